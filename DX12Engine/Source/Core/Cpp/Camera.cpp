@@ -41,6 +41,7 @@ void Camera::setLens(const float fovY, const float aspectRatio, const float near
 	// Generate the World -> View transform matrix
 	XMMATRIX projMtx = DirectX::XMMatrixPerspectiveFovRH(m_fovY, m_aspectRatio, m_nearZ, m_farZ);
 	XMStoreFloat4x4(&m_projMtx, projMtx);
+	m_dirty = true;
 }
 
 void Camera::setPosition(DirectX::XMFLOAT3 position)
@@ -206,6 +207,11 @@ DirectX::XMFLOAT4X4 Camera::getProjMtx() const
 	return m_projMtx;
 }
 
+const Frustum& Camera::getFrustum() const
+{
+	return m_frustum;
+}
+
 void Camera::update()
 {
 	if (m_dirty)
@@ -252,6 +258,11 @@ void Camera::update()
 		m_viewMtx(2, 3) = 0.0f;
 		m_viewMtx(3, 3) = 1.0f; 
 
+		// The frustum planes of the World -> Clip transform
+		XMFLOAT4X4 viewProjMtx;
+		DirectX::XMStoreFloat4x4(&viewProjMtx, DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&m_viewMtx), DirectX::XMLoadFloat4x4(&m_projMtx)));
+		m_frustum = GetFrustum(&viewProjMtx.m[0][0]);
+
 		m_dirty = false;
 	}
 }
\ No newline at end of file
@@ -1,21 +1,63 @@
 #include "Mesh.h"
 #include "DXUtil.h"
 
-D3D12_INPUT_ELEMENT_DESC vertexElementsDesc[] =
+namespace
 {
+	DXGI_FORMAT GetElementFormat(const VertexElement& element)
 	{
-		"POSITION",						// Semantic name: this will be used from the vertex shader to indentify the input field 
-		0,								// Semantin index: a descriptor could have the same name, but different index (e.g. "POSITION0", "POSITION1")
-		DXGI_FORMAT_R32G32B32_FLOAT,	// A DXGI_FORMAT that describe the data type
-		0,								// Input slot 0
-		0,								// Byte offset from the beginning of the struct, 0 because is the first struct field
-		D3D12_INPUT_CLASSIFICATION::D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
-		0								// Instaced data step rate
-	},
-	{"NORMAL", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION::D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-	{"TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 2, 0, D3D12_INPUT_CLASSIFICATION::D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-	{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 3, 0, D3D12_INPUT_CLASSIFICATION::D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}
-};
+		const DXGI_FORMAT floatFormats[] = { DXGI_FORMAT_R32_FLOAT, DXGI_FORMAT_R32G32_FLOAT, DXGI_FORMAT_R32G32B32_FLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT };
+		switch (element.format)
+		{
+		case VertexFormat::Float32: return floatFormats[element.componentsCount - 1];
+		case VertexFormat::Unorm16x4: return DXGI_FORMAT_R16G16B16A16_UNORM;
+		case VertexFormat::OctSnorm16x2:
+		case VertexFormat::OctSignSnorm16x2: return DXGI_FORMAT_R16G16_SNORM;
+		case VertexFormat::Half2: return DXGI_FORMAT_R16G16_FLOAT;
+		case VertexFormat::Unorm16x2: return DXGI_FORMAT_R16G16_UNORM;
+		}
+		DXUtil::ThrowException("Unknown vertex format " + std::to_string(static_cast<uint32_t>(element.format)));
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+std::vector<D3D12_INPUT_ELEMENT_DESC> GetInputElementsDesc(const VertexLayout& layout)
+{
+	std::vector<D3D12_INPUT_ELEMENT_DESC> elementsDesc;
+	for (const VertexElement& element : layout.elements)
+	{
+		const VertexAttributeDesc& attribute = GetVertexAttributeDesc(element.attribute);
+		elementsDesc.push_back({
+			attribute.semanticName,					// Semantic name: this will be used from the vertex shader to indentify the input field
+			attribute.semanticIndex,				// Semantic index: a descriptor could have the same name, but different index (e.g. "TEXCOORD0", "TEXCOORD1")
+			GetElementFormat(element),				// A DXGI_FORMAT that describe the data type, 32 bit floats or the 16 bit quantized formats
+			element.slot,							// Input slot
+			element.byteOffset,						// Byte offset from the beginning of the vertex in its slot
+			D3D12_INPUT_CLASSIFICATION::D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
+			0										// Instaced data step rate
+		});
+	}
+	return elementsDesc;
+}
+
+BufferView& SubMesh::GetAttributeView(const VertexAttribute attribute)
+{
+	return const_cast<BufferView&>(static_cast<const SubMesh*>(this)->GetAttributeView(attribute));
+}
+
+const BufferView& SubMesh::GetAttributeView(const VertexAttribute attribute) const
+{
+	switch (attribute)
+	{
+	case VERTEX_ATTRIBUTE_POSITION: return verticesBufferView;
+	case VERTEX_ATTRIBUTE_NORMAL: return normalsBufferView;
+	case VERTEX_ATTRIBUTE_TANGENT: return tangentsBufferView;
+	case VERTEX_ATTRIBUTE_TEXCOORD0: return texCoord0BufferView;
+	case VERTEX_ATTRIBUTE_TEXCOORD1: return texCoord1BufferView;
+	case VERTEX_ATTRIBUTE_COLOR0: return colorsBufferView;
+	default: DXUtil::ThrowException("Unknown vertex attribute " + std::to_string(attribute));
+	}
+	return verticesBufferView;
+}
 
 Mesh::Mesh()
 {
@@ -42,7 +84,18 @@ void Mesh::SetNodeMtx(const DirectX::XMFLOAT4X4& nodeMtx)
 	constants.nodeTransformMtx = nodeMtx;
 }
 
-void Mesh::AddSubMesh(const SubMesh&& subMesh)
+void Mesh::AddSubMesh(SubMesh&& subMesh)
+{
+	m_bounds.Add(subMesh.bounds);
+	m_subMeshes.push_back(std::move(subMesh));
+}
+
+const std::vector<SubMesh>& Mesh::GetSubMeshes() const
+{
+	return m_subMeshes;
+}
+
+const BoundingBox& Mesh::GetBounds() const
 {
-	m_subMeshes.push_back(subMesh);
+	return m_bounds;
 }
\ No newline at end of file
@@ -419,17 +419,17 @@ void Renderer::CreatePipelineState(SkyBox* skyBox)
 
 void Renderer::CreatePipelineState(Scene* scene, const bool wireFrame)
 {
-    D3D12_INPUT_LAYOUT_DESC inputLayoutDesc;
-    inputLayoutDesc.pInputElementDescs = vertexElementsDesc;
-    inputLayoutDesc.NumElements = 4;
+    // The input layout follows the vertex buffers the scene was loaded in
+    std::vector<D3D12_INPUT_ELEMENT_DESC> inputElementsDesc = GetInputElementsDesc(scene->GetVertexLayout());
 
     D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-    psoDesc.InputLayout = { vertexElementsDesc, 4 };
+    psoDesc.InputLayout = { inputElementsDesc.data(), static_cast<UINT>(inputElementsDesc.size()) };
     psoDesc.pRootSignature = scene->CreateRootSignature().Get();
     psoDesc.VS = { reinterpret_cast<UINT8*>(scene->GetVertexShader()->GetBufferPointer()), scene->GetVertexShader()->GetBufferSize() };
     psoDesc.PS = { reinterpret_cast<UINT8*>(scene->GetPixelShader()->GetBufferPointer()), scene->GetPixelShader()->GetBufferSize() };
     psoDesc.RasterizerState.FillMode = (wireFrame) ? D3D12_FILL_MODE_WIREFRAME : D3D12_FILL_MODE_SOLID;
     psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+    psoDesc.RasterizerState.FrontCounterClockwise = TRUE;    // The indices are uploaded with the glTF winding
     psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
     psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
     psoDesc.SampleMask = UINT_MAX;
@@ -3,9 +3,24 @@
 #include "Mesh.h"
 #include "Camera.h"
 #include "SkyBox.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
 
 #include "using_directives.h"
 
+namespace
+{
+	/** The smaller of the sphere around the world box and of the world transformed sphere around the model box */
+	BoundingSphere GetWorldBoundingSphere(const BoundingBox& modelBounds, const BoundingBox& worldBounds, const XMFLOAT4X4& worldMtx)
+	{
+		BoundingSphere sphere = ::GetBoundingSphere(worldBounds);
+		BoundingSphere transformedSphere = TransformBoundingSphere(::GetBoundingSphere(modelBounds), &worldMtx.m[0][0]);
+		if (!modelBounds.IsEmpty() && transformedSphere.radius < sphere.radius) sphere = transformedSphere;
+		return sphere;
+	}
+}
+
 Scene::~Scene() {}
 
 Scene::Scene(ComPtr<ID3D12Device> device)
@@ -127,6 +142,8 @@ void Scene::AddTexture(const unsigned int textureId, Microsoft::WRL::ComPtr<ID3D
 
 void Scene::AddSampler(const unsigned int samplerId, D3D12_SAMPLER_DESC samplerDesc)
 {
+	m_samplers[samplerId] = samplerDesc;
+
 	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(m_samplersDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
 	hDescriptor.Offset(samplerId, m_samplersDescriptorSize);
 	m_device->CreateSampler(&samplerDesc, m_samplersDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
@@ -137,20 +154,11 @@ void Scene::AddLight(const unsigned int lightId, const Light&& light)
 	m_lights[lightId] = light;
 }
 
-void Scene::AddMesh(const Mesh&& mesh)
+void Scene::AddMesh(Mesh&& mesh)
 {
 	unsigned int meshId = mesh.GetId();
-	m_meshes[meshId] = mesh;
-	m_meshConstantsBuffer[meshId] = std::make_unique<UploadBuffer<MeshConstants>>(m_device.Get(), MAX_MESH_INSTANCES, false);
-
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(m_CBVSRVDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-	hDescriptor.Offset(meshId, m_CBVSRVDescriptorSize); // Texture descriptors starts after material descrisptors, in the CBV_SRV_UAV descriptor heap layout of the Scene class
-
-	D3D12_CONSTANT_BUFFER_VIEW_DESC meshConstantsDesc;
-	D3D12_GPU_VIRTUAL_ADDRESS bufferAddress = m_meshConstantsBuffer[meshId]->getResource()->GetGPUVirtualAddress();
-	meshConstantsDesc.BufferLocation = bufferAddress;
-	meshConstantsDesc.SizeInBytes = DXUtil::PadByteSizeTo256Mul(sizeof(MeshConstants));
-	m_device->CreateConstantBufferView(&meshConstantsDesc, hDescriptor);
+	m_meshes[meshId] = std::move(mesh);
+	m_areNodesBoundsDirty = true;
 }
 
 void Scene::SetCubeMapTexture(Microsoft::WRL::ComPtr<ID3D12Resource> cubeMapTexture)
@@ -170,19 +178,29 @@ void Scene::SetCubeMapTexture(Microsoft::WRL::ComPtr<ID3D12Resource> cubeMapText
 	m_device->CreateShaderResourceView(m_cubeMapTexture.Get(), &srvDesc, hDescriptor);
 }
 
-float Scene::GetSceneRadius() const
+const VertexLayout& Scene::GetVertexLayout() const
+{
+	return m_vertexLayout;
+}
+
+const BoundingBox& Scene::GetBounds() const
 {
-	return sqrt(m_sceneRadius.x*m_sceneRadius.x + m_sceneRadius.y * m_sceneRadius.y + m_sceneRadius.z * m_sceneRadius.z);
+	return m_sceneBounds;
+}
+
+BoundingSphere Scene::GetBoundingSphere() const
+{
+	return ::GetBoundingSphere(m_sceneBounds);
 }
 
 ComPtr<ID3D12RootSignature> Scene::CreateRootSignature()
 {
 	if (m_rootSignature) return m_rootSignature;
 
-	CD3DX12_ROOT_PARAMETER rootParameters[4] = {};
+	CD3DX12_ROOT_PARAMETER rootParameters[6] = {};
 
 	rootParameters[0].InitAsConstantBufferView(0, 0);	// Parameter 1: Root descriptor that will holds the pass constants PassConstants
-	rootParameters[1].InitAsShaderResourceView(0, 0);	// Parameter 2: Root descriptor for mesh constants
+	rootParameters[1].InitAsShaderResourceView(0, 0);	// Parameter 2: Root descriptor for the instance constants of the batch drawn
 
 	CD3DX12_DESCRIPTOR_RANGE descriptorRangesCBVSRV[3] = {};	// Parameter 3: Descriptor table with different ranges
 	// Descriptor range for materials
@@ -197,7 +215,13 @@ ComPtr<ID3D12RootSignature> Scene::CreateRootSignature()
 	descriptorRangeSamplers[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, SAMPLERS_N_DESCRIPTORS, 0);
 	rootParameters[3].InitAsDescriptorTable(1, descriptorRangeSamplers);
 
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, rootParameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+	// Parameter 5: Root constants with the vertex dequantization of the submesh drawn
+	rootParameters[4].InitAsConstants(sizeof(VertexDequantization) / sizeof(uint32_t), 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+
+	// Parameter 6: Root constant with the material of the batch drawn
+	rootParameters[5].InitAsConstants(1, 2, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(6, rootParameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 	ComPtr<ID3DBlob> serializedRootSig = nullptr;
 	ComPtr<ID3DBlob> errorBlob = nullptr;
 	ThrowIfFailed(D3D12SerializeRootSignature(&rootSigDesc, D3D_ROOT_SIGNATURE_VERSION_1, serializedRootSig.GetAddressOf(), errorBlob.GetAddressOf()), 
@@ -208,7 +232,7 @@ ComPtr<ID3D12RootSignature> Scene::CreateRootSignature()
 	return m_rootSignature;
 }
 
-void Scene::SetRootSignature(ID3D12GraphicsCommandList* commandList, const unsigned int meshId)
+void Scene::SetRootSignature(ID3D12GraphicsCommandList* commandList)
 {
 	ID3D12DescriptorHeap* descriptorHeaps[] = { m_CBVSRVDescriptorHeap.Get(), m_samplersDescriptorHeap.Get() };
 	commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
@@ -218,10 +242,7 @@ void Scene::SetRootSignature(ID3D12GraphicsCommandList* commandList, const unsig
 	// Set the frame constants root parameter
 	commandList->SetGraphicsRootConstantBufferView(0, m_frameConstantsBuffer->getResource()->GetGPUVirtualAddress());
 
-	// Set the mesh constants root parameter
-	commandList->SetGraphicsRootShaderResourceView(1, m_meshConstantsBuffer[meshId]->getResource()->GetGPUVirtualAddress());
-
-	// Set the descriptors table parameter for mesh constants, materials, textures
+	// Set the descriptors table parameter for materials, textures, the instance constants are set by each batch
 	commandList->SetGraphicsRootDescriptorTable(2, m_CBVSRVDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
 
 	// Set the descriptors table parameter for samplers
@@ -237,28 +258,95 @@ void Scene::SetCamera(const Camera& camera)
 {
 	m_frameConstants.projMtx = camera.getProjMtx();
 	m_frameConstants.viewMtx = camera.getViewMtx();
-	XMStoreFloat4x4(&m_frameConstants.projViewMtx, XMMatrixTranspose(XMMatrixMultiply(XMLoadFloat4x4(&m_frameConstants.viewMtx), XMLoadFloat4x4(&m_frameConstants.projMtx))));
+	XMStoreFloat4x4(&m_viewProjMtx, XMMatrixMultiply(XMLoadFloat4x4(&m_frameConstants.viewMtx), XMLoadFloat4x4(&m_frameConstants.projMtx)));
+	XMStoreFloat4x4(&m_frameConstants.projViewMtx, XMMatrixTranspose(XMLoadFloat4x4(&m_viewProjMtx)));
 	m_frameConstants.eyePosition = DirectX::XMFLOAT4(camera.GetPosition().x, camera.GetPosition().y, camera.GetPosition().z, 1.0f);
 	m_frameConstantsBuffer->copyData(0, m_frameConstants);
+	m_cameraFovY = camera.getFovY();
+	m_frustum = camera.getFrustum();
+}
+
+void Scene::SetViewportHeight(const UINT height)
+{
+	m_viewportHeight = height;
+}
+
+void Scene::SetLodPixelError(const float pixelError)
+{
+	m_lodPixelError = pixelError;
+}
+
+void Scene::SetMeshletCulling(const bool enabled)
+{
+	m_cullMeshlets = enabled;
+}
+
+void Scene::SetFrustumCulling(const bool enabled)
+{
+	m_cullNodes = enabled;
+}
+
+void Scene::SetOcclusionCulling(const bool enabled)
+{
+	m_cullOccluded = enabled;
+	if (!enabled) m_lastVisibleBounds.clear();
+}
+
+void Scene::SetOccluderReuse(const bool enabled)
+{
+	m_reuseOccluders = enabled;
+}
+
+const SceneCullingStats& Scene::GetCullingStats() const
+{
+	return m_cullingStats;
 }
 
 void Scene::SetMeshConstants(const unsigned int meshId, MeshConstants meshConstants)
 {
 	if (m_meshes.find(meshId) == m_meshes.end()) return;
-	XMStoreFloat4x4(&meshConstants.nodeTransformMtx, XMMatrixTranspose(XMLoadFloat4x4(&meshConstants.nodeTransformMtx)));	// Transpose the matrix due HLSL use a column-major memory layout by default
+	if (std::memcmp(&m_meshes[meshId].constants.modelMtx, &meshConstants.modelMtx, sizeof(XMFLOAT4X4)) != 0) m_areNodesBoundsDirty = true;
 	m_meshes[meshId].SetModelMtx(meshConstants.modelMtx);
-
-	int i = 0;
-	for(MeshConstants meshConstants : m_meshInstances[meshId]) 
-	{
-		XMStoreFloat4x4(&meshConstants.nodeTransformMtx, XMMatrixTranspose(XMLoadFloat4x4(&meshConstants.nodeTransformMtx)));	// Transpose the matrix due HLSL use a column-major memory layout by default
-		m_meshConstantsBuffer[meshId]->copyData(i++, meshConstants);
-	}
 }
 
 void Scene::SetRootTransform(DirectX::XMFLOAT4X4 sceneTransform)
 {
-	m_sceneTransform = sceneTransform;
+	m_transforms.SetRootTransform(&sceneTransform.m[0][0]);
+}
+
+size_t Scene::AddNode(const int parentId, const int meshId)
+{
+	// Depth first order: the parent is the last node or one of its ancestors, so that every subtree is a range of nodes
+	int ancestorId = m_nodes.empty() ? -1 : static_cast<int>(m_nodes.size() - 1);
+	while (ancestorId != parentId && ancestorId != -1) ancestorId = m_nodes[ancestorId].parentId;
+	if (ancestorId != parentId) DXUtil::ThrowException("Scene node parent is not an ancestor of the previous node");
+
+	SceneNode node;
+	node.meshId = meshId;
+	node.parentId = parentId;
+	m_nodes.push_back(node);
+	m_areNodesBoundsDirty = true;
+	return m_transforms.AddNode(parentId);
+}
+
+const std::vector<SceneNode>& Scene::GetNodes() const
+{
+	return m_nodes;
+}
+
+void Scene::SetNodeTransform(const size_t nodeId, const LocalTransform& transform)
+{
+	m_transforms.SetLocalTransform(nodeId, transform);
+}
+
+void Scene::SetNodeMatrix(const size_t nodeId, const DirectX::XMFLOAT4X4& transformMtx)
+{
+	m_transforms.SetLocalMatrix(nodeId, &transformMtx.m[0][0]);
+}
+
+LocalTransform Scene::GetNodeTransform(const size_t nodeId) const
+{
+	return m_transforms.GetLocalTransform(nodeId);
 }
 
 void Scene::SetRenderMode(const int renderMode)
@@ -280,127 +368,352 @@ void Scene::UpdateConstants(FrameConstants frameConstants)
 
 void Scene::Draw(ID3D12GraphicsCommandList* commandList)
 {
-	m_meshInstances.clear();												//Maybe refactor this out, and deal with it differently
 	if (m_isInitialized)													 
 	{
-		// glTF is a disjoint union of strict trees
-		for(std::shared_ptr<SceneNode> node : m_sceneTree)
+		UpdateBounds();
+		CullNodes();
+
+		// The visible submeshes are grouped by mesh, submesh and material, one instanced draw per group over its contiguous instances
+		m_instanceBatcher.Build(m_visibleBounds, m_cullingBoundsKeys, static_cast<uint32_t>(m_batchKeys.size()));
+		const std::vector<uint32_t>& instances = m_instanceBatcher.GetInstances();
+		m_cullingStats.batchesCount = m_instanceBatcher.GetBatches().size();
+		if (instances.empty()) return;
+
+		// The renderer waits for the GPU at the end of each frame, so the instances buffer of the last frame can be rewritten or replaced
+		if (instances.size() > m_instancesCapacity)
 		{
-			// Apply the whole scene (root) transformation m_sceneTransform  
-			SetupNode(node.get(), m_sceneTransform); 						//Setup may be refactored out of Draw method, conceptually
-			DrawNode(node.get(), commandList, m_sceneTransform);
+			m_instancesCapacity = (std::max)({ instances.size(), 2 * m_instancesCapacity, MIN_INSTANCES_CAPACITY });
+			m_instancesBuffer = std::make_unique<UploadBuffer<InstanceConstants>>(m_device.Get(), static_cast<UINT>(m_instancesCapacity), false);
 		}
+		const size_t chunksCount = (instances.size() + INSTANCES_CHUNK_SIZE - 1) / INSTANCES_CHUNK_SIZE;
+		ThreadPool::GetDefault().ParallelFor(chunksCount, [&](size_t chunk)
+		{
+			for (size_t i = chunk * INSTANCES_CHUNK_SIZE; i < (std::min)(instances.size(), (chunk + 1) * INSTANCES_CHUNK_SIZE); i++)
+			{
+				InstanceConstants instance;
+				XMStoreFloat4x4(&instance.worldMtx, XMMatrixTranspose(XMLoadFloat4x4(&m_nodes[m_cullingBoundsNodes[instances[i]]].worldMtx)));	// HLSL reads matrices column-major by default
+				m_instancesBuffer->copyData(static_cast<int>(i), instance);
+			}
+		});
+
+		SetRootSignature(commandList);
+		for (const InstanceBatch& batch : m_instanceBatcher.GetBatches()) DrawBatch(batch, commandList);
 	}
 }
 
-void Scene::SetupNode(SceneNode* node, DirectX::XMFLOAT4X4 parentMtx)
+void Scene::UpdateBounds()
 {
-	DirectX::XMFLOAT4X4 M;
-	DirectX::XMStoreFloat4x4(&M, DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&node->transformMtx), DirectX::XMLoadFloat4x4(&parentMtx)));
+	// Only the nodes placed again get new bounds, unless a mesh changed
+	m_transforms.Update();
+	if (m_areNodesBoundsDirty)
+	{
+		// The meshes or the nodes changed: number the submeshes in the order of their instanced draws
+		std::vector<BatchKey> subMeshKeys;
+		std::map<unsigned int, size_t> meshFirstKeys;
+		for (const auto& mesh : m_meshes)
+		{
+			meshFirstKeys[mesh.first] = subMeshKeys.size();
+			const std::vector<SubMesh>& subMeshes = mesh.second.GetSubMeshes();
+			for (size_t s = 0; s < subMeshes.size(); s++) subMeshKeys.push_back({ mesh.first, static_cast<uint32_t>(s), subMeshes[s].materialId });
+		}
+		std::vector<uint32_t> keyIds;
+		m_batchKeys.assign(AssignBatchKeys(subMeshKeys, keyIds), BatchKey());
+		for (size_t k = 0; k < subMeshKeys.size(); k++) m_batchKeys[keyIds[k]] = subMeshKeys[k];
+
+		// Then lay out the culling bounds of the nodes submeshes again
+		m_nodeFirstCullingBounds.assign(m_nodes.size() + 1, 0);
+		m_cullingBoundsNodes.clear();
+		m_occluderTriangles.clear();
+		m_cullingBoundsKeys.clear();
+		m_lastVisibleBounds.clear();
+		m_cullingStats = SceneCullingStats();
+		for (size_t nodeId = 0; nodeId < m_nodes.size(); nodeId++)
+		{
+			m_nodeFirstCullingBounds[nodeId] = m_cullingBoundsNodes.size();
+			if (m_nodes[nodeId].meshId == -1) continue;
+			const std::vector<SubMesh>& subMeshes = m_meshes[m_nodes[nodeId].meshId].GetSubMeshes();
+			size_t subMeshesCount = subMeshes.size();
+			m_cullingBoundsNodes.insert(m_cullingBoundsNodes.end(), subMeshesCount, static_cast<uint32_t>(nodeId));
+			for (const SubMesh& subMesh : subMeshes) m_occluderTriangles.push_back(subMesh.bvh.triangles.size());
+			for (size_t s = 0; s < subMeshesCount; s++) m_cullingBoundsKeys.push_back(keyIds[meshFirstKeys[m_nodes[nodeId].meshId] + s]);
+			m_cullingStats.nodesCount++;
+		}
+		m_nodeFirstCullingBounds[m_nodes.size()] = m_cullingBoundsNodes.size();
+		m_cullingBounds.Resize(m_cullingBoundsNodes.size());
+		m_cullingStats.subMeshesCount = m_cullingBoundsNodes.size();
 
-	if (node->meshId != -1)
+		for (size_t nodeId = 0; nodeId < m_nodes.size(); nodeId++) UpdateNodeBounds(nodeId);
+		m_cullingBVH.Build(m_cullingBounds, ThreadPool::GetDefault());
+	}
+	else if (m_transforms.GetUpdatedNodes().empty()) return;
+	else
 	{
-		m_meshes[node->meshId].SetNodeMtx(M);
-		m_meshInstances[node->meshId].push_back(m_meshes[node->meshId].constants);
-		SetMeshConstants(node->meshId, m_meshes[node->meshId].constants);		
+		// Every node placed again, as after a root transform change, refits the whole hierarchy on the pool threads
+		const std::vector<uint32_t>& updatedNodes = m_transforms.GetUpdatedNodes();
+		if (updatedNodes.size() == m_nodes.size()) m_cullingBVH.MarkAllMoved();
+		for (uint32_t nodeId : updatedNodes)
+		{
+			UpdateNodeBounds(nodeId);
+			if (updatedNodes.size() == m_nodes.size()) continue;
+			for (size_t i = m_nodeFirstCullingBounds[nodeId]; i < m_nodeFirstCullingBounds[nodeId + 1]; i++) m_cullingBVH.MarkMoved(i);
+		}
+		m_cullingBVH.Update(m_cullingBounds, ThreadPool::GetDefault());
 	}
+	m_areNodesBoundsDirty = false;
+
+	m_sceneBounds = BoundingBox();
+	for (const SceneNode& node : m_nodes) m_sceneBounds.Add(node.bounds);
+	m_isInstanceBVHDirty = true;
+}
 
-	for (const std::unique_ptr<SceneNode>& child : node->children)
+bool Scene::IntersectRay(const Ray& ray, SceneRayHit& hit)
+{
+	if (m_isInstanceBVHDirty)
 	{
-		SetupNode(child.get(), M);
+		// One instance per submesh with a hierarchy of each node, placed by the node world matrix
+		std::vector<BVHInstance> instances;
+		m_instanceTriangleBVHs.clear();
+		for (size_t nodeId = 0; nodeId < m_nodes.size(); nodeId++)
+		{
+			const SceneNode& node = m_nodes[nodeId];
+			if (node.meshId == -1) continue;
+
+			const std::vector<SubMesh>& subMeshes = m_meshes[node.meshId].GetSubMeshes();
+			for (size_t s = 0; s < subMeshes.size(); s++)
+			{
+				if (subMeshes[s].bvh.IsEmpty()) continue;
+				BVHInstance instance;
+				std::memcpy(instance.transform, &node.worldMtx.m[0][0], sizeof(instance.transform));
+				instance.bvhId = static_cast<uint32_t>(m_instanceTriangleBVHs.size());
+				instance.nodeId = static_cast<uint32_t>(nodeId);
+				instance.subMeshId = static_cast<uint32_t>(s);
+				instances.push_back(instance);
+				m_instanceTriangleBVHs.push_back(&subMeshes[s].bvh);
+			}
+		}
+		BuildInstanceBVH(instances, m_instanceTriangleBVHs, BVHOptions(), ThreadPool::GetDefault(), m_instanceBVH);
+		m_isInstanceBVHDirty = false;
 	}
+
+	RayHit rayHit;
+	if (!::IntersectRay(m_instanceBVH, m_instanceTriangleBVHs, ray, rayHit)) return false;
+	const BVHInstance& instance = m_instanceBVH.instances[rayHit.instance];
+	hit.nodeId = instance.nodeId;
+	hit.meshId = m_nodes[instance.nodeId].meshId;
+	hit.subMeshId = instance.subMeshId;
+	hit.triangle = rayHit.triangle;
+	hit.t = rayHit.t;
+	hit.u = rayHit.u;
+	hit.v = rayHit.v;
+	return true;
 }
 
-void Scene::DrawNode(SceneNode* node, ID3D12GraphicsCommandList* commandList, DirectX::XMFLOAT4X4 parentMtx)
+size_t Scene::QueryNodes(const BoundingBox& region, std::vector<size_t>& nodeIds) const
 {
-	DirectX::XMFLOAT4X4 M;
-	DirectX::XMStoreFloat4x4(&M, DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&node->transformMtx), DirectX::XMLoadFloat4x4(&parentMtx)));
-
-	if(node->meshId != -1) 
+	// The submeshes bounds are in node order, the nodes of the sorted submeshes found are sorted too
+	std::vector<uint32_t> objects;
+	m_cullingBVH.Query(region, m_cullingBounds, objects);
+	nodeIds.clear();
+	for (uint32_t i : objects)
 	{
-		//m_meshes[node->meshId].SetNodeMtx(M);
-		//m_meshInstances[node->meshId].push_back(m_meshes[node->meshId].constants);
-		SetMeshConstants(node->meshId, m_meshes[node->meshId].constants);
-		SetRootSignature(commandList, node->meshId);
-		DrawMesh(m_meshes[node->meshId], commandList);
+		if (nodeIds.empty() || nodeIds.back() != m_cullingBoundsNodes[i]) nodeIds.push_back(m_cullingBoundsNodes[i]);
 	}
+	return nodeIds.size();
+}
 
-	for (const std::unique_ptr<SceneNode>& child : node->children)
+size_t Scene::QueryNodes(const Ray& ray, std::vector<size_t>& nodeIds) const
+{
+	std::vector<uint32_t> objects;
+	m_cullingBVH.Query(ray, m_cullingBounds, objects);
+	nodeIds.clear();
+	for (uint32_t i : objects)
 	{
-		DrawNode(child.get(), commandList, M);
+		if (nodeIds.empty() || nodeIds.back() != m_cullingBoundsNodes[i]) nodeIds.push_back(m_cullingBoundsNodes[i]);
 	}
+	return nodeIds.size();
 }
 
-void Scene::DrawMesh(const Mesh& mesh, ID3D12GraphicsCommandList* commandList) 
+void Scene::UpdateNodeBounds(const size_t nodeId)
 {
-	int nextIdBuf = 0;
-	for (const SubMesh& subMesh : mesh.m_subMeshes)
+	SceneNode& node = m_nodes[nodeId];
+	node.bounds = BoundingBox();
+	node.boundingSphere = BoundingSphere();
+	if (node.meshId != -1)
 	{
-		D3D12_VERTEX_BUFFER_VIEW vbView; // Vertices buffer view
-		if(subMesh.verticesBufferView.bufferId != -1) 
+		// The box of the transformed box corners, and the smaller of the sphere around it and of the transformed sphere around the local box
+		const Mesh& mesh = m_meshes[node.meshId];
+		XMFLOAT4X4 M, worldMtx;
+		std::memcpy(&M, m_transforms.GetWorldMatrix(nodeId), sizeof(M));
+		DirectX::XMStoreFloat4x4(&worldMtx, DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&mesh.constants.modelMtx), DirectX::XMLoadFloat4x4(&M)));
+		node.worldMtx = worldMtx;
+		node.bounds = TransformBoundingBox(mesh.GetBounds(), &worldMtx.m[0][0]);
+		node.boundingSphere = GetWorldBoundingSphere(mesh.GetBounds(), node.bounds, worldMtx);
+
+		// The same bounds for each submesh, culled on their own
+		const std::vector<SubMesh>& subMeshes = mesh.GetSubMeshes();
+		for (size_t s = 0; s < subMeshes.size(); s++)
 		{
-			vbView.BufferLocation = m_buffersGPU[subMesh.verticesBufferView.bufferId]->GetGPUVirtualAddress() + subMesh.verticesBufferView.byteOffset;
-			vbView.StrideInBytes = static_cast<UINT>((subMesh.verticesBufferView.byteStride == 0) ? sizeof(DirectX::XMFLOAT3) : subMesh.verticesBufferView.byteStride);
-			vbView.SizeInBytes = static_cast<UINT>(subMesh.verticesBufferView.byteLength);
-			commandList->IASetVertexBuffers(nextIdBuf++, 1, &vbView);
+			BoundingBox subMeshBounds = TransformBoundingBox(subMeshes[s].bounds, &worldMtx.m[0][0]);
+			m_cullingBounds.Set(m_nodeFirstCullingBounds[nodeId] + s, subMeshBounds, GetWorldBoundingSphere(subMeshes[s].bounds, subMeshBounds, worldMtx));
 		}
-		
-		D3D12_VERTEX_BUFFER_VIEW nbView; // Normals buffer view
-		if (subMesh.normalsBufferView.bufferId != -1)
-		{
-			nbView.BufferLocation = m_buffersGPU[subMesh.normalsBufferView.bufferId]->GetGPUVirtualAddress() + subMesh.normalsBufferView.byteOffset;
-			nbView.StrideInBytes = static_cast<UINT>((subMesh.normalsBufferView.byteStride == 0) ? sizeof(DirectX::XMFLOAT3) : subMesh.normalsBufferView.byteStride);
-			nbView.SizeInBytes = static_cast<UINT>(subMesh.normalsBufferView.byteLength);
-			commandList->IASetVertexBuffers(nextIdBuf++, 1, &nbView);
-		}
-		//else nbView = vbView;
+	}
+}
 
-		D3D12_VERTEX_BUFFER_VIEW tbView; // Tangents buffer view
-		if (subMesh.tangentsBufferView.bufferId != -1)
-		{
-			tbView.BufferLocation = m_buffersGPU[subMesh.tangentsBufferView.bufferId]->GetGPUVirtualAddress() + subMesh.tangentsBufferView.byteOffset;
-			tbView.StrideInBytes = static_cast<UINT>((subMesh.tangentsBufferView.byteStride == 0) ? sizeof(DirectX::XMFLOAT4) : subMesh.tangentsBufferView.byteStride);
-			tbView.SizeInBytes = static_cast<UINT>(subMesh.tangentsBufferView.byteLength);
-			commandList->IASetVertexBuffers(nextIdBuf++, 1, &tbView);
-		}
-		//else tbView = vbView;
+void Scene::CullNodes()
+{
+	m_visibleBounds.clear();
+	if (m_cullNodes) m_cullingBVH.Cull(m_frustum, m_cullingBounds, m_visibleBounds);
+	else for (size_t i = 0; i < m_cullingBounds.count; i++) m_visibleBounds.push_back(static_cast<uint32_t>(i));
+	m_cullingStats.occludedSubMeshesCount = 0;
+	m_cullingStats.occludersCount = 0;
+	if (m_cullOccluded) CullOccluded();
+
+	// A node is drawn if one of its submeshes may be visible, the bounds of a node are contiguous
+	m_visibleNodes.clear();
+	for (uint32_t i : m_visibleBounds)
+	{
+		uint32_t nodeId = m_cullingBoundsNodes[i];
+		if (m_visibleNodes.empty() || m_visibleNodes.back() != nodeId) m_visibleNodes.push_back(nodeId);
+	}
+	m_cullingStats.visibleNodesCount = m_visibleNodes.size();
+	m_cullingStats.visibleSubMeshesCount = m_visibleBounds.size();
+}
 
-		D3D12_VERTEX_BUFFER_VIEW tc0bView; // Texture coordinates buffer view
-		if (subMesh.texCoord0BufferView.bufferId != -1)
-		{
-			tc0bView.BufferLocation = m_buffersGPU[subMesh.texCoord0BufferView.bufferId]->GetGPUVirtualAddress() + subMesh.texCoord0BufferView.byteOffset;
-			tc0bView.StrideInBytes = static_cast<UINT>((subMesh.texCoord0BufferView.byteStride == 0) ? sizeof(DirectX::XMFLOAT2) : subMesh.texCoord0BufferView.byteStride);
-			tc0bView.SizeInBytes = static_cast<UINT>(subMesh.texCoord0BufferView.byteLength);
-			commandList->IASetVertexBuffers(nextIdBuf++, 1, &tc0bView);
-		}
-		//else tc0bView = vbView;
+void Scene::CullOccluded()
+{
+	// The largest submeshes on screen are the occluders: with the reuse, among the ones the last frame drew, which are seldom hidden themselves
+	ThreadPool& pool = ThreadPool::GetDefault();
+	const std::vector<uint32_t>& candidates = (m_reuseOccluders && !m_lastVisibleBounds.empty()) ? m_lastVisibleBounds : m_visibleBounds;
+	const float eye[3] = { m_frameConstants.eyePosition.x, m_frameConstants.eyePosition.y, m_frameConstants.eyePosition.z };
+	SelectOccluders(m_cullingBounds, candidates, m_occluderTriangles, eye, m_occlusionOptions, m_occluderBounds);
+
+	std::vector<Occluder> occluders(m_occluderBounds.size());
+	for (size_t o = 0; o < occluders.size(); o++)
+	{
+		uint32_t nodeId = m_cullingBoundsNodes[m_occluderBounds[o]];
+		const TriangleBVH& bvh = m_meshes[m_nodes[nodeId].meshId].GetSubMeshes()[m_occluderBounds[o] - m_nodeFirstCullingBounds[nodeId]].bvh;
+		occluders[o].vertices = bvh.vertices.data();
+		occluders[o].trianglesCount = bvh.triangles.size();
+		std::memcpy(occluders[o].transform, &m_nodes[nodeId].worldMtx.m[0][0], sizeof(occluders[o].transform));
+	}
+	m_occlusionBuffer.SetViewProjection(&m_viewProjMtx.m[0][0]);
+	m_occlusionBuffer.Rasterize(occluders, pool);
+	m_occlusionBuffer.TestBounds(m_cullingBounds, m_visibleBounds, m_unoccludedBounds, pool);
+
+	m_cullingStats.occludedSubMeshesCount = m_visibleBounds.size() - m_unoccludedBounds.size();
+	m_cullingStats.occludersCount = occluders.size();
+	std::swap(m_visibleBounds, m_unoccludedBounds);
+	m_lastVisibleBounds = m_visibleBounds;
+}
 
-		D3D12_VERTEX_BUFFER_VIEW tc1bView; // Texture coordinates buffer view
-		if (subMesh.texCoord1BufferView.bufferId != -1)
-		{
-			tc1bView.BufferLocation = m_buffersGPU[subMesh.texCoord1BufferView.bufferId]->GetGPUVirtualAddress() + subMesh.texCoord0BufferView.byteOffset;
-			tc1bView.StrideInBytes = static_cast<UINT>((subMesh.texCoord1BufferView.byteStride == 0) ? sizeof(DirectX::XMFLOAT2) : subMesh.texCoord1BufferView.byteStride);
-			tc1bView.SizeInBytes = static_cast<UINT>(subMesh.texCoord0BufferView.byteLength);
-			commandList->IASetVertexBuffers(nextIdBuf++, 1, &tc1bView);
-		}
-	
-		commandList->IASetPrimitiveTopology(subMesh.topology);
+void Scene::DrawBatch(const InstanceBatch& batch, ID3D12GraphicsCommandList* commandList) 
+{
+	const BatchKey& key = m_batchKeys[batch.key];
+	const SubMesh& subMesh = m_meshes[key.meshId].GetSubMeshes()[key.subMeshId];
 
-		D3D12_INDEX_BUFFER_VIEW ibView;
-		if (subMesh.indicesBufferView.bufferId != -1)
-		{
-			ibView.BufferLocation = m_buffersGPU[subMesh.indicesBufferView.bufferId]->GetGPUVirtualAddress() + subMesh.indicesBufferView.byteOffset;
-			ibView.Format = DXGI_FORMAT_R16_UINT;
-			ibView.SizeInBytes = static_cast<UINT>(subMesh.indicesBufferView.byteLength);
-			D3D12_INDEX_BUFFER_VIEW indexBuffers[1] = { ibView };
+	// SV_InstanceID starts at 0 in each draw, the instance constants view starts at the first instance of the batch
+	commandList->SetGraphicsRootShaderResourceView(1, m_instancesBuffer->getResource()->GetGPUVirtualAddress() + batch.firstInstance * sizeof(InstanceConstants));
 
-			commandList->IASetIndexBuffer(indexBuffers);
-			commandList->DrawIndexedInstanced(static_cast<UINT>(subMesh.indicesBufferView.count), static_cast<UINT>(m_meshInstances[mesh.GetId()].size()), 0, 0, 0);
-		}
-		else
+	// Each slot of the layout is bound to the buffer of its first element. The slots of the attributes a submesh lacks
+	// get a null view, read as zeros, so that no buffer of the previous submesh stays bound
+	D3D12_VERTEX_BUFFER_VIEW vbViews[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT] = {};
+	for (const VertexElement& element : m_vertexLayout.elements)
+	{
+		const BufferView& view = subMesh.GetAttributeView(element.attribute);
+		D3D12_VERTEX_BUFFER_VIEW& vbView = vbViews[element.slot];
+		if (view.bufferId == -1 || vbView.BufferLocation != 0) continue;
+
+		vbView.BufferLocation = m_buffersGPU[view.bufferId]->GetGPUVirtualAddress() + view.byteOffset - element.byteOffset;
+		vbView.StrideInBytes = static_cast<UINT>((view.byteStride == 0) ? view.elemType * sizeof(float) : view.byteStride);
+		vbView.SizeInBytes = static_cast<UINT>(view.byteLength + element.byteOffset);
+	}
+	commandList->IASetVertexBuffers(0, static_cast<UINT>(m_vertexLayout.slotStrides.size()), vbViews);
+	commandList->SetGraphicsRoot32BitConstants(4, sizeof(VertexDequantization) / sizeof(uint32_t), &subMesh.dequantization, 0);
+	commandList->SetGraphicsRoot32BitConstant(5, key.materialId, 0);
+
+	commandList->IASetPrimitiveTopology(subMesh.topology);
+
+	// A level of detail replaces the indices, the vertex buffers are the same
+	const SubMeshLod* lod = SelectLod(subMesh, batch);
+	const BufferView& indicesBufferView = lod ? lod->indicesBufferView : subMesh.indicesBufferView;
+
+	D3D12_INDEX_BUFFER_VIEW ibView;
+	if (indicesBufferView.bufferId != -1)
+	{
+		ibView.BufferLocation = m_buffersGPU[indicesBufferView.bufferId]->GetGPUVirtualAddress() + indicesBufferView.byteOffset;
+		ibView.Format = (indicesBufferView.componentType == BUFFER_ELEM_TYPE_UNSIGNED_INT) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+		ibView.SizeInBytes = static_cast<UINT>(indicesBufferView.byteLength);
+		D3D12_INDEX_BUFFER_VIEW indexBuffers[1] = { ibView };
+
+		commandList->IASetIndexBuffer(indexBuffers);
+
+		// The meshlets cluster the full submesh indices, a level of detail is drawn whole
+		if (m_cullMeshlets && !lod && !subMesh.meshlets.empty() && batch.instancesCount <= MESHLET_CULLING_MAX_INSTANCES)
 		{
-			// No indices, it's a vertices list
-			commandList->DrawInstanced(static_cast<UINT>(subMesh.verticesBufferView.count), static_cast<UINT>(m_meshInstances[mesh.GetId()].size()), 0, 0);
+			for (const MeshletRange& range : CullMeshlets(subMesh, batch)) commandList->DrawIndexedInstanced(range.indicesCount, batch.instancesCount, range.firstIndex, 0, 0);
 		}
+		else commandList->DrawIndexedInstanced(static_cast<UINT>(indicesBufferView.count), batch.instancesCount, 0, 0, 0);
+	}
+	else
+	{
+		// No indices, it's a vertices list
+		commandList->DrawInstanced(static_cast<UINT>(subMesh.verticesBufferView.count), batch.instancesCount, 0, 0);
+	}
+}
+
+const SubMeshLod* Scene::SelectLod(const SubMesh& subMesh, const InstanceBatch& batch)
+{
+	if (subMesh.lods.empty() || m_lodPixelError <= 0.0f || m_viewportHeight == 0) return nullptr;
+
+	// An error e at distance d covers e * viewportHeight / (2 * d * tan(fovY / 2)) pixels: the closest instance, relative to its scale, sets the level
+	const float pixelsPerRadian = static_cast<float>(m_viewportHeight) / (2.0f * tanf(0.5f * m_cameraFovY));
+	const XMVECTOR eye = XMLoadFloat4(&m_frameConstants.eyePosition);
+	const XMFLOAT4& sphere = subMesh.boundingSphere;
+	float pixelsPerUnit = 0.0f;
+	const std::vector<uint32_t>& instances = m_instanceBatcher.GetInstances();
+	for (uint32_t i = batch.firstInstance; i < batch.firstInstance + batch.instancesCount; i++)
+	{
+		XMMATRIX worldMtx = XMLoadFloat4x4(&m_nodes[m_cullingBoundsNodes[instances[i]]].worldMtx);
+		float scale = (std::max)({ XMVectorGetX(DirectX::XMVector3Length(worldMtx.r[0])), XMVectorGetX(DirectX::XMVector3Length(worldMtx.r[1])),
+			XMVectorGetX(DirectX::XMVector3Length(worldMtx.r[2])) });
+		XMVECTOR center = DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(sphere.x, sphere.y, sphere.z, 1.0f), worldMtx);
+		float distance = XMVectorGetX(DirectX::XMVector3Length(XMVectorSubtract(center, eye))) - sphere.w * scale;
+		if (distance <= 0.0f) return nullptr;	// The camera is inside the submesh bounds
+		pixelsPerUnit = (std::max)(pixelsPerUnit, scale * pixelsPerRadian / distance);
+	}
+
+	const SubMeshLod* selected = nullptr;
+	for (const SubMeshLod& lod : subMesh.lods)
+	{
+		if (lod.error * pixelsPerUnit > m_lodPixelError) break;
+		selected = &lod;
+	}
+	return selected;
+}
+
+std::vector<MeshletRange> Scene::CullMeshlets(const SubMesh& subMesh, const InstanceBatch& batch)
+{
+	// The instances share the draw calls: a meshlet is drawn if any instance sees it
+	const XMMATRIX viewProjMtx = XMMatrixMultiply(XMLoadFloat4x4(&m_frameConstants.viewMtx), XMLoadFloat4x4(&m_frameConstants.projMtx));
+	const XMVECTOR eye = XMLoadFloat4(&m_frameConstants.eyePosition);
+	std::vector<uint8_t> visible;
+	const std::vector<uint32_t>& instances = m_instanceBatcher.GetInstances();
+	for (uint32_t i = batch.firstInstance; i < batch.firstInstance + batch.instancesCount; i++)
+	{
+		XMMATRIX worldMtx = XMLoadFloat4x4(&m_nodes[m_cullingBoundsNodes[instances[i]]].worldMtx);
+		XMFLOAT4X4 modelViewProjMtx;
+		XMStoreFloat4x4(&modelViewProjMtx, XMMatrixMultiply(worldMtx, viewProjMtx));
+		XMFLOAT3 modelEye;
+		XMStoreFloat3(&modelEye, DirectX::XMVector3TransformCoord(eye, XMMatrixInverse(nullptr, worldMtx)));
+
+		// The normal cones are only valid under a uniform scale, and a mirror makes the rasterizer cull the other faces
+		float scales[3] = { XMVectorGetX(DirectX::XMVector3Length(worldMtx.r[0])), XMVectorGetX(DirectX::XMVector3Length(worldMtx.r[1])),
+			XMVectorGetX(DirectX::XMVector3Length(worldMtx.r[2])) };
+		float minScale = (std::min)({ scales[0], scales[1], scales[2] });
+		float maxScale = (std::max)({ scales[0], scales[1], scales[2] });
+		bool isConeValid = maxScale - minScale <= 1e-3f * maxScale && XMVectorGetX(DirectX::XMMatrixDeterminant(worldMtx)) > 0.0f;
+
+		MarkVisibleMeshlets(subMesh.meshlets, GetMeshletCullingView(&modelViewProjMtx.m[0][0], &modelEye.x, isConeValid), visible);
 	}
+	return GetMeshletRanges(subMesh.meshlets, visible, MESHLET_MERGE_GAP_INDICES);
 }
@@ -1,6 +1,4 @@
 #include "shaders.h"
-#include <Pathcch.h>
-#include <atlstr.h>
 
 #include "using_directives.h"
 
@@ -40,14 +38,7 @@ bool CompileVertexShader(const std::wstring vsFileName, std::string& errorMsg, C
     UINT compileFlags = 0;
 #endif
 
-    TCHAR filePath[200];
-    _tcscpy_s(filePath, CA2T(DXUtil::transform_to<string>(vsFileName).c_str()));
-    PathCchRemoveFileSpec(filePath, 200);
-
-    TCHAR currentPath[200];
-    GetCurrentDirectory(200, currentPath);
-    SetCurrentDirectory(filePath);
-
+    // The standard include handler resolves includes relative to the shader file, no need to change the working directory
     ComPtr<ID3DBlob> errorBlob;
     if (FAILED(D3DCompileFromFile(vsFileName.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, "VSMain", "vs_5_1", compileFlags, 0, &vertexShader, &errorBlob)))
     {
@@ -56,8 +47,6 @@ bool CompileVertexShader(const std::wstring vsFileName, std::string& errorMsg, C
             return false;
     }
 
-    SetCurrentDirectory(currentPath);
-
     DEBUG_LOG("Compiled vertex shader")
     return true;
 }
@@ -75,14 +64,7 @@ bool CompilePixelShader(const std::wstring psFileName, std::string& errorMsg, Co
     UINT compileFlags = 0;
 #endif
     
-    TCHAR filePath[200];
-    _tcscpy_s(filePath, CA2T(DXUtil::transform_to<string>(psFileName).c_str()));
-    PathCchRemoveFileSpec(filePath, 200);
-
-    TCHAR currentPath[200];
-    GetCurrentDirectory(200, currentPath);
-    SetCurrentDirectory(filePath);
-
+    // The standard include handler resolves includes relative to the shader file, no need to change the working directory
     ComPtr<ID3DBlob> errorBlob;
     if (FAILED(D3DCompileFromFile(psFileName.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, "PSMain", "ps_5_1", compileFlags, 0, &pixelShader, &errorBlob)))
     {
@@ -90,7 +72,6 @@ bool CompilePixelShader(const std::wstring psFileName, std::string& errorMsg, Co
         DEBUG_LOG(errorMsg.c_str())
             return false;
     }
-    SetCurrentDirectory(currentPath);
 
     DEBUG_LOG("Compiled pixel shader")
     return true;
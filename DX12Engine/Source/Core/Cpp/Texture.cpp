@@ -33,4 +33,30 @@ void CreateTextureFromDDSFile(ID3D12Device* device, ID3D12CommandQueue* commandQ
 		"Cannot create DDS texture from " + fileName);
 	auto finish = resourceUploadBatch.End(commandQueue);
 	finish.wait();
+}
+
+void CreateTextureFromDecoded(ID3D12Device* device, UploadBatch& uploadBatch, const DecodedTexture& decodedTexture, ID3D12Resource** texture)
+{
+	std::vector<D3D12_SUBRESOURCE_DATA> subresources(decodedTexture.mipLevels.size());
+	for (size_t i = 0; i < subresources.size(); i++)
+	{
+		subresources[i].pData = decodedTexture.GetMipData(i);
+		subresources[i].RowPitch = static_cast<LONG_PTR>(decodedTexture.GetRowPitch(i));
+		subresources[i].SlicePitch = subresources[i].RowPitch * decodedTexture.mipLevels[i].height;
+	}
+	CreateTextureFromSubresources(device, uploadBatch, decodedTexture.GetWidth(), decodedTexture.GetHeight(), subresources, texture);
+}
+
+void CreateTextureFromSubresources(ID3D12Device* device, UploadBatch& uploadBatch, const UINT64 width, const UINT height, 
+	const std::vector<D3D12_SUBRESOURCE_DATA>& subresources, ID3D12Resource** texture)
+{
+	D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, static_cast<UINT16>(subresources.size()));
+	DXUtil::ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(texture)), "Cannot create texture");
+	uploadBatch.EnqueueTexture(*texture, subresources);
 }
\ No newline at end of file
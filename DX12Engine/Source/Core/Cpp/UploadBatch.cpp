@@ -0,0 +1,161 @@
+#include "UploadBatch.h"
+
+#include "using_directives.h"
+
+UploadBatch::UploadBatch(ComPtr<ID3D12Device> device, ComPtr<ID3D12CommandQueue> commandQueue, const uint64_t stagingBudget)
+	: m_device(device), m_commandQueue(commandQueue), m_stagingBudget(stagingBudget)
+{
+	ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandListAlloc)), "Cannot create command allocator");
+	ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandListAlloc.Get(), nullptr, IID_PPV_ARGS(&m_commandList)), "Cannot create command list");
+	m_commandList->Close();
+	ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)), "Cannot create fence");
+	m_fenceEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+	if (m_fenceEvent == nullptr) DXUtil::ThrowException("Cannot create fence event");
+}
+
+UploadBatch::~UploadBatch()
+{
+	CloseHandle(m_fenceEvent);
+}
+
+ComPtr<ID3D12Resource> UploadBatch::EnqueueBuffer(const void* data, const UINT64 byteSize)
+{
+	PendingUpload upload;
+	ThrowIfFailed(m_device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(upload.resource.GetAddressOf())), "Cannot create default buffer");
+	upload.data = data;
+	upload.byteSize = byteSize;
+	m_pendingUploads.push_back(std::move(upload));
+	return m_pendingUploads.back().resource;
+}
+
+ComPtr<ID3D12Resource> UploadBatch::EnqueueBuffer(std::vector<uint8_t>&& data)
+{
+	ComPtr<ID3D12Resource> buffer = EnqueueBuffer(data.data(), data.size());
+	m_pendingUploads.back().ownedData = std::move(data);	// Moving a vector keeps its storage, so upload.data is still valid
+	return buffer;
+}
+
+void UploadBatch::EnqueueTexture(ID3D12Resource* texture, const std::vector<D3D12_SUBRESOURCE_DATA>& subresources)
+{
+	PendingUpload upload;
+	upload.resource = texture;
+	upload.isTexture = true;
+	upload.subresources = subresources;
+	upload.layouts.resize(subresources.size());
+	upload.rowsCount.resize(subresources.size());
+	upload.rowByteSizes.resize(subresources.size());
+
+	D3D12_RESOURCE_DESC desc = texture->GetDesc();
+	m_device->GetCopyableFootprints(&desc, 0, static_cast<UINT>(subresources.size()), 0, 
+		upload.layouts.data(), upload.rowsCount.data(), upload.rowByteSizes.data(), &upload.byteSize);
+	m_pendingUploads.push_back(std::move(upload));
+}
+
+void UploadBatch::Submit()
+{
+	UploadPlanner planner(m_stagingBudget);
+	for (const PendingUpload& upload : m_pendingUploads)
+	{
+		planner.Add(upload.byteSize, upload.isTexture ? D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT : BUFFER_PLACEMENT_ALIGNMENT);
+	}
+	planner.Plan();
+
+	for (const UploadBatchPlan& batch : planner.GetBatches()) SubmitBatch(planner, batch);
+	m_pendingUploads.clear();
+}
+
+void UploadBatch::SubmitBatch(const UploadPlanner& planner, const UploadBatchPlan& batch)
+{
+	ComPtr<ID3D12Resource> staging;
+	ThrowIfFailed(m_device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(batch.byteSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(staging.GetAddressOf())), "Cannot create upload buffer");
+
+	uint8_t* stagingData = nullptr;
+	ThrowIfFailed(staging->Map(0, nullptr, reinterpret_cast<void**>(&stagingData)), "Cannot map upload buffer");
+
+	ThrowIfFailed(m_commandListAlloc->Reset(), "Cannot reset allocator");
+	ThrowIfFailed(m_commandList->Reset(m_commandListAlloc.Get(), nullptr), "Cannot reset command list");
+
+	// Buffers are created in the common state, move them all to copy dest at once
+	std::vector<D3D12_RESOURCE_BARRIER> barriers;
+	for (size_t requestId : batch.requests)
+	{
+		const PendingUpload& upload = m_pendingUploads[requestId];
+		if (!upload.isTexture) barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(upload.resource.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+	}
+	if (!barriers.empty()) m_commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+	barriers.clear();
+
+	for (size_t requestId : batch.requests)
+	{
+		const PendingUpload& upload = m_pendingUploads[requestId];
+		UINT64 stagingOffset = planner.GetPlacement(requestId).byteOffset;
+
+		if (upload.isTexture)
+		{
+			for (size_t i = 0; i < upload.subresources.size(); i++)
+			{
+				D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout = upload.layouts[i];
+				layout.Offset += stagingOffset;
+				D3D12_MEMCPY_DEST dest = { stagingData + layout.Offset, layout.Footprint.RowPitch, SIZE_T(layout.Footprint.RowPitch) * upload.rowsCount[i] };
+				MemcpySubresource(&dest, &upload.subresources[i], static_cast<SIZE_T>(upload.rowByteSizes[i]), upload.rowsCount[i], layout.Footprint.Depth);
+
+				CD3DX12_TEXTURE_COPY_LOCATION dst(upload.resource.Get(), static_cast<UINT>(i));
+				CD3DX12_TEXTURE_COPY_LOCATION src(staging.Get(), layout);
+				m_commandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+			}
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(upload.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+		}
+		else
+		{
+			memcpy(stagingData + stagingOffset, upload.data, static_cast<size_t>(upload.byteSize));
+			m_commandList->CopyBufferRegion(upload.resource.Get(), 0, staging.Get(), stagingOffset, upload.byteSize);
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(upload.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
+		}
+	}
+	m_commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+
+	staging->Unmap(0, nullptr);
+	ThrowIfFailed(m_commandList->Close(), "Cannot close command list");
+	ID3D12CommandList* commandLists[] = { m_commandList.Get() };
+	m_commandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+	m_submissionsCount++;
+
+	// The staging buffer is released when the copies are done, so at most one budget of staging memory is alive
+	FlushCommandQueue();
+}
+
+void UploadBatch::FlushCommandQueue()
+{
+	m_currentFenceValue++;
+	ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), m_currentFenceValue), "Cannot signal fence");
+
+	if (m_fence->GetCompletedValue() < m_currentFenceValue)
+	{
+		ThrowIfFailed(m_fence->SetEventOnCompletion(m_currentFenceValue, m_fenceEvent), "Cannot set fence event on completion");
+		WaitForSingleObject(m_fenceEvent, INFINITE);
+	}
+}
+
+uint64_t UploadBatch::GetPendingBytes() const
+{
+	uint64_t bytes = 0;
+	for (const PendingUpload& upload : m_pendingUploads) bytes += upload.byteSize;
+	return bytes;
+}
+
+size_t UploadBatch::GetSubmissionsCount() const
+{
+	return m_submissionsCount;
+}
@@ -0,0 +1,104 @@
+#include "UploadPlanner.h"
+
+#include <stdexcept>
+
+UploadPlanner::UploadPlanner(const uint64_t stagingBudget) : m_stagingBudget(stagingBudget)
+{
+	if (stagingBudget == 0) throw std::invalid_argument("Staging budget must be greater than zero");
+}
+
+size_t UploadPlanner::Add(const uint64_t byteSize, const uint64_t alignment)
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0) throw std::invalid_argument("Upload alignment must be a power of two");
+	m_requests.push_back({ byteSize, alignment });
+	return m_requests.size() - 1;
+}
+
+void UploadPlanner::Plan()
+{
+	m_batches.clear();
+	m_placements.assign(m_requests.size(), UploadPlacement());
+
+	for (size_t i = 0; i < m_requests.size(); i++)
+	{
+		const Request& request = m_requests[i];
+		uint64_t byteOffset = m_batches.empty() ? 0 : AlignUp(m_batches.back().byteSize, request.alignment);
+
+		// Start a new batch when the current one is full, staging allocations always start aligned
+		if (m_batches.empty() || (!m_batches.back().requests.empty() && byteOffset + request.byteSize > m_stagingBudget))
+		{
+			m_batches.push_back(UploadBatchPlan());
+			byteOffset = 0;
+		}
+
+		UploadBatchPlan& batch = m_batches.back();
+		batch.requests.push_back(i);
+		batch.byteSize = byteOffset + request.byteSize;
+		m_placements[i] = { m_batches.size() - 1, byteOffset };
+	}
+}
+
+void UploadPlanner::Clear()
+{
+	m_requests.clear();
+	m_placements.clear();
+	m_batches.clear();
+}
+
+bool UploadPlanner::Validate() const
+{
+	if (m_placements.size() != m_requests.size()) return false;
+
+	for (size_t batchId = 0; batchId < m_batches.size(); batchId++)
+	{
+		const UploadBatchPlan& batch = m_batches[batchId];
+		if (batch.requests.empty()) return false;
+		if (batch.byteSize > m_stagingBudget && batch.requests.size() > 1) return false;
+
+		uint64_t end = 0;
+		for (size_t requestId : batch.requests)
+		{
+			const UploadPlacement& placement = m_placements[requestId];
+			const Request& request = m_requests[requestId];
+			if (placement.batchId != batchId) return false;
+			if (placement.byteOffset % request.alignment != 0) return false;
+			if (placement.byteOffset < end) return false;	// Requests are placed in order, so this detects overlaps
+			end = placement.byteOffset + request.byteSize;
+		}
+		if (end > batch.byteSize) return false;
+	}
+	return true;
+}
+
+const std::vector<UploadBatchPlan>& UploadPlanner::GetBatches() const
+{
+	return m_batches;
+}
+
+const UploadPlacement& UploadPlanner::GetPlacement(const size_t requestId) const
+{
+	return m_placements.at(requestId);
+}
+
+size_t UploadPlanner::GetRequestsCount() const
+{
+	return m_requests.size();
+}
+
+uint64_t UploadPlanner::GetStagingBudget() const
+{
+	return m_stagingBudget;
+}
+
+uint64_t UploadPlanner::GetPaddingBytes() const
+{
+	uint64_t usedBytes = 0, requestedBytes = 0;
+	for (const UploadBatchPlan& batch : m_batches) usedBytes += batch.byteSize;
+	for (const Request& request : m_requests) requestedBytes += request.byteSize;
+	return usedBytes - requestedBytes;
+}
+
+uint64_t UploadPlanner::AlignUp(const uint64_t value, const uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
@@ -13,7 +13,7 @@ constexpr uint8_t BUFFER_ELEM_TYPE_FLOAT = 4;
 /** BufferView is used to address resources in larger memory buffers */
 struct BufferView
 {
-	int8_t bufferId = -1;
+	int bufferId = -1;
 	size_t byteOffset = 0;
 	size_t byteLength = 0;
 	size_t byteStride = 0;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "DXUtil.h"
+#include "FrustumCulling.h"
 
 /**
  * Implements a first person camera.
@@ -72,6 +73,9 @@ public:
 	DirectX::XMFLOAT4X4 getViewMtx() const;
 	DirectX::XMFLOAT4X4 getProjMtx() const;
 
+	/** The world space view frustum, as of the last update */
+	const Frustum& getFrustum() const;
+
 private:
 
 	UINT32 m_width;
@@ -90,8 +94,9 @@ private:
 	DirectX::XMFLOAT3 m_up;			// Positive Y direction 
 	DirectX::XMFLOAT3 m_forward;	// Positive Z direction
 	
-	bool m_dirty;	// The base vectors have changed and the view matrix needs to be updated 
+	bool m_dirty;	// The base vectors or the lens have changed and the view matrix and frustum need to be updated 
 
 	DirectX::XMFLOAT4X4 m_viewMtx = DXUtil::IdentityMtx();
 	DirectX::XMFLOAT4X4 m_projMtx = DXUtil::IdentityMtx();
+	Frustum m_frustum;		// Planes of the view projection, in world space
 };
\ No newline at end of file
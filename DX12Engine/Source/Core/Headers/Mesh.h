@@ -2,11 +2,22 @@
 
 #include "DXUtil.h"
 #include "Scene.h"
+#include "Meshlets.h"
+#include "Bounds.h"
+#include "MeshBVH.h"
+#include "VertexLayout.h"
 
 #define DESCRIPTORS_HEAP_SIZE 50
 
-/** Mesh vertex descriptor */
-D3D12_INPUT_ELEMENT_DESC vertexElementsDesc[];
+/** Return the input elements of the vertex buffers of layout, one per attribute */
+std::vector<D3D12_INPUT_ELEMENT_DESC> GetInputElementsDesc(const VertexLayout& layout);
+
+/** A simplified level of detail of a SubMesh, its indices address the vertex buffers of the submesh */
+struct SubMeshLod
+{
+	BufferView indicesBufferView;
+	float error = 0.0f;		// Estimate of the largest distance from the submesh surface, in model units
+};
 
 /** A submes is a part of a Mesh */
 struct SubMesh
@@ -20,6 +31,16 @@ struct SubMesh
 	BufferView indicesBufferView;
 	unsigned int materialId = 0;
 	D3D_PRIMITIVE_TOPOLOGY topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	std::vector<SubMeshLod> lods;								// From the finest to the coarsest, empty if the submesh has no levels of detail
+	BoundingBox bounds;											// Bounding box of the positions in model units, empty if the submesh has none
+	DirectX::XMFLOAT4 boundingSphere = { 0.0f, 0.0f, 0.0f, 0.0f };	// Center and radius in model units, used to select the level of detail
+	std::vector<Meshlet> meshlets;								// Clusters of the indices, culled before the draw, empty if the submesh has none
+	TriangleBVH bvh;											// Hierarchy of the triangles in model units for the ray queries, empty if the submesh has none
+	VertexDequantization dequantization;						// Decodes the quantized vertex elements, root constants of the vertex shader
+
+	/** Return the view of a vertex attribute. With an interleaved layout the views of a slot share its buffer and stride, each at the offset of its element */
+	BufferView& GetAttributeView(const VertexAttribute attribute);
+	const BufferView& GetAttributeView(const VertexAttribute attribute) const;
 };
 
 /** MeshConstants contains all mesh constants used from shaders */
@@ -30,6 +51,12 @@ struct MeshConstants
 	DirectX::XMFLOAT4 rotXYZ; // Rotations about the X, Y and Z axis. The fourth component is not used
 };
 
+/** The constants of a drawn instance of a submesh, in the scene instances buffer */
+struct InstanceConstants
+{
+	DirectX::XMFLOAT4X4 worldMtx;	// Model to world matrix of the node, transposed for HLSL
+};
+
 /** A 3D mesh */
 class Mesh
 {
@@ -37,17 +64,23 @@ public:
 	Mesh();
 	Mesh(const Mesh& mesh) = default;
 	Mesh& operator=(const Mesh& mesh) = default;
+	Mesh(Mesh&& mesh) = default;
+	Mesh& operator=(Mesh&& mesh) = default;
 	
 	void SetId(const unsigned int id);
 	unsigned int GetId() const;
 	void SetModelMtx(const DirectX::XMFLOAT4X4& modelMtx);
 	void SetNodeMtx(const DirectX::XMFLOAT4X4& nodeMtx); // A model transformation defined as the default position of the mesh in the world
-	void AddSubMesh(const SubMesh&& subMesh);
+	void AddSubMesh(SubMesh&& subMesh);
+	const std::vector<SubMesh>& GetSubMeshes() const;
+
+	/** Return the bounding box of the submeshes, in model units */
+	const BoundingBox& GetBounds() const;
 
-	friend void Scene::DrawMesh(const Mesh& mesh, ID3D12GraphicsCommandList* commandList);
 	MeshConstants constants;
 protected:
 	unsigned int m_id;
 	
 	std::vector<SubMesh> m_subMeshes;
+	BoundingBox m_bounds;
 };
\ No newline at end of file
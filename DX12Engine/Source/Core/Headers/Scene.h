@@ -4,6 +4,14 @@
 #include "DXUtil.h"
 #include "Renderer.h"
 #include "Material.h"
+#include "VertexLayout.h"
+#include "Bounds.h"
+#include "MeshBVH.h"
+#include "TransformHierarchy.h"
+#include "FrustumCulling.h"
+#include "DynamicBVH.h"
+#include "OcclusionCulling.h"
+#include "InstanceBatching.h"
 #include <string>
 #include <vector>
 #include <map>
@@ -12,15 +20,48 @@
 class GLTFSceneLoader;
 class Camera;
 class Mesh;
+struct SubMesh;
+struct SubMeshLod;
+struct MeshletRange;
 struct MeshConstants;
+struct InstanceConstants;
 class SkyBox;
 
-/* A SceneNode is a node in the scene graph */
+/**
+ * A SceneNode is a node in the scene graph. The nodes are flattened in depth first order, each node followed by its descendants, and
+ * their transformations are in the scene TransformHierarchy at the same index
+ */
 struct SceneNode 
 {
 	int meshId = -1;											// Id of the scene mesh associated with this node, -1 for no mesh
-	std::vector<std::unique_ptr<SceneNode>> children;			// Children of this node
-	DirectX::XMFLOAT4X4 transformMtx = DXUtil::IdentityMtx();	// Node tranformation relative to its parent
+	int parentId = -1;											// Index of the parent node, -1 for a root
+	BoundingBox bounds;											// World bounds of the node mesh, empty for no mesh. Set by Scene::UpdateBounds
+	BoundingSphere boundingSphere;								// World bounding sphere of the node mesh
+	DirectX::XMFLOAT4X4 worldMtx = DXUtil::IdentityMtx();		// Model to world matrix of the node mesh, set by Scene::UpdateBounds
+};
+
+/** The nearest triangle hit by a scene ray query */
+struct SceneRayHit
+{
+	size_t nodeId = 0;					// The node whose mesh is hit
+	int meshId = -1;
+	size_t subMeshId = 0;
+	uint32_t triangle = RAY_NO_HIT;		// The triangle in the submesh indices, in the order they are uploaded
+	float t = 0.0f;						// Distance along the ray, in units of its direction
+	float u = 0.0f;						// Barycentric coordinates of the hit point in the triangle
+	float v = 0.0f;
+};
+
+/** The mesh nodes and their submeshes in the camera frustum and not hidden by the occluders, and their instanced draws, as of the last Draw */
+struct SceneCullingStats
+{
+	size_t nodesCount = 0;				// Nodes with a mesh
+	size_t visibleNodesCount = 0;
+	size_t subMeshesCount = 0;			// Submeshes of the nodes with a mesh, a mesh counts once per node
+	size_t visibleSubMeshesCount = 0;
+	size_t occludedSubMeshesCount = 0;	// Submeshes in the frustum hidden by the occluders
+	size_t occludersCount = 0;			// Submeshes rasterized as occluders
+	size_t batchesCount = 0;			// Instanced draws of the visible submeshes, one per mesh, submesh and material
 };
 
 class Scene : public DrawableAsset
@@ -40,38 +81,124 @@ public:
 	void AddTexture(const unsigned int textureId, Microsoft::WRL::ComPtr<ID3D12Resource> texture);
 	void AddSampler(const unsigned int samplerId, D3D12_SAMPLER_DESC samplerDesc);
 	void AddLight(const unsigned int lightId, const Light&& light);
-	void AddMesh(const Mesh&& mesh);
+	void AddMesh(Mesh&& mesh);
 	
 	void SetCamera(const Camera& camera);
+
+	/** Set the height in pixels of the viewport the scene is drawn to, used with the camera field of view to select the levels of detail */
+	void SetViewportHeight(const UINT height);
+
+	/** Set the largest error in pixels of the level of detail drawn for a submesh, 0 always draws the full submeshes */
+	void SetLodPixelError(const float pixelError);
+
+	/** Enable or disable the culling of the submeshes meshlets against the camera frustum and their normal cones (enabled by default) */
+	void SetMeshletCulling(const bool enabled);
+
+	/** Enable or disable the culling of the mesh nodes and their submeshes against the camera frustum (enabled by default) */
+	void SetFrustumCulling(const bool enabled);
+
+	/**
+	 * Enable or disable the culling of the submeshes hidden by the largest ones on screen, rasterized on the CPU into a coarse depth
+	 * buffer (disabled by default). Only the submeshes with a ray query hierarchy, whose triangles are kept on the CPU, are occluders
+	 */
+	void SetOcclusionCulling(const bool enabled);
+
+	/** Pick the occluders among the submeshes drawn by the last frame, rather than among the ones in the frustum (enabled by default) */
+	void SetOccluderReuse(const bool enabled);
+
+	/** Return the counts of nodes and submeshes drawn by the last Draw */
+	const SceneCullingStats& GetCullingStats() const;
+
+	/** Set the model matrix of a mesh, applied under the node matrices of its instances */
 	void SetMeshConstants(const unsigned int meshId, MeshConstants meshConstant);
 
-	/** Set the root transformation for this scene, used to rotate/translate the whole scene (model) */
+	/** Set the root transformation for this scene, used to rotate/translate the whole scene (model). The nodes are placed again only if it changed */
 	void SetRootTransform(DirectX::XMFLOAT4X4 sceneTransform);
+
+	/**
+	 * Append a node under parentId, -1 for a root, and return its index. A node must follow its parent and the nodes of its earlier
+	 * siblings subtrees, the depth first order. Throw if parentId is not an earlier node
+	 */
+	size_t AddNode(const int parentId, const int meshId);
+
+	/** Return the nodes, in depth first order */
+	const std::vector<SceneNode>& GetNodes() const;
+
+	/** Set the transformation of a node relative to its parent, the node and its descendants are placed again by the next UpdateBounds */
+	void SetNodeTransform(const size_t nodeId, const LocalTransform& transform);
+
+	/** Set the matrix of a node relative to its parent, kept as is when it has shear */
+	void SetNodeMatrix(const size_t nodeId, const DirectX::XMFLOAT4X4& transformMtx);
+
+	LocalTransform GetNodeTransform(const size_t nodeId) const;
 	
 	void SetRenderMode(const int renderMode);
 	void SetLight(const unsigned int lightId, Light light);
 	void SetCubeMapTexture(Microsoft::WRL::ComPtr<ID3D12Resource> cubeMapTexture);
 	
-	float GetSceneRadius() const;
+	/**
+	 * Transform the bounds of the meshes to world space with the node transformations and the root transform, into the bounds of each
+	 * node and of the whole scene. Only the nodes whose transformation, or an ancestor or the root one, changed since the last call are
+	 * transformed again. Called by Draw, and after a load to place the camera before the first draw
+	 */
+	void UpdateBounds();
+
+	/** Return the world bounding box of the scene, as of the last UpdateBounds */
+	const BoundingBox& GetBounds() const;
+
+	/** Return the world bounding sphere of the scene, as of the last UpdateBounds */
+	BoundingSphere GetBoundingSphere() const;
+
+	/**
+	 * Find the nearest triangle hit by the world ray in the submeshes that have a hierarchy, as the nodes were placed by the last
+	 * UpdateBounds. The hierarchy over the node submeshes is rebuilt on the first query after an UpdateBounds that moved a node.
+	 * Return false if the ray hits nothing
+	 */
+	bool IntersectRay(const Ray& ray, SceneRayHit& hit);
+
+	/** Write the mesh nodes with a submesh whose world box intersects region to nodeIds, in increasing order, and return their count */
+	size_t QueryNodes(const BoundingBox& region, std::vector<size_t>& nodeIds) const;
+
+	/** Write the mesh nodes with a submesh whose world box the ray hits to nodeIds, in increasing order, and return their count */
+	size_t QueryNodes(const Ray& ray, std::vector<size_t>& nodeIds) const;
+
+	/** Return the layout of the submeshes vertex buffers, the input layout of the scene pipeline */
+	const VertexLayout& GetVertexLayout() const;
 
 	Microsoft::WRL::ComPtr<ID3D12RootSignature> CreateRootSignature();
 	void Draw(ID3D12GraphicsCommandList* commandList) override;									//Should be const conceptually; see notes in .cpp
-	void SetupNode(SceneNode* node, DirectX::XMFLOAT4X4 parentMtx);
-	void DrawNode(SceneNode* node, ID3D12GraphicsCommandList* commandList, DirectX::XMFLOAT4X4 parentMtx);
-	void DrawMesh(const Mesh& mesh, ID3D12GraphicsCommandList* commandList);
 
 protected:
 	virtual void SetUpRootSignature(ID3D12GraphicsCommandList* commandList);
 
 	void AddFrameConstantsBuffer();
-	void SetRootSignature(ID3D12GraphicsCommandList* commandList, const unsigned int meshId);
+	void SetRootSignature(ID3D12GraphicsCommandList* commandList);
 	void UpdateConstants(FrameConstants frameConstants);
+	void UpdateNodeBounds(const size_t nodeId);
+
+	/** Find the mesh nodes and the submeshes whose world bounds may be in the camera frustum, the ones Draw draws, walking the hierarchy over their bounds */
+	void CullNodes();
 
-	const unsigned int MESH_CONSTANTS_N_DESCRIPTORS = 100;	// Mesh constants descriptors goes from 0 to 15 in the CBV_SRV_UAV descriptor heap (maximum 15 mesh)
-	const unsigned int MATERIALS_N_DESCRIPTORS = 100;		// Materials descriptors goes from 15 to 29 in the CBV_SRV_UAV descriptor heap (maximum 15 materials)
-	const unsigned int TEXTURES_N_DESCRIPTORS = 100;		// Texture resource view descriptors go from 30 to 44 in the CBV_SRV_UAV descriptor heap (maximum 15 textures)
+	/** Remove the submeshes hidden by the occluders from the ones CullNodes found in the frustum */
+	void CullOccluded();
+
+	/** Draw the instances of a batch of the last CullNodes with one instanced draw call, or one per range of visible meshlets */
+	void DrawBatch(const InstanceBatch& batch, ID3D12GraphicsCommandList* commandList);
+
+	/** Return the coarsest level of detail of subMesh whose error stays under the pixel error at its closest instance in batch, nullptr for the full submesh */
+	const SubMeshLod* SelectLod(const SubMesh& subMesh, const InstanceBatch& batch);
+
+	/** Return the index ranges of the meshlets of subMesh visible from at least one instance of batch */
+	std::vector<MeshletRange> CullMeshlets(const SubMesh& subMesh, const InstanceBatch& batch);
+
+	const unsigned int MESH_CONSTANTS_N_DESCRIPTORS = 100;	// Not in the descriptor heap, the node matrices are read from the instances buffer
+	const unsigned int MATERIALS_N_DESCRIPTORS = 100;		// Materials descriptors go from 0 to 99 in the CBV_SRV_UAV descriptor heap (maximum 100 materials)
+	const unsigned int TEXTURES_N_DESCRIPTORS = 100;		// Texture resource view descriptors go from 100 to 199 in the CBV_SRV_UAV descriptor heap (maximum 100 textures), the cube map follows
 	const unsigned int SAMPLERS_N_DESCRIPTORS = 100;		// Number of samplers descriptors in the samplers descriptor heap
-	static constexpr unsigned int MAX_MESH_INSTANCES = 100;	// Maximum number of allowed instanced for a mesh
+	static constexpr size_t MIN_INSTANCES_CAPACITY = 1024;		// Instances of the first instances buffer, it then grows to the instances drawn
+	static constexpr size_t INSTANCES_CHUNK_SIZE = 4096;		// Instances written to the instances buffer by a pool task
+	static constexpr uint32_t MESHLET_MERGE_GAP_INDICES = 384;	// Culled meshlets up to this many indices between two visible ones are drawn, to save a draw call
+	static constexpr uint32_t MESHLET_CULLING_MAX_INSTANCES = 64;	// Above this many instances a batch draws all its meshlets, seen from one instance or another
 
 	Microsoft::WRL::ComPtr<ID3D12Device> m_device;	
 	UINT m_CBVSRVDescriptorSize = 0;
@@ -85,22 +212,85 @@ protected:
 	std::map<unsigned int, RoughMetallicMaterial> m_materials;
 	std::map<unsigned int, std::unique_ptr<UploadBuffer<RoughMetallicMaterial>>> m_materialsBuffer;
 	std::map<unsigned int, Microsoft::WRL::ComPtr<ID3D12Resource>> m_textures;
+	std::map<unsigned int, D3D12_SAMPLER_DESC> m_samplers;
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_cubeMapTexture;
 	std::map<unsigned int, Mesh> m_meshes;
-	std::map<unsigned int, std::vector<MeshConstants>> m_meshInstances;
-	std::map<unsigned int, std::unique_ptr<UploadBuffer<MeshConstants>>> m_meshConstantsBuffer;
 	std::map<unsigned int, Light> m_lights;
 	std::map<unsigned int, std::unique_ptr<UploadBuffer<Light>>> m_lightsConstantsBuffer;
 	Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
 
-	/** The root transform for this scene, used to rotate/transform the whole scene (model)*/
-	DirectX::XMFLOAT4X4 m_sceneTransform;
+	/** The scene nodes, glTF scene is a is disjoint union of strict trees flattened in depth first order */
+	std::vector<SceneNode> m_nodes;
+
+	/** The transformations of m_nodes and their world matrices, under the root transform used to rotate/transform the whole scene (model) */
+	TransformHierarchy m_transforms;
+
+	/** True when every node needs new bounds, after a change of the meshes */
+	bool m_areNodesBoundsDirty = true;
+
+	/**
+	 * The world bounds of the submeshes of the mesh nodes, to cull them against the camera frustum. The submeshes of a node are
+	 * contiguous, in node order, and laid out again when the meshes or the nodes change
+	 */
+	CullingBounds m_cullingBounds;
+	std::vector<size_t> m_nodeFirstCullingBounds;		// Index of the first submesh bounds of each node, one more for the end
+	std::vector<uint32_t> m_cullingBoundsNodes;			// The node of each submesh bounds
+
+	/** The hierarchy over m_cullingBounds, built when they are laid out and refitted to the submeshes of the nodes placed again */
+	DynamicBVH m_cullingBVH;
+
+	/** The result of the last CullNodes: the submesh bounds drawn, in increasing order, and their nodes */
+	std::vector<uint32_t> m_visibleBounds;
+	std::vector<uint32_t> m_visibleNodes;
+	SceneCullingStats m_cullingStats;
+
+	/** The camera frustum in world space, and true to draw only the nodes and submeshes that may be in it */
+	Frustum m_frustum;
+	bool m_cullNodes = true;
+
+	/**
+	 * The occlusion culling: the camera world to clip matrix, the occluders triangles count of each submesh bounds (0 for a submesh
+	 * without hierarchy), and the submeshes drawn by the last frame to pick the occluders from
+	 */
+	DirectX::XMFLOAT4X4 m_viewProjMtx = DXUtil::IdentityMtx();
+	OcclusionOptions m_occlusionOptions;
+	OcclusionBuffer m_occlusionBuffer;
+	std::vector<size_t> m_occluderTriangles;
+	std::vector<uint32_t> m_occluderBounds;
+	std::vector<uint32_t> m_unoccludedBounds;
+	std::vector<uint32_t> m_lastVisibleBounds;
+	bool m_cullOccluded = false;
+	bool m_reuseOccluders = true;
+
+	/**
+	 * The instanced draws: the batch key number of each submesh bounds, the mesh, submesh and material of each key number, and the
+	 * batches of the submeshes drawn by the last Draw. Their world matrices are written to the instances buffer in batch order, the
+	 * buffer grows when a frame draws more instances than it holds
+	 */
+	std::vector<uint32_t> m_cullingBoundsKeys;
+	std::vector<BatchKey> m_batchKeys;
+	InstanceBatcher m_instanceBatcher;
+	std::unique_ptr<UploadBuffer<InstanceConstants>> m_instancesBuffer;
+	size_t m_instancesCapacity = 0;
+
+	/** The world bounds of the whole scene, the union of the nodes bounds */
+	BoundingBox m_sceneBounds;
+
+	/** The hierarchy over the submeshes hierarchies of the nodes and their hierarchies by instance, for the ray queries */
+	InstanceBVH m_instanceBVH;
+	std::vector<const TriangleBVH*> m_instanceTriangleBVHs;
+	bool m_isInstanceBVHDirty = true;
+
+	/** The layout the loader stored the submeshes vertices in, the attributes of the mesh shaders in their own buffers until a loader sets it */
+	VertexLayout m_vertexLayout = CreateVertexLayout(VERTEX_FEATURES_MESH, VertexSlotsMode::Separate);
 
-	/** The scene tree, glTF scene is a is disjoint union of strict trees */
-	std::vector<std::shared_ptr<SceneNode>> m_sceneTree;
+	/** The camera field of view and the viewport height, to project the error of the levels of detail to pixels */
+	float m_cameraFovY = DirectX::XM_PIDIV4;
+	UINT m_viewportHeight = 0;
+	float m_lodPixelError = 1.0f;
 
-	/** The radius of the whole scene */
-	DirectX::XMFLOAT3 m_sceneRadius;
+	/** True to draw only the meshlets in the frustum and facing the camera */
+	bool m_cullMeshlets = true;
 
 	/** True after initialization */
 	bool m_isInitialized = false;
@@ -108,6 +298,8 @@ protected:
 	
 private:
 
-	/** Scene loader helper object */
+	/** Scene loader helper objects */
 	friend class GLTFSceneLoader;
+	friend class SceneBaker;
+	friend class BakedSceneLoader;
 };
\ No newline at end of file
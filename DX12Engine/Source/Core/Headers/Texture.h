@@ -1,7 +1,16 @@
 #pragma once
 
 #include "DXUtil.h"
+#include "UploadBatch.h"
+#include "TextureDecoder.h"
 
 void CreateTextureFromMemory(ID3D12Device* device, ID3D12CommandQueue* commandQueue, const uint8_t* textureData, const size_t textureDataSize, ID3D12Resource** texture);
 void CreateTextureFromFile(ID3D12Device* device, ID3D12CommandQueue* commandQueue, const std::string& fileName, ID3D12Resource** texture);
 void CreateTextureFromDDSFile(ID3D12Device* device, ID3D12CommandQueue* commandQueue, const std::string& fileName, ID3D12Resource** texture);
+
+/** Create a texture with the mip chain of a decoded image, the data is copied when the upload batch is submitted and must stay valid until then */
+void CreateTextureFromDecoded(ID3D12Device* device, UploadBatch& uploadBatch, const DecodedTexture& decodedTexture, ID3D12Resource** texture);
+
+/** Create an RGBA8 texture with a subresource per mip level, the data is copied when the upload batch is submitted and must stay valid until then */
+void CreateTextureFromSubresources(ID3D12Device* device, UploadBatch& uploadBatch, const UINT64 width, const UINT height, 
+	const std::vector<D3D12_SUBRESOURCE_DATA>& subresources, ID3D12Resource** texture);
\ No newline at end of file
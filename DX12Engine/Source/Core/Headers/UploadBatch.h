@@ -0,0 +1,73 @@
+#pragma once
+
+#include "DXUtil.h"
+#include "UploadPlanner.h"
+
+/**
+ * Collects buffer and texture uploads and submits them together.
+ * The destination resources are created when the upload is enqueued, so they can be referenced right away.
+ * On Submit the data is packed into one staging buffer, copied with one command list and waited with one fence;
+ * when the data exceeds the staging budget it is split into several submissions, one staging buffer alive at a time.
+ */
+class UploadBatch
+{
+public:
+	static constexpr uint64_t DEFAULT_STAGING_BUDGET = 256ull * 1024 * 1024;
+
+	UploadBatch(Microsoft::WRL::ComPtr<ID3D12Device> device, Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue, const uint64_t stagingBudget = DEFAULT_STAGING_BUDGET);
+	UploadBatch(const UploadBatch&) = delete;
+	UploadBatch& operator=(const UploadBatch&) = delete;
+	~UploadBatch();
+
+	/** Create a default heap buffer that is filled with data on Submit, data must stay valid until then */
+	Microsoft::WRL::ComPtr<ID3D12Resource> EnqueueBuffer(const void* data, const UINT64 byteSize);
+
+	/** Create a default heap buffer that is filled with data on Submit, the batch keeps the data until then */
+	Microsoft::WRL::ComPtr<ID3D12Resource> EnqueueBuffer(std::vector<uint8_t>&& data);
+
+	/**
+	 * Upload the subresources of a texture created in the COPY_DEST state, the texture is left in the PIXEL_SHADER_RESOURCE state.
+	 * The subresources data must stay valid until Submit.
+	 */
+	void EnqueueTexture(ID3D12Resource* texture, const std::vector<D3D12_SUBRESOURCE_DATA>& subresources);
+
+	/** Copy all the enqueued data to the GPU and wait for the copies to complete */
+	void Submit();
+
+	/** Return the bytes enqueued and not submitted yet, texture data as laid out in the staging buffer */
+	uint64_t GetPendingBytes() const;
+
+	/** Return the number of command lists executed so far */
+	size_t GetSubmissionsCount() const;
+
+private:
+	struct PendingUpload
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		const void* data = nullptr;
+		UINT64 byteSize = 0;
+		std::vector<uint8_t> ownedData;
+		bool isTexture = false;
+		std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts;
+		std::vector<UINT> rowsCount;
+		std::vector<UINT64> rowByteSizes;
+	};
+
+	void SubmitBatch(const UploadPlanner& planner, const UploadBatchPlan& batch);
+	void FlushCommandQueue();
+
+	Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_commandQueue;
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_commandListAlloc;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_commandList;
+	Microsoft::WRL::ComPtr<ID3D12Fence> m_fence;
+	HANDLE m_fenceEvent = nullptr;
+	UINT64 m_currentFenceValue = 0;
+	uint64_t m_stagingBudget;
+	std::vector<PendingUpload> m_pendingUploads;
+	size_t m_submissionsCount = 0;
+
+	/** Staging offset alignment of buffer data */
+	static constexpr uint64_t BUFFER_PLACEMENT_ALIGNMENT = 16;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** Where an upload request is placed: the staging batch and the aligned offset inside it */
+struct UploadPlacement
+{
+	size_t batchId = 0;
+	uint64_t byteOffset = 0;
+};
+
+/** A staging allocation, filled and submitted at once */
+struct UploadBatchPlan
+{
+	uint64_t byteSize = 0;
+	std::vector<size_t> requests;	/*< The requests in the batch, in submission order */
+};
+
+/**
+ * Packs upload requests into as few staging allocations as possible.
+ * Requests are placed in order, each at an offset multiple of its alignment; a new batch is started
+ * when the next request doesn't fit the staging budget. A request larger than the budget gets a batch of its own.
+ * The planner doesn't depend on the graphics API, so the packing can be validated and measured without a GPU.
+ */
+class UploadPlanner
+{
+public:
+	UploadPlanner(const uint64_t stagingBudget);
+
+	/** Add a request of byteSize bytes, alignment must be a power of two. Return the request id */
+	size_t Add(const uint64_t byteSize, const uint64_t alignment);
+
+	/** Compute the placement of every request added so far */
+	void Plan();
+
+	/** Remove all the requests and the plan */
+	void Clear();
+
+	/** Check that requests don't overlap, are aligned and fit their batch, as computed by Plan */
+	bool Validate() const;
+
+	const std::vector<UploadBatchPlan>& GetBatches() const;
+	const UploadPlacement& GetPlacement(const size_t requestId) const;
+	size_t GetRequestsCount() const;
+	uint64_t GetStagingBudget() const;
+
+	/** Return the bytes lost to alignment padding */
+	uint64_t GetPaddingBytes() const;
+
+	static uint64_t AlignUp(const uint64_t value, const uint64_t alignment);
+
+private:
+	struct Request
+	{
+		uint64_t byteSize;
+		uint64_t alignment;
+	};
+
+	uint64_t m_stagingBudget;
+	std::vector<Request> m_requests;
+	std::vector<UploadPlacement> m_placements;
+	std::vector<UploadBatchPlan> m_batches;
+};
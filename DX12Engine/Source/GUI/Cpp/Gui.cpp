@@ -20,7 +20,7 @@ void Gui::Init(std::shared_ptr<Renderer> renderer, AppState* appState)
     ImGui::CreateContext();
     
     m_fileDialog.SetTitle("title");
-    m_fileDialog.SetTypeFilters({ ".glb", ".gltf" });
+    m_fileDialog.SetTypeFilters({ ".glb", ".gltf", ".gltfbake" });
 
     SetStyle();
 
@@ -193,6 +193,10 @@ void Gui::DrawStatistics()
     sprintf(overlay, "%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
     ImGui::PlotHistogram("", m_frameRateSeries, IM_ARRAYSIZE(m_frameRateSeries), 0, overlay, 0.0f, 100.0f, ImVec2(0, 80.0f));
     ImGui::PopItemWidth();
+    ImGui::Text("Nodes: %zu visible, %zu culled", m_appState->visibleNodesCount, m_appState->nodesCount - m_appState->visibleNodesCount);
+    ImGui::Text("Submeshes: %zu visible, %zu culled", m_appState->visibleSubMeshesCount, m_appState->subMeshesCount - m_appState->visibleSubMeshesCount);
+    ImGui::Text("Instanced draws: %zu", m_appState->batchesCount);
+    if (m_appState->cullOccluded) ImGui::Text("Occlusion: %zu occluders, %zu submeshes hidden", m_appState->occludersCount, m_appState->occludedSubMeshesCount);
     ImGui::End();
 }
 
@@ -244,6 +248,9 @@ void Gui::DrawControls()
         if (ImGui::Selectable("Roughness map", selected == 4)) { selected = 4; m_appState->currentRenderModeMask = 0x1 << 3; }
         if (ImGui::Selectable("Occlusion map", selected == 5)) { selected = 5; m_appState->currentRenderModeMask = 0x1 << 4; }
         if (ImGui::Selectable("Emissive map",  selected == 6)) { selected = 6; m_appState->currentRenderModeMask = 0x1 << 5; }
+        ImGui::Checkbox("Frustum culling", &m_appState->cullNodes);
+        ImGui::Checkbox("Occlusion culling", &m_appState->cullOccluded);
+        if (m_appState->cullOccluded) ImGui::Checkbox("Reuse last frame occluders", &m_appState->reuseOccluders);
     }
 
     if (allItemOpen) ImGui::SetNextItemOpen(true);
@@ -265,6 +272,7 @@ void Gui::DrawControls()
         ImGui::Text("Rot Z"); ImGui::SameLine(); ImGui::SliderAngle("##z", &m_appState->modelConstants[0].rotXYZ.z);
         ImGui::PopItemWidth();
         ImGui::EndGroup();
+        if (!m_appState->pickStatus.empty()) ImGui::Text("Picked: %s", m_appState->pickStatus.c_str());
         ImGui::Separator();
     }
 
@@ -312,6 +320,14 @@ void Gui::DrawBarFileMenu()
             ImGui::CloseCurrentPopup();
         }
 
+        if (m_appState->isLoadingGLTF)
+        {
+            ImGui::ProgressBar(m_appState->loadingProgress, ImVec2(200.0f, 0.0f));
+            ImGui::Text("%s", m_appState->loadingStatus.c_str());
+            if (ImGui::Button("Cancel loading")) { m_appState->isCancelLoadingPressed = true; }
+        }
+        else if (!m_appState->loadingStatus.empty()) ImGui::Text("%s", m_appState->loadingStatus.c_str());
+
         if (ImGui::Button("Exit"))
         {
             m_appState->isExitTriggered = true;
@@ -19,12 +19,27 @@ struct AppState
 	bool isAppMinimized = false;
 	bool isExitTriggered = false;
 	bool isOpenGLTFPressed = false;
+	bool isCancelLoadingPressed = false;
+	bool isLoadingGLTF = false;
 	bool showSkyBox = true;
+	bool cullNodes = true;			// Draw only the nodes and submeshes in the camera frustum
+	bool cullOccluded = false;		// Draw only the submeshes not hidden by the largest ones on screen
+	bool reuseOccluders = true;		// Pick the occluders among the submeshes drawn by the last frame
 	bool doRecompileShader = false;
 	int currentRenderModeMask = 0; // Render modes: 0 render, 1 wireframe, 2 base color, 3 rough map, 4 occlusion map, 5 emissive map 
 	int currentDisplayMode = 0;
 
 	std::string gltfFileLoaded;
+	float loadingProgress = 0.0f;	// Fraction of the meshes and textures loaded
+	std::string loadingStatus;		// Progress details, or the error of the last loading
+	std::string pickStatus;			// The mesh and the triangle under the last left click, empty before the first one
+	size_t nodesCount = 0;			// Mesh nodes and their submeshes in the scene and drawn by the last frame
+	size_t visibleNodesCount = 0;
+	size_t subMeshesCount = 0;
+	size_t visibleSubMeshesCount = 0;
+	size_t occludedSubMeshesCount = 0;
+	size_t occludersCount = 0;
+	size_t batchesCount = 0;
 	std::map<unsigned int, MeshConstants> modelConstants;
 	std::map<unsigned int, Light> lights;	// Light 0 is used as "Ambient light", i.e. only the color is considered
 };
\ No newline at end of file
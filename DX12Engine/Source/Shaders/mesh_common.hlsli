@@ -1,11 +1,11 @@
 static const float PI = 3.14159265f;
 
-static const uint MESH_CONSTANTS_N_DESCRIPTORS = 15;
-static const uint MATERIALS_N_DESCRIPTORS = 15;
-static const uint TEXTURES_N_DESCRIPTORS = 15;
-static const uint SAMPLERS_N_DESCRIPTORS = 15;
+// The descriptor counts of the scene root signature, as in Scene.h
+static const uint MESH_CONSTANTS_N_DESCRIPTORS = 100;
+static const uint MATERIALS_N_DESCRIPTORS = 100;
+static const uint TEXTURES_N_DESCRIPTORS = 100;
+static const uint SAMPLERS_N_DESCRIPTORS = 100;
 static const uint MAX_LIGHT_NUMBER = 7;
-static const uint MAX_MESH_INSTANCES = 10;
 
 static const float3 dielectricSpecular = { 0.04f, 0.04f, 0.04f };
 static const float3 black = { 0.0f, 0.0f, 0.0f };
@@ -26,11 +26,10 @@ struct FrameConstants
     Light lights[MAX_LIGHT_NUMBER];
 };
 
-struct MeshConstants
+// The constants of an instance of the submesh drawn, the instances of a draw call are contiguous
+struct InstanceConstants
 {
-    float4x4 modelMtx;
-    float4x4 nodeMtx;
-    float4 rotationXYZ; // rotations about X, Y and Z axes. Fourth component unused;
+    float4x4 worldMtx; // Model to world matrix of the node
 };
 
 struct TextureAccessor
@@ -51,22 +50,55 @@ struct RoughMetallicMaterial
     TextureAccessor occlusionTA;
 };
 
+// The transforms that decode the quantized vertex elements of the submesh drawn, the identity for float elements
+struct VertexDequantization
+{
+    float4 positionScale;
+    float4 positionOffset;
+    float4 texCoordTransforms[2]; // TEXCOORD0 and TEXCOORD1, scale in xy and offset in zw
+    uint octahedralDirections; uint3 _pad0; // 1 if the normals and tangents are octahedral
+};
+
+// The material of the submesh drawn, index in materials
+struct DrawConstants
+{
+    uint materialId;
+};
+
 FrameConstants frameConstants : register(b0, space0);
-StructuredBuffer<MeshConstants> meshConstants : register(t0, space0);
+ConstantBuffer<VertexDequantization> vertexDequantization : register(b1, space0);
+ConstantBuffer<DrawConstants> drawConstants : register(b2, space0);
+StructuredBuffer<InstanceConstants> instanceConstants : register(t0, space0);
 ConstantBuffer<RoughMetallicMaterial> materials[MATERIALS_N_DESCRIPTORS]  : register(b0, space1);
 Texture2D textures[TEXTURES_N_DESCRIPTORS] : register(t0, space1);
 TextureCube cubeMap : register(t0, space2);
 SamplerState samplers[SAMPLERS_N_DESCRIPTORS] : register(s0);
 
+// The elements are floats or 16 bit quantized values, the input assembler expands both to floats
 struct VertexIn
 {
-    float3 position : POSITION;
-    float3 normal : NORMAL;
+    float4 position : POSITION;
+    float4 normal : NORMAL;
     float4 tangent : TANGENT;
     float2 textCoord : TEXCOORD;
 
 };
 
+// Unit vector of octahedral coordinates in [-1, 1]^2
+float3 OctDecode(float2 oct)
+{
+    float3 v = float3(oct, 1.0f - abs(oct.x) - abs(oct.y));
+    if (v.z < 0.0f) v.xy = (1.0f - abs(v.yx)) * (v.xy >= 0.0f ? 1.0f : -1.0f);
+    return normalize(v);
+}
+
+// Tangent of octahedral coordinates whose y has 15 bits, biased by 16384: its sign is the bitangent sign
+float4 OctDecodeTangent(float2 oct)
+{
+    float y = (round(abs(oct.y) * 32767.0f) - 16384.0f) / 16383.0f;
+    return float4(OctDecode(float2(oct.x, y)), oct.y < 0.0f ? -1.0f : 1.0f);
+}
+
 struct VertexOut
 {
     float4 position : SV_POSITION;
@@ -12,11 +12,12 @@ float4 PSMain(VertexOut vIn) : SV_Target // SV_Target means that the output shou
     float4 occlusion = { 1.0f, 1.0f, 1.0f, 1.0f };
     float4 emissive = { 0.0f, 0.0f, 0.0f, 1.0f };
 
-    if (materials[0].baseColorTA.textureId != -1)          baseColor = textures[materials[0].baseColorTA.textureId].Sample(samplers[0], vIn.textCoord);
-    if (materials[0].normalTA.textureId != -1)		       normal = textures[materials[0].normalTA.textureId].Sample(samplers[0], vIn.textCoord);
-    if (materials[0].roughMetallicTA.textureId != -1)   roughMetallic = textures[materials[0].roughMetallicTA.textureId].Sample(samplers[0], vIn.textCoord);
-    if (materials[0].occlusionTA.textureId != -1)           occlusion = textures[materials[0].occlusionTA.textureId].Sample(samplers[0], vIn.textCoord);
-    if (materials[0].emissiveTA.textureId != -1)            emissive = textures[materials[0].emissiveTA.textureId].Sample(samplers[0], vIn.textCoord);
+    RoughMetallicMaterial material = materials[drawConstants.materialId];
+    if (material.baseColorTA.textureId != -1)          baseColor = textures[material.baseColorTA.textureId].Sample(samplers[0], vIn.textCoord);
+    if (material.normalTA.textureId != -1)		       normal = textures[material.normalTA.textureId].Sample(samplers[0], vIn.textCoord);
+    if (material.roughMetallicTA.textureId != -1)   roughMetallic = textures[material.roughMetallicTA.textureId].Sample(samplers[0], vIn.textCoord);
+    if (material.occlusionTA.textureId != -1)           occlusion = textures[material.occlusionTA.textureId].Sample(samplers[0], vIn.textCoord);
+    if (material.emissiveTA.textureId != -1)            emissive = textures[material.emissiveTA.textureId].Sample(samplers[0], vIn.textCoord);
 
     if (frameConstants.renderMode & (0x1 << 1)) { return baseColor; }
     if (frameConstants.renderMode & (0x1 << 2)) { return normal; }
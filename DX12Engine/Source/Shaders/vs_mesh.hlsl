@@ -3,12 +3,24 @@
 VertexOut VSMain(VertexIn vIn, uint instanceID : SV_InstanceID)
 {
     VertexOut vOut;
-    float4x4 modelMtx = mul(meshConstants[instanceID].modelMtx, meshConstants[instanceID].nodeMtx);
-    vOut.shadingLocation = mul(float4(vIn.position, 1.0f), modelMtx).xyz;
-    vOut.normal = mul(float4(vIn.normal, 1.0f), modelMtx).xyz;
-    vOut.position = mul(float4(vIn.position, 1.0f), mul(modelMtx, frameConstants.viewProjMtx));
-    vOut.textCoord = float2(vIn.textCoord.x, vIn.textCoord.y);
-    vOut.tangent.xyz = mul(vIn.tangent.xyz, (float3x3)modelMtx);
-    vOut.tangent.w = vIn.tangent.w;
+
+    // Bring the quantized elements back to model units
+    float3 position = vIn.position.xyz * vertexDequantization.positionScale.xyz + vertexDequantization.positionOffset.xyz;
+    float3 normal = vIn.normal.xyz;
+    float4 tangent = vIn.tangent;
+    if (vertexDequantization.octahedralDirections != 0)
+    {
+        normal = OctDecode(vIn.normal.xy);
+        tangent = OctDecodeTangent(vIn.tangent.xy);
+    }
+    float2 textCoord = vIn.textCoord * vertexDequantization.texCoordTransforms[0].xy + vertexDequantization.texCoordTransforms[0].zw;
+
+    float4x4 modelMtx = instanceConstants[instanceID].worldMtx;
+    vOut.shadingLocation = mul(float4(position, 1.0f), modelMtx).xyz;
+    vOut.normal = mul(float4(normal, 1.0f), modelMtx).xyz;
+    vOut.position = mul(float4(position, 1.0f), mul(modelMtx, frameConstants.viewProjMtx));
+    vOut.textCoord = textCoord;
+    vOut.tangent.xyz = mul(tangent.xyz, (float3x3)modelMtx);
+    vOut.tangent.w = tangent.w;
     return vOut;
 }
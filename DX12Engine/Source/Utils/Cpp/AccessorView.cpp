@@ -0,0 +1,193 @@
+#include "AccessorView.h"
+
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define ACCESSOR_VIEW_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	template <class Component>
+	Component Load(const uint8_t* src, const size_t i)
+	{
+		Component value;
+		std::memcpy(&value, src + i * sizeof(Component), sizeof(Component));
+		return value;
+	}
+
+	// glTF normalization: unsigned c / max, signed max(c / max, -1)
+	template <class Component, bool Normalized>
+	float ToFloat(const Component value)
+	{
+		if (!Normalized) return static_cast<float>(value);
+		constexpr float MAX_VALUE = static_cast<float>(std::numeric_limits<Component>::max());
+		if (std::is_signed<Component>::value) return (std::max)(static_cast<float>(value) / MAX_VALUE, -1.0f);
+		return static_cast<float>(value) / MAX_VALUE;
+	}
+
+	template <class Component, bool Normalized>
+	void ConvertTail(const uint8_t* src, size_t i, const size_t count, float* dst)
+	{
+		for (; i < count; i++) dst[i] = ToFloat<Component, Normalized>(Load<Component>(src, i));
+	}
+
+#ifdef ACCESSOR_VIEW_SSE2
+	template <bool IsSigned, bool Normalized>
+	void Store(__m128i integers, const float maxValue, float* dst)
+	{
+		__m128 values = _mm_cvtepi32_ps(integers);
+		if (Normalized)
+		{
+			values = _mm_div_ps(values, _mm_set1_ps(maxValue));
+			if (IsSigned) values = _mm_max_ps(values, _mm_set1_ps(-1.0f));
+		}
+		_mm_storeu_ps(dst, values);
+	}
+
+	/** Widen 8 shorts to 2 vectors of 32 bit integers and convert them */
+	template <bool IsSigned, bool Normalized>
+	void ConvertShorts(const __m128i shorts, const float maxValue, float* dst)
+	{
+		__m128i low = IsSigned ? _mm_srai_epi32(_mm_unpacklo_epi16(shorts, shorts), 16) : _mm_unpacklo_epi16(shorts, _mm_setzero_si128());
+		__m128i high = IsSigned ? _mm_srai_epi32(_mm_unpackhi_epi16(shorts, shorts), 16) : _mm_unpackhi_epi16(shorts, _mm_setzero_si128());
+		Store<IsSigned, Normalized>(low, maxValue, dst);
+		Store<IsSigned, Normalized>(high, maxValue, dst + 4);
+	}
+
+	/** Widen 16 bytes to 2 vectors of shorts and convert them */
+	template <bool IsSigned, bool Normalized>
+	void ConvertBytes(const __m128i bytes, float* dst)
+	{
+		constexpr float MAX_VALUE = IsSigned ? 127.0f : 255.0f;
+		__m128i low = IsSigned ? _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8) : _mm_unpacklo_epi8(bytes, _mm_setzero_si128());
+		__m128i high = IsSigned ? _mm_srai_epi16(_mm_unpackhi_epi8(bytes, bytes), 8) : _mm_unpackhi_epi8(bytes, _mm_setzero_si128());
+		ConvertShorts<IsSigned, Normalized>(low, MAX_VALUE, dst);
+		ConvertShorts<IsSigned, Normalized>(high, MAX_VALUE, dst + 8);
+	}
+#endif
+
+	template <class Component, bool Normalized>
+	void ConvertBytesToFloat(const uint8_t* src, const size_t count, float* dst)
+	{
+		size_t i = 0;
+#ifdef ACCESSOR_VIEW_SSE2
+		for (; i + 16 <= count; i += 16) ConvertBytes<std::is_signed<Component>::value, Normalized>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), dst + i);
+#endif
+		ConvertTail<Component, Normalized>(src, i, count, dst);
+	}
+
+	template <class Component, bool Normalized>
+	void ConvertShortsToFloat(const uint8_t* src, const size_t count, float* dst)
+	{
+		size_t i = 0;
+#ifdef ACCESSOR_VIEW_SSE2
+		constexpr float MAX_VALUE = std::is_signed<Component>::value ? 32767.0f : 65535.0f;
+		for (; i + 8 <= count; i += 8) ConvertShorts<std::is_signed<Component>::value, Normalized>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i)), MAX_VALUE, dst + i);
+#endif
+		ConvertTail<Component, Normalized>(src, i, count, dst);
+	}
+
+	template <class Component>
+	void ReadUInt32(const AccessorDesc& accessor, uint32_t* out)
+	{
+		AccessorView<Component, 1>(accessor.data, accessor.count, accessor.byteStride).ReadUInt32(out);
+	}
+}
+
+size_t AccessorDesc::GetElementSize() const
+{
+	int componentSize = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(componentType));
+	return (componentSize > 0 && elementsCount > 0) ? static_cast<size_t>(componentSize) * elementsCount : 0;
+}
+
+size_t AccessorDesc::GetByteLength() const
+{
+	if (count == 0) return 0;
+	size_t elementSize = GetElementSize();
+	return (count - 1) * (byteStride == 0 ? elementSize : byteStride) + elementSize;
+}
+
+template <> void ConvertToFloat<float, false>(const uint8_t* src, const size_t count, float* dst)
+{
+	std::memcpy(dst, src, count * sizeof(float));
+}
+
+template <> void ConvertToFloat<int8_t, false>(const uint8_t* src, const size_t count, float* dst) { ConvertBytesToFloat<int8_t, false>(src, count, dst); }
+template <> void ConvertToFloat<int8_t, true>(const uint8_t* src, const size_t count, float* dst) { ConvertBytesToFloat<int8_t, true>(src, count, dst); }
+template <> void ConvertToFloat<uint8_t, false>(const uint8_t* src, const size_t count, float* dst) { ConvertBytesToFloat<uint8_t, false>(src, count, dst); }
+template <> void ConvertToFloat<uint8_t, true>(const uint8_t* src, const size_t count, float* dst) { ConvertBytesToFloat<uint8_t, true>(src, count, dst); }
+template <> void ConvertToFloat<int16_t, false>(const uint8_t* src, const size_t count, float* dst) { ConvertShortsToFloat<int16_t, false>(src, count, dst); }
+template <> void ConvertToFloat<int16_t, true>(const uint8_t* src, const size_t count, float* dst) { ConvertShortsToFloat<int16_t, true>(src, count, dst); }
+template <> void ConvertToFloat<uint16_t, false>(const uint8_t* src, const size_t count, float* dst) { ConvertShortsToFloat<uint16_t, false>(src, count, dst); }
+template <> void ConvertToFloat<uint16_t, true>(const uint8_t* src, const size_t count, float* dst) { ConvertShortsToFloat<uint16_t, true>(src, count, dst); }
+
+template <> void ConvertToFloat<uint32_t, false>(const uint8_t* src, const size_t count, float* dst)
+{
+	// SSE2 has no unsigned conversion, values above 2^31 would need a fixup: these accessors are rare
+	ConvertTail<uint32_t, false>(src, 0, count, dst);
+}
+
+template <> void ConvertToUInt32<uint8_t>(const uint8_t* src, const size_t count, uint32_t* dst)
+{
+	size_t i = 0;
+#ifdef ACCESSOR_VIEW_SSE2
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		__m128i low = _mm_unpacklo_epi8(bytes, _mm_setzero_si128());
+		__m128i high = _mm_unpackhi_epi8(bytes, _mm_setzero_si128());
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(low, _mm_setzero_si128()));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(low, _mm_setzero_si128()));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpacklo_epi16(high, _mm_setzero_si128()));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 12), _mm_unpackhi_epi16(high, _mm_setzero_si128()));
+	}
+#endif
+	for (; i < count; i++) dst[i] = src[i];
+}
+
+template <> void ConvertToUInt32<uint16_t>(const uint8_t* src, const size_t count, uint32_t* dst)
+{
+	size_t i = 0;
+#ifdef ACCESSOR_VIEW_SSE2
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i shorts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(shorts, _mm_setzero_si128()));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(shorts, _mm_setzero_si128()));
+	}
+#endif
+	for (; i < count; i++) dst[i] = Load<uint16_t>(src, i);
+}
+
+template <> void ConvertToUInt32<uint32_t>(const uint8_t* src, const size_t count, uint32_t* dst)
+{
+	std::memcpy(dst, src, count * sizeof(uint32_t));
+}
+
+void ReadAccessorFloats(const AccessorDesc& accessor, float* out)
+{
+	auto read = [out](const auto& view) { view.ReadFloats(out); };
+	switch (accessor.elementsCount)
+	{
+	case 1: VisitAccessorView<1>(accessor, read); return;
+	case 2: VisitAccessorView<2>(accessor, read); return;
+	case 3: VisitAccessorView<3>(accessor, read); return;
+	case 4: VisitAccessorView<4>(accessor, read); return;
+	case 16: VisitAccessorView<16>(accessor, read); return;
+	}
+	throw std::invalid_argument("Unsupported accessor type");
+}
+
+void ReadAccessorUInt32(const AccessorDesc& accessor, uint32_t* out)
+{
+	if (accessor.elementsCount != 1 || accessor.normalized) throw std::invalid_argument("Indices must be unsigned scalars");
+	switch (accessor.componentType)
+	{
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: ReadUInt32<uint8_t>(accessor, out); return;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: ReadUInt32<uint16_t>(accessor, out); return;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: ReadUInt32<uint32_t>(accessor, out); return;
+	}
+	throw std::invalid_argument("Indices must be unsigned scalars");
+}
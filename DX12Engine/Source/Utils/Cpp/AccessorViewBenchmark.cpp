@@ -0,0 +1,187 @@
+#include "Benchmark.h"
+#include "AccessorView.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace
+{
+	constexpr size_t DEFAULT_ACCESSOR_ELEMENTS = 1 << 20;
+	constexpr int ACCESSOR_REPETITIONS = 7;
+
+	struct ComponentDesc
+	{
+		const char* name;
+		int componentType;
+		bool normalized;
+	};
+
+	const std::vector<ComponentDesc> FLOAT_COMPONENTS = {
+		{ "float", TINYGLTF_COMPONENT_TYPE_FLOAT, false },
+		{ "byte", TINYGLTF_COMPONENT_TYPE_BYTE, false },
+		{ "byte_normalized", TINYGLTF_COMPONENT_TYPE_BYTE, true },
+		{ "unsigned_byte", TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, false },
+		{ "unsigned_byte_normalized", TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, true },
+		{ "short", TINYGLTF_COMPONENT_TYPE_SHORT, false },
+		{ "short_normalized", TINYGLTF_COMPONENT_TYPE_SHORT, true },
+		{ "unsigned_short", TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, false },
+		{ "unsigned_short_normalized", TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, true },
+		{ "unsigned_int", TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, false } };
+
+	const std::vector<ComponentDesc> INDEX_COMPONENTS = {
+		{ "unsigned_byte", TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, false },
+		{ "unsigned_short", TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, false },
+		{ "unsigned_int", TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, false } };
+
+	/** The per element conversion that the bulk kernels replace, written from the glTF specification */
+	float ReferenceToFloat(const uint8_t* component, const int componentType, const bool normalized)
+	{
+		auto load = [component](auto value) { std::memcpy(&value, component, sizeof(value)); return value; };
+		switch (componentType)
+		{
+		case TINYGLTF_COMPONENT_TYPE_FLOAT: return load(0.0f);
+		case TINYGLTF_COMPONENT_TYPE_BYTE: return normalized ? (std::max)(load(int8_t()) / 127.0f, -1.0f) : load(int8_t());
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: return normalized ? load(uint8_t()) / 255.0f : load(uint8_t());
+		case TINYGLTF_COMPONENT_TYPE_SHORT: return normalized ? (std::max)(load(int16_t()) / 32767.0f, -1.0f) : load(int16_t());
+		case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: return normalized ? load(uint16_t()) / 65535.0f : load(uint16_t());
+		default: return static_cast<float>(load(uint32_t()));
+		}
+	}
+
+	template <class F>
+	double MeasureMegaElementsPerSecond(const size_t count, F&& convert)
+	{
+		std::vector<double> seconds;
+		for (int r = 0; r < ACCESSOR_REPETITIONS; r++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			convert();
+			seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(seconds.begin(), seconds.end());
+		return count / 1e6 / seconds[seconds.size() / 2];
+	}
+
+	/** Random accessor data, float components are kept finite so that the comparison is meaningful */
+	std::vector<uint8_t> CreateAccessorData(const AccessorDesc& accessor, std::mt19937& random)
+	{
+		std::vector<uint8_t> data(accessor.GetByteLength());
+		std::uniform_int_distribution<int> byteDistribution(0, 255);
+		for (uint8_t& byte : data) byte = static_cast<uint8_t>(byteDistribution(random));
+		if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+		{
+			std::uniform_real_distribution<float> floatDistribution(-1000.0f, 1000.0f);
+			for (size_t i = 0; i + sizeof(float) <= data.size(); i += sizeof(float))
+			{
+				float value = floatDistribution(random);
+				std::memcpy(&data[i], &value, sizeof(float));
+			}
+		}
+		return data;
+	}
+
+	void PrintResult(const char* kernel, const ComponentDesc& component, const int elements, const bool isStrided, const size_t count,
+		const double scalarMEps, const double bulkMEps, const bool isMatch, const bool isLast)
+	{
+		std::cout << std::fixed << std::setprecision(1)
+			<< "  { \"kernel\": \"" << kernel << "\", \"component\": \"" << component.name << "\", \"elements\": " << elements
+			<< ", \"layout\": \"" << (isStrided ? "strided" : "packed") << "\", \"count\": " << count
+			<< ", \"scalarMElementsPerSecond\": " << scalarMEps << ", \"bulkMElementsPerSecond\": " << bulkMEps
+			<< ", \"speedup\": " << std::setprecision(2) << bulkMEps / scalarMEps << ", \"match\": " << (isMatch ? "true" : "false") << " }"
+			<< (isLast ? "" : ",") << std::endl;
+	}
+}
+
+namespace Benchmark
+{
+	int RunAccessorViews(const std::vector<std::string>& args)
+	{
+		size_t count = args.empty() ? DEFAULT_ACCESSOR_ELEMENTS : std::stoul(args[0]);
+		std::mt19937 random(7);
+		bool isMatch = true;
+
+		std::cout << "[" << std::endl;
+		for (const ComponentDesc& component : FLOAT_COMPONENTS)
+		{
+			for (int elements = 1; elements <= 4; elements++)
+			{
+				for (bool isStrided : { false, true })
+				{
+					// Strided views interleave the accessor with a 4 bytes aligned attribute, as in an interleaved vertex buffer
+					AccessorDesc accessor;
+					accessor.count = count;
+					accessor.componentType = component.componentType;
+					accessor.elementsCount = elements;
+					accessor.normalized = component.normalized;
+					accessor.byteStride = isStrided ? ((accessor.GetElementSize() + 3) / 4 * 4 + 12) : 0;
+					std::vector<uint8_t> data = CreateAccessorData(accessor, random);
+					accessor.data = data.data();
+
+					size_t stride = accessor.byteStride == 0 ? accessor.GetElementSize() : accessor.byteStride;
+					size_t componentSize = accessor.GetElementSize() / elements;
+					std::vector<float> scalar(count * elements), bulk(count * elements);
+					double scalarMEps = MeasureMegaElementsPerSecond(count, [&]()
+						{
+							for (size_t i = 0; i < count; i++)
+							{
+								for (int c = 0; c < elements; c++) scalar[i * elements + c] = ReferenceToFloat(data.data() + i * stride + c * componentSize, component.componentType, component.normalized);
+							}
+						});
+					double bulkMEps = MeasureMegaElementsPerSecond(count, [&]() { ReadAccessorFloats(accessor, bulk.data()); });
+
+					bool isKernelMatch = std::memcmp(scalar.data(), bulk.data(), bulk.size() * sizeof(float)) == 0;
+					isMatch &= isKernelMatch;
+					PrintResult("float", component, elements, isStrided, count, scalarMEps, bulkMEps, isKernelMatch, false);
+				}
+			}
+		}
+
+		for (size_t c = 0; c < INDEX_COMPONENTS.size(); c++)
+		{
+			AccessorDesc accessor;
+			accessor.count = count;
+			accessor.componentType = INDEX_COMPONENTS[c].componentType;
+			accessor.elementsCount = 1;
+			std::vector<uint8_t> data = CreateAccessorData(accessor, random);
+			accessor.data = data.data();
+
+			size_t componentSize = accessor.GetElementSize();
+			std::vector<uint32_t> scalar(count), bulk(count);
+			double scalarMEps = MeasureMegaElementsPerSecond(count, [&]()
+				{
+					for (size_t i = 0; i < count; i++)
+					{
+						uint32_t index = 0;
+						std::memcpy(&index, data.data() + i * componentSize, componentSize);	// Little endian
+						scalar[i] = index;
+					}
+				});
+			double bulkMEps = MeasureMegaElementsPerSecond(count, [&]() { ReadAccessorUInt32(accessor, bulk.data()); });
+
+			bool isKernelMatch = scalar == bulk;
+			isMatch &= isKernelMatch;
+			PrintResult("uint32", INDEX_COMPONENTS[c], 1, false, count, scalarMEps, bulkMEps, isKernelMatch, c == INDEX_COMPONENTS.size() - 1);
+		}
+		std::cout << "]" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef ACCESSOR_VIEW_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunAccessorViews({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
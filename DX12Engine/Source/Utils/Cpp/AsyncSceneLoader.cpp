@@ -0,0 +1,127 @@
+#include "AsyncSceneLoader.h"
+#include "BakedSceneLoader.h"
+#include "Scene.h"
+
+#include "using_directives.h"
+
+AsyncSceneLoader::AsyncSceneLoader(ComPtr<ID3D12Device> device, ComPtr<ID3D12CommandQueue> commandQueue)
+{
+	m_device = device;
+	m_commandQueue = commandQueue;
+	m_progress = std::make_shared<LoadingProgress>();
+	m_progress->isFinished = true;
+}
+
+AsyncSceneLoader::~AsyncSceneLoader()
+{
+	Cancel();
+	JoinFinishedJobs(true);
+}
+
+void AsyncSceneLoader::Start(const std::string& fileName)
+{
+	Cancel();
+	JoinFinishedJobs(false);
+
+	// Each job has its own progress, so a cancelled job still terminating can't touch the new one
+	m_progress = std::make_shared<LoadingProgress>();
+	Job job;
+	job.progress = m_progress;
+	job.thread = std::thread(&AsyncSceneLoader::RunJob, this, fileName, m_progress);
+	m_jobs.push_back(std::move(job));
+}
+
+void AsyncSceneLoader::Cancel()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_progress->isCancelled = true;
+}
+
+bool AsyncSceneLoader::IsLoading() const
+{
+	return !m_progress->isFinished;
+}
+
+const LoadingProgress& AsyncSceneLoader::GetProgress() const
+{
+	return *m_progress;
+}
+
+std::shared_ptr<Scene> AsyncSceneLoader::TakeScene()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return std::move(m_loadedScene);
+}
+
+std::string AsyncSceneLoader::TakeError()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::string error;
+	error.swap(m_error);
+	return error;
+}
+
+void AsyncSceneLoader::RunJob(const std::string fileName, std::shared_ptr<LoadingProgress> progress)
+{
+	std::shared_ptr<Scene> scene;
+	std::string error;
+	try
+	{
+		if (BakedSceneLoader::IsBakedSceneFile(fileName))
+		{
+			BakedSceneLoader loader(m_device, m_commandQueue);
+			loader.SetProgress(progress.get());
+			loader.Load(fileName);
+			loader.GetScene(scene);
+		}
+		else
+		{
+			LoadProfile profile;
+			GLTFSceneLoader loader(m_device, m_commandQueue);
+			loader.SetMemoryMapping(true);
+			loader.SetTopologyNormalization(true);
+			loader.SetVertexWelding(true);
+			loader.SetMeshOptimization(true);
+			loader.SetLodGeneration(true);
+			loader.SetMeshletGeneration(true);
+			loader.SetBVHGeneration(true);
+			loader.SetVertexLayout(CreateVertexLayout(VERTEX_FEATURES_MESH, VertexSlotsMode::Interleaved));
+			loader.SetProgress(progress.get());
+			loader.SetProfile(&profile);
+			loader.Load(fileName);
+			loader.GetScene(0, scene);
+			DEBUG_LOG(("Loaded " + fileName + " " + profile.ToJson()).c_str())
+		}
+	}
+	catch (const std::exception& e)
+	{
+		scene = nullptr;
+		error = e.what();
+	}
+
+	{
+		// Publish the scene only if the job has not been cancelled in the meantime, Cancel takes the same lock
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!progress->isCancelled)
+		{
+			m_loadedScene = scene;
+			m_error = error;
+		}
+		progress->isFinished = true;
+	}
+
+	if (!error.empty()) { DEBUG_LOG(error.c_str()) }
+}
+
+void AsyncSceneLoader::JoinFinishedJobs(const bool waitAll)
+{
+	for (auto it = m_jobs.begin(); it != m_jobs.end();)
+	{
+		if (waitAll || it->progress->isFinished)
+		{
+			it->thread.join();
+			it = m_jobs.erase(it);
+		}
+		else it++;
+	}
+}
@@ -0,0 +1,313 @@
+#include "BakedSceneLoader.h"
+#include "Scene.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include <cstring>
+#include <filesystem>
+#include <algorithm>
+
+#include "using_directives.h"
+
+namespace
+{
+	/** Read the value stored in a material, light or sampler record, throw if it was baked with a different layout */
+	template <class T, class B>
+	T ReadRecord(const B& record)
+	{
+		if (record.byteSize != sizeof(T)) DXUtil::ThrowException("Baked scene record size mismatch, bake the scene again");
+		T value;
+		std::memcpy(&value, record.data, sizeof(T));
+		return value;
+	}
+}
+
+BakedSceneLoader::BakedSceneLoader(ComPtr<ID3D12Device> device, ComPtr<ID3D12CommandQueue> commandQueue)
+{
+	m_device = device;
+	m_commandQueue = commandQueue;
+}
+
+void BakedSceneLoader::Load(const std::string& fileName)
+{
+	m_mappedFile = std::make_unique<MappedFile>(fileName);
+	if (m_mappedFile->GetSize() < sizeof(BakedSceneHeader)) DXUtil::ThrowException(fileName + " is not a baked scene");
+	std::memcpy(&m_header, m_mappedFile->GetData().data, sizeof(m_header));
+
+	if (std::memcmp(m_header.magic, BAKED_SCENE_MAGIC, sizeof(m_header.magic)) != 0) DXUtil::ThrowException(fileName + " is not a baked scene");
+	if (m_header.version != BAKED_SCENE_VERSION)
+	{
+		DXUtil::ThrowException(fileName + " was baked with format version " + std::to_string(m_header.version) + ", version "
+			+ std::to_string(BAKED_SCENE_VERSION) + " is supported: bake the scene again");
+	}
+	if (m_header.fileByteSize != m_mappedFile->GetSize()) DXUtil::ThrowException(fileName + " is truncated");
+}
+
+void BakedSceneLoader::SetProgress(LoadingProgress* progress)
+{
+	m_progress = progress;
+}
+
+bool BakedSceneLoader::IsBakedSceneFile(const std::string& fileName)
+{
+	std::string extension = std::filesystem::path(fileName).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return extension == BAKED_SCENE_EXTENSION;
+}
+
+void BakedSceneLoader::GetScene(std::shared_ptr<Scene>& scene)
+{
+	if (!m_mappedFile) DXUtil::ThrowException("No baked scene loaded");
+
+	scene = std::make_shared<Scene>(m_device);
+	UploadBatch uploadBatch(m_device, m_commandQueue);
+
+	const BakedBuffer* buffers = GetSection<BakedBuffer>(BAKED_SECTION_BUFFERS);
+	const BakedImage* images = GetSection<BakedImage>(BAKED_SECTION_IMAGES);
+	const BakedMipLevel* mipLevels = GetSection<BakedMipLevel>(BAKED_SECTION_MIP_LEVELS);
+	const BakedTexture* textures = GetSection<BakedTexture>(BAKED_SECTION_TEXTURES);
+	const BakedMesh* meshes = GetSection<BakedMesh>(BAKED_SECTION_MESHES);
+	const BakedSubMesh* subMeshes = GetSection<BakedSubMesh>(BAKED_SECTION_SUBMESHES);
+	const BakedSubMeshLod* subMeshLods = GetSection<BakedSubMeshLod>(BAKED_SECTION_SUBMESH_LODS);
+	const BakedMeshlet* meshlets = GetSection<BakedMeshlet>(BAKED_SECTION_MESHLETS);
+	const BakedMaterial* materials = GetSection<BakedMaterial>(BAKED_SECTION_MATERIALS);
+	const BakedLight* lights = GetSection<BakedLight>(BAKED_SECTION_LIGHTS);
+	const BakedSampler* samplers = GetSection<BakedSampler>(BAKED_SECTION_SAMPLERS);
+
+	size_t payloadBytes = 0;
+	for (size_t i = 0; i < GetSectionCount(BAKED_SECTION_BUFFERS); i++) payloadBytes += buffers[i].payload.byteSize;
+	for (size_t i = 0; i < GetSectionCount(BAKED_SECTION_IMAGES); i++) payloadBytes += images[i].payload.byteSize;
+	if (m_progress)
+	{
+		m_progress->bytesTotal = payloadBytes;
+		m_progress->objectsTotal = GetSectionCount(BAKED_SECTION_MESHES) + GetSectionCount(BAKED_SECTION_IMAGES);
+	}
+
+	// Buffers and images are copied to the GPU straight from the mapped file
+	for (size_t i = 0; i < GetSectionCount(BAKED_SECTION_BUFFERS); i++)
+	{
+		ByteSpan data = GetPayload(buffers[i].payload);
+		scene->AddGPUBuffer(uploadBatch.EnqueueBuffer(data.data, data.size));
+	}
+
+	std::vector<ComPtr<ID3D12Resource>> imagesGPU(GetSectionCount(BAKED_SECTION_IMAGES));
+	for (size_t i = 0; i < imagesGPU.size(); i++)
+	{
+		CheckCancelled();
+		const BakedImage& image = images[i];
+		if (image.mipLevelsCount == 0 || image.firstMipLevel + static_cast<size_t>(image.mipLevelsCount) > GetSectionCount(BAKED_SECTION_MIP_LEVELS))
+		{
+			DXUtil::ThrowException("Baked image mip levels out of range");
+		}
+
+		ByteSpan data = GetPayload(image.payload);
+		std::vector<D3D12_SUBRESOURCE_DATA> subresources(image.mipLevelsCount);
+		for (size_t level = 0; level < subresources.size(); level++)
+		{
+			const BakedMipLevel& mipLevel = mipLevels[image.firstMipLevel + level];
+			uint64_t rowPitch = static_cast<uint64_t>(mipLevel.width) * DecodedTexture::BYTES_PER_PIXEL;
+			if (mipLevel.byteOffset > data.size || rowPitch * mipLevel.height > data.size - mipLevel.byteOffset)
+			{
+				DXUtil::ThrowException("Baked image mip level out of its payload");
+			}
+			subresources[level].pData = data.data + mipLevel.byteOffset;
+			subresources[level].RowPitch = static_cast<LONG_PTR>(rowPitch);
+			subresources[level].SlicePitch = static_cast<LONG_PTR>(rowPitch * mipLevel.height);
+		}
+		CreateTextureFromSubresources(m_device.Get(), uploadBatch, image.width, image.height, subresources, &imagesGPU[i]);
+		ReportProgress(0, 1);
+	}
+
+	for (size_t i = 0; i < GetSectionCount(BAKED_SECTION_TEXTURES); i++)
+	{
+		if (textures[i].imageId >= imagesGPU.size()) DXUtil::ThrowException("Baked texture image out of range");
+		if (textures[i].textureId >= scene->TEXTURES_N_DESCRIPTORS) DXUtil::ThrowException("Baked texture id out of the scene descriptors");
+		scene->AddTexture(textures[i].textureId, imagesGPU[textures[i].imageId]);
+	}
+
+	for (size_t i = 0; i < GetSectionCount(BAKED_SECTION_MESHES); i++)
+	{
+		CheckCancelled();
+		const BakedMesh& bakedMesh = meshes[i];
+		if (bakedMesh.firstSubMesh + static_cast<size_t>(bakedMesh.subMeshesCount) > GetSectionCount(BAKED_SECTION_SUBMESHES))
+		{
+			DXUtil::ThrowException("Baked mesh submeshes out of range");
+		}
+		if (bakedMesh.meshId >= GetSectionCount(BAKED_SECTION_MESHES)) DXUtil::ThrowException("Baked mesh id out of range");
+
+		Mesh m;
+		m.SetId(bakedMesh.meshId);
+		m.SetModelMtx(DXUtil::IdentityMtx());
+		m.SetNodeMtx(DXUtil::IdentityMtx());
+		for (uint32_t j = 0; j < bakedMesh.subMeshesCount; j++)
+		{
+			const BakedSubMesh& bakedSubMesh = subMeshes[bakedMesh.firstSubMesh + j];
+			SubMesh sm;
+			sm.verticesBufferView = GetBufferView(bakedSubMesh.views[BAKED_VIEW_VERTICES]);
+			sm.colorsBufferView = GetBufferView(bakedSubMesh.views[BAKED_VIEW_COLORS]);
+			sm.normalsBufferView = GetBufferView(bakedSubMesh.views[BAKED_VIEW_NORMALS]);
+			sm.tangentsBufferView = GetBufferView(bakedSubMesh.views[BAKED_VIEW_TANGENTS]);
+			sm.texCoord0BufferView = GetBufferView(bakedSubMesh.views[BAKED_VIEW_TEXCOORD0]);
+			sm.texCoord1BufferView = GetBufferView(bakedSubMesh.views[BAKED_VIEW_TEXCOORD1]);
+			sm.indicesBufferView = GetBufferView(bakedSubMesh.views[BAKED_VIEW_INDICES]);
+			if (bakedSubMesh.materialId >= scene->MATERIALS_N_DESCRIPTORS) DXUtil::ThrowException("Baked submesh material out of the scene descriptors");
+			sm.materialId = bakedSubMesh.materialId;
+			sm.topology = static_cast<D3D_PRIMITIVE_TOPOLOGY>(bakedSubMesh.topology);
+			if (bakedSubMesh.firstLod + static_cast<size_t>(bakedSubMesh.lodsCount) > GetSectionCount(BAKED_SECTION_SUBMESH_LODS))
+			{
+				DXUtil::ThrowException("Baked submesh levels of detail out of range");
+			}
+			for (uint32_t l = 0; l < bakedSubMesh.lodsCount; l++)
+			{
+				const BakedSubMeshLod& bakedLod = subMeshLods[bakedSubMesh.firstLod + l];
+				sm.lods.push_back({ GetBufferView(bakedLod.indices), bakedLod.error });
+			}
+			sm.boundingSphere = { bakedSubMesh.boundingSphere[0], bakedSubMesh.boundingSphere[1], bakedSubMesh.boundingSphere[2], bakedSubMesh.boundingSphere[3] };
+			std::memcpy(sm.bounds.min, bakedSubMesh.boundsMin, sizeof(sm.bounds.min));
+			std::memcpy(sm.bounds.max, bakedSubMesh.boundsMax, sizeof(sm.bounds.max));
+			std::memcpy(sm.dequantization.positionScale, bakedSubMesh.positionScale, sizeof(sm.dequantization.positionScale));
+			std::memcpy(sm.dequantization.positionOffset, bakedSubMesh.positionOffset, sizeof(sm.dequantization.positionOffset));
+			std::memcpy(sm.dequantization.texCoordTransforms, bakedSubMesh.texCoordTransforms, sizeof(sm.dequantization.texCoordTransforms));
+			sm.dequantization.octahedralDirections = bakedSubMesh.octahedralDirections;
+			if (bakedSubMesh.firstMeshlet + static_cast<size_t>(bakedSubMesh.meshletsCount) > GetSectionCount(BAKED_SECTION_MESHLETS))
+			{
+				DXUtil::ThrowException("Baked submesh meshlets out of range");
+			}
+			for (uint32_t k = 0; k < bakedSubMesh.meshletsCount; k++)
+			{
+				const BakedMeshlet& bakedMeshlet = meshlets[bakedSubMesh.firstMeshlet + k];
+				if (bakedMeshlet.firstIndex + static_cast<size_t>(bakedMeshlet.indicesCount) > sm.indicesBufferView.count)
+				{
+					DXUtil::ThrowException("Baked meshlet out of the submesh indices");
+				}
+				Meshlet meshlet;
+				meshlet.firstIndex = bakedMeshlet.firstIndex;
+				meshlet.indicesCount = bakedMeshlet.indicesCount;
+				meshlet.verticesCount = bakedMeshlet.verticesCount;
+				std::copy(bakedMeshlet.center, bakedMeshlet.center + 3, meshlet.center);
+				meshlet.radius = bakedMeshlet.radius;
+				std::copy(bakedMeshlet.aabbMin, bakedMeshlet.aabbMin + 3, meshlet.aabbMin);
+				std::copy(bakedMeshlet.aabbMax, bakedMeshlet.aabbMax + 3, meshlet.aabbMax);
+				std::copy(bakedMeshlet.coneApex, bakedMeshlet.coneApex + 3, meshlet.coneApex);
+				std::copy(bakedMeshlet.coneAxis, bakedMeshlet.coneAxis + 3, meshlet.coneAxis);
+				meshlet.coneCutoff = bakedMeshlet.coneCutoff;
+				sm.meshlets.push_back(meshlet);
+			}
+			m.AddSubMesh(std::move(sm));
+		}
+		scene->AddMesh(std::move(m));
+		ReportProgress(0, 1);
+	}
+
+	for (size_t i = 0; i < GetSectionCount(BAKED_SECTION_MATERIALS); i++)
+	{
+		if (materials[i].id >= scene->MATERIALS_N_DESCRIPTORS) DXUtil::ThrowException("Baked material id out of the scene descriptors");
+		RoughMetallicMaterial material = ReadRecord<RoughMetallicMaterial>(materials[i]);
+		for (int32_t textureId : { material.baseColorTA.textureId, material.roughMetallicTA.textureId, material.normalTA.textureId, material.occlusionTA.textureId, material.emissiveTA.textureId })
+		{
+			if (textureId < -1 || textureId >= static_cast<int32_t>(scene->TEXTURES_N_DESCRIPTORS)) DXUtil::ThrowException("Baked material texture out of the scene descriptors");
+		}
+		scene->AddMaterial(materials[i].id, std::move(material));
+	}
+	for (size_t i = 0; i < GetSectionCount(BAKED_SECTION_LIGHTS); i++)
+	{
+		scene->AddLight(lights[i].id, ReadRecord<Light>(lights[i]));
+	}
+	for (size_t i = 0; i < GetSectionCount(BAKED_SECTION_SAMPLERS); i++)
+	{
+		if (samplers[i].id >= scene->SAMPLERS_N_DESCRIPTORS) DXUtil::ThrowException("Baked sampler id out of the scene descriptors");
+		scene->AddSampler(samplers[i].id, ReadRecord<D3D12_SAMPLER_DESC>(samplers[i]));
+	}
+
+	size_t nodeId = 0;
+	for (uint32_t i = 0; i < m_header.rootNodesCount; i++) ParseSceneNode(nodeId, -1, scene.get());
+	if (m_header.vertexSlotsMode > static_cast<uint32_t>(VertexSlotsMode::PositionSplit) || (m_header.vertexFeatures & VERTEX_FEATURES_MESH) != VERTEX_FEATURES_MESH
+		|| (m_header.vertexFeatures >> VERTEX_ATTRIBUTES_COUNT) != 0 || m_header.quantizedPositions > 1 || m_header.quantizedDirections > 1
+		|| (m_header.texCoordsFormat != static_cast<uint32_t>(VertexFormat::Float32) && m_header.texCoordsFormat != static_cast<uint32_t>(VertexFormat::Half2)
+			&& m_header.texCoordsFormat != static_cast<uint32_t>(VertexFormat::Unorm16x2)))
+	{
+		DXUtil::ThrowException("Baked scene vertex layout not supported");
+	}
+	VertexQuantization quantization;
+	quantization.positions = m_header.quantizedPositions != 0;
+	quantization.directions = m_header.quantizedDirections != 0;
+	quantization.texCoords = static_cast<VertexFormat>(m_header.texCoordsFormat);
+	scene->m_vertexLayout = CreateVertexLayout(m_header.vertexFeatures, static_cast<VertexSlotsMode>(m_header.vertexSlotsMode), quantization);
+
+	CheckCancelled();
+	uploadBatch.Submit();
+	ReportProgress(payloadBytes, 0);
+	scene->m_isInitialized = true;
+}
+
+template <class T>
+const T* BakedSceneLoader::GetSection(const BakedSceneSection section) const
+{
+	const BakedSectionDesc& desc = m_header.sections[section];
+	if (desc.count > m_mappedFile->GetSize() / sizeof(T) || desc.byteOffset % alignof(T) != 0) DXUtil::ThrowException("Baked scene section out of the file");
+	return reinterpret_cast<const T*>(m_mappedFile->GetRange(static_cast<size_t>(desc.byteOffset), static_cast<size_t>(desc.count * sizeof(T))).data);
+}
+
+size_t BakedSceneLoader::GetSectionCount(const BakedSceneSection section) const
+{
+	return static_cast<size_t>(m_header.sections[section].count);
+}
+
+ByteSpan BakedSceneLoader::GetPayload(const BakedPayload& payload) const
+{
+	return m_mappedFile->GetRange(static_cast<size_t>(payload.byteOffset), static_cast<size_t>(payload.byteSize));
+}
+
+BufferView BakedSceneLoader::GetBufferView(const BakedBufferView& bakedView) const
+{
+	if (bakedView.bufferId < -1 || bakedView.bufferId >= static_cast<int64_t>(GetSectionCount(BAKED_SECTION_BUFFERS)))
+	{
+		DXUtil::ThrowException("Baked buffer view out of range");
+	}
+	if (bakedView.bufferId != -1)
+	{
+		const uint64_t payloadSize = GetSection<BakedBuffer>(BAKED_SECTION_BUFFERS)[bakedView.bufferId].payload.byteSize;
+		if (bakedView.byteOffset > payloadSize || bakedView.byteLength > payloadSize - bakedView.byteOffset)
+		{
+			DXUtil::ThrowException("Baked buffer view out of its buffer payload");
+		}
+	}
+
+	BufferView view;
+	view.bufferId = bakedView.bufferId;
+	view.elemType = bakedView.elemType;
+	view.componentType = bakedView.componentType;
+	view.byteOffset = static_cast<size_t>(bakedView.byteOffset);
+	view.byteLength = static_cast<size_t>(bakedView.byteLength);
+	view.byteStride = static_cast<size_t>(bakedView.byteStride);
+	view.count = static_cast<size_t>(bakedView.count);
+	return view;
+}
+
+void BakedSceneLoader::ParseSceneNode(size_t& nodeId, const int parentId, Scene* scene) const
+{
+	// Nodes are in depth first order, each node is followed by its children subtrees, as the scene stores them
+	if (nodeId >= GetSectionCount(BAKED_SECTION_NODES)) DXUtil::ThrowException("Baked scene node out of range");
+	const BakedNode& bakedNode = GetSection<BakedNode>(BAKED_SECTION_NODES)[nodeId++];
+	if (bakedNode.meshId < -1 || bakedNode.meshId >= static_cast<int64_t>(GetSectionCount(BAKED_SECTION_MESHES)))
+	{
+		DXUtil::ThrowException("Baked node mesh out of range");
+	}
+
+	size_t sceneNodeId = scene->AddNode(parentId, bakedNode.meshId);
+	XMFLOAT4X4 transformMtx;
+	std::memcpy(&transformMtx, bakedNode.transformMtx, sizeof(bakedNode.transformMtx));
+	scene->SetNodeMatrix(sceneNodeId, transformMtx);
+	for (uint32_t i = 0; i < bakedNode.childrenCount; i++) ParseSceneNode(nodeId, static_cast<int>(sceneNodeId), scene);
+}
+
+void BakedSceneLoader::CheckCancelled() const
+{
+	if (m_progress != nullptr && m_progress->isCancelled) DXUtil::ThrowException("Loading cancelled");
+}
+
+void BakedSceneLoader::ReportProgress(const size_t bytesDone, const size_t objectsDone)
+{
+	if (m_progress == nullptr) return;
+	m_progress->bytesDone += bytesDone;
+	m_progress->objectsDone += objectsDone;
+}
\ No newline at end of file
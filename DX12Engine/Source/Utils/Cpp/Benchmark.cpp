@@ -0,0 +1,421 @@
+#include "Benchmark.h"
+#include "DXUtil.h"
+#include "GLTFSceneLoader.h"
+#include "BakedSceneLoader.h"
+#include "SceneBaker.h"
+#include "Scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <Psapi.h>
+
+namespace
+{
+	const std::vector<std::string> DEFAULT_GLB_FILES = { "models/DamagedHelmet.glb", "models/2CylinderEngine.glb" };
+	const std::vector<std::string> GLB_LOAD_MODES = { "tinygltf", "copy", "mmap" };
+	constexpr int SCENE_OPEN_REPETITIONS = 5;
+	const std::vector<std::string> DEFAULT_LOAD_PATHS = { "models" };
+	constexpr int DEFAULT_LOAD_REPETITIONS = 5;
+	constexpr double DEFAULT_REGRESSION_PERCENT = 10.0;
+	constexpr double MIN_REGRESSION_MS = 0.5;	// Smaller slowdowns are reported but are not regressions, they are within the noise
+
+	std::string GetExecutablePath()
+	{
+		char exePath[MAX_PATH];
+		GetModuleFileNameA(nullptr, exePath, MAX_PATH);
+		return exePath;
+	}
+
+	/** Run a command line in a new process and wait for its termination, return the process exit code */
+	DWORD RunProcess(std::string commandLine)
+	{
+		STARTUPINFOA startupInfo = {};
+		startupInfo.cb = sizeof(startupInfo);
+		PROCESS_INFORMATION processInfo = {};
+		if (!CreateProcessA(nullptr, &commandLine[0], nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startupInfo, &processInfo))
+		{
+			DXUtil::ThrowException("Cannot start process " + commandLine);
+		}
+		WaitForSingleObject(processInfo.hProcess, INFINITE);
+		DWORD exitCode = 1;
+		GetExitCodeProcess(processInfo.hProcess, &exitCode);
+		CloseHandle(processInfo.hThread);
+		CloseHandle(processInfo.hProcess);
+		return exitCode;
+	}
+
+	/** Load a .glb file in the current process and append wall time and peak memory to resultFileName */
+	int RunGLBLoad(const std::string& mode, const std::string& fileName, const std::string& resultFileName)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		// Read every buffer byte, as the upload to the GPU would do
+		uint64_t checksum = 0;
+		if (mode == "tinygltf")
+		{
+			// The reference, the loading before GLTFSceneLoader read the file itself: tinygltf reads the file, copies the BIN chunk
+			// and decodes the images, then the loader copied each buffer by value
+			tinygltf::TinyGLTF gltfLoader;
+			tinygltf::Model model;
+			std::string err, warn;
+			if (!gltfLoader.LoadBinaryFromFile(&model, &err, &warn, fileName)) DXUtil::ThrowException("Failed to load " + fileName + ": " + err);
+			for (size_t i = 0; i < model.buffers.size(); i++)
+			{
+				tinygltf::Buffer buffer = model.buffers[i];
+				for (unsigned char byte : buffer.data) checksum += byte;
+			}
+		}
+		else
+		{
+			GLTFSceneLoader loader(nullptr, nullptr);
+			loader.SetMemoryMapping(mode == "mmap");
+			loader.Load(fileName);
+			for (int i = 0; i < static_cast<int>(loader.GetBuffersCount()); i++)
+			{
+				ByteSpan data = loader.GetBufferData(i);
+				for (size_t j = 0; j < data.size; j++) checksum += data.data[j];
+			}
+		}
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		PROCESS_MEMORY_COUNTERS memoryCounters = {};
+		GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters));
+
+		std::ofstream resultFile(resultFileName, std::ios::app);
+		resultFile << mode << " " << milliseconds << " " << memoryCounters.PeakWorkingSetSize << " " << memoryCounters.PeakPagefileUsage << " " << checksum << std::endl;
+		return 0;
+	}
+
+	/** Load every file with every mode, each load in a child process, and print the results */
+	int RunGLBBenchmark(std::vector<std::string> fileNames)
+	{
+		if (fileNames.empty()) fileNames = DEFAULT_GLB_FILES;
+
+		char tempPath[MAX_PATH], resultFileName[MAX_PATH];
+		GetTempPathA(MAX_PATH, tempPath);
+		GetTempFileNameA(tempPath, "glb", 0, resultFileName);
+
+		std::cout << "[" << std::endl;
+		for (size_t i = 0; i < fileNames.size(); i++)
+		{
+			for (size_t j = 0; j < GLB_LOAD_MODES.size(); j++)
+			{
+				std::ofstream(resultFileName, std::ios::trunc).close();
+				DWORD exitCode = RunProcess("\"" + GetExecutablePath() + "\" --bench-glb-run " + GLB_LOAD_MODES[j] + " \"" + fileNames[i] + "\" \"" + resultFileName + "\"");
+				
+				std::string mode;
+				double milliseconds = 0.0;
+				size_t peakWorkingSet = 0, peakPrivateBytes = 0;
+				uint64_t checksum = 0;
+				std::ifstream resultFile(resultFileName);
+				if (exitCode != 0 || !(resultFile >> mode >> milliseconds >> peakWorkingSet >> peakPrivateBytes >> checksum))
+				{
+					std::cerr << "Failed to load " << fileNames[i] << " in " << GLB_LOAD_MODES[j] << " mode" << std::endl;
+					continue;
+				}
+
+				bool isLast = (i == fileNames.size() - 1) && (j == GLB_LOAD_MODES.size() - 1);
+				std::cout << std::fixed << std::setprecision(3)
+					<< "  { \"file\": \"" << fileNames[i] << "\", \"mode\": \"" << mode << "\", \"ms\": " << milliseconds
+					<< ", \"peakWorkingSetMB\": " << peakWorkingSet / (1024.0 * 1024.0)
+					<< ", \"peakPrivateMB\": " << peakPrivateBytes / (1024.0 * 1024.0) << " }" << (isLast ? "" : ",") << std::endl;
+			}
+		}
+		std::cout << "]" << std::endl;
+
+		DeleteFileA(resultFileName);
+		return 0;
+	}
+
+	/** Compare the geometry bytes uploaded once per range with the bytes uploaded by copying every buffer per primitive */
+	int RunResidencyReport(std::vector<std::string> fileNames)
+	{
+		if (fileNames.empty()) fileNames = DEFAULT_GLB_FILES;
+
+		std::cout << "[" << std::endl;
+		for (size_t i = 0; i < fileNames.size(); i++)
+		{
+			GLTFSceneLoader loader(nullptr, nullptr);
+			loader.SetMemoryMapping(true);
+			loader.Load(fileNames[i]);
+
+			const GeometryResidency& residency = loader.GetGeometryResidency();
+			double residentMB = residency.GetResidentBytes() / (1024.0 * 1024.0);
+			double perPrimitiveMB = loader.GetPerPrimitiveUploadBytes() / (1024.0 * 1024.0);
+			std::cout << std::fixed << std::setprecision(3)
+				<< "  { \"file\": \"" << fileNames[i] << "\", \"primitives\": " << residency.GetPrimitivesCount()
+				<< ", \"ranges\": " << residency.GetRanges().size() << ", \"perPrimitiveMB\": " << perPrimitiveMB
+				<< ", \"residentMB\": " << residentMB << ", \"savedMB\": " << (perPrimitiveMB - residentMB) << " }"
+				<< (i == fileNames.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "]" << std::endl;
+		return 0;
+	}
+
+	double GetMedian(std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+		return values[values.size() / 2];
+	}
+
+	/** Return the nearest rank percentile of values, percent in [0, 100] */
+	double GetPercentile(std::vector<double> values, const double percent)
+	{
+		std::sort(values.begin(), values.end());
+		size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * values.size()));
+		return values[(std::max)(rank, size_t(1)) - 1];
+	}
+
+	/** Return the value of key in a line printed by RunLoadBenchmark, an empty string if the line does not have it */
+	std::string GetLineValue(const std::string& line, const std::string& key)
+	{
+		std::string pattern = "\"" + key + "\": ";
+		size_t begin = line.find(pattern);
+		if (begin == std::string::npos) return "";
+		begin += pattern.size();
+		if (line[begin] == '"') return line.substr(begin + 1, line.find('"', begin + 1) - begin - 1);
+		return line.substr(begin, line.find_first_of(",}", begin) - begin);
+	}
+
+	/** Read the phases median of a saved RunLoadBenchmark output, indexed by file and phase */
+	std::map<std::pair<std::string, std::string>, double> ReadLoadBaseline(const std::string& fileName)
+	{
+		std::ifstream baselineFile(fileName);
+		if (!baselineFile) DXUtil::ThrowException("Cannot open the baseline " + fileName);
+
+		std::map<std::pair<std::string, std::string>, double> baseline;
+		std::string line;
+		while (std::getline(baselineFile, line))
+		{
+			std::string file = GetLineValue(line, "file"), phase = GetLineValue(line, "phase"), median = GetLineValue(line, "medianMs");
+			if (!file.empty() && !phase.empty() && !median.empty()) baseline[{ file, phase }] = std::stod(median);
+		}
+		return baseline;
+	}
+
+	/**
+	 * Open every glTF file in paths up to a scene resident on the GPU, runs times, and report the median and 95th percentile
+	 * of each loading phase. The first opening of each file warms up the file cache and is not measured.
+	 * With a baseline, a saved output of this benchmark, each phase is compared with its baseline median: a phase slower by more
+	 * than regressionPercent (and MIN_REGRESSION_MS) is a regression, and the benchmark exits with an error.
+	 */
+	int RunLoadBenchmark(const std::vector<std::string>& args)
+	{
+		int runs = DEFAULT_LOAD_REPETITIONS;
+		double regressionPercent = DEFAULT_REGRESSION_PERCENT;
+		std::string baselineFileName;
+		std::vector<std::string> paths;
+		for (size_t i = 0; i < args.size(); i++)
+		{
+			if (args[i] == "--runs" && i + 1 < args.size()) runs = (std::max)(std::stoi(args[++i]), 1);
+			else if (args[i] == "--baseline" && i + 1 < args.size()) baselineFileName = args[++i];
+			else if (args[i] == "--threshold" && i + 1 < args.size()) regressionPercent = std::stod(args[++i]);
+			else paths.push_back(args[i]);
+		}
+
+		std::vector<std::string> fileNames = FindGLTFFiles(paths.empty() ? DEFAULT_LOAD_PATHS : paths);
+		if (fileNames.empty()) { std::cerr << "No glTF file found" << std::endl; return 1; }
+		std::map<std::pair<std::string, std::string>, double> baseline;
+		if (!baselineFileName.empty()) baseline = ReadLoadBaseline(baselineFileName);
+
+		Microsoft::WRL::ComPtr<ID3D12Device> device;
+		Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue;
+		DXUtil::CreateHeadlessDevice(device, commandQueue);
+
+		bool isRegression = false;
+		bool isFirstLine = true;
+		std::cout << "[" << std::endl;
+		for (const std::string& fileName : fileNames)
+		{
+			// Phases in the order they ran, with their time in each run
+			std::vector<std::string> phases;
+			std::map<std::string, std::vector<double>> phasesMs;
+			std::map<std::string, size_t> phasesBytes;
+			try
+			{
+				for (int r = -1; r < runs; r++)
+				{
+					LoadProfile profile;
+					auto start = std::chrono::steady_clock::now();
+					{
+						std::shared_ptr<Scene> scene;
+						GLTFSceneLoader loader(device, commandQueue);
+						loader.SetMemoryMapping(true);
+						loader.SetProfile(&profile);
+						loader.Load(fileName);
+						loader.GetScene(0, scene);
+					}
+					double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+					if (r < 0) continue;
+
+					profile.Add("total", totalMs, 0);
+					for (const LoadPhase& phase : profile.GetPhases())
+					{
+						if (phasesMs.find(phase.name) == phasesMs.end()) phases.push_back(phase.name);
+						phasesMs[phase.name].push_back(phase.milliseconds);
+						phasesBytes[phase.name] = phase.bytes;
+					}
+				}
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "Failed to load " << fileName << ": " << e.what() << std::endl;
+				isRegression = true;
+				continue;
+			}
+
+			std::string file = EscapeJson(fileName);
+			for (const std::string& phase : phases)
+			{
+				// A phase that did not run in every run, such as normals, took no time in the others
+				std::vector<double>& milliseconds = phasesMs[phase];
+				milliseconds.resize(runs, 0.0);
+				double median = GetPercentile(milliseconds, 50.0), p95 = GetPercentile(milliseconds, 95.0);
+
+				std::cout << (isFirstLine ? "" : ",\n") << std::fixed << std::setprecision(3)
+					<< "  { \"file\": \"" << file << "\", \"phase\": \"" << phase << "\", \"runs\": " << runs
+					<< ", \"medianMs\": " << median << ", \"p95Ms\": " << p95 << ", \"bytes\": " << phasesBytes[phase];
+				if (phasesBytes[phase] > 0 && median > 0.0) std::cout << ", \"MBps\": " << phasesBytes[phase] / (1024.0 * 1024.0) / (median / 1000.0);
+
+				auto baselinePhase = baseline.find({ file, phase });
+				if (baselinePhase != baseline.end())
+				{
+					double change = (baselinePhase->second > 0.0) ? (median / baselinePhase->second - 1.0) * 100.0 : 0.0;
+					bool isPhaseRegression = change > regressionPercent && median - baselinePhase->second > MIN_REGRESSION_MS;
+					isRegression |= isPhaseRegression;
+					std::cout << ", \"baselineMedianMs\": " << baselinePhase->second << ", \"changePercent\": " << std::setprecision(1) << change
+						<< ", \"regression\": " << (isPhaseRegression ? "true" : "false");
+				}
+				std::cout << " }";
+				isFirstLine = false;
+			}
+		}
+		std::cout << std::endl << "]" << std::endl;
+		return isRegression ? 1 : 0;
+	}
+
+	/**
+	 * Bake every file, then compare the time to open the glTF file and the baked file, each up to a scene resident on the GPU.
+	 * Creating the Scene object (shaders compilation, descriptor heaps) is the same for both and is also reported alone.
+	 */
+	int RunBakedSceneBenchmark(std::vector<std::string> fileNames)
+	{
+		if (fileNames.empty()) fileNames = DEFAULT_GLB_FILES;
+
+		Microsoft::WRL::ComPtr<ID3D12Device> device;
+		Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue;
+		DXUtil::CreateHeadlessDevice(device, commandQueue);
+
+		char tempPath[MAX_PATH];
+		GetTempPathA(MAX_PATH, tempPath);
+
+		std::cout << "[" << std::endl;
+		for (size_t i = 0; i < fileNames.size(); i++)
+		{
+			std::string bakedFileName = (std::filesystem::path(tempPath) / std::filesystem::path(fileNames[i]).filename()).string();
+			bakedFileName = SceneBaker::GetBakedFileName(bakedFileName);
+			{
+				SceneBaker baker(device, commandQueue);
+				baker.SetMemoryMapping(true);
+				baker.Load(fileNames[i]);
+				baker.Bake(0, bakedFileName);
+			}
+
+			std::vector<double> sceneSetupMs, gltfMs, bakedMs;
+			for (int r = 0; r < SCENE_OPEN_REPETITIONS; r++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				{
+					std::shared_ptr<Scene> scene = std::make_shared<Scene>(device);
+				}
+				sceneSetupMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+				start = std::chrono::steady_clock::now();
+				{
+					std::shared_ptr<Scene> scene;
+					GLTFSceneLoader loader(device, commandQueue);
+					loader.SetMemoryMapping(true);
+					loader.Load(fileNames[i]);
+					loader.GetScene(0, scene);
+				}
+				gltfMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+				start = std::chrono::steady_clock::now();
+				{
+					std::shared_ptr<Scene> scene;
+					BakedSceneLoader loader(device, commandQueue);
+					loader.Load(bakedFileName);
+					loader.GetScene(scene);
+				}
+				bakedMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			}
+
+			double setup = GetMedian(sceneSetupMs), gltf = GetMedian(gltfMs), baked = GetMedian(bakedMs);
+			std::cout << std::fixed << std::setprecision(3)
+				<< "  { \"file\": \"" << fileNames[i] << "\", \"bakedMB\": " << std::filesystem::file_size(bakedFileName) / (1024.0 * 1024.0)
+				<< ", \"gltfMs\": " << gltf << ", \"bakedMs\": " << baked << ", \"sceneSetupMs\": " << setup
+				<< ", \"speedup\": " << gltf / baked << ", \"speedupWithoutSetup\": " << (gltf - setup) / (std::max)(baked - setup, 0.001) << " }"
+				<< (i == fileNames.size() - 1 ? "" : ",") << std::endl;
+
+			DeleteFileA(bakedFileName.c_str());
+		}
+		std::cout << "]" << std::endl;
+		return 0;
+	}
+}
+
+namespace Benchmark
+{
+	bool IsBenchmarkCommandLine(const std::vector<std::string>& args)
+	{
+		return !args.empty() && args[0].rfind("--bench", 0) == 0;
+	}
+
+	int Run(const std::vector<std::string>& args)
+	{
+		DXUtil::AttachParentConsole();
+		try
+		{
+			if (args[0] == "--bench-glb") return RunGLBBenchmark({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-glb-run" && args.size() == 4) return RunGLBLoad(args[1], args[2], args[3]);
+			if (args[0] == "--bench-residency") return RunResidencyReport({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-upload-plan") return RunUploadPlan({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-baked") return RunBakedSceneBenchmark({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-texture-decode") return RunTextureDecode({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-gltf-parse") return RunGLTFParse({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-load") return RunLoadBenchmark({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-accessors") return RunAccessorViews({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-normals") return RunNormals({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-tangents") return RunTangents({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-mesh-optimization") return RunMeshOptimization({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-weld") return RunWelding({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-simplify") return RunSimplification({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-meshlets") return RunMeshlets({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-vertex-layout") return RunVertexLayout({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-vertex-quantization") return RunVertexQuantization({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-topology") return RunTopology({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-bounds") return RunBounds({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-bvh") return RunMeshBVH({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-transforms") return RunTransformHierarchy({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-frustum") return RunFrustumCulling({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-scene-bvh") return RunDynamicBVH({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-occlusion") return RunOcclusionCulling({ args.begin() + 1, args.end() });
+			if (args[0] == "--bench-instancing") return RunInstanceBatching({ args.begin() + 1, args.end() });
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+
+		std::cerr << "Unknown benchmark " << args[0] << std::endl;
+		return 1;
+	}
+}
@@ -0,0 +1,175 @@
+#include "Bounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define BOUNDS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	void AddPoints(BoundingBox& box, const uint8_t* points, const size_t count, const size_t byteStride)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			float point[3];
+			std::memcpy(point, points + i * byteStride, sizeof(point));
+			box.Add(point);
+		}
+	}
+
+#ifdef BOUNDS_SSE2
+	/**
+	 * Four tightly packed points are three vectors: x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3. Each lane keeps the min and the max of one
+	 * coordinate, the four lanes of each coordinate are reduced at the end
+	 */
+	size_t AddPackedPoints(BoundingBox& box, const float* points, const size_t count)
+	{
+		const size_t blocksCount = count / 4;
+		if (blocksCount == 0) return 0;
+		__m128 lower[3], upper[3];
+		for (int k = 0; k < 3; k++) lower[k] = upper[k] = _mm_loadu_ps(points + 4 * k);
+		for (size_t b = 1; b < blocksCount; b++)
+		{
+			const float* block = points + 12 * b;
+			for (int k = 0; k < 3; k++)
+			{
+				__m128 v = _mm_loadu_ps(block + 4 * k);
+				lower[k] = _mm_min_ps(lower[k], v);
+				upper[k] = _mm_max_ps(upper[k], v);
+			}
+		}
+
+		alignas(16) float l[3][4], u[3][4];
+		for (int k = 0; k < 3; k++) { _mm_store_ps(l[k], lower[k]); _mm_store_ps(u[k], upper[k]); }
+		float blockMin[3] = { (std::min)({ l[0][0], l[0][3], l[1][2], l[2][1] }), (std::min)({ l[0][1], l[1][0], l[1][3], l[2][2] }), (std::min)({ l[0][2], l[1][1], l[2][0], l[2][3] }) };
+		float blockMax[3] = { (std::max)({ u[0][0], u[0][3], u[1][2], u[2][1] }), (std::max)({ u[0][1], u[1][0], u[1][3], u[2][2] }), (std::max)({ u[0][2], u[1][1], u[2][0], u[2][3] }) };
+		box.Add(blockMin);
+		box.Add(blockMax);
+		return 4 * blocksCount;
+	}
+
+	void AddStridedPoints(BoundingBox& box, const uint8_t* points, const size_t count, const size_t byteStride)
+	{
+		if (count == 0) return;
+		auto load = [&](const size_t i) { float p[3]; std::memcpy(p, points + i * byteStride, sizeof(p)); return _mm_setr_ps(p[0], p[1], p[2], p[2]); };
+		__m128 lower = load(0), upper = lower;
+		for (size_t i = 1; i < count; i++)
+		{
+			__m128 v = load(i);
+			lower = _mm_min_ps(lower, v);
+			upper = _mm_max_ps(upper, v);
+		}
+		alignas(16) float l[4], u[4];
+		_mm_store_ps(l, lower);
+		_mm_store_ps(u, upper);
+		box.Add(l);
+		box.Add(u);
+	}
+#endif
+}
+
+bool BoundingBox::IsEmpty() const
+{
+	return min[0] > max[0] || min[1] > max[1] || min[2] > max[2];
+}
+
+void BoundingBox::Add(const float point[3])
+{
+	for (int k = 0; k < 3; k++)
+	{
+		min[k] = (std::min)(min[k], point[k]);
+		max[k] = (std::max)(max[k], point[k]);
+	}
+}
+
+void BoundingBox::Add(const BoundingBox& box)
+{
+	if (box.IsEmpty()) return;
+	Add(box.min);
+	Add(box.max);
+}
+
+BoundingBox ComputeBoundingBox(const float* points, const size_t count, const size_t byteStride)
+{
+	BoundingBox box;
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(points);
+#ifdef BOUNDS_SSE2
+	if (byteStride == 0 || byteStride == 3 * sizeof(float))
+	{
+		size_t done = AddPackedPoints(box, points, count);
+		AddPoints(box, bytes + done * 3 * sizeof(float), count - done, 3 * sizeof(float));
+	}
+	else AddStridedPoints(box, bytes, count, byteStride);
+#else
+	AddPoints(box, bytes, count, (byteStride == 0) ? 3 * sizeof(float) : byteStride);
+#endif
+	return box;
+}
+
+BoundingBox ComputeBoundingBox(const std::vector<float>& points)
+{
+	return ComputeBoundingBox(points.data(), points.size() / 3);
+}
+
+BoundingBox TransformBoundingBox(const BoundingBox& box, const float matrix[16])
+{
+	if (box.IsEmpty()) return box;
+	float center[3], extent[3];
+	for (int k = 0; k < 3; k++)
+	{
+		center[k] = 0.5f * (box.min[k] + box.max[k]);
+		extent[k] = 0.5f * (box.max[k] - box.min[k]);
+	}
+
+	BoundingBox transformed;
+	for (int j = 0; j < 3; j++)
+	{
+		float c = matrix[12 + j], e = 0.0f;
+		for (int i = 0; i < 3; i++)
+		{
+			c += center[i] * matrix[4 * i + j];
+			e += extent[i] * std::fabs(matrix[4 * i + j]);
+		}
+		transformed.min[j] = c - e;
+		transformed.max[j] = c + e;
+	}
+	return transformed;
+}
+
+BoundingSphere GetBoundingSphere(const BoundingBox& box)
+{
+	BoundingSphere sphere;
+	if (box.IsEmpty()) return sphere;
+	float squaredRadius = 0.0f;
+	for (int k = 0; k < 3; k++)
+	{
+		sphere.center[k] = 0.5f * (box.min[k] + box.max[k]);
+		squaredRadius += 0.25f * (box.max[k] - box.min[k]) * (box.max[k] - box.min[k]);
+	}
+	sphere.radius = std::sqrt(squaredRadius);
+	return sphere;
+}
+
+BoundingSphere TransformBoundingSphere(const BoundingSphere& sphere, const float matrix[16])
+{
+	BoundingSphere transformed;
+	for (int j = 0; j < 3; j++)
+	{
+		transformed.center[j] = matrix[12 + j];
+		for (int i = 0; i < 3; i++) transformed.center[j] += sphere.center[i] * matrix[4 * i + j];
+	}
+
+	// Without shear the longest axis is the largest scale, a sheared matrix can stretch more and the sum of the axes bounds it
+	auto dot = [matrix](const int a, const int b) { return matrix[4 * a] * matrix[4 * b] + matrix[4 * a + 1] * matrix[4 * b + 1] + matrix[4 * a + 2] * matrix[4 * b + 2]; };
+	float squaredScales[3] = { dot(0, 0), dot(1, 1), dot(2, 2) };
+	float squaredScale = (std::max)({ squaredScales[0], squaredScales[1], squaredScales[2] });
+	float tolerance = 1e-5f * squaredScale;
+	if (std::fabs(dot(0, 1)) > tolerance || std::fabs(dot(0, 2)) > tolerance || std::fabs(dot(1, 2)) > tolerance) squaredScale = squaredScales[0] + squaredScales[1] + squaredScales[2];
+	transformed.radius = sphere.radius * std::sqrt(squaredScale);
+	return transformed;
+}
@@ -0,0 +1,407 @@
+#include "Benchmark.h"
+#include "Bounds.h"
+#include "MeshStreams.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const std::vector<std::string> DEFAULT_BOUNDS_MODELS = { "models/TriangleWithoutIndices.gltf", "models/BoxTextured.glb", "models/2CylinderEngine.glb", "models/DamagedHelmet.glb", "models/scene.gltf" };
+	const std::vector<size_t> DEFAULT_BOUNDS_POINTS = { 1 << 16, 1 << 20 };
+	constexpr int BOUNDS_TRANSFORMS = 32;		// Random transformations each cloud and model is checked under
+	constexpr int BOUNDS_HIERARCHIES = 16;
+	constexpr int BOUNDS_REPETITIONS = 5;
+
+	using Matrix = std::array<float, 16>;
+
+	/** Row major, applied to row vectors as DirectXMath does: the result applies a then b */
+	Matrix Multiply(const Matrix& a, const Matrix& b)
+	{
+		Matrix m = {};
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				for (int k = 0; k < 4; k++) m[4 * i + j] += a[4 * i + k] * b[4 * k + j];
+			}
+		}
+		return m;
+	}
+
+	void TransformPoint(const float* point, const Matrix& m, float* result)
+	{
+		for (int j = 0; j < 3; j++) result[j] = point[0] * m[j] + point[1] * m[4 + j] + point[2] * m[8 + j] + m[12 + j];
+	}
+
+	/**
+	 * A random affine transformation: a rotation, a scale of 0.01 to 100 on each axis, sometimes mirrored, and a translation.
+	 * One out of four is sheared, as the product of a non uniform scale and of a rotation of a parent node is
+	 */
+	Matrix CreateRandomTransform(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> logScale(-2.0f, 2.0f);
+		float q[4] = { unit(random), unit(random), unit(random), unit(random) };
+		float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		for (float& c : q) c /= (length > 0.0f ? length : 1.0f);
+		float x = q[0], y = q[1], z = q[2], w = q[3];
+		Matrix rotation = { 1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w), 0,
+			2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w), 0,
+			2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y), 0,
+			0, 0, 0, 1 };
+		Matrix scale = {};
+		for (int k = 0; k < 3; k++) scale[5 * k] = std::pow(10.0f, logScale(random)) * ((random() % 8 == 0) ? -1.0f : 1.0f);
+		scale[15] = 1.0f;
+		Matrix m = Multiply(scale, rotation);
+		if (random() % 4 == 0)
+		{
+			Matrix shear = Multiply(rotation, scale);
+			m = Multiply(m, shear);
+		}
+		for (int k = 0; k < 3; k++) m[12 + k] = 100.0f * unit(random);
+		return m;
+	}
+
+	/** The reference bounding box: the points one by one, at byteStride */
+	BoundingBox ComputeReferenceBox(const float* points, const size_t count, const size_t byteStride)
+	{
+		BoundingBox box;
+		for (size_t i = 0; i < count; i++)
+		{
+			float point[3];
+			std::memcpy(point, reinterpret_cast<const uint8_t*>(points) + i * byteStride, sizeof(point));
+			box.Add(point);
+		}
+		return box;
+	}
+
+	bool IsSameBox(const BoundingBox& a, const BoundingBox& b)
+	{
+		return std::memcmp(a.min, b.min, sizeof(a.min)) == 0 && std::memcmp(a.max, b.max, sizeof(a.max)) == 0;
+	}
+
+	/** The tolerance of the float rounding of boxes transformed in different orders, relative to their size and position */
+	float GetTolerance(const BoundingBox& box)
+	{
+		float size = 1.0f;
+		for (int k = 0; k < 3; k++) size = (std::max)({ size, std::fabs(box.min[k]), std::fabs(box.max[k]) });
+		return 1e-4f * size;
+	}
+
+	bool IsNearBox(const BoundingBox& a, const BoundingBox& b)
+	{
+		float tolerance = (std::max)(GetTolerance(a), GetTolerance(b));
+		for (int k = 0; k < 3; k++)
+		{
+			if (std::fabs(a.min[k] - b.min[k]) > tolerance || std::fabs(a.max[k] - b.max[k]) > tolerance) return false;
+		}
+		return true;
+	}
+
+	bool ContainsBox(const BoundingBox& outer, const BoundingBox& inner)
+	{
+		float tolerance = GetTolerance(outer);
+		for (int k = 0; k < 3; k++)
+		{
+			if (inner.min[k] < outer.min[k] - tolerance || inner.max[k] > outer.max[k] + tolerance) return false;
+		}
+		return true;
+	}
+
+	bool ContainsPoints(const BoundingSphere& sphere, const std::vector<float>& points)
+	{
+		float tolerance = 1e-4f * (std::max)({ 1.0f, sphere.radius, std::fabs(sphere.center[0]), std::fabs(sphere.center[1]), std::fabs(sphere.center[2]) });
+		for (size_t i = 0; i + 2 < points.size(); i += 3)
+		{
+			float d[3] = { points[i] - sphere.center[0], points[i + 1] - sphere.center[1], points[i + 2] - sphere.center[2] };
+			if (std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) > sphere.radius + tolerance) return false;
+		}
+		return true;
+	}
+
+	std::vector<float> TransformPoints(const std::vector<float>& points, const Matrix& m)
+	{
+		std::vector<float> transformed(points.size());
+		for (size_t i = 0; i + 2 < points.size(); i += 3) TransformPoint(&points[i], m, &transformed[i]);
+		return transformed;
+	}
+
+	/** The box of the eight corners of box transformed one by one */
+	BoundingBox TransformCorners(const BoundingBox& box, const Matrix& m)
+	{
+		BoundingBox transformed;
+		for (int c = 0; c < 8; c++)
+		{
+			float corner[3] = { (c & 1) ? box.max[0] : box.min[0], (c & 2) ? box.max[1] : box.min[1], (c & 4) ? box.max[2] : box.min[2] };
+			float point[3];
+			TransformPoint(corner, m, point);
+			transformed.Add(point);
+		}
+		return transformed;
+	}
+
+	/**
+	 * Check that the transformed box of points is the box of its transformed corners and holds the transformed points, and that the
+	 * sphere around it and the transformed sphere hold them too. volumeRatio receives the volume of the transformed box over the volume
+	 * of the box of the transformed points, the slack of a box transformed instead of its points
+	 */
+	bool CheckTransform(const std::vector<float>& points, const BoundingBox& box, const Matrix& m, double& volumeRatio)
+	{
+		BoundingBox transformedBox = TransformBoundingBox(box, m.data());
+		std::vector<float> transformedPoints = TransformPoints(points, m);
+		BoundingBox exactBox = ComputeReferenceBox(transformedPoints.data(), transformedPoints.size() / 3, 3 * sizeof(float));
+		BoundingSphere transformedSphere = TransformBoundingSphere(GetBoundingSphere(box), m.data());
+
+		volumeRatio = 1.0;
+		for (int k = 0; k < 3; k++)
+		{
+			double exactExtent = double(exactBox.max[k]) - exactBox.min[k];
+			if (exactExtent > 0.0) volumeRatio *= (double(transformedBox.max[k]) - transformedBox.min[k]) / exactExtent;
+		}
+		return IsNearBox(transformedBox, TransformCorners(box, m)) && ContainsBox(transformedBox, exactBox)
+			&& ContainsPoints(GetBoundingSphere(transformedBox), transformedPoints) && ContainsPoints(transformedSphere, transformedPoints);
+	}
+
+	/** Run the hand checked cases: the empty boxes, the counts around the four points of a SIMD block and the strided points */
+	bool CheckCases()
+	{
+		bool isMatch = true;
+		std::cout << "  \"cases\": [" << std::endl;
+
+		Matrix translation = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 5, 6, 7, 1 };
+		BoundingBox empty = ComputeBoundingBox(nullptr, 0);
+		bool isEmptyMatch = empty.IsEmpty() && TransformBoundingBox(empty, translation.data()).IsEmpty() && GetBoundingSphere(empty).radius == 0.0f;
+		BoundingBox merged = empty;
+		merged.Add(empty);
+		isEmptyMatch &= merged.IsEmpty();
+
+		// The box of the unit cube corners translated, and its sphere
+		std::vector<float> cube;
+		for (int c = 0; c < 8; c++) cube.insert(cube.end(), { float(c & 1), float((c >> 1) & 1), float((c >> 2) & 1) });
+		BoundingBox cubeBox = TransformBoundingBox(ComputeBoundingBox(cube), translation.data());
+		BoundingSphere cubeSphere = GetBoundingSphere(cubeBox);
+		bool isCubeMatch = cubeBox.min[0] == 5.0f && cubeBox.min[1] == 6.0f && cubeBox.min[2] == 7.0f && cubeBox.max[0] == 6.0f && cubeBox.max[1] == 7.0f && cubeBox.max[2] == 8.0f
+			&& cubeSphere.center[0] == 5.5f && cubeSphere.center[1] == 6.5f && cubeSphere.center[2] == 7.5f && std::fabs(cubeSphere.radius - 0.5f * std::sqrt(3.0f)) < 1e-6f;
+
+		// Each count from 1 to 13 with the extreme values at each position, packed and in strides of 16, 20 and 28 bytes
+		bool isCountsMatch = true;
+		std::mt19937 random(19);
+		std::uniform_real_distribution<float> value(-1000.0f, 1000.0f);
+		for (size_t count = 1; count <= 13; count++)
+		{
+			for (size_t stride : { size_t(12), size_t(16), size_t(20), size_t(28) })
+			{
+				for (size_t extreme = 0; extreme < count; extreme++)
+				{
+					std::vector<float> points(count * stride / sizeof(float));
+					for (float& p : points) p = value(random);
+					for (int k = 0; k < 3; k++) points[extreme * stride / sizeof(float) + k] = (k == 1) ? -2000.0f : 2000.0f;
+					isCountsMatch &= IsSameBox(ComputeBoundingBox(points.data(), count, stride == 12 ? 0 : stride), ComputeReferenceBox(points.data(), count, stride));
+				}
+			}
+		}
+
+		isMatch &= isEmptyMatch && isCubeMatch && isCountsMatch;
+		std::cout << "    { \"case\": \"empty\", \"match\": " << (isEmptyMatch ? "true" : "false") << " }," << std::endl;
+		std::cout << "    { \"case\": \"translated_cube\", \"match\": " << (isCubeMatch ? "true" : "false") << " }," << std::endl;
+		std::cout << "    { \"case\": \"counts_and_strides\", \"match\": " << (isCountsMatch ? "true" : "false") << " }" << std::endl;
+		std::cout << "  ]," << std::endl;
+		return isMatch;
+	}
+
+	/** Reduce random clouds of each count with the SIMD and the reference loop, then check their transformed bounds */
+	bool CheckClouds(const std::vector<size_t>& pointsCounts)
+	{
+		bool isMatch = true;
+		std::mt19937 random(23);
+		std::cout << "  \"clouds\": [" << std::endl;
+		for (size_t c = 0; c < pointsCounts.size(); c++)
+		{
+			std::normal_distribution<float> coordinate(0.0f, 50.0f);
+			std::vector<float> points(3 * pointsCounts[c]);
+			for (float& p : points) p = coordinate(random);
+
+			BoundingBox box, referenceBox;
+			std::vector<double> simdMs, referenceMs;
+			for (int r = 0; r < BOUNDS_REPETITIONS; r++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				box = ComputeBoundingBox(points);
+				simdMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+				start = std::chrono::steady_clock::now();
+				referenceBox = ComputeReferenceBox(points.data(), pointsCounts[c], 3 * sizeof(float));
+				referenceMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			}
+			std::sort(simdMs.begin(), simdMs.end());
+			std::sort(referenceMs.begin(), referenceMs.end());
+
+			bool isCloudMatch = IsSameBox(box, referenceBox);
+			double largestVolumeRatio = 1.0;
+			for (int t = 0; t < BOUNDS_TRANSFORMS; t++)
+			{
+				double volumeRatio;
+				isCloudMatch &= CheckTransform(points, box, CreateRandomTransform(random), volumeRatio);
+				largestVolumeRatio = (std::max)(largestVolumeRatio, volumeRatio);
+			}
+
+			isMatch &= isCloudMatch;
+			double simd = simdMs[simdMs.size() / 2], reference = referenceMs[referenceMs.size() / 2];
+			std::cout << std::fixed << std::setprecision(3)
+				<< "    { \"points\": " << pointsCounts[c] << ", \"referenceMs\": " << reference << ", \"simdMs\": " << simd
+				<< ", \"simdMPointsPerSecond\": " << pointsCounts[c] / ((std::max)(simd, 1e-6) * 1000.0) << ", \"speedup\": " << reference / (std::max)(simd, 1e-6)
+				<< ", \"largestVolumeRatio\": " << largestVolumeRatio << ", \"match\": " << (isCloudMatch ? "true" : "false") << " }"
+				<< (c == pointsCounts.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]," << std::endl;
+		return isMatch;
+	}
+
+	/** A node of a random hierarchy: its local transformation, its parent and the points of its mesh, in its model space */
+	struct HierarchyNode
+	{
+		Matrix transform;
+		int parent = -1;
+		std::vector<float> points;
+	};
+
+	/**
+	 * Propagate the bounds of random hierarchies as Scene::UpdateBounds does, the world matrix of a node applying its transformation then
+	 * its parent one. The reference transforms the points of each node by its transformation and each of its ancestors one by one
+	 */
+	bool CheckHierarchies()
+	{
+		bool isMatch = true;
+		std::mt19937 random(29);
+		std::uniform_int_distribution<int> pointsCount(0, 200);
+		std::uniform_real_distribution<float> coordinate(-10.0f, 10.0f);
+		size_t nodesCount = 0;
+		double largestAxisRatio = 1.0;
+		for (int h = 0; h < BOUNDS_HIERARCHIES; h++)
+		{
+			std::vector<HierarchyNode> nodes(1 + random() % 40);
+			for (size_t n = 0; n < nodes.size(); n++)
+			{
+				nodes[n].transform = CreateRandomTransform(random);
+				nodes[n].parent = (n == 0) ? -1 : static_cast<int>(random() % n);
+				nodes[n].points.resize(3 * pointsCount(random));
+				for (float& p : nodes[n].points) p = coordinate(random);
+			}
+			nodesCount += nodes.size();
+
+			BoundingBox sceneBounds, referenceSceneBounds;
+			std::vector<Matrix> worldMatrices(nodes.size());
+			for (size_t n = 0; n < nodes.size(); n++)
+			{
+				worldMatrices[n] = (nodes[n].parent == -1) ? nodes[n].transform : Multiply(nodes[n].transform, worldMatrices[nodes[n].parent]);
+				BoundingBox bounds = TransformBoundingBox(ComputeBoundingBox(nodes[n].points), worldMatrices[n].data());
+				sceneBounds.Add(bounds);
+
+				std::vector<float> points = nodes[n].points;
+				for (int ancestor = static_cast<int>(n); ancestor != -1; ancestor = nodes[ancestor].parent) points = TransformPoints(points, nodes[ancestor].transform);
+				BoundingBox referenceBounds = ComputeReferenceBox(points.data(), points.size() / 3, 3 * sizeof(float));
+				referenceSceneBounds.Add(referenceBounds);
+
+				isMatch &= bounds.IsEmpty() == referenceBounds.IsEmpty() && (bounds.IsEmpty() || (ContainsBox(bounds, referenceBounds)
+					&& IsNearBox(bounds, TransformCorners(ComputeBoundingBox(nodes[n].points), worldMatrices[n]))));
+				for (int k = 0; k < 3 && !bounds.IsEmpty(); k++)
+				{
+					double referenceExtent = double(referenceBounds.max[k]) - referenceBounds.min[k];
+					if (referenceExtent > 0.0) largestAxisRatio = (std::max)(largestAxisRatio, (double(bounds.max[k]) - bounds.min[k]) / referenceExtent);
+				}
+			}
+			isMatch &= sceneBounds.IsEmpty() == referenceSceneBounds.IsEmpty() && (sceneBounds.IsEmpty() || ContainsBox(sceneBounds, referenceSceneBounds));
+		}
+
+		std::cout << std::fixed << std::setprecision(3) << "  \"hierarchies\": { \"hierarchies\": " << BOUNDS_HIERARCHIES << ", \"nodes\": " << nodesCount
+			<< ", \"largestAxisRatio\": " << largestAxisRatio << ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+
+	/** Reduce the positions of the models triangle lists, then check their transformed bounds */
+	bool CheckModels(const std::vector<std::string>& fileNames)
+	{
+		bool isMatch = true;
+		std::mt19937 random(31);
+		std::cout << "  \"models\": [" << std::endl;
+		for (size_t f = 0; f < fileNames.size(); f++)
+		{
+			bool isFileMatch = true;
+			size_t pointsCount = 0;
+			double largestVolumeRatio = 1.0;
+			BoundingBox modelBounds;
+			for (MeshStreams& mesh : LoadMeshStreams(fileNames[f]))
+			{
+				const std::vector<float>& points = mesh.Find("POSITION")->values;
+				BoundingBox box = ComputeBoundingBox(points);
+				isFileMatch &= IsSameBox(box, ComputeReferenceBox(points.data(), points.size() / 3, 3 * sizeof(float)));
+				for (int t = 0; t < BOUNDS_TRANSFORMS; t++)
+				{
+					double volumeRatio;
+					isFileMatch &= CheckTransform(points, box, CreateRandomTransform(random), volumeRatio);
+					largestVolumeRatio = (std::max)(largestVolumeRatio, volumeRatio);
+				}
+				modelBounds.Add(box);
+				pointsCount += points.size() / 3;
+			}
+
+			isMatch &= isFileMatch;
+			BoundingSphere sphere = GetBoundingSphere(modelBounds);
+			std::cout << std::setprecision(3) << "    { \"file\": \"" << std::filesystem::path(fileNames[f]).generic_string() << "\", \"points\": " << pointsCount
+				<< ", \"radius\": " << sphere.radius << ", \"largestVolumeRatio\": " << largestVolumeRatio << ", \"match\": " << (isFileMatch ? "true" : "false") << " }"
+				<< (f == fileNames.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]" << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunBounds(const std::vector<std::string>& args)
+	{
+		std::vector<size_t> pointsCounts;
+		std::vector<std::string> fileNames;
+		for (const std::string& arg : args)
+		{
+			if (!arg.empty() && std::all_of(arg.begin(), arg.end(), ::isdigit)) pointsCounts.push_back(std::stoul(arg));
+			else fileNames.push_back(arg);
+		}
+		if (pointsCounts.empty()) pointsCounts = DEFAULT_BOUNDS_POINTS;
+		if (fileNames.empty()) fileNames = DEFAULT_BOUNDS_MODELS;
+
+		std::cout << "{" << std::endl;
+		bool isMatch = CheckCases();
+		isMatch &= CheckClouds(pointsCounts);
+		isMatch &= CheckHierarchies();
+		isMatch &= CheckModels(fileNames);
+		std::cout << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef BOUNDS_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunBounds({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
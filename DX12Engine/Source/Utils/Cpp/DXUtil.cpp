@@ -105,4 +105,29 @@ namespace DXUtil
 
 		return I;
 	}
+
+	void AttachParentConsole()
+	{
+		if (AttachConsole(ATTACH_PARENT_PROCESS))
+		{
+			freopen("CONOUT$", "w", stdout);
+			freopen("CONOUT$", "w", stderr);
+		}
+	}
+
+	void CreateHeadlessDevice(ComPtr<ID3D12Device>& device, ComPtr<ID3D12CommandQueue>& commandQueue)
+	{
+		if (FAILED(D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&device))))
+		{
+			// Fallback on the WARP software adapter
+			ComPtr<IDXGIFactory4> dxgiFactory;
+			ThrowIfFailed(CreateDXGIFactory2(0, IID_PPV_ARGS(&dxgiFactory)), "Cannot create DXGI factory");
+			ComPtr<IDXGIAdapter> warpAdapter;
+			ThrowIfFailed(dxgiFactory->EnumWarpAdapter(IID_PPV_ARGS(&warpAdapter)), "Cannot enumerate the WARP adapter");
+			ThrowIfFailed(D3D12CreateDevice(warpAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&device)), "Cannot create Direct3D device on WARP adapter");
+		}
+
+		D3D12_COMMAND_QUEUE_DESC queueDesc = { D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_QUEUE_PRIORITY_NORMAL, D3D12_COMMAND_QUEUE_FLAG_NONE, 0 };
+		ThrowIfFailed(device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&commandQueue)), "Cannot create command queue");
+	}
 }
\ No newline at end of file
@@ -0,0 +1,443 @@
+#include "DynamicBVH.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	constexpr uint32_t NO_NODE = 0xFFFFFFFF;
+	constexpr size_t MIN_REFIT_TASK_SIZE = 1 << 12;	// Objects below a subtree refitted by a pool task
+	constexpr size_t FULL_REFIT_DIVISOR = 8;		// Every node is refitted when more than this fraction of the objects moved
+	constexpr size_t STACK_SIZE = 96;
+	constexpr float NODE_TEST_SLACK = 1e-5f;		// Relative margin of the node tests, so that a node is never culled or accepted when one of its objects is not
+
+	/** Half the surface area of a node box, 0 for an empty one */
+	float GetHalfArea(const BVHNode& node)
+	{
+		float d[3];
+		for (int k = 0; k < 3; k++)
+		{
+			d[k] = node.boundsMax[k] - node.boundsMin[k];
+			if (d[k] < 0.0f) return 0.0f;
+		}
+		return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+	}
+
+	bool IsVisible(const CullingBounds& bounds, const uint32_t object)
+	{
+		return bounds.sphereRadii[object] != -std::numeric_limits<float>::infinity();
+	}
+
+	BoundingBox GetObjectBox(const CullingBounds& bounds, const uint32_t object)
+	{
+		BoundingBox box;
+		if (!IsVisible(bounds, object)) return box;
+		for (int k = 0; k < 3; k++)
+		{
+			box.min[k] = bounds.boxCenters[k][object] - bounds.boxExtents[k][object];
+			box.max[k] = bounds.boxCenters[k][object] + bounds.boxExtents[k][object];
+		}
+		return box;
+	}
+
+	/** The CullBounds test of one object against the planes of planeMask */
+	bool IsOutside(const Frustum& frustum, const uint32_t planeMask, const CullingBounds& bounds, const uint32_t i)
+	{
+		for (int p = 0; p < 6; p++)
+		{
+			if ((planeMask & (1u << p)) == 0) continue;
+			const float* plane = frustum.planes[p];
+			float boxDistance = plane[0] * bounds.boxCenters[0][i] + plane[1] * bounds.boxCenters[1][i] + plane[2] * bounds.boxCenters[2][i] + plane[3];
+			float boxReach = std::fabs(plane[0]) * bounds.boxExtents[0][i] + std::fabs(plane[1]) * bounds.boxExtents[1][i] + std::fabs(plane[2]) * bounds.boxExtents[2][i];
+			float sphereDistance = plane[0] * bounds.sphereCenters[0][i] + plane[1] * bounds.sphereCenters[1][i] + plane[2] * bounds.sphereCenters[2][i] + plane[3];
+			if (boxDistance + boxReach < 0.0f || sphereDistance + bounds.sphereRadii[i] < 0.0f) return true;
+		}
+		return false;
+	}
+
+	bool IntersectBoxes(const BoundingBox& a, const BoundingBox& b)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			if (a.min[k] > b.max[k] || b.min[k] > a.max[k]) return false;
+		}
+		return true;
+	}
+
+	/** The slab test of ray against box, for tMin <= t <= tMax */
+	bool IntersectBox(const Ray& ray, const float inverseDirection[3], const float boxMin[3], const float boxMax[3])
+	{
+		float t0 = ray.tMin, t1 = ray.tMax;
+		for (int k = 0; k < 3; k++)
+		{
+			float a = (boxMin[k] - ray.origin[k]) * inverseDirection[k];
+			float b = (boxMax[k] - ray.origin[k]) * inverseDirection[k];
+			if (a > b) std::swap(a, b);
+			t0 = (std::max)(t0, a);
+			t1 = (std::min)(t1, b);
+		}
+		return t0 <= t1;
+	}
+
+	/**
+	 * Put the objects of a query in increasing order. Past a few per 64 objects a bit set, walked word by word, is cheaper than a sort
+	 * of the objects as the traversal found them
+	 */
+	void SortObjects(std::vector<uint32_t>& objects, const size_t objectsCount)
+	{
+		if (objects.size() * 64 < objectsCount)
+		{
+			std::sort(objects.begin(), objects.end());
+			return;
+		}
+		std::vector<uint64_t> words((objectsCount + 63) / 64, 0);
+		for (uint32_t object : objects) words[object / 64] |= uint64_t(1) << (object % 64);
+		objects.clear();
+		for (size_t w = 0; w < words.size(); w++)
+		{
+			uint64_t word = words[w];
+			for (uint32_t bit = 0; word != 0; bit++, word >>= 1)
+			{
+				if (word & 1) objects.push_back(static_cast<uint32_t>(64 * w + bit));
+			}
+		}
+	}
+
+	/** Walk the nodes whose box isInside accepts, calling visitLeaf(node) on the leaves reached */
+	template <typename IsInside, typename VisitLeaf>
+	void Traverse(const std::vector<BVHNode>& nodes, const IsInside& isInside, const VisitLeaf& visitLeaf)
+	{
+		if (nodes.empty() || !isInside(nodes[0])) return;
+		uint32_t stack[STACK_SIZE];
+		size_t stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			const BVHNode& node = nodes[stack[--stackSize]];
+			if (node.IsLeaf())
+			{
+				visitLeaf(node);
+				continue;
+			}
+			for (uint32_t c = node.firstChildOrPrimitive; c < node.firstChildOrPrimitive + 2; c++)
+			{
+				if (isInside(nodes[c])) stack[stackSize++] = c;
+			}
+		}
+	}
+}
+
+void DynamicBVH::Build(const CullingBounds& bounds, ThreadPool& pool, const BVHOptions& options)
+{
+	m_options = options;
+	std::vector<BoundingBox> boxes(bounds.count);
+	for (size_t i = 0; i < bounds.count; i++) boxes[i] = GetObjectBox(bounds, static_cast<uint32_t>(i));
+	BuildBoundsBVH(boxes, options, pool, m_nodes, m_order);
+
+	// The parents and the slot ranges, children after their parent: a reverse pass sees the children first
+	const size_t nodesCount = m_nodes.size();
+	m_parents.assign(nodesCount, NO_NODE);
+	m_firstSlots.assign(nodesCount, 0);
+	m_slotsCounts.assign(nodesCount, 0);
+	m_objectLeaves.assign(bounds.count, NO_NODE);
+	for (size_t n = nodesCount; n-- > 0;)
+	{
+		const BVHNode& node = m_nodes[n];
+		if (node.IsLeaf())
+		{
+			m_firstSlots[n] = node.firstChildOrPrimitive;
+			m_slotsCounts[n] = node.primitivesCount;
+			for (uint32_t slot = node.firstChildOrPrimitive; slot < node.firstChildOrPrimitive + node.primitivesCount; slot++) m_objectLeaves[m_order[slot]] = static_cast<uint32_t>(n);
+			continue;
+		}
+		uint32_t child = node.firstChildOrPrimitive;
+		m_parents[child] = m_parents[child + 1] = static_cast<uint32_t>(n);
+		m_firstSlots[n] = m_firstSlots[child];
+		m_slotsCounts[n] = m_slotsCounts[child] + m_slotsCounts[child + 1];
+	}
+
+	m_movedObjects.clear();
+	m_isMoved.assign(bounds.count, 0);
+	m_areAllMoved = false;
+	m_isNodeDirty.assign(nodesCount, 0);
+	SetRefitTasks(pool.GetThreadsCount());
+
+	m_costSum = 0.0;
+	for (size_t n = 0; n < nodesCount; n++) m_costSum += GetNodeCost(static_cast<uint32_t>(n));
+	m_buildCost = GetCost();
+}
+
+void DynamicBVH::Clear()
+{
+	*this = DynamicBVH();
+}
+
+void DynamicBVH::SetRefitTasks(const size_t threadsCount)
+{
+	// Split the upper nodes down to subtrees of a few tasks per thread, the whole hierarchy is one task on a single thread
+	m_refitTasks.clear();
+	m_upperNodes.clear();
+	if (m_nodes.empty()) return;
+	const size_t taskSize = (threadsCount > 1) ? (std::max)(MIN_REFIT_TASK_SIZE, m_order.size() / (4 * threadsCount)) : m_order.size();
+	std::vector<uint32_t> stack = { 0 };
+	while (!stack.empty())
+	{
+		uint32_t nodeId = stack.back();
+		stack.pop_back();
+		const BVHNode& node = m_nodes[nodeId];
+		if (node.IsLeaf() || m_slotsCounts[nodeId] <= taskSize)
+		{
+			m_refitTasks.push_back(nodeId);
+			continue;
+		}
+		m_upperNodes.push_back(nodeId);
+		stack.push_back(node.firstChildOrPrimitive);
+		stack.push_back(node.firstChildOrPrimitive + 1);
+	}
+	std::sort(m_upperNodes.begin(), m_upperNodes.end(), std::greater<uint32_t>());
+}
+
+void DynamicBVH::MarkMoved(const size_t object)
+{
+	if (m_isMoved[object]) return;
+	m_isMoved[object] = 1;
+	m_movedObjects.push_back(static_cast<uint32_t>(object));
+}
+
+void DynamicBVH::MarkAllMoved()
+{
+	m_areAllMoved = true;
+}
+
+double DynamicBVH::GetNodeCost(const uint32_t nodeId) const
+{
+	const BVHNode& node = m_nodes[nodeId];
+	return static_cast<double>(GetHalfArea(node)) * (node.IsLeaf() ? static_cast<double>(node.primitivesCount) : m_options.traversalCost);
+}
+
+double DynamicBVH::GetCost() const
+{
+	if (m_nodes.empty()) return 0.0;
+	float rootArea = GetHalfArea(m_nodes[0]);
+	return rootArea > 0.0f ? m_costSum / rootArea : static_cast<double>(m_order.size());
+}
+
+void DynamicBVH::RefitNode(const uint32_t nodeId, const CullingBounds& bounds)
+{
+	// A leaf bounds its objects that are still visible, an inner node its children
+	BVHNode& node = m_nodes[nodeId];
+	BoundingBox box;
+	if (node.IsLeaf())
+	{
+		for (uint32_t slot = node.firstChildOrPrimitive; slot < node.firstChildOrPrimitive + node.primitivesCount; slot++) box.Add(GetObjectBox(bounds, m_order[slot]));
+	}
+	else
+	{
+		for (uint32_t c = node.firstChildOrPrimitive; c < node.firstChildOrPrimitive + 2; c++)
+		{
+			BoundingBox child;
+			std::copy(m_nodes[c].boundsMin, m_nodes[c].boundsMin + 3, child.min);
+			std::copy(m_nodes[c].boundsMax, m_nodes[c].boundsMax + 3, child.max);
+			box.Add(child);
+		}
+	}
+	std::copy(box.min, box.min + 3, node.boundsMin);
+	std::copy(box.max, box.max + 3, node.boundsMax);
+}
+
+DynamicBVHUpdate DynamicBVH::Update(const CullingBounds& bounds, ThreadPool& pool)
+{
+	DynamicBVHUpdate update;
+	update.movedObjectsCount = m_areAllMoved ? m_objectLeaves.size() : m_movedObjects.size();
+	if (update.movedObjectsCount == 0)
+	{
+		update.cost = GetCost();
+		return update;
+	}
+
+	// An object left out of the hierarchy that now has bounds has no leaf to refit
+	bool isRebuildNeeded = false;
+	auto isLeftOut = [&](uint32_t object) { return m_objectLeaves[object] == NO_NODE && IsVisible(bounds, object); };
+	if (m_areAllMoved)
+	{
+		for (uint32_t object = 0; object < m_objectLeaves.size() && !isRebuildNeeded; object++) isRebuildNeeded = isLeftOut(object);
+	}
+	else
+	{
+		for (uint32_t object : m_movedObjects) isRebuildNeeded |= isLeftOut(object);
+	}
+
+	if (!isRebuildNeeded && (m_areAllMoved || m_movedObjects.size() > m_objectLeaves.size() / FULL_REFIT_DIVISOR))
+	{
+		// Refit every node: the subtrees of the tasks on the pool threads, each in reverse depth first order, then the nodes above them
+		std::vector<double> taskCosts(m_refitTasks.size(), 0.0);
+		pool.ParallelFor(m_refitTasks.size(), [&](size_t t)
+		{
+			std::vector<uint32_t> subtree = { m_refitTasks[t] };
+			for (size_t i = 0; i < subtree.size(); i++)
+			{
+				const BVHNode& node = m_nodes[subtree[i]];
+				if (!node.IsLeaf())
+				{
+					subtree.push_back(node.firstChildOrPrimitive);
+					subtree.push_back(node.firstChildOrPrimitive + 1);
+				}
+			}
+			for (size_t i = subtree.size(); i-- > 0;)
+			{
+				RefitNode(subtree[i], bounds);
+				taskCosts[t] += GetNodeCost(subtree[i]);
+			}
+		});
+		m_costSum = 0.0;
+		for (double cost : taskCosts) m_costSum += cost;
+		for (uint32_t nodeId : m_upperNodes)
+		{
+			RefitNode(nodeId, bounds);
+			m_costSum += GetNodeCost(nodeId);
+		}
+		update.refittedNodesCount = m_nodes.size();
+		update.isFullRefit = true;
+	}
+	else if (!isRebuildNeeded)
+	{
+		// Refit the leaves of the moved objects and their ancestors once each, children before their parent
+		std::vector<uint32_t> dirtyNodes;
+		for (uint32_t object : m_movedObjects)
+		{
+			for (uint32_t nodeId = m_objectLeaves[object]; nodeId != NO_NODE && !m_isNodeDirty[nodeId]; nodeId = m_parents[nodeId])
+			{
+				m_isNodeDirty[nodeId] = 1;
+				dirtyNodes.push_back(nodeId);
+			}
+		}
+		std::sort(dirtyNodes.begin(), dirtyNodes.end(), std::greater<uint32_t>());
+		for (uint32_t nodeId : dirtyNodes)
+		{
+			m_costSum -= GetNodeCost(nodeId);
+			RefitNode(nodeId, bounds);
+			m_costSum += GetNodeCost(nodeId);
+			m_isNodeDirty[nodeId] = 0;
+		}
+		update.refittedNodesCount = dirtyNodes.size();
+	}
+
+	for (uint32_t object : m_movedObjects) m_isMoved[object] = 0;
+	m_movedObjects.clear();
+	m_areAllMoved = false;
+
+	if (isRebuildNeeded || GetCost() > REBUILD_COST_RATIO * m_buildCost)
+	{
+		Build(bounds, pool, m_options);
+		update.isRebuilt = true;
+	}
+	update.cost = GetCost();
+	return update;
+}
+
+size_t DynamicBVH::Cull(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visible) const
+{
+	visible.clear();
+	if (m_nodes.empty()) return 0;
+
+	// Each stack entry carries the planes its box straddles, the planes its ancestors are inside of are not tested again
+	struct Entry
+	{
+		uint32_t nodeId;
+		uint32_t planeMask;
+	};
+	Entry stack[STACK_SIZE];
+	size_t stackSize = 0;
+	stack[stackSize++] = { 0, 0x3F };
+	while (stackSize > 0)
+	{
+		const Entry entry = stack[--stackSize];
+		const BVHNode& node = m_nodes[entry.nodeId];
+		if (node.boundsMin[0] > node.boundsMax[0]) continue;
+
+		uint32_t planeMask = entry.planeMask;
+		bool isOutside = false;
+		for (int p = 0; p < 6 && !isOutside; p++)
+		{
+			if ((planeMask & (1u << p)) == 0) continue;
+			const float* plane = frustum.planes[p];
+			float distance = plane[3], reach = 0.0f;
+			for (int k = 0; k < 3; k++)
+			{
+				distance += plane[k] * 0.5f * (node.boundsMin[k] + node.boundsMax[k]);
+				reach += std::fabs(plane[k]) * 0.5f * (node.boundsMax[k] - node.boundsMin[k]);
+			}
+			float slack = NODE_TEST_SLACK * (std::fabs(distance) + reach);
+			if (distance + reach < -slack) isOutside = true;
+			else if (distance - reach > slack) planeMask &= ~(1u << p);
+		}
+		if (isOutside) continue;
+
+		const uint32_t firstSlot = m_firstSlots[entry.nodeId], lastSlot = firstSlot + m_slotsCounts[entry.nodeId];
+		if (planeMask == 0)
+		{
+			for (uint32_t slot = firstSlot; slot < lastSlot; slot++)
+			{
+				if (IsVisible(bounds, m_order[slot])) visible.push_back(m_order[slot]);
+			}
+		}
+		else if (node.IsLeaf())
+		{
+			for (uint32_t slot = firstSlot; slot < lastSlot; slot++)
+			{
+				if (IsVisible(bounds, m_order[slot]) && !IsOutside(frustum, planeMask, bounds, m_order[slot])) visible.push_back(m_order[slot]);
+			}
+		}
+		else
+		{
+			stack[stackSize++] = { node.firstChildOrPrimitive, planeMask };
+			stack[stackSize++] = { node.firstChildOrPrimitive + 1, planeMask };
+		}
+	}
+	SortObjects(visible, bounds.count);
+	return visible.size();
+}
+
+size_t DynamicBVH::Query(const BoundingBox& region, const CullingBounds& bounds, std::vector<uint32_t>& objects) const
+{
+	objects.clear();
+	if (region.IsEmpty()) return 0;
+	auto isInside = [&](const BVHNode& node)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			if (node.boundsMin[k] > region.max[k] || region.min[k] > node.boundsMax[k]) return false;
+		}
+		return true;
+	};
+	Traverse(m_nodes, isInside, [&](const BVHNode& leaf)
+	{
+		for (uint32_t slot = leaf.firstChildOrPrimitive; slot < leaf.firstChildOrPrimitive + leaf.primitivesCount; slot++)
+		{
+			BoundingBox box = GetObjectBox(bounds, m_order[slot]);
+			if (!box.IsEmpty() && IntersectBoxes(box, region)) objects.push_back(m_order[slot]);
+		}
+	});
+	SortObjects(objects, bounds.count);
+	return objects.size();
+}
+
+size_t DynamicBVH::Query(const Ray& ray, const CullingBounds& bounds, std::vector<uint32_t>& objects) const
+{
+	objects.clear();
+	const float inverseDirection[3] = { 1.0f / ray.direction[0], 1.0f / ray.direction[1], 1.0f / ray.direction[2] };
+	auto isInside = [&](const BVHNode& node) { return IntersectBox(ray, inverseDirection, node.boundsMin, node.boundsMax); };
+	Traverse(m_nodes, isInside, [&](const BVHNode& leaf)
+	{
+		for (uint32_t slot = leaf.firstChildOrPrimitive; slot < leaf.firstChildOrPrimitive + leaf.primitivesCount; slot++)
+		{
+			BoundingBox box = GetObjectBox(bounds, m_order[slot]);
+			if (!box.IsEmpty() && IntersectBox(ray, inverseDirection, box.min, box.max)) objects.push_back(m_order[slot]);
+		}
+	});
+	SortObjects(objects, bounds.count);
+	return objects.size();
+}
@@ -0,0 +1,489 @@
+#include "Benchmark.h"
+#include "DynamicBVH.h"
+#include "ThreadPool.h"
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const std::vector<size_t> DEFAULT_SCENE_BVH_OBJECTS = { 10000, 100000, 1000000 };
+	constexpr size_t SCENE_BVH_CHECKED_OBJECTS = 20000;	// Objects of the scene the refits are checked on
+	constexpr size_t PARTS_PER_GROUP = 32;
+	constexpr size_t GROUPS_PER_ASSEMBLY = 32;
+	constexpr int SCENE_BVH_FRAMES = 32;				// Frames of each camera motion
+	constexpr int SCENE_BVH_QUERIES = 64;				// Random frustums, regions and rays checked after each refit
+	constexpr int SCENE_BVH_REPETITIONS = 5;
+	constexpr float PI = 3.14159265358979f;
+
+	using Matrix = std::array<float, 16>;
+
+	double GetMilliseconds(const std::chrono::steady_clock::time_point& start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double Median(std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+		return values[values.size() / 2];
+	}
+
+	Matrix Multiply(const Matrix& a, const Matrix& b)
+	{
+		Matrix m = {};
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				for (int k = 0; k < 4; k++) m[4 * i + j] += a[4 * i + k] * b[4 * k + j];
+			}
+		}
+		return m;
+	}
+
+	/** A right handed look at and XMMatrixPerspectiveFovRH, row major, as Camera builds them */
+	Frustum CreateFrustum(const float eye[3], const float target[3], const float fovY, const float farZ)
+	{
+		auto normalize = [](float v[3]) { float l = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]); for (int k = 0; k < 3; k++) v[k] /= l; };
+		float forward[3] = { eye[0] - target[0], eye[1] - target[1], eye[2] - target[2] };
+		normalize(forward);
+		float worldUp[3] = { 0.0f, 1.0f, 0.0f };
+		if (std::fabs(forward[1]) > 0.99f) { worldUp[1] = 0.0f; worldUp[2] = 1.0f; }
+		float right[3] = { worldUp[1] * forward[2] - worldUp[2] * forward[1], worldUp[2] * forward[0] - worldUp[0] * forward[2], worldUp[0] * forward[1] - worldUp[1] * forward[0] };
+		normalize(right);
+		float up[3] = { forward[1] * right[2] - forward[2] * right[1], forward[2] * right[0] - forward[0] * right[2], forward[0] * right[1] - forward[1] * right[0] };
+
+		Matrix view = {};
+		const float* axes[3] = { right, up, forward };
+		for (int a = 0; a < 3; a++)
+		{
+			for (int k = 0; k < 3; k++) view[4 * k + a] = axes[a][k];
+			view[12 + a] = -(eye[0] * axes[a][0] + eye[1] * axes[a][1] + eye[2] * axes[a][2]);
+		}
+		view[15] = 1.0f;
+
+		const float nearZ = 0.1f, h = 1.0f / std::tan(0.5f * fovY), range = farZ / (nearZ - farZ);
+		Matrix projection = { h / (16.0f / 9.0f), 0, 0, 0, 0, h, 0, 0, 0, 0, range, -1, 0, 0, range * nearZ, 0 };
+		return GetFrustum(Multiply(view, projection).data());
+	}
+
+	LocalTransform CreateRandomTransform(std::mt19937& random, const float offset)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		LocalTransform transform;
+		float length = 0.0f;
+		for (float& c : transform.rotation) { c = unit(random); length += c * c; }
+		for (float& c : transform.rotation) c /= std::sqrt(length);
+		for (int k = 0; k < 3; k++) transform.translation[k] = offset * unit(random);
+		return transform;
+	}
+
+	/**
+	 * An assembly of parts, as a CAD model: assemblies scattered in a cube, each with groups of parts around it. The parts are the
+	 * objects, placed by a TransformHierarchy as Scene places its nodes; one in 64 has no bounds, as a mesh without positions
+	 */
+	struct TestScene
+	{
+		TransformHierarchy hierarchy;
+		std::vector<BoundingBox> localBoxes;	// Of each node, empty for the assemblies and groups
+		std::vector<int> nodeObjects;			// The object of each node, -1 for the assemblies and groups
+		std::vector<uint32_t> objectNodes;
+		CullingBounds bounds;
+		float halfSize = 0.0f;					// Of the cube the assemblies are in
+	};
+
+	void CreateScene(const size_t objectsCount, std::mt19937& random, TestScene& scene)
+	{
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		const size_t objectsPerAssembly = PARTS_PER_GROUP * GROUPS_PER_ASSEMBLY;
+		const size_t assembliesCount = (std::max)(size_t(1), (objectsCount + objectsPerAssembly - 1) / objectsPerAssembly);
+		scene.halfSize = 25.0f * std::cbrt(static_cast<float>(assembliesCount));
+
+		auto addNode = [&](int parentId, const LocalTransform& transform, const BoundingBox& box)
+		{
+			size_t nodeId = scene.hierarchy.AddNode(parentId, transform);
+			scene.localBoxes.push_back(box);
+			scene.nodeObjects.push_back(-1);
+			return static_cast<int>(nodeId);
+		};
+		for (size_t a = 0; a < assembliesCount && scene.objectNodes.size() < objectsCount; a++)
+		{
+			int assemblyId = addNode(-1, CreateRandomTransform(random, scene.halfSize), BoundingBox());
+			for (size_t g = 0; g < GROUPS_PER_ASSEMBLY && scene.objectNodes.size() < objectsCount; g++)
+			{
+				int groupId = addNode(assemblyId, CreateRandomTransform(random, 8.0f), BoundingBox());
+				for (size_t p = 0; p < PARTS_PER_GROUP && scene.objectNodes.size() < objectsCount; p++)
+				{
+					BoundingBox box;
+					if (random() % 64 != 0)
+					{
+						for (int k = 0; k < 3; k++)
+						{
+							box.max[k] = 0.1f + 0.4f * unit(random);
+							box.min[k] = -box.max[k];
+						}
+					}
+					int partId = addNode(groupId, CreateRandomTransform(random, 3.0f), box);
+					scene.nodeObjects[partId] = static_cast<int>(scene.objectNodes.size());
+					scene.objectNodes.push_back(static_cast<uint32_t>(partId));
+				}
+			}
+		}
+		scene.bounds.Resize(scene.objectNodes.size());
+	}
+
+	/** Place the nodes edited since the last call and set the bounds of their objects, marking them moved as Scene does */
+	void UpdateScene(TestScene& scene, DynamicBVH& bvh)
+	{
+		const size_t updatedCount = scene.hierarchy.Update();
+		if (updatedCount == scene.hierarchy.GetNodesCount()) bvh.MarkAllMoved();
+		for (uint32_t nodeId : scene.hierarchy.GetUpdatedNodes())
+		{
+			int object = scene.nodeObjects[nodeId];
+			if (object < 0) continue;
+			BoundingBox box = TransformBoundingBox(scene.localBoxes[nodeId], scene.hierarchy.GetWorldMatrix(nodeId));
+			scene.bounds.Set(object, box, GetBoundingSphere(box));
+			if (!bvh.IsEmpty() && updatedCount != scene.hierarchy.GetNodesCount()) bvh.MarkMoved(object);
+		}
+	}
+
+	BoundingBox GetBox(const CullingBounds& bounds, const uint32_t object)
+	{
+		BoundingBox box;
+		if (bounds.sphereRadii[object] == -std::numeric_limits<float>::infinity()) return box;
+		for (int k = 0; k < 3; k++)
+		{
+			box.min[k] = bounds.boxCenters[k][object] - bounds.boxExtents[k][object];
+			box.max[k] = bounds.boxCenters[k][object] + bounds.boxExtents[k][object];
+		}
+		return box;
+	}
+
+	bool IsEqual(const BVHNode& node, const BoundingBox& box)
+	{
+		return std::equal(box.min, box.min + 3, node.boundsMin) && std::equal(box.max, box.max + 3, node.boundsMax);
+	}
+
+	/** Every node box must be the union of its children or objects boxes, and every object with bounds in exactly one slot */
+	bool IsHierarchyValid(const DynamicBVH& bvh, const CullingBounds& bounds)
+	{
+		const std::vector<BVHNode>& nodes = bvh.GetNodes();
+		const std::vector<uint32_t>& order = bvh.GetOrder();
+		std::vector<int> slotsPerObject(bounds.count, 0);
+		for (uint32_t object : order) slotsPerObject[object]++;
+		for (uint32_t object = 0; object < bounds.count; object++)
+		{
+			if (slotsPerObject[object] > 1 || (slotsPerObject[object] == 0 && !GetBox(bounds, object).IsEmpty())) return false;
+		}
+
+		for (size_t n = 0; n < nodes.size(); n++)
+		{
+			const BVHNode& node = nodes[n];
+			BoundingBox box;
+			if (node.IsLeaf())
+			{
+				if (bvh.GetFirstSlot(n) != node.firstChildOrPrimitive || bvh.GetSlotsCount(n) != node.primitivesCount) return false;
+				for (uint32_t slot = node.firstChildOrPrimitive; slot < node.firstChildOrPrimitive + node.primitivesCount; slot++) box.Add(GetBox(bounds, order[slot]));
+			}
+			else
+			{
+				const uint32_t c = node.firstChildOrPrimitive;
+				if (c <= n || bvh.GetFirstSlot(n) != bvh.GetFirstSlot(c) || bvh.GetFirstSlot(c + 1) != bvh.GetFirstSlot(c) + bvh.GetSlotsCount(c)
+					|| bvh.GetSlotsCount(n) != bvh.GetSlotsCount(c) + bvh.GetSlotsCount(c + 1)) return false;
+				for (uint32_t child = c; child < c + 2; child++)
+				{
+					BoundingBox childBox;
+					std::copy(nodes[child].boundsMin, nodes[child].boundsMin + 3, childBox.min);
+					std::copy(nodes[child].boundsMax, nodes[child].boundsMax + 3, childBox.max);
+					box.Add(childBox);
+				}
+			}
+			if (!IsEqual(node, box)) return false;
+		}
+		return true;
+	}
+
+	/** The culls of random frustums must equal CullBounds, the region and ray queries a loop over every object */
+	bool AreQueriesValid(const DynamicBVH& bvh, const TestScene& scene, std::mt19937& random)
+	{
+		const CullingBounds& bounds = scene.bounds;
+		std::uniform_real_distribution<float> position(-scene.halfSize, scene.halfSize);
+		std::uniform_real_distribution<float> size(1.0f, 0.25f * scene.halfSize);
+		std::vector<uint32_t> visible, reference;
+		for (int q = 0; q < SCENE_BVH_QUERIES; q++)
+		{
+			float eye[3] = { position(random), position(random), position(random) };
+			float target[3] = { position(random), position(random), position(random) };
+			Frustum frustum = CreateFrustum(eye, target, PI / 3.0f, (q % 2 == 0) ? 4.0f * scene.halfSize : 0.5f * scene.halfSize);
+			CullBounds(frustum, bounds, reference);
+			bvh.Cull(frustum, bounds, visible);
+			if (visible != reference) return false;
+
+			BoundingBox region;
+			region.Add(eye);
+			float halfSize = size(random);
+			for (int k = 0; k < 3; k++) { region.min[k] -= halfSize; region.max[k] += halfSize; }
+			reference.clear();
+			for (uint32_t object = 0; object < bounds.count; object++)
+			{
+				BoundingBox box = GetBox(bounds, object);
+				bool isInside = !box.IsEmpty();
+				for (int k = 0; k < 3 && isInside; k++) isInside = box.min[k] <= region.max[k] && region.min[k] <= box.max[k];
+				if (isInside) reference.push_back(object);
+			}
+			bvh.Query(region, bounds, visible);
+			if (visible != reference) return false;
+
+			Ray ray;
+			for (int k = 0; k < 3; k++) { ray.origin[k] = eye[k]; ray.direction[k] = target[k] - eye[k]; }
+			ray.tMax = (q % 2 == 0) ? 1.0f : (std::numeric_limits<float>::max)();
+			reference.clear();
+			for (uint32_t object = 0; object < bounds.count; object++)
+			{
+				BoundingBox box = GetBox(bounds, object);
+				if (box.IsEmpty()) continue;
+				float t0 = ray.tMin, t1 = ray.tMax;
+				for (int k = 0; k < 3; k++)
+				{
+					float a = (box.min[k] - ray.origin[k]) / ray.direction[k], b = (box.max[k] - ray.origin[k]) / ray.direction[k];
+					t0 = (std::max)(t0, (std::min)(a, b));
+					t1 = (std::min)(t1, (std::max)(a, b));
+				}
+				if (t0 <= t1) reference.push_back(object);
+			}
+			bvh.Query(ray, bounds, visible);
+			if (visible != reference) return false;
+		}
+		return true;
+	}
+
+	/** Edit a fraction of the nodes, moving each by up to offset from where it is */
+	void EditNodes(TestScene& scene, const double fraction, const float offset, std::mt19937& random)
+	{
+		std::uniform_int_distribution<size_t> node(0, scene.hierarchy.GetNodesCount() - 1);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		const size_t editsCount = (std::max)(size_t(1), static_cast<size_t>(fraction * scene.hierarchy.GetNodesCount()));
+		for (size_t e = 0; e < editsCount; e++)
+		{
+			size_t nodeId = node(random);
+			LocalTransform transform = scene.hierarchy.GetLocalTransform(nodeId);
+			for (int k = 0; k < 3; k++) transform.translation[k] += offset * unit(random);
+			scene.hierarchy.SetLocalTransform(nodeId, transform);
+		}
+	}
+
+	/**
+	 * Refit a scene after a root transform, small and large node edits, a scattering of the groups and an object that gets bounds,
+	 * checking the hierarchy and its queries after each: the refits must keep the node boxes the exact unions of their children
+	 */
+	bool CheckRefits(ThreadPool& pool)
+	{
+		std::mt19937 random(59);
+		TestScene scene;
+		CreateScene(SCENE_BVH_CHECKED_OBJECTS, random, scene);
+		DynamicBVH bvh;
+		UpdateScene(scene, bvh);
+		bvh.Build(scene.bounds, pool);
+
+		bool isMatch = true;
+		std::cout << "  \"refits\": [" << std::endl;
+		auto check = [&](const char* step, const DynamicBVHUpdate& update, const bool isLast)
+		{
+			bool isStepMatch = IsHierarchyValid(bvh, scene.bounds) && AreQueriesValid(bvh, scene, random);
+			isMatch &= isStepMatch;
+			std::cout << std::fixed << std::setprecision(3) << "    { \"step\": \"" << step << "\", \"movedObjects\": " << update.movedObjectsCount
+				<< ", \"refittedNodes\": " << update.refittedNodesCount << ", \"fullRefit\": " << (update.isFullRefit ? "true" : "false")
+				<< ", \"rebuilt\": " << (update.isRebuilt ? "true" : "false") << ", \"cost\": " << bvh.GetCost() << ", \"buildCost\": " << bvh.GetBuildCost()
+				<< ", \"match\": " << (isStepMatch ? "true" : "false") << " }" << (isLast ? "" : ",") << std::endl;
+		};
+		DynamicBVHUpdate build;
+		build.movedObjectsCount = scene.objectNodes.size();
+		build.isRebuilt = true;
+		build.cost = bvh.GetCost();
+		check("build", build, false);
+
+		Matrix root;
+		LocalTransform rootTransform = CreateRandomTransform(random, 10.0f);
+		ComposeMatrix(rootTransform, root.data());
+		scene.hierarchy.SetRootTransform(root.data());
+		UpdateScene(scene, bvh);
+		DynamicBVHUpdate update = bvh.Update(scene.bounds, pool);
+		isMatch &= update.isFullRefit || update.isRebuilt;
+		check("rootTransform", update, false);
+
+		EditNodes(scene, 0.01, 1.0f, random);
+		UpdateScene(scene, bvh);
+		update = bvh.Update(scene.bounds, pool);
+		isMatch &= !update.isFullRefit && !update.isRebuilt;
+		check("editOnePercent", update, false);
+
+		EditNodes(scene, 0.2, 1.0f, random);
+		UpdateScene(scene, bvh);
+		update = bvh.Update(scene.bounds, pool);
+		check("editTwentyPercent", update, false);
+
+		// Groups thrown across the scene stretch the boxes of the assemblies they leave: the cost grows until the hierarchy is built again
+		bool isRebuilt = false;
+		for (int round = 0; round < 8 && !isRebuilt; round++)
+		{
+			for (size_t nodeId = 0; nodeId < scene.hierarchy.GetNodesCount(); nodeId++)
+			{
+				if (scene.hierarchy.GetParent(nodeId) < 0 || scene.nodeObjects[nodeId] >= 0 || random() % 4 != 0) continue;
+				scene.hierarchy.SetLocalTransform(nodeId, CreateRandomTransform(random, 2.0f * scene.halfSize));
+			}
+			UpdateScene(scene, bvh);
+			update = bvh.Update(scene.bounds, pool);
+			isRebuilt = update.isRebuilt;
+			if (!IsHierarchyValid(bvh, scene.bounds)) isMatch = false;
+		}
+		isMatch &= isRebuilt;
+		check("scatterGroups", update, false);
+
+		// An object left out of the hierarchy for its empty box gets one: it has no leaf, the hierarchy is built again
+		for (size_t object = 0; object < scene.objectNodes.size(); object++)
+		{
+			uint32_t nodeId = scene.objectNodes[object];
+			if (!scene.localBoxes[nodeId].IsEmpty()) continue;
+			scene.localBoxes[nodeId].min[0] = scene.localBoxes[nodeId].min[1] = scene.localBoxes[nodeId].min[2] = -0.5f;
+			scene.localBoxes[nodeId].max[0] = scene.localBoxes[nodeId].max[1] = scene.localBoxes[nodeId].max[2] = 0.5f;
+			scene.hierarchy.SetLocalTransform(nodeId, scene.hierarchy.GetLocalTransform(nodeId));
+			break;
+		}
+		UpdateScene(scene, bvh);
+		update = bvh.Update(scene.bounds, pool);
+		isMatch &= update.isRebuilt;
+		check("boundsAdded", update, true);
+		std::cout << "  ]," << std::endl;
+		return isMatch;
+	}
+
+	/** Cull the scenes from three camera motions with CullBounds and the hierarchy, then time the refits of node edits and of a root transform */
+	bool CheckScaling(const std::vector<size_t>& objectsCounts, ThreadPool& pool)
+	{
+		bool isMatch = true;
+		std::mt19937 random(61);
+		std::cout << "  \"scaling\": [" << std::endl;
+		for (size_t c = 0; c < objectsCounts.size(); c++)
+		{
+			TestScene scene;
+			CreateScene(objectsCounts[c], random, scene);
+			DynamicBVH bvh;
+			UpdateScene(scene, bvh);
+			auto start = std::chrono::steady_clock::now();
+			bvh.Build(scene.bounds, pool);
+			double buildMs = GetMilliseconds(start);
+
+			// The camera stands in the scene and sees a sixth of it: still, walking forward and turning in place
+			std::cout << "    { \"objects\": " << scene.objectNodes.size() << ", \"nodes\": " << bvh.GetNodes().size()
+				<< std::fixed << std::setprecision(3) << ", \"buildMs\": " << buildMs << ", \"motions\": [" << std::endl;
+			const char* motions[3] = { "still", "walk", "turn" };
+			bool isScaleMatch = true;
+			for (int m = 0; m < 3; m++)
+			{
+				std::vector<double> flatMs, bvhMs;
+				size_t visibleCount = 0;
+				std::vector<uint32_t> visible, reference;
+				for (int frame = 0; frame < SCENE_BVH_FRAMES; frame++)
+				{
+					float step = (m == 1) ? frame * scene.halfSize / SCENE_BVH_FRAMES : 0.0f;
+					float angle = (m == 2) ? frame * 2.0f * PI / SCENE_BVH_FRAMES : 0.0f;
+					float eye[3] = { -0.5f * scene.halfSize + step, 0.0f, 0.0f };
+					float target[3] = { eye[0] + std::cos(angle), 0.1f, eye[2] + std::sin(angle) };
+					Frustum frustum = CreateFrustum(eye, target, PI / 3.0f, scene.halfSize);
+
+					start = std::chrono::steady_clock::now();
+					CullBounds(frustum, scene.bounds, reference);
+					flatMs.push_back(GetMilliseconds(start));
+					start = std::chrono::steady_clock::now();
+					bvh.Cull(frustum, scene.bounds, visible);
+					bvhMs.push_back(GetMilliseconds(start));
+					isScaleMatch &= visible == reference;
+					visibleCount += visible.size();
+				}
+				double flat = Median(flatMs), hierarchical = Median(bvhMs);
+				std::cout << "      { \"motion\": \"" << motions[m] << "\", \"visiblePercent\": " << 100.0 * visibleCount / (SCENE_BVH_FRAMES * scene.objectNodes.size())
+					<< ", \"flatMs\": " << flat << ", \"bvhMs\": " << hierarchical << ", \"speedup\": " << flat / (std::max)(hierarchical, 1e-6) << " }"
+					<< (m == 2 ? "" : ",") << std::endl;
+			}
+
+			// Each edit round is timed from the node edits placed to the hierarchy refitted
+			std::vector<double> hierarchyMs, smallRefitMs, largeRefitMs, rootRefitMs;
+			size_t rebuildsCount = 0;
+			for (int r = 0; r < SCENE_BVH_REPETITIONS; r++)
+			{
+				const double fractions[2] = { 0.001, 0.01 };
+				for (int f = 0; f < 2; f++)
+				{
+					EditNodes(scene, fractions[f], 0.5f, random);
+					start = std::chrono::steady_clock::now();
+					UpdateScene(scene, bvh);
+					hierarchyMs.push_back(GetMilliseconds(start));
+					start = std::chrono::steady_clock::now();
+					rebuildsCount += bvh.Update(scene.bounds, pool).isRebuilt;
+					(f == 0 ? smallRefitMs : largeRefitMs).push_back(GetMilliseconds(start));
+				}
+				Matrix root;
+				ComposeMatrix(CreateRandomTransform(random, 10.0f), root.data());
+				scene.hierarchy.SetRootTransform(root.data());
+				UpdateScene(scene, bvh);
+				start = std::chrono::steady_clock::now();
+				rebuildsCount += bvh.Update(scene.bounds, pool).isRebuilt;
+				rootRefitMs.push_back(GetMilliseconds(start));
+			}
+			isScaleMatch &= IsHierarchyValid(bvh, scene.bounds);
+			isMatch &= isScaleMatch;
+			std::cout << "    ], \"refitTenthPercentMs\": " << Median(smallRefitMs) << ", \"refitOnePercentMs\": " << Median(largeRefitMs)
+				<< ", \"refitRootTransformMs\": " << Median(rootRefitMs) << ", \"rebuilds\": " << rebuildsCount << ", \"cost\": " << bvh.GetCost()
+				<< ", \"match\": " << (isScaleMatch ? "true" : "false") << " }" << (c == objectsCounts.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]" << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunDynamicBVH(const std::vector<std::string>& args)
+	{
+		std::vector<size_t> objectsCounts;
+		for (const std::string& arg : args)
+		{
+			if (arg.empty() || !std::all_of(arg.begin(), arg.end(), ::isdigit)) throw std::invalid_argument("Expected an objects count: " + arg);
+			objectsCounts.push_back(std::stoul(arg));
+		}
+		if (objectsCounts.empty()) objectsCounts = DEFAULT_SCENE_BVH_OBJECTS;
+
+		ThreadPool& pool = ThreadPool::GetDefault();
+		std::cout << "{" << std::endl << "  \"threads\": " << pool.GetThreadsCount() << "," << std::endl;
+		bool isMatch = CheckRefits(pool);
+		isMatch &= CheckScaling(objectsCounts, pool);
+		std::cout << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef DYNAMIC_BVH_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunDynamicBVH({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
@@ -0,0 +1,115 @@
+#include "FrustumCulling.h"
+
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define FRUSTUM_CULLING_SSE2
+#include <emmintrin.h>
+#endif
+
+void CullingBounds::Resize(const size_t objectsCount)
+{
+	// The padding and the new objects get a minus infinity radius, outside every plane
+	count = objectsCount;
+	size_t paddedCount = (objectsCount + 3) & ~size_t(3);
+	for (int k = 0; k < 3; k++)
+	{
+		boxCenters[k].resize(paddedCount, 0.0f);
+		boxExtents[k].resize(paddedCount, 0.0f);
+		sphereCenters[k].resize(paddedCount, 0.0f);
+	}
+	sphereRadii.resize(paddedCount, -std::numeric_limits<float>::infinity());
+	for (size_t i = objectsCount; i < paddedCount; i++) sphereRadii[i] = -std::numeric_limits<float>::infinity();
+}
+
+void CullingBounds::Set(const size_t object, const BoundingBox& box, const BoundingSphere& sphere)
+{
+	if (box.IsEmpty())
+	{
+		for (int k = 0; k < 3; k++) boxCenters[k][object] = boxExtents[k][object] = sphereCenters[k][object] = 0.0f;
+		sphereRadii[object] = -std::numeric_limits<float>::infinity();
+		return;
+	}
+	for (int k = 0; k < 3; k++)
+	{
+		boxCenters[k][object] = 0.5f * (box.min[k] + box.max[k]);
+		boxExtents[k][object] = 0.5f * (box.max[k] - box.min[k]);
+		sphereCenters[k][object] = sphere.center[k];
+	}
+	sphereRadii[object] = sphere.radius;
+}
+
+Frustum GetFrustum(const float viewProjection[16])
+{
+	// Clip space planes on the matrix columns (Gribb, Hartmann): -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	const float* m = viewProjection;
+	const float signs[6][4] = { { 1, 0, 0, 1 }, { -1, 0, 0, 1 }, { 0, 1, 0, 1 }, { 0, -1, 0, 1 }, { 0, 0, 1, 0 }, { 0, 0, -1, 1 } };
+	Frustum frustum;
+	for (size_t p = 0; p < 6; p++)
+	{
+		float plane[4];
+		for (size_t r = 0; r < 4; r++)
+		{
+			plane[r] = signs[p][0] * m[4 * r] + signs[p][1] * m[4 * r + 1] + signs[p][2] * m[4 * r + 2] + signs[p][3] * m[4 * r + 3];
+		}
+		float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		for (size_t k = 0; k < 4; k++) frustum.planes[p][k] = length > 0.0f ? plane[k] / length : 0.0f;
+	}
+	return frustum;
+}
+
+size_t CullBounds(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visible)
+{
+	visible.clear();
+
+#ifdef FRUSTUM_CULLING_SSE2
+	// Each lane holds an object, outside a plane if the distance of its box or sphere center plus its reach towards the plane is negative
+	__m128 planes[6][7];
+	for (int p = 0; p < 6; p++)
+	{
+		for (int k = 0; k < 4; k++) planes[p][k] = _mm_set1_ps(frustum.planes[p][k]);
+		for (int k = 0; k < 3; k++) planes[p][4 + k] = _mm_set1_ps(std::fabs(frustum.planes[p][k]));
+	}
+	const __m128 zero = _mm_setzero_ps();
+	for (size_t i = 0; i < bounds.count; i += 4)
+	{
+		const __m128 boxCenter[3] = { _mm_loadu_ps(&bounds.boxCenters[0][i]), _mm_loadu_ps(&bounds.boxCenters[1][i]), _mm_loadu_ps(&bounds.boxCenters[2][i]) };
+		const __m128 boxExtent[3] = { _mm_loadu_ps(&bounds.boxExtents[0][i]), _mm_loadu_ps(&bounds.boxExtents[1][i]), _mm_loadu_ps(&bounds.boxExtents[2][i]) };
+		const __m128 sphereCenter[3] = { _mm_loadu_ps(&bounds.sphereCenters[0][i]), _mm_loadu_ps(&bounds.sphereCenters[1][i]), _mm_loadu_ps(&bounds.sphereCenters[2][i]) };
+		const __m128 sphereRadius = _mm_loadu_ps(&bounds.sphereRadii[i]);
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; p++)
+		{
+			const __m128* plane = planes[p];
+			__m128 boxDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[0], boxCenter[0]), _mm_mul_ps(plane[1], boxCenter[1])), _mm_add_ps(_mm_mul_ps(plane[2], boxCenter[2]), plane[3]));
+			__m128 boxReach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[4], boxExtent[0]), _mm_mul_ps(plane[5], boxExtent[1])), _mm_mul_ps(plane[6], boxExtent[2]));
+			__m128 sphereDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[0], sphereCenter[0]), _mm_mul_ps(plane[1], sphereCenter[1])), _mm_add_ps(_mm_mul_ps(plane[2], sphereCenter[2]), plane[3]));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(boxDistance, boxReach), zero));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(sphereDistance, sphereRadius), zero));
+		}
+
+		int outsideMask = _mm_movemask_ps(outside);
+		if (outsideMask == 0xF) continue;
+		for (size_t lane = 0; lane < 4 && i + lane < bounds.count; lane++)
+		{
+			if ((outsideMask & (1 << lane)) == 0) visible.push_back(static_cast<uint32_t>(i + lane));
+		}
+	}
+#else
+	for (size_t i = 0; i < bounds.count; i++)
+	{
+		bool isOutside = false;
+		for (int p = 0; p < 6 && !isOutside; p++)
+		{
+			const float* plane = frustum.planes[p];
+			float boxDistance = plane[0] * bounds.boxCenters[0][i] + plane[1] * bounds.boxCenters[1][i] + plane[2] * bounds.boxCenters[2][i] + plane[3];
+			float boxReach = std::fabs(plane[0]) * bounds.boxExtents[0][i] + std::fabs(plane[1]) * bounds.boxExtents[1][i] + std::fabs(plane[2]) * bounds.boxExtents[2][i];
+			float sphereDistance = plane[0] * bounds.sphereCenters[0][i] + plane[1] * bounds.sphereCenters[1][i] + plane[2] * bounds.sphereCenters[2][i] + plane[3];
+			isOutside = boxDistance + boxReach < 0.0f || sphereDistance + bounds.sphereRadii[i] < 0.0f;
+		}
+		if (!isOutside) visible.push_back(static_cast<uint32_t>(i));
+	}
+#endif
+	return visible.size();
+}
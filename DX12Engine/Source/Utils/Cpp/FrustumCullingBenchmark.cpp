@@ -0,0 +1,301 @@
+#include "Benchmark.h"
+#include "FrustumCulling.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const std::vector<size_t> DEFAULT_FRUSTUM_OBJECTS = { 10000, 100000, 1000000 };
+	constexpr int FRUSTUM_VIEWS = 16;			// Random cameras each set of objects is culled from
+	constexpr size_t FRUSTUM_CHECKED_OBJECTS = 2000;	// Culled objects sampled for points in the frustum, per view
+	constexpr int FRUSTUM_REPETITIONS = 5;
+	constexpr float PI = 3.14159265358979f;
+
+	using Matrix = std::array<float, 16>;
+
+	Matrix Multiply(const Matrix& a, const Matrix& b)
+	{
+		Matrix m = {};
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				for (int k = 0; k < 4; k++) m[4 * i + j] += a[4 * i + k] * b[4 * k + j];
+			}
+		}
+		return m;
+	}
+
+	/** The view projection of Camera: a right handed look at and XMMatrixPerspectiveFovRH, row major */
+	Matrix CreateViewProjection(const float eye[3], const float target[3], const float fovY, const float aspect, const float nearZ, const float farZ)
+	{
+		auto normalize = [](float v[3]) { float l = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]); for (int k = 0; k < 3; k++) v[k] /= l; };
+		float forward[3] = { eye[0] - target[0], eye[1] - target[1], eye[2] - target[2] };
+		normalize(forward);
+		float worldUp[3] = { 0.0f, 1.0f, 0.0f };
+		if (std::fabs(forward[1]) > 0.99f) { worldUp[1] = 0.0f; worldUp[2] = 1.0f; }
+		float right[3] = { worldUp[1] * forward[2] - worldUp[2] * forward[1], worldUp[2] * forward[0] - worldUp[0] * forward[2], worldUp[0] * forward[1] - worldUp[1] * forward[0] };
+		normalize(right);
+		float up[3] = { forward[1] * right[2] - forward[2] * right[1], forward[2] * right[0] - forward[0] * right[2], forward[0] * right[1] - forward[1] * right[0] };
+
+		Matrix view = {};
+		const float* axes[3] = { right, up, forward };
+		for (int a = 0; a < 3; a++)
+		{
+			for (int k = 0; k < 3; k++) view[4 * k + a] = axes[a][k];
+			view[12 + a] = -(eye[0] * axes[a][0] + eye[1] * axes[a][1] + eye[2] * axes[a][2]);
+		}
+		view[15] = 1.0f;
+
+		float h = 1.0f / std::tan(0.5f * fovY), range = farZ / (nearZ - farZ);
+		Matrix projection = { h / aspect, 0, 0, 0, 0, h, 0, 0, 0, 0, range, -1, 0, 0, range * nearZ, 0 };
+		return Multiply(view, projection);
+	}
+
+	/**
+	 * True if the point is in the clip volume of viewProjection: -w <= x <= w, -w <= y <= w, 0 <= z <= w. The point must be inside
+	 * by a small fraction of w, more than the float rounding of the extracted planes
+	 */
+	bool IsInClipVolume(const Matrix& m, const float p[3])
+	{
+		float clip[4];
+		for (int j = 0; j < 4; j++) clip[j] = p[0] * m[j] + p[1] * m[4 + j] + p[2] * m[8 + j] + m[12 + j];
+		const float w = clip[3] * (1.0f - 1e-4f), margin = clip[3] * 1e-4f;
+		return std::fabs(clip[0]) <= w && std::fabs(clip[1]) <= w && clip[2] >= margin && clip[2] <= w;
+	}
+
+	struct CullingObject
+	{
+		BoundingBox box;
+		BoundingSphere sphere;
+	};
+
+	/** The reference culling: one object and one plane at a time, the box corner furthest along the plane normal */
+	void CullReference(const Frustum& frustum, const std::vector<CullingObject>& objects, std::vector<uint32_t>& visible)
+	{
+		visible.clear();
+		for (size_t i = 0; i < objects.size(); i++)
+		{
+			const CullingObject& object = objects[i];
+			bool isOutside = object.box.IsEmpty();
+			for (int p = 0; p < 6 && !isOutside; p++)
+			{
+				const float* plane = frustum.planes[p];
+				float corner[3];
+				for (int k = 0; k < 3; k++) corner[k] = (plane[k] >= 0.0f) ? object.box.max[k] : object.box.min[k];
+				float cornerDistance = plane[0] * corner[0] + plane[1] * corner[1] + plane[2] * corner[2] + plane[3];
+				float sphereDistance = plane[0] * object.sphere.center[0] + plane[1] * object.sphere.center[1] + plane[2] * object.sphere.center[2] + plane[3];
+				isOutside = cornerDistance < 0.0f || sphereDistance < -object.sphere.radius;
+			}
+			if (!isOutside) visible.push_back(static_cast<uint32_t>(i));
+		}
+	}
+
+	CullingObject CreateObject(const float center[3], const float halfSize[3])
+	{
+		CullingObject object;
+		for (int k = 0; k < 3; k++)
+		{
+			object.box.min[k] = center[k] - halfSize[k];
+			object.box.max[k] = center[k] + halfSize[k];
+		}
+		object.sphere = GetBoundingSphere(object.box);
+		return object;
+	}
+
+	CullingBounds GetCullingBounds(const std::vector<CullingObject>& objects)
+	{
+		CullingBounds bounds;
+		bounds.Resize(objects.size());
+		for (size_t i = 0; i < objects.size(); i++) bounds.Set(i, objects[i].box, objects[i].sphere);
+		return bounds;
+	}
+
+	/**
+	 * Hand checked objects against a camera at the origin looking down -z, with a 90 degrees field of view: the side planes are
+	 * x = z and x = -z, the near and far planes z = -0.1 and z = -100
+	 */
+	bool CheckCases()
+	{
+		struct Case { const char* name; float center[3]; float halfSize[3]; float sphereRadius; bool isVisible; };
+		const Case cases[] = {
+			{ "inside", { 0, 0, -10 }, { 1, 1, 1 }, 0, true },
+			{ "straddlingLeft", { -10, 0, -10 }, { 1, 1, 1 }, 0, true },
+			{ "outsideLeft", { -12.5f, 0, -10 }, { 1, 1, 1 }, 0, false },
+			{ "outsideTop", { 0, 13, -10 }, { 1, 1, 1 }, 0, false },
+			{ "behindCamera", { 0, 0, 10 }, { 1, 1, 1 }, 0, false },
+			{ "behindCameraWide", { 0, 0, 5 }, { 30, 30, 1 }, 0, false },
+			{ "aroundCamera", { 0, 0, 0 }, { 1, 1, 1 }, 0, true },
+			{ "straddlingFar", { 0, 0, -100 }, { 1, 1, 1 }, 0, true },
+			{ "beyondFar", { 0, 0, -200 }, { 1, 1, 1 }, 0, false },
+			{ "enclosingFrustum", { 0, 0, 0 }, { 1000, 1000, 1000 }, 0, true },
+			{ "sphereOutside", { -11.2f, 0, -10 }, { 1, 1, 1 }, 0.5f, false },	// The box straddles the left plane, its inner sphere does not
+			{ "empty", { 0, 0, -10 }, { -1, -1, -1 }, 0, false },
+		};
+		const float eye[3] = { 0, 0, 0 }, target[3] = { 0, 0, -1 };
+		Matrix viewProjection = CreateViewProjection(eye, target, 0.5f * PI, 1.0f, 0.1f, 100.0f);
+		Frustum frustum = GetFrustum(viewProjection.data());
+
+		std::vector<CullingObject> objects;
+		for (const Case& c : cases)
+		{
+			objects.push_back(CreateObject(c.center, c.halfSize));
+			if (c.sphereRadius > 0.0f) objects.back().sphere.radius = c.sphereRadius;
+		}
+		std::vector<uint32_t> visible, referenceVisible;
+		CullBounds(frustum, GetCullingBounds(objects), visible);
+		CullReference(frustum, objects, referenceVisible);
+
+		bool isMatch = visible == referenceVisible;
+		std::cout << "  \"cases\": [" << std::endl;
+		for (size_t i = 0; i < objects.size(); i++)
+		{
+			bool isVisible = std::find(visible.begin(), visible.end(), static_cast<uint32_t>(i)) != visible.end();
+			isMatch &= isVisible == cases[i].isVisible;
+			std::cout << "    { \"case\": \"" << cases[i].name << "\", \"visible\": " << (isVisible ? "true" : "false") << ", \"match\": "
+				<< (isVisible == cases[i].isVisible ? "true" : "false") << " }" << (i == objects.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]," << std::endl;
+		return isMatch;
+	}
+
+	/** Return true if a point of a grid over the box, inside the sphere, is in the clip volume: the object must not be culled */
+	bool HasPointInFrustum(const CullingObject& object, const Matrix& viewProjection)
+	{
+		const int steps = 4;
+		for (int i = 0; i <= steps; i++)
+		{
+			for (int j = 0; j <= steps; j++)
+			{
+				for (int k = 0; k <= steps; k++)
+				{
+					const int t[3] = { i, j, k };
+					float p[3], squaredDistance = 0.0f;
+					for (int a = 0; a < 3; a++)
+					{
+						p[a] = object.box.min[a] + (object.box.max[a] - object.box.min[a]) * t[a] / steps;
+						squaredDistance += (p[a] - object.sphere.center[a]) * (p[a] - object.sphere.center[a]);
+					}
+					if (squaredDistance <= object.sphere.radius * object.sphere.radius * 0.999f && IsInClipVolume(viewProjection, p)) return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Cull random boxes of each count, scattered around the cameras with sizes over three orders of magnitude, from random views.
+	 * The visible lists must equal the reference ones, and no culled object may have a point in the frustum
+	 */
+	bool CheckRandom(const std::vector<size_t>& objectsCounts)
+	{
+		bool isMatch = true;
+		std::mt19937 random(47);
+		std::cout << "  \"random\": [" << std::endl;
+		for (size_t c = 0; c < objectsCounts.size(); c++)
+		{
+			std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+			std::uniform_real_distribution<float> logSize(-1.0f, 2.0f);
+			std::vector<CullingObject> objects(objectsCounts[c]);
+			for (CullingObject& object : objects)
+			{
+				float center[3] = { position(random), position(random), position(random) };
+				float halfSize[3] = { std::pow(10.0f, logSize(random)), std::pow(10.0f, logSize(random)), std::pow(10.0f, logSize(random)) };
+				object = CreateObject(center, halfSize);
+				if (random() % 4 == 0) object.sphere.radius *= 0.75f;	// A sphere tighter than the box, as around a rotated mesh
+			}
+			CullingBounds bounds = GetCullingBounds(objects);
+
+			bool isViewMatch = true;
+			size_t visibleCount = 0;
+			std::vector<double> simdMs, referenceMs;
+			for (int v = 0; v < FRUSTUM_VIEWS; v++)
+			{
+				float eye[3] = { 0.5f * position(random), 0.5f * position(random), 0.5f * position(random) };
+				float target[3] = { position(random), position(random), position(random) };
+				Matrix viewProjection = CreateViewProjection(eye, target, 0.25f * PI, 16.0f / 9.0f, 0.1f, 400.0f);
+				Frustum frustum = GetFrustum(viewProjection.data());
+
+				std::vector<uint32_t> visible, referenceVisible;
+				for (int r = 0; r < FRUSTUM_REPETITIONS; r++)
+				{
+					auto start = std::chrono::steady_clock::now();
+					CullBounds(frustum, bounds, visible);
+					simdMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+					start = std::chrono::steady_clock::now();
+					CullReference(frustum, objects, referenceVisible);
+					referenceMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+				}
+				isViewMatch &= visible == referenceVisible;
+				visibleCount += visible.size();
+
+				std::vector<uint8_t> isVisible(objects.size(), 0);
+				for (uint32_t i : visible) isVisible[i] = 1;
+				size_t checked = 0;
+				for (size_t i = 0; i < objects.size() && checked < FRUSTUM_CHECKED_OBJECTS; i++)
+				{
+					if (isVisible[i]) continue;
+					isViewMatch &= !HasPointInFrustum(objects[i], viewProjection);
+					checked++;
+				}
+			}
+			std::sort(simdMs.begin(), simdMs.end());
+			std::sort(referenceMs.begin(), referenceMs.end());
+
+			isMatch &= isViewMatch;
+			double simd = simdMs[simdMs.size() / 2], reference = referenceMs[referenceMs.size() / 2];
+			std::cout << std::fixed << std::setprecision(3)
+				<< "    { \"objects\": " << objectsCounts[c] << ", \"views\": " << FRUSTUM_VIEWS << ", \"visiblePercent\": " << 100.0 * visibleCount / (std::max)(size_t(1), objectsCounts[c] * FRUSTUM_VIEWS)
+				<< ", \"referenceMs\": " << reference << ", \"simdMs\": " << simd << ", \"simdMObjectsPerSecond\": " << objectsCounts[c] / ((std::max)(simd, 1e-6) * 1000.0)
+				<< ", \"speedup\": " << reference / (std::max)(simd, 1e-6) << ", \"match\": " << (isViewMatch ? "true" : "false") << " }"
+				<< (c == objectsCounts.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]" << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunFrustumCulling(const std::vector<std::string>& args)
+	{
+		std::vector<size_t> objectsCounts;
+		for (const std::string& arg : args)
+		{
+			if (arg.empty() || !std::all_of(arg.begin(), arg.end(), ::isdigit)) throw std::invalid_argument("Expected an objects count: " + arg);
+			objectsCounts.push_back(std::stoul(arg));
+		}
+		if (objectsCounts.empty()) objectsCounts = DEFAULT_FRUSTUM_OBJECTS;
+
+		std::cout << "{" << std::endl;
+		bool isMatch = CheckCases();
+		isMatch &= CheckRandom(objectsCounts);
+		std::cout << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef FRUSTUM_CULLING_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunFrustumCulling({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
@@ -0,0 +1,764 @@
+#include "GLTFJsonReader.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	constexpr uint32_t GLB_MAGIC = 0x46546C67;			// "glTF"
+	constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;		// "JSON"
+	constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;		// "BIN"
+	constexpr size_t GLB_HEADER_SIZE = 12;
+	constexpr size_t GLB_CHUNK_HEADER_SIZE = 8;
+
+	constexpr int MAX_DEPTH = 128;
+	constexpr int MAX_SIGNIFICANT_DIGITS = 19;				// Any 19 digits fit in an uint64_t
+	constexpr uint64_t MAX_EXACT_MANTISSA = 1ull << 53;		// Integers up to 2^53 are exact doubles
+	constexpr int MAX_EXACT_POW10 = 22;						// 10^22 is the largest exact power of 10 in a double
+
+	constexpr double POW10[MAX_EXACT_POW10 + 1] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	bool IsDigit(const char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	int HexValue(const char c)
+	{
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+		return -1;
+	}
+
+	void AppendUTF8(std::string& out, const uint32_t codePoint)
+	{
+		if (codePoint < 0x80) out += static_cast<char>(codePoint);
+		else if (codePoint < 0x800)
+		{
+			out += static_cast<char>(0xC0 | (codePoint >> 6));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else if (codePoint < 0x10000)
+		{
+			out += static_cast<char>(0xE0 | (codePoint >> 12));
+			out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			out += static_cast<char>(0xF0 | (codePoint >> 18));
+			out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+			out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+	}
+
+	int AccessorType(const std::string_view type)
+	{
+		if (type == "SCALAR") return TINYGLTF_TYPE_SCALAR;
+		if (type == "VEC2") return TINYGLTF_TYPE_VEC2;
+		if (type == "VEC3") return TINYGLTF_TYPE_VEC3;
+		if (type == "VEC4") return TINYGLTF_TYPE_VEC4;
+		if (type == "MAT2") return TINYGLTF_TYPE_MAT2;
+		if (type == "MAT3") return TINYGLTF_TYPE_MAT3;
+		if (type == "MAT4") return TINYGLTF_TYPE_MAT4;
+		return -1;
+	}
+
+	int Base64Value(const unsigned char c)
+	{
+		if (c >= 'A' && c <= 'Z') return c - 'A';
+		if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+		if (c >= '0' && c <= '9') return c - '0' + 52;
+		if (c == '+') return 62;
+		if (c == '/') return 63;
+		return -1;
+	}
+
+	uint32_t ReadUInt32(const uint8_t* data)
+	{
+		uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+}
+
+void GLTFJsonReader::Parse(const char* json, const size_t size, tinygltf::Model& model)
+{
+	m_begin = m_cursor = json;
+	m_end = json + size;
+	m_depth = 0;
+	m_buffersByteLength.clear();
+	model = tinygltf::Model();
+
+	// Skip the UTF-8 byte order mark
+	if (size >= 3 && std::memcmp(json, "\xEF\xBB\xBF", 3) == 0) m_cursor += 3;
+
+	bool hasAsset = false;
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "asset") { ReadAsset(model.asset); hasAsset = true; }
+			else if (key == "scene") model.defaultScene = ReadInt();
+			else if (key == "scenes") ReadObjects(model.scenes, &GLTFJsonReader::ReadScene);
+			else if (key == "nodes") ReadObjects(model.nodes, &GLTFJsonReader::ReadNode);
+			else if (key == "meshes") ReadObjects(model.meshes, &GLTFJsonReader::ReadMesh);
+			else if (key == "accessors") ReadObjects(model.accessors, &GLTFJsonReader::ReadAccessor);
+			else if (key == "bufferViews") ReadObjects(model.bufferViews, &GLTFJsonReader::ReadBufferView);
+			else if (key == "buffers")
+			{
+				ForEachElement([&]()
+					{
+						model.buffers.emplace_back();
+						m_buffersByteLength.push_back(0);
+						ReadBuffer(model.buffers.back(), m_buffersByteLength.back());
+					});
+			}
+			else if (key == "images") ReadObjects(model.images, &GLTFJsonReader::ReadImage);
+			else if (key == "textures") ReadObjects(model.textures, &GLTFJsonReader::ReadTexture);
+			else if (key == "samplers") ReadObjects(model.samplers, &GLTFJsonReader::ReadSampler);
+			else if (key == "materials") ReadObjects(model.materials, &GLTFJsonReader::ReadMaterial);
+			else if (key == "extensions") ReadRootExtensions(model);
+			else SkipValue();
+		});
+
+	// GLB JSON chunks are padded with spaces, some writers pad them with zeros
+	SkipWhitespace();
+	while (m_cursor < m_end && *m_cursor == '\0') m_cursor++;
+	if (m_cursor != m_end) Fail("Unexpected data after the glTF JSON document");
+	if (!hasAsset || model.asset.version.empty()) Fail("The glTF asset version is missing");
+
+	// Buffer views without a target get the one of the primitives reading them, as tinygltf does
+	auto setTarget = [&](const int accessorId, const int target)
+	{
+		if (accessorId < 0 || static_cast<size_t>(accessorId) >= model.accessors.size()) Fail("Primitive accessor out of range");
+		int bufferView = model.accessors[accessorId].bufferView;
+		if (bufferView >= static_cast<int>(model.bufferViews.size())) Fail("Accessor buffer view out of range");
+		if (bufferView >= 0) model.bufferViews[bufferView].target = target;
+	};
+	for (const tinygltf::Mesh& mesh : model.meshes)
+	{
+		for (const tinygltf::Primitive& primitive : mesh.primitives)
+		{
+			if (primitive.indices != -1) setTarget(primitive.indices, TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER);
+			for (const auto& attribute : primitive.attributes) setTarget(attribute.second, TINYGLTF_TARGET_ARRAY_BUFFER);
+			for (const auto& target : primitive.targets) for (const auto& attribute : target) setTarget(attribute.second, TINYGLTF_TARGET_ARRAY_BUFFER);
+		}
+	}
+}
+
+const std::vector<size_t>& GLTFJsonReader::GetBuffersByteLength() const
+{
+	return m_buffersByteLength;
+}
+
+GLBChunks GLTFJsonReader::ReadGLBChunks(const uint8_t* data, const size_t size)
+{
+	// See https://github.com/KhronosGroup/glTF/tree/master/specification/2.0#glb-file-format-specification
+	if (size < GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE || ReadUInt32(data) != GLB_MAGIC) throw std::runtime_error("Invalid glTF binary magic");
+	size_t length = ReadUInt32(data + 8);
+	if (length > size) throw std::runtime_error("Invalid glTF binary length");
+
+	GLBChunks chunks;
+	size_t chunkLength = ReadUInt32(data + GLB_HEADER_SIZE);
+	if (ReadUInt32(data + GLB_HEADER_SIZE + 4) != GLB_CHUNK_JSON) throw std::runtime_error("The first glTF binary chunk must be JSON");
+	if (chunkLength > length - GLB_HEADER_SIZE - GLB_CHUNK_HEADER_SIZE) throw std::runtime_error("Invalid glTF binary JSON chunk length");
+	chunks.json = reinterpret_cast<const char*>(data + GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE);
+	chunks.jsonSize = chunkLength;
+
+	// The optional BIN chunk follows the JSON chunk
+	size_t binChunkOffset = GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE + chunkLength;
+	if (binChunkOffset + GLB_CHUNK_HEADER_SIZE <= length && ReadUInt32(data + binChunkOffset + 4) == GLB_CHUNK_BIN)
+	{
+		chunkLength = ReadUInt32(data + binChunkOffset);
+		if (chunkLength > length - binChunkOffset - GLB_CHUNK_HEADER_SIZE) throw std::runtime_error("Invalid glTF binary BIN chunk length");
+		chunks.bin = data + binChunkOffset + GLB_CHUNK_HEADER_SIZE;
+		chunks.binSize = chunkLength;
+	}
+	return chunks;
+}
+
+bool GLTFJsonReader::DecodeDataURI(const std::string& uri, std::vector<unsigned char>& data)
+{
+	// data:[<mime type>];base64,<data>
+	if (uri.compare(0, 5, "data:") != 0) return false;
+	size_t base64Begin = uri.find(";base64,");
+	if (base64Begin == std::string::npos) return false;
+	base64Begin += 8;
+
+	data.clear();
+	data.reserve((uri.size() - base64Begin) / 4 * 3);
+	uint32_t bits = 0;
+	int bitsCount = 0;
+	for (size_t i = base64Begin; i < uri.size() && uri[i] != '='; i++)
+	{
+		int value = Base64Value(static_cast<unsigned char>(uri[i]));
+		if (value < 0) return false;
+		bits = (bits << 6) | static_cast<uint32_t>(value);
+		bitsCount += 6;
+		if (bitsCount >= 8)
+		{
+			bitsCount -= 8;
+			data.push_back(static_cast<unsigned char>((bits >> bitsCount) & 0xFF));
+		}
+	}
+	return true;
+}
+
+template <class F>
+void GLTFJsonReader::ForEachMember(F&& onMember)
+{
+	if (++m_depth > MAX_DEPTH) Fail("JSON nesting too deep");
+	Expect('{');
+	if (!Consume('}'))
+	{
+		std::string escapedKey;
+		do
+		{
+			std::string_view key = ReadKey(escapedKey);
+			Expect(':');
+			onMember(key);
+		} while (Consume(','));
+		Expect('}');
+	}
+	m_depth--;
+}
+
+template <class F>
+void GLTFJsonReader::ForEachElement(F&& onElement)
+{
+	if (++m_depth > MAX_DEPTH) Fail("JSON nesting too deep");
+	Expect('[');
+	if (!Consume(']'))
+	{
+		do { onElement(); } while (Consume(','));
+		Expect(']');
+	}
+	m_depth--;
+}
+
+template <class T>
+void GLTFJsonReader::ReadObjects(std::vector<T>& objects, void (GLTFJsonReader::*readObject)(T&))
+{
+	ForEachElement([&]()
+		{
+			objects.emplace_back();
+			(this->*readObject)(objects.back());
+		});
+}
+
+void GLTFJsonReader::SkipWhitespace()
+{
+	while (m_cursor < m_end && (*m_cursor == ' ' || *m_cursor == '\n' || *m_cursor == '\r' || *m_cursor == '\t')) m_cursor++;
+}
+
+void GLTFJsonReader::Expect(const char c)
+{
+	if (!Consume(c)) Fail((std::string("Expected '") + c + "'").c_str());
+}
+
+bool GLTFJsonReader::Consume(const char c)
+{
+	SkipWhitespace();
+	if (m_cursor == m_end || *m_cursor != c) return false;
+	m_cursor++;
+	return true;
+}
+
+void GLTFJsonReader::Fail(const char* message) const
+{
+	throw std::runtime_error("Invalid glTF JSON at byte " + std::to_string(m_cursor - m_begin) + ": " + message);
+}
+
+std::string_view GLTFJsonReader::ReadKey(std::string& escapedKey)
+{
+	SkipWhitespace();
+	const char* quote = m_cursor;
+	Expect('"');
+
+	// Keys are compared in place, only keys with escape sequences are decoded
+	const char* begin = m_cursor;
+	while (m_cursor < m_end && *m_cursor != '"' && *m_cursor != '\\') m_cursor++;
+	if (m_cursor == m_end) Fail("Unterminated string");
+	if (*m_cursor == '"') return std::string_view(begin, static_cast<size_t>(m_cursor++ - begin));
+
+	m_cursor = quote;
+	escapedKey = ReadString();
+	return escapedKey;
+}
+
+std::string GLTFJsonReader::ReadString()
+{
+	Expect('"');
+	std::string value;
+	for (;;)
+	{
+		const char* begin = m_cursor;
+		while (m_cursor < m_end && *m_cursor != '"' && *m_cursor != '\\' && static_cast<unsigned char>(*m_cursor) >= 0x20) m_cursor++;
+		value.append(begin, m_cursor);
+		if (m_cursor == m_end) Fail("Unterminated string");
+		if (*m_cursor == '"') { m_cursor++; return value; }
+		if (*m_cursor != '\\') Fail("Control character in string");
+
+		if (++m_cursor == m_end) Fail("Unterminated string");
+		switch (*m_cursor++)
+		{
+		case '"': value += '"'; break;
+		case '\\': value += '\\'; break;
+		case '/': value += '/'; break;
+		case 'b': value += '\b'; break;
+		case 'f': value += '\f'; break;
+		case 'n': value += '\n'; break;
+		case 'r': value += '\r'; break;
+		case 't': value += '\t'; break;
+		case 'u':
+		{
+			auto readHex4 = [this]()
+			{
+				if (m_end - m_cursor < 4) Fail("Invalid unicode escape");
+				uint32_t codeUnit = 0;
+				for (int i = 0; i < 4; i++)
+				{
+					int digit = HexValue(*m_cursor++);
+					if (digit < 0) Fail("Invalid unicode escape");
+					codeUnit = (codeUnit << 4) | static_cast<uint32_t>(digit);
+				}
+				return codeUnit;
+			};
+
+			uint32_t codePoint = readHex4();
+			if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+			{
+				// A high surrogate must be followed by a low surrogate
+				if (m_end - m_cursor < 2 || m_cursor[0] != '\\' || m_cursor[1] != 'u') Fail("Invalid unicode surrogate pair");
+				m_cursor += 2;
+				uint32_t lowSurrogate = readHex4();
+				if (lowSurrogate < 0xDC00 || lowSurrogate > 0xDFFF) Fail("Invalid unicode surrogate pair");
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+			}
+			else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF) Fail("Invalid unicode surrogate pair");
+			AppendUTF8(value, codePoint);
+			break;
+		}
+		default: Fail("Invalid escape sequence");
+		}
+	}
+}
+
+double GLTFJsonReader::ReadNumber()
+{
+	SkipWhitespace();
+	const char* begin = m_cursor;
+	bool isNegative = (m_cursor < m_end && *m_cursor == '-');
+	if (isNegative) m_cursor++;
+	if (m_cursor == m_end || !IsDigit(*m_cursor)) Fail("Expected a number");
+
+	// Accumulate up to 19 significant digits in the mantissa, the digits that don't fit only move the exponent
+	uint64_t mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool isTruncated = false;
+	if (*m_cursor == '0') m_cursor++;
+	else
+	{
+		for (; m_cursor < m_end && IsDigit(*m_cursor); m_cursor++)
+		{
+			if (significantDigits < MAX_SIGNIFICANT_DIGITS) { mantissa = mantissa * 10 + static_cast<uint64_t>(*m_cursor - '0'); significantDigits++; }
+			else { exponent++; isTruncated |= (*m_cursor != '0'); }
+		}
+	}
+
+	if (m_cursor < m_end && *m_cursor == '.')
+	{
+		m_cursor++;
+		if (m_cursor == m_end || !IsDigit(*m_cursor)) Fail("Expected a digit after the decimal point");
+		for (; m_cursor < m_end && IsDigit(*m_cursor); m_cursor++)
+		{
+			if (significantDigits < MAX_SIGNIFICANT_DIGITS)
+			{
+				// Leading zeros of the fraction are not significant
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*m_cursor - '0');
+				if (mantissa != 0) significantDigits++;
+				exponent--;
+			}
+			else isTruncated |= (*m_cursor != '0');
+		}
+	}
+
+	if (m_cursor < m_end && (*m_cursor == 'e' || *m_cursor == 'E'))
+	{
+		m_cursor++;
+		bool isExponentNegative = false;
+		if (m_cursor < m_end && (*m_cursor == '+' || *m_cursor == '-')) isExponentNegative = (*m_cursor++ == '-');
+		if (m_cursor == m_end || !IsDigit(*m_cursor)) Fail("Expected a digit in the exponent");
+		int explicitExponent = 0;
+		for (; m_cursor < m_end && IsDigit(*m_cursor); m_cursor++)
+		{
+			if (explicitExponent < 100000) explicitExponent = explicitExponent * 10 + (*m_cursor - '0');
+		}
+		exponent += isExponentNegative ? -explicitExponent : explicitExponent;
+	}
+
+	// Exact fast path: both the mantissa and the power of 10 are exact doubles, so one rounding gives the correctly rounded result
+	if (!isTruncated && mantissa <= MAX_EXACT_MANTISSA && exponent >= -MAX_EXACT_POW10 && exponent <= MAX_EXACT_POW10)
+	{
+		double value = static_cast<double>(mantissa);
+		value = (exponent < 0) ? value / POW10[-exponent] : value * POW10[exponent];
+		return isNegative ? -value : value;
+	}
+
+	// The rare long or extreme numbers are converted by the standard library
+	double value = 0.0;
+	std::from_chars_result result = std::from_chars(begin + (isNegative ? 1 : 0), m_cursor, value);
+	if (result.ec == std::errc::invalid_argument) Fail("Invalid number");
+	if (result.ec == std::errc::result_out_of_range) value = (exponent + significantDigits > 0) ? HUGE_VAL : 0.0;	// Saturate as strtod does
+	return isNegative ? -value : value;
+}
+
+int GLTFJsonReader::ReadInt()
+{
+	double value = ReadNumber();
+	if (value < INT32_MIN || value > INT32_MAX || value != static_cast<double>(static_cast<int>(value))) Fail("Expected an integer");
+	return static_cast<int>(value);
+}
+
+size_t GLTFJsonReader::ReadSize()
+{
+	double value = ReadNumber();
+	if (value < 0.0 || value > static_cast<double>(MAX_EXACT_MANTISSA) || value != static_cast<double>(static_cast<uint64_t>(value))) Fail("Expected a non negative integer");
+	return static_cast<size_t>(value);
+}
+
+bool GLTFJsonReader::ReadBool()
+{
+	SkipWhitespace();
+	if (m_end - m_cursor >= 4 && std::memcmp(m_cursor, "true", 4) == 0) { m_cursor += 4; return true; }
+	if (m_end - m_cursor >= 5 && std::memcmp(m_cursor, "false", 5) == 0) { m_cursor += 5; return false; }
+	Fail("Expected a boolean");
+}
+
+void GLTFJsonReader::ReadNumbers(std::vector<double>& values)
+{
+	values.clear();
+	ForEachElement([&]() { values.push_back(ReadNumber()); });
+}
+
+void GLTFJsonReader::ReadInts(std::vector<int>& values)
+{
+	values.clear();
+	ForEachElement([&]() { values.push_back(ReadInt()); });
+}
+
+void GLTFJsonReader::SkipString()
+{
+	Expect('"');
+	for (; m_cursor < m_end && *m_cursor != '"'; m_cursor++)
+	{
+		if (*m_cursor == '\\' && ++m_cursor == m_end) break;
+	}
+	if (m_cursor == m_end) Fail("Unterminated string");
+	m_cursor++;
+}
+
+void GLTFJsonReader::SkipValue()
+{
+	SkipWhitespace();
+	if (m_cursor == m_end) Fail("Expected a value");
+	switch (*m_cursor)
+	{
+	case '{': ForEachMember([this](const std::string_view) { SkipValue(); }); break;
+	case '[': ForEachElement([this]() { SkipValue(); }); break;
+	case '"': SkipString(); break;
+	case 't':
+	case 'f': ReadBool(); break;
+	case 'n':
+		if (m_end - m_cursor < 4 || std::memcmp(m_cursor, "null", 4) != 0) Fail("Expected a value");
+		m_cursor += 4;
+		break;
+	default: ReadNumber();
+	}
+}
+
+void GLTFJsonReader::ReadAsset(tinygltf::Asset& asset)
+{
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "version") asset.version = ReadString();
+			else if (key == "minVersion") asset.minVersion = ReadString();
+			else if (key == "generator") asset.generator = ReadString();
+			else if (key == "copyright") asset.copyright = ReadString();
+			else SkipValue();
+		});
+}
+
+void GLTFJsonReader::ReadScene(tinygltf::Scene& scene)
+{
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "name") scene.name = ReadString();
+			else if (key == "nodes") ReadInts(scene.nodes);
+			else SkipValue();
+		});
+}
+
+void GLTFJsonReader::ReadNode(tinygltf::Node& node)
+{
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "name") node.name = ReadString();
+			else if (key == "mesh") node.mesh = ReadInt();
+			else if (key == "camera") node.camera = ReadInt();
+			else if (key == "skin") node.skin = ReadInt();
+			else if (key == "children") ReadInts(node.children);
+			else if (key == "matrix") ReadNumbers(node.matrix);
+			else if (key == "rotation") ReadNumbers(node.rotation);
+			else if (key == "scale") ReadNumbers(node.scale);
+			else if (key == "translation") ReadNumbers(node.translation);
+			else if (key == "weights") ReadNumbers(node.weights);
+			else SkipValue();
+		});
+
+	// The matrix and the TRS properties are exclusive, the matrix wins
+	if (!node.matrix.empty())
+	{
+		node.rotation.clear();
+		node.scale.clear();
+		node.translation.clear();
+	}
+}
+
+void GLTFJsonReader::ReadMesh(tinygltf::Mesh& mesh)
+{
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "name") mesh.name = ReadString();
+			else if (key == "primitives") ReadObjects(mesh.primitives, &GLTFJsonReader::ReadPrimitive);
+			else if (key == "weights") ReadNumbers(mesh.weights);
+			else SkipValue();
+		});
+}
+
+void GLTFJsonReader::ReadPrimitive(tinygltf::Primitive& primitive)
+{
+	primitive.mode = TINYGLTF_MODE_TRIANGLES;
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "attributes") ForEachMember([&](const std::string_view attribute) { primitive.attributes[std::string(attribute)] = ReadInt(); });
+			else if (key == "indices") primitive.indices = ReadInt();
+			else if (key == "material") primitive.material = ReadInt();
+			else if (key == "mode") primitive.mode = ReadInt();
+			else if (key == "targets")
+			{
+				ForEachElement([&]()
+					{
+						primitive.targets.emplace_back();
+						ForEachMember([&](const std::string_view attribute) { primitive.targets.back()[std::string(attribute)] = ReadInt(); });
+					});
+			}
+			else SkipValue();
+		});
+}
+
+void GLTFJsonReader::ReadAccessor(tinygltf::Accessor& accessor)
+{
+	bool hasCount = false;
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "bufferView") accessor.bufferView = ReadInt();
+			else if (key == "byteOffset") accessor.byteOffset = ReadSize();
+			else if (key == "componentType") accessor.componentType = ReadInt();
+			else if (key == "count") { accessor.count = ReadSize(); hasCount = true; }
+			else if (key == "type")
+			{
+				accessor.type = AccessorType(ReadString());
+				if (accessor.type == -1) Fail("Invalid accessor type");
+			}
+			else if (key == "normalized") accessor.normalized = ReadBool();
+			else if (key == "min") ReadNumbers(accessor.minValues);
+			else if (key == "max") ReadNumbers(accessor.maxValues);
+			else if (key == "name") accessor.name = ReadString();
+			else SkipValue();
+		});
+	if (accessor.componentType == -1 || accessor.type == -1 || !hasCount) Fail("The accessor componentType, count and type are required");
+}
+
+void GLTFJsonReader::ReadBufferView(tinygltf::BufferView& bufferView)
+{
+	bool hasByteLength = false;
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "buffer") bufferView.buffer = ReadInt();
+			else if (key == "byteOffset") bufferView.byteOffset = ReadSize();
+			else if (key == "byteLength") { bufferView.byteLength = ReadSize(); hasByteLength = true; }
+			else if (key == "byteStride")
+			{
+				bufferView.byteStride = ReadSize();
+				if (bufferView.byteStride > 252 || bufferView.byteStride % 4 != 0) Fail("The buffer view byteStride must be a multiple of 4 up to 252");
+			}
+			else if (key == "target") bufferView.target = ReadInt();
+			else if (key == "name") bufferView.name = ReadString();
+			else SkipValue();
+		});
+	if (bufferView.buffer == -1 || !hasByteLength) Fail("The buffer view buffer and byteLength are required");
+}
+
+void GLTFJsonReader::ReadBuffer(tinygltf::Buffer& buffer, size_t& byteLength)
+{
+	bool hasByteLength = false;
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "byteLength") { byteLength = ReadSize(); hasByteLength = true; }
+			else if (key == "uri") buffer.uri = ReadString();
+			else if (key == "name") buffer.name = ReadString();
+			else SkipValue();
+		});
+	if (!hasByteLength) Fail("The buffer byteLength is required");
+}
+
+void GLTFJsonReader::ReadImage(tinygltf::Image& image)
+{
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "uri") image.uri = ReadString();
+			else if (key == "bufferView") image.bufferView = ReadInt();
+			else if (key == "mimeType") image.mimeType = ReadString();
+			else if (key == "name") image.name = ReadString();
+			else SkipValue();
+		});
+}
+
+void GLTFJsonReader::ReadTexture(tinygltf::Texture& texture)
+{
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "source") texture.source = ReadInt();
+			else if (key == "sampler") texture.sampler = ReadInt();
+			else if (key == "name") texture.name = ReadString();
+			else SkipValue();
+		});
+}
+
+void GLTFJsonReader::ReadSampler(tinygltf::Sampler& sampler)
+{
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "minFilter") sampler.minFilter = ReadInt();
+			else if (key == "magFilter") sampler.magFilter = ReadInt();
+			else if (key == "wrapS") sampler.wrapS = ReadInt();
+			else if (key == "wrapT") sampler.wrapT = ReadInt();
+			else if (key == "wrapR") sampler.wrapR = ReadInt();
+			else if (key == "name") sampler.name = ReadString();
+			else SkipValue();
+		});
+}
+
+void GLTFJsonReader::ReadMaterial(tinygltf::Material& material)
+{
+	material.emissiveFactor = { 0.0, 0.0, 0.0 };
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "name") material.name = ReadString();
+			else if (key == "pbrMetallicRoughness") ReadPbrMetallicRoughness(material.pbrMetallicRoughness);
+			else if (key == "normalTexture") ReadNormalTextureInfo(material.normalTexture);
+			else if (key == "occlusionTexture") ReadOcclusionTextureInfo(material.occlusionTexture);
+			else if (key == "emissiveTexture") ReadTextureInfo(material.emissiveTexture);
+			else if (key == "emissiveFactor")
+			{
+				ReadNumbers(material.emissiveFactor);
+				if (material.emissiveFactor.size() != 3) Fail("The material emissiveFactor must have 3 components");
+			}
+			else if (key == "alphaMode") material.alphaMode = ReadString();
+			else if (key == "alphaCutoff") material.alphaCutoff = ReadNumber();
+			else if (key == "doubleSided") material.doubleSided = ReadBool();
+			else SkipValue();
+		});
+}
+
+void GLTFJsonReader::ReadTextureInfo(tinygltf::TextureInfo& textureInfo)
+{
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "index") textureInfo.index = ReadInt();
+			else if (key == "texCoord") textureInfo.texCoord = ReadInt();
+			else SkipValue();
+		});
+}
+
+void GLTFJsonReader::ReadNormalTextureInfo(tinygltf::NormalTextureInfo& textureInfo)
+{
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "index") textureInfo.index = ReadInt();
+			else if (key == "texCoord") textureInfo.texCoord = ReadInt();
+			else if (key == "scale") textureInfo.scale = ReadNumber();
+			else SkipValue();
+		});
+}
+
+void GLTFJsonReader::ReadOcclusionTextureInfo(tinygltf::OcclusionTextureInfo& textureInfo)
+{
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "index") textureInfo.index = ReadInt();
+			else if (key == "texCoord") textureInfo.texCoord = ReadInt();
+			else if (key == "strength") textureInfo.strength = ReadNumber();
+			else SkipValue();
+		});
+}
+
+void GLTFJsonReader::ReadPbrMetallicRoughness(tinygltf::PbrMetallicRoughness& pbr)
+{
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "baseColorFactor")
+			{
+				ReadNumbers(pbr.baseColorFactor);
+				if (pbr.baseColorFactor.size() != 4) Fail("The material baseColorFactor must have 4 components");
+			}
+			else if (key == "metallicFactor") pbr.metallicFactor = ReadNumber();
+			else if (key == "roughnessFactor") pbr.roughnessFactor = ReadNumber();
+			else if (key == "baseColorTexture") ReadTextureInfo(pbr.baseColorTexture);
+			else if (key == "metallicRoughnessTexture") ReadTextureInfo(pbr.metallicRoughnessTexture);
+			else SkipValue();
+		});
+}
+
+void GLTFJsonReader::ReadRootExtensions(tinygltf::Model& model)
+{
+	ForEachMember([&](const std::string_view extension)
+		{
+			if (extension != "KHR_lights_punctual") { SkipValue(); return; }
+			ForEachMember([&](const std::string_view key)
+				{
+					if (key == "lights") ReadObjects(model.lights, &GLTFJsonReader::ReadLight);
+					else SkipValue();
+				});
+		});
+}
+
+void GLTFJsonReader::ReadLight(tinygltf::Light& light)
+{
+	ForEachMember([&](const std::string_view key)
+		{
+			if (key == "type") light.type = ReadString();
+			else if (key == "name") light.name = ReadString();
+			else if (key == "color") ReadNumbers(light.color);
+			else if (key == "intensity") light.intensity = ReadNumber();
+			else if (key == "range") light.range = ReadNumber();
+			else if (key == "spot")
+			{
+				ForEachMember([&](const std::string_view spotKey)
+					{
+						if (spotKey == "innerConeAngle") light.spot.innerConeAngle = ReadNumber();
+						else if (spotKey == "outerConeAngle") light.spot.outerConeAngle = ReadNumber();
+						else SkipValue();
+					});
+			}
+			else SkipValue();
+		});
+	if (light.type.empty()) Fail("The light type is required");
+}
@@ -0,0 +1,356 @@
+#include "Benchmark.h"
+#include "GLTFJsonReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+
+namespace
+{
+	const std::vector<std::string> DEFAULT_GLTF_PATHS = { "models" };
+	const std::vector<size_t> SYNTHETIC_NODES_COUNTS = { 10000, 100000 };
+	constexpr int GLTF_PARSE_REPETITIONS = 5;
+
+	// Images are decoded by the viewer from their buffer view or file, tinygltf only has to describe them as the reader does
+	bool SkipImageData(tinygltf::Image*, const int, std::string*, std::string*, int, int, const unsigned char*, int, void*)
+	{
+		return true;
+	}
+
+	bool LoadWithTinyGLTF(const std::vector<uint8_t>& data, const bool isBinary, const std::string& baseDir, tinygltf::Model& model, std::string& err)
+	{
+		tinygltf::TinyGLTF loader;
+		loader.SetImageLoader(&SkipImageData, nullptr);
+		std::string warn;
+		if (isBinary) return loader.LoadBinaryFromMemory(&model, &err, &warn, data.data(), static_cast<unsigned int>(data.size()), baseDir);
+		return loader.LoadASCIIFromString(&model, &err, &warn, reinterpret_cast<const char*>(data.data()), static_cast<unsigned int>(data.size()), baseDir);
+	}
+
+	/** Compare the fields that GLTFJsonReader fills, the first difference found is recorded with its path in the model */
+	class ModelComparer
+	{
+	public:
+		bool Compare(const tinygltf::Model& expected, const tinygltf::Model& actual, const std::vector<size_t>& buffersByteLength)
+		{
+			Field("asset.version", expected.asset.version, actual.asset.version);
+			Field("asset.minVersion", expected.asset.minVersion, actual.asset.minVersion);
+			Field("scene", expected.defaultScene, actual.defaultScene);
+			Objects("scenes", expected.scenes, actual.scenes, [this](const std::string& path, const tinygltf::Scene& e, const tinygltf::Scene& a)
+				{
+					Field(path + ".name", e.name, a.name);
+					Field(path + ".nodes", e.nodes, a.nodes);
+				});
+			Objects("nodes", expected.nodes, actual.nodes, [this](const std::string& path, const tinygltf::Node& e, const tinygltf::Node& a)
+				{
+					Field(path + ".name", e.name, a.name);
+					Field(path + ".mesh", e.mesh, a.mesh);
+					Field(path + ".children", e.children, a.children);
+					Field(path + ".matrix", e.matrix, a.matrix);
+					Field(path + ".rotation", e.rotation, a.rotation);
+					Field(path + ".scale", e.scale, a.scale);
+					Field(path + ".translation", e.translation, a.translation);
+				});
+			Objects("meshes", expected.meshes, actual.meshes, [this](const std::string& path, const tinygltf::Mesh& e, const tinygltf::Mesh& a)
+				{
+					Field(path + ".name", e.name, a.name);
+					Objects(path + ".primitives", e.primitives, a.primitives, [this](const std::string& path, const tinygltf::Primitive& e, const tinygltf::Primitive& a)
+						{
+							Field(path + ".attributes", e.attributes, a.attributes);
+							Field(path + ".indices", e.indices, a.indices);
+							Field(path + ".material", e.material, a.material);
+							Field(path + ".mode", e.mode, a.mode);
+							Field(path + ".targets", e.targets, a.targets);
+						});
+				});
+			Objects("accessors", expected.accessors, actual.accessors, [this](const std::string& path, const tinygltf::Accessor& e, const tinygltf::Accessor& a)
+				{
+					Field(path + ".bufferView", e.bufferView, a.bufferView);
+					Field(path + ".byteOffset", e.byteOffset, a.byteOffset);
+					Field(path + ".componentType", e.componentType, a.componentType);
+					Field(path + ".count", e.count, a.count);
+					Field(path + ".type", e.type, a.type);
+					Field(path + ".normalized", e.normalized, a.normalized);
+					Field(path + ".min", e.minValues, a.minValues);
+					Field(path + ".max", e.maxValues, a.maxValues);
+				});
+			Objects("bufferViews", expected.bufferViews, actual.bufferViews, [this](const std::string& path, const tinygltf::BufferView& e, const tinygltf::BufferView& a)
+				{
+					Field(path + ".buffer", e.buffer, a.buffer);
+					Field(path + ".byteOffset", e.byteOffset, a.byteOffset);
+					Field(path + ".byteLength", e.byteLength, a.byteLength);
+					Field(path + ".byteStride", e.byteStride, a.byteStride);
+					Field(path + ".target", e.target, a.target);
+				});
+			Objects("buffers", expected.buffers, actual.buffers, [this](const std::string& path, const tinygltf::Buffer& e, const tinygltf::Buffer& a)
+				{
+					Field(path + ".uri", e.uri, a.uri);
+				});
+			for (size_t i = 0; i < expected.buffers.size() && i < buffersByteLength.size(); i++)
+			{
+				Field("buffers[" + std::to_string(i) + "].byteLength", expected.buffers[i].data.size(), buffersByteLength[i]);
+			}
+			Objects("images", expected.images, actual.images, [this](const std::string& path, const tinygltf::Image& e, const tinygltf::Image& a)
+				{
+					Field(path + ".uri", e.uri, a.uri);
+					Field(path + ".bufferView", e.bufferView, a.bufferView);
+					Field(path + ".mimeType", e.mimeType, a.mimeType);
+				});
+			Objects("textures", expected.textures, actual.textures, [this](const std::string& path, const tinygltf::Texture& e, const tinygltf::Texture& a)
+				{
+					Field(path + ".source", e.source, a.source);
+					Field(path + ".sampler", e.sampler, a.sampler);
+				});
+			Objects("samplers", expected.samplers, actual.samplers, [this](const std::string& path, const tinygltf::Sampler& e, const tinygltf::Sampler& a)
+				{
+					Field(path + ".minFilter", e.minFilter, a.minFilter);
+					Field(path + ".magFilter", e.magFilter, a.magFilter);
+					Field(path + ".wrapS", e.wrapS, a.wrapS);
+					Field(path + ".wrapT", e.wrapT, a.wrapT);
+					Field(path + ".wrapR", e.wrapR, a.wrapR);
+				});
+			Objects("materials", expected.materials, actual.materials, [this](const std::string& path, const tinygltf::Material& e, const tinygltf::Material& a)
+				{
+					Field(path + ".name", e.name, a.name);
+					Field(path + ".emissiveFactor", e.emissiveFactor, a.emissiveFactor);
+					Field(path + ".alphaMode", e.alphaMode, a.alphaMode);
+					Field(path + ".alphaCutoff", e.alphaCutoff, a.alphaCutoff);
+					Field(path + ".doubleSided", e.doubleSided, a.doubleSided);
+					Field(path + ".pbrMetallicRoughness", e.pbrMetallicRoughness, a.pbrMetallicRoughness);
+					Field(path + ".normalTexture", e.normalTexture, a.normalTexture);
+					Field(path + ".occlusionTexture", e.occlusionTexture, a.occlusionTexture);
+					Field(path + ".emissiveTexture", e.emissiveTexture, a.emissiveTexture);
+				});
+			Objects("lights", expected.lights, actual.lights, [this](const std::string& path, const tinygltf::Light& e, const tinygltf::Light& a)
+				{
+					Field(path + ".type", e.type, a.type);
+					Field(path + ".color", e.color, a.color);
+					Field(path + ".intensity", e.intensity, a.intensity);
+					Field(path + ".range", e.range, a.range);
+					Field(path + ".spot", e.spot, a.spot);
+				});
+			return m_difference.empty();
+		}
+
+		const std::string& GetDifference() const { return m_difference; }
+
+	private:
+		template <class T>
+		void Field(const std::string& path, const T& expected, const T& actual)
+		{
+			if (m_difference.empty() && !(expected == actual)) m_difference = path;
+		}
+
+		template <class T, class F>
+		void Objects(const std::string& path, const std::vector<T>& expected, const std::vector<T>& actual, F&& compareObject)
+		{
+			if (!m_difference.empty()) return;
+			if (expected.size() != actual.size()) { m_difference = path + ".size"; return; }
+			for (size_t i = 0; i < expected.size(); i++) compareObject(path + "[" + std::to_string(i) + "]", expected[i], actual[i]);
+		}
+
+		std::string m_difference;
+	};
+
+	/** Parse every file with tinygltf and with GLTFJsonReader and check that the reader fills the same model */
+	bool RunParity(const std::vector<std::string>& fileNames)
+	{
+		bool isParity = true;
+		std::cout << "  \"parity\": [" << std::endl;
+		for (size_t f = 0; f < fileNames.size(); f++)
+		{
+			std::ifstream file(fileNames[f], std::ios::binary);
+			std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			bool isBinary = std::filesystem::path(fileNames[f]).extension() == ".glb";
+
+			std::string difference;
+			tinygltf::Model expected;
+			if (!LoadWithTinyGLTF(data, isBinary, std::filesystem::path(fileNames[f]).parent_path().string(), expected, difference))
+			{
+				difference = "tinygltf: " + difference;
+			}
+			else
+			{
+				try
+				{
+					GLBChunks chunks = { reinterpret_cast<const char*>(data.data()), data.size(), nullptr, 0 };
+					if (isBinary) chunks = GLTFJsonReader::ReadGLBChunks(data.data(), data.size());
+					GLTFJsonReader reader;
+					tinygltf::Model actual;
+					reader.Parse(chunks.json, chunks.jsonSize, actual);
+
+					ModelComparer comparer;
+					if (!comparer.Compare(expected, actual, reader.GetBuffersByteLength())) difference = comparer.GetDifference();
+				}
+				catch (const std::exception& e)
+				{
+					difference = std::string("reader: ") + e.what();
+				}
+			}
+
+			isParity &= difference.empty();
+			std::cout << "    { \"file\": \"" << Benchmark::EscapeJson(fileNames[f]) << "\", \"parity\": " << (difference.empty() ? "true" : "false")
+				<< ", \"difference\": \"" << Benchmark::EscapeJson(difference) << "\" }" << (f == fileNames.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]," << std::endl;
+		return isParity;
+	}
+
+	/** Write a glTF document with nodesCount nodes, each with its own mesh, accessor and transform, all sharing a tiny buffer */
+	std::string CreateSyntheticScene(const size_t nodesCount)
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<double> distribution(-100.0, 100.0);
+		std::ostringstream json;
+		json << std::setprecision(9);
+
+		json << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"gltf-parse-benchmark\"},\"scene\":0,\"scenes\":[{\"nodes\":[";
+		for (size_t i = 0; i < nodesCount; i++) json << (i ? "," : "") << i;
+		json << "]}],\"nodes\":[";
+		for (size_t i = 0; i < nodesCount; i++)
+		{
+			json << (i ? "," : "") << "{\"name\":\"node" << i << "\",\"mesh\":" << i
+				<< ",\"translation\":[" << distribution(random) << "," << distribution(random) << "," << distribution(random) << "]"
+				<< ",\"rotation\":[0.0,0.70710678,0.0,0.70710678],\"scale\":[1.5,1.5,1.5]}";
+		}
+		json << "],\"meshes\":[";
+		for (size_t i = 0; i < nodesCount; i++)
+		{
+			json << (i ? "," : "") << "{\"primitives\":[{\"attributes\":{\"POSITION\":" << i << "},\"material\":" << i % 16 << ",\"mode\":4}]}";
+		}
+		json << "],\"accessors\":[";
+		for (size_t i = 0; i < nodesCount; i++)
+		{
+			json << (i ? "," : "") << "{\"bufferView\":0,\"componentType\":5126,\"count\":1,\"type\":\"VEC3\""
+				<< ",\"min\":[" << distribution(random) << "," << distribution(random) << "," << distribution(random) << "]"
+				<< ",\"max\":[" << distribution(random) << "," << distribution(random) << "," << distribution(random) << "]}";
+		}
+		json << "],\"materials\":[";
+		for (size_t i = 0; i < 16; i++)
+		{
+			json << (i ? "," : "") << "{\"name\":\"material" << i << "\",\"pbrMetallicRoughness\":{\"baseColorFactor\":[0.8,0.2,0.1,1.0],\"metallicFactor\":0.25,\"roughnessFactor\":0.75}}";
+		}
+		json << "],\"bufferViews\":[{\"buffer\":0,\"byteLength\":12}],"
+			<< "\"buffers\":[{\"byteLength\":12,\"uri\":\"data:application/octet-stream;base64,AAAAAAAAAAAAAAAA\"}]}";
+		return json.str();
+	}
+
+	template <class F>
+	double MeasureMegaBytesPerSecond(const size_t byteSize, F&& parse)
+	{
+		std::vector<double> seconds;
+		for (int r = 0; r < GLTF_PARSE_REPETITIONS; r++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			parse();
+			seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(seconds.begin(), seconds.end());
+		return byteSize / (1024.0 * 1024.0) / seconds[seconds.size() / 2];
+	}
+
+	/** Compare the parse throughput of tinygltf, which builds a JSON DOM first, and of GLTFJsonReader on synthetic scenes, return their parity */
+	bool RunThroughput()
+	{
+		bool isParity = true;
+		std::cout << "  \"throughput\": [" << std::endl;
+		for (size_t s = 0; s < SYNTHETIC_NODES_COUNTS.size(); s++)
+		{
+			std::string json = CreateSyntheticScene(SYNTHETIC_NODES_COUNTS[s]);
+			std::vector<uint8_t> data(json.begin(), json.end());
+
+			tinygltf::Model expected, actual;
+			GLTFJsonReader reader;
+			double tinyGLTFMBps = MeasureMegaBytesPerSecond(json.size(), [&]()
+				{
+					std::string err;
+					expected = tinygltf::Model();
+					if (!LoadWithTinyGLTF(data, false, "", expected, err)) throw std::runtime_error("tinygltf: " + err);
+				});
+			double readerMBps = MeasureMegaBytesPerSecond(json.size(), [&]()
+				{
+					reader.Parse(json.data(), json.size(), actual);
+				});
+			ModelComparer comparer;
+			bool isSceneParity = comparer.Compare(expected, actual, reader.GetBuffersByteLength());
+			isParity &= isSceneParity;
+
+			std::cout << std::fixed << std::setprecision(3)
+				<< "    { \"nodes\": " << SYNTHETIC_NODES_COUNTS[s] << ", \"megaBytes\": " << json.size() / (1024.0 * 1024.0)
+				<< ", \"tinygltfMBps\": " << tinyGLTFMBps << ", \"readerMBps\": " << readerMBps
+				<< ", \"speedup\": " << readerMBps / tinyGLTFMBps << ", \"parity\": " << (isSceneParity ? "true" : "false") << " }" << (s == SYNTHETIC_NODES_COUNTS.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]" << std::endl;
+		return isParity;
+	}
+}
+
+namespace Benchmark
+{
+	std::vector<std::string> FindGLTFFiles(const std::vector<std::string>& paths)
+	{
+		std::vector<std::string> fileNames;
+		for (const std::string& path : paths)
+		{
+			if (!std::filesystem::is_directory(path)) { fileNames.push_back(path); continue; }
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(path))
+			{
+				std::string extension = entry.path().extension().string();
+				std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+				if (extension == ".gltf" || extension == ".glb") fileNames.push_back(entry.path().string());
+			}
+		}
+		std::sort(fileNames.begin(), fileNames.end());
+		return fileNames;
+	}
+
+	std::string EscapeJson(const std::string& text)
+	{
+		std::string escaped;
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\') escaped += '\\';
+			if (c == '\n') { escaped += "\\n"; continue; }
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	int RunGLTFParse(const std::vector<std::string>& args)
+	{
+		std::vector<std::string> fileNames = FindGLTFFiles(args.empty() ? DEFAULT_GLTF_PATHS : args);
+		if (fileNames.empty()) { std::cerr << "No glTF file found" << std::endl; return 1; }
+
+		std::cout << "{" << std::endl;
+		bool isParity = RunParity(fileNames);
+		isParity &= RunThroughput();
+		std::cout << "}" << std::endl;
+		return isParity ? 0 : 1;
+	}
+}
+
+#ifdef GLTF_PARSE_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "glTF/tiny_gltf.h"
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunGLTFParse({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
@@ -3,13 +3,38 @@
 #include "Material.h"
 #include "Mesh.h"
 #include "Scene.h"
+#include "ThreadPool.h"
+#include "GLTFJsonReader.h"
+#include "MeshNormals.h"
+#include "MeshTangents.h"
+#include "MeshStreams.h"
+#include "MeshOptimization.h"
+#include "MeshWelding.h"
+#include "MeshSimplification.h"
+#include "MeshTopology.h"
 #include <map>
+#include <algorithm>
 #include <cmath>
-#include <Pathcch.h>
-#include <atlstr.h>
+#include <numeric>
+#include <filesystem>
+#include <fstream>
 
 #include "using_directives.h"
 
+namespace
+{
+	std::vector<unsigned char> ReadWholeFile(const std::string& fileName)
+	{
+		std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+		if (!file) DXUtil::ThrowException("Cannot open " + fileName);
+		std::vector<unsigned char> data(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(data.data()), data.size());
+		if (!file) DXUtil::ThrowException("Cannot read " + fileName);
+		return data;
+	}
+}
+
 GLTFSceneLoader::GLTFSceneLoader(Microsoft::WRL::ComPtr<ID3D12Device> device, Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue)
 {
 	m_device = device;
@@ -18,29 +43,116 @@ GLTFSceneLoader::GLTFSceneLoader(Microsoft::WRL::ComPtr<ID3D12Device> device, Mi
 
 void GLTFSceneLoader::Load(const std::string& fileName)
 {
-	// Save the gltf file resources path
-	_tcscpy_s(m_gltfFilePath, CA2T(fileName.c_str()));		
-	PathCchRemoveFileSpec(m_gltfFilePath, MAX_PATH_SIZE);
+	// External resources are resolved relative to the glTF file
+	m_baseDir = std::filesystem::path(fileName).parent_path().string();
+
+	m_model = tinygltf::Model();
+	m_buffersData.clear();
+	m_mappedBuffers.clear();
+	m_mappedFile.reset();
 
-	std::string err, warn;
-	bool ret = false;
-	if(fileName.find(".glb") != std::string::npos)
+	bool isBinary = fileName.find(".glb") != std::string::npos;
+	if (!isBinary && fileName.find(".gltf") == std::string::npos) { DXUtil::ThrowException("Failed to load glTF file: unknown file extension"); }
+
+	// With memory mapping the BIN chunk is read in place, otherwise the file is only kept while it is parsed
+	std::vector<unsigned char> fileData;
+	ByteSpan file;
 	{
-		ret = m_glTFLoader.LoadBinaryFromFile(&m_model, &err, &warn, fileName.c_str());
+		ScopedPhase phase(m_profile, "file_io");
+		if (m_useMemoryMapping)
+		{
+			m_mappedFile = std::make_unique<MappedFile>(fileName);
+			file = m_mappedFile->GetData();
+		}
+		else
+		{
+			fileData = ReadWholeFile(fileName);
+			file = { fileData.data(), fileData.size() };
+		}
+		phase.AddBytes(file.size);
 	}
-	else if(fileName.find(".gltf") != std::string::npos)
+
+	GLBChunks chunks = { reinterpret_cast<const char*>(file.data), file.size, nullptr, 0 };
+	GLTFJsonReader jsonReader;
 	{
-		TCHAR currentPath[MAX_PATH_SIZE];
-		GetCurrentDirectory(MAX_PATH_SIZE, currentPath);
-		SetCurrentDirectory(m_gltfFilePath);	// Change director to the one that contains the glTF resources
-		ret = m_glTFLoader.LoadASCIIFromFile(&m_model, &err, &warn, fileName.c_str());
-		SetCurrentDirectory(currentPath);		// Change back to the previous working directory
+		ScopedPhase phase(m_profile, "json_parse");
+		if (isBinary) chunks = GLTFJsonReader::ReadGLBChunks(file.data, file.size);
+		jsonReader.Parse(chunks.json, chunks.jsonSize, m_model);
+		phase.AddBytes(chunks.jsonSize);
 	}
-
-	if (!warn.empty()) { DEBUG_LOG(warn.c_str()) }
-	if (!err.empty()) { DXUtil::ThrowException(err); }
-	if (!ret) { DXUtil::ThrowException("Failed to load glTF file"); }
 	if (!CheckMajorMinorVersion()) { DXUtil::ThrowException("Failed to load glTF file: version not supported"); }
+
+	// A buffer is the BIN chunk, a base64 data uri or an external file. Mapped buffers are read in place, the others are owned by the model
+	const std::vector<size_t>& buffersByteLength = jsonReader.GetBuffersByteLength();
+	m_buffersData.resize(m_model.buffers.size());
+	for (size_t i = 0; i < m_model.buffers.size(); i++)
+	{
+		CheckCancelled();
+		ScopedPhase phase(m_profile, "file_io", buffersByteLength[i]);
+		tinygltf::Buffer& buffer = m_model.buffers[i];
+		ByteSpan bufferData;
+		if (buffer.uri.empty())
+		{
+			if (chunks.bin == nullptr) { DXUtil::ThrowException("Buffer " + std::to_string(i) + " has no uri and no glTF binary chunk"); }
+			if (m_useMemoryMapping) bufferData = { chunks.bin, chunks.binSize };
+			else buffer.data.assign(chunks.bin, chunks.bin + chunks.binSize);
+		}
+		else if (!GLTFJsonReader::DecodeDataURI(buffer.uri, buffer.data))
+		{
+			if (m_useMemoryMapping)
+			{
+				m_mappedBuffers.push_back(std::make_unique<MappedFile>(ResolvePath(buffer.uri)));
+				bufferData = m_mappedBuffers.back()->GetData();
+			}
+			else buffer.data = ReadWholeFile(ResolvePath(buffer.uri));
+		}
+
+		if (bufferData.data == nullptr) bufferData = { buffer.data.data(), buffer.data.size() };
+		if (bufferData.size < buffersByteLength[i]) { DXUtil::ThrowException("Buffer " + std::to_string(i) + " is shorter than its byteLength"); }
+		m_buffersData[i] = { bufferData.data, buffersByteLength[i] };
+	}
+
+	CheckCancelled();
+	ScopedPhase phase(m_profile, "geometry_residency");
+	m_geometryResidency.Build(m_model);
+	phase.AddBytes(m_geometryResidency.GetResidentBytes());
+}
+
+const GeometryResidency& GLTFSceneLoader::GetGeometryResidency() const
+{
+	return m_geometryResidency;
+}
+
+size_t GLTFSceneLoader::GetPerPrimitiveUploadBytes() const
+{
+	size_t buffersBytes = 0;
+	for (const ByteSpan& bufferData : m_buffersData) buffersBytes += bufferData.size;
+	return buffersBytes * m_geometryResidency.GetPrimitivesCount();
+}
+
+void GLTFSceneLoader::SetMemoryMapping(const bool enabled)
+{
+	m_useMemoryMapping = enabled;
+}
+
+size_t GLTFSceneLoader::GetBuffersCount() const
+{
+	return m_buffersData.size();
+}
+
+ByteSpan GLTFSceneLoader::GetBufferData(const int bufferId) const
+{
+	if (bufferId < 0 || static_cast<size_t>(bufferId) >= m_buffersData.size()) { DXUtil::ThrowException("Buffer index out of range"); }
+	return m_buffersData[bufferId];
+}
+
+ByteSpan GLTFSceneLoader::GetBufferViewData(const int bufferViewId) const
+{
+	if (bufferViewId < 0 || static_cast<size_t>(bufferViewId) >= m_model.bufferViews.size()) { DXUtil::ThrowException("Buffer view index out of range"); }
+	const tinygltf::BufferView& bufferView = m_model.bufferViews[bufferViewId];
+	ByteSpan buffer = GetBufferData(bufferView.buffer);
+	if (bufferView.byteOffset + bufferView.byteLength > buffer.size) { DXUtil::ThrowException("Buffer view out of the buffer range"); }
+	return { buffer.data + bufferView.byteOffset, bufferView.byteLength };
 }
 
 bool GLTFSceneLoader::CheckMajorMinorVersion() const
@@ -59,82 +171,385 @@ void GLTFSceneLoader::GetScene(const int sceneId, std::shared_ptr<Scene>& scene)
 {	
 	if (sceneId >= m_model.scenes.size()) { DXUtil::ThrowException("Scene index out of range"); }
 
-	scene = std::make_shared<Scene>(m_device);
-	GPUHeapUploader gpuHeapUploader(m_device.Get(), m_commandQueue.Get());
+	{
+		ScopedPhase phase(m_profile, "scene_setup");
+		scene = std::make_shared<Scene>(m_device);
+		m_uploadBatch = std::make_unique<UploadBatch>(m_device, m_commandQueue);
+	}
+
+	// The scene descriptor heap has a fixed number of materials, textures and samplers, refuse the file before loading anything
+	if (m_model.materials.size() > scene->MATERIALS_N_DESCRIPTORS) { DXUtil::ThrowException("The scene has " + std::to_string(m_model.materials.size()) + " materials, at most " + std::to_string(scene->MATERIALS_N_DESCRIPTORS) + " are supported"); }
+	if (m_model.textures.size() > scene->TEXTURES_N_DESCRIPTORS) { DXUtil::ThrowException("The scene has " + std::to_string(m_model.textures.size()) + " textures, at most " + std::to_string(scene->TEXTURES_N_DESCRIPTORS) + " are supported"); }
+	if (m_model.samplers.size() > scene->SAMPLERS_N_DESCRIPTORS) { DXUtil::ThrowException("The scene has " + std::to_string(m_model.samplers.size()) + " samplers, at most " + std::to_string(scene->SAMPLERS_N_DESCRIPTORS) + " are supported"); }
 
-	// Change director to the one that contains the glTF resources
-	TCHAR currentPath[MAX_PATH_SIZE];
-	GetCurrentDirectory(MAX_PATH_SIZE, currentPath);
-	SetCurrentDirectory(m_gltfFilePath);
+	if (m_progress)
+	{
+		size_t bytesTotal = m_geometryResidency.GetResidentBytes();
+		for (const tinygltf::Image& image : m_model.images) bytesTotal += GetImageByteSize(image);
+		m_progress->bytesTotal = bytesTotal;
+		m_progress->objectsTotal = m_model.meshes.size() + m_model.images.size();
+	}
 		
-	ParseSceneGraph(sceneId, scene.get());
-	LoadMeshes(scene.get());
-	LoadLights(scene.get());
-	LoadMaterials(scene.get());
+	{
+		ScopedPhase phase(m_profile, "scene_graph");
+		ParseSceneGraph(sceneId, scene.get());
+	}
+	{
+		ScopedPhase phase(m_profile, "meshes", m_geometryResidency.GetResidentBytes());
+		LoadMeshes(scene.get());
+	}
+	{
+		ScopedPhase phase(m_profile, "materials");
+		LoadLights(scene.get());
+		LoadMaterials(scene.get());
+	}
 	LoadTextures(scene.get());
-	LoadSamplers(scene.get());
+	{
+		ScopedPhase phase(m_profile, "samplers");
+		LoadSamplers(scene.get());
+	}
+
+	// All the scene buffers are copied to the GPU with a single submission
+	CheckCancelled();
+	{
+		ScopedPhase phase(m_profile, "gpu_upload", m_uploadBatch->GetPendingBytes());
+		m_uploadBatch->Submit();
+	}
+	m_uploadBatch.reset();
+	m_decodedTextures.clear();
+	ReportProgress(m_geometryResidency.GetResidentBytes(), 0);
 	scene->m_isInitialized = true;
-	
-	// Change back to the previous working directory
-	SetCurrentDirectory(currentPath);
 }
 
-void GLTFSceneLoader::ParseSceneGraph(const int sceneId, Scene* scene)
+void GLTFSceneLoader::SetProgress(LoadingProgress* progress)
 {
-	for (int childId : m_model.scenes[sceneId].nodes) { scene->m_sceneTree.push_back(ParseSceneNode(childId)); }
-};
+	m_progress = progress;
+}
+
+void GLTFSceneLoader::SetProfile(LoadProfile* profile)
+{
+	m_profile = profile;
+}
+
+void GLTFSceneLoader::SetNormalWeighting(const NormalWeighting weighting)
+{
+	m_normalWeighting = weighting;
+}
+
+void GLTFSceneLoader::SetTopologyNormalization(const bool enabled, const TopologyOptions& options)
+{
+	m_normalizeTopology = enabled;
+	m_topologyOptions = options;
+}
 
-std::unique_ptr<SceneNode> GLTFSceneLoader::ParseSceneNode(const int nodeId)
+const TopologyReport& GLTFSceneLoader::GetTopologyReport() const
 {
-	tinygltf::Node currentNode = m_model.nodes[nodeId];
+	return m_topologyReport;
+}
 
-	std::unique_ptr<SceneNode> sceneNode = std::make_unique<SceneNode>();
-	sceneNode->meshId = currentNode.mesh;
+void GLTFSceneLoader::SetMeshOptimization(const bool enabled, const MeshOptimizationOptions& options)
+{
+	m_optimizeMeshes = enabled;
+	m_meshOptimizationOptions = options;
+}
 
-	// Load node transformations
-	XMMATRIX M, T, R, S;
-	M = T = R = S = DirectX::XMMatrixIdentity();
+const MeshOptimizationReport& GLTFSceneLoader::GetMeshOptimizationReport() const
+{
+	return m_meshOptimizationReport;
+}
 
-	std::vector<double> t = currentNode.translation;
-	std::vector<double> r = currentNode.rotation;
-	std::vector<double> s = currentNode.scale;
+void GLTFSceneLoader::SetVertexWelding(const bool enabled, const VertexWeldOptions& options)
+{
+	m_weldVertices = enabled;
+	m_vertexWeldOptions = options;
+}
 
-	// Compute the composed transform: Scale, then Rotate, than Translate
-	if (!t.empty()) { T = XMMatrixTranslation(static_cast<float>(t[0]), static_cast<float>(t[1]), static_cast<float>(t[2])); }
-	if (!r.empty()) { R = XMMatrixRotationQuaternion(XMLoadFloat4(&XMFLOAT4(static_cast<float>(r[0]), static_cast<float>(r[1]), static_cast<float>(r[2]), static_cast<float>(r[3])))); }
-	if (!s.empty()) { S = XMMatrixScaling(static_cast<float>(s[0]), static_cast<float>(s[1]), static_cast<float>(s[2])); }
-	M = XMMatrixMultiply(S, XMMatrixMultiply(R, T));
+const VertexWeldReport& GLTFSceneLoader::GetVertexWeldReport() const
+{
+	return m_vertexWeldReport;
+}
 
-	// Check if the transform is already specified with one matrix
+void GLTFSceneLoader::SetLodGeneration(const bool enabled, const SimplificationOptions& options)
+{
+	m_generateLods = enabled;
+	m_simplificationOptions = options;
+}
+
+const SimplificationReport& GLTFSceneLoader::GetSimplificationReport() const
+{
+	return m_simplificationReport;
+}
+
+void GLTFSceneLoader::SetMeshletGeneration(const bool enabled, const MeshletOptions& options)
+{
+	m_buildMeshlets = enabled;
+	m_meshletOptions = options;
+}
+
+const MeshletReport& GLTFSceneLoader::GetMeshletReport() const
+{
+	return m_meshletReport;
+}
+
+void GLTFSceneLoader::SetBVHGeneration(const bool enabled, const BVHOptions& options)
+{
+	m_buildBVH = enabled;
+	m_bvhOptions = options;
+}
+
+const BVHReport& GLTFSceneLoader::GetBVHReport() const
+{
+	return m_bvhReport;
+}
+
+void GLTFSceneLoader::SetVertexLayout(const VertexLayout& layout)
+{
+	m_vertexLayout = layout;
+}
+
+const VertexQuantizationReport& GLTFSceneLoader::GetVertexQuantizationReport() const
+{
+	return m_vertexQuantizationReport;
+}
+
+bool GLTFSceneLoader::IsCancelled() const
+{
+	return m_progress != nullptr && m_progress->isCancelled;
+}
+
+void GLTFSceneLoader::CheckCancelled() const
+{
+	if (IsCancelled()) DXUtil::ThrowException("Loading cancelled");
+}
+
+void GLTFSceneLoader::ReportProgress(const size_t bytesDone, const size_t objectsDone)
+{
+	if (m_progress == nullptr) return;
+	m_progress->bytesDone += bytesDone;
+	m_progress->objectsDone += objectsDone;
+}
+
+std::string GLTFSceneLoader::ResolvePath(const std::string& uri) const
+{
+	std::filesystem::path path(uri);
+	if (path.is_absolute()) return uri;
+	return (std::filesystem::path(m_baseDir) / path).string();
+}
+
+void GLTFSceneLoader::ParseSceneGraph(const int sceneId, Scene* scene)
+{
+	for (int childId : m_model.scenes[sceneId].nodes) { ParseSceneNode(childId, -1, scene); }
+};
+
+void GLTFSceneLoader::ParseSceneNode(const int nodeId, const int parentId, Scene* scene)
+{
+	const tinygltf::Node& currentNode = m_model.nodes[nodeId];
+	size_t sceneNodeId = scene->AddNode(parentId, currentNode.mesh);
+
+	// Check if the transform is specified with one matrix, else it is composed: Scale, then Rotate, than Translate
 	if (!currentNode.matrix.empty())
 	{
 		DirectX::XMFLOAT4X4 m;
 		for (size_t i = 0; i < 4; i++) for (size_t j = 0; j < 4; j++) { m(i, j) = static_cast<float>(currentNode.matrix[4 * i + j]); }
-		M = DirectX::XMLoadFloat4x4(&m);
+		scene->SetNodeMatrix(sceneNodeId, m);
+	}
+	else
+	{
+		LocalTransform transform;
+		for (size_t k = 0; k < currentNode.translation.size() && k < 3; k++) { transform.translation[k] = static_cast<float>(currentNode.translation[k]); }
+		for (size_t k = 0; k < currentNode.rotation.size() && k < 4; k++) { transform.rotation[k] = static_cast<float>(currentNode.rotation[k]); }
+		for (size_t k = 0; k < currentNode.scale.size() && k < 3; k++) { transform.scale[k] = static_cast<float>(currentNode.scale[k]); }
+		scene->SetNodeTransform(sceneNodeId, transform);
 	}
-	
-	DirectX::XMStoreFloat4x4(&sceneNode->transformMtx, M);
-
-	for (int childId : currentNode.children) { sceneNode->children.push_back(ParseSceneNode(childId)); }
 
-	return sceneNode;
+	for (int childId : currentNode.children) { ParseSceneNode(childId, static_cast<int>(sceneNodeId), scene); }
 };
 
+AccessorDesc GLTFSceneLoader::GetAccessorDesc(const int accessorId) const
+{
+	if (accessorId < 0 || static_cast<size_t>(accessorId) >= m_model.accessors.size()) { DXUtil::ThrowException("Accessor index out of range"); }
+	const tinygltf::Accessor& accessor = m_model.accessors[accessorId];
+	if (accessor.bufferView == -1) { DXUtil::ThrowException("Accessors without a buffer view are not supported"); }
+	ByteSpan bufferView = GetBufferViewData(accessor.bufferView);
+
+	AccessorDesc desc;
+	desc.count = accessor.count;
+	desc.byteStride = m_model.bufferViews[accessor.bufferView].byteStride;
+	desc.componentType = accessor.componentType;
+	desc.elementsCount = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+	desc.normalized = accessor.normalized;
+	if (desc.GetElementSize() == 0) { DXUtil::ThrowException("Accessor " + std::to_string(accessorId) + " has an unknown type"); }
+	if (accessor.byteOffset + desc.GetByteLength() > bufferView.size) { DXUtil::ThrowException("Accessor " + std::to_string(accessorId) + " out of the buffer view range"); }
+	desc.data = bufferView.data + accessor.byteOffset;
+	return desc;
+}
+
+template <class T>
+std::vector<T> GLTFSceneLoader::ReadAttribute(const int accessorId) const
+{
+	AccessorDesc accessor = GetAccessorDesc(accessorId);
+	if (accessor.elementsCount * sizeof(float) != sizeof(T)) { DXUtil::ThrowException("Accessor " + std::to_string(accessorId) + " has an unexpected type"); }
+	std::vector<T> elements(accessor.count);
+	ReadAccessorFloats(accessor, reinterpret_cast<float*>(elements.data()));
+	return elements;
+}
+
+BoundingBox GLTFSceneLoader::ReadPositionBounds(const int accessorId) const
+{
+	AccessorDesc desc = GetAccessorDesc(accessorId);
+	if (desc.elementsCount != 3) { DXUtil::ThrowException("Accessor " + std::to_string(accessorId) + " has an unexpected type"); }
+
+	// glTF requires the min and max of the positions accessors, they are trusted for the float positions only
+	const tinygltf::Accessor& accessor = m_model.accessors[accessorId];
+	if (desc.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT)
+	{
+		std::vector<XMFLOAT3> positions = ReadAttribute<XMFLOAT3>(accessorId);
+		return ComputeBoundingBox(reinterpret_cast<const float*>(positions.data()), positions.size());
+	}
+	if (accessor.minValues.size() == 3 && accessor.maxValues.size() == 3 && desc.count > 0)
+	{
+		BoundingBox box;
+		for (int k = 0; k < 3; k++)
+		{
+			box.min[k] = static_cast<float>(accessor.minValues[k]);
+			box.max[k] = static_cast<float>(accessor.maxValues[k]);
+		}
+		if (!box.IsEmpty()) return box;
+	}
+	return ComputeBoundingBox(reinterpret_cast<const float*>(desc.data), desc.count, desc.byteStride);
+}
+
+std::vector<uint32_t> GLTFSceneLoader::ReadIndices(const int accessorId) const
+{
+	AccessorDesc accessor = GetAccessorDesc(accessorId);
+	std::vector<uint32_t> indices(accessor.count);
+	ReadAccessorUInt32(accessor, indices.data());
+	return indices;
+}
+
+PrimitiveTopology GLTFSceneLoader::ReadPrimitiveTopology(tinygltf::Primitive primitive, const bool withPositions) const
+{
+	PrimitiveTopology topology;
+	topology.mode = static_cast<PrimitiveMode>(primitive.mode);
+	topology.verticesCount = GetAccessorDesc(primitive.attributes["POSITION"]).count;
+	if (primitive.indices != -1) topology.indices = ReadIndices(primitive.indices);
+	if (withPositions)
+	{
+		std::vector<XMFLOAT3> positions = ReadAttribute<XMFLOAT3>(primitive.attributes["POSITION"]);
+		topology.positions.resize(3 * positions.size());
+		if (!positions.empty()) std::memcpy(topology.positions.data(), positions.data(), topology.positions.size() * sizeof(float));
+	}
+	return topology;
+}
+
+void GLTFSceneLoader::SetResidentView(Scene* scene, const int accessorId, BufferView& view)
+{
+	AccessorDesc accessor = GetAccessorDesc(accessorId);
+	const tinygltf::BufferView& bufferView = m_model.bufferViews[m_model.accessors[accessorId].bufferView];
+	size_t byteOffset = bufferView.byteOffset + m_model.accessors[accessorId].byteOffset; // Accessors defines an additional offset
+
+	int rangeId = m_geometryResidency.FindRange(bufferView.buffer, byteOffset);
+	if (rangeId == -1) DXUtil::ThrowException("Buffer view is not resident on the GPU");
+	if (m_rangesGPUBufferId[rangeId] == -1)
+	{
+		// The range is uploaded with its first view, the ranges of primitives uploaded in their own buffers never are
+		const GeometryRange& range = m_geometryResidency.GetRanges()[rangeId];
+		m_rangesGPUBufferId[rangeId] = AddSceneBuffer(scene, GetBufferData(range.bufferId).data + range.byteOffset, range.byteLength);
+		m_uploadedRangesCount++;
+		m_uploadedRangesBytes += range.byteLength;
+	}
+	view.bufferId = m_rangesGPUBufferId[rangeId];
+	view.byteOffset = byteOffset - m_geometryResidency.GetRanges()[rangeId].byteOffset;
+	view.byteLength = accessor.GetByteLength();
+	view.byteStride = accessor.byteStride;
+	view.count = accessor.count;
+}
+
+void GLTFSceneLoader::SetAttributeView(Scene* scene, const int accessorId, const uint8_t elemType, BufferView& view)
+{
+	AccessorDesc accessor = GetAccessorDesc(accessorId);
+	if (accessor.elementsCount != elemType) { DXUtil::ThrowException("Accessor " + std::to_string(accessorId) + " has an unexpected type"); }
+	view.elemType = elemType;
+	view.componentType = BUFFER_ELEM_TYPE_FLOAT;
+
+	if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+	{
+		SetResidentView(scene, accessorId, view);
+		return;
+	}
+
+	// The input layout reads float attributes: normalized and integer attributes are converted once, before the upload
+	std::vector<uint8_t> data(accessor.count * accessor.elementsCount * sizeof(float));
+	ReadAccessorFloats(accessor, reinterpret_cast<float*>(data.data()));
+	view.byteOffset = 0;
+	view.byteLength = data.size();
+	view.byteStride = 0;	// Tighly packed
+	view.count = accessor.count;
+	view.bufferId = AddSceneBuffer(scene, std::move(data));
+}
+
 void GLTFSceneLoader::LoadMeshes(Scene* scene)
 {
-	GPUHeapUploader gpuHeapUploader(m_device.Get(), m_commandQueue.Get());
-	
-	int meshId = 0;
-	for (tinygltf::Mesh& mesh : m_model.meshes)
+	// Each geometry range is uploaded once, by the first submesh that reads it in place, and shared by the others
+	m_rangesGPUBufferId.assign(m_geometryResidency.GetRanges().size(), -1);
+	m_uploadedRangesCount = 0;
+	m_uploadedRangesBytes = 0;
+
+	m_topologyReport = TopologyReport();
+	m_meshOptimizationReport = MeshOptimizationReport();
+	m_vertexWeldReport = VertexWeldReport();
+	m_simplificationReport = SimplificationReport();
+	m_meshletReport = MeshletReport();
+	m_bvhReport = BVHReport();
+	m_vertexQuantizationReport = VertexQuantizationReport();
+	scene->m_vertexLayout = m_vertexLayout;
+
+	// The topologies of the primitives are normalized at once, on the pool threads. Without the normalization only the modes
+	// that Direct3D cannot draw are converted
+	const TopologyOptions topologyOptions = m_normalizeTopology ? m_topologyOptions : TopologyOptions{ false, false, false, false };
+	std::vector<PrimitiveTopology> topologies;
+	std::vector<std::vector<int>> primitiveTopologies(m_model.meshes.size());	// The topology of each primitive, -1 if it is read as it is
+	size_t topologiesBytes = 0;
+	for (size_t meshId = 0; meshId < m_model.meshes.size(); meshId++)
 	{
-		Mesh m;
-		m.SetId(meshId++);
-		m.SetModelMtx(DXUtil::IdentityMtx());
-		m.SetNodeMtx(DXUtil::IdentityMtx());
+		for (const tinygltf::Primitive& primitive : m_model.meshes[meshId].primitives)
+		{
+			bool isNormalized = primitive.attributes.find("POSITION") != primitive.attributes.end() && primitive.mode >= TINYGLTF_MODE_POINTS
+				&& primitive.mode <= TINYGLTF_MODE_TRIANGLE_FAN && (m_normalizeTopology || primitive.mode != TINYGLTF_MODE_TRIANGLES);
+			primitiveTopologies[meshId].push_back(isNormalized ? static_cast<int>(topologies.size()) : -1);
+			if (!isNormalized) continue;
+
+			topologies.push_back(ReadPrimitiveTopology(primitive, topologyOptions.removeDegenerates));
+			topologiesBytes += topologies.back().indices.size() * sizeof(uint32_t);
+		}
+	}
+	if (!topologies.empty())
+	{
+		CheckCancelled();
+		ScopedPhase phase(m_profile, "topology", topologiesBytes);
+		m_topologyReport.Add(NormalizeTopologies(topologies, topologyOptions, ThreadPool::GetDefault()));
+		for (PrimitiveTopology& topology : topologies) std::vector<float>().swap(topology.positions);
+	}
+
+	// The submeshes are added to the scene once their meshlets and levels of detail are built, all the primitives at once
+	std::vector<std::vector<SubMesh>> subMeshes(m_model.meshes.size());
+	std::vector<MeshStreams> geometries;
+	std::vector<std::pair<size_t, size_t>> geometrySubMeshes;	// The mesh and the submesh of each geometry
+	std::vector<MeshStreams> bvhMeshes;	// The positions and the triangles of the hierarchies to build, in the order they are uploaded
+	std::vector<std::pair<size_t, size_t>> bvhSubMeshes;
+	for (size_t meshId = 0; meshId < m_model.meshes.size(); meshId++)
+	{
+		CheckCancelled();
 
 		// Create a submesh for each primitive
-		for (tinygltf::Primitive primitive : mesh.primitives)
+		size_t primitiveId = 0;
+		for (tinygltf::Primitive primitive : m_model.meshes[meshId].primitives)
 		{
+			const int topologyId = primitiveTopologies[meshId][primitiveId++];
+			PrimitiveTopology* topology = (topologyId != -1) ? &topologies[topologyId] : nullptr;
+			const int mode = topology ? static_cast<int>(topology->mode) : primitive.mode;
+			const bool isIndexed = topology ? !topology->indices.empty() : primitive.indices != -1;
+
 			SubMesh sm;
 			sm.verticesBufferView.bufferId = -1;
 			sm.colorsBufferView.bufferId = -1;
@@ -143,192 +558,279 @@ void GLTFSceneLoader::LoadMeshes(Scene* scene)
 			sm.texCoord0BufferView.bufferId = -1;
 			sm.texCoord1BufferView.bufferId = -1;
 
-			// Attribute (es. "POSITION") -> Accessors -> BufferView -> Buffer
+			// The bounds of all the positions, the welding and the topology normalization keep the vertices in them
 			if (primitive.attributes.find("POSITION") != primitive.attributes.end())
 			{
-				tinygltf::Accessor positionAccessor = m_model.accessors[primitive.attributes["POSITION"]];
-				tinygltf::BufferView positionsBV = m_model.bufferViews[positionAccessor.bufferView];
-				sm.verticesBufferView.bufferId = positionsBV.buffer;
-				sm.verticesBufferView.byteOffset = positionsBV.byteOffset + positionAccessor.byteOffset; // Accessors defines an additional offset
-				sm.verticesBufferView.byteStride = positionsBV.byteStride;
-				sm.verticesBufferView.count = positionAccessor.count;
-				sm.verticesBufferView.elemType = BUFFER_ELEM_VEC3;
-				sm.verticesBufferView.componentType = BUFFER_ELEM_TYPE_FLOAT;
-				sm.verticesBufferView.byteLength = positionAccessor.count * sizeof(XMFLOAT3);
-
-				DirectX::XMFLOAT3* vp = (DirectX::XMFLOAT3*)(m_model.buffers[0].data.data() + positionsBV.byteOffset);
-				for (int i = 0; i < sm.verticesBufferView.count; i++, vp++) 
-				{ 
-					// Compute the radius of the scene
-					if (abs(vp->x) > scene->m_sceneRadius.x) scene->m_sceneRadius.x = abs(vp->x);
-					if (abs(vp->y) > scene->m_sceneRadius.y) scene->m_sceneRadius.y = abs(vp->y);
-					if (abs(vp->z) > scene->m_sceneRadius.z) scene->m_sceneRadius.z = abs(vp->z);
-				}
+				sm.bounds = ReadPositionBounds(primitive.attributes["POSITION"]);
+				BoundingSphere sphere = GetBoundingSphere(sm.bounds);
+				sm.boundingSphere = { sphere.center[0], sphere.center[1], sphere.center[2], sphere.radius };
 			}
 
-			if (primitive.attributes.find("COLOR_0") != primitive.attributes.end())
+			// Compute normals if they are not specified into the file
+			std::vector<DirectX::XMFLOAT3> computedNormals;
+			if (primitive.attributes.find("NORMAL") == primitive.attributes.end() && primitive.attributes.find("POSITION") != primitive.attributes.end())
 			{
-				tinygltf::Accessor colorAccessor = m_model.accessors[primitive.attributes["COLOR"]];
-				tinygltf::BufferView colorBV = m_model.bufferViews[colorAccessor.bufferView];
-				sm.colorsBufferView.bufferId = colorBV.buffer;
-				sm.colorsBufferView.byteOffset = colorBV.byteOffset + colorAccessor.byteOffset; // Accessors defines an additional offset
-				sm.colorsBufferView.byteLength = colorBV.byteLength;
-				sm.colorsBufferView.byteStride = colorBV.byteStride;
-				sm.colorsBufferView.count = m_model.accessors[primitive.attributes["COLOR"]].count;
-
-				if (colorAccessor.type == TINYGLTF_TYPE_VEC3) sm.texCoord0BufferView.elemType = BUFFER_ELEM_VEC3;
-				if (colorAccessor.type == TINYGLTF_TYPE_VEC4) sm.texCoord0BufferView.elemType = BUFFER_ELEM_VEC4;
-				if (colorAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) sm.colorsBufferView.componentType = BUFFER_ELEM_TYPE_FLOAT;
-				if (colorAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) sm.colorsBufferView.componentType = BUFFER_ELEM_TYPE_UNSIGNED_CHAR;
-				if (colorAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) sm.colorsBufferView.componentType = BUFFER_ELEM_TYPE_UNSIGNED_SHORT;
+				ScopedPhase phase(m_profile, "normals", m_model.accessors[primitive.attributes["POSITION"]].count * sizeof(DirectX::XMFLOAT3));
+				computedNormals = ComputeNormals(primitive, topology);
 			}
 
-			if (primitive.attributes.find("NORMAL") != primitive.attributes.end())
+			// Compute tangents if they are not specified into the file, for the triangle lists with texture coords
+			VertexTangents computedTangents;
+			if (primitive.attributes.find("TANGENT") == primitive.attributes.end() && mode == TINYGLTF_MODE_TRIANGLES
+				&& primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end() && primitive.attributes.find("POSITION") != primitive.attributes.end())
 			{
-				tinygltf::Accessor normalAccessor = m_model.accessors[primitive.attributes["NORMAL"]];
-				tinygltf::BufferView normalsBV = m_model.bufferViews[normalAccessor.bufferView];
-				sm.normalsBufferView.bufferId = normalsBV.buffer;
-				sm.normalsBufferView.byteOffset = normalsBV.byteOffset + normalAccessor.byteOffset;
-				sm.normalsBufferView.byteLength = normalsBV.byteLength;
-				sm.normalsBufferView.byteStride = normalsBV.byteStride;
-				sm.normalsBufferView.count = normalAccessor.count;
-				sm.normalsBufferView.elemType = BUFFER_ELEM_VEC3;
-				sm.normalsBufferView.componentType = BUFFER_ELEM_TYPE_FLOAT;
+				ScopedPhase phase(m_profile, "tangents", m_model.accessors[primitive.attributes["POSITION"]].count * sizeof(DirectX::XMFLOAT4));
+				computedTangents = ComputeTangents(primitive, topology, computedNormals);
 			}
 
-			if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end())
+			// The primitives whose vertices are split by the tangents, welded or reordered by the optimization are rebuilt from copies of their attributes
+			bool isTriangleList = mode == TINYGLTF_MODE_TRIANGLES && primitive.attributes.find("POSITION") != primitive.attributes.end();
+			bool isWelded = m_weldVertices && isTriangleList;
+			bool isOptimized = m_optimizeMeshes && isTriangleList && (isIndexed || isWelded);
+			bool isSimplified = m_generateLods && isTriangleList && (isIndexed || isWelded);
+			bool isClustered = m_buildMeshlets && isTriangleList && (isIndexed || isWelded);
+			bool isPacked = (m_vertexLayout.mode != VertexSlotsMode::Separate || m_vertexLayout.quantization.IsEnabled()) && primitive.attributes.find("POSITION") != primitive.attributes.end();
+			if (isWelded || isOptimized || isSimplified || isClustered || isPacked || !computedTangents.sourceVertices.empty())
 			{
-				tinygltf::Accessor texCoord0Accessor = m_model.accessors[primitive.attributes["TEXCOORD_0"]];
-				tinygltf::BufferView texCoord0BV = m_model.bufferViews[texCoord0Accessor.bufferView];
-				sm.texCoord0BufferView.bufferId = texCoord0BV.buffer;
-				sm.texCoord0BufferView.byteOffset = texCoord0BV.byteOffset + texCoord0Accessor.byteOffset;
-				sm.texCoord0BufferView.byteLength = texCoord0BV.byteLength;
-				sm.texCoord0BufferView.byteStride = texCoord0BV.byteStride;
-				sm.texCoord0BufferView.count = texCoord0Accessor.count;
-				sm.texCoord0BufferView.elemType = BUFFER_ELEM_VEC2;
-				if (texCoord0Accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) sm.texCoord0BufferView.componentType = BUFFER_ELEM_TYPE_FLOAT;
-				if (texCoord0Accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) sm.texCoord0BufferView.componentType = BUFFER_ELEM_TYPE_UNSIGNED_CHAR;
-				if (texCoord0Accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) sm.texCoord0BufferView.componentType = BUFFER_ELEM_TYPE_UNSIGNED_SHORT;
-			}
+				MeshStreams streams = ReadMeshStreams(primitive, [this](const int accessorId) { return GetAccessorDesc(accessorId); });
+				if (isTriangleList && topology) streams.indices = std::move(topology->indices);
+				else if (isTriangleList && isIndexed) streams.indices = ReadIndices(primitive.indices);
+				else if (topology && isIndexed) SetIndicesView(scene, topology->indices, sm.indicesBufferView);	// Points, lines and strips are only packed
+				else if (isIndexed) SetIndicesAccessorView(scene, primitive.indices, sm.indicesBufferView);
+				if (!computedNormals.empty()) streams.SetStream("NORMAL", 3, { &computedNormals[0].x, &computedNormals[0].x + 3 * computedNormals.size() });
+				if (!computedTangents.sourceVertices.empty())
+				{
+					std::vector<uint32_t> sourceVertices(streams.verticesCount);
+					std::iota(sourceVertices.begin(), sourceVertices.end(), 0);
+					sourceVertices.insert(sourceVertices.end(), computedTangents.sourceVertices.begin(), computedTangents.sourceVertices.end());
+					streams.GatherVertices(sourceVertices);
+					streams.indices = std::move(computedTangents.indices);
+				}
+				if (!computedTangents.tangents.empty()) streams.SetStream("TANGENT", 4, std::move(computedTangents.tangents));
 
-			if (primitive.attributes.find("TEXCOORD_1") != primitive.attributes.end())
-			{
-				tinygltf::Accessor texCoord1Accessor = m_model.accessors[primitive.attributes["TEXCOORD_1"]];
-				tinygltf::BufferView texCoord1BV = m_model.bufferViews[texCoord1Accessor.bufferView];
-
-				sm.texCoord1BufferView.bufferId = texCoord1BV.buffer;
-				sm.texCoord1BufferView.byteOffset = texCoord1BV.byteOffset + texCoord1Accessor.byteOffset;
-				sm.texCoord1BufferView.byteLength = texCoord1BV.byteLength;
-				sm.texCoord1BufferView.byteStride = texCoord1BV.byteStride;
-				sm.texCoord1BufferView.count = texCoord1Accessor.count;
-				sm.texCoord1BufferView.elemType = BUFFER_ELEM_VEC2;
-				if (texCoord1Accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) sm.texCoord1BufferView.componentType = BUFFER_ELEM_TYPE_FLOAT;
-				if (texCoord1Accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) sm.texCoord1BufferView.componentType = BUFFER_ELEM_TYPE_UNSIGNED_CHAR;
-				if (texCoord1Accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) sm.texCoord1BufferView.componentType = BUFFER_ELEM_TYPE_UNSIGNED_SHORT;
+				if (isWelded)
+				{
+					ScopedPhase phase(m_profile, "vertex_welding", streams.verticesCount * sizeof(uint32_t));
+					m_vertexWeldReport.Add(WeldVertices(streams, m_vertexWeldOptions, ThreadPool::GetDefault()));
+				}
+				if (isOptimized)
+				{
+					ScopedPhase phase(m_profile, "mesh_optimization", streams.indices.size() * sizeof(uint32_t));
+					m_meshOptimizationReport.Add(OptimizeMesh(streams, m_meshOptimizationOptions));
+				}
+				if (isSimplified || isClustered)
+				{
+					// The meshlets reorder the indices, they are uploaded later. The meshlets and the levels only need the positions of the vertices uploaded
+					MeshStreams geometry;
+					geometry.indices = std::move(streams.indices);
+					SetMeshStreamsViews(scene, streams, sm);
+					geometry.verticesCount = streams.verticesCount;
+					geometry.SetStream("POSITION", 3, std::move(streams.Find("POSITION")->values));
+					geometries.push_back(std::move(geometry));
+					geometrySubMeshes.push_back({ meshId, subMeshes[meshId].size() });
+				}
+				else
+				{
+					if (m_buildBVH && isTriangleList)
+					{
+						MeshStreams bvhMesh;
+						bvhMesh.indices = streams.indices;
+						bvhMesh.verticesCount = streams.verticesCount;
+						bvhMesh.SetStream("POSITION", 3, std::vector<float>(streams.Find("POSITION")->values));
+						bvhMeshes.push_back(std::move(bvhMesh));
+						bvhSubMeshes.push_back({ meshId, subMeshes[meshId].size() });
+					}
+					SetMeshStreamsViews(scene, streams, sm);
+				}
 			}
-
-			if (primitive.indices != -1)
+			else
 			{
-				tinygltf::Accessor indicesAccessor = m_model.accessors[primitive.indices];
-				tinygltf::BufferView indicesBV = m_model.bufferViews[m_model.accessors[primitive.indices].bufferView];
-				sm.indicesBufferView.bufferId = indicesBV.buffer;
-				sm.indicesBufferView.byteOffset = indicesBV.byteOffset + indicesAccessor.byteOffset;
-				sm.indicesBufferView.byteLength = indicesBV.byteLength;
-				sm.indicesBufferView.byteStride = indicesBV.byteStride;
-				sm.indicesBufferView.count = m_model.accessors[primitive.indices].count;
-
-				if (indicesAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+				// Attribute (es. "POSITION") -> Accessors -> BufferView -> Buffer
+				if (primitive.attributes.find("POSITION") != primitive.attributes.end())
 				{
-					sm.indicesBufferView.componentType = BUFFER_ELEM_TYPE_UNSIGNED_CHAR;
-					uint8_t* indexes = (uint8_t*)(m_model.buffers[0].data.data() + indicesBV.byteOffset);
+					SetAttributeView(scene, primitive.attributes["POSITION"], BUFFER_ELEM_VEC3, sm.verticesBufferView);
 				}
 
-				if (indicesAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+				if (primitive.attributes.find("COLOR_0") != primitive.attributes.end())
 				{
-					sm.indicesBufferView.componentType = BUFFER_ELEM_TYPE_UNSIGNED_SHORT;
-					uint16_t* indexes = (uint16_t*)(m_model.buffers[0].data.data() + indicesBV.byteOffset);
+					int colorAccessorId = primitive.attributes["COLOR_0"];
+					bool isVec3 = GetAccessorDesc(colorAccessorId).elementsCount == 3;
+					SetAttributeView(scene, colorAccessorId, isVec3 ? BUFFER_ELEM_VEC3 : BUFFER_ELEM_VEC4, sm.colorsBufferView);
+				}
 
-					size_t indexesCount = m_model.accessors[primitive.indices].count;
-					for (int i = 0; i < indexesCount; i += 3)
-					{
-						int tmp = indexes[i];
-						indexes[i] = indexes[i + 2];
-						indexes[i + 2] = tmp;
-					}
+				if (primitive.attributes.find("NORMAL") != primitive.attributes.end())
+				{
+					SetAttributeView(scene, primitive.attributes["NORMAL"], BUFFER_ELEM_VEC3, sm.normalsBufferView);
 				}
 
-				if (indicesAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+				if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end())
 				{
-					sm.indicesBufferView.componentType = BUFFER_ELEM_TYPE_UNSIGNED_INT;
-					uint32_t* indexes = (uint32_t*)(m_model.buffers[0].data.data() + indicesBV.byteOffset);
-					
-					size_t indexesCount = m_model.accessors[primitive.indices].count;
-					for (int i = 0; i < indexesCount; i += 3)
-					{
-						int tmp = indexes[i];
-						indexes[i] = indexes[i + 2];
-						indexes[i + 2] = tmp;
-					}
+					SetAttributeView(scene, primitive.attributes["TEXCOORD_0"], BUFFER_ELEM_VEC2, sm.texCoord0BufferView);
 				}
-			}
 
-			if (primitive.attributes.find("TANGENT") != primitive.attributes.end())
-			{
-				tinygltf::Accessor tangentsAccessor = m_model.accessors[primitive.attributes["TANGENT"]];
-				tinygltf::BufferView tangentsBV = m_model.bufferViews[tangentsAccessor.bufferView];
-				sm.tangentsBufferView.bufferId = tangentsBV.buffer;
-				sm.tangentsBufferView.byteOffset = tangentsBV.byteOffset + tangentsAccessor.byteOffset;
-				sm.tangentsBufferView.byteLength = tangentsBV.byteLength;
-				sm.tangentsBufferView.byteStride = tangentsBV.byteStride;
-				sm.tangentsBufferView.count = m_model.accessors[primitive.attributes["TANGENT"]].count;
-			}
+				if (primitive.attributes.find("TEXCOORD_1") != primitive.attributes.end())
+				{
+					SetAttributeView(scene, primitive.attributes["TEXCOORD_1"], BUFFER_ELEM_VEC2, sm.texCoord1BufferView);
+				}
 
-			// Load all buffers to the GPU
-			for (tinygltf::Buffer buffer : m_model.buffers)
-			{
-				scene->AddGPUBuffer(gpuHeapUploader.Upload(buffer.data.data(), buffer.data.size()));
-			}
+				if (topology && isIndexed) SetIndicesView(scene, topology->indices, sm.indicesBufferView);
+				else if (isIndexed) SetIndicesAccessorView(scene, primitive.indices, sm.indicesBufferView);
 
-			// Compute normals if they are not specified into the file
-			if (primitive.attributes.find("NORMAL") == primitive.attributes.end())
-			{
-				sm.normalsBufferView.bufferId = static_cast<UINT>(m_model.buffers.size()); // A new GPU buffer will be created for normals
-				sm.normalsBufferView.byteOffset = 0;
-				sm.normalsBufferView.count = m_model.accessors[primitive.attributes["POSITION"]].count;	// As many normals as vertices
-				sm.normalsBufferView.byteLength = sm.normalsBufferView.count * sizeof(DirectX::XMFLOAT3);
-				sm.normalsBufferView.byteStride = 0;
-				ComputeNormals(primitive, scene);
-			}
+				if (primitive.attributes.find("TANGENT") != primitive.attributes.end())
+				{
+					SetAttributeView(scene, primitive.attributes["TANGENT"], BUFFER_ELEM_VEC4, sm.tangentsBufferView);
+				}
 
-			// Compute tangents if they are not specified into the file
-			if (primitive.attributes.find("TANGENT") == primitive.attributes.end())
-			{
-				// Tangents computing is only supported for primitives that define texture coords, normals and indices
-				if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end() && primitive.attributes.find("NORMAL") != primitive.attributes.end() && primitive.indices != -1)
+				if (!computedNormals.empty()) SetFloatsView(scene, &computedNormals[0].x, computedNormals.size(), BUFFER_ELEM_VEC3, sm.normalsBufferView);
+				if (!computedTangents.tangents.empty()) SetFloatsView(scene, computedTangents.tangents.data(), computedTangents.GetVerticesCount(), BUFFER_ELEM_VEC4, sm.tangentsBufferView);
+
+				if (m_buildBVH && isTriangleList)
 				{
-					sm.tangentsBufferView.bufferId = static_cast<UINT>(m_model.buffers.size()); // A new GPU buffer will be created for tangents
-					sm.tangentsBufferView.byteOffset = 0;
-					sm.tangentsBufferView.count = m_model.accessors[primitive.attributes["POSITION"]].count;	// As many tangents as vertices
-					sm.tangentsBufferView.byteLength = sm.tangentsBufferView.count * sizeof(DirectX::XMFLOAT4);
-					sm.tangentsBufferView.byteStride = 0;	// Tighly packed
-					ComputeTangents(primitive, scene);
+					std::vector<XMFLOAT3> positions = ReadAttribute<XMFLOAT3>(primitive.attributes["POSITION"]);
+					const float* values = reinterpret_cast<const float*>(positions.data());
+					MeshStreams bvhMesh;
+					if (topology) bvhMesh.indices = topology->indices;
+					else if (isIndexed) bvhMesh.indices = ReadIndices(primitive.indices);
+					bvhMesh.verticesCount = positions.size();
+					bvhMesh.SetStream("POSITION", 3, { values, values + 3 * positions.size() });
+					bvhMeshes.push_back(std::move(bvhMesh));
+					bvhSubMeshes.push_back({ meshId, subMeshes[meshId].size() });
 				}
 			}
 
-			if (sm.materialId == -1) primitive.material = 0; // No material in the file, will use the default material
+			if (primitive.material >= static_cast<int>((std::max)(m_model.materials.size(), size_t(1)))) { DXUtil::ThrowException("Material index out of range"); }
+			sm.materialId = (primitive.material == -1) ? 0 : primitive.material; // No material, the first or the default material
+
+			// The fans and the line loops with positions have been converted to lists by the topology normalization
+			if (mode == TINYGLTF_MODE_POINTS) sm.topology = D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
+			if (mode == TINYGLTF_MODE_LINE) sm.topology = D3D_PRIMITIVE_TOPOLOGY_LINELIST;
+			if (mode == TINYGLTF_MODE_LINE_STRIP) sm.topology = D3D_PRIMITIVE_TOPOLOGY_LINESTRIP;
+			if (mode == TINYGLTF_MODE_TRIANGLES) sm.topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+			if (mode == TINYGLTF_MODE_TRIANGLE_STRIP) sm.topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+
+			subMeshes[meshId].push_back(std::move(sm));
+		}
+		ReportProgress(0, 1);
+	}
+
+	size_t perPrimitiveBytes = GetPerPrimitiveUploadBytes();
+	DEBUG_LOG((std::to_string(m_uploadedRangesCount) + " of " + std::to_string(m_geometryResidency.GetRanges().size()) + " geometry ranges uploaded, "
+		+ std::to_string(m_uploadedRangesBytes) + " bytes, " + std::to_string(perPrimitiveBytes > m_uploadedRangesBytes ? perPrimitiveBytes - m_uploadedRangesBytes : 0)
+		+ " bytes saved\n").c_str())
+
+	size_t geometriesBytes = 0;
+	for (const MeshStreams& geometry : geometries) geometriesBytes += geometry.indices.size() * sizeof(uint32_t);
+	if (m_buildMeshlets && !geometries.empty())
+	{
+		CheckCancelled();
+		ScopedPhase phase(m_profile, "meshlets", geometriesBytes);
+		std::vector<std::vector<Meshlet>> meshlets;
+		m_meshletReport = BuildMeshlets(geometries, m_meshletOptions, ThreadPool::GetDefault(), meshlets);
+		for (size_t g = 0; g < geometries.size(); g++) subMeshes[geometrySubMeshes[g].first][geometrySubMeshes[g].second].meshlets = std::move(meshlets[g]);
+	}
+	for (size_t g = 0; g < geometries.size(); g++)
+	{
+		if (!geometries[g].indices.empty()) SetIndicesView(scene, geometries[g].indices, subMeshes[geometrySubMeshes[g].first][geometrySubMeshes[g].second].indicesBufferView);
+	}
+
+	if (m_generateLods && !geometries.empty())
+	{
+		CheckCancelled();
+		std::vector<std::vector<MeshLod>> lods;
+		{
+			ScopedPhase phase(m_profile, "lod_generation", geometriesBytes);
+			m_simplificationReport = SimplifyMeshes(geometries, m_simplificationOptions, ThreadPool::GetDefault(), lods);
 
-			if (primitive.mode == TINYGLTF_MODE_POINTS) sm.topology = D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
-			if (primitive.mode == TINYGLTF_MODE_LINE) sm.topology = D3D_PRIMITIVE_TOPOLOGY_LINELIST;
-			//if (primitive.mode == tinygltf::TINYGLTF_MODE_LINE_LOOP) sm.topology = ; UNSUPPORTED
-			if (primitive.mode == TINYGLTF_MODE_LINE_STRIP) sm.topology = D3D_PRIMITIVE_TOPOLOGY_LINESTRIP;
-			if (primitive.mode == TINYGLTF_MODE_TRIANGLES) sm.topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-			if (primitive.mode == TINYGLTF_MODE_TRIANGLE_STRIP) sm.topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
-			//if (primitive.mode == TINYGLTF_MODE_TRIANGLE_FAN) sm.topology = ; UNSUPPORTED
+			// The levels are drawn through the same vertex cache as the submeshes
+			if (m_optimizeMeshes)
+			{
+				ThreadPool::GetDefault().ParallelFor(lods.size(), [&](size_t m)
+					{
+						for (MeshLod& lod : lods[m]) lod.indices = OptimizeVertexCache(lod.indices, geometries[m].verticesCount, m_meshOptimizationOptions.cacheSize);
+					});
+			}
+		}
+		for (size_t m = 0; m < lods.size(); m++) SetLodsViews(scene, lods[m], subMeshes[geometrySubMeshes[m].first][geometrySubMeshes[m].second]);
+	}
 
-			m.AddSubMesh(std::move(sm));
+	// The geometries indices are final once the meshlets reordered them, the hierarchies find the triangles of the uploaded indices
+	if (m_buildBVH)
+	{
+		for (size_t g = 0; g < geometries.size(); g++)
+		{
+			bvhMeshes.push_back(std::move(geometries[g]));
+			bvhSubMeshes.push_back(geometrySubMeshes[g]);
 		}
+	}
+	if (!bvhMeshes.empty())
+	{
+		CheckCancelled();
+		size_t bvhBytes = 0;
+		for (const MeshStreams& bvhMesh : bvhMeshes) bvhBytes += bvhMesh.Find("POSITION")->values.size() * sizeof(float) + bvhMesh.indices.size() * sizeof(uint32_t);
+		ScopedPhase phase(m_profile, "bvh", bvhBytes);
+		std::vector<TriangleBVH> bvhs;
+		m_bvhReport = BuildTriangleBVHs(bvhMeshes, m_bvhOptions, ThreadPool::GetDefault(), bvhs);
+		for (size_t b = 0; b < bvhs.size(); b++) subMeshes[bvhSubMeshes[b].first][bvhSubMeshes[b].second].bvh = std::move(bvhs[b]);
+	}
+
+	for (size_t meshId = 0; meshId < subMeshes.size(); meshId++)
+	{
+		Mesh m;
+		m.SetId(static_cast<unsigned int>(meshId));
+		m.SetModelMtx(DXUtil::IdentityMtx());
+		m.SetNodeMtx(DXUtil::IdentityMtx());
+		for (SubMesh& sm : subMeshes[meshId]) m.AddSubMesh(std::move(sm));
 		scene->AddMesh(std::move(m));
 	}
+
+	if (m_topologyReport.primitivesCount > 0)
+	{
+		const TopologyReport& report = m_topologyReport;
+		DEBUG_LOG((std::to_string(report.primitivesCount) + " primitives normalized, " + std::to_string(report.fansCount) + " fans, "
+			+ std::to_string(report.loopsCount) + " loops and " + std::to_string(report.stripsCount) + " strips converted, "
+			+ std::to_string(report.degenerateTriangles) + " degenerate and " + std::to_string(report.duplicateTriangles) + " duplicate triangles removed, "
+			+ std::to_string(report.shortIndicesCount) + " 16 bit indices\n").c_str())
+	}
+	if (m_vertexWeldReport.verticesCountBefore > 0)
+	{
+		const VertexWeldReport& report = m_vertexWeldReport;
+		DEBUG_LOG((std::to_string(report.verticesCountBefore) + " vertices welded to " + std::to_string(report.verticesCountAfter) + ", "
+			+ std::to_string(report.degenerateTriangles) + " degenerate triangles removed\n").c_str())
+	}
+	if (m_meshOptimizationReport.trianglesCount > 0)
+	{
+		const MeshOptimizationReport& report = m_meshOptimizationReport;
+		DEBUG_LOG((std::to_string(report.trianglesCount) + " triangles optimized, ACMR " + std::to_string(report.before.acmr) + " -> " + std::to_string(report.after.acmr)
+			+ ", ATVR " + std::to_string(report.before.atvr) + " -> " + std::to_string(report.after.atvr) + "\n").c_str())
+	}
+	if (m_simplificationReport.meshesCount > 0)
+	{
+		const SimplificationReport& report = m_simplificationReport;
+		std::string levels;
+		for (size_t l = 0; l < report.lodTrianglesCount.size(); l++)
+		{
+			levels += " " + std::to_string(report.lodTrianglesCount[l]) + " (error " + std::to_string(report.lodRelativeError[l]) + ")";
+		}
+		DEBUG_LOG((std::to_string(report.meshesCount) + " submeshes simplified, " + std::to_string(report.trianglesCount) + " triangles ->" + levels + "\n").c_str())
+	}
+	if (m_meshletReport.meshletsCount > 0)
+	{
+		const MeshletReport& report = m_meshletReport;
+		DEBUG_LOG((std::to_string(report.trianglesCount) + " triangles split in " + std::to_string(report.meshletsCount) + " meshlets, "
+			+ std::to_string(report.conesCount) + " with a normal cone\n").c_str())
+	}
+	if (m_bvhReport.meshesCount > 0)
+	{
+		const BVHReport& report = m_bvhReport;
+		DEBUG_LOG((std::to_string(report.primitivesCount) + " triangles in " + std::to_string(report.meshesCount) + " hierarchies, " + std::to_string(report.nodesCount)
+			+ " nodes, depth " + std::to_string(report.maxDepth) + ", SAH cost " + std::to_string(report.sahCost) + "\n").c_str())
+	}
+	if (m_vertexQuantizationReport.verticesCount > 0)
+	{
+		const VertexQuantizationReport& report = m_vertexQuantizationReport;
+		DEBUG_LOG((std::to_string(report.verticesCount) + " vertices quantized, " + std::to_string(report.floatByteSize) + " bytes -> "
+			+ std::to_string(report.quantizedByteSize) + " bytes\n").c_str())
+	}
 }
 
 void GLTFSceneLoader::LoadLights(Scene* scene)
@@ -352,8 +854,11 @@ void GLTFSceneLoader::LoadMaterials(Scene* scene)
 	if (m_model.materials.empty())
 	{
 		// Default material is black
-		RoughMetallicMaterial rmMaterial;
+		RoughMetallicMaterial rmMaterial = {};
 		rmMaterial.baseColorFactor = { 0.0f, 0.0f, 0.0f, 0.0f };
+		rmMaterial.baseColorTA.textureId = rmMaterial.roughMetallicTA.textureId = rmMaterial.normalTA.textureId = -1;
+		rmMaterial.emissiveTA.textureId = rmMaterial.occlusionTA.textureId = -1;
+		scene->AddMaterial(materialId++, std::move(rmMaterial));
 	}
 	else
 	{
@@ -379,6 +884,10 @@ void GLTFSceneLoader::LoadMaterials(Scene* scene)
 			rmMaterial.occlusionTA.texCoordId = material.occlusionTexture.texCoord;
 			rmMaterial.emissiveTA.textureId = material.emissiveTexture.index;
 			rmMaterial.emissiveTA.texCoordId = material.emissiveTexture.texCoord;
+			for (int textureId : { rmMaterial.baseColorTA.textureId, rmMaterial.roughMetallicTA.textureId, rmMaterial.normalTA.textureId, rmMaterial.occlusionTA.textureId, rmMaterial.emissiveTA.textureId })
+			{
+				if (textureId >= static_cast<int>(m_model.textures.size())) { DXUtil::ThrowException("Material " + std::to_string(materialId) + " texture index out of range"); }
+			}
 			scene->AddMaterial(materialId++, std::move(rmMaterial));
 		}
 	}
@@ -386,26 +895,76 @@ void GLTFSceneLoader::LoadMaterials(Scene* scene)
 
 void GLTFSceneLoader::LoadTextures(Scene* scene)
 {
-	int textureId = 0;
-	for (tinygltf::Texture& texture : m_model.textures)
+	// Images are decoded and their mip chains generated on the worker threads, then copied with the scene buffers upload
+	m_decodedTextures.assign(m_model.images.size(), DecodedTexture());
 	{
-		tinygltf::Image image = m_model.images[texture.source];
-		if (image.bufferView != -1)
-		{
-			tinygltf::BufferView imageBufferView = m_model.bufferViews[image.bufferView];
-			tinygltf::Buffer imageBuffer = m_model.buffers[imageBufferView.buffer];
-			uint8_t* imageBufferBegin = imageBuffer.data.data() + imageBufferView.byteOffset;
-			Microsoft::WRL::ComPtr<ID3D12Resource> pTexture;
-			CreateTextureFromMemory(m_device.Get(), m_commandQueue.Get(), imageBufferBegin, imageBufferView.byteLength, &pTexture);
-			scene->AddTexture(textureId++, pTexture);
-		}
-		else
+		ScopedPhase phase(m_profile, "texture_decode");
+		for (const tinygltf::Image& image : m_model.images) phase.AddBytes(GetImageByteSize(image));
+		ThreadPool::GetDefault().ParallelFor(m_model.images.size(), [this](size_t imageId)
+			{
+				if (IsCancelled()) return;
+
+				const tinygltf::Image& image = m_model.images[imageId];
+				EncodedImage encodedImage;
+				if (image.bufferView != -1)
+				{
+					ByteSpan imageData = GetBufferViewData(image.bufferView);
+					encodedImage.data = imageData.data;
+					encodedImage.size = imageData.size;
+				}
+				else encodedImage.fileName = ResolvePath(image.uri);
+
+				m_decodedTextures[imageId] = DecodeTexture(encodedImage);
+				ReportProgress(GetImageByteSize(image), 1);
+			});
+	}
+	CheckCancelled();
+
+	// Textures sharing an image share its GPU resource
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> imagesGPU(m_model.images.size());
+	{
+		ScopedPhase phase(m_profile, "texture_resources");
+		for (size_t imageId = 0; imageId < m_model.images.size(); imageId++)
 		{
-			Microsoft::WRL::ComPtr<ID3D12Resource> pTexture;
-			CreateTextureFromFile(m_device.Get(), m_commandQueue.Get(), image.uri, &pTexture);
-			scene->AddTexture(textureId++, pTexture);
+			imagesGPU[imageId] = AddSceneImage(m_decodedTextures[imageId]);
+			phase.AddBytes(m_decodedTextures[imageId].data.size());
 		}
 	}
+
+	ScopedPhase phase(m_profile, "texture_descriptors");
+	int textureId = 0;
+	for (tinygltf::Texture& texture : m_model.textures)
+	{
+		scene->AddTexture(textureId++, imagesGPU[texture.source]);
+	}
+}
+
+int GLTFSceneLoader::AddSceneBuffer(Scene* scene, const uint8_t* data, const size_t byteSize)
+{
+	scene->AddGPUBuffer(m_uploadBatch->EnqueueBuffer(data, byteSize));
+	return static_cast<int>(scene->m_buffersGPU.size()) - 1;
+}
+
+int GLTFSceneLoader::AddSceneBuffer(Scene* scene, std::vector<uint8_t>&& data)
+{
+	scene->AddGPUBuffer(m_uploadBatch->EnqueueBuffer(std::move(data)));
+	return static_cast<int>(scene->m_buffersGPU.size()) - 1;
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> GLTFSceneLoader::AddSceneImage(const DecodedTexture& decodedTexture)
+{
+	Microsoft::WRL::ComPtr<ID3D12Resource> texture;
+	CreateTextureFromDecoded(m_device.Get(), *m_uploadBatch, decodedTexture, &texture);
+	return texture;
+}
+
+size_t GLTFSceneLoader::GetImageByteSize(const tinygltf::Image& image) const
+{
+	if (image.bufferView != -1) return m_model.bufferViews[image.bufferView].byteLength;
+
+	std::error_code error;
+	uintmax_t fileSize = std::filesystem::file_size(ResolvePath(image.uri), error);
+	return error ? 0 : static_cast<size_t>(fileSize);
 }
 
 void GLTFSceneLoader::LoadSamplers(Scene* scene)
@@ -456,134 +1015,165 @@ void GLTFSceneLoader::LoadSamplers(Scene* scene)
 	}
 }
 
-void GLTFSceneLoader::ComputeNormals(tinygltf::Primitive primitive, Scene* scene) 
+std::vector<DirectX::XMFLOAT3> GLTFSceneLoader::ComputeNormals(tinygltf::Primitive primitive, const PrimitiveTopology* topology)
 {
-	tinygltf::BufferView positionsBV = m_model.bufferViews[m_model.accessors[primitive.attributes["POSITION"]].bufferView];
-	DirectX::XMFLOAT3* vertices = (DirectX::XMFLOAT3*)(m_model.buffers[0].data.data() + positionsBV.byteOffset);
-	size_t verticesCount = m_model.accessors[primitive.attributes["POSITION"]].count;
+	std::vector<DirectX::XMFLOAT3> vertices = ReadAttribute<DirectX::XMFLOAT3>(primitive.attributes["POSITION"]);
+	std::vector<uint32_t> indexes;
+	if (topology) indexes = topology->indices;
+	else if (primitive.indices != -1) indexes = ReadIndices(primitive.indices);
+	const bool isIndexed = topology ? !indexes.empty() : primitive.indices != -1;
+	const int mode = topology ? static_cast<int>(topology->mode) : primitive.mode;
+
+	// Only triangle lists have faces, the vertices of other primitives get the default normal
+	TriangleMesh mesh;
+	mesh.positions = reinterpret_cast<const float*>(vertices.data());
+	mesh.verticesCount = vertices.size();
+	mesh.indices = isIndexed ? indexes.data() : nullptr;
+	if (mode == TINYGLTF_MODE_TRIANGLES) mesh.indicesCount = isIndexed ? indexes.size() : vertices.size();
+
+	std::vector<DirectX::XMFLOAT3> normals(vertices.size());
+	GenerateNormals(mesh, m_normalWeighting, reinterpret_cast<float*>(normals.data()), ThreadPool::GetDefault());
+	return normals;
+}
 
-	tinygltf::BufferView indicesBV = m_model.bufferViews[m_model.accessors[primitive.indices].bufferView];
-	uint16_t* indexes = (uint16_t*)(m_model.buffers[0].data.data() + indicesBV.byteOffset);
-	size_t indexesCount = m_model.accessors[primitive.indices].count;
+VertexTangents GLTFSceneLoader::ComputeTangents(tinygltf::Primitive primitive, const PrimitiveTopology* topology, const std::vector<DirectX::XMFLOAT3>& computedNormals)
+{
+	std::vector<DirectX::XMFLOAT3> vertices = ReadAttribute<DirectX::XMFLOAT3>(primitive.attributes["POSITION"]);
+	std::vector<DirectX::XMFLOAT3> normals = computedNormals.empty() ? ReadAttribute<DirectX::XMFLOAT3>(primitive.attributes["NORMAL"]) : computedNormals;
+	std::vector<DirectX::XMFLOAT2> texCoords = ReadAttribute<DirectX::XMFLOAT2>(primitive.attributes["TEXCOORD_0"]);
+	if (normals.size() != vertices.size() || texCoords.size() != vertices.size()) { DXUtil::ThrowException("Vertex attributes with different counts"); }
+
+	std::vector<uint32_t> indexes;
+	if (topology) indexes = topology->indices;
+	else if (primitive.indices != -1) indexes = ReadIndices(primitive.indices);
+	const bool isIndexed = topology ? !indexes.empty() : primitive.indices != -1;
+
+	TriangleMesh mesh;
+	mesh.positions = reinterpret_cast<const float*>(vertices.data());
+	mesh.verticesCount = vertices.size();
+	mesh.indices = isIndexed ? indexes.data() : nullptr;
+	mesh.indicesCount = isIndexed ? indexes.size() : vertices.size();
+	return GenerateTangents(mesh, reinterpret_cast<const float*>(normals.data()), reinterpret_cast<const float*>(texCoords.data()), ThreadPool::GetDefault());
+}
 
-	std::unique_ptr<DirectX::XMFLOAT3[]> normals(new DirectX::XMFLOAT3[verticesCount]);
-	ZeroMemory(normals.get(), verticesCount * sizeof(DirectX::XMFLOAT3));
+void GLTFSceneLoader::SetFloatsView(Scene* scene, const float* values, const size_t count, const uint8_t elemType, BufferView& view)
+{
+	std::vector<uint8_t> data(count * elemType * sizeof(float));
+	std::memcpy(data.data(), values, data.size());
+	view.byteOffset = 0;
+	view.byteLength = data.size();
+	view.byteStride = 0;	// Tighly packed
+	view.count = count;
+	view.elemType = elemType;
+	view.componentType = BUFFER_ELEM_TYPE_FLOAT;
+	view.bufferId = AddSceneBuffer(scene, std::move(data));
+}
 
-	int* idxAvgSize = new int[verticesCount]();
-	std::fill_n(idxAvgSize, verticesCount, 0);
-	for (size_t i = 0; i < indexesCount; i += 3)
+void GLTFSceneLoader::SetIndicesAccessorView(Scene* scene, const int accessorId, BufferView& view)
+{
+	int componentType = GetAccessorDesc(accessorId).componentType;
+	if (componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
 	{
-		long i1 = indexes[i];
-		long i2 = indexes[i + 1];
-		long i3 = indexes[i + 2];
-
-		DirectX::XMVECTOR v1 = XMLoadFloat3(&vertices[i1]);
-		DirectX::XMVECTOR v2 = XMLoadFloat3(&vertices[i2]);
-		DirectX::XMVECTOR v3 = XMLoadFloat3(&vertices[i3]);
-		
-		// Face normal
-		XMFLOAT3 faceNormal;
-		DirectX::XMStoreFloat3(&faceNormal, DirectX::XMVector3Normalize(DirectX::XMVector3Cross(DirectX::XMVectorSubtract(v2, v1), DirectX::XMVectorSubtract(v3, v1))));
-		
-		// Average face normals to get vertex normal
-		normals[i1] = { normals[i1].x + faceNormal.x, normals[i1].y + faceNormal.y, normals[i1].z + faceNormal.z };
-		normals[i2] = { normals[i2].x + faceNormal.x, normals[i2].y + faceNormal.y, normals[i2].z + faceNormal.z };
-		normals[i3] = { normals[i3].x + faceNormal.x, normals[i3].y + faceNormal.y, normals[i3].z + faceNormal.z };
-		idxAvgSize[i1]++;
-		idxAvgSize[i2]++;
-		idxAvgSize[i3]++;
+		// Direct3D has no 8 bit index format, the indices are widened to 16 bit
+		std::vector<uint32_t> indices = ReadIndices(accessorId);
+		bool isShort;
+		std::vector<uint8_t> indicesData = PackIndices(indices, true, isShort);
+		view.byteOffset = 0;
+		view.byteLength = indicesData.size();
+		view.byteStride = 0;
+		view.count = indices.size();
+		view.bufferId = AddSceneBuffer(scene, std::move(indicesData));
+		view.componentType = BUFFER_ELEM_TYPE_UNSIGNED_SHORT;
 	}
-
-	for (size_t i = 0; i < verticesCount; i += 3) 
-	{ 
-		normals[i].x /= static_cast<float>(idxAvgSize[i]); 
-		normals[i].y /= static_cast<float>(idxAvgSize[i]);
-		normals[i].z /= static_cast<float>(idxAvgSize[i]);
+	else if (componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT || componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+	{
+		SetResidentView(scene, accessorId, view);
+		view.componentType = (componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) ? BUFFER_ELEM_TYPE_UNSIGNED_INT : BUFFER_ELEM_TYPE_UNSIGNED_SHORT;
 	}
-
-	GPUHeapUploader gpuHeapUploader(m_device, m_commandQueue);
-	scene->AddGPUBuffer(gpuHeapUploader.Upload(normals.get(), verticesCount * sizeof(DirectX::XMFLOAT3)));
+	else DXUtil::ThrowException("Indices must be unsigned bytes, shorts or ints");
 }
 
-void GLTFSceneLoader::ComputeTangents(tinygltf::Primitive primitive, Scene* scene)
+void GLTFSceneLoader::SetMeshStreamsViews(Scene* scene, const MeshStreams& mesh, SubMesh& subMesh)
 {
-	tinygltf::BufferView positionsBV = m_model.bufferViews[m_model.accessors[primitive.attributes["POSITION"]].bufferView];
-	DirectX::XMFLOAT3* vertices = (DirectX::XMFLOAT3*)(m_model.buffers[0].data.data() + positionsBV.byteOffset);
-	size_t verticesCount = m_model.accessors[primitive.attributes["POSITION"]].count;
+	if (m_vertexLayout.mode == VertexSlotsMode::Separate && !m_vertexLayout.quantization.IsEnabled())
+	{
+		for (uint32_t a = 0; a < VERTEX_ATTRIBUTES_COUNT; a++)
+		{
+			VertexAttribute attribute = static_cast<VertexAttribute>(a);
+			const VertexStream* stream = mesh.Find(GetVertexAttributeDesc(attribute).gltfSemantic);
+			if (stream) SetFloatsView(scene, stream->values.data(), mesh.verticesCount, static_cast<uint8_t>(stream->elementsCount), subMesh.GetAttributeView(attribute));
+		}
+	}
+	else
+	{
+		// The views of the elements of a slot address the same buffer, each at its offset in the vertex
+		PackedVertices packed = PackVertices(mesh, m_vertexLayout);
+		std::vector<int> slotBufferIds;
+		for (std::vector<uint8_t>& slot : packed.slots) slotBufferIds.push_back(AddSceneBuffer(scene, std::move(slot)));
+		for (const VertexElement& element : m_vertexLayout.elements)
+		{
+			BufferView& view = subMesh.GetAttributeView(element.attribute);
+			view.bufferId = slotBufferIds[element.slot];
+			view.byteOffset = element.byteOffset;
+			view.byteStride = m_vertexLayout.slotStrides[element.slot];
+			view.byteLength = mesh.verticesCount * view.byteStride - element.byteOffset;
+			view.count = mesh.verticesCount;
+			view.elemType = static_cast<uint8_t>(element.componentsCount);
+			view.componentType = (element.format == VertexFormat::Float32) ? BUFFER_ELEM_TYPE_FLOAT : BUFFER_ELEM_TYPE_UNSIGNED_SHORT;
+		}
+		subMesh.dequantization = packed.dequantization;
 
-	tinygltf::BufferView normalsBV = m_model.bufferViews[m_model.accessors[primitive.attributes["NORMAL"]].bufferView];
-	DirectX::XMFLOAT3* normals = (DirectX::XMFLOAT3*)(m_model.buffers[0].data.data() + normalsBV.byteOffset);
+		if (m_vertexLayout.quantization.IsEnabled())
+		{
+			VertexQuantizationReport report;
+			report.verticesCount = mesh.verticesCount;
+			report.floatByteSize = mesh.verticesCount * CreateVertexLayout(m_vertexLayout.features, m_vertexLayout.mode).GetVertexByteSize();
+			report.quantizedByteSize = mesh.verticesCount * m_vertexLayout.GetVertexByteSize();
+			m_vertexQuantizationReport.Add(report);
+		}
+	}
+	if (!mesh.indices.empty()) SetIndicesView(scene, mesh.indices, subMesh.indicesBufferView);
+}
 
-	//tinygltf::BufferView tangentsBV = m_model.bufferViews[m_model.accessors[primitive.attributes["TANGENT"]].bufferView];
-	//DirectX::XMFLOAT4* tangents = (DirectX::XMFLOAT4*)(m_model.buffers[0].data.data() + tangentsBV.byteOffset);
+void GLTFSceneLoader::SetIndicesView(Scene* scene, const std::vector<uint32_t>& indices, BufferView& view)
+{
+	bool isShort;
+	std::vector<uint8_t> indicesData = PackIndices(indices, m_normalizeTopology && m_topologyOptions.shortIndices, isShort);
+	if (isShort) m_topologyReport.shortIndicesCount += indices.size();
+	view.byteOffset = 0;
+	view.byteLength = indicesData.size();
+	view.byteStride = 0;
+	view.count = indices.size();
+	view.componentType = isShort ? BUFFER_ELEM_TYPE_UNSIGNED_SHORT : BUFFER_ELEM_TYPE_UNSIGNED_INT;
+	view.bufferId = AddSceneBuffer(scene, std::move(indicesData));
+}
 
-	tinygltf::BufferView texCoord0BV = m_model.bufferViews[m_model.accessors[primitive.attributes["TEXCOORD_0"]].bufferView];
-	DirectX::XMFLOAT2* texCoords = (DirectX::XMFLOAT2*)(m_model.buffers[0].data.data() + texCoord0BV.byteOffset);
+void GLTFSceneLoader::SetLodsViews(Scene* scene, const std::vector<MeshLod>& lods, SubMesh& subMesh)
+{
+	if (lods.empty()) return;
+
+	// The levels share the index size of their buffer, so that each of them is aligned on it
+	std::vector<uint32_t> indices;
+	for (const MeshLod& lod : lods) indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+	bool isShort;
+	std::vector<uint8_t> indicesData = PackIndices(indices, m_normalizeTopology && m_topologyOptions.shortIndices, isShort);
+	if (isShort) m_topologyReport.shortIndicesCount += indices.size();
+	const size_t indexByteSize = isShort ? sizeof(uint16_t) : sizeof(uint32_t);
+
+	size_t firstIndex = 0;
+	for (const MeshLod& lod : lods)
+	{
+		SubMeshLod subMeshLod;
+		subMeshLod.indicesBufferView.byteOffset = firstIndex * indexByteSize;
+		subMeshLod.indicesBufferView.byteLength = lod.indices.size() * indexByteSize;
+		subMeshLod.indicesBufferView.byteStride = 0;
+		subMeshLod.indicesBufferView.count = lod.indices.size();
+		subMeshLod.indicesBufferView.componentType = isShort ? BUFFER_ELEM_TYPE_UNSIGNED_SHORT : BUFFER_ELEM_TYPE_UNSIGNED_INT;
+		subMeshLod.error = lod.error;
+		subMesh.lods.push_back(subMeshLod);
+		firstIndex += lod.indices.size();
+	}
 
-	tinygltf::BufferView indicesBV = m_model.bufferViews[m_model.accessors[primitive.indices].bufferView];
-	uint16_t* indexes = (uint16_t*)(m_model.buffers[0].data.data() + indicesBV.byteOffset);
-	size_t indexesCount = m_model.accessors[primitive.indices].count;
-	
-	std::unique_ptr<DirectX::XMFLOAT3[]> tan1(new DirectX::XMFLOAT3[verticesCount]);
-	ZeroMemory(tan1.get(), verticesCount * sizeof(DirectX::XMFLOAT3));
-	std::unique_ptr<DirectX::XMFLOAT3[]> tan2(new DirectX::XMFLOAT3[verticesCount]);
-	ZeroMemory(tan2.get(), verticesCount * sizeof(DirectX::XMFLOAT3));
-	//std::unique_ptr<DirectX::XMVECTOR[]> tan1(new DirectX::XMVECTOR[verticesCount]);
-	//std::unique_ptr<DirectX::XMVECTOR[]> tan2(new DirectX::XMVECTOR[verticesCount]);
-	std::unique_ptr<DirectX::XMFLOAT4[]> tangent(new DirectX::XMFLOAT4[verticesCount]);
-	ZeroMemory(tangent.get(), verticesCount * sizeof(DirectX::XMFLOAT4));
-
-	for (size_t i = 0; i < indexesCount; i += 3)
-	{
-		long i1 = indexes[i];
-		long i2 = indexes[i + 1];
-		long i3 = indexes[i + 2];
-
-		DirectX::XMFLOAT3 v1 = vertices[i1];
-		DirectX::XMFLOAT3 v2 = vertices[i2];
-		DirectX::XMFLOAT3 v3 = vertices[i3];
-
-		DirectX::XMFLOAT2 w1 = texCoords[i1];
-		DirectX::XMFLOAT2 w2 = texCoords[i2];
-		DirectX::XMFLOAT2 w3 = texCoords[i3];
-
-		float x1 = v2.x - v1.x;
-		float x2 = v3.x - v1.x;
-		float y1 = v2.y - v1.y;
-		float y2 = v3.y - v1.y;
-		float z1 = v2.z - v1.z;
-		float z2 = v3.z - v1.z;
-		float s1 = w2.x - w1.x;
-		float s2 = w3.x - w1.x;
-		float t1 = w2.y - w1.y;
-		float t2 = w3.y - w1.y;
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-		DirectX::XMFLOAT3 sdir((t2 * x1 - t1 * x2) * r, (t2 * y1 - t1 * y2) * r, (t2 * z1 - t1 * z2) * r);
-		DirectX::XMFLOAT3 tdir((s1 * x2 - s2 * x1) * r, (s1 * y2 - s2 * y1) * r, (s1 * z2 - s2 * z1) * r);
-		tan1[i1] = { tan1[i1].x + sdir.x, tan1[i1].y + sdir.y, tan1[i1].z + sdir.z };
-		tan1[i2] = { tan1[i2].x + sdir.x, tan1[i2].y + sdir.y, tan1[i2].z + sdir.z };
-		tan1[i3] = { tan1[i3].x + sdir.x, tan1[i3].y + sdir.y, tan1[i3].z + sdir.z };
-		tan2[i1] = { tan2[i1].x + sdir.x, tan2[i1].y + sdir.y, tan2[i1].z + sdir.z };
-		tan2[i2] = { tan2[i2].x + sdir.x, tan2[i2].y + sdir.y, tan2[i2].z + sdir.z };
-		tan2[i3] = { tan2[i3].x + sdir.x, tan2[i3].y + sdir.y, tan2[i3].z + sdir.z };
-	}
-
-	for (size_t i = 0; i < verticesCount; i++)
-	{
-
-		DirectX::XMVECTOR n = DirectX::XMLoadFloat3(&normals[i]);
-		DirectX::XMVECTOR t = DirectX::XMLoadFloat3(&tan1[i]);
-
-		// Gram-Schmidt orthogonalize        
-		DirectX::XMVECTOR xmTangent = XMVector3Normalize(XMVectorSubtract(t, XMVectorScale(n, XMVectorGetX(XMVector3Dot(n, t)))));
-
-		// Calculate handedness        
-		DirectX::XMVECTOR t2 = DirectX::XMLoadFloat3(&tan2[i]);
-		float handedness = (XMVectorGetX(XMVector3Dot(XMVector3Cross(n, t), t2)) < 0.0f) ? -1.0f : 1.0f;
-		xmTangent = DirectX::XMVectorSetW(xmTangent, handedness);
-		DirectX::XMStoreFloat4(&tangent[i], xmTangent);
-	}
-
-	GPUHeapUploader gpuHeapUploader(m_device, m_commandQueue);
-	scene->AddGPUBuffer(gpuHeapUploader.Upload(tangent.get(), verticesCount * sizeof(DirectX::XMFLOAT4)));
-}
\ No newline at end of file
+	int bufferId = AddSceneBuffer(scene, std::move(indicesData));
+	for (SubMeshLod& subMeshLod : subMesh.lods) subMeshLod.indicesBufferView.bufferId = bufferId;
+}
@@ -0,0 +1,83 @@
+#include "GeometryResidency.h"
+
+#include <algorithm>
+
+#include "using_directives.h"
+
+void GeometryResidency::Build(const tinygltf::Model& model)
+{
+	m_ranges.clear();
+	m_primitivesCount = 0;
+
+	std::vector<bool> isGeometryView(model.bufferViews.size(), false);
+	auto markAccessor = [&](const int accessorId)
+	{
+		if (accessorId < 0 || accessorId >= static_cast<int>(model.accessors.size())) return;
+		int bufferViewId = model.accessors[accessorId].bufferView;
+		if (bufferViewId >= 0 && bufferViewId < static_cast<int>(model.bufferViews.size())) isGeometryView[bufferViewId] = true;
+	};
+
+	for (const tinygltf::Mesh& mesh : model.meshes)
+	{
+		for (const tinygltf::Primitive& primitive : mesh.primitives)
+		{
+			m_primitivesCount++;
+			for (const auto& attribute : primitive.attributes) markAccessor(attribute.second);
+			markAccessor(primitive.indices);
+		}
+	}
+
+	for (size_t i = 0; i < model.bufferViews.size(); i++)
+	{
+		if (!isGeometryView[i]) continue;
+		const tinygltf::BufferView& bufferView = model.bufferViews[i];
+		m_ranges.push_back({ bufferView.buffer, bufferView.byteOffset, bufferView.byteLength });
+	}
+
+	// Merge the views that overlap or touch each other
+	std::sort(m_ranges.begin(), m_ranges.end(), [](const GeometryRange& a, const GeometryRange& b)
+	{
+		return a.bufferId != b.bufferId ? a.bufferId < b.bufferId : a.byteOffset < b.byteOffset;
+	});
+
+	std::vector<GeometryRange> merged;
+	for (const GeometryRange& range : m_ranges)
+	{
+		if (!merged.empty() && merged.back().bufferId == range.bufferId && range.byteOffset <= merged.back().byteOffset + merged.back().byteLength)
+		{
+			size_t end = (std::max)(merged.back().byteOffset + merged.back().byteLength, range.byteOffset + range.byteLength);
+			merged.back().byteLength = end - merged.back().byteOffset;
+		}
+		else merged.push_back(range);
+	}
+	m_ranges = std::move(merged);
+}
+
+const std::vector<GeometryRange>& GeometryResidency::GetRanges() const
+{
+	return m_ranges;
+}
+
+int GeometryResidency::FindRange(const int bufferId, const size_t byteOffset) const
+{
+	auto it = std::upper_bound(m_ranges.begin(), m_ranges.end(), std::make_pair(bufferId, byteOffset), [](const std::pair<int, size_t>& key, const GeometryRange& range)
+	{
+		return key.first != range.bufferId ? key.first < range.bufferId : key.second < range.byteOffset;
+	});
+	if (it == m_ranges.begin()) return -1;
+	--it;
+	if (it->bufferId != bufferId || byteOffset >= it->byteOffset + it->byteLength) return -1;
+	return static_cast<int>(it - m_ranges.begin());
+}
+
+size_t GeometryResidency::GetResidentBytes() const
+{
+	size_t bytes = 0;
+	for (const GeometryRange& range : m_ranges) bytes += range.byteLength;
+	return bytes;
+}
+
+size_t GeometryResidency::GetPrimitivesCount() const
+{
+	return m_primitivesCount;
+}
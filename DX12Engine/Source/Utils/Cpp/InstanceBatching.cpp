@@ -0,0 +1,55 @@
+#include "InstanceBatching.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+
+uint32_t AssignBatchKeys(const std::vector<BatchKey>& keys, std::vector<uint32_t>& keyIds)
+{
+	auto drawOrder = [&keys](const uint32_t a, const uint32_t b)
+	{
+		return std::tie(keys[a].materialId, keys[a].meshId, keys[a].subMeshId) < std::tie(keys[b].materialId, keys[b].meshId, keys[b].subMeshId);
+	};
+	std::vector<uint32_t> order(keys.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), drawOrder);
+
+	keyIds.assign(keys.size(), 0);
+	uint32_t keysCount = 0;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		if (i > 0 && drawOrder(order[i - 1], order[i])) keysCount++;
+		keyIds[order[i]] = keysCount;
+	}
+	return order.empty() ? 0 : keysCount + 1;
+}
+
+void InstanceBatcher::Build(const std::vector<uint32_t>& instances, const std::vector<uint32_t>& instanceKeys, const uint32_t keysCount)
+{
+	// Count the instances of each key, one batch per key with instances, then place each instance after the earlier ones of its key
+	m_keyOffsets.assign(keysCount, 0);
+	for (uint32_t instance : instances)
+	{
+		if (instance >= instanceKeys.size() || instanceKeys[instance] >= keysCount) throw std::invalid_argument("Instance without a key below the keys count");
+		m_keyOffsets[instanceKeys[instance]]++;
+	}
+
+	m_batches.clear();
+	uint32_t offset = 0;
+	for (uint32_t key = 0; key < keysCount; key++)
+	{
+		uint32_t count = m_keyOffsets[key];
+		m_keyOffsets[key] = offset;
+		if (count == 0) continue;
+		InstanceBatch batch;
+		batch.key = key;
+		batch.firstInstance = offset;
+		batch.instancesCount = count;
+		m_batches.push_back(batch);
+		offset += count;
+	}
+
+	m_instances.resize(instances.size());
+	for (uint32_t instance : instances) m_instances[m_keyOffsets[instanceKeys[instance]]++] = instance;
+}
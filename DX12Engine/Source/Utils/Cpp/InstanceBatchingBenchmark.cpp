@@ -0,0 +1,284 @@
+#include "Benchmark.h"
+#include "InstanceBatching.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const std::vector<size_t> DEFAULT_INSTANCING_INSTANCES = { 10000, 100000, 1000000 };
+	constexpr uint32_t INSTANCING_RANDOM_KEYS = 64;	// Submeshes of the random scenes, the batches count at most
+	constexpr int INSTANCING_REPETITIONS = 5;
+	constexpr size_t BOLT_NODES = 100000;
+
+	/** The submeshes drawn by the nodes of a scene: the key of each, for each node its submeshes are contiguous */
+	struct InstancingScene
+	{
+		std::vector<BatchKey> subMeshKeys;		// The key of each submesh of each mesh, meshes in order
+		std::vector<uint32_t> meshFirstSubMesh = { 0 };	// One more for the end
+		std::vector<uint32_t> nodeMeshes;
+		std::vector<uint32_t> entryKeys;		// The key number of each submesh of each node, the instances batched
+		std::vector<uint32_t> entryNodes;
+		std::vector<uint32_t> entrySubMeshes;	// The submesh of each entry in subMeshKeys
+		uint32_t keysCount = 0;
+	};
+
+	void AddMesh(InstancingScene& scene, const std::vector<uint32_t>& materials)
+	{
+		uint32_t meshId = static_cast<uint32_t>(scene.meshFirstSubMesh.size() - 1);
+		for (uint32_t s = 0; s < materials.size(); s++)
+		{
+			BatchKey key;
+			key.meshId = meshId;
+			key.subMeshId = s;
+			key.materialId = materials[s];
+			scene.subMeshKeys.push_back(key);
+		}
+		scene.meshFirstSubMesh.push_back(static_cast<uint32_t>(scene.subMeshKeys.size()));
+	}
+
+	/** Number the submesh keys and lay out the entries of the nodes, as Scene does when its nodes change */
+	void LayOut(InstancingScene& scene)
+	{
+		std::vector<uint32_t> keyIds;
+		scene.keysCount = AssignBatchKeys(scene.subMeshKeys, keyIds);
+		scene.entryKeys.clear();
+		scene.entryNodes.clear();
+		scene.entrySubMeshes.clear();
+		for (uint32_t nodeId = 0; nodeId < scene.nodeMeshes.size(); nodeId++)
+		{
+			uint32_t meshId = scene.nodeMeshes[nodeId];
+			for (uint32_t s = scene.meshFirstSubMesh[meshId]; s < scene.meshFirstSubMesh[meshId + 1]; s++)
+			{
+				scene.entryKeys.push_back(keyIds[s]);
+				scene.entryNodes.push_back(nodeId);
+				scene.entrySubMeshes.push_back(s);
+			}
+		}
+	}
+
+	/**
+	 * Check the batches of the visible entries against a stable sort by key: they must be in increasing key order, contiguous and not
+	 * empty, and hold the entries of their key in their visible order
+	 */
+	bool CheckBatches(const InstanceBatcher& batcher, const InstancingScene& scene, const std::vector<uint32_t>& visible)
+	{
+		std::vector<uint32_t> reference = visible;
+		std::stable_sort(reference.begin(), reference.end(), [&scene](const uint32_t a, const uint32_t b) { return scene.entryKeys[a] < scene.entryKeys[b]; });
+		bool isMatch = batcher.GetInstances() == reference;
+
+		uint32_t nextInstance = 0;
+		const std::vector<InstanceBatch>& batches = batcher.GetBatches();
+		for (size_t b = 0; b < batches.size(); b++)
+		{
+			const InstanceBatch& batch = batches[b];
+			isMatch &= batch.instancesCount > 0 && batch.firstInstance == nextInstance && (b == 0 || batches[b - 1].key < batch.key);
+			for (uint32_t i = batch.firstInstance; i < batch.firstInstance + batch.instancesCount && isMatch; i++) isMatch &= scene.entryKeys[batcher.GetInstances()[i]] == batch.key;
+			nextInstance += batch.instancesCount;
+		}
+		return isMatch && nextInstance == visible.size();
+	}
+
+	/** Hand checked keys: the draw order is by material, then mesh and submesh, and equal keys share their number */
+	bool CheckKeys()
+	{
+		const std::vector<BatchKey> keys = { { 0, 0, 2 }, { 0, 1, 1 }, { 1, 0, 1 }, { 2, 0, 0 }, { 0, 1, 1 }, { 1, 1, 0 } };
+		const std::vector<uint32_t> expectedIds = { 4, 2, 3, 1, 2, 0 };
+		std::vector<uint32_t> keyIds;
+		uint32_t keysCount = AssignBatchKeys(keys, keyIds);
+		bool isMatch = keysCount == 5 && keyIds == expectedIds;
+
+		// An instance whose key is not below the keys count is refused
+		bool isRefused = false;
+		InstanceBatcher batcher;
+		try
+		{
+			batcher.Build({ 0, 1 }, { 0, 5 }, 5);
+		}
+		catch (const std::invalid_argument&)
+		{
+			isRefused = true;
+		}
+		isMatch &= isRefused;
+
+		std::cout << "  \"keys\": { \"keysCount\": " << keysCount << ", \"badKeyRefused\": " << (isRefused ? "true" : "false")
+			<< ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+
+	/**
+	 * A bolt of two submeshes placed BOLT_NODES times beside a few small meshes, all visible then half of them: the draws must be one per
+	 * key of the visible submeshes. Report them against the previous drawing, one draw per submesh of each visible node, each with every
+	 * visible instance of its mesh
+	 */
+	bool CheckBolts()
+	{
+		InstancingScene scene;
+		AddMesh(scene, { 1, 2 });
+		for (uint32_t m = 0; m < 12; m++) AddMesh(scene, std::vector<uint32_t>(1 + m % 3, m % 4));
+		scene.nodeMeshes.assign(BOLT_NODES, 0);
+		for (uint32_t m = 1; m <= 12; m++) scene.nodeMeshes.insert(scene.nodeMeshes.end(), 10, m);
+		LayOut(scene);
+
+		bool isMatch = true;
+		std::mt19937 random(29);
+		InstanceBatcher batcher;
+		std::cout << "  \"bolts\": [" << std::endl;
+		for (int pass = 0; pass < 2; pass++)
+		{
+			std::vector<uint32_t> visible;
+			for (uint32_t i = 0; i < scene.entryKeys.size(); i++)
+			{
+				if (pass == 0 || random() % 2 == 0) visible.push_back(i);
+			}
+			auto start = std::chrono::steady_clock::now();
+			batcher.Build(visible, scene.entryKeys, scene.keysCount);
+			double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			std::set<uint32_t> visibleKeys;
+			for (uint32_t i : visible) visibleKeys.insert(scene.entryKeys[i]);
+			const std::vector<InstanceBatch>& batches = batcher.GetBatches();
+			size_t boltDraws = std::count_if(batches.begin(), batches.end(),
+				[&scene, &batcher](const InstanceBatch& batch) { return scene.entryNodes[batcher.GetInstances()[batch.firstInstance]] < BOLT_NODES; });
+			bool isPassMatch = CheckBatches(batcher, scene, visible) && batches.size() == visibleKeys.size() && boltDraws == 2;
+
+			// The previous drawing: each visible node drew the submeshes of its mesh visible from any node, with all the visible nodes of the mesh
+			std::vector<uint32_t> meshVisibleNodes(scene.meshFirstSubMesh.size() - 1, 0);
+			std::vector<uint8_t> isKeyVisible(scene.subMeshKeys.size(), 0), isNodeVisible(scene.nodeMeshes.size(), 0);
+			for (uint32_t i : visible)
+			{
+				uint32_t nodeId = scene.entryNodes[i], meshId = scene.nodeMeshes[nodeId];
+				if (!isNodeVisible[nodeId]) meshVisibleNodes[meshId]++;
+				isNodeVisible[nodeId] = 1;
+				isKeyVisible[scene.entrySubMeshes[i]] = 1;
+			}
+			double perNodeDraws = 0.0, perNodeInstances = 0.0;
+			for (uint32_t nodeId = 0; nodeId < scene.nodeMeshes.size(); nodeId++)
+			{
+				if (!isNodeVisible[nodeId]) continue;
+				uint32_t meshId = scene.nodeMeshes[nodeId];
+				for (uint32_t s = scene.meshFirstSubMesh[meshId]; s < scene.meshFirstSubMesh[meshId + 1]; s++)
+				{
+					if (!isKeyVisible[s]) continue;
+					perNodeDraws += 1.0;
+					perNodeInstances += meshVisibleNodes[meshId];
+				}
+			}
+
+			isMatch &= isPassMatch;
+			std::cout << std::fixed << std::setprecision(3)
+				<< "    { \"visible\": \"" << (pass == 0 ? "all" : "half") << "\", \"nodes\": " << scene.nodeMeshes.size() << ", \"instances\": " << visible.size()
+				<< ", \"draws\": " << batches.size() << ", \"boltDraws\": " << boltDraws
+				<< ", \"perNodeDraws\": " << std::setprecision(0) << perNodeDraws << ", \"perNodeInstancesDrawn\": " << perNodeInstances
+				<< ", \"buildMs\": " << std::setprecision(3) << buildMs << ", \"match\": " << (isPassMatch ? "true" : "false") << " }" << (pass == 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]," << std::endl;
+		return isMatch;
+	}
+
+	/**
+	 * Batch random scenes of each instances count over INSTANCING_RANDOM_KEYS submeshes, about half of them visible, and write a transposed
+	 * matrix per batched instance as Scene fills its instance buffer. The batches must match a stable sort by key
+	 */
+	bool CheckRandom(const std::vector<size_t>& instancesCounts)
+	{
+		bool isMatch = true;
+		std::mt19937 random(53);
+		InstanceBatcher batcher;
+		std::cout << "  \"random\": [" << std::endl;
+		for (size_t c = 0; c < instancesCounts.size(); c++)
+		{
+			InstancingScene scene;
+			for (uint32_t m = 0; m < INSTANCING_RANDOM_KEYS / 2; m++) AddMesh(scene, { m % 8, (m + 3) % 8 });
+			scene.nodeMeshes.resize(instancesCounts[c] / 2);
+			for (uint32_t& meshId : scene.nodeMeshes) meshId = random() % (INSTANCING_RANDOM_KEYS / 2);
+			LayOut(scene);
+
+			std::vector<uint32_t> visible;
+			for (uint32_t i = 0; i < scene.entryKeys.size(); i++)
+			{
+				if (random() % 2 == 0) visible.push_back(i);
+			}
+			std::vector<float> nodeMatrices(16 * scene.nodeMeshes.size());
+			for (float& value : nodeMatrices) value = static_cast<float>(random() % 1000) * 0.01f;
+			std::vector<float> instanceMatrices(16 * visible.size());
+
+			std::vector<double> buildMs, writeMs;
+			for (int r = 0; r < INSTANCING_REPETITIONS; r++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				batcher.Build(visible, scene.entryKeys, scene.keysCount);
+				buildMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+				start = std::chrono::steady_clock::now();
+				const std::vector<uint32_t>& instances = batcher.GetInstances();
+				for (size_t i = 0; i < instances.size(); i++)
+				{
+					const float* m = &nodeMatrices[16 * static_cast<size_t>(scene.entryNodes[instances[i]])];
+					for (int row = 0; row < 4; row++)
+					{
+						for (int column = 0; column < 4; column++) instanceMatrices[16 * i + 4 * column + row] = m[4 * row + column];
+					}
+				}
+				writeMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			}
+			std::sort(buildMs.begin(), buildMs.end());
+			std::sort(writeMs.begin(), writeMs.end());
+
+			bool isCountMatch = CheckBatches(batcher, scene, visible);
+			isMatch &= isCountMatch;
+			double build = buildMs[buildMs.size() / 2], write = writeMs[writeMs.size() / 2];
+			std::cout << std::fixed << std::setprecision(3)
+				<< "    { \"instances\": " << scene.entryKeys.size() << ", \"visible\": " << visible.size() << ", \"draws\": " << batcher.GetBatches().size()
+				<< ", \"buildMs\": " << build << ", \"buildMInstancesPerSecond\": " << visible.size() / ((std::max)(build, 1e-6) * 1000.0)
+				<< ", \"writeMs\": " << write << ", \"match\": " << (isCountMatch ? "true" : "false") << " }"
+				<< (c == instancesCounts.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]" << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunInstanceBatching(const std::vector<std::string>& args)
+	{
+		std::vector<size_t> instancesCounts;
+		for (const std::string& arg : args)
+		{
+			if (arg.empty() || !std::all_of(arg.begin(), arg.end(), ::isdigit)) throw std::invalid_argument("Expected an instances count: " + arg);
+			instancesCounts.push_back(std::stoul(arg));
+		}
+		if (instancesCounts.empty()) instancesCounts = DEFAULT_INSTANCING_INSTANCES;
+
+		std::cout << "{" << std::endl;
+		bool isMatch = CheckKeys();
+		isMatch &= CheckBolts();
+		isMatch &= CheckRandom(instancesCounts);
+		std::cout << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef INSTANCE_BATCHING_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunInstanceBatching({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
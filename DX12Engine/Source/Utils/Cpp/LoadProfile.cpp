@@ -0,0 +1,81 @@
+#include "LoadProfile.h"
+
+#include <iomanip>
+#include <sstream>
+
+thread_local ScopedPhase* ScopedPhase::s_current = nullptr;
+
+void LoadProfile::Clear()
+{
+	m_phases.clear();
+}
+
+void LoadProfile::Add(const std::string& name, const double milliseconds, const size_t bytes)
+{
+	for (LoadPhase& phase : m_phases)
+	{
+		if (phase.name != name) continue;
+		phase.milliseconds += milliseconds;
+		phase.bytes += bytes;
+		phase.calls++;
+		return;
+	}
+	m_phases.push_back({ name, milliseconds, bytes, 1 });
+}
+
+const std::vector<LoadPhase>& LoadProfile::GetPhases() const
+{
+	return m_phases;
+}
+
+const LoadPhase* LoadProfile::FindPhase(const std::string& name) const
+{
+	for (const LoadPhase& phase : m_phases)
+	{
+		if (phase.name == name) return &phase;
+	}
+	return nullptr;
+}
+
+double LoadProfile::GetTotalMilliseconds() const
+{
+	double milliseconds = 0.0;
+	for (const LoadPhase& phase : m_phases) milliseconds += phase.milliseconds;
+	return milliseconds;
+}
+
+std::string LoadProfile::ToJson() const
+{
+	std::ostringstream json;
+	json << std::fixed << std::setprecision(3) << "{ ";
+	for (size_t i = 0; i < m_phases.size(); i++)
+	{
+		json << "\"" << m_phases[i].name << "\": { \"ms\": " << m_phases[i].milliseconds << ", \"bytes\": " << m_phases[i].bytes
+			<< ", \"calls\": " << m_phases[i].calls << " }" << (i == m_phases.size() - 1 ? "" : ", ");
+	}
+	json << " }";
+	return json.str();
+}
+
+ScopedPhase::ScopedPhase(LoadProfile* profile, const char* name, const size_t bytes)
+	: m_profile(profile), m_name(name), m_bytes(bytes)
+{
+	if (m_profile == nullptr) return;
+	m_parent = s_current;
+	s_current = this;
+	m_start = std::chrono::steady_clock::now();
+}
+
+ScopedPhase::~ScopedPhase()
+{
+	if (m_profile == nullptr) return;
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+	s_current = m_parent;
+	if (m_parent != nullptr) m_parent->m_nestedMilliseconds += milliseconds;
+	m_profile->Add(m_name, milliseconds - m_nestedMilliseconds, m_bytes);
+}
+
+void ScopedPhase::AddBytes(const size_t bytes)
+{
+	m_bytes += bytes;
+}
@@ -0,0 +1,53 @@
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const std::string& fileName)
+{
+	m_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE) { DXUtil::ThrowException("Cannot open file " + fileName); }
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(m_file);
+		DXUtil::ThrowException("Cannot map empty file " + fileName);
+	}
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == NULL)
+	{
+		CloseHandle(m_file);
+		DXUtil::ThrowException("Cannot create file mapping for " + fileName);
+	}
+
+	m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_data == nullptr)
+	{
+		CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		DXUtil::ThrowException("Cannot map view of file " + fileName);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data) UnmapViewOfFile(m_data);
+	if (m_mapping) CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+}
+
+ByteSpan MappedFile::GetData() const
+{
+	return { m_data, m_size };
+}
+
+ByteSpan MappedFile::GetRange(const size_t byteOffset, const size_t byteLength) const
+{
+	if (byteOffset > m_size || byteLength > m_size - byteOffset) { DXUtil::ThrowException("Range out of the mapped file"); }
+	return { m_data + byteOffset, byteLength };
+}
+
+size_t MappedFile::GetSize() const
+{
+	return m_size;
+}
@@ -0,0 +1,805 @@
+#include "MeshBVH.h"
+
+#include "MeshStreams.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MESH_BVH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	constexpr size_t MAX_BINS = 64;
+	constexpr size_t PARALLEL_BINNING_SIZE = 1 << 16;	// Nodes of more primitives are binned in chunks on the pool threads
+	constexpr size_t BINNING_CHUNK_SIZE = 1 << 14;
+	constexpr size_t MIN_SUBTREE_TASK_SIZE = 1 << 12;	// Smaller subtrees are built by the task of their parent
+	constexpr size_t MAX_SAH_DEPTH = 48;				// Deeper nodes are split in halves, so that a traversal stack never overflows
+	constexpr size_t STACK_SIZE = 96;
+	constexpr size_t RAYS_PER_TASK = 256;
+
+	struct BuildPrimitive
+	{
+		BoundingBox bounds;
+		float centroid[3];
+	};
+
+	struct Bin
+	{
+		BoundingBox bounds;
+		size_t count = 0;
+	};
+
+	struct Split
+	{
+		int axis = -1;
+		size_t bin = 0;
+		float cost = (std::numeric_limits<float>::max)();
+	};
+
+	/** A node whose subtree is built by a pool task, in its own node array spliced in afterwards */
+	struct SubtreeTask
+	{
+		uint32_t node;
+		size_t first;
+		size_t count;
+		size_t depth;
+	};
+
+	/** Half the surface area: the relative probability of a random ray hitting the box */
+	float GetHalfArea(const BoundingBox& box)
+	{
+		if (box.IsEmpty()) return 0.0f;
+		float dx = box.max[0] - box.min[0], dy = box.max[1] - box.min[1], dz = box.max[2] - box.min[2];
+		return dx * dy + dy * dz + dz * dx;
+	}
+
+	void ValidateOptions(const BVHOptions& options)
+	{
+		if (options.binsCount < 2 || options.binsCount > MAX_BINS || options.maxLeafPrimitives == 0 || !(options.traversalCost >= 0.0f))
+		{
+			throw std::invalid_argument("Invalid BVH options");
+		}
+	}
+
+	/** Build the hierarchy of primitives, reordering order; the slots of a leaf are contiguous in order */
+	class HierarchyBuilder
+	{
+	public:
+		HierarchyBuilder(const std::vector<BuildPrimitive>& primitives, const BVHOptions& options, ThreadPool& pool)
+			: m_primitives(primitives), m_options(options), m_pool(pool)
+		{
+		}
+
+		void Build(std::vector<BVHNode>& nodes, std::vector<uint32_t>& order)
+		{
+			const size_t count = m_primitives.size();
+			m_order.resize(count);
+			std::iota(m_order.begin(), m_order.end(), 0u);
+			nodes.clear();
+			if (count == 0)
+			{
+				order.clear();
+				return;
+			}
+
+			// Split the upper nodes here, binning them on the pool threads, down to subtrees small enough to be one task each
+			size_t threadsCount = m_pool.GetThreadsCount();
+			bool isParallel = threadsCount > 1 && count >= 2 * MIN_SUBTREE_TASK_SIZE;
+			size_t taskSize = (std::max)(MIN_SUBTREE_TASK_SIZE, count / (4 * threadsCount));
+			std::vector<SubtreeTask> tasks;
+			nodes.reserve(2 * count / (std::max)(m_options.maxLeafPrimitives / 2, size_t(1)));
+			nodes.resize(1);
+			BuildNode(nodes, 0, 0, count, 0, isParallel, isParallel ? &tasks : nullptr, taskSize);
+
+			std::vector<std::vector<BVHNode>> subtrees(tasks.size());
+			m_pool.ParallelFor(tasks.size(), [&](size_t t)
+			{
+				subtrees[t].resize(1);
+				BuildNode(subtrees[t], 0, tasks[t].first, tasks[t].count, tasks[t].depth, false, nullptr, 0);
+			});
+
+			// The subtree root takes the place of its task node, the other nodes are appended: child indices move by the same offset
+			for (size_t t = 0; t < tasks.size(); t++)
+			{
+				uint32_t offset = static_cast<uint32_t>(nodes.size()) - 1;
+				auto move = [offset](BVHNode node)
+				{
+					if (!node.IsLeaf()) node.firstChildOrPrimitive += offset;
+					return node;
+				};
+				nodes[tasks[t].node] = move(subtrees[t][0]);
+				for (size_t i = 1; i < subtrees[t].size(); i++) nodes.push_back(move(subtrees[t][i]));
+			}
+			order = std::move(m_order);
+		}
+
+	private:
+		void BuildNode(std::vector<BVHNode>& nodes, const uint32_t nodeId, const size_t first, const size_t count, const size_t depth,
+			const bool isParallel, std::vector<SubtreeTask>* tasks, const size_t taskSize)
+		{
+			BoundingBox bounds, centroidBounds;
+			ComputeBounds(first, count, isParallel, bounds, centroidBounds);
+			std::copy(bounds.min, bounds.min + 3, nodes[nodeId].boundsMin);
+			std::copy(bounds.max, bounds.max + 3, nodes[nodeId].boundsMax);
+
+			Split split;
+			if (count > 1 && depth < MAX_SAH_DEPTH) split = FindSplit(first, count, bounds, centroidBounds, isParallel);
+			if (count == 1 || (count <= m_options.maxLeafPrimitives && (split.axis < 0 || split.cost >= static_cast<float>(count))))
+			{
+				nodes[nodeId].firstChildOrPrimitive = static_cast<uint32_t>(first);
+				nodes[nodeId].primitivesCount = static_cast<uint32_t>(count);
+				return;
+			}
+
+			size_t middle = first + count / 2;
+			if (split.axis >= 0)
+			{
+				const int axis = split.axis;
+				const float scale = GetBinScale(centroidBounds, axis);
+				auto isLeft = [&](uint32_t p) { return GetBin(m_primitives[p].centroid[axis], centroidBounds.min[axis], scale) < split.bin; };
+				middle = std::partition(m_order.begin() + first, m_order.begin() + first + count, isLeft) - m_order.begin();
+			}
+			else
+			{
+				// Coincident centroids or too deep: split the slots in halves, along the longest centroid axis when there is one
+				int axis = 0;
+				for (int k = 1; k < 3; k++)
+				{
+					if (centroidBounds.max[k] - centroidBounds.min[k] > centroidBounds.max[axis] - centroidBounds.min[axis]) axis = k;
+				}
+				std::nth_element(m_order.begin() + first, m_order.begin() + middle, m_order.begin() + first + count,
+					[&](uint32_t a, uint32_t b) { return m_primitives[a].centroid[axis] < m_primitives[b].centroid[axis]; });
+			}
+
+			uint32_t firstChild = static_cast<uint32_t>(nodes.size());
+			nodes.resize(nodes.size() + 2);
+			nodes[nodeId].firstChildOrPrimitive = firstChild;
+			nodes[nodeId].primitivesCount = 0;
+
+			const size_t childFirsts[2] = { first, middle };
+			const size_t childCounts[2] = { middle - first, first + count - middle };
+			for (size_t c = 0; c < 2; c++)
+			{
+				if (tasks && childCounts[c] <= taskSize) tasks->push_back({ firstChild + static_cast<uint32_t>(c), childFirsts[c], childCounts[c], depth + 1 });
+				else BuildNode(nodes, firstChild + static_cast<uint32_t>(c), childFirsts[c], childCounts[c], depth + 1, isParallel, tasks, taskSize);
+			}
+		}
+
+		/** Bounds of the primitives and of their centroids in the slots [first, first + count) */
+		void ComputeBounds(const size_t first, const size_t count, const bool isParallel, BoundingBox& bounds, BoundingBox& centroidBounds) const
+		{
+			auto add = [this](size_t begin, size_t end, BoundingBox& b, BoundingBox& c)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					const BuildPrimitive& primitive = m_primitives[m_order[i]];
+					b.Add(primitive.bounds);
+					c.Add(primitive.centroid);
+				}
+			};
+			if (!isParallel || count < PARALLEL_BINNING_SIZE)
+			{
+				add(first, first + count, bounds, centroidBounds);
+				return;
+			}
+
+			size_t chunksCount = (count + BINNING_CHUNK_SIZE - 1) / BINNING_CHUNK_SIZE;
+			std::vector<BoundingBox> chunkBounds(chunksCount), chunkCentroidBounds(chunksCount);
+			m_pool.ParallelFor(chunksCount, [&](size_t c)
+			{
+				size_t begin = first + c * BINNING_CHUNK_SIZE;
+				add(begin, (std::min)(begin + BINNING_CHUNK_SIZE, first + count), chunkBounds[c], chunkCentroidBounds[c]);
+			});
+			for (size_t c = 0; c < chunksCount; c++)
+			{
+				bounds.Add(chunkBounds[c]);
+				centroidBounds.Add(chunkCentroidBounds[c]);
+			}
+		}
+
+		float GetBinScale(const BoundingBox& centroidBounds, const int axis) const
+		{
+			return static_cast<float>(m_options.binsCount) / (centroidBounds.max[axis] - centroidBounds.min[axis]);
+		}
+
+		size_t GetBin(const float centroid, const float min, const float scale) const
+		{
+			float bin = (centroid - min) * scale;
+			return (std::min)(static_cast<size_t>((std::max)(bin, 0.0f)), m_options.binsCount - 1);
+		}
+
+		void ComputeBins(const size_t first, const size_t count, const int axis, const BoundingBox& centroidBounds, const bool isParallel, Bin* bins) const
+		{
+			const float scale = GetBinScale(centroidBounds, axis);
+			auto add = [&](size_t begin, size_t end, Bin* b)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					const BuildPrimitive& primitive = m_primitives[m_order[i]];
+					Bin& bin = b[GetBin(primitive.centroid[axis], centroidBounds.min[axis], scale)];
+					bin.bounds.Add(primitive.bounds);
+					bin.count++;
+				}
+			};
+			if (!isParallel || count < PARALLEL_BINNING_SIZE)
+			{
+				add(first, first + count, bins);
+				return;
+			}
+
+			size_t chunksCount = (count + BINNING_CHUNK_SIZE - 1) / BINNING_CHUNK_SIZE;
+			std::vector<Bin> chunkBins(chunksCount * m_options.binsCount);
+			m_pool.ParallelFor(chunksCount, [&](size_t c)
+			{
+				size_t begin = first + c * BINNING_CHUNK_SIZE;
+				add(begin, (std::min)(begin + BINNING_CHUNK_SIZE, first + count), &chunkBins[c * m_options.binsCount]);
+			});
+			for (size_t c = 0; c < chunksCount; c++)
+			{
+				for (size_t b = 0; b < m_options.binsCount; b++)
+				{
+					bins[b].bounds.Add(chunkBins[c * m_options.binsCount + b].bounds);
+					bins[b].count += chunkBins[c * m_options.binsCount + b].count;
+				}
+			}
+		}
+
+		/** The cheapest bin border of the three axes: traversalCost + (areaLeft * countLeft + areaRight * countRight) / area */
+		Split FindSplit(const size_t first, const size_t count, const BoundingBox& bounds, const BoundingBox& centroidBounds, const bool isParallel) const
+		{
+			const size_t binsCount = m_options.binsCount;
+			Split best;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (!(centroidBounds.max[axis] > centroidBounds.min[axis])) continue;
+				Bin bins[MAX_BINS];
+				ComputeBins(first, count, axis, centroidBounds, isParallel, bins);
+
+				float rightAreas[MAX_BINS];
+				size_t rightCounts[MAX_BINS];
+				BoundingBox right;
+				size_t rightCount = 0;
+				for (size_t b = binsCount - 1; b > 0; b--)
+				{
+					right.Add(bins[b].bounds);
+					rightCount += bins[b].count;
+					rightAreas[b] = GetHalfArea(right);
+					rightCounts[b] = rightCount;
+				}
+
+				BoundingBox left;
+				size_t leftCount = 0;
+				for (size_t b = 1; b < binsCount; b++)
+				{
+					left.Add(bins[b - 1].bounds);
+					leftCount += bins[b - 1].count;
+					if (leftCount == 0 || rightCounts[b] == 0) continue;
+					float cost = GetHalfArea(left) * leftCount + rightAreas[b] * rightCounts[b];
+					if (cost < best.cost) best = { axis, b, cost };
+				}
+			}
+			if (best.axis < 0) return best;
+
+			float area = GetHalfArea(bounds);
+			best.cost = m_options.traversalCost + (area > 0.0f ? best.cost / area : static_cast<float>(count));
+			return best;
+		}
+
+		const std::vector<BuildPrimitive>& m_primitives;
+		const BVHOptions& m_options;
+		ThreadPool& m_pool;
+		std::vector<uint32_t> m_order;
+	};
+
+	/** The node and leaf counts, the depth and the expected cost of a ray hitting the root, each node weighted by its area */
+	BVHReport GetReport(const std::vector<BVHNode>& nodes, const float traversalCost)
+	{
+		BVHReport report;
+		if (nodes.empty()) return report;
+		auto getArea = [](const BVHNode& node)
+		{
+			BoundingBox box;
+			box.Add(node.boundsMin);
+			box.Add(node.boundsMax);
+			return GetHalfArea(box);
+		};
+		float rootArea = getArea(nodes[0]);
+
+		report.nodesCount = nodes.size();
+		std::vector<std::pair<uint32_t, size_t>> stack = { { 0u, size_t(1) } };
+		while (!stack.empty())
+		{
+			auto [nodeId, depth] = stack.back();
+			stack.pop_back();
+			const BVHNode& node = nodes[nodeId];
+			report.maxDepth = (std::max)(report.maxDepth, depth);
+			double weight = rootArea > 0.0f ? getArea(node) / rootArea : 1.0;
+			if (node.IsLeaf())
+			{
+				report.leavesCount++;
+				report.primitivesCount += node.primitivesCount;
+				report.sahCost += weight * node.primitivesCount;
+				continue;
+			}
+			report.sahCost += weight * traversalCost;
+			stack.push_back({ node.firstChildOrPrimitive, depth + 1 });
+			stack.push_back({ node.firstChildOrPrimitive + 1, depth + 1 });
+		}
+		return report;
+	}
+
+	/** A ray with the reciprocals of its direction for the slab tests */
+	struct RayData
+	{
+		float origin[3];
+		float direction[3];
+		float inverseDirection[3];
+		float tMin;
+	};
+
+	RayData GetRayData(const Ray& ray)
+	{
+		RayData r;
+		for (int k = 0; k < 3; k++)
+		{
+			r.origin[k] = ray.origin[k];
+			r.direction[k] = ray.direction[k];
+			r.inverseDirection[k] = 1.0f / ray.direction[k];
+		}
+		r.tMin = ray.tMin;
+		return r;
+	}
+
+	bool IntersectBox(const BVHNode& node, const RayData& r, const float tMax, float& tNear)
+	{
+		float t0 = r.tMin, t1 = tMax;
+		for (int k = 0; k < 3; k++)
+		{
+			float a = (node.boundsMin[k] - r.origin[k]) * r.inverseDirection[k];
+			float b = (node.boundsMax[k] - r.origin[k]) * r.inverseDirection[k];
+			if (a > b) std::swap(a, b);
+			t0 = (std::max)(t0, a);
+			t1 = (std::min)(t1, b);
+		}
+		tNear = t0;
+		return t0 <= t1;
+	}
+
+	/** Möller-Trumbore on both faces of the triangle p0 p1 p2, nine floats */
+	bool IntersectTriangle(const float* p, const RayData& r, const float tMax, float& t, float& u, float& v)
+	{
+		float e1[3] = { p[3] - p[0], p[4] - p[1], p[5] - p[2] };
+		float e2[3] = { p[6] - p[0], p[7] - p[1], p[8] - p[2] };
+		float q[3] = { r.direction[1] * e2[2] - r.direction[2] * e2[1], r.direction[2] * e2[0] - r.direction[0] * e2[2], r.direction[0] * e2[1] - r.direction[1] * e2[0] };
+		float det = e1[0] * q[0] + e1[1] * q[1] + e1[2] * q[2];
+		if (det == 0.0f) return false;
+		float inverseDet = 1.0f / det;
+		float s[3] = { r.origin[0] - p[0], r.origin[1] - p[1], r.origin[2] - p[2] };
+		u = (s[0] * q[0] + s[1] * q[1] + s[2] * q[2]) * inverseDet;
+		if (!(u >= 0.0f && u <= 1.0f)) return false;
+		float w[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+		v = (r.direction[0] * w[0] + r.direction[1] * w[1] + r.direction[2] * w[2]) * inverseDet;
+		if (!(v >= 0.0f && u + v <= 1.0f)) return false;
+		t = (e2[0] * w[0] + e2[1] * w[1] + e2[2] * w[2]) * inverseDet;
+		return t >= r.tMin && t < tMax;
+	}
+
+	/**
+	 * Walk the hierarchy nodes front to back with ray, calling intersectLeaf(first, count, tMax) on the leaves it reaches;
+	 * the leaf returns the new tMax, lower when it found a nearer hit
+	 */
+	template <typename IntersectLeaf>
+	void Traverse(const std::vector<BVHNode>& nodes, const RayData& r, float tMax, const IntersectLeaf& intersectLeaf)
+	{
+		float tNear;
+		if (nodes.empty() || !IntersectBox(nodes[0], r, tMax, tNear)) return;
+		uint32_t stack[STACK_SIZE];
+		size_t stackSize = 0;
+		uint32_t nodeId = 0;
+		for (;;)
+		{
+			const BVHNode& node = nodes[nodeId];
+			if (node.IsLeaf())
+			{
+				tMax = intersectLeaf(node.firstChildOrPrimitive, node.primitivesCount, tMax);
+				if (stackSize == 0) return;
+				nodeId = stack[--stackSize];
+				continue;
+			}
+
+			uint32_t nearChild = node.firstChildOrPrimitive, farChild = nearChild + 1;
+			float tNear0, tNear1;
+			bool hit0 = IntersectBox(nodes[nearChild], r, tMax, tNear0), hit1 = IntersectBox(nodes[farChild], r, tMax, tNear1);
+			if (hit0 && hit1)
+			{
+				if (tNear1 < tNear0) std::swap(nearChild, farChild);
+				stack[stackSize++] = farChild;
+				nodeId = nearChild;
+			}
+			else if (hit0) nodeId = nearChild;
+			else if (hit1) nodeId = farChild;
+			else if (stackSize == 0) return;
+			else nodeId = stack[--stackSize];
+		}
+	}
+
+	bool InvertAffine(const float m[16], std::array<float, 16>& inverse)
+	{
+		double a[3][3];
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++) a[i][j] = m[4 * i + j];
+		}
+		double c[3][3] = {
+			{ a[1][1] * a[2][2] - a[1][2] * a[2][1], a[0][2] * a[2][1] - a[0][1] * a[2][2], a[0][1] * a[1][2] - a[0][2] * a[1][1] },
+			{ a[1][2] * a[2][0] - a[1][0] * a[2][2], a[0][0] * a[2][2] - a[0][2] * a[2][0], a[0][2] * a[1][0] - a[0][0] * a[1][2] },
+			{ a[1][0] * a[2][1] - a[1][1] * a[2][0], a[0][1] * a[2][0] - a[0][0] * a[2][1], a[0][0] * a[1][1] - a[0][1] * a[1][0] } };
+		double det = a[0][0] * c[0][0] + a[0][1] * c[1][0] + a[0][2] * c[2][0];
+		if (!std::isfinite(det) || std::fabs(det) < 1e-30) return false;
+
+		// The model point of a world point p is (p - translation) * inverse(upper 3x3)
+		inverse.fill(0.0f);
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++) inverse[4 * i + j] = static_cast<float>(c[i][j] / det);
+		}
+		for (int j = 0; j < 3; j++)
+		{
+			double t = 0.0;
+			for (int i = 0; i < 3; i++) t -= m[12 + i] * c[i][j] / det;
+			inverse[12 + j] = static_cast<float>(t);
+		}
+		inverse[15] = 1.0f;
+		return true;
+	}
+
+	Ray TransformRay(const Ray& ray, const std::array<float, 16>& m)
+	{
+		Ray transformed = ray;
+		for (int j = 0; j < 3; j++)
+		{
+			transformed.origin[j] = m[12 + j];
+			transformed.direction[j] = 0.0f;
+			for (int i = 0; i < 3; i++)
+			{
+				transformed.origin[j] += ray.origin[i] * m[4 * i + j];
+				transformed.direction[j] += ray.direction[i] * m[4 * i + j];
+			}
+		}
+		return transformed;
+	}
+
+#ifdef MESH_BVH_SSE2
+	/** Four rays in structure of arrays, the lanes past the last ray never hit anything */
+	struct RayPacket
+	{
+		__m128 origin[3];
+		__m128 direction[3];
+		__m128 inverseDirection[3];
+		__m128 tMin;
+	};
+
+	__m128 IntersectBox4(const BVHNode& node, const RayPacket& r, const __m128 tMax, __m128& tNear)
+	{
+		__m128 t0 = r.tMin, t1 = tMax;
+		for (int k = 0; k < 3; k++)
+		{
+			__m128 a = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin[k]), r.origin[k]), r.inverseDirection[k]);
+			__m128 b = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax[k]), r.origin[k]), r.inverseDirection[k]);
+			t0 = _mm_max_ps(t0, _mm_min_ps(a, b));
+			t1 = _mm_min_ps(t1, _mm_max_ps(a, b));
+		}
+		tNear = t0;
+		return _mm_cmple_ps(t0, t1);
+	}
+
+	__m128 Select(const __m128 mask, const __m128 a, const __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	/** IntersectTriangle on four rays, with the same operations so that a lane finds what the single ray does */
+	__m128 IntersectTriangle4(const float* p, const RayPacket& r, const __m128 tMax, __m128& t, __m128& u, __m128& v)
+	{
+		__m128 e1[3], e2[3], s[3];
+		for (int k = 0; k < 3; k++)
+		{
+			e1[k] = _mm_set1_ps(p[3 + k] - p[k]);
+			e2[k] = _mm_set1_ps(p[6 + k] - p[k]);
+			s[k] = _mm_sub_ps(r.origin[k], _mm_set1_ps(p[k]));
+		}
+		const __m128* d = r.direction;
+		__m128 q[3] = {
+			_mm_sub_ps(_mm_mul_ps(d[1], e2[2]), _mm_mul_ps(d[2], e2[1])),
+			_mm_sub_ps(_mm_mul_ps(d[2], e2[0]), _mm_mul_ps(d[0], e2[2])),
+			_mm_sub_ps(_mm_mul_ps(d[0], e2[1]), _mm_mul_ps(d[1], e2[0])) };
+		__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1[0], q[0]), _mm_mul_ps(e1[1], q[1])), _mm_mul_ps(e1[2], q[2]));
+		__m128 inverseDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+		u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(s[0], q[0]), _mm_mul_ps(s[1], q[1])), _mm_mul_ps(s[2], q[2])), inverseDet);
+		__m128 w[3] = {
+			_mm_sub_ps(_mm_mul_ps(s[1], e1[2]), _mm_mul_ps(s[2], e1[1])),
+			_mm_sub_ps(_mm_mul_ps(s[2], e1[0]), _mm_mul_ps(s[0], e1[2])),
+			_mm_sub_ps(_mm_mul_ps(s[0], e1[1]), _mm_mul_ps(s[1], e1[0])) };
+		v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(d[0], w[0]), _mm_mul_ps(d[1], w[1])), _mm_mul_ps(d[2], w[2])), inverseDet);
+		t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2[0], w[0]), _mm_mul_ps(e2[1], w[1])), _mm_mul_ps(e2[2], w[2])), inverseDet);
+
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+		__m128 mask = _mm_cmpneq_ps(det, zero);
+		mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+		mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), one)));
+		return _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(t, r.tMin), _mm_cmplt_ps(t, tMax)));
+	}
+
+	void IntersectPacket(const TriangleBVH& bvh, const Ray* rays, const size_t count, RayHit* hits)
+	{
+		alignas(16) float data[10][4];
+		alignas(16) float limits[4];
+		for (size_t lane = 0; lane < 4; lane++)
+		{
+			// Padding lanes start with tMin above tMax: their boxes tests always fail
+			bool isRay = lane < count;
+			for (int k = 0; k < 3; k++)
+			{
+				data[k][lane] = isRay ? rays[lane].origin[k] : 0.0f;
+				data[3 + k][lane] = isRay ? rays[lane].direction[k] : 1.0f;
+				data[6 + k][lane] = 1.0f / data[3 + k][lane];
+			}
+			data[9][lane] = isRay ? rays[lane].tMin : 1.0f;
+			limits[lane] = isRay ? (std::min)(rays[lane].tMax, hits[lane].t) : 0.0f;
+		}
+		RayPacket r;
+		for (int k = 0; k < 3; k++)
+		{
+			r.origin[k] = _mm_load_ps(data[k]);
+			r.direction[k] = _mm_load_ps(data[3 + k]);
+			r.inverseDirection[k] = _mm_load_ps(data[6 + k]);
+		}
+		r.tMin = _mm_load_ps(data[9]);
+		__m128 tMax = _mm_load_ps(limits), hitU = _mm_setzero_ps(), hitV = _mm_setzero_ps();
+		__m128i hitSlots = _mm_set1_epi32(-1);
+
+		__m128 tNear;
+		if (_mm_movemask_ps(IntersectBox4(bvh.nodes[0], r, tMax, tNear)) == 0) return;
+		uint32_t stack[STACK_SIZE];
+		size_t stackSize = 0;
+		uint32_t nodeId = 0;
+		for (;;)
+		{
+			const BVHNode& node = bvh.nodes[nodeId];
+			if (node.IsLeaf())
+			{
+				for (uint32_t slot = node.firstChildOrPrimitive; slot < node.firstChildOrPrimitive + node.primitivesCount; slot++)
+				{
+					__m128 t, u, v;
+					__m128 mask = IntersectTriangle4(&bvh.vertices[9 * static_cast<size_t>(slot)], r, tMax, t, u, v);
+					if (_mm_movemask_ps(mask) == 0) continue;
+					tMax = Select(mask, t, tMax);
+					hitU = Select(mask, u, hitU);
+					hitV = Select(mask, v, hitV);
+					__m128i slotMask = _mm_castps_si128(mask);
+					hitSlots = _mm_or_si128(_mm_and_si128(slotMask, _mm_set1_epi32(static_cast<int>(slot))), _mm_andnot_si128(slotMask, hitSlots));
+				}
+				if (stackSize == 0) break;
+				nodeId = stack[--stackSize];
+				continue;
+			}
+
+			uint32_t nearChild = node.firstChildOrPrimitive, farChild = nearChild + 1;
+			__m128 tNear0, tNear1;
+			__m128 mask0 = IntersectBox4(bvh.nodes[nearChild], r, tMax, tNear0), mask1 = IntersectBox4(bvh.nodes[farChild], r, tMax, tNear1);
+			bool hit0 = _mm_movemask_ps(mask0) != 0, hit1 = _mm_movemask_ps(mask1) != 0;
+			if (hit0 && hit1)
+			{
+				// Visit first the child nearest to the rays that hit it
+				const __m128 infinity = _mm_set1_ps((std::numeric_limits<float>::infinity)());
+				alignas(16) float near0[4], near1[4];
+				_mm_store_ps(near0, Select(mask0, tNear0, infinity));
+				_mm_store_ps(near1, Select(mask1, tNear1, infinity));
+				if ((std::min)({ near1[0], near1[1], near1[2], near1[3] }) < (std::min)({ near0[0], near0[1], near0[2], near0[3] })) std::swap(nearChild, farChild);
+				stack[stackSize++] = farChild;
+				nodeId = nearChild;
+			}
+			else if (hit0) nodeId = nearChild;
+			else if (hit1) nodeId = farChild;
+			else if (stackSize == 0) break;
+			else nodeId = stack[--stackSize];
+		}
+
+		alignas(16) float ts[4], us[4], vs[4];
+		alignas(16) int32_t slots[4];
+		_mm_store_ps(ts, tMax);
+		_mm_store_ps(us, hitU);
+		_mm_store_ps(vs, hitV);
+		_mm_store_si128(reinterpret_cast<__m128i*>(slots), hitSlots);
+		for (size_t lane = 0; lane < count; lane++)
+		{
+			if (slots[lane] < 0) continue;
+			hits[lane].t = ts[lane];
+			hits[lane].u = us[lane];
+			hits[lane].v = vs[lane];
+			hits[lane].triangle = bvh.triangles[slots[lane]];
+		}
+	}
+#endif
+}
+
+void BVHReport::Add(const BVHReport& report)
+{
+	meshesCount += report.meshesCount;
+	primitivesCount += report.primitivesCount;
+	nodesCount += report.nodesCount;
+	leavesCount += report.leavesCount;
+	maxDepth = (std::max)(maxDepth, report.maxDepth);
+	sahCost += report.sahCost;
+}
+
+BVHReport BuildTriangleBVH(const MeshStreams& mesh, const BVHOptions& options, ThreadPool& pool, TriangleBVH& bvh)
+{
+	bvh = TriangleBVH();
+	ValidateOptions(options);
+	if (mesh.indices.size() % 3 != 0) throw std::invalid_argument("The indices are not a triangle list");
+	const VertexStream* positions = mesh.Find("POSITION");
+	if (!positions || positions->elementsCount != 3) throw std::invalid_argument("The mesh has no positions");
+	for (const uint32_t v : mesh.indices)
+	{
+		if (v >= mesh.verticesCount) throw std::invalid_argument("Index out of the vertices range");
+	}
+
+	const bool isIndexed = !mesh.indices.empty();
+	const size_t trianglesCount = isIndexed ? mesh.indices.size() / 3 : mesh.verticesCount / 3;
+	auto getCorner = [&](size_t triangle, size_t corner) { return &positions->values[3 * (isIndexed ? mesh.indices[3 * triangle + corner] : 3 * triangle + corner)]; };
+
+	std::vector<BuildPrimitive> primitives(trianglesCount);
+	for (size_t i = 0; i < trianglesCount; i++)
+	{
+		BuildPrimitive& primitive = primitives[i];
+		for (size_t c = 0; c < 3; c++) primitive.bounds.Add(getCorner(i, c));
+		for (int k = 0; k < 3; k++) primitive.centroid[k] = 0.5f * (primitive.bounds.min[k] + primitive.bounds.max[k]);
+	}
+	HierarchyBuilder(primitives, options, pool).Build(bvh.nodes, bvh.triangles);
+
+	bvh.vertices.resize(9 * trianglesCount);
+	for (size_t slot = 0; slot < trianglesCount; slot++)
+	{
+		for (size_t c = 0; c < 3; c++) std::copy_n(getCorner(bvh.triangles[slot], c), 3, &bvh.vertices[9 * slot + 3 * c]);
+	}
+
+	BVHReport report = GetReport(bvh.nodes, options.traversalCost);
+	report.meshesCount = 1;
+	return report;
+}
+
+BVHReport BuildTriangleBVHs(const std::vector<MeshStreams>& meshes, const BVHOptions& options, ThreadPool& pool, std::vector<TriangleBVH>& bvhs)
+{
+	bvhs.assign(meshes.size(), {});
+	std::vector<BVHReport> reports(meshes.size());
+	pool.ParallelFor(meshes.size(), [&](size_t m) { reports[m] = BuildTriangleBVH(meshes[m], options, pool, bvhs[m]); });
+
+	BVHReport report;
+	for (const BVHReport& meshReport : reports) report.Add(meshReport);
+	return report;
+}
+
+BVHReport BuildInstanceBVH(const std::vector<BVHInstance>& instances, const std::vector<const TriangleBVH*>& bvhs, const BVHOptions& options, ThreadPool& pool, InstanceBVH& bvh)
+{
+	bvh = InstanceBVH();
+	ValidateOptions(options);
+	bvh.instances = instances;
+	bvh.inverseTransforms.resize(instances.size());
+
+	// Only the instances that can be hit are primitives of the hierarchy
+	std::vector<BuildPrimitive> primitives;
+	std::vector<uint32_t> primitiveInstances;
+	for (size_t i = 0; i < instances.size(); i++)
+	{
+		const BVHInstance& instance = instances[i];
+		if (instance.bvhId >= bvhs.size()) throw std::invalid_argument("Instance of a hierarchy out of the hierarchies range");
+		const TriangleBVH* mesh = bvhs[instance.bvhId];
+		if (!mesh || mesh->IsEmpty() || !InvertAffine(instance.transform, bvh.inverseTransforms[i])) continue;
+
+		BuildPrimitive primitive;
+		BoundingBox root;
+		root.Add(mesh->nodes[0].boundsMin);
+		root.Add(mesh->nodes[0].boundsMax);
+		primitive.bounds = TransformBoundingBox(root, instance.transform);
+		for (int k = 0; k < 3; k++) primitive.centroid[k] = 0.5f * (primitive.bounds.min[k] + primitive.bounds.max[k]);
+		primitives.push_back(primitive);
+		primitiveInstances.push_back(static_cast<uint32_t>(i));
+	}
+
+	HierarchyBuilder(primitives, options, pool).Build(bvh.nodes, bvh.order);
+	for (uint32_t& slot : bvh.order) slot = primitiveInstances[slot];
+	return GetReport(bvh.nodes, options.traversalCost);
+}
+
+BVHReport BuildBoundsBVH(const std::vector<BoundingBox>& boxes, const BVHOptions& options, ThreadPool& pool, std::vector<BVHNode>& nodes, std::vector<uint32_t>& order)
+{
+	ValidateOptions(options);
+	std::vector<BuildPrimitive> primitives;
+	std::vector<uint32_t> primitiveBoxes;
+	primitives.reserve(boxes.size());
+	for (size_t i = 0; i < boxes.size(); i++)
+	{
+		if (boxes[i].IsEmpty()) continue;
+		BuildPrimitive primitive;
+		primitive.bounds = boxes[i];
+		for (int k = 0; k < 3; k++) primitive.centroid[k] = 0.5f * (primitive.bounds.min[k] + primitive.bounds.max[k]);
+		primitives.push_back(primitive);
+		primitiveBoxes.push_back(static_cast<uint32_t>(i));
+	}
+
+	HierarchyBuilder(primitives, options, pool).Build(nodes, order);
+	for (uint32_t& slot : order) slot = primitiveBoxes[slot];
+	return GetReport(nodes, options.traversalCost);
+}
+
+bool IntersectRay(const TriangleBVH& bvh, const Ray& ray, RayHit& hit)
+{
+	const RayData r = GetRayData(ray);
+	bool isHit = false;
+	Traverse(bvh.nodes, r, (std::min)(ray.tMax, hit.t), [&](uint32_t first, uint32_t count, float tMax)
+	{
+		for (uint32_t slot = first; slot < first + count; slot++)
+		{
+			float t, u, v;
+			if (!IntersectTriangle(&bvh.vertices[9 * static_cast<size_t>(slot)], r, tMax, t, u, v)) continue;
+			tMax = t;
+			hit.t = t;
+			hit.u = u;
+			hit.v = v;
+			hit.triangle = bvh.triangles[slot];
+			isHit = true;
+		}
+		return tMax;
+	});
+	return isHit;
+}
+
+void IntersectRays(const TriangleBVH& bvh, const Ray* rays, const size_t count, RayHit* hits)
+{
+	if (bvh.IsEmpty()) return;
+#ifdef MESH_BVH_SSE2
+	for (size_t i = 0; i < count; i += 4) IntersectPacket(bvh, rays + i, (std::min)(count - i, size_t(4)), hits + i);
+#else
+	for (size_t i = 0; i < count; i++) IntersectRay(bvh, rays[i], hits[i]);
+#endif
+}
+
+bool IntersectRay(const InstanceBVH& scene, const std::vector<const TriangleBVH*>& bvhs, const Ray& ray, RayHit& hit)
+{
+	const RayData r = GetRayData(ray);
+	bool isHit = false;
+	Traverse(scene.nodes, r, (std::min)(ray.tMax, hit.t), [&](uint32_t first, uint32_t count, float tMax)
+	{
+		for (uint32_t slot = first; slot < first + count; slot++)
+		{
+			// An affine transform keeps t: the model ray at t is the model point of the world ray at t
+			uint32_t instanceId = scene.order[slot];
+			const BVHInstance& instance = scene.instances[instanceId];
+			RayHit modelHit;
+			modelHit.t = tMax;
+			if (!IntersectRay(*bvhs[instance.bvhId], TransformRay(ray, scene.inverseTransforms[instanceId]), modelHit)) continue;
+			tMax = modelHit.t;
+			hit = modelHit;
+			hit.instance = instanceId;
+			isHit = true;
+		}
+		return tMax;
+	});
+	return isHit;
+}
+
+void IntersectRays(const InstanceBVH& scene, const std::vector<const TriangleBVH*>& bvhs, const Ray* rays, const size_t count, RayHit* hits, ThreadPool& pool)
+{
+	pool.ParallelFor((count + RAYS_PER_TASK - 1) / RAYS_PER_TASK, [&](size_t task)
+	{
+		for (size_t i = task * RAYS_PER_TASK; i < (std::min)(count, (task + 1) * RAYS_PER_TASK); i++) IntersectRay(scene, bvhs, rays[i], hits[i]);
+	});
+}
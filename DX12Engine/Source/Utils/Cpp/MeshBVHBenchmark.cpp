@@ -0,0 +1,469 @@
+#include "Benchmark.h"
+#include "MeshBVH.h"
+#include "MeshStreams.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const std::vector<std::string> DEFAULT_BVH_MODELS = { "models/TriangleWithoutIndices.gltf", "models/BoxTextured.glb", "models/2CylinderEngine.glb", "models/DamagedHelmet.glb", "models/scene.gltf" };
+	const std::vector<size_t> DEFAULT_BVH_TRIANGLES = { 1 << 12, 1 << 18 };
+	constexpr size_t BVH_VIEW_SIZE = 256;			// Camera rays per side of the throughput views
+	constexpr size_t BVH_REFERENCE_RAYS = 512;		// Rays checked against the brute force loop over all the triangles
+	constexpr size_t BVH_SCENE_INSTANCES = 64;
+	constexpr int BVH_REPETITIONS = 3;
+
+	using Matrix = std::array<float, 16>;
+
+	double GetMilliseconds(const std::chrono::steady_clock::time_point& start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/** Möller-Trumbore on both faces, with the operations of the hierarchy traversal so that both find the same t */
+	bool IntersectReferenceTriangle(const float* p0, const float* p1, const float* p2, const Ray& ray, float& t)
+	{
+		const float* d = ray.direction;
+		float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		float q[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+		float det = e1[0] * q[0] + e1[1] * q[1] + e1[2] * q[2];
+		if (det == 0.0f) return false;
+		float inverseDet = 1.0f / det;
+		float s[3] = { ray.origin[0] - p0[0], ray.origin[1] - p0[1], ray.origin[2] - p0[2] };
+		float u = (s[0] * q[0] + s[1] * q[1] + s[2] * q[2]) * inverseDet;
+		if (!(u >= 0.0f && u <= 1.0f)) return false;
+		float w[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+		float v = (d[0] * w[0] + d[1] * w[1] + d[2] * w[2]) * inverseDet;
+		if (!(v >= 0.0f && u + v <= 1.0f)) return false;
+		t = (e2[0] * w[0] + e2[1] * w[1] + e2[2] * w[2]) * inverseDet;
+		return t >= ray.tMin && t < ray.tMax;
+	}
+
+	/** The nearest hit of ray with every triangle of positions and indices, unindexed when indices is empty */
+	RayHit IntersectReference(const std::vector<float>& positions, const std::vector<uint32_t>& indices, const Ray& ray)
+	{
+		RayHit hit;
+		size_t trianglesCount = indices.empty() ? positions.size() / 9 : indices.size() / 3;
+		for (size_t i = 0; i < trianglesCount; i++)
+		{
+			const float* p[3];
+			for (size_t c = 0; c < 3; c++) p[c] = &positions[3 * (indices.empty() ? 3 * i + c : indices[3 * i + c])];
+			float t;
+			if (IntersectReferenceTriangle(p[0], p[1], p[2], ray, t) && t < hit.t)
+			{
+				hit.t = t;
+				hit.triangle = static_cast<uint32_t>(i);
+			}
+		}
+		return hit;
+	}
+
+	/** Ties between triangles sharing an edge may be broken either way: hits match on their distance */
+	bool IsSameHit(const RayHit& a, const RayHit& b)
+	{
+		return a.IsHit() == b.IsHit() && (!a.IsHit() || a.t == b.t);
+	}
+
+	bool IsNearHit(const RayHit& a, const RayHit& b)
+	{
+		return a.IsHit() == b.IsHit() && (!a.IsHit() || std::fabs(a.t - b.t) <= 1e-3f * (std::max)(1.0f, std::fabs(b.t)));
+	}
+
+	bool IsExactHit(const RayHit& a, const RayHit& b)
+	{
+		return a.t == b.t && a.u == b.u && a.v == b.v && a.triangle == b.triangle && a.instance == b.instance;
+	}
+
+	/** Check that the leaves hold every triangle once and that each node bounds its children and its triangles */
+	bool CheckHierarchy(const TriangleBVH& bvh, const size_t trianglesCount)
+	{
+		if (bvh.triangles.size() != trianglesCount || bvh.vertices.size() != 9 * trianglesCount || bvh.IsEmpty() != (trianglesCount == 0)) return false;
+		std::vector<int> seen(trianglesCount, 0);
+		for (uint32_t triangle : bvh.triangles)
+		{
+			if (triangle >= trianglesCount || seen[triangle]++) return false;
+		}
+
+		auto contains = [](const BVHNode& node, const float* point)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				if (point[k] < node.boundsMin[k] || point[k] > node.boundsMax[k]) return false;
+			}
+			return true;
+		};
+		size_t slotsCount = 0;
+		std::vector<uint32_t> stack;
+		if (!bvh.IsEmpty()) stack.push_back(0);
+		while (!stack.empty())
+		{
+			const BVHNode& node = bvh.nodes[stack.back()];
+			stack.pop_back();
+			if (node.IsLeaf())
+			{
+				slotsCount += node.primitivesCount;
+				for (size_t f = 0; f < 9 * static_cast<size_t>(node.primitivesCount); f += 3)
+				{
+					if (!contains(node, &bvh.vertices[9 * static_cast<size_t>(node.firstChildOrPrimitive) + f])) return false;
+				}
+				continue;
+			}
+			for (uint32_t c = node.firstChildOrPrimitive; c < node.firstChildOrPrimitive + 2; c++)
+			{
+				if (c >= bvh.nodes.size() || !contains(node, bvh.nodes[c].boundsMin) || !contains(node, bvh.nodes[c].boundsMax)) return false;
+				stack.push_back(c);
+			}
+		}
+		return slotsCount == trianglesCount;
+	}
+
+	/** Rays from the origin to random points around box, spread over all directions */
+	std::vector<Ray> CreateRandomRays(const BoundingBox& box, const size_t count, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::vector<Ray> rays(count);
+		for (Ray& ray : rays)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				float center = 0.5f * (box.min[k] + box.max[k]), extent = 0.5f * (box.max[k] - box.min[k]) + 1e-3f;
+				ray.origin[k] = center + 2.0f * extent * unit(random);
+				ray.direction[k] = center + extent * unit(random) - ray.origin[k];
+			}
+		}
+		return rays;
+	}
+
+	/** The rays of a pinhole camera of size x size pixels looking at the center of box, from a random direction outside it */
+	std::vector<Ray> CreateViewRays(const BoundingBox& box, const size_t size, std::mt19937& random)
+	{
+		std::normal_distribution<float> normal(0.0f, 1.0f);
+		float center[3], radius = 0.0f, back[3], length = 0.0f;
+		for (int k = 0; k < 3; k++)
+		{
+			center[k] = 0.5f * (box.min[k] + box.max[k]);
+			radius += 0.25f * (box.max[k] - box.min[k]) * (box.max[k] - box.min[k]);
+			back[k] = normal(random);
+			length += back[k] * back[k];
+		}
+		radius = (std::max)(std::sqrt(radius), 1e-3f);
+		length = std::sqrt(length);
+		for (float& c : back) c /= length;
+
+		// Right and up vectors perpendicular to the view direction, the view spans the sphere around the box
+		float helper[3] = { std::fabs(back[0]) < 0.9f ? 1.0f : 0.0f, std::fabs(back[0]) < 0.9f ? 0.0f : 1.0f, 0.0f };
+		float right[3] = { helper[1] * back[2] - helper[2] * back[1], helper[2] * back[0] - helper[0] * back[2], helper[0] * back[1] - helper[1] * back[0] };
+		float rightLength = std::sqrt(right[0] * right[0] + right[1] * right[1] + right[2] * right[2]);
+		for (float& c : right) c /= rightLength;
+		float up[3] = { back[1] * right[2] - back[2] * right[1], back[2] * right[0] - back[0] * right[2], back[0] * right[1] - back[1] * right[0] };
+
+		std::vector<Ray> rays(size * size);
+		for (size_t y = 0; y < size; y++)
+		{
+			for (size_t x = 0; x < size; x++)
+			{
+				float sx = (2.0f * (x + 0.5f) / size - 1.0f) * radius, sy = (2.0f * (y + 0.5f) / size - 1.0f) * radius;
+				Ray& ray = rays[y * size + x];
+				for (int k = 0; k < 3; k++)
+				{
+					ray.origin[k] = center[k] + 3.0f * radius * back[k];
+					ray.direction[k] = center[k] + sx * right[k] + sy * up[k] - ray.origin[k];
+				}
+			}
+		}
+		return rays;
+	}
+
+	/** Trace rays one by one and in packets, return the medians of the repetitions in milliseconds */
+	void TraceRays(const TriangleBVH& bvh, const std::vector<Ray>& rays, std::vector<RayHit>& singleHits, std::vector<RayHit>& packetHits, double& singleMs, double& packetMs)
+	{
+		std::vector<double> singleTimes, packetTimes;
+		for (int r = 0; r < BVH_REPETITIONS; r++)
+		{
+			singleHits.assign(rays.size(), RayHit());
+			auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < rays.size(); i++) IntersectRay(bvh, rays[i], singleHits[i]);
+			singleTimes.push_back(GetMilliseconds(start));
+
+			packetHits.assign(rays.size(), RayHit());
+			start = std::chrono::steady_clock::now();
+			IntersectRays(bvh, rays.data(), rays.size(), packetHits.data());
+			packetTimes.push_back(GetMilliseconds(start));
+		}
+		std::sort(singleTimes.begin(), singleTimes.end());
+		std::sort(packetTimes.begin(), packetTimes.end());
+		singleMs = singleTimes[singleTimes.size() / 2];
+		packetMs = packetTimes[packetTimes.size() / 2];
+	}
+
+	/** The results of a mesh: its hierarchy checked, its rays traced and compared to the references */
+	struct MeshResult
+	{
+		bool isMatch = true;
+		double buildMs = 0.0;
+		double singleMs = 0.0;
+		double packetMs = 0.0;
+		size_t raysCount = 0;
+		size_t hitsCount = 0;
+	};
+
+	/**
+	 * Build the hierarchy of mesh on pool and on the calling thread alone, check both, then trace view rays one by one and in packets, and
+	 * random rays against the brute force loop. The packets and the single rays use the same operations: their hits are bit exact
+	 */
+	MeshResult CheckMesh(const MeshStreams& mesh, const BVHOptions& options, ThreadPool& pool, std::mt19937& random, BVHReport& report)
+	{
+		MeshResult result;
+		const std::vector<float>& positions = mesh.Find("POSITION")->values;
+		size_t trianglesCount = mesh.indices.empty() ? mesh.verticesCount / 3 : mesh.indices.size() / 3;
+
+		TriangleBVH bvh, serialBvh;
+		std::vector<double> buildTimes;
+		for (int r = 0; r < BVH_REPETITIONS; r++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			report = BuildTriangleBVH(mesh, options, pool, bvh);
+			buildTimes.push_back(GetMilliseconds(start));
+		}
+		std::sort(buildTimes.begin(), buildTimes.end());
+		result.buildMs = buildTimes[buildTimes.size() / 2];
+		ThreadPool serialPool(0);
+		BuildTriangleBVH(mesh, options, serialPool, serialBvh);
+		result.isMatch &= CheckHierarchy(bvh, trianglesCount) && CheckHierarchy(serialBvh, trianglesCount) && report.nodesCount == serialBvh.nodes.size();
+		if (bvh.IsEmpty()) return result;
+
+		BoundingBox box;
+		box.Add(bvh.nodes[0].boundsMin);
+		box.Add(bvh.nodes[0].boundsMax);
+		std::vector<Ray> rays = CreateViewRays(box, BVH_VIEW_SIZE, random);
+		std::vector<RayHit> singleHits, packetHits;
+		TraceRays(bvh, rays, singleHits, packetHits, result.singleMs, result.packetMs);
+		result.raysCount = rays.size();
+		for (size_t i = 0; i < rays.size(); i++)
+		{
+			result.isMatch &= IsExactHit(singleHits[i], packetHits[i]);
+			result.hitsCount += singleHits[i].IsHit();
+		}
+
+		// The odd count leaves a partial packet
+		std::vector<Ray> randomRays = CreateRandomRays(box, BVH_REFERENCE_RAYS - 1, random);
+		std::vector<RayHit> randomHits(randomRays.size());
+		IntersectRays(bvh, randomRays.data(), randomRays.size(), randomHits.data());
+		for (size_t i = 0; i < randomRays.size(); i++)
+		{
+			RayHit hit, serialHit;
+			IntersectRay(bvh, randomRays[i], hit);
+			IntersectRay(serialBvh, randomRays[i], serialHit);
+			RayHit reference = IntersectReference(positions, mesh.indices, randomRays[i]);
+			result.isMatch &= IsSameHit(hit, reference) && IsSameHit(serialHit, reference) && IsExactHit(hit, randomHits[i]);
+		}
+		return result;
+	}
+
+	void PrintMeshResult(const MeshResult& result, const BVHReport& report)
+	{
+		std::cout << std::fixed << std::setprecision(3) << ", \"nodes\": " << report.nodesCount << ", \"leaves\": " << report.leavesCount
+			<< ", \"maxDepth\": " << report.maxDepth << ", \"sahCost\": " << report.sahCost << ", \"buildMs\": " << result.buildMs
+			<< ", \"rays\": " << result.raysCount << ", \"hits\": " << result.hitsCount
+			<< ", \"singleMRaysPerSecond\": " << result.raysCount / ((std::max)(result.singleMs, 1e-6) * 1000.0)
+			<< ", \"packetMRaysPerSecond\": " << result.raysCount / ((std::max)(result.packetMs, 1e-6) * 1000.0)
+			<< ", \"match\": " << (result.isMatch ? "true" : "false") << " }";
+	}
+
+	/** A soup of random small triangles in a unit cube, the worst case of overlapping boxes */
+	MeshStreams CreateTriangleSoup(const size_t trianglesCount, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> position(0.0f, 1.0f);
+		std::normal_distribution<float> offset(0.0f, 0.5f / std::cbrt(static_cast<float>(trianglesCount)));
+		std::vector<float> positions(9 * trianglesCount);
+		for (size_t i = 0; i < trianglesCount; i++)
+		{
+			float center[3] = { position(random), position(random), position(random) };
+			for (size_t f = 0; f < 9; f++) positions[9 * i + f] = center[f % 3] + offset(random);
+		}
+		MeshStreams mesh;
+		mesh.verticesCount = 3 * trianglesCount;
+		mesh.SetStream("POSITION", 3, std::move(positions));
+		return mesh;
+	}
+
+	bool CheckSoups(const std::vector<size_t>& trianglesCounts, const BVHOptions& options, ThreadPool& pool)
+	{
+		bool isMatch = true;
+		std::mt19937 random(37);
+		std::cout << "  \"soups\": [" << std::endl;
+		for (size_t s = 0; s < trianglesCounts.size(); s++)
+		{
+			BVHReport report;
+			MeshResult result = CheckMesh(CreateTriangleSoup(trianglesCounts[s], random), options, pool, random, report);
+			isMatch &= result.isMatch;
+			std::cout << "    { \"triangles\": " << trianglesCounts[s];
+			PrintMeshResult(result, report);
+			std::cout << (s == trianglesCounts.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]," << std::endl;
+		return isMatch;
+	}
+
+	/** A random rotation, scale and translation; one instance in eight is mirrored */
+	Matrix CreateRandomTransform(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		float q[4] = { unit(random), unit(random), unit(random), unit(random) };
+		float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+		for (float& c : q) c /= (length > 0.0f ? length : 1.0f);
+		float x = q[0], y = q[1], z = q[2], w = q[3];
+		float scale = std::pow(10.0f, 0.5f * unit(random)) * ((random() % 8 == 0) ? -1.0f : 1.0f);
+		Matrix m = { 1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w), 0,
+			2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w), 0,
+			2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y), 0,
+			4.0f * unit(random), 4.0f * unit(random), 4.0f * unit(random), 1 };
+		for (int i = 0; i < 12; i++) m[i] *= ((i % 4) == 3) ? 1.0f : scale;
+		return m;
+	}
+
+	/**
+	 * Place random instances of two soups and of an empty mesh, one of them flattened to a singular transform, and trace random rays
+	 * through the top level hierarchy. The reference transforms the triangles of every instance to the world and loops over all of them
+	 */
+	bool CheckScene(const BVHOptions& options, ThreadPool& pool)
+	{
+		std::mt19937 random(41);
+		std::vector<MeshStreams> meshes = { CreateTriangleSoup(1 << 10, random), CreateTriangleSoup(1 << 12, random), MeshStreams() };
+		meshes[2].SetStream("POSITION", 3, {});
+		std::vector<TriangleBVH> bvhs;
+		BuildTriangleBVHs(meshes, options, pool, bvhs);
+		std::vector<const TriangleBVH*> bvhPointers = { &bvhs[0], &bvhs[1], &bvhs[2] };
+
+		std::vector<BVHInstance> instances(BVH_SCENE_INSTANCES);
+		std::vector<float> worldPositions;
+		std::vector<uint32_t> worldInstances;
+		size_t hitInstancesCount = 0;
+		for (size_t i = 0; i < instances.size(); i++)
+		{
+			Matrix m = CreateRandomTransform(random);
+			if (i == 1) std::fill(m.begin() + 8, m.begin() + 11, 0.0f);
+			std::copy(m.begin(), m.end(), instances[i].transform);
+			instances[i].bvhId = static_cast<uint32_t>(i % 3);
+			instances[i].nodeId = static_cast<uint32_t>(i);
+			if (i == 1 || i % 3 == 2) continue;
+			hitInstancesCount++;
+
+			const std::vector<float>& positions = meshes[i % 3].Find("POSITION")->values;
+			for (size_t p = 0; p < positions.size(); p += 3)
+			{
+				for (int j = 0; j < 3; j++) worldPositions.push_back(positions[p] * m[j] + positions[p + 1] * m[4 + j] + positions[p + 2] * m[8 + j] + m[12 + j]);
+				if (p % 9 == 0) worldInstances.push_back(static_cast<uint32_t>(i));
+			}
+		}
+
+		InstanceBVH scene;
+		auto start = std::chrono::steady_clock::now();
+		BVHReport report = BuildInstanceBVH(instances, bvhPointers, options, pool, scene);
+		double buildMs = GetMilliseconds(start);
+		bool isMatch = report.primitivesCount == hitInstancesCount;
+
+		std::vector<Ray> rays = CreateViewRays(ComputeBoundingBox(worldPositions), BVH_VIEW_SIZE, random);
+		std::vector<RayHit> hits(rays.size());
+		start = std::chrono::steady_clock::now();
+		IntersectRays(scene, bvhPointers, rays.data(), rays.size(), hits.data(), pool);
+		double traceMs = GetMilliseconds(start);
+
+		size_t hitsCount = 0;
+		for (size_t i = 0; i < rays.size(); i++)
+		{
+			RayHit single;
+			IntersectRay(scene, bvhPointers, rays[i], single);
+			isMatch &= IsExactHit(single, hits[i]);
+			hitsCount += hits[i].IsHit();
+		}
+		for (size_t i = 0; i < rays.size(); i += rays.size() / BVH_REFERENCE_RAYS)
+		{
+			RayHit reference = IntersectReference(worldPositions, {}, rays[i]);
+			if (reference.IsHit()) reference.instance = worldInstances[reference.triangle];
+			isMatch &= IsNearHit(hits[i], reference) && (!reference.IsHit() || hits[i].instance == reference.instance);
+		}
+
+		std::cout << std::fixed << std::setprecision(3) << "  \"scene\": { \"instances\": " << instances.size() << ", \"nodes\": " << report.nodesCount
+			<< ", \"buildMs\": " << buildMs << ", \"rays\": " << rays.size() << ", \"hits\": " << hitsCount << ", \"threads\": " << pool.GetThreadsCount()
+			<< ", \"MRaysPerSecond\": " << rays.size() / ((std::max)(traceMs, 1e-6) * 1000.0) << ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+
+	bool CheckModels(const std::vector<std::string>& fileNames, const BVHOptions& options, ThreadPool& pool)
+	{
+		bool isMatch = true;
+		std::mt19937 random(43);
+		std::cout << "  \"models\": [" << std::endl;
+		for (size_t f = 0; f < fileNames.size(); f++)
+		{
+			std::vector<MeshStreams> meshes = LoadMeshStreams(fileNames[f]);
+			std::cout << "    { \"file\": \"" << std::filesystem::path(fileNames[f]).generic_string() << "\", \"meshes\": [" << std::endl;
+			for (size_t m = 0; m < meshes.size(); m++)
+			{
+				BVHReport report;
+				MeshResult result = CheckMesh(meshes[m], options, pool, random, report);
+				isMatch &= result.isMatch;
+				std::cout << "      { \"triangles\": " << report.primitivesCount;
+				PrintMeshResult(result, report);
+				std::cout << (m == meshes.size() - 1 ? "" : ",") << std::endl;
+			}
+			std::cout << "    ] }" << (f == fileNames.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]" << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunMeshBVH(const std::vector<std::string>& args)
+	{
+		std::vector<size_t> trianglesCounts;
+		std::vector<std::string> fileNames;
+		for (const std::string& arg : args)
+		{
+			if (!arg.empty() && std::all_of(arg.begin(), arg.end(), ::isdigit)) trianglesCounts.push_back(std::stoul(arg));
+			else fileNames.push_back(arg);
+		}
+		if (trianglesCounts.empty()) trianglesCounts = DEFAULT_BVH_TRIANGLES;
+		if (fileNames.empty()) fileNames = DEFAULT_BVH_MODELS;
+
+		BVHOptions options;
+		ThreadPool& pool = ThreadPool::GetDefault();
+		std::cout << "{" << std::endl;
+		bool isMatch = CheckSoups(trianglesCounts, options, pool);
+		isMatch &= CheckScene(options, pool);
+		isMatch &= CheckModels(fileNames, options, pool);
+		std::cout << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef MESH_BVH_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunMeshBVH({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
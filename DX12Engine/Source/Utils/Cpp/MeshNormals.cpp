@@ -0,0 +1,164 @@
+#include "MeshNormals.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MESH_NORMALS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	constexpr size_t CHUNK_SIZE = 16384;	// Triangles or vertices processed by a parallel loop iteration
+
+	/** Call fn(begin, end) on consecutive ranges of [0, count) on the pool threads */
+	template <class F>
+	void ParallelForChunks(ThreadPool& pool, const size_t count, F&& fn)
+	{
+		pool.ParallelFor((count + CHUNK_SIZE - 1) / CHUNK_SIZE, [&](size_t chunk)
+			{
+				fn(chunk * CHUNK_SIZE, (std::min)(count, (chunk + 1) * CHUNK_SIZE));
+			});
+	}
+
+#ifdef MESH_NORMALS_SSE2
+	using Vector = __m128;
+
+	Vector Load3(const float* p) { return _mm_setr_ps(p[0], p[1], p[2], 0.0f); }
+	Vector Load4(const float* p) { return _mm_loadu_ps(p); }
+	void Store4(float* p, const Vector v) { _mm_storeu_ps(p, v); }
+	void Store3(float* p, const Vector v) { alignas(16) float f[4]; _mm_store_ps(f, v); p[0] = f[0]; p[1] = f[1]; p[2] = f[2]; }
+	Vector Add(const Vector a, const Vector b) { return _mm_add_ps(a, b); }
+	Vector Subtract(const Vector a, const Vector b) { return _mm_sub_ps(a, b); }
+	Vector Scale(const Vector v, const float s) { return _mm_mul_ps(v, _mm_set1_ps(s)); }
+	Vector Zero() { return _mm_setzero_ps(); }
+
+	Vector Cross(const Vector a, const Vector b)
+	{
+		Vector aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+		Vector bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		Vector aZXY = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+		Vector bZXY = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+		return _mm_sub_ps(_mm_mul_ps(aYZX, bZXY), _mm_mul_ps(aZXY, bYZX));
+	}
+
+	float Dot3(const Vector a, const Vector b)
+	{
+		alignas(16) float p[4];
+		_mm_store_ps(p, _mm_mul_ps(a, b));
+		return p[0] + p[1] + p[2];
+	}
+#else
+	struct Vector { float x, y, z, w; };
+
+	Vector Load3(const float* p) { return { p[0], p[1], p[2], 0.0f }; }
+	Vector Load4(const float* p) { return { p[0], p[1], p[2], p[3] }; }
+	void Store4(float* p, const Vector v) { p[0] = v.x; p[1] = v.y; p[2] = v.z; p[3] = v.w; }
+	void Store3(float* p, const Vector v) { p[0] = v.x; p[1] = v.y; p[2] = v.z; }
+	Vector Add(const Vector a, const Vector b) { return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w }; }
+	Vector Subtract(const Vector a, const Vector b) { return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w }; }
+	Vector Scale(const Vector v, const float s) { return { v.x * s, v.y * s, v.z * s, v.w * s }; }
+	Vector Zero() { return { 0.0f, 0.0f, 0.0f, 0.0f }; }
+	Vector Cross(const Vector a, const Vector b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x, 0.0f }; }
+	float Dot3(const Vector a, const Vector b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+#endif
+
+	/** The triangle normals, weighted as requested, and for the angle weighting the angle at each corner */
+	struct TriangleNormals
+	{
+		std::vector<float> normals;	// 4 floats per triangle, the fourth is padding
+		std::vector<float> cornerWeights;
+	};
+
+	TriangleNormals ComputeTriangleNormals(const TriangleMesh& mesh, const NormalWeighting weighting, ThreadPool& pool)
+	{
+		size_t trianglesCount = mesh.indicesCount / 3;
+		TriangleNormals triangles;
+		triangles.normals.resize(trianglesCount * 4);
+		if (weighting == NormalWeighting::Angle) triangles.cornerWeights.resize(trianglesCount * 3);
+
+		ParallelForChunks(pool, trianglesCount, [&](size_t begin, size_t end)
+			{
+				for (size_t t = begin; t < end; t++)
+				{
+					Vector p[3];
+					for (size_t k = 0; k < 3; k++) p[k] = Load3(mesh.positions + 3 * (mesh.indices ? mesh.indices[3 * t + k] : 3 * t + k));
+
+					// The cross product length is twice the triangle area, and the sine of each corner angle times its edges length
+					Vector normal = Cross(Subtract(p[1], p[0]), Subtract(p[2], p[0]));
+					float length = std::sqrt(Dot3(normal, normal));
+					if (length == 0.0f) normal = Zero();
+					else if (weighting != NormalWeighting::Area) normal = Scale(normal, 1.0f / length);
+					Store4(&triangles.normals[4 * t], normal);
+
+					if (weighting != NormalWeighting::Angle) continue;
+					for (size_t k = 0; k < 3; k++)
+					{
+						float cosine = Dot3(Subtract(p[(k + 1) % 3], p[k]), Subtract(p[(k + 2) % 3], p[k]));
+						triangles.cornerWeights[3 * t + k] = (length == 0.0f) ? 0.0f : std::atan2(length, cosine);
+					}
+				}
+			});
+		return triangles;
+	}
+
+	void StoreNormal(const Vector sum, float* normal)
+	{
+		float length = std::sqrt(Dot3(sum, sum));
+		if (length == 0.0f) { normal[0] = 0.0f; normal[1] = 1.0f; normal[2] = 0.0f; return; }
+		Store3(normal, Scale(sum, 1.0f / length));
+	}
+}
+
+void GenerateNormals(const TriangleMesh& mesh, const NormalWeighting weighting, float* normals, ThreadPool& pool)
+{
+	if (mesh.indices == nullptr && mesh.indicesCount > mesh.verticesCount) throw std::invalid_argument("Unindexed triangles out of the vertices range");
+
+	TriangleNormals triangles = ComputeTriangleNormals(mesh, weighting, pool);
+	auto weightedNormal = [&triangles, weighting](const size_t corner)
+	{
+		Vector normal = Load4(&triangles.normals[4 * (corner / 3)]);
+		return (weighting == NormalWeighting::Angle) ? Scale(normal, triangles.cornerWeights[corner]) : normal;
+	};
+
+	// Unindexed vertices belong to a single corner
+	if (mesh.indices == nullptr)
+	{
+		size_t cornersCount = mesh.indicesCount / 3 * 3;
+		ParallelForChunks(pool, mesh.verticesCount, [&](size_t begin, size_t end)
+			{
+				for (size_t v = begin; v < end; v++) StoreNormal(v < cornersCount ? weightedNormal(v) : Zero(), normals + 3 * v);
+			});
+		return;
+	}
+
+	// Each partition owns a range of vertices and scans all the corners, accumulating only those of its vertices:
+	// the corners indices are read once per partition, but no two threads write the same vertex
+	size_t cornersCount = mesh.indicesCount / 3 * 3;
+	size_t partitionsCount = (std::max)(size_t(1), (std::min)(pool.GetThreadsCount(), cornersCount / CHUNK_SIZE));
+	size_t partitionSize = (mesh.verticesCount + partitionsCount - 1) / partitionsCount;
+	std::atomic<bool> isOutOfRange{ false };
+	pool.ParallelFor(partitionsCount, [&](size_t partition)
+		{
+			uint32_t begin = static_cast<uint32_t>((std::min)(mesh.verticesCount, partition * partitionSize));
+			uint32_t end = static_cast<uint32_t>((std::min)(mesh.verticesCount, (partition + 1) * partitionSize));
+			std::fill(normals + 3 * size_t(begin), normals + 3 * size_t(end), 0.0f);
+			for (size_t c = 0; c < cornersCount; c++)
+			{
+				uint32_t v = mesh.indices[c];
+				if (v < begin || v >= end)
+				{
+					if (v >= mesh.verticesCount) isOutOfRange = true;
+					continue;
+				}
+				Store3(normals + 3 * size_t(v), Add(Load3(normals + 3 * size_t(v)), weightedNormal(c)));
+			}
+			for (size_t v = begin; v < end; v++) StoreNormal(Load3(normals + 3 * v), normals + 3 * v);
+		});
+	if (isOutOfRange) throw std::invalid_argument("Index out of the vertices range");
+}
@@ -0,0 +1,235 @@
+#include "Benchmark.h"
+#include "MeshNormals.h"
+#include "AccessorView.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace
+{
+	const std::vector<size_t> DEFAULT_NORMALS_TRIANGLES = { 1 << 20, 1 << 22 };
+	constexpr int NORMALS_REPETITIONS = 5;
+	constexpr double MAX_NORMAL_ERROR_DEGREES = 0.01;
+
+	const std::vector<std::pair<const char*, NormalWeighting>> WEIGHTINGS = {
+		{ "uniform", NormalWeighting::Uniform }, { "area", NormalWeighting::Area }, { "angle", NormalWeighting::Angle } };
+
+	/** A noisy height field of about trianglesCount triangles, with shuffled triangles as in a scanned mesh */
+	struct SyntheticMesh
+	{
+		std::vector<float> positions;
+		std::vector<uint32_t> indices;
+
+		TriangleMesh GetTriangleMesh() const { return { positions.data(), positions.size() / 3, indices.data(), indices.size() }; }
+	};
+
+	SyntheticMesh CreateHeightField(const size_t trianglesCount, std::mt19937& random)
+	{
+		size_t side = (std::max)(static_cast<size_t>(std::sqrt(trianglesCount / 2.0)) + 1, size_t(2));
+		SyntheticMesh mesh;
+		std::uniform_real_distribution<float> noise(-0.2f, 0.2f);
+		for (size_t y = 0; y < side; y++)
+		{
+			for (size_t x = 0; x < side; x++)
+			{
+				mesh.positions.insert(mesh.positions.end(), { static_cast<float>(x), std::sin(x * 0.1f) * std::cos(y * 0.1f) * 4.0f + noise(random), static_cast<float>(y) });
+			}
+		}
+
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (uint32_t y = 0; y + 1 < side; y++)
+		{
+			for (uint32_t x = 0; x + 1 < side; x++)
+			{
+				uint32_t v = y * static_cast<uint32_t>(side) + x, s = static_cast<uint32_t>(side);
+				triangles.push_back({ v, v + s, v + 1 });
+				triangles.push_back({ v + 1, v + s, v + s + 1 });
+			}
+		}
+		std::shuffle(triangles.begin(), triangles.end(), random);
+		for (const auto& triangle : triangles) mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+		return mesh;
+	}
+
+	/** The single threaded, scalar triangle scatter that GenerateNormals replaces, written from the weighting definitions */
+	void GenerateNormalsReference(const TriangleMesh& mesh, const NormalWeighting weighting, float* normals)
+	{
+		std::fill(normals, normals + 3 * mesh.verticesCount, 0.0f);
+		for (size_t t = 0; t < mesh.indicesCount / 3; t++)
+		{
+			size_t v[3];
+			const float* p[3];
+			for (size_t k = 0; k < 3; k++)
+			{
+				v[k] = mesh.indices ? mesh.indices[3 * t + k] : 3 * t + k;
+				p[k] = mesh.positions + 3 * v[k];
+			}
+
+			float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+			float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length == 0.0f) continue;
+
+			for (size_t k = 0; k < 3; k++)
+			{
+				float weight = (weighting == NormalWeighting::Area) ? 1.0f : 1.0f / length;
+				if (weighting == NormalWeighting::Angle)
+				{
+					const float* a = p[(k + 1) % 3];
+					const float* b = p[(k + 2) % 3];
+					float cosine = (a[0] - p[k][0]) * (b[0] - p[k][0]) + (a[1] - p[k][1]) * (b[1] - p[k][1]) + (a[2] - p[k][2]) * (b[2] - p[k][2]);
+					weight *= std::atan2(length, cosine);
+				}
+				for (size_t i = 0; i < 3; i++) normals[3 * v[k] + i] += n[i] * weight;
+			}
+		}
+
+		for (size_t v = 0; v < mesh.verticesCount; v++)
+		{
+			float* n = normals + 3 * v;
+			float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length == 0.0f) { n[0] = 0.0f; n[1] = 1.0f; n[2] = 0.0f; continue; }
+			for (size_t i = 0; i < 3; i++) n[i] /= length;
+		}
+	}
+
+	/** Return the largest angle between two sets of normals, in degrees */
+	double GetMaxErrorDegrees(const std::vector<float>& expected, const std::vector<float>& normals)
+	{
+		double maxError = 0.0;
+		for (size_t v = 0; v < expected.size(); v += 3)
+		{
+			// atan2 of the cross and dot products keeps its precision for small angles, unlike acos of the dot product
+			double a[3] = { expected[v], expected[v + 1], expected[v + 2] }, b[3] = { normals[v], normals[v + 1], normals[v + 2] };
+			double cross[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+			double sine = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+			maxError = (std::max)(maxError, std::atan2(sine, a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) * 180.0 / 3.14159265358979323846);
+		}
+		return maxError;
+	}
+
+	template <class F>
+	double MeasureMilliseconds(F&& f)
+	{
+		std::vector<double> milliseconds;
+		for (int r = 0; r < NORMALS_REPETITIONS; r++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			f();
+			milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(milliseconds.begin(), milliseconds.end());
+		return milliseconds[milliseconds.size() / 2];
+	}
+
+	/** Check a small mesh with 8, 16 and 32 bit indices, read through the accessor views as the loader does, and unindexed */
+	bool CheckIndexFormats(std::ostream& out, ThreadPool& pool, std::mt19937& random)
+	{
+		SyntheticMesh mesh = CreateHeightField(300, random);
+		const std::vector<std::pair<const char*, int>> formats = {
+			{ "unsigned_byte", TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE }, { "unsigned_short", TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT },
+			{ "unsigned_int", TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT }, { "unindexed", -1 } };
+
+		bool isMatch = true;
+		for (size_t f = 0; f < formats.size(); f++)
+		{
+			std::vector<float> positions = mesh.positions;
+			std::vector<uint32_t> indices;
+			if (formats[f].second == -1)
+			{
+				positions.clear();
+				for (uint32_t index : mesh.indices) positions.insert(positions.end(), mesh.positions.begin() + 3 * index, mesh.positions.begin() + 3 * index + 3);
+			}
+			else
+			{
+				AccessorDesc accessor;
+				accessor.count = mesh.indices.size();
+				accessor.componentType = formats[f].second;
+				accessor.elementsCount = 1;
+				std::vector<uint8_t> data(accessor.GetByteLength());
+				for (size_t i = 0; i < mesh.indices.size(); i++) std::memcpy(&data[i * accessor.GetElementSize()], &mesh.indices[i], accessor.GetElementSize());	// Little endian
+				accessor.data = data.data();
+				indices.resize(accessor.count);
+				ReadAccessorUInt32(accessor, indices.data());
+			}
+
+			TriangleMesh triangleMesh = { positions.data(), positions.size() / 3, indices.empty() ? nullptr : indices.data(), indices.empty() ? positions.size() / 3 : indices.size() };
+			std::vector<float> expected(positions.size()), normals(positions.size());
+			GenerateNormalsReference(triangleMesh, NormalWeighting::Angle, expected.data());
+			GenerateNormals(triangleMesh, NormalWeighting::Angle, normals.data(), pool);
+			double error = GetMaxErrorDegrees(expected, normals);
+			isMatch &= error <= MAX_NORMAL_ERROR_DEGREES;
+
+			out << std::fixed << std::setprecision(6) << "    { \"indices\": \"" << formats[f].first << "\", \"vertices\": " << triangleMesh.verticesCount
+				<< ", \"maxErrorDegrees\": " << error << ", \"match\": " << (error <= MAX_NORMAL_ERROR_DEGREES ? "true" : "false") << " }"
+				<< (f == formats.size() - 1 ? "" : ",") << std::endl;
+		}
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunNormals(const std::vector<std::string>& args)
+	{
+		std::vector<size_t> trianglesCounts;
+		for (const std::string& arg : args) trianglesCounts.push_back(std::stoul(arg));
+		if (trianglesCounts.empty()) trianglesCounts = DEFAULT_NORMALS_TRIANGLES;
+
+		std::mt19937 random(11);
+		ThreadPool& pool = ThreadPool::GetDefault();
+
+		std::cout << "{" << std::endl << "  \"formats\": [" << std::endl;
+		bool isMatch = CheckIndexFormats(std::cout, pool, random);
+		std::cout << "  ]," << std::endl << "  \"meshes\": [" << std::endl;
+
+		for (size_t m = 0; m < trianglesCounts.size(); m++)
+		{
+			SyntheticMesh mesh = CreateHeightField(trianglesCounts[m], random);
+			TriangleMesh triangleMesh = mesh.GetTriangleMesh();
+			std::vector<float> expected(mesh.positions.size()), normals(mesh.positions.size());
+
+			for (size_t w = 0; w < WEIGHTINGS.size(); w++)
+			{
+				double referenceMs = MeasureMilliseconds([&]() { GenerateNormalsReference(triangleMesh, WEIGHTINGS[w].second, expected.data()); });
+				double parallelMs = MeasureMilliseconds([&]() { GenerateNormals(triangleMesh, WEIGHTINGS[w].second, normals.data(), pool); });
+				double error = GetMaxErrorDegrees(expected, normals);
+				isMatch &= error <= MAX_NORMAL_ERROR_DEGREES;
+
+				bool isLast = (m == trianglesCounts.size() - 1) && (w == WEIGHTINGS.size() - 1);
+				std::cout << std::fixed << std::setprecision(3)
+					<< "    { \"triangles\": " << triangleMesh.indicesCount / 3 << ", \"vertices\": " << triangleMesh.verticesCount
+					<< ", \"weighting\": \"" << WEIGHTINGS[w].first << "\", \"threads\": " << pool.GetThreadsCount()
+					<< ", \"referenceMs\": " << referenceMs << ", \"parallelMs\": " << parallelMs << ", \"speedup\": " << referenceMs / parallelMs
+					<< ", \"maxErrorDegrees\": " << std::setprecision(6) << error << ", \"match\": " << (error <= MAX_NORMAL_ERROR_DEGREES ? "true" : "false") << " }"
+					<< (isLast ? "" : ",") << std::endl;
+			}
+		}
+		std::cout << "  ]" << std::endl << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef MESH_NORMALS_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunNormals({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
@@ -0,0 +1,270 @@
+#include "MeshOptimization.h"
+#include "MeshStreams.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+	/** The triangles around each vertex, in compressed rows: the triangles of v are triangles[offsets[v]] to triangles[offsets[v + 1]] */
+	struct VertexTriangles
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+	};
+
+	void CheckIndices(const std::vector<uint32_t>& indices, const size_t verticesCount)
+	{
+		if (indices.size() % 3 != 0) throw std::invalid_argument("The indices are not a triangle list");
+		for (const uint32_t index : indices) if (index >= verticesCount) throw std::invalid_argument("Index out of the vertices range");
+	}
+
+	VertexTriangles GetVertexTriangles(const std::vector<uint32_t>& indices, const size_t verticesCount)
+	{
+		VertexTriangles adjacency;
+		adjacency.offsets.assign(verticesCount + 1, 0);
+		for (const uint32_t index : indices) adjacency.offsets[index + 1]++;
+		for (size_t v = 0; v < verticesCount; v++) adjacency.offsets[v + 1] += adjacency.offsets[v];
+
+		std::vector<uint32_t> cursor(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+		adjacency.triangles.resize(indices.size());
+		for (size_t i = 0; i < indices.size(); i++) adjacency.triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		return adjacency;
+	}
+
+	/** Count the misses of a FIFO cache: a vertex is cached until cacheSize misses happened since its own */
+	size_t CountCacheMisses(const uint32_t* indices, const size_t indicesCount, std::vector<size_t>& timestamps, size_t& time, const size_t cacheSize)
+	{
+		size_t misses = 0;
+		for (size_t i = 0; i < indicesCount; i++)
+		{
+			size_t& timestamp = timestamps[indices[i]];
+			if (time - timestamp > cacheSize) { timestamp = time++; misses++; }
+		}
+		return misses;
+	}
+}
+
+void MeshOptimizationReport::Add(const MeshOptimizationReport& report)
+{
+	auto merge = [](VertexCacheStatistics& total, const VertexCacheStatistics& statistics, const size_t trianglesCount, const size_t verticesCount)
+	{
+		total.transformedVertices += statistics.transformedVertices;
+		total.acmr = trianglesCount ? double(total.transformedVertices) / trianglesCount : 0.0;
+		total.atvr = verticesCount ? double(total.transformedVertices) / verticesCount : 0.0;
+	};
+	trianglesCount += report.trianglesCount;
+	verticesCountBefore += report.verticesCountBefore;
+	verticesCountAfter += report.verticesCountAfter;
+	merge(before, report.before, trianglesCount, verticesCountBefore);
+	merge(after, report.after, trianglesCount, verticesCountAfter);
+}
+
+VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, const size_t verticesCount, const size_t cacheSize)
+{
+	CheckIndices(indices, verticesCount);
+	std::vector<size_t> timestamps(verticesCount, 0);
+	size_t time = cacheSize + 1;
+	VertexCacheStatistics statistics;
+	statistics.transformedVertices = CountCacheMisses(indices.data(), indices.size(), timestamps, time, cacheSize);
+	if (!indices.empty()) statistics.acmr = double(statistics.transformedVertices) / (indices.size() / 3);
+	if (verticesCount != 0) statistics.atvr = double(statistics.transformedVertices) / verticesCount;
+	return statistics;
+}
+
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, const size_t verticesCount, const size_t cacheSize, std::vector<uint32_t>* clusters)
+{
+	CheckIndices(indices, verticesCount);
+	const size_t trianglesCount = indices.size() / 3;
+	VertexTriangles adjacency = GetVertexTriangles(indices, verticesCount);
+
+	std::vector<uint32_t> liveTriangles(verticesCount);
+	for (size_t v = 0; v < verticesCount; v++) liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+	std::vector<size_t> timestamps(verticesCount, 0);
+	std::vector<bool> isEmitted(trianglesCount, false);
+	std::vector<uint32_t> deadEnds;		// The vertices of the emitted triangles, the fallback when the candidates are exhausted
+	std::vector<uint32_t> candidates;	// The vertices of the triangles emitted by the last fan
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	if (clusters) clusters->clear();
+
+	size_t time = cacheSize + 1;
+	size_t cursor = 0;		// Input vertices before cursor have no live triangle left
+	while (cursor < verticesCount && liveTriangles[cursor] == 0) cursor++;
+	int64_t fanning = (cursor < verticesCount) ? static_cast<int64_t>(cursor) : -1;
+	bool isColdStart = true;
+	while (fanning >= 0)
+	{
+		if (isColdStart && clusters) clusters->push_back(static_cast<uint32_t>(result.size() / 3));
+
+		candidates.clear();
+		for (uint32_t a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; a++)
+		{
+			uint32_t t = adjacency.triangles[a];
+			if (isEmitted[t]) continue;
+			isEmitted[t] = true;
+			for (size_t k = 0; k < 3; k++)
+			{
+				uint32_t v = indices[3 * t + k];
+				result.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+				if (time - timestamps[v] > cacheSize) timestamps[v] = time++;
+			}
+		}
+
+		// Prefer the candidate that entered the cache first among those whose triangles fit in what remains of the cache
+		int64_t next = -1;
+		size_t bestPriority = 0;
+		for (const uint32_t v : candidates)
+		{
+			if (liveTriangles[v] == 0) continue;
+			size_t priority = 0;
+			if (time - timestamps[v] + 2 * liveTriangles[v] <= cacheSize) priority = time - timestamps[v];
+			if (next < 0 || priority > bestPriority) { next = v; bestPriority = priority; }
+		}
+		isColdStart = false;
+		if (next >= 0) { fanning = next; continue; }
+
+		// Dead end: go back to the most recent vertex that still has triangles, else to the next one in input order
+		while (!deadEnds.empty() && next < 0)
+		{
+			uint32_t v = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveTriangles[v] > 0) next = v;
+		}
+		while (next < 0 && cursor < verticesCount)
+		{
+			if (liveTriangles[cursor] > 0) next = static_cast<int64_t>(cursor);
+			else cursor++;
+		}
+		isColdStart = next >= 0 && time - timestamps[next] > cacheSize;
+		fanning = next;
+	}
+
+	if (clusters) clusters->push_back(static_cast<uint32_t>(trianglesCount));
+	return result;
+}
+
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const float* positions, const size_t verticesCount,
+	const std::vector<uint32_t>& clusters, const size_t cacheSize, const float overdrawThreshold)
+{
+	CheckIndices(indices, verticesCount);
+	if (clusters.size() < 2) return;
+
+	// Split the clusters where the ACMR of their first triangles is already within the threshold of the whole cluster's
+	std::vector<uint32_t> softClusters;
+	std::vector<size_t> timestamps(verticesCount, 0);
+	size_t time = cacheSize + 1;
+	for (size_t c = 0; c + 1 < clusters.size(); c++)
+	{
+		const uint32_t begin = clusters[c], end = clusters[c + 1];
+		time += cacheSize + 1;
+		double clusterAcmr = double(CountCacheMisses(&indices[3 * begin], 3 * size_t(end - begin), timestamps, time, cacheSize)) / (std::max)(end - begin, 1u);
+
+		time += cacheSize + 1;
+		softClusters.push_back(begin);
+		size_t misses = 0, count = 0;
+		for (uint32_t t = begin; t < end; t++)
+		{
+			misses += CountCacheMisses(&indices[3 * t], 3, timestamps, time, cacheSize);
+			count++;
+			if (t + 1 < end && double(misses) / count <= clusterAcmr * overdrawThreshold)
+			{
+				softClusters.push_back(t + 1);
+				time += cacheSize + 1;
+				misses = count = 0;
+			}
+		}
+	}
+	softClusters.push_back(clusters.back());
+
+	// Sort the clusters on how much their area weighted normal points away from the mesh centroid
+	double meshCentroid[3] = { 0.0, 0.0, 0.0 };
+	for (const uint32_t index : indices) for (size_t k = 0; k < 3; k++) meshCentroid[k] += positions[3 * index + k];
+	for (size_t k = 0; k < 3; k++) meshCentroid[k] /= (std::max)(indices.size(), size_t(1));
+
+	const size_t clustersCount = softClusters.size() - 1;
+	std::vector<float> sortKeys(clustersCount);
+	for (size_t c = 0; c < clustersCount; c++)
+	{
+		double centroid[3] = { 0.0, 0.0, 0.0 }, normal[3] = { 0.0, 0.0, 0.0 }, area = 0.0;
+		for (uint32_t t = softClusters[c]; t < softClusters[c + 1]; t++)
+		{
+			const float* p0 = positions + 3 * indices[3 * t];
+			const float* p1 = positions + 3 * indices[3 * t + 1];
+			const float* p2 = positions + 3 * indices[3 * t + 2];
+			double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			double triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			for (size_t k = 0; k < 3; k++)
+			{
+				centroid[k] += (p0[k] + p1[k] + p2[k]) / 3.0 * triangleArea;
+				normal[k] += n[k];
+			}
+			area += triangleArea;
+		}
+		double normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (area == 0.0 || normalLength == 0.0) continue;
+		double key = 0.0;
+		for (size_t k = 0; k < 3; k++) key += (centroid[k] / area - meshCentroid[k]) * normal[k] / normalLength;
+		sortKeys[c] = static_cast<float>(key);
+	}
+
+	std::vector<uint32_t> order(clustersCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](const uint32_t a, const uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(indices.size());
+	for (const uint32_t c : order) sorted.insert(sorted.end(), indices.begin() + 3 * size_t(softClusters[c]), indices.begin() + 3 * size_t(softClusters[c + 1]));
+	indices = std::move(sorted);
+}
+
+std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, const size_t verticesCount)
+{
+	CheckIndices(indices, verticesCount);
+	constexpr uint32_t UNUSED = ~0u;
+	std::vector<uint32_t> remap(verticesCount, UNUSED);
+	std::vector<uint32_t> sourceVertices;
+	sourceVertices.reserve(verticesCount);
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == UNUSED)
+		{
+			remap[index] = static_cast<uint32_t>(sourceVertices.size());
+			sourceVertices.push_back(index);
+		}
+		index = remap[index];
+	}
+	return sourceVertices;
+}
+
+MeshOptimizationReport OptimizeMesh(MeshStreams& mesh, const MeshOptimizationOptions& options)
+{
+	MeshOptimizationReport report;
+	if (mesh.indices.empty()) return report;
+
+	report.trianglesCount = mesh.indices.size() / 3;
+	report.verticesCountBefore = mesh.verticesCount;
+	report.before = AnalyzeVertexCache(mesh.indices, mesh.verticesCount, options.cacheSize);
+
+	std::vector<uint32_t> clusters;
+	mesh.indices = OptimizeVertexCache(mesh.indices, mesh.verticesCount, options.cacheSize, &clusters);
+	const VertexStream* positions = mesh.Find("POSITION");
+	if (options.reduceOverdraw && positions && positions->elementsCount == 3)
+	{
+		OptimizeOverdraw(mesh.indices, positions->values.data(), mesh.verticesCount, clusters, options.cacheSize, options.overdrawThreshold);
+	}
+
+	std::vector<uint32_t> sourceVertices = OptimizeVertexFetch(mesh.indices, mesh.verticesCount);
+	mesh.GatherVertices(sourceVertices);
+
+	report.verticesCountAfter = mesh.verticesCount;
+	report.after = AnalyzeVertexCache(mesh.indices, mesh.verticesCount, options.cacheSize);
+	return report;
+}
@@ -0,0 +1,194 @@
+#include "Benchmark.h"
+#include "MeshOptimization.h"
+#include "MeshStreams.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+	const std::vector<std::string> DEFAULT_OPTIMIZATION_MODELS = { "models/2CylinderEngine.glb", "models/DamagedHelmet.glb", "models/BoxTextured.glb", "models/NormalTangentTest.glb", "models/scene.gltf" };
+	constexpr size_t GRID_SIDE = 724;	// About 1M triangles
+	constexpr int OPTIMIZATION_REPETITIONS = 3;
+
+	/** A triangle as the attributes of its corners, rotated to start from the smallest corner so that the winding is kept */
+	using TriangleKey = std::vector<float>;
+
+	/** Return the triangles of mesh by value, sorted: two meshes with the same result draw the same triangles */
+	std::vector<TriangleKey> GetTriangleKeys(const MeshStreams& mesh)
+	{
+		auto getVertex = [&mesh](const uint32_t v)
+		{
+			std::vector<float> values;
+			for (const VertexStream& stream : mesh.streams) values.insert(values.end(), stream.values.begin() + v * stream.elementsCount, stream.values.begin() + (v + 1) * stream.elementsCount);
+			return values;
+		};
+
+		std::vector<TriangleKey> keys(mesh.indices.size() / 3);
+		for (size_t t = 0; t < keys.size(); t++)
+		{
+			std::vector<float> corners[3] = { getVertex(mesh.indices[3 * t]), getVertex(mesh.indices[3 * t + 1]), getVertex(mesh.indices[3 * t + 2]) };
+			size_t first = std::min_element(std::begin(corners), std::end(corners)) - std::begin(corners);
+			for (size_t k = 0; k < 3; k++) keys[t].insert(keys[t].end(), corners[(first + k) % 3].begin(), corners[(first + k) % 3].end());
+		}
+		std::sort(keys.begin(), keys.end());
+		return keys;
+	}
+
+	/** Return true if each vertex is first referenced after all the vertices before it, and every vertex is referenced */
+	bool IsFirstUseOrder(const MeshStreams& mesh)
+	{
+		uint32_t nextVertex = 0;
+		for (const uint32_t index : mesh.indices)
+		{
+			if (index > nextVertex) return false;
+			if (index == nextVertex) nextVertex++;
+		}
+		return nextVertex == mesh.verticesCount;
+	}
+
+	/** A side x side grid of quads with its triangles shuffled, the worst case for the vertex cache */
+	MeshStreams CreateShuffledGrid(const size_t side, std::mt19937& random)
+	{
+		MeshStreams mesh;
+		mesh.verticesCount = (side + 1) * (side + 1);
+		std::vector<float> positions, texCoords;
+		for (size_t y = 0; y <= side; y++)
+		{
+			for (size_t x = 0; x <= side; x++)
+			{
+				positions.insert(positions.end(), { float(x), 0.0f, float(y) });
+				texCoords.insert(texCoords.end(), { float(x) / side, float(y) / side });
+			}
+		}
+		mesh.SetStream("POSITION", 3, std::move(positions));
+		mesh.SetStream("TEXCOORD_0", 2, std::move(texCoords));
+
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (uint32_t y = 0; y < side; y++)
+		{
+			for (uint32_t x = 0; x < side; x++)
+			{
+				uint32_t v = y * uint32_t(side + 1) + x, w = uint32_t(side + 1);
+				triangles.push_back({ v, v + w, v + 1 });
+				triangles.push_back({ v + 1, v + w, v + w + 1 });
+			}
+		}
+		std::shuffle(triangles.begin(), triangles.end(), random);
+		for (const auto& triangle : triangles) mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+		return mesh;
+	}
+
+	/** Optimize a copy of the primitives of a model, check them and print their summed report as a JSON object */
+	bool CheckOptimization(const std::string& name, const std::vector<MeshStreams>& meshes, const MeshOptimizationOptions& options, const bool isLast)
+	{
+		MeshOptimizationReport total;
+		std::vector<double> milliseconds(OPTIMIZATION_REPETITIONS, 0.0);
+		bool isSameTriangles = true, isFirstUse = true, isCacheBetter = true;
+		for (const MeshStreams& mesh : meshes)
+		{
+			MeshStreams optimized;
+			MeshOptimizationReport report;
+			for (int r = 0; r < OPTIMIZATION_REPETITIONS; r++)
+			{
+				optimized = mesh;
+				auto start = std::chrono::steady_clock::now();
+				report = OptimizeMesh(optimized, options);
+				milliseconds[r] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			}
+			total.Add(report);
+
+			// The optimized mesh must draw the same triangles with the same winding, in first use vertex order, and hit the
+			// cache at least as well as the input: the overdraw clusters may only cost their threshold
+			isSameTriangles &= GetTriangleKeys(mesh) == GetTriangleKeys(optimized);
+			isFirstUse &= IsFirstUseOrder(optimized);
+			isCacheBetter &= report.after.acmr <= report.before.acmr * (options.reduceOverdraw ? options.overdrawThreshold : 1.0f);
+		}
+		std::sort(milliseconds.begin(), milliseconds.end());
+		double ms = milliseconds[milliseconds.size() / 2];
+		bool isMatch = isSameTriangles && isFirstUse && isCacheBetter;
+
+		std::cout << std::fixed << std::setprecision(4)
+			<< "    { \"mesh\": \"" << name << "\", \"primitives\": " << meshes.size() << ", \"overdraw\": " << (options.reduceOverdraw ? "true" : "false")
+			<< ", \"triangles\": " << total.trianglesCount << ", \"verticesBefore\": " << total.verticesCountBefore << ", \"verticesAfter\": " << total.verticesCountAfter
+			<< ", \"acmrBefore\": " << total.before.acmr << ", \"acmrAfter\": " << total.after.acmr
+			<< ", \"atvrBefore\": " << total.before.atvr << ", \"atvrAfter\": " << total.after.atvr
+			<< ", \"ms\": " << std::setprecision(3) << ms << ", \"mTrianglesPerSecond\": " << total.trianglesCount / (ms * 1000.0)
+			<< ", \"sameTriangles\": " << (isSameTriangles ? "true" : "false") << ", \"firstUseOrder\": " << (isFirstUse ? "true" : "false")
+			<< ", \"match\": " << (isMatch ? "true" : "false") << " }" << (isLast ? "" : ",") << std::endl;
+		return isMatch;
+	}
+
+	/** A vertex out of range must be rejected, and a mesh without indices left untouched */
+	bool CheckInvalidMeshes()
+	{
+		bool isRejected = false;
+		MeshStreams mesh;
+		mesh.verticesCount = 3;
+		mesh.SetStream("POSITION", 3, std::vector<float>(9, 0.0f));
+		mesh.indices = { 0, 1, 3 };
+		try { OptimizeMesh(mesh, {}); }
+		catch (const std::invalid_argument&) { isRejected = true; }
+
+		mesh.indices.clear();
+		MeshOptimizationReport report = OptimizeMesh(mesh, {});
+		bool isUnindexedKept = report.trianglesCount == 0 && mesh.verticesCount == 3;
+		bool isMatch = isRejected && isUnindexedKept;
+		std::cout << "  \"invalidMeshes\": { \"outOfRangeRejected\": " << (isRejected ? "true" : "false") << ", \"unindexedKept\": "
+			<< (isUnindexedKept ? "true" : "false") << ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunMeshOptimization(const std::vector<std::string>& args)
+	{
+		std::vector<std::string> fileNames = args.empty() ? DEFAULT_OPTIMIZATION_MODELS : args;
+		std::vector<std::pair<std::string, std::vector<MeshStreams>>> meshes;
+		for (const std::string& fileName : fileNames)
+		{
+			std::vector<MeshStreams> primitives = LoadMeshStreams(fileName);
+			primitives.erase(std::remove_if(primitives.begin(), primitives.end(), [](const MeshStreams& mesh) { return mesh.indices.empty(); }), primitives.end());
+			meshes.emplace_back(std::filesystem::path(fileName).generic_string(), std::move(primitives));
+		}
+		std::mt19937 random(7);
+		meshes.emplace_back("shuffledGrid", std::vector<MeshStreams>{ CreateShuffledGrid(GRID_SIDE, random) });
+
+		std::cout << "{" << std::endl;
+		bool isMatch = CheckInvalidMeshes();
+		std::cout << "  \"meshes\": [" << std::endl;
+		for (size_t m = 0; m < meshes.size(); m++)
+		{
+			MeshOptimizationOptions options;
+			options.reduceOverdraw = false;
+			isMatch &= CheckOptimization(meshes[m].first, meshes[m].second, options, false);
+			options.reduceOverdraw = true;
+			isMatch &= CheckOptimization(meshes[m].first, meshes[m].second, options, m == meshes.size() - 1);
+		}
+		std::cout << "  ]" << std::endl << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef MESH_OPTIMIZATION_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunMeshOptimization({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
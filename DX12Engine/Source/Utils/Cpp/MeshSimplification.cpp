@@ -0,0 +1,419 @@
+#include "MeshSimplification.h"
+#include "MeshStreams.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+	constexpr double BORDER_WEIGHT = 10.0;		// Weight of the border and seam edges quadrics, against the triangles ones
+	constexpr double PASS_ERROR_FACTOR = 1.5;	// A pass stops at this times the error of the collapse that would reach its goal
+	constexpr double FLIP_THRESHOLD = 1e-2;		// Cosine between a triangle normal before and after a collapse below which it flipped
+
+	using Vector3 = std::array<double, 3>;
+
+	Vector3 Subtract(const Vector3& a, const Vector3& b) { return { a[0] - b[0], a[1] - b[1], a[2] - b[2] }; }
+	double Dot(const Vector3& a, const Vector3& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+	Vector3 Cross(const Vector3& a, const Vector3& b) { return { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] }; }
+
+	/** The weighted sum of the squared distances from a set of planes, divided by the weight it is the mean squared distance */
+	struct Quadric
+	{
+		double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0, c = 0.0;
+		double weight = 0.0;
+
+		/** Add the plane of unit normal n through point, with weight w */
+		void AddPlane(const Vector3& n, const Vector3& point, const double w)
+		{
+			double d = -Dot(n, point);
+			a00 += w * n[0] * n[0]; a01 += w * n[0] * n[1]; a02 += w * n[0] * n[2];
+			a11 += w * n[1] * n[1]; a12 += w * n[1] * n[2]; a22 += w * n[2] * n[2];
+			b0 += w * d * n[0]; b1 += w * d * n[1]; b2 += w * d * n[2];
+			c += w * d * d;
+			weight += w;
+		}
+
+		void Add(const Quadric& q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c;
+			weight += q.weight;
+		}
+
+		double Evaluate(const Vector3& v) const
+		{
+			double x = v[0], y = v[1], z = v[2];
+			double error = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+			return (std::max)(0.0, error);
+		}
+	};
+
+	enum class VertexKind : uint8_t
+	{
+		Manifold,	// Collapses along any edge
+		Border,		// On two open border edges, collapses along them
+		Locked		// On a non manifold edge or a complex border, never collapses
+	};
+
+	uint64_t EdgeKey(const uint32_t a, const uint32_t b) { return (static_cast<uint64_t>((std::min)(a, b)) << 32) | (std::max)(a, b); }
+
+	/** The collapses of the vertices of a triangle list, that share their vertex buffer along the levels */
+	class Simplifier
+	{
+	public:
+		Simplifier(const MeshStreams& mesh)
+			: m_indices(mesh.indices)
+		{
+			const VertexStream* positions = mesh.Find("POSITION");
+			if (!positions || positions->elementsCount != 3) throw std::invalid_argument("The mesh has no POSITION");
+			if (m_indices.empty() || m_indices.size() % 3 != 0) throw std::invalid_argument("The indices are not a triangle list");
+			for (const uint32_t index : m_indices) if (index >= mesh.verticesCount) throw std::invalid_argument("Index out of the vertices range");
+
+			JoinPositions(positions->values, mesh.verticesCount);
+			AddQuadrics();
+		}
+
+		size_t GetTrianglesCount() const { return m_indices.size() / 3; }
+		const std::vector<uint32_t>& GetIndices() const { return m_indices; }
+		double GetError() const { return m_error; }
+
+		/** The radius of the sphere around the bounding box center of the positions */
+		double GetRadius() const
+		{
+			Vector3 lower = m_positions[0], upper = m_positions[0];
+			for (const Vector3& p : m_positions) for (int k = 0; k < 3; k++) { lower[k] = (std::min)(lower[k], p[k]); upper[k] = (std::max)(upper[k], p[k]); }
+			return 0.5 * std::sqrt(Dot(Subtract(upper, lower), Subtract(upper, lower)));
+		}
+
+		/** Collapse edges until there are at most targetTriangles triangles, or no edge can collapse with an error below maxError */
+		void Simplify(const size_t targetTriangles, const double maxError)
+		{
+			while (GetTrianglesCount() > targetTriangles)
+			{
+				if (CollapseEdges(GetTrianglesCount() - targetTriangles, maxError) == 0) break;
+			}
+		}
+
+	private:
+		struct Collapse
+		{
+			uint32_t from, to;	// Positions
+			double error;
+		};
+
+		/** Number the distinct positions: the vertices at the same position with different attributes are on an attribute seam */
+		void JoinPositions(const std::vector<float>& values, const size_t verticesCount)
+		{
+			struct PositionHash
+			{
+				size_t operator()(const std::array<float, 3>& p) const
+				{
+					uint32_t bits[3];
+					std::memcpy(bits, p.data(), sizeof(bits));
+					return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+				}
+			};
+			std::unordered_map<std::array<float, 3>, uint32_t, PositionHash> positionIds;
+			positionIds.reserve(verticesCount);
+			m_vertexPositions.resize(verticesCount);
+			for (size_t v = 0; v < verticesCount; v++)
+			{
+				// Adding 0 turns -0 into +0, so that they are the same position
+				std::array<float, 3> p = { values[3 * v] + 0.0f, values[3 * v + 1] + 0.0f, values[3 * v + 2] + 0.0f };
+				auto inserted = positionIds.emplace(p, static_cast<uint32_t>(m_positions.size()));
+				if (inserted.second) m_positions.push_back({ p[0], p[1], p[2] });
+				m_vertexPositions[v] = inserted.first->second;
+			}
+		}
+
+		/**
+		 * The plane of each triangle, weighted by its area, and a plane through each border or seam edge perpendicular to its triangle.
+		 * An edge is on a border or a seam when no triangle has the same vertices in the opposite direction.
+		 */
+		void AddQuadrics()
+		{
+			m_quadrics.assign(m_positions.size(), Quadric());
+			std::vector<uint64_t> directedEdges;
+			directedEdges.reserve(m_indices.size());
+			for (size_t i = 0; i < m_indices.size(); i += 3)
+			{
+				for (int k = 0; k < 3; k++) directedEdges.push_back((static_cast<uint64_t>(m_indices[i + k]) << 32) | m_indices[i + (k + 1) % 3]);
+			}
+			std::sort(directedEdges.begin(), directedEdges.end());
+
+			for (size_t i = 0; i < m_indices.size(); i += 3)
+			{
+				const Vector3& p0 = m_positions[m_vertexPositions[m_indices[i]]];
+				Vector3 normal = Cross(Subtract(m_positions[m_vertexPositions[m_indices[i + 1]]], p0), Subtract(m_positions[m_vertexPositions[m_indices[i + 2]]], p0));
+				double doubleArea = std::sqrt(Dot(normal, normal));
+				if (doubleArea == 0.0) continue;
+				for (double& n : normal) n /= doubleArea;
+
+				Quadric triangle;
+				triangle.AddPlane(normal, p0, 0.5 * doubleArea);
+				for (int k = 0; k < 3; k++) m_quadrics[m_vertexPositions[m_indices[i + k]]].Add(triangle);
+
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t a = m_indices[i + k], b = m_indices[i + (k + 1) % 3];
+					if (std::binary_search(directedEdges.begin(), directedEdges.end(), (static_cast<uint64_t>(b) << 32) | a)) continue;
+
+					const Vector3& pa = m_positions[m_vertexPositions[a]];
+					Vector3 edge = Subtract(m_positions[m_vertexPositions[b]], pa);
+					Vector3 edgeNormal = Cross(edge, normal);
+					double length = std::sqrt(Dot(edgeNormal, edgeNormal));
+					if (length == 0.0) continue;
+					for (double& n : edgeNormal) n /= length;
+
+					Quadric border;
+					border.AddPlane(edgeNormal, pa, BORDER_WEIGHT * Dot(edge, edge));
+					m_quadrics[m_vertexPositions[a]].Add(border);
+					m_quadrics[m_vertexPositions[b]].Add(border);
+				}
+			}
+		}
+
+		/** List the triangles around each position, and classify the positions from the edges of the current triangles */
+		void BuildAdjacency()
+		{
+			const size_t positionsCount = m_positions.size();
+			m_triangleOffsets.assign(positionsCount + 1, 0);
+			for (const uint32_t v : m_indices) m_triangleOffsets[m_vertexPositions[v] + 1]++;
+			for (size_t p = 0; p < positionsCount; p++) m_triangleOffsets[p + 1] += m_triangleOffsets[p];
+			m_triangles.resize(m_indices.size());
+			std::vector<uint32_t> cursor(m_triangleOffsets.begin(), m_triangleOffsets.end() - 1);
+			for (size_t i = 0; i < m_indices.size(); i++) m_triangles[cursor[m_vertexPositions[m_indices[i]]]++] = static_cast<uint32_t>(i / 3);
+
+			m_edges.clear();
+			m_edges.reserve(m_indices.size());
+			for (size_t i = 0; i < m_indices.size(); i += 3)
+			{
+				for (int k = 0; k < 3; k++) m_edges.push_back(EdgeKey(m_vertexPositions[m_indices[i + k]], m_vertexPositions[m_indices[i + (k + 1) % 3]]));
+			}
+			std::sort(m_edges.begin(), m_edges.end());
+
+			// Count the triangles of each edge: one is a border, more than two is non manifold
+			std::vector<uint8_t> borderEdgesCount(positionsCount, 0);
+			m_kinds.assign(positionsCount, VertexKind::Manifold);
+			m_edgeTrianglesCount.clear();
+			size_t unique = 0;
+			for (size_t e = 0; e < m_edges.size();)
+			{
+				size_t end = e;
+				while (end < m_edges.size() && m_edges[end] == m_edges[e]) end++;
+				uint32_t a = static_cast<uint32_t>(m_edges[e] >> 32), b = static_cast<uint32_t>(m_edges[e]);
+				size_t count = end - e;
+				if (count == 1)
+				{
+					borderEdgesCount[a] = static_cast<uint8_t>((std::min)(borderEdgesCount[a] + 1, 3));
+					borderEdgesCount[b] = static_cast<uint8_t>((std::min)(borderEdgesCount[b] + 1, 3));
+				}
+				else if (count > 2) m_kinds[a] = m_kinds[b] = VertexKind::Locked;
+				m_edges[unique++] = m_edges[e];
+				m_edgeTrianglesCount.push_back(static_cast<uint32_t>(count));
+				e = end;
+			}
+			m_edges.resize(unique);
+
+			for (size_t p = 0; p < positionsCount; p++)
+			{
+				if (m_kinds[p] == VertexKind::Locked || borderEdgesCount[p] == 0) continue;
+				m_kinds[p] = (borderEdgesCount[p] == 2) ? VertexKind::Border : VertexKind::Locked;
+			}
+		}
+
+		bool CanCollapse(const uint32_t from, const bool isBorderEdge) const
+		{
+			return m_kinds[from] == VertexKind::Manifold || (m_kinds[from] == VertexKind::Border && isBorderEdge);
+		}
+
+		double GetCollapseError(const uint32_t from, const uint32_t to) const
+		{
+			Quadric q = m_quadrics[from];
+			q.Add(m_quadrics[to]);
+			return q.weight > 0.0 ? q.Evaluate(m_positions[to]) / q.weight : 0.0;
+		}
+
+		/** The position of a corner of a triangle, after the collapses of the current pass */
+		uint32_t GetCornerPosition(const size_t corner) const { return m_vertexPositions[m_vertexRemap[m_indices[corner]]]; }
+
+		/**
+		 * Return true if moving from onto to keeps the orientation of the triangles around from, and set the vertices each
+		 * vertex at from moves to: the vertex at to that shares an edge with it. A vertex with no such vertex, or two, means
+		 * that the edge does not follow the seam.
+		 */
+		bool CheckCollapse(const uint32_t from, const uint32_t to, std::vector<std::pair<uint32_t, uint32_t>>& targets, size_t& removedTriangles) const
+		{
+			targets.clear();
+			removedTriangles = 0;
+			for (size_t i = m_triangleOffsets[from]; i < m_triangleOffsets[from + 1]; i++)
+			{
+				size_t t = m_triangles[i];
+				uint32_t corners[3] = { GetCornerPosition(3 * t), GetCornerPosition(3 * t + 1), GetCornerPosition(3 * t + 2) };
+				if (corners[0] == corners[1] || corners[1] == corners[2] || corners[0] == corners[2]) continue;	// Removed by a collapse of this pass
+
+				int fromCorner = (corners[0] == from) ? 0 : (corners[1] == from) ? 1 : 2;
+				uint32_t vertex = m_indices[3 * t + fromCorner];
+				auto target = std::find_if(targets.begin(), targets.end(), [vertex](const std::pair<uint32_t, uint32_t>& p) { return p.first == vertex; });
+				if (target == targets.end()) target = targets.insert(targets.end(), { vertex, UINT32_MAX });
+
+				int toCorner = (corners[0] == to) ? 0 : (corners[1] == to) ? 1 : (corners[2] == to) ? 2 : -1;
+				if (toCorner != -1)
+				{
+					uint32_t toVertex = m_vertexRemap[m_indices[3 * t + toCorner]];
+					if (target->second != UINT32_MAX && target->second != toVertex) return false;
+					target->second = toVertex;
+					removedTriangles++;
+					continue;
+				}
+
+				const Vector3& a = m_positions[corners[(fromCorner + 1) % 3]];
+				const Vector3& b = m_positions[corners[(fromCorner + 2) % 3]];
+				Vector3 before = Cross(Subtract(a, m_positions[from]), Subtract(b, m_positions[from]));
+				Vector3 after = Cross(Subtract(a, m_positions[to]), Subtract(b, m_positions[to]));
+				if (Dot(before, after) <= FLIP_THRESHOLD * std::sqrt(Dot(before, before) * Dot(after, after))) return false;
+			}
+			for (const auto& target : targets) if (target.second == UINT32_MAX) return false;
+			return removedTriangles > 0;
+		}
+
+		/**
+		 * One pass of collapses, the cheapest first: the positions of a collapse are not collapsed again in the same pass, so the
+		 * checks only see the triangles as they were at its start. Return the number of collapses.
+		 */
+		size_t CollapseEdges(const size_t trianglesToRemove, const double maxError)
+		{
+			BuildAdjacency();
+			m_vertexRemap.resize(m_vertexPositions.size());
+			for (uint32_t v = 0; v < m_vertexRemap.size(); v++) m_vertexRemap[v] = v;
+
+			// The candidates are checked on the triangles at the start of the pass, so that the ones that fail do not set its error limit
+			std::vector<Collapse> collapses;
+			std::vector<std::pair<uint32_t, uint32_t>> targets;
+			size_t removedTriangles = 0;
+			for (size_t e = 0; e < m_edges.size(); e++)
+			{
+				uint32_t a = static_cast<uint32_t>(m_edges[e] >> 32), b = static_cast<uint32_t>(m_edges[e]);
+				bool isBorderEdge = m_edgeTrianglesCount[e] == 1;
+				Collapse ab = { a, b, CanCollapse(a, isBorderEdge) ? GetCollapseError(a, b) : HUGE_VAL };
+				Collapse ba = { b, a, CanCollapse(b, isBorderEdge) ? GetCollapseError(b, a) : HUGE_VAL };
+				if (ba.error < ab.error) std::swap(ab, ba);
+				for (const Collapse& collapse : { ab, ba })
+				{
+					if (collapse.error > maxError * maxError) break;
+					if (CheckCollapse(collapse.from, collapse.to, targets, removedTriangles)) { collapses.push_back(collapse); break; }
+				}
+			}
+			if (collapses.empty()) return 0;
+			std::stable_sort(collapses.begin(), collapses.end(), [](const Collapse& c0, const Collapse& c1) { return c0.error < c1.error; });
+
+			// An interior collapse removes two triangles, the pass stops a little above the error that would reach the goal
+			size_t goal = (std::min)(collapses.size() - 1, (trianglesToRemove + 1) / 2);
+			double errorLimit = collapses[goal].error * PASS_ERROR_FACTOR;
+
+			std::vector<bool> isLocked(m_positions.size(), false);
+			size_t collapsesCount = 0;
+			removedTriangles = 0;
+			for (const Collapse& collapse : collapses)
+			{
+				if (removedTriangles >= trianglesToRemove || (collapsesCount > 0 && collapse.error > errorLimit)) break;
+				if (isLocked[collapse.from] || isLocked[collapse.to]) continue;
+
+				size_t collapseRemovedTriangles = 0;
+				if (!CheckCollapse(collapse.from, collapse.to, targets, collapseRemovedTriangles)) continue;
+
+				for (const auto& target : targets) m_vertexRemap[target.first] = target.second;
+				m_quadrics[collapse.to].Add(m_quadrics[collapse.from]);
+				m_error = (std::max)(m_error, std::sqrt(collapse.error));
+				isLocked[collapse.from] = isLocked[collapse.to] = true;
+				removedTriangles += collapseRemovedTriangles;
+				collapsesCount++;
+			}
+
+			// Rewrite the indices, without the triangles that lost an edge
+			size_t kept = 0;
+			for (size_t i = 0; i < m_indices.size(); i += 3)
+			{
+				uint32_t a = m_vertexRemap[m_indices[i]], b = m_vertexRemap[m_indices[i + 1]], c = m_vertexRemap[m_indices[i + 2]];
+				uint32_t pa = m_vertexPositions[a], pb = m_vertexPositions[b], pc = m_vertexPositions[c];
+				if (pa == pb || pb == pc || pa == pc) continue;
+				m_indices[kept++] = a;
+				m_indices[kept++] = b;
+				m_indices[kept++] = c;
+			}
+			m_indices.resize(kept);
+			return collapsesCount;
+		}
+
+		std::vector<uint32_t> m_indices;
+		std::vector<Vector3> m_positions;				// The distinct positions
+		std::vector<uint32_t> m_vertexPositions;		// The position of each vertex
+		std::vector<Quadric> m_quadrics;				// The quadric of each position, with the quadrics of the positions collapsed onto it
+		double m_error = 0.0;
+
+		// The current pass
+		std::vector<uint32_t> m_triangleOffsets;
+		std::vector<uint32_t> m_triangles;				// The triangles around each position
+		std::vector<uint64_t> m_edges;					// The distinct edges between positions
+		std::vector<uint32_t> m_edgeTrianglesCount;
+		std::vector<VertexKind> m_kinds;
+		std::vector<uint32_t> m_vertexRemap;			// The vertex each vertex collapsed onto
+	};
+}
+
+void SimplificationReport::Add(const SimplificationReport& report)
+{
+	meshesCount += report.meshesCount;
+	trianglesCount += report.trianglesCount;
+	if (lodTrianglesCount.size() < report.lodTrianglesCount.size()) lodTrianglesCount.resize(report.lodTrianglesCount.size(), 0);
+	if (lodRelativeError.size() < report.lodRelativeError.size()) lodRelativeError.resize(report.lodRelativeError.size(), 0.0f);
+	for (size_t l = 0; l < report.lodTrianglesCount.size(); l++) lodTrianglesCount[l] += report.lodTrianglesCount[l];
+	for (size_t l = 0; l < report.lodRelativeError.size(); l++) lodRelativeError[l] = (std::max)(lodRelativeError[l], report.lodRelativeError[l]);
+}
+
+SimplificationReport SimplifyMesh(const MeshStreams& mesh, const SimplificationOptions& options, std::vector<MeshLod>& lods)
+{
+	lods.clear();
+	SimplificationReport report;
+	if (mesh.indices.size() / 3 < options.minTrianglesCount) return report;
+
+	Simplifier simplifier(mesh);
+	const size_t trianglesCount = simplifier.GetTrianglesCount();
+	const double radius = simplifier.GetRadius();
+	for (const float ratio : options.lodRatios)
+	{
+		size_t previousCount = lods.empty() ? trianglesCount : lods.back().indices.size() / 3;
+		simplifier.Simplify(static_cast<size_t>(static_cast<double>(trianglesCount) * ratio), options.maxRelativeError * radius);
+		if (simplifier.GetTrianglesCount() >= previousCount) break;	// Nothing left to collapse
+		lods.push_back({ simplifier.GetIndices(), static_cast<float>(simplifier.GetError()) });
+	}
+	if (lods.empty()) return report;
+
+	report.meshesCount = 1;
+	report.trianglesCount = trianglesCount;
+	for (size_t l = 0; l < options.lodRatios.size(); l++)
+	{
+		const MeshLod& lod = lods[(std::min)(l, lods.size() - 1)];
+		report.lodTrianglesCount.push_back(lod.indices.size() / 3);
+		report.lodRelativeError.push_back(radius > 0.0 ? static_cast<float>(lod.error / radius) : 0.0f);
+	}
+	return report;
+}
+
+SimplificationReport SimplifyMeshes(const std::vector<MeshStreams>& meshes, const SimplificationOptions& options, ThreadPool& pool, std::vector<std::vector<MeshLod>>& lods)
+{
+	lods.assign(meshes.size(), {});
+	std::vector<SimplificationReport> reports(meshes.size());
+	pool.ParallelFor(meshes.size(), [&](size_t m) { reports[m] = SimplifyMesh(meshes[m], options, lods[m]); });
+
+	SimplificationReport report;
+	for (const SimplificationReport& meshReport : reports) report.Add(meshReport);
+	return report;
+}
@@ -0,0 +1,249 @@
+#include "Benchmark.h"
+#include "MeshSimplification.h"
+#include "MeshStreams.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+	const std::vector<std::string> DEFAULT_SIMPLIFICATION_MODELS = { "models/2CylinderEngine.glb", "models/DamagedHelmet.glb", "models/NormalTangentTest.glb", "models/scene.gltf" };
+	constexpr size_t GRID_SIDE = 512;	// About 500K triangles
+	constexpr int SIMPLIFICATION_REPETITIONS = 3;
+
+	/**
+	 * A side x side height field of quads, its vertices on the column side / 2 are split in two with different texture coordinates:
+	 * the triangles on the left use the first copy and the ones on the right the second, as on an attribute seam.
+	 */
+	MeshStreams CreateSeamGrid(const size_t side, std::vector<uint8_t>& vertexCharts)
+	{
+		const float pi = 3.14159265f;
+		const size_t seam = side / 2;
+		std::vector<float> positions, texCoords;
+		std::vector<uint32_t> gridVertices[2];	// The vertex of each grid point, for the left and the right triangles
+		gridVertices[0].resize((side + 1) * (side + 1));
+		gridVertices[1].resize((side + 1) * (side + 1));
+		vertexCharts.clear();
+		for (size_t y = 0; y <= side; y++)
+		{
+			for (size_t x = 0; x <= side; x++)
+			{
+				size_t point = y * (side + 1) + x;
+				float height = 0.05f * side * std::sin(4.0f * pi * x / side) * std::cos(4.0f * pi * y / side);
+				for (uint8_t chart = 0; chart < 2; chart++)
+				{
+					// The points left of the seam only have a vertex for the left triangles, and the ones right of it for the right triangles
+					if ((chart == 0 && x > seam) || (chart == 1 && x < seam)) continue;
+					gridVertices[chart][point] = static_cast<uint32_t>(positions.size() / 3);
+					positions.insert(positions.end(), { float(x), height, float(y) });
+					texCoords.insert(texCoords.end(), { float(x) / side + chart, float(y) / side });
+					vertexCharts.push_back(chart);
+				}
+			}
+		}
+
+		MeshStreams mesh;
+		mesh.verticesCount = positions.size() / 3;
+		mesh.SetStream("POSITION", 3, std::move(positions));
+		mesh.SetStream("TEXCOORD_0", 2, std::move(texCoords));
+		for (uint32_t y = 0; y < side; y++)
+		{
+			for (uint32_t x = 0; x < side; x++)
+			{
+				const std::vector<uint32_t>& vertices = gridVertices[(x < seam) ? 0 : 1];
+				uint32_t p = y * uint32_t(side + 1) + x, w = uint32_t(side + 1);
+				mesh.indices.insert(mesh.indices.end(), { vertices[p], vertices[p + w], vertices[p + 1], vertices[p + 1], vertices[p + w], vertices[p + w + 1] });
+			}
+		}
+		return mesh;
+	}
+
+	/**
+	 * Return true if the levels of the grid keep its outline and its seam: every open edge runs along a side of the grid and they
+	 * add up to its perimeter, and no triangle uses the vertices of both sides of the seam.
+	 */
+	bool IsGridOutlineKept(const MeshStreams& grid, const std::vector<uint8_t>& vertexCharts, const size_t side, const MeshLod& lod)
+	{
+		const std::vector<float>& positions = grid.Find("POSITION")->values;
+		const float last = float(side);
+		std::vector<uint64_t> edges;
+		for (size_t i = 0; i < lod.indices.size(); i += 3)
+		{
+			uint32_t a = lod.indices[i], b = lod.indices[i + 1], c = lod.indices[i + 2];
+			if (vertexCharts[a] != vertexCharts[b] || vertexCharts[b] != vertexCharts[c]) return false;
+			for (int k = 0; k < 3; k++)
+			{
+				// The edges are compared by grid point, the two copies of a seam vertex are the same point
+				auto point = [&](const uint32_t v) { return static_cast<uint64_t>(positions[3 * v + 2] * (side + 1) + positions[3 * v]); };
+				uint64_t p0 = point(lod.indices[i + k]), p1 = point(lod.indices[i + (k + 1) % 3]);
+				edges.push_back((std::min)(p0, p1) * (side + 1) * (side + 1) + (std::max)(p0, p1));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		double perimeter = 0.0;
+		for (size_t e = 0; e < edges.size();)
+		{
+			size_t end = e;
+			while (end < edges.size() && edges[end] == edges[e]) end++;
+			if (end - e == 1)
+			{
+				uint64_t p0 = edges[e] / ((side + 1) * (side + 1)), p1 = edges[e] % ((side + 1) * (side + 1));
+				float x0 = float(p0 % (side + 1)), y0 = float(p0 / (side + 1)), x1 = float(p1 % (side + 1)), y1 = float(p1 / (side + 1));
+				bool isOnSide = (x0 == x1 && (x0 == 0.0f || x0 == last)) || (y0 == y1 && (y0 == 0.0f || y0 == last));
+				if (!isOnSide) return false;
+				perimeter += std::abs(x1 - x0) + std::abs(y1 - y0);
+			}
+			e = end;
+		}
+		return perimeter == 4.0 * side;
+	}
+
+	/** Return true if the levels are valid triangle lists over the mesh vertices, with fewer triangles and larger errors each */
+	bool IsChainValid(const MeshStreams& mesh, const std::vector<MeshLod>& lods)
+	{
+		size_t previousCount = mesh.indices.size() / 3;
+		float previousError = 0.0f;
+		for (const MeshLod& lod : lods)
+		{
+			if (lod.indices.size() % 3 != 0 || lod.indices.size() / 3 >= previousCount || lod.error < previousError) return false;
+			for (const uint32_t index : lod.indices) if (index >= mesh.verticesCount) return false;
+			previousCount = lod.indices.size() / 3;
+			previousError = lod.error;
+		}
+		return true;
+	}
+
+	void PrintLevels(const SimplificationReport& report)
+	{
+		std::cout << "\"levels\": [";
+		for (size_t l = 0; l < report.lodTrianglesCount.size(); l++)
+		{
+			std::cout << (l == 0 ? "" : ", ") << std::setprecision(5) << "{ \"triangles\": " << report.lodTrianglesCount[l] << ", \"relativeError\": " << report.lodRelativeError[l] << " }";
+		}
+		std::cout << "]";
+	}
+
+	/** Simplify the meshes one after the other and on the pool, check the chains and print the report as a JSON object */
+	bool CheckSimplification(const std::string& name, const std::vector<MeshStreams>& meshes, const SimplificationOptions& options, ThreadPool& pool, const bool isLast,
+		const std::function<bool(const MeshLod&, size_t)>& checkLod = nullptr)
+	{
+		std::vector<double> serialMilliseconds, parallelMilliseconds;
+		std::vector<std::vector<MeshLod>> lods, serialLods(meshes.size());
+		SimplificationReport report;
+		for (int r = 0; r < SIMPLIFICATION_REPETITIONS; r++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (size_t m = 0; m < meshes.size(); m++) SimplifyMesh(meshes[m], options, serialLods[m]);
+			serialMilliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+			start = std::chrono::steady_clock::now();
+			report = SimplifyMeshes(meshes, options, pool, lods);
+			parallelMilliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(serialMilliseconds.begin(), serialMilliseconds.end());
+		std::sort(parallelMilliseconds.begin(), parallelMilliseconds.end());
+		double serialMs = serialMilliseconds[serialMilliseconds.size() / 2], parallelMs = parallelMilliseconds[parallelMilliseconds.size() / 2];
+
+		// The levels cannot depend on the threads, every chain must be valid, and complete to pass checkLod
+		bool isSameLods = true, isValid = true, isLodChecked = true;
+		for (size_t m = 0; m < meshes.size(); m++)
+		{
+			isValid &= IsChainValid(meshes[m], lods[m]);
+			isSameLods &= lods[m].size() == serialLods[m].size();
+			for (size_t l = 0; isSameLods && l < lods[m].size(); l++) isSameLods &= lods[m][l].indices == serialLods[m][l].indices && lods[m][l].error == serialLods[m][l].error;
+			if (checkLod) isLodChecked &= lods[m].size() == options.lodRatios.size();
+			for (size_t l = 0; checkLod && l < lods[m].size(); l++) isLodChecked &= checkLod(lods[m][l], l);
+		}
+		bool isMatch = isSameLods && isValid && isLodChecked;
+
+		std::cout << std::fixed << std::setprecision(3)
+			<< "    { \"mesh\": \"" << name << "\", \"primitives\": " << meshes.size() << ", \"simplifiedPrimitives\": " << report.meshesCount
+			<< ", \"triangles\": " << report.trianglesCount << ", ";
+		PrintLevels(report);
+		std::cout << std::fixed << std::setprecision(3) << ", \"threads\": " << pool.GetThreadsCount() << ", \"serialMs\": " << serialMs << ", \"parallelMs\": " << parallelMs
+			<< ", \"mTrianglesPerSecond\": " << report.trianglesCount / (parallelMs * 1000.0) << ", \"sameLevels\": " << (isSameLods ? "true" : "false")
+			<< ", \"validChains\": " << (isValid ? "true" : "false") << ", \"match\": " << (isMatch ? "true" : "false") << " }" << (isLast ? "" : ",") << std::endl;
+		return isMatch;
+	}
+
+	/** A vertex out of range must be rejected, and a mesh below the minimum triangles left without levels */
+	bool CheckInvalidMeshes()
+	{
+		bool isRejected = false;
+		MeshStreams mesh;
+		mesh.verticesCount = 3;
+		mesh.SetStream("POSITION", 3, { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f });
+		mesh.indices = { 0, 1, 3 };
+		SimplificationOptions options;
+		options.minTrianglesCount = 0;
+		std::vector<MeshLod> lods;
+		try { SimplifyMesh(mesh, options, lods); }
+		catch (const std::invalid_argument&) { isRejected = true; }
+
+		mesh.indices = { 0, 1, 2 };
+		SimplificationReport report = SimplifyMesh(mesh, SimplificationOptions(), lods);
+		bool isSmallKept = lods.empty() && report.meshesCount == 0;
+		bool isMatch = isRejected && isSmallKept;
+		std::cout << "  \"invalidMeshes\": { \"outOfRangeRejected\": " << (isRejected ? "true" : "false") << ", \"smallMeshKept\": "
+			<< (isSmallKept ? "true" : "false") << ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunSimplification(const std::vector<std::string>& args)
+	{
+		std::vector<std::string> fileNames = args.empty() ? DEFAULT_SIMPLIFICATION_MODELS : args;
+		ThreadPool& pool = ThreadPool::GetDefault();
+		SimplificationOptions options;
+
+		std::cout << "{" << std::endl;
+		bool isMatch = CheckInvalidMeshes();
+		std::cout << "  \"meshes\": [" << std::endl;
+
+		// The grid has no reason to stop early: every level must reach its ratio, give or take a few collapses, with the outline and the seam in place
+		std::vector<uint8_t> vertexCharts;
+		std::vector<MeshStreams> grid = { CreateSeamGrid(GRID_SIDE, vertexCharts) };
+		size_t gridTriangles = grid[0].indices.size() / 3;
+		isMatch &= CheckSimplification("seamGrid", grid, options, pool, fileNames.empty(), [&](const MeshLod& lod, const size_t level)
+			{
+				double target = static_cast<double>(gridTriangles) * options.lodRatios[level];
+				bool isRatioReached = lod.indices.size() / 3 <= target && lod.indices.size() / 3 >= 0.99 * target;
+				return isRatioReached && IsGridOutlineKept(grid[0], vertexCharts, GRID_SIDE, lod);
+			});
+
+		for (size_t f = 0; f < fileNames.size(); f++)
+		{
+			std::vector<MeshStreams> meshes = LoadMeshStreams(fileNames[f]);
+			meshes.erase(std::remove_if(meshes.begin(), meshes.end(), [](const MeshStreams& mesh) { return mesh.indices.empty(); }), meshes.end());
+			isMatch &= CheckSimplification(std::filesystem::path(fileNames[f]).generic_string(), meshes, options, pool, f == fileNames.size() - 1);
+		}
+		std::cout << "  ]" << std::endl << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef MESH_SIMPLIFICATION_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunSimplification({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
@@ -0,0 +1,145 @@
+#include "MeshStreams.h"
+#include "GLTFJsonReader.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+const std::vector<std::string> MESH_STREAM_SEMANTICS = { "POSITION", "NORMAL", "TANGENT", "TEXCOORD_0", "TEXCOORD_1", "COLOR_0" };
+
+VertexStream* MeshStreams::Find(const std::string& semantic)
+{
+	for (VertexStream& stream : streams) if (stream.semantic == semantic) return &stream;
+	return nullptr;
+}
+
+const VertexStream* MeshStreams::Find(const std::string& semantic) const
+{
+	for (const VertexStream& stream : streams) if (stream.semantic == semantic) return &stream;
+	return nullptr;
+}
+
+void MeshStreams::SetStream(const std::string& semantic, const size_t elementsCount, std::vector<float>&& values)
+{
+	if (values.size() != verticesCount * elementsCount) throw std::invalid_argument("The " + semantic + " stream does not match the vertices count");
+	VertexStream* stream = Find(semantic);
+	if (stream == nullptr) stream = &streams.emplace_back();
+	stream->semantic = semantic;
+	stream->elementsCount = elementsCount;
+	stream->values = std::move(values);
+}
+
+void MeshStreams::GatherVertices(const std::vector<uint32_t>& sourceVertices)
+{
+	for (const uint32_t v : sourceVertices) if (v >= verticesCount) throw std::invalid_argument("Source vertex out of range");
+	for (VertexStream& stream : streams)
+	{
+		const size_t n = stream.elementsCount;
+		std::vector<float> values(sourceVertices.size() * n);
+		for (size_t v = 0; v < sourceVertices.size(); v++)
+		{
+			const float* src = &stream.values[sourceVertices[v] * n];
+			for (size_t k = 0; k < n; k++) values[v * n + k] = src[k];
+		}
+		stream.values = std::move(values);
+	}
+	verticesCount = sourceVertices.size();
+}
+
+MeshStreams ReadMeshStreams(const tinygltf::Primitive& primitive, const std::function<AccessorDesc(int)>& getAccessor)
+{
+	MeshStreams mesh;
+	bool isFirst = true;
+	for (const std::string& semantic : MESH_STREAM_SEMANTICS)
+	{
+		auto attribute = primitive.attributes.find(semantic);
+		if (attribute == primitive.attributes.end()) continue;
+
+		AccessorDesc accessor = getAccessor(attribute->second);
+		if (isFirst) mesh.verticesCount = accessor.count;
+		else if (accessor.count != mesh.verticesCount) throw std::runtime_error("The " + semantic + " attribute does not match the vertices count");
+		isFirst = false;
+
+		VertexStream& stream = mesh.streams.emplace_back();
+		stream.semantic = semantic;
+		stream.elementsCount = accessor.elementsCount;
+		stream.values.resize(accessor.count * accessor.elementsCount);
+		ReadAccessorFloats(accessor, stream.values.data());
+	}
+	return mesh;
+}
+
+std::vector<MeshStreams> LoadMeshStreams(const std::string& fileName)
+{
+	auto readFile = [](const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file) throw std::runtime_error("Cannot open " + path.string());
+		return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	};
+
+	std::vector<uint8_t> data = readFile(fileName);
+	tinygltf::Model model;
+	GLTFJsonReader reader;
+	GLBChunks chunks;
+	bool isBinary = data.size() >= 4 && data[0] == 'g' && data[1] == 'l' && data[2] == 'T' && data[3] == 'F';
+	if (isBinary)
+	{
+		chunks = GLTFJsonReader::ReadGLBChunks(data.data(), data.size());
+		reader.Parse(chunks.json, chunks.jsonSize, model);
+	}
+	else reader.Parse(reinterpret_cast<const char*>(data.data()), data.size(), model);
+
+	// Buffer 0 of a .glb without uri is its BIN chunk, the others are data uris or files relative to the glTF file
+	std::vector<std::vector<uint8_t>> buffers(model.buffers.size());
+	std::vector<std::pair<const uint8_t*, size_t>> buffersData(model.buffers.size());
+	for (size_t b = 0; b < model.buffers.size(); b++)
+	{
+		const std::string& uri = model.buffers[b].uri;
+		if (uri.empty())
+		{
+			if (!isBinary || b != 0 || chunks.bin == nullptr) throw std::runtime_error("Buffer " + std::to_string(b) + " has no data");
+			buffersData[b] = { chunks.bin, chunks.binSize };
+			continue;
+		}
+		if (!GLTFJsonReader::DecodeDataURI(uri, buffers[b])) buffers[b] = readFile(std::filesystem::path(fileName).parent_path() / uri);
+		buffersData[b] = { buffers[b].data(), buffers[b].size() };
+	}
+
+	auto getAccessor = [&model, &buffersData](const int accessorId)
+	{
+		const tinygltf::Accessor& accessor = model.accessors.at(accessorId);
+		const tinygltf::BufferView& bufferView = model.bufferViews.at(accessor.bufferView);
+		const std::pair<const uint8_t*, size_t>& buffer = buffersData.at(bufferView.buffer);
+		AccessorDesc desc;
+		desc.count = accessor.count;
+		desc.byteStride = bufferView.byteStride;
+		desc.componentType = accessor.componentType;
+		desc.elementsCount = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+		desc.normalized = accessor.normalized;
+		desc.data = buffer.first + bufferView.byteOffset + accessor.byteOffset;
+		if (bufferView.byteOffset + accessor.byteOffset + desc.GetByteLength() > buffer.second)
+		{
+			throw std::runtime_error("Accessor " + std::to_string(accessorId) + " is out of its buffer");
+		}
+		return desc;
+	};
+
+	std::vector<MeshStreams> meshes;
+	for (const tinygltf::Mesh& mesh : model.meshes)
+	{
+		for (const tinygltf::Primitive& primitive : mesh.primitives)
+		{
+			if (primitive.mode != TINYGLTF_MODE_TRIANGLES || !primitive.attributes.count("POSITION")) continue;
+			MeshStreams streams = ReadMeshStreams(primitive, getAccessor);
+			if (primitive.indices != -1)
+			{
+				AccessorDesc indices = getAccessor(primitive.indices);
+				streams.indices.resize(indices.count);
+				ReadAccessorUInt32(indices, streams.indices.data());
+			}
+			meshes.push_back(std::move(streams));
+		}
+	}
+	return meshes;
+}
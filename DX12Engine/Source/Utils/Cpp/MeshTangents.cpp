@@ -0,0 +1,410 @@
+#include "MeshTangents.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MESH_TANGENTS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	constexpr size_t CHUNK_SIZE = 16384;	// Triangles, corners or vertices processed by a parallel loop iteration
+	constexpr size_t PREFETCH_DISTANCE = 4;	// Triangles ahead whose vertices the single threaded loop prefetches, the indices scatter them in memory
+
+	constexpr uint8_t CORNER_ORIENT_PRESERVING = 1;	// The triangle keeps the texture orientation, it is also the orientation bit of the group id
+	constexpr uint8_t CORNER_GROUP_WITH_ANY = 2;	// The triangle has no tangent, its corners join the other triangles of their vertex
+
+	constexpr uint32_t NO_GROUP = UINT32_MAX;			// A vertex whose triangles all have no tangent
+	constexpr uint32_t UNUSED_VERTEX = UINT32_MAX - 1;	// A vertex of no triangle
+
+	/** Call fn(begin, end) on consecutive ranges of [0, count) on the pool threads */
+	template <class F>
+	void ParallelForChunks(ThreadPool& pool, const size_t count, F&& fn)
+	{
+		pool.ParallelFor((count + CHUNK_SIZE - 1) / CHUNK_SIZE, [&](size_t chunk)
+			{
+				fn(chunk * CHUNK_SIZE, (std::min)(count, (chunk + 1) * CHUNK_SIZE));
+			});
+	}
+
+	/** Start loading the cache line of p, the loops over the triangles wait on their vertices more than they compute */
+	void Prefetch(const void* p)
+	{
+#ifdef MESH_TANGENTS_SSE2
+		_mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+		(void)p;
+#endif
+	}
+
+	/** The coefficients of acos(x) = sqrt(1 - x) * polynomial(x) on [0, 1], from the highest degree, Abramowitz and Stegun 4.4.46 */
+	constexpr float ACOS_COEFFICIENTS[8] = { -0.0012624911f, 0.0066700901f, -0.0170881256f, 0.0308918810f, -0.0501743046f, 0.0889789874f, -0.2145988016f, 1.5707963050f };
+	constexpr float PI = 3.14159265358979f;
+
+	struct Float3 { float x, y, z; };
+
+	Float3 Load3(const float* p) { return { p[0], p[1], p[2] }; }
+	Float3 operator+(const Float3 a, const Float3 b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	Float3 operator-(const Float3 a, const Float3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	Float3 operator*(const float s, const Float3 v) { return { s * v.x, s * v.y, s * v.z }; }
+	float Dot(const Float3 a, const Float3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+	// The MikkTSpace tests for zero: lengths and areas below the smallest normalized float are degenerate
+	bool NotZero(const float x) { return std::fabs(x) > FLT_MIN; }
+	bool NotZero(const Float3 v) { return NotZero(v.x) || NotZero(v.y) || NotZero(v.z); }
+	Float3 NormalizeSafe(const Float3 v) { return NotZero(v) ? (1.0f / std::sqrt(Dot(v, v))) * v : v; }
+
+	/** The position, normal and texture coordinates of the vertices */
+	struct VertexAttributes
+	{
+		const float* positions;
+		const float* normals;
+		const float* texCoords;
+
+		bool IsSame(const uint32_t a, const uint32_t b) const
+		{
+			for (size_t i = 0; i < 3; i++) { if (positions[3 * a + i] != positions[3 * b + i] || normals[3 * a + i] != normals[3 * b + i]) return false; }
+			return texCoords[2 * a] == texCoords[2 * b] && texCoords[2 * a + 1] == texCoords[2 * b + 1];
+		}
+
+		uint32_t Hash(const uint32_t v) const
+		{
+			// Equal values must hash equal: adding 0 turns -0 into +0
+			uint32_t hash = 2166136261u;
+			auto add = [&hash](const float value) { float f = value + 0.0f; uint32_t bits; std::memcpy(&bits, &f, sizeof(bits)); hash = (hash ^ bits) * 16777619u; };
+			for (size_t i = 0; i < 3; i++) { add(positions[3 * v + i]); add(normals[3 * v + i]); }
+			add(texCoords[2 * v]);
+			add(texCoords[2 * v + 1]);
+			return hash ^ (hash >> 15);
+		}
+	};
+
+	/** The sum of the corner tangents of a vertex in one orientation */
+	struct GroupSum
+	{
+		Float3 tangent;
+		float cornersCount;
+	};
+
+	void AddCorner(GroupSum& group, const Float3 cornerTangent)
+	{
+		group.tangent = group.tangent + cornerTangent;
+		group.cornersCount += 1.0f;
+	}
+
+	/** Compute the unit triangle tangent of the vertices v, signed by the texture orientation, and return the flags of its corners */
+	uint8_t GetTriangleTangent(const VertexAttributes& attributes, const uint32_t v[3], Float3& tangent)
+	{
+		uint8_t flags = CORNER_GROUP_WITH_ANY;
+		tangent = { 0.0f, 0.0f, 0.0f };
+		if (attributes.IsSame(v[0], v[1]) || attributes.IsSame(v[1], v[2]) || attributes.IsSame(v[0], v[2])) return flags;
+
+		// MikkTSpace expects the texture coordinates origin at the bottom left, the glTF one is at the top left
+		Float3 p[3] = { Load3(attributes.positions + 3 * v[0]), Load3(attributes.positions + 3 * v[1]), Load3(attributes.positions + 3 * v[2]) };
+		const float* uv[3] = { attributes.texCoords + 2 * v[0], attributes.texCoords + 2 * v[1], attributes.texCoords + 2 * v[2] };
+		Float3 d1 = p[1] - p[0], d2 = p[2] - p[0];
+		float t21x = uv[1][0] - uv[0][0], t21y = uv[0][1] - uv[1][1];
+		float t31x = uv[2][0] - uv[0][0], t31y = uv[0][1] - uv[2][1];
+		float signedAreaUV = t21x * t31y - t21y * t31x;
+		tangent = t31y * d1 - t21y * d2;
+		Float3 bitangent = t21x * d2 - t31x * d1;
+		if (signedAreaUV > 0.0f) flags |= CORNER_ORIENT_PRESERVING;
+		if (NotZero(signedAreaUV))
+		{
+			float tangentLength = std::sqrt(Dot(tangent, tangent)), bitangentLength = std::sqrt(Dot(bitangent, bitangent));
+			if (NotZero(tangentLength)) tangent = (((flags & CORNER_ORIENT_PRESERVING) ? 1.0f : -1.0f) / tangentLength) * tangent;
+			if (NotZero(tangentLength / std::fabs(signedAreaUV)) && NotZero(bitangentLength / std::fabs(signedAreaUV))) flags &= ~CORNER_GROUP_WITH_ANY;
+		}
+		return flags;
+	}
+
+	/**
+	 * Project the tangent of the triangle of the vertices v on the tangent plane of each corner, weighted by the corner angle.
+	 * The corner angle is the angle between the edges projected on the tangent plane, from the dot products of the triangle
+	 * edges: with e' = e - (n.e) n, e1'.e2' = e1.e2 - (n.e1)(n.e2) and |e'|^2 = e.e - (n.e)^2
+	 */
+#ifdef MESH_TANGENTS_SSE2
+	void GetCornerTangents(const VertexAttributes& attributes, const uint32_t v[3], const Float3 tangent, Float3 cornerTangents[3])
+	{
+		// One corner per lane, so that the square roots and divisions of the three corners run at once
+		Float3 p[3] = { Load3(attributes.positions + 3 * v[0]), Load3(attributes.positions + 3 * v[1]), Load3(attributes.positions + 3 * v[2]) };
+		Float3 n[3] = { Load3(attributes.normals + 3 * v[0]), Load3(attributes.normals + 3 * v[1]), Load3(attributes.normals + 3 * v[2]) };
+		Float3 edges[3] = { p[1] - p[0], p[2] - p[1], p[0] - p[2] };
+		__m128 nx = _mm_setr_ps(n[0].x, n[1].x, n[2].x, 0.0f), ny = _mm_setr_ps(n[0].y, n[1].y, n[2].y, 0.0f), nz = _mm_setr_ps(n[0].z, n[1].z, n[2].z, 0.0f);
+
+		// The edge from the corner to the next vertex, and the one from the previous vertex to the corner
+		__m128 nextX = _mm_setr_ps(edges[0].x, edges[1].x, edges[2].x, 0.0f);
+		__m128 nextY = _mm_setr_ps(edges[0].y, edges[1].y, edges[2].y, 0.0f);
+		__m128 nextZ = _mm_setr_ps(edges[0].z, edges[1].z, edges[2].z, 0.0f);
+		__m128 previousX = _mm_shuffle_ps(nextX, nextX, _MM_SHUFFLE(3, 1, 0, 2));
+		__m128 previousY = _mm_shuffle_ps(nextY, nextY, _MM_SHUFFLE(3, 1, 0, 2));
+		__m128 previousZ = _mm_shuffle_ps(nextZ, nextZ, _MM_SHUFFLE(3, 1, 0, 2));
+
+		auto dot = [](const __m128 ax, const __m128 ay, const __m128 az, const __m128 bx, const __m128 by, const __m128 bz)
+		{
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+		};
+		const __m128 signBit = _mm_set1_ps(-0.0f), one = _mm_set1_ps(1.0f);
+		auto notZero = [signBit](const __m128 x) { return _mm_cmpgt_ps(_mm_andnot_ps(signBit, x), _mm_set1_ps(FLT_MIN)); };
+		auto select = [](const __m128 mask, const __m128 a, const __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); };
+
+		__m128 nextDot = dot(nextX, nextY, nextZ, nextX, nextY, nextZ);
+		__m128 previousDot = _mm_shuffle_ps(nextDot, nextDot, _MM_SHUFFLE(3, 1, 0, 2));
+		__m128 nextNormal = dot(nx, ny, nz, nextX, nextY, nextZ);
+		__m128 previousNormal = _mm_xor_ps(dot(nx, ny, nz, previousX, previousY, previousZ), signBit);
+		__m128 nextLength = _mm_sub_ps(nextDot, _mm_mul_ps(nextNormal, nextNormal));
+		__m128 previousLength = _mm_sub_ps(previousDot, _mm_mul_ps(previousNormal, previousNormal));
+		__m128 cosine = _mm_sub_ps(_mm_xor_ps(dot(nextX, nextY, nextZ, previousX, previousY, previousZ), signBit), _mm_mul_ps(nextNormal, previousNormal));
+		cosine = _mm_div_ps(cosine, _mm_sqrt_ps(_mm_mul_ps(nextLength, previousLength)));
+		cosine = _mm_max_ps(_mm_min_ps(cosine, one), _mm_set1_ps(-1.0f));
+		cosine = _mm_and_ps(cosine, _mm_and_ps(notZero(nextLength), notZero(previousLength)));
+
+		__m128 absCosine = _mm_andnot_ps(signBit, cosine);
+		__m128 polynomial = _mm_set1_ps(ACOS_COEFFICIENTS[0]);
+		for (size_t i = 1; i < 8; i++) polynomial = _mm_add_ps(_mm_mul_ps(polynomial, absCosine), _mm_set1_ps(ACOS_COEFFICIENTS[i]));
+		__m128 angle = _mm_mul_ps(_mm_sqrt_ps(_mm_sub_ps(one, absCosine)), polynomial);
+		angle = select(_mm_cmplt_ps(cosine, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(PI), angle), angle);
+
+		__m128 tx = _mm_set1_ps(tangent.x), ty = _mm_set1_ps(tangent.y), tz = _mm_set1_ps(tangent.z);
+		__m128 tangentNormal = dot(nx, ny, nz, tx, ty, tz);
+		__m128 projectedX = _mm_sub_ps(tx, _mm_mul_ps(tangentNormal, nx));
+		__m128 projectedY = _mm_sub_ps(ty, _mm_mul_ps(tangentNormal, ny));
+		__m128 projectedZ = _mm_sub_ps(tz, _mm_mul_ps(tangentNormal, nz));
+		__m128 isProjectedNotZero = _mm_or_ps(_mm_or_ps(notZero(projectedX), notZero(projectedY)), notZero(projectedZ));
+		__m128 scale = _mm_div_ps(one, _mm_sqrt_ps(dot(projectedX, projectedY, projectedZ, projectedX, projectedY, projectedZ)));
+		scale = select(isProjectedNotZero, scale, one);
+
+		alignas(16) float x[4], y[4], z[4];
+		_mm_store_ps(x, _mm_mul_ps(angle, _mm_mul_ps(scale, projectedX)));
+		_mm_store_ps(y, _mm_mul_ps(angle, _mm_mul_ps(scale, projectedY)));
+		_mm_store_ps(z, _mm_mul_ps(angle, _mm_mul_ps(scale, projectedZ)));
+		for (size_t k = 0; k < 3; k++) cornerTangents[k] = { x[k], y[k], z[k] };
+	}
+#else
+	/** Project v on the plane orthogonal to the unit vector n, then normalize it */
+	Float3 ProjectOnPlane(const Float3 v, const Float3 n) { return NormalizeSafe(v - Dot(n, v) * n); }
+
+	/** acos of x in [-1, 1] with an absolute error below 2e-8, without the branches of the library function */
+	float Acos(const float x)
+	{
+		float a = std::fabs(x);
+		float polynomial = ACOS_COEFFICIENTS[0];
+		for (size_t i = 1; i < 8; i++) polynomial = polynomial * a + ACOS_COEFFICIENTS[i];
+		float angle = std::sqrt(1.0f - a) * polynomial;
+		return x < 0.0f ? PI - angle : angle;
+	}
+
+	void GetCornerTangents(const VertexAttributes& attributes, const uint32_t v[3], const Float3 tangent, Float3 cornerTangents[3])
+	{
+		Float3 p[3] = { Load3(attributes.positions + 3 * v[0]), Load3(attributes.positions + 3 * v[1]), Load3(attributes.positions + 3 * v[2]) };
+		Float3 edges[3] = { p[1] - p[0], p[2] - p[1], p[0] - p[2] };
+		float edgesDot[3] = { Dot(edges[0], edges[0]), Dot(edges[1], edges[1]), Dot(edges[2], edges[2]) };
+		for (size_t k = 0; k < 3; k++)
+		{
+			// The corner k edges, from the corner to the next and to the previous vertex
+			Float3 n = Load3(attributes.normals + 3 * v[k]);
+			size_t previous = (k + 2) % 3;
+			float nextNormal = Dot(n, edges[k]), previousNormal = -Dot(n, edges[previous]);
+			float nextLength = edgesDot[k] - nextNormal * nextNormal, previousLength = edgesDot[previous] - previousNormal * previousNormal;
+			float cosine = 0.0f;
+			if (NotZero(nextLength) && NotZero(previousLength)) cosine = (-Dot(edges[k], edges[previous]) - nextNormal * previousNormal) / std::sqrt(nextLength * previousLength);
+			float angle = Acos((std::max)(-1.0f, (std::min)(1.0f, cosine)));
+			cornerTangents[k] = angle * ProjectOnPlane(tangent, n);
+		}
+	}
+#endif
+
+	/** Return for each vertex the first vertex with the same attributes, as MikkTSpace identifies the vertices */
+	std::vector<uint32_t> WeldVertices(const VertexAttributes& attributes, const size_t verticesCount, ThreadPool& pool)
+	{
+		std::vector<uint32_t> hashes(verticesCount);
+		ParallelForChunks(pool, verticesCount, [&](size_t begin, size_t end)
+			{
+				for (size_t v = begin; v < end; v++) hashes[v] = attributes.Hash(static_cast<uint32_t>(v));
+			});
+
+		// Open addressing table of the first vertex of each distinct value, at most half full
+		size_t tableSize = 16;
+		while (tableSize < 2 * verticesCount) tableSize <<= 1;
+		std::vector<uint32_t> table(tableSize, UINT32_MAX);
+		std::vector<uint32_t> welded(verticesCount);
+		for (uint32_t v = 0; v < verticesCount; v++)
+		{
+			for (size_t slot = hashes[v] & (tableSize - 1);; slot = (slot + 1) & (tableSize - 1))
+			{
+				uint32_t first = table[slot];
+				if (first == UINT32_MAX) { table[slot] = welded[v] = v; break; }
+				if (hashes[first] == hashes[v] && attributes.IsSame(first, v)) { welded[v] = first; break; }
+			}
+		}
+		return welded;
+	}
+}
+
+VertexTangents GenerateTangents(const TriangleMesh& mesh, const float* normals, const float* texCoords, ThreadPool& pool)
+{
+	if (mesh.indices == nullptr && mesh.indicesCount > mesh.verticesCount) throw std::invalid_argument("Unindexed triangles out of the vertices range");
+	size_t verticesCount = mesh.verticesCount;
+	size_t cornersCount = mesh.indicesCount / 3 * 3;
+	auto vertexOf = [&mesh](const size_t corner) { return mesh.indices ? mesh.indices[corner] : static_cast<uint32_t>(corner); };
+
+	std::atomic<bool> isOutOfRange{ false };
+	if (mesh.indices != nullptr)
+	{
+		ParallelForChunks(pool, cornersCount, [&](size_t begin, size_t end)
+			{
+				for (size_t c = begin; c < end; c++) { if (mesh.indices[c] >= verticesCount) isOutOfRange = true; }
+			});
+	}
+	if (isOutOfRange) throw std::invalid_argument("Index out of the vertices range");
+
+	VertexAttributes attributes = { mesh.positions, normals, texCoords };
+	std::vector<uint32_t> welded = WeldVertices(attributes, verticesCount, pool);
+
+	// The corners of each vertex and orientation are summed in order in group 2 * vertex + orientation. The loop over the
+	// triangles reads no welded vertex, the groups of the vertices welded together are merged afterwards
+	std::vector<uint8_t> cornerFlags(cornersCount);
+	std::vector<GroupSum> groups(2 * verticesCount);
+	if (pool.GetThreadsCount() == 1)
+	{
+		// Without workers the corners are summed as they are computed, in the order of the partitions below, and never stored
+		for (size_t t = 0; t < cornersCount / 3; t++)
+		{
+			if (3 * (t + PREFETCH_DISTANCE) + 2 < cornersCount)
+			{
+				for (size_t k = 0; k < 3; k++)
+				{
+					uint32_t next = vertexOf(3 * (t + PREFETCH_DISTANCE) + k);
+					Prefetch(attributes.positions + 3 * next);
+					Prefetch(attributes.normals + 3 * next);
+					Prefetch(attributes.texCoords + 2 * next);
+					Prefetch(&groups[2 * size_t(next)]);
+				}
+			}
+			uint32_t v[3] = { vertexOf(3 * t), vertexOf(3 * t + 1), vertexOf(3 * t + 2) };
+			Float3 tangent;
+			uint8_t flags = GetTriangleTangent(attributes, v, tangent);
+			cornerFlags[3 * t] = cornerFlags[3 * t + 1] = cornerFlags[3 * t + 2] = flags;
+			if (flags & CORNER_GROUP_WITH_ANY) continue;
+
+			Float3 cornerTangents[3];
+			GetCornerTangents(attributes, v, tangent, cornerTangents);
+			uint8_t orientation = flags & CORNER_ORIENT_PRESERVING;
+			for (size_t k = 0; k < 3; k++) AddCorner(groups[2 * size_t(v[k]) + orientation], cornerTangents[k]);
+		}
+	}
+	else
+	{
+		// The triangle tangent, projected on the tangent plane of each corner and weighted by the corner angle
+		std::vector<Float3> cornerTangents(cornersCount);
+		ParallelForChunks(pool, cornersCount / 3, [&](size_t begin, size_t end)
+			{
+				for (size_t t = begin; t < end; t++)
+				{
+					uint32_t v[3] = { vertexOf(3 * t), vertexOf(3 * t + 1), vertexOf(3 * t + 2) };
+					Float3 tangent;
+					uint8_t flags = GetTriangleTangent(attributes, v, tangent);
+					cornerFlags[3 * t] = cornerFlags[3 * t + 1] = cornerFlags[3 * t + 2] = flags;
+					if (!(flags & CORNER_GROUP_WITH_ANY)) GetCornerTangents(attributes, v, tangent, &cornerTangents[3 * t]);
+				}
+			});
+
+		// As for the normals each partition owns a range of vertices and scans all the corners, so the corners are summed without atomics
+		size_t partitionsCount = (std::max)(size_t(1), (std::min)(pool.GetThreadsCount(), cornersCount / CHUNK_SIZE));
+		size_t partitionSize = (verticesCount + partitionsCount - 1) / partitionsCount;
+		pool.ParallelFor(partitionsCount, [&](size_t partition)
+			{
+				size_t begin = (std::min)(verticesCount, partition * partitionSize);
+				size_t end = (std::min)(verticesCount, (partition + 1) * partitionSize);
+				for (size_t c = 0; c < cornersCount; c++)
+				{
+					uint32_t v = vertexOf(c);
+					if (v < begin || v >= end || (cornerFlags[c] & CORNER_GROUP_WITH_ANY)) continue;
+					AddCorner(groups[2 * size_t(v) + (cornerFlags[c] & CORNER_ORIENT_PRESERVING)], cornerTangents[c]);
+				}
+			});
+	}
+
+	// Merge the groups of each vertex into the groups of its welded vertex, which comes first, in the vertices order
+	for (size_t v = 0; v < verticesCount; v++)
+	{
+		size_t w = welded[v];
+		if (w == v) continue;
+		for (size_t orientation = 0; orientation < 2; orientation++)
+		{
+			groups[2 * w + orientation].tangent = groups[2 * w + orientation].tangent + groups[2 * v + orientation].tangent;
+			groups[2 * w + orientation].cornersCount += groups[2 * v + orientation].cornersCount;
+		}
+	}
+	ParallelForChunks(pool, groups.size(), [&](size_t begin, size_t end)
+		{
+			for (size_t g = begin; g < end; g++) groups[g].tangent = NormalizeSafe(groups[g].tangent);
+		});
+
+	// Each vertex takes the group of its first corner, a corner of another group gets a copy of the vertex. The welded vertex
+	// is read with the group, in the same cache line
+	struct VertexGroup { uint32_t welded; uint32_t group; };
+	std::vector<VertexGroup> vertexGroups(verticesCount);
+	ParallelForChunks(pool, verticesCount, [&](size_t begin, size_t end)
+		{
+			for (size_t v = begin; v < end; v++) vertexGroups[v] = { welded[v], UNUSED_VERTEX };
+		});
+
+	VertexTangents result;
+	std::vector<uint32_t> splitGroups;
+	std::unordered_map<uint64_t, uint32_t> splitVertices;	// (vertex << 32 | group) -> output vertex
+	std::vector<uint32_t> indices(cornersCount);
+	for (size_t c = 0; c < cornersCount; c++)
+	{
+		uint32_t v = vertexOf(c);
+		VertexGroup& vertex = vertexGroups[v];
+		uint32_t w = vertex.welded;
+		uint32_t group = 2 * w + (cornerFlags[c] & CORNER_ORIENT_PRESERVING);
+		if (cornerFlags[c] & CORNER_GROUP_WITH_ANY)
+		{
+			// The corner joins the groups of the other triangles of the vertex, the orientation preserving one first
+			if (groups[2 * size_t(w) + 1].cornersCount > 0.0f) group = 2 * w + 1;
+			else if (groups[2 * size_t(w)].cornersCount > 0.0f) group = 2 * w;
+			else group = NO_GROUP;
+		}
+		if (vertex.group == UNUSED_VERTEX) vertex.group = group;
+		indices[c] = v;
+		if (vertex.group == group) continue;
+
+		auto split = splitVertices.emplace((uint64_t(v) << 32) | group, static_cast<uint32_t>(verticesCount + splitGroups.size()));
+		if (split.second)
+		{
+			result.sourceVertices.push_back(v);
+			splitGroups.push_back(group);
+		}
+		indices[c] = split.first->second;
+	}
+	if (!splitGroups.empty()) result.indices = std::move(indices);
+
+	result.tangents.resize(4 * (verticesCount + splitGroups.size()));
+	ParallelForChunks(pool, verticesCount + splitGroups.size(), [&](size_t begin, size_t end)
+		{
+			for (size_t v = begin; v < end; v++)
+			{
+				uint32_t group = (v < verticesCount) ? vertexGroups[v].group : splitGroups[v - verticesCount];
+				Float3 tangent = { 1.0f, 0.0f, 0.0f };
+				float sign = 1.0f;
+				if (group != NO_GROUP && group != UNUSED_VERTEX)
+				{
+					if (NotZero(groups[group].tangent)) tangent = groups[group].tangent;
+					sign = (group & CORNER_ORIENT_PRESERVING) ? 1.0f : -1.0f;
+				}
+				float* out = &result.tangents[4 * v];
+				out[0] = tangent.x; out[1] = tangent.y; out[2] = tangent.z; out[3] = sign;
+			}
+		});
+	return result;
+}
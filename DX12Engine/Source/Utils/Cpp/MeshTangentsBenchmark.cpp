@@ -0,0 +1,333 @@
+#include "Benchmark.h"
+#include "MeshTangents.h"
+#include "AccessorView.h"
+#include "GLTFJsonReader.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace
+{
+	const std::vector<std::string> DEFAULT_TANGENTS_MODELS = { "models/NormalTangentTest.glb", "models/NormalTangentMirrorTest.glb" };
+	const std::vector<size_t> DEFAULT_TANGENTS_TRIANGLES = { 1 << 20, 1 << 22 };
+	constexpr int TANGENTS_REPETITIONS = 5;
+	constexpr double MAX_GOLDEN_ERROR_DEGREES = 0.01;	// The golden tangents are MikkTSpace tangents too, they differ by the float rounding of the sums
+	constexpr double MAX_REFERENCE_MEAN_ERROR_DEGREES = 2.0;	// Without golden tangents, the mean difference with the reference loop
+	constexpr double MAX_FRAME_ERROR = 1e-3;			// Tolerance on the tangents length and orthogonality to the normals
+
+	/** The attributes of a triangle list primitive, as floats and 32 bit indices */
+	struct TangentPrimitive
+	{
+		std::vector<float> positions;
+		std::vector<float> normals;
+		std::vector<float> texCoords;
+		std::vector<float> goldenTangents;	// The TANGENT attribute of the file, empty if it has none
+		std::vector<uint32_t> indices;		// Empty for an unindexed primitive
+
+		TriangleMesh GetTriangleMesh() const
+		{
+			return { positions.data(), positions.size() / 3, indices.empty() ? nullptr : indices.data(), indices.empty() ? positions.size() / 3 : indices.size() };
+		}
+	};
+
+	double GetAngleDegrees(const float* a, const float* b)
+	{
+		// atan2 of the cross and dot products keeps its precision for small angles, unlike acos of the dot product
+		double cross[3] = { double(a[1]) * b[2] - double(a[2]) * b[1], double(a[2]) * b[0] - double(a[0]) * b[2], double(a[0]) * b[1] - double(a[1]) * b[0] };
+		double sine = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+		return std::atan2(sine, double(a[0]) * b[0] + double(a[1]) * b[1] + double(a[2]) * b[2]) * 180.0 / 3.14159265358979323846;
+	}
+
+	/** Read the triangle list primitives with positions, normals and texture coordinates of a .glb file */
+	std::vector<TangentPrimitive> ReadTangentPrimitives(const std::string& fileName)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		if (!file) throw std::runtime_error("Cannot open " + fileName);
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		GLBChunks chunks = GLTFJsonReader::ReadGLBChunks(data.data(), data.size());
+		if (chunks.bin == nullptr) throw std::runtime_error(fileName + " has no BIN chunk");
+
+		tinygltf::Model model;
+		GLTFJsonReader reader;
+		reader.Parse(chunks.json, chunks.jsonSize, model);
+
+		auto getAccessor = [&model, &chunks](const int accessorId, const int expectedElements)
+		{
+			const tinygltf::Accessor& accessor = model.accessors.at(accessorId);
+			const tinygltf::BufferView& bufferView = model.bufferViews.at(accessor.bufferView);
+			AccessorDesc desc;
+			desc.count = accessor.count;
+			desc.byteStride = bufferView.byteStride;
+			desc.componentType = accessor.componentType;
+			desc.elementsCount = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+			desc.normalized = accessor.normalized;
+			desc.data = chunks.bin + bufferView.byteOffset + accessor.byteOffset;
+			if (bufferView.buffer != 0 || expectedElements != desc.elementsCount || bufferView.byteOffset + accessor.byteOffset + desc.GetByteLength() > chunks.binSize)
+			{
+				throw std::runtime_error("Unsupported accessor " + std::to_string(accessorId));
+			}
+			return desc;
+		};
+		auto readFloats = [&getAccessor](const int accessorId, const int elements)
+		{
+			AccessorDesc accessor = getAccessor(accessorId, elements);
+			std::vector<float> values(accessor.count * elements);
+			ReadAccessorFloats(accessor, values.data());
+			return values;
+		};
+
+		std::vector<TangentPrimitive> primitives;
+		for (const tinygltf::Mesh& mesh : model.meshes)
+		{
+			for (const tinygltf::Primitive& primitive : mesh.primitives)
+			{
+				auto& attributes = primitive.attributes;
+				if (primitive.mode != TINYGLTF_MODE_TRIANGLES || !attributes.count("POSITION") || !attributes.count("NORMAL") || !attributes.count("TEXCOORD_0")) continue;
+
+				TangentPrimitive tangentPrimitive;
+				tangentPrimitive.positions = readFloats(attributes.at("POSITION"), 3);
+				tangentPrimitive.normals = readFloats(attributes.at("NORMAL"), 3);
+				tangentPrimitive.texCoords = readFloats(attributes.at("TEXCOORD_0"), 2);
+				if (attributes.count("TANGENT")) tangentPrimitive.goldenTangents = readFloats(attributes.at("TANGENT"), 4);
+				if (primitive.indices != -1)
+				{
+					AccessorDesc indices = getAccessor(primitive.indices, 1);
+					tangentPrimitive.indices.resize(indices.count);
+					ReadAccessorUInt32(indices, tangentPrimitive.indices.data());
+				}
+				primitives.push_back(std::move(tangentPrimitive));
+			}
+		}
+		return primitives;
+	}
+
+	/**
+	 * The single threaded Lengyel loop that GenerateTangents replaces, with its bitangent accumulation fixed and the
+	 * texture v axis pointing up as in MikkTSpace. It sums the unnormalized triangle tangents without welding or splitting vertices.
+	 */
+	std::vector<float> GenerateTangentsReference(const TriangleMesh& mesh, const float* normals, const float* texCoords)
+	{
+		std::vector<float> tan1(3 * mesh.verticesCount, 0.0f), tan2(3 * mesh.verticesCount, 0.0f);
+		for (size_t t = 0; t < mesh.indicesCount / 3; t++)
+		{
+			size_t v[3];
+			for (size_t k = 0; k < 3; k++) v[k] = mesh.indices ? mesh.indices[3 * t + k] : 3 * t + k;
+			const float* p1 = mesh.positions + 3 * v[0], * p2 = mesh.positions + 3 * v[1], * p3 = mesh.positions + 3 * v[2];
+			const float* w1 = texCoords + 2 * v[0], * w2 = texCoords + 2 * v[1], * w3 = texCoords + 2 * v[2];
+
+			float x1 = p2[0] - p1[0], x2 = p3[0] - p1[0];
+			float y1 = p2[1] - p1[1], y2 = p3[1] - p1[1];
+			float z1 = p2[2] - p1[2], z2 = p3[2] - p1[2];
+			float s1 = w2[0] - w1[0], s2 = w3[0] - w1[0];
+			float t1 = w1[1] - w2[1], t2 = w1[1] - w3[1];
+			float area = s1 * t2 - s2 * t1;
+			if (area == 0.0f) continue;
+			float r = 1.0f / area;
+			float sdir[3] = { (t2 * x1 - t1 * x2) * r, (t2 * y1 - t1 * y2) * r, (t2 * z1 - t1 * z2) * r };
+			float tdir[3] = { (s1 * x2 - s2 * x1) * r, (s1 * y2 - s2 * y1) * r, (s1 * z2 - s2 * z1) * r };
+			for (size_t k = 0; k < 3; k++)
+			{
+				for (size_t i = 0; i < 3; i++) { tan1[3 * v[k] + i] += sdir[i]; tan2[3 * v[k] + i] += tdir[i]; }
+			}
+		}
+
+		std::vector<float> tangents(4 * mesh.verticesCount);
+		for (size_t v = 0; v < mesh.verticesCount; v++)
+		{
+			const float* n = normals + 3 * v, * t = &tan1[3 * v], * b = &tan2[3 * v];
+			float nDotT = n[0] * t[0] + n[1] * t[1] + n[2] * t[2];
+			float tangent[3] = { t[0] - n[0] * nDotT, t[1] - n[1] * nDotT, t[2] - n[2] * nDotT };
+			float length = std::sqrt(tangent[0] * tangent[0] + tangent[1] * tangent[1] + tangent[2] * tangent[2]);
+			float cross[3] = { n[1] * t[2] - n[2] * t[1], n[2] * t[0] - n[0] * t[2], n[0] * t[1] - n[1] * t[0] };
+			for (size_t i = 0; i < 3; i++) tangents[4 * v + i] = (length == 0.0f) ? (i == 0 ? 1.0f : 0.0f) : tangent[i] / length;
+			tangents[4 * v + 3] = (cross[0] * b[0] + cross[1] * b[1] + cross[2] * b[2] < 0.0f) ? -1.0f : 1.0f;
+		}
+		return tangents;
+	}
+
+	/** A noisy height field of about trianglesCount triangles with planar texture coordinates, its triangles shuffled */
+	TangentPrimitive CreateTexturedHeightField(const size_t trianglesCount, std::mt19937& random)
+	{
+		size_t side = (std::max)(static_cast<size_t>(std::sqrt(trianglesCount / 2.0)) + 1, size_t(2));
+		TangentPrimitive primitive;
+		std::uniform_real_distribution<float> noise(-0.2f, 0.2f);
+		for (size_t y = 0; y < side; y++)
+		{
+			for (size_t x = 0; x < side; x++)
+			{
+				float height = std::sin(x * 0.1f) * std::cos(y * 0.1f) * 4.0f + noise(random);
+				primitive.positions.insert(primitive.positions.end(), { static_cast<float>(x), height, static_cast<float>(y) });
+				primitive.texCoords.insert(primitive.texCoords.end(), { x / static_cast<float>(side - 1), y / static_cast<float>(side - 1) });
+				float normal[3] = { -std::cos(x * 0.1f) * std::cos(y * 0.1f) * 0.4f, 1.0f, std::sin(x * 0.1f) * std::sin(y * 0.1f) * 0.4f };
+				float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				primitive.normals.insert(primitive.normals.end(), { normal[0] / length, normal[1] / length, normal[2] / length });
+			}
+		}
+
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (uint32_t y = 0; y + 1 < side; y++)
+		{
+			for (uint32_t x = 0; x + 1 < side; x++)
+			{
+				uint32_t v = y * static_cast<uint32_t>(side) + x, s = static_cast<uint32_t>(side);
+				triangles.push_back({ v, v + 1, v + s });
+				triangles.push_back({ v + 1, v + s + 1, v + s });
+			}
+		}
+		std::shuffle(triangles.begin(), triangles.end(), random);
+		for (const auto& triangle : triangles) primitive.indices.insert(primitive.indices.end(), triangle.begin(), triangle.end());
+		return primitive;
+	}
+
+	template <class F>
+	double MeasureMilliseconds(F&& f)
+	{
+		std::vector<double> milliseconds;
+		for (int r = 0; r < TANGENTS_REPETITIONS; r++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			f();
+			milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(milliseconds.begin(), milliseconds.end());
+		return milliseconds[milliseconds.size() / 2];
+	}
+
+	/**
+	 * A quad whose two triangles share an edge but mirror the texture, as on a symmetric model seam: the two shared
+	 * vertices must be split, each copy with the frame of its triangle.
+	 */
+	bool CheckMirroredSeam(ThreadPool& pool)
+	{
+		const std::vector<float> positions = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f };
+		const std::vector<float> normals = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f };
+		const std::vector<float> texCoords = { 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+		const std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3 };
+		TriangleMesh mesh = { positions.data(), 4, indices.data(), indices.size() };
+		VertexTangents result = GenerateTangents(mesh, normals.data(), texCoords.data(), pool);
+
+		// The corners of each triangle must have the sign of the triangle, the two triangles opposite signs
+		bool isMatch = result.sourceVertices.size() == 2 && result.indices.size() == indices.size();
+		auto sign = [&result](const size_t corner) { return result.tangents[4 * result.indices[corner] + 3]; };
+		for (size_t c = 0; isMatch && c < indices.size(); c++) isMatch = result.indices[c] < result.GetVerticesCount() && sign(c) == sign(c - c % 3);
+		isMatch = isMatch && sign(0) != sign(3);
+		std::cout << "  \"mirroredSeam\": { \"splitVertices\": " << result.sourceVertices.size() << ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+
+	/**
+	 * Generate the tangents of the models primitives. Those with a TANGENT attribute, exported with MikkTSpace, are the golden
+	 * output: the tangents must match it. The others are checked for a valid frame at each vertex, and compared with the reference.
+	 * Only the mean difference with the reference is bounded: the reference sums the unnormalized triangle tangents, weighted by
+	 * their area in texture space, where MikkTSpace sums the unit ones weighted by the corner angles. The two differ by up to
+	 * 10 degrees on the vertices of NormalTangentTest.glb whose triangles map the texture at scales 3.5 times apart.
+	 */
+	bool CheckModels(const std::vector<std::string>& fileNames, ThreadPool& pool)
+	{
+		bool isMatch = true;
+		std::cout << "  \"models\": [" << std::endl;
+		for (size_t f = 0; f < fileNames.size(); f++)
+		{
+			std::vector<TangentPrimitive> primitives = ReadTangentPrimitives(fileNames[f]);
+			for (size_t p = 0; p < primitives.size(); p++)
+			{
+				const TangentPrimitive& primitive = primitives[p];
+				TriangleMesh mesh = primitive.GetTriangleMesh();
+				VertexTangents result = GenerateTangents(mesh, primitive.normals.data(), primitive.texCoords.data(), pool);
+				std::vector<float> reference = GenerateTangentsReference(mesh, primitive.normals.data(), primitive.texCoords.data());
+				bool hasGolden = !primitive.goldenTangents.empty();
+				const std::vector<float>& expected = hasGolden ? primitive.goldenTangents : reference;
+
+				// A split vertex is compared through the vertex it copies
+				double maxError = 0.0, sumError = 0.0, maxFrameError = 0.0;
+				size_t signMismatches = 0;
+				for (size_t v = 0; v < result.GetVerticesCount(); v++)
+				{
+					size_t source = (v < mesh.verticesCount) ? v : result.sourceVertices[v - mesh.verticesCount];
+					const float* tangent = &result.tangents[4 * v];
+					const float* normal = &primitive.normals[3 * source];
+					double error = GetAngleDegrees(tangent, &expected[4 * source]);
+					maxError = (std::max)(maxError, error);
+					sumError += error;
+					if (tangent[3] != expected[4 * source + 3]) signMismatches++;
+
+					double length = std::sqrt(tangent[0] * tangent[0] + tangent[1] * tangent[1] + tangent[2] * tangent[2]);
+					double orthogonality = std::fabs(tangent[0] * normal[0] + tangent[1] * normal[1] + tangent[2] * normal[2]);
+					maxFrameError = (std::max)({ maxFrameError, std::fabs(length - 1.0), orthogonality });
+				}
+
+				double meanError = sumError / (std::max)(result.GetVerticesCount(), size_t(1));
+				bool isExpectedMatch = hasGolden ? (maxError <= MAX_GOLDEN_ERROR_DEGREES && signMismatches == 0) : meanError <= MAX_REFERENCE_MEAN_ERROR_DEGREES;
+				bool isPrimitiveMatch = maxFrameError <= MAX_FRAME_ERROR && isExpectedMatch;
+				isMatch &= isPrimitiveMatch;
+				bool isLast = (f == fileNames.size() - 1) && (p == primitives.size() - 1);
+				std::cout << std::fixed << std::setprecision(4)
+					<< "    { \"file\": \"" << std::filesystem::path(fileNames[f]).generic_string() << "\", \"primitive\": " << p
+					<< ", \"vertices\": " << mesh.verticesCount << ", \"splitVertices\": " << result.sourceVertices.size()
+					<< ", \"expected\": \"" << (hasGolden ? "golden" : "reference") << "\", \"maxErrorDegrees\": " << maxError
+					<< ", \"meanErrorDegrees\": " << meanError << ", \"signMismatches\": " << signMismatches
+					<< ", \"maxFrameError\": " << std::setprecision(6) << maxFrameError << ", \"match\": " << (isPrimitiveMatch ? "true" : "false") << " }"
+					<< (isLast ? "" : ",") << std::endl;
+			}
+		}
+		std::cout << "  ]," << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunTangents(const std::vector<std::string>& args)
+	{
+		std::vector<std::string> fileNames = args.empty() ? DEFAULT_TANGENTS_MODELS : args;
+		ThreadPool& pool = ThreadPool::GetDefault();
+
+		std::cout << "{" << std::endl;
+		bool isMatch = CheckMirroredSeam(pool);
+		isMatch &= CheckModels(fileNames, pool);
+
+		std::mt19937 random(7);
+		std::cout << "  \"meshes\": [" << std::endl;
+		for (size_t m = 0; m < DEFAULT_TANGENTS_TRIANGLES.size(); m++)
+		{
+			TangentPrimitive primitive = CreateTexturedHeightField(DEFAULT_TANGENTS_TRIANGLES[m], random);
+			TriangleMesh mesh = primitive.GetTriangleMesh();
+			double referenceMs = MeasureMilliseconds([&]() { GenerateTangentsReference(mesh, primitive.normals.data(), primitive.texCoords.data()); });
+			double parallelMs = MeasureMilliseconds([&]() { GenerateTangents(mesh, primitive.normals.data(), primitive.texCoords.data(), pool); });
+
+			size_t trianglesCount = mesh.indicesCount / 3;
+			std::cout << std::fixed << std::setprecision(3)
+				<< "    { \"triangles\": " << trianglesCount << ", \"vertices\": " << mesh.verticesCount << ", \"threads\": " << pool.GetThreadsCount()
+				<< ", \"referenceMs\": " << referenceMs << ", \"parallelMs\": " << parallelMs
+				<< ", \"referenceMTrianglesPerSecond\": " << trianglesCount / (referenceMs * 1000.0)
+				<< ", \"parallelMTrianglesPerSecond\": " << trianglesCount / (parallelMs * 1000.0) << " }"
+				<< (m == DEFAULT_TANGENTS_TRIANGLES.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]" << std::endl << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef MESH_TANGENTS_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunTangents({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
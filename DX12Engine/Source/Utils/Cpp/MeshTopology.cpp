@@ -0,0 +1,198 @@
+#include "MeshTopology.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace
+{
+	/** A triangle rotated to start at its smallest vertex: the rotations of a triangle have the same key, its mirror has another one */
+	struct TriangleKey
+	{
+		uint32_t a, b, c;
+		uint32_t triangle;
+
+		bool operator<(const TriangleKey& other) const { return std::tie(a, b, c, triangle) < std::tie(other.a, other.b, other.c, other.triangle); }
+		bool IsSame(const TriangleKey& other) const { return a == other.a && b == other.b && c == other.c; }
+	};
+
+	TriangleKey GetTriangleKey(const uint32_t a, const uint32_t b, const uint32_t c, const uint32_t triangle)
+	{
+		if (b < a && b < c) return { b, c, a, triangle };
+		if (c < a && c < b) return { c, a, b, triangle };
+		return { a, b, c, triangle };
+	}
+
+	/** Return true if the positions of the corners are aligned, the cross product of two edges is computed in double */
+	bool IsZeroArea(const float* positions, const uint32_t a, const uint32_t b, const uint32_t c)
+	{
+		const float* pa = positions + 3 * size_t(a);
+		const float* pb = positions + 3 * size_t(b);
+		const float* pc = positions + 3 * size_t(c);
+		double e1[3] = { double(pb[0]) - pa[0], double(pb[1]) - pa[1], double(pb[2]) - pa[2] };
+		double e2[3] = { double(pc[0]) - pa[0], double(pc[1]) - pa[1], double(pc[2]) - pa[2] };
+		return e1[1] * e2[2] - e1[2] * e2[1] == 0.0 && e1[2] * e2[0] - e1[0] * e2[2] == 0.0 && e1[0] * e2[1] - e1[1] * e2[0] == 0.0;
+	}
+
+	/** Remove the degenerate and the duplicate triangles of a triangle list, the triangles kept stay in order */
+	void RemoveTriangles(PrimitiveTopology& topology, const TopologyOptions& options, TopologyReport& report)
+	{
+		const bool isIndexed = !topology.indices.empty();
+		const size_t trianglesCount = (isIndexed ? topology.indices.size() : topology.verticesCount) / 3;
+		auto corner = [&](const size_t c) { return isIndexed ? topology.indices[c] : static_cast<uint32_t>(c); };
+
+		std::vector<uint8_t> isRemoved(trianglesCount, 0);
+		if (options.removeDegenerates)
+		{
+			const float* positions = topology.positions.empty() ? nullptr : topology.positions.data();
+			for (size_t t = 0; t < trianglesCount; t++)
+			{
+				uint32_t a = corner(3 * t), b = corner(3 * t + 1), c = corner(3 * t + 2);
+				if (a == b || b == c || c == a || (positions && IsZeroArea(positions, a, b, c)))
+				{
+					isRemoved[t] = 1;
+					report.degenerateTriangles++;
+				}
+			}
+		}
+		if (options.removeDuplicates)
+		{
+			// Sorted by key then by triangle, the first triangle of each key is kept
+			std::vector<TriangleKey> keys;
+			keys.reserve(trianglesCount);
+			for (size_t t = 0; t < trianglesCount; t++)
+			{
+				if (!isRemoved[t]) keys.push_back(GetTriangleKey(corner(3 * t), corner(3 * t + 1), corner(3 * t + 2), static_cast<uint32_t>(t)));
+			}
+			std::sort(keys.begin(), keys.end());
+			for (size_t k = 1; k < keys.size(); k++)
+			{
+				if (!keys[k].IsSame(keys[k - 1])) continue;
+				isRemoved[keys[k].triangle] = 1;
+				report.duplicateTriangles++;
+			}
+		}
+		if (std::find(isRemoved.begin(), isRemoved.end(), 1) == isRemoved.end()) return;
+
+		std::vector<uint32_t> indices;
+		indices.reserve(3 * trianglesCount);
+		for (size_t t = 0; t < trianglesCount; t++)
+		{
+			if (!isRemoved[t]) indices.insert(indices.end(), { corner(3 * t), corner(3 * t + 1), corner(3 * t + 2) });
+		}
+		topology.indices = std::move(indices);
+	}
+}
+
+void TopologyReport::Add(const TopologyReport& report)
+{
+	primitivesCount += report.primitivesCount;
+	fansCount += report.fansCount;
+	loopsCount += report.loopsCount;
+	stripsCount += report.stripsCount;
+	degenerateTriangles += report.degenerateTriangles;
+	duplicateTriangles += report.duplicateTriangles;
+	shortIndicesCount += report.shortIndicesCount;
+}
+
+PrimitiveMode GetNormalizedMode(const PrimitiveMode mode, const TopologyOptions& options)
+{
+	switch (mode)
+	{
+	case PrimitiveMode::TriangleFan: return PrimitiveMode::Triangles;
+	case PrimitiveMode::LineLoop: return PrimitiveMode::Lines;
+	case PrimitiveMode::TriangleStrip: return options.stripsToLists ? PrimitiveMode::Triangles : mode;
+	case PrimitiveMode::LineStrip: return options.stripsToLists ? PrimitiveMode::Lines : mode;
+	default: return mode;
+	}
+}
+
+TopologyReport NormalizeTopology(PrimitiveTopology& topology, const TopologyOptions& options)
+{
+	if (!topology.positions.empty() && topology.positions.size() != 3 * topology.verticesCount)
+	{
+		throw std::invalid_argument("The positions do not match the vertices count");
+	}
+	for (const uint32_t index : topology.indices)
+	{
+		if (index >= topology.verticesCount) throw std::invalid_argument("Index " + std::to_string(index) + " out of the vertices range");
+	}
+
+	TopologyReport report;
+	report.primitivesCount = 1;
+	const bool isIndexed = !topology.indices.empty();
+	const size_t count = isIndexed ? topology.indices.size() : topology.verticesCount;
+	auto vertex = [&](const size_t i) { return isIndexed ? topology.indices[i] : static_cast<uint32_t>(i); };
+
+	// The triangles and the segments of each mode, as the glTF specification numbers them
+	const PrimitiveMode mode = GetNormalizedMode(topology.mode, options);
+	std::vector<uint32_t> indices;
+	if (topology.mode == PrimitiveMode::TriangleFan)
+	{
+		for (size_t i = 0; i + 2 < count; i++) indices.insert(indices.end(), { vertex(i + 1), vertex(i + 2), vertex(0) });
+		report.fansCount = 1;
+	}
+	else if (topology.mode == PrimitiveMode::LineLoop)
+	{
+		for (size_t i = 0; i < count && count > 1; i++) indices.insert(indices.end(), { vertex(i), vertex((i + 1) % count) });
+		report.loopsCount = 1;
+	}
+	else if (topology.mode == PrimitiveMode::TriangleStrip && mode == PrimitiveMode::Triangles)
+	{
+		for (size_t i = 0; i + 2 < count; i++)
+		{
+			if (i % 2 == 0) indices.insert(indices.end(), { vertex(i), vertex(i + 1), vertex(i + 2) });
+			else indices.insert(indices.end(), { vertex(i), vertex(i + 2), vertex(i + 1) });
+		}
+		report.stripsCount = 1;
+	}
+	else if (topology.mode == PrimitiveMode::LineStrip && mode == PrimitiveMode::Lines)
+	{
+		for (size_t i = 0; i + 1 < count; i++) indices.insert(indices.end(), { vertex(i), vertex(i + 1) });
+		report.stripsCount = 1;
+	}
+	else if (mode == PrimitiveMode::TriangleStrip || mode == PrimitiveMode::LineStrip)
+	{
+		// The strips kept are indexed, their upload can then change their winding
+		indices.resize(count);
+		for (size_t i = 0; i < count; i++) indices[i] = vertex(i);
+	}
+	else indices = std::move(topology.indices);
+
+	topology.mode = mode;
+	topology.indices = std::move(indices);
+	if (mode == PrimitiveMode::Triangles && (options.removeDegenerates || options.removeDuplicates)) RemoveTriangles(topology, options, report);
+	return report;
+}
+
+TopologyReport NormalizeTopologies(std::vector<PrimitiveTopology>& topologies, const TopologyOptions& options, ThreadPool& pool)
+{
+	std::vector<TopologyReport> reports(topologies.size());
+	pool.ParallelFor(topologies.size(), [&](size_t p) { reports[p] = NormalizeTopology(topologies[p], options); });
+
+	TopologyReport report;
+	for (const TopologyReport& primitiveReport : reports) report.Add(primitiveReport);
+	return report;
+}
+
+std::vector<uint8_t> PackIndices(const std::vector<uint32_t>& indices, const bool shortIndices, bool& isShort)
+{
+	isShort = shortIndices && std::all_of(indices.begin(), indices.end(), [](const uint32_t index) { return index <= 0xFFFF; });
+	if (!isShort)
+	{
+		std::vector<uint8_t> data(indices.size() * sizeof(uint32_t));
+		if (!indices.empty()) std::memcpy(data.data(), indices.data(), data.size());
+		return data;
+	}
+
+	std::vector<uint8_t> data(indices.size() * sizeof(uint16_t));
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		uint16_t index = static_cast<uint16_t>(indices[i]);
+		std::memcpy(data.data() + i * sizeof(uint16_t), &index, sizeof(uint16_t));
+	}
+	return data;
+}
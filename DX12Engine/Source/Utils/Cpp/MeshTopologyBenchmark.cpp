@@ -0,0 +1,349 @@
+#include "Benchmark.h"
+#include "MeshTopology.h"
+#include "MeshStreams.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const std::vector<std::string> DEFAULT_TOPOLOGY_MODELS = { "models/TriangleWithoutIndices.gltf", "models/BoxTextured.glb", "models/2CylinderEngine.glb", "models/DamagedHelmet.glb", "models/scene.gltf" };
+	const std::vector<size_t> DEFAULT_TOPOLOGY_VERTICES = { 1 << 16, 1 << 20 };
+	constexpr size_t TOPOLOGY_PRIMITIVES = 64;		// The primitives of each mode normalized at once, to compare the pool with one thread
+	constexpr int TOPOLOGY_REPETITIONS = 3;
+
+	const char* GetModeName(const PrimitiveMode mode)
+	{
+		const char* names[] = { "points", "lines", "line_loop", "line_strip", "triangles", "triangle_strip", "triangle_fan" };
+		return names[static_cast<uint32_t>(mode)];
+	}
+
+	/** Normalize a copy of topology, return false if it throws */
+	bool TryNormalize(PrimitiveTopology topology, const TopologyOptions& options)
+	{
+		try { NormalizeTopology(topology, options); }
+		catch (const std::invalid_argument&) { return false; }
+		return true;
+	}
+
+	/** A hand checked case: the topology, the options, and the mode and the indices it must have once normalized */
+	struct TopologyCase
+	{
+		const char* name;
+		PrimitiveTopology topology;
+		TopologyOptions options;
+		PrimitiveMode expectedMode;
+		std::vector<uint32_t> expectedIndices;
+		size_t expectedDegenerates;
+		size_t expectedDuplicates;
+	};
+
+	PrimitiveTopology CreateTopology(const PrimitiveMode mode, const size_t verticesCount, const std::vector<uint32_t>& indices = {})
+	{
+		PrimitiveTopology topology;
+		topology.mode = mode;
+		topology.verticesCount = verticesCount;
+		topology.indices = indices;
+		return topology;
+	}
+
+	/** The cases of each mode, in the triangle order and the winding of the glTF specification */
+	std::vector<TopologyCase> CreateCases()
+	{
+		TopologyOptions keepStrips;
+		keepStrips.stripsToLists = false;
+		TopologyOptions keepAll = { false, false, false, false };
+
+		// Four corners of a unit square, the fifth vertex is on the segment between the first two
+		PrimitiveTopology triangles = CreateTopology(PrimitiveMode::Triangles, 5,
+			{ 0, 1, 2, 0, 0, 3, 2, 3, 0, 0, 2, 3, 3, 2, 0, 1, 2, 0, 0, 4, 1 });
+		triangles.positions = { 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 0.5f, 0, 0 };
+
+		return
+		{
+			{ "points", CreateTopology(PrimitiveMode::Points, 3), {}, PrimitiveMode::Points, {}, 0, 0 },
+			{ "indexed_points", CreateTopology(PrimitiveMode::Points, 3, { 2, 0 }), {}, PrimitiveMode::Points, { 2, 0 }, 0, 0 },
+			{ "lines", CreateTopology(PrimitiveMode::Lines, 4, { 0, 1, 1, 1 }), {}, PrimitiveMode::Lines, { 0, 1, 1, 1 }, 0, 0 },
+			{ "line_loop", CreateTopology(PrimitiveMode::LineLoop, 4), keepAll, PrimitiveMode::Lines, { 0, 1, 1, 2, 2, 3, 3, 0 }, 0, 0 },
+			{ "indexed_line_loop", CreateTopology(PrimitiveMode::LineLoop, 4, { 3, 1, 2 }), {}, PrimitiveMode::Lines, { 3, 1, 1, 2, 2, 3 }, 0, 0 },
+			{ "line_loop_of_one_vertex", CreateTopology(PrimitiveMode::LineLoop, 1), {}, PrimitiveMode::Lines, {}, 0, 0 },
+			{ "line_strip", CreateTopology(PrimitiveMode::LineStrip, 4), {}, PrimitiveMode::Lines, { 0, 1, 1, 2, 2, 3 }, 0, 0 },
+			{ "kept_line_strip", CreateTopology(PrimitiveMode::LineStrip, 3), keepStrips, PrimitiveMode::LineStrip, { 0, 1, 2 }, 0, 0 },
+			{ "triangles", triangles, {}, PrimitiveMode::Triangles, { 0, 1, 2, 2, 3, 0, 3, 2, 0 }, 2, 2 },
+			{ "triangles_degenerates_only", triangles, { true, true, false, true }, PrimitiveMode::Triangles, { 0, 1, 2, 2, 3, 0, 0, 2, 3, 3, 2, 0, 1, 2, 0 }, 2, 0 },
+			{ "triangles_kept", triangles, keepAll, PrimitiveMode::Triangles, triangles.indices, 0, 0 },
+			{ "unindexed_triangles", CreateTopology(PrimitiveMode::Triangles, 7), {}, PrimitiveMode::Triangles, {}, 0, 0 },
+			{ "unindexed_degenerate_triangles", [] { PrimitiveTopology t = CreateTopology(PrimitiveMode::Triangles, 6); t.positions = { 0, 0, 0, 1, 0, 0, 0, 1, 0, 2, 2, 2, 2, 2, 2, 0, 0, 1 }; return t; }(),
+				{}, PrimitiveMode::Triangles, { 0, 1, 2 }, 1, 0 },
+			{ "triangle_strip", CreateTopology(PrimitiveMode::TriangleStrip, 5), {}, PrimitiveMode::Triangles, { 0, 1, 2, 1, 3, 2, 2, 3, 4 }, 0, 0 },
+			{ "indexed_triangle_strip", CreateTopology(PrimitiveMode::TriangleStrip, 6, { 5, 4, 3, 3, 2 }), {}, PrimitiveMode::Triangles, { 5, 4, 3 }, 2, 0 },
+			{ "kept_triangle_strip", CreateTopology(PrimitiveMode::TriangleStrip, 4), keepStrips, PrimitiveMode::TriangleStrip, { 0, 1, 2, 3 }, 0, 0 },
+			{ "triangle_fan", CreateTopology(PrimitiveMode::TriangleFan, 5), keepAll, PrimitiveMode::Triangles, { 1, 2, 0, 2, 3, 0, 3, 4, 0 }, 0, 0 },
+			{ "indexed_triangle_fan", CreateTopology(PrimitiveMode::TriangleFan, 5, { 4, 3, 2, 1 }), {}, PrimitiveMode::Triangles, { 3, 2, 4, 2, 1, 4 }, 0, 0 },
+			{ "triangle_fan_of_two_vertices", CreateTopology(PrimitiveMode::TriangleFan, 2), {}, PrimitiveMode::Triangles, {}, 0, 0 }
+		};
+	}
+
+	/** Run the hand checked cases, the invalid inputs and the 16 bit packing */
+	bool CheckCases()
+	{
+		bool isMatch = true;
+		std::cout << "  \"cases\": [" << std::endl;
+		std::vector<TopologyCase> cases = CreateCases();
+		for (size_t c = 0; c < cases.size(); c++)
+		{
+			PrimitiveTopology topology = cases[c].topology;
+			TopologyReport report = NormalizeTopology(topology, cases[c].options);
+			bool isCaseMatch = topology.mode == cases[c].expectedMode && topology.indices == cases[c].expectedIndices
+				&& report.degenerateTriangles == cases[c].expectedDegenerates && report.duplicateTriangles == cases[c].expectedDuplicates;
+			isMatch &= isCaseMatch;
+			std::cout << "    { \"case\": \"" << cases[c].name << "\", \"mode\": \"" << GetModeName(topology.mode) << "\", \"indices\": " << topology.indices.size()
+				<< ", \"match\": " << (isCaseMatch ? "true" : "false") << " }," << std::endl;
+		}
+
+		PrimitiveTopology outOfRange = CreateTopology(PrimitiveMode::TriangleFan, 3, { 0, 1, 3 });
+		PrimitiveTopology badPositions = CreateTopology(PrimitiveMode::Triangles, 3);
+		badPositions.positions = { 0.0f, 0.0f, 0.0f };
+		bool isInvalidMatch = !TryNormalize(outOfRange, {}) && !TryNormalize(badPositions, {});
+
+		// 0xFFFF is the largest 16 bit index, the packed bytes must read back as the indices
+		bool isShort = false, isLongShort = true, isDisabledShort = true;
+		std::vector<uint32_t> shortIndices = { 0, 1, 0xFFFE, 0xFFFF, 7 };
+		std::vector<uint8_t> packed = PackIndices(shortIndices, true, isShort);
+		std::vector<uint8_t> longPacked = PackIndices({ 0, 0x10000 }, true, isLongShort);
+		std::vector<uint8_t> disabledPacked = PackIndices(shortIndices, false, isDisabledShort);
+		bool isPackMatch = isShort && !isLongShort && !isDisabledShort && packed.size() == 2 * shortIndices.size() && longPacked.size() == 8
+			&& disabledPacked.size() == 4 * shortIndices.size() && std::memcmp(disabledPacked.data(), shortIndices.data(), disabledPacked.size()) == 0;
+		for (size_t i = 0; i < shortIndices.size() && isPackMatch; i++)
+		{
+			uint16_t index;
+			std::memcpy(&index, packed.data() + 2 * i, sizeof(index));
+			isPackMatch = index == shortIndices[i];
+		}
+
+		isMatch &= isInvalidMatch && isPackMatch;
+		std::cout << "    { \"case\": \"invalid_inputs\", \"match\": " << (isInvalidMatch ? "true" : "false") << " }," << std::endl;
+		std::cout << "    { \"case\": \"short_indices\", \"match\": " << (isPackMatch ? "true" : "false") << " }" << std::endl;
+		std::cout << "  ]," << std::endl;
+		return isMatch;
+	}
+
+	/**
+	 * The reference normalization: the triangles and segments as the glTF specification lists them, then the triangles with a repeated
+	 * or aligned corner and the rotations of a triangle already seen skipped one by one, with a std::set
+	 */
+	std::vector<uint32_t> NormalizeReference(const PrimitiveTopology& topology, const TopologyOptions& options)
+	{
+		const size_t count = topology.indices.empty() ? topology.verticesCount : topology.indices.size();
+		auto v = [&](const size_t i) { return topology.indices.empty() ? static_cast<uint32_t>(i) : topology.indices[i]; };
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t i = 0; i + 2 < count; i++)
+		{
+			if (topology.mode == PrimitiveMode::TriangleFan) triangles.push_back({ v(i + 1), v(i + 2), v(0) });
+			if (topology.mode == PrimitiveMode::TriangleStrip) triangles.push_back({ v(i), v(i + 1 + i % 2), v(i + 2 - i % 2) });
+		}
+		for (size_t i = 0; i + 2 < count && topology.mode == PrimitiveMode::Triangles; i += 3) triangles.push_back({ v(i), v(i + 1), v(i + 2) });
+
+		std::vector<uint32_t> indices;
+		std::set<std::array<uint32_t, 3>> seen;
+		for (const std::array<uint32_t, 3>& t : triangles)
+		{
+			bool isDegenerate = t[0] == t[1] || t[1] == t[2] || t[2] == t[0];
+			if (!topology.positions.empty())
+			{
+				const float* p = topology.positions.data();
+				auto edge = [&](const uint32_t a, const uint32_t b, const int k) { return double(p[3 * b + k]) - double(p[3 * a + k]); };
+				double cross[3] = { edge(t[0], t[1], 1) * edge(t[0], t[2], 2) - edge(t[0], t[1], 2) * edge(t[0], t[2], 1),
+					edge(t[0], t[1], 2) * edge(t[0], t[2], 0) - edge(t[0], t[1], 0) * edge(t[0], t[2], 2),
+					edge(t[0], t[1], 0) * edge(t[0], t[2], 1) - edge(t[0], t[1], 1) * edge(t[0], t[2], 0) };
+				isDegenerate |= cross[0] == 0.0 && cross[1] == 0.0 && cross[2] == 0.0;
+			}
+			if (options.removeDegenerates && isDegenerate) continue;
+
+			size_t first = std::min_element(t.begin(), t.end()) - t.begin();
+			if (options.removeDuplicates && !seen.insert({ t[first], t[(first + 1) % 3], t[(first + 2) % 3] }).second) continue;
+			indices.insert(indices.end(), t.begin(), t.end());
+		}
+		return indices;
+	}
+
+	/**
+	 * A strip and a fan over a grid of positions, and a triangle list of random triangles with copies, rotated copies and
+	 * degenerate triangles. Some indices repeat so that the strips have degenerate triangles
+	 */
+	PrimitiveTopology CreateRandomTopology(const PrimitiveMode mode, const size_t verticesCount, std::mt19937& random)
+	{
+		PrimitiveTopology topology;
+		topology.mode = mode;
+		topology.verticesCount = verticesCount;
+		std::uniform_int_distribution<uint32_t> vertex(0, static_cast<uint32_t>(verticesCount - 1));
+		std::uniform_int_distribution<int> kind(0, 15);
+		for (size_t i = 0; i < verticesCount; i++)
+		{
+			float x = float(i % 1024), y = float(i / 1024);
+			topology.positions.insert(topology.positions.end(), { x, y, float(kind(random) == 0) });
+		}
+		if (mode == PrimitiveMode::Triangles)
+		{
+			while (topology.indices.size() < verticesCount)
+			{
+				uint32_t a = vertex(random), b = vertex(random), c = vertex(random);
+				int k = kind(random);
+				if (k == 0 && topology.indices.size() >= 3) { size_t t = vertex(random) % (topology.indices.size() / 3); a = topology.indices[3 * t + 1]; b = topology.indices[3 * t + 2]; c = topology.indices[3 * t]; }
+				else if (k == 1) b = a;
+				topology.indices.insert(topology.indices.end(), { a, b, c });
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < verticesCount; i++) topology.indices.push_back((kind(random) == 0 && i > 0) ? topology.indices.back() : static_cast<uint32_t>(i));
+		}
+		return topology;
+	}
+
+	/** Normalize the random primitives of each mode with the pool and with one thread, both checked against the reference */
+	bool CheckSyntheticPrimitives(const std::vector<size_t>& verticesCounts, ThreadPool& pool)
+	{
+		bool isMatch = true;
+		ThreadPool singleThread(0);
+		std::mt19937 random(11);
+		std::cout << "  \"primitives\": [" << std::endl;
+		const PrimitiveMode modes[] = { PrimitiveMode::Triangles, PrimitiveMode::TriangleStrip, PrimitiveMode::TriangleFan };
+		for (size_t v = 0; v < verticesCounts.size(); v++)
+		{
+			for (size_t m = 0; m < 3; m++)
+			{
+				// The largest counts are normalized as a few primitives only, to bound the memory
+				size_t primitivesCount = (std::max)(size_t(1), (std::min)(TOPOLOGY_PRIMITIVES, (size_t(1) << 22) / verticesCounts[v]));
+				std::vector<PrimitiveTopology> topologies;
+				for (size_t p = 0; p < primitivesCount; p++) topologies.push_back(CreateRandomTopology(modes[m], (std::max)(verticesCounts[v], size_t(3)), random));
+
+				bool isReferenceMatch = true;
+				TopologyReport report;
+				std::vector<double> parallelMs, singleMs;
+				for (int r = 0; r < TOPOLOGY_REPETITIONS; r++)
+				{
+					for (ThreadPool* runPool : { &pool, &singleThread })
+					{
+						std::vector<PrimitiveTopology> normalized = topologies;
+						auto start = std::chrono::steady_clock::now();
+						report = NormalizeTopologies(normalized, {}, *runPool);
+						(runPool == &pool ? parallelMs : singleMs).push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+						for (size_t p = 0; p < topologies.size() && r == 0; p++)
+						{
+							isReferenceMatch &= normalized[p].mode == PrimitiveMode::Triangles && normalized[p].indices == NormalizeReference(topologies[p], {});
+						}
+					}
+				}
+				std::sort(parallelMs.begin(), parallelMs.end());
+				std::sort(singleMs.begin(), singleMs.end());
+				size_t inputTriangles = 0;
+				for (const PrimitiveTopology& topology : topologies) inputTriangles += (modes[m] == PrimitiveMode::Triangles) ? topology.indices.size() / 3 : topology.indices.size() - 2;
+
+				isMatch &= isReferenceMatch;
+				std::cout << std::fixed << std::setprecision(3)
+					<< "    { \"mode\": \"" << GetModeName(modes[m]) << "\", \"vertices\": " << verticesCounts[v] << ", \"primitives\": " << primitivesCount
+					<< ", \"triangles\": " << inputTriangles << ", \"degenerateTriangles\": " << report.degenerateTriangles << ", \"duplicateTriangles\": " << report.duplicateTriangles
+					<< ", \"threads\": " << pool.GetThreadsCount() << ", \"singleThreadMs\": " << singleMs[singleMs.size() / 2] << ", \"parallelMs\": " << parallelMs[parallelMs.size() / 2]
+					<< ", \"parallelMTrianglesPerSecond\": " << inputTriangles / (parallelMs[parallelMs.size() / 2] * 1000.0)
+					<< ", \"match\": " << (isReferenceMatch ? "true" : "false") << " }" << ((v == verticesCounts.size() - 1 && m == 2) ? "" : ",") << std::endl;
+			}
+		}
+		std::cout << "  ]," << std::endl;
+		return isMatch;
+	}
+
+	/** Normalize the triangle lists of the models, report the triangles removed and the indices that fit in 16 bit */
+	bool CheckModels(const std::vector<std::string>& fileNames, ThreadPool& pool)
+	{
+		bool isMatch = true;
+		std::cout << "  \"models\": [" << std::endl;
+		for (size_t f = 0; f < fileNames.size(); f++)
+		{
+			std::vector<PrimitiveTopology> topologies;
+			for (MeshStreams& mesh : LoadMeshStreams(fileNames[f]))
+			{
+				PrimitiveTopology topology;
+				topology.verticesCount = mesh.verticesCount;
+				topology.indices = std::move(mesh.indices);
+				topology.positions = std::move(mesh.Find("POSITION")->values);
+				topologies.push_back(std::move(topology));
+			}
+			std::vector<PrimitiveTopology> normalized = topologies;
+			TopologyReport report = NormalizeTopologies(normalized, {}, pool);
+
+			bool isFileMatch = true;
+			size_t indicesCount = 0;
+			for (size_t p = 0; p < topologies.size(); p++)
+			{
+				std::vector<uint32_t> reference = NormalizeReference(topologies[p], {});
+				bool isUnchanged = reference.size() == (topologies[p].indices.empty() ? topologies[p].verticesCount / 3 * 3 : topologies[p].indices.size());
+				isFileMatch &= normalized[p].indices == reference || (isUnchanged && normalized[p].indices == topologies[p].indices);
+
+				bool isShort;
+				PackIndices(normalized[p].indices, true, isShort);
+				if (isShort) report.shortIndicesCount += normalized[p].indices.size();
+				indicesCount += normalized[p].indices.size();
+			}
+
+			isMatch &= isFileMatch;
+			std::cout << "    { \"file\": \"" << std::filesystem::path(fileNames[f]).generic_string() << "\", \"primitives\": " << report.primitivesCount
+				<< ", \"degenerateTriangles\": " << report.degenerateTriangles << ", \"duplicateTriangles\": " << report.duplicateTriangles
+				<< ", \"indices\": " << indicesCount << ", \"shortIndices\": " << report.shortIndicesCount << ", \"match\": " << (isFileMatch ? "true" : "false") << " }"
+				<< (f == fileNames.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]" << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunTopology(const std::vector<std::string>& args)
+	{
+		std::vector<size_t> verticesCounts;
+		std::vector<std::string> fileNames;
+		for (const std::string& arg : args)
+		{
+			if (!arg.empty() && std::all_of(arg.begin(), arg.end(), ::isdigit)) verticesCounts.push_back(std::stoul(arg));
+			else fileNames.push_back(arg);
+		}
+		if (verticesCounts.empty()) verticesCounts = DEFAULT_TOPOLOGY_VERTICES;
+		if (fileNames.empty()) fileNames = DEFAULT_TOPOLOGY_MODELS;
+		ThreadPool& pool = ThreadPool::GetDefault();
+
+		std::cout << "{" << std::endl;
+		bool isMatch = CheckCases();
+		isMatch &= CheckSyntheticPrimitives(verticesCounts, pool);
+		isMatch &= CheckModels(fileNames, pool);
+		std::cout << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef MESH_TOPOLOGY_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunTopology({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
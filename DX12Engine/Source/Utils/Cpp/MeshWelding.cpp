@@ -0,0 +1,208 @@
+#include "MeshWelding.h"
+#include "MeshStreams.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	constexpr size_t CHUNK_SIZE = 16384;	// Vertices or corners processed by a parallel loop iteration
+	constexpr uint32_t SHARD_BITS = 6;		// The top hash bits select one of the 64 shards, welded independently
+	constexpr size_t SHARDS_COUNT = size_t(1) << SHARD_BITS;
+
+	/** Call fn(begin, end) on consecutive ranges of [0, count) on the pool threads */
+	template <class F>
+	void ParallelForChunks(ThreadPool& pool, const size_t count, F&& fn)
+	{
+		pool.ParallelFor((count + CHUNK_SIZE - 1) / CHUNK_SIZE, [&](size_t chunk)
+			{
+				fn(chunk * CHUNK_SIZE, (std::min)(count, (chunk + 1) * CHUNK_SIZE));
+			});
+	}
+
+	/** The values compared by the welding: the attributes as they are, or their index on the epsilon grid */
+	class VertexKeys
+	{
+	public:
+		VertexKeys(const MeshStreams& mesh, const VertexWeldOptions& options)
+		{
+			for (const VertexStream& stream : mesh.streams)
+			{
+				float epsilon = (stream.semantic == "POSITION") ? options.positionEpsilon : options.attributeEpsilon;
+				m_streams.push_back({ stream.values.data(), stream.elementsCount, epsilon > 0.0f ? 1.0 / epsilon : 0.0 });
+			}
+		}
+
+		uint32_t Hash(const uint32_t v) const
+		{
+			uint32_t hash = 2166136261u;
+			ForEachKey(v, [&hash](const double key)
+				{
+					// Equal keys must hash equal: adding 0 turns -0 into +0
+					double k = key + 0.0;
+					uint64_t bits;
+					std::memcpy(&bits, &k, sizeof(bits));
+					hash = (hash ^ static_cast<uint32_t>(bits ^ (bits >> 32))) * 16777619u;
+				});
+			return hash ^ (hash >> 15);
+		}
+
+		bool IsSame(const uint32_t a, const uint32_t b) const
+		{
+			for (const Stream& stream : m_streams)
+			{
+				for (size_t k = 0; k < stream.elementsCount; k++)
+				{
+					if (stream.GetKey(a * stream.elementsCount + k) != stream.GetKey(b * stream.elementsCount + k)) return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		struct Stream
+		{
+			const float* values;
+			size_t elementsCount;
+			double inverseEpsilon;	// 0 compares the values as they are
+
+			double GetKey(const size_t i) const { return inverseEpsilon == 0.0 ? values[i] : std::floor(values[i] * inverseEpsilon + 0.5); }
+		};
+
+		template <class F>
+		void ForEachKey(const uint32_t v, F&& f) const
+		{
+			for (const Stream& stream : m_streams) for (size_t k = 0; k < stream.elementsCount; k++) f(stream.GetKey(v * stream.elementsCount + k));
+		}
+
+		std::vector<Stream> m_streams;
+	};
+}
+
+void VertexWeldReport::Add(const VertexWeldReport& report)
+{
+	verticesCountBefore += report.verticesCountBefore;
+	verticesCountAfter += report.verticesCountAfter;
+	degenerateTriangles += report.degenerateTriangles;
+}
+
+std::vector<uint32_t> GenerateVertexRemap(const MeshStreams& mesh, const VertexWeldOptions& options, ThreadPool& pool, size_t& uniqueCount)
+{
+	const size_t verticesCount = mesh.verticesCount;
+	VertexKeys keys(mesh, options);
+	std::vector<uint32_t> hashes(verticesCount);
+	ParallelForChunks(pool, verticesCount, [&](size_t begin, size_t end)
+		{
+			for (size_t v = begin; v < end; v++) hashes[v] = keys.Hash(static_cast<uint32_t>(v));
+		});
+
+	// Sort the vertices by shard, in increasing order within each shard
+	std::vector<size_t> shardOffsets(SHARDS_COUNT + 1, 0);
+	for (const uint32_t hash : hashes) shardOffsets[(hash >> (32 - SHARD_BITS)) + 1]++;
+	for (size_t s = 0; s < SHARDS_COUNT; s++) shardOffsets[s + 1] += shardOffsets[s];
+	std::vector<uint32_t> shardVertices(verticesCount);
+	{
+		std::vector<size_t> cursor(shardOffsets.begin(), shardOffsets.end() - 1);
+		for (uint32_t v = 0; v < verticesCount; v++) shardVertices[cursor[hashes[v] >> (32 - SHARD_BITS)]++] = v;
+	}
+
+	// Each shard finds the first vertex of each distinct value in its own open addressing table, at most half full
+	std::vector<uint32_t> firstVertices(verticesCount);
+	pool.ParallelFor(SHARDS_COUNT, [&](size_t shard)
+		{
+			size_t count = shardOffsets[shard + 1] - shardOffsets[shard];
+			size_t tableSize = 16;
+			while (tableSize < 2 * count) tableSize <<= 1;
+			std::vector<uint32_t> table(tableSize, UINT32_MAX);
+			for (size_t i = shardOffsets[shard]; i < shardOffsets[shard + 1]; i++)
+			{
+				uint32_t v = shardVertices[i];
+				for (size_t slot = hashes[v] & (tableSize - 1);; slot = (slot + 1) & (tableSize - 1))
+				{
+					uint32_t first = table[slot];
+					if (first == UINT32_MAX) { table[slot] = firstVertices[v] = v; break; }
+					if (hashes[first] == hashes[v] && keys.IsSame(first, v)) { firstVertices[v] = first; break; }
+				}
+			}
+		});
+
+	// Number the first vertices in order: each chunk counts its own, then numbers them from the sum of the previous chunks
+	const size_t chunksCount = (verticesCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	std::vector<size_t> chunkOffsets(chunksCount + 1, 0);
+	ParallelForChunks(pool, verticesCount, [&](size_t begin, size_t end)
+		{
+			size_t count = 0;
+			for (size_t v = begin; v < end; v++) count += (firstVertices[v] == v);
+			chunkOffsets[begin / CHUNK_SIZE + 1] = count;
+		});
+	for (size_t c = 0; c < chunksCount; c++) chunkOffsets[c + 1] += chunkOffsets[c];
+	uniqueCount = chunkOffsets[chunksCount];
+
+	std::vector<uint32_t> remap(verticesCount);
+	ParallelForChunks(pool, verticesCount, [&](size_t begin, size_t end)
+		{
+			uint32_t next = static_cast<uint32_t>(chunkOffsets[begin / CHUNK_SIZE]);
+			for (size_t v = begin; v < end; v++) if (firstVertices[v] == v) remap[v] = next++;
+		});
+	ParallelForChunks(pool, verticesCount, [&](size_t begin, size_t end)
+		{
+			for (size_t v = begin; v < end; v++) if (firstVertices[v] != v) remap[v] = remap[firstVertices[v]];
+		});
+	return remap;
+}
+
+VertexWeldReport WeldVertices(MeshStreams& mesh, const VertexWeldOptions& options, ThreadPool& pool)
+{
+	if (mesh.indices.size() % 3 != 0) throw std::invalid_argument("The indices are not a triangle list");
+	std::atomic<bool> isOutOfRange{ false };
+	ParallelForChunks(pool, mesh.indices.size(), [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++) { if (mesh.indices[i] >= mesh.verticesCount) isOutOfRange = true; }
+		});
+	if (isOutOfRange) throw std::invalid_argument("Index out of the vertices range");
+
+	VertexWeldReport report;
+	report.verticesCountBefore = mesh.verticesCount;
+	size_t uniqueCount = 0;
+	std::vector<uint32_t> remap = GenerateVertexRemap(mesh, options, pool, uniqueCount);
+
+	// An unindexed list becomes indexed, its triangle t was the vertices 3t, 3t + 1, 3t + 2
+	if (mesh.indices.empty())
+	{
+		mesh.indices.assign(remap.begin(), remap.begin() + mesh.verticesCount / 3 * 3);
+	}
+	else
+	{
+		ParallelForChunks(pool, mesh.indices.size(), [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++) mesh.indices[i] = remap[mesh.indices[i]];
+			});
+	}
+
+	// Exact welding only joins equal vertices, it cannot collapse a triangle that was not already degenerate: those are kept as in the file
+	if (options.positionEpsilon > 0.0f || options.attributeEpsilon > 0.0f)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			uint32_t a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+			if (a == b || b == c || a == c) continue;
+			mesh.indices[kept++] = a;
+			mesh.indices[kept++] = b;
+			mesh.indices[kept++] = c;
+		}
+		report.degenerateTriangles = (mesh.indices.size() - kept) / 3;
+		mesh.indices.resize(kept);
+	}
+
+	// Each welded vertex takes the attributes of its first vertex: going backwards, the first one is written last
+	std::vector<uint32_t> sourceVertices(uniqueCount);
+	for (size_t v = mesh.verticesCount; v-- > 0;) sourceVertices[remap[v]] = static_cast<uint32_t>(v);
+	mesh.GatherVertices(sourceVertices);
+	report.verticesCountAfter = mesh.verticesCount;
+	return report;
+}
@@ -0,0 +1,222 @@
+#include "Benchmark.h"
+#include "MeshWelding.h"
+#include "MeshStreams.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+	const std::vector<std::string> DEFAULT_WELDING_MODELS = { "models/TriangleWithoutIndices.gltf", "models/BoxTextured.glb", "models/2CylinderEngine.glb", "models/DamagedHelmet.glb", "models/scene.gltf" };
+	const std::vector<size_t> DEFAULT_WELDING_VERTICES = { 1 << 20, 1 << 22 };
+	constexpr int WELDING_REPETITIONS = 3;
+	constexpr float WELDING_EPSILON = 1e-3f;
+
+	/**
+	 * The unindexed triangles of a grid of quads, with the streams of a textured and colored mesh: each grid point is
+	 * stored six times. positionJitter moves every copy by a random amount, to weld with an epsilon.
+	 */
+	MeshStreams CreateUnindexedGrid(const size_t verticesCount, const float positionJitter, std::mt19937& random)
+	{
+		size_t side = (std::max)(size_t(1), static_cast<size_t>(std::sqrt(verticesCount / 6.0)));
+		std::uniform_real_distribution<float> jitter(-positionJitter, positionJitter);
+		std::vector<float> positions, normals, texCoords, colors;
+		auto addVertex = [&](const size_t x, const size_t y)
+		{
+			positions.insert(positions.end(), { float(x) + jitter(random), 0.0f, float(y) + jitter(random) });
+			normals.insert(normals.end(), { 0.0f, 1.0f, 0.0f });
+			texCoords.insert(texCoords.end(), { float(x) / side, float(y) / side });
+			colors.insert(colors.end(), { 1.0f, float(x % 2), float(y % 2), 1.0f });
+		};
+		for (size_t y = 0; y < side; y++)
+		{
+			for (size_t x = 0; x < side; x++)
+			{
+				addVertex(x, y); addVertex(x, y + 1); addVertex(x + 1, y);
+				addVertex(x + 1, y); addVertex(x, y + 1); addVertex(x + 1, y + 1);
+			}
+		}
+
+		MeshStreams mesh;
+		mesh.verticesCount = positions.size() / 3;
+		mesh.SetStream("POSITION", 3, std::move(positions));
+		mesh.SetStream("NORMAL", 3, std::move(normals));
+		mesh.SetStream("TEXCOORD_0", 2, std::move(texCoords));
+		mesh.SetStream("COLOR_0", 4, std::move(colors));
+		return mesh;
+	}
+
+	/** The single threaded welding that WeldVertices replaces: an unordered_map keyed on the bytes of every attribute */
+	size_t WeldVerticesReference(const MeshStreams& mesh, std::vector<uint32_t>& remap)
+	{
+		std::unordered_map<std::string, uint32_t> vertices;
+		remap.resize(mesh.verticesCount);
+		std::string key;
+		for (size_t v = 0; v < mesh.verticesCount; v++)
+		{
+			key.clear();
+			for (const VertexStream& stream : mesh.streams)
+			{
+				for (size_t k = 0; k < stream.elementsCount; k++)
+				{
+					float value = stream.values[v * stream.elementsCount + k] + 0.0f;
+					key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+				}
+			}
+			remap[v] = vertices.emplace(key, static_cast<uint32_t>(vertices.size())).first->second;
+		}
+		return vertices.size();
+	}
+
+	/** Return true if every corner of welded has the attributes of the same corner of mesh, which must be unindexed or indexed */
+	bool IsSameCorners(const MeshStreams& mesh, const MeshStreams& welded)
+	{
+		size_t cornersCount = mesh.indices.empty() ? mesh.verticesCount / 3 * 3 : mesh.indices.size();
+		if (welded.indices.size() != cornersCount || welded.streams.size() != mesh.streams.size()) return false;
+		for (size_t c = 0; c < cornersCount; c++)
+		{
+			size_t v = mesh.indices.empty() ? c : mesh.indices[c];
+			for (size_t s = 0; s < mesh.streams.size(); s++)
+			{
+				const VertexStream& before = mesh.streams[s];
+				const VertexStream& after = welded.streams[s];
+				for (size_t k = 0; k < before.elementsCount; k++)
+				{
+					if (before.values[v * before.elementsCount + k] != after.values[welded.indices[c] * after.elementsCount + k]) return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Weld the unindexed grids: exactly, checked against the reference and the input corners, then with their positions
+	 * jittered by a tenth of the epsilon, which must weld to the same vertices count.
+	 */
+	bool CheckSyntheticMeshes(const std::vector<size_t>& verticesCounts, ThreadPool& pool)
+	{
+		bool isMatch = true;
+		std::mt19937 random(7);
+		std::cout << "  \"meshes\": [" << std::endl;
+		for (size_t m = 0; m < verticesCounts.size(); m++)
+		{
+			MeshStreams mesh = CreateUnindexedGrid(verticesCounts[m], 0.0f, random);
+			std::vector<uint32_t> referenceRemap;
+			auto referenceStart = std::chrono::steady_clock::now();
+			size_t referenceCount = WeldVerticesReference(mesh, referenceRemap);
+			double referenceMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - referenceStart).count();
+
+			// Each run welds a fresh copy, the copy is not timed
+			MeshStreams welded;
+			VertexWeldReport report;
+			std::vector<double> milliseconds;
+			for (int r = 0; r < WELDING_REPETITIONS; r++)
+			{
+				welded = mesh;
+				auto start = std::chrono::steady_clock::now();
+				report = WeldVertices(welded, {}, pool);
+				milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			}
+			std::sort(milliseconds.begin(), milliseconds.end());
+			double parallelMs = milliseconds[milliseconds.size() / 2];
+			bool isExactMatch = report.verticesCountAfter == referenceCount && welded.indices == referenceRemap && IsSameCorners(mesh, welded);
+
+			MeshStreams jittered = CreateUnindexedGrid(verticesCounts[m], 0.1f * WELDING_EPSILON, random);
+			VertexWeldOptions options;
+			options.positionEpsilon = WELDING_EPSILON;
+			VertexWeldReport epsilonReport = WeldVertices(jittered, options, pool);
+			bool isEpsilonMatch = epsilonReport.verticesCountAfter == referenceCount && epsilonReport.degenerateTriangles == 0;
+
+			isMatch &= isExactMatch && isEpsilonMatch;
+			std::cout << std::fixed << std::setprecision(3)
+				<< "    { \"vertices\": " << report.verticesCountBefore << ", \"weldedVertices\": " << report.verticesCountAfter
+				<< ", \"jitteredWeldedVertices\": " << epsilonReport.verticesCountAfter << ", \"threads\": " << pool.GetThreadsCount()
+				<< ", \"referenceMs\": " << referenceMs << ", \"parallelMs\": " << parallelMs
+				<< ", \"parallelMVerticesPerSecond\": " << report.verticesCountBefore / (parallelMs * 1000.0)
+				<< ", \"exactMatch\": " << (isExactMatch ? "true" : "false") << ", \"epsilonMatch\": " << (isEpsilonMatch ? "true" : "false") << " }"
+				<< (m == verticesCounts.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]," << std::endl;
+		return isMatch;
+	}
+
+	/** Weld the triangle lists of the models exactly and with the epsilon, the exact welding must keep every corner */
+	bool CheckModels(const std::vector<std::string>& fileNames, ThreadPool& pool)
+	{
+		bool isMatch = true;
+		std::cout << "  \"models\": [" << std::endl;
+		for (size_t f = 0; f < fileNames.size(); f++)
+		{
+			VertexWeldReport exact, epsilon;
+			bool isFileMatch = true;
+			for (const MeshStreams& mesh : LoadMeshStreams(fileNames[f]))
+			{
+				MeshStreams welded = mesh;
+				exact.Add(WeldVertices(welded, {}, pool));
+				isFileMatch &= IsSameCorners(mesh, welded);
+
+				welded = mesh;
+				VertexWeldOptions options;
+				options.positionEpsilon = options.attributeEpsilon = WELDING_EPSILON;
+				epsilon.Add(WeldVertices(welded, options, pool));
+			}
+
+			isMatch &= isFileMatch;
+			std::cout << "    { \"file\": \"" << std::filesystem::path(fileNames[f]).generic_string() << "\", \"vertices\": " << exact.verticesCountBefore
+				<< ", \"weldedVertices\": " << exact.verticesCountAfter << ", \"epsilonWeldedVertices\": " << epsilon.verticesCountAfter
+				<< ", \"epsilonDegenerateTriangles\": " << epsilon.degenerateTriangles << ", \"match\": " << (isFileMatch ? "true" : "false") << " }"
+				<< (f == fileNames.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]" << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunWelding(const std::vector<std::string>& args)
+	{
+		std::vector<size_t> verticesCounts;
+		std::vector<std::string> fileNames;
+		for (const std::string& arg : args)
+		{
+			if (!arg.empty() && std::all_of(arg.begin(), arg.end(), ::isdigit)) verticesCounts.push_back(std::stoul(arg));
+			else fileNames.push_back(arg);
+		}
+		if (verticesCounts.empty()) verticesCounts = DEFAULT_WELDING_VERTICES;
+		if (fileNames.empty()) fileNames = DEFAULT_WELDING_MODELS;
+		ThreadPool& pool = ThreadPool::GetDefault();
+
+		std::cout << "{" << std::endl;
+		bool isMatch = CheckSyntheticMeshes(verticesCounts, pool);
+		isMatch &= CheckModels(fileNames, pool);
+		std::cout << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef MESH_WELDING_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunWelding({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
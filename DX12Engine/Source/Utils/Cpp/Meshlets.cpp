@@ -0,0 +1,331 @@
+#include "Meshlets.h"
+#include "FrustumCulling.h"
+#include "MeshStreams.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	constexpr float MIN_CONE_DOT = 0.1f;		// Below this cosine between the cone axis and a triangle normal, the cone is too wide to cull
+	constexpr size_t SMALL_MESHLET_DIVISOR = 4;	// A meshlet under 1 / SMALL_MESHLET_DIVISOR of the triangles limit is small
+
+	/** Grow the meshlets of a triangle list, see BuildMeshlets */
+	class MeshletBuilder
+	{
+	public:
+		MeshletBuilder(const MeshStreams& mesh, const MeshletOptions& options)
+			: m_indices(mesh.indices), m_positions(mesh.Find("POSITION")->values.data()), m_options(options)
+		{
+			// The triangles of each vertex
+			const size_t verticesCount = mesh.verticesCount;
+			m_vertexTrianglesOffsets.assign(verticesCount + 1, 0);
+			for (const uint32_t v : m_indices) m_vertexTrianglesOffsets[v + 1]++;
+			for (size_t v = 0; v < verticesCount; v++) m_vertexTrianglesOffsets[v + 1] += m_vertexTrianglesOffsets[v];
+			m_vertexTriangles.resize(m_indices.size());
+			std::vector<uint32_t> cursor(m_vertexTrianglesOffsets.begin(), m_vertexTrianglesOffsets.end() - 1);
+			for (size_t i = 0; i < m_indices.size(); i++) m_vertexTriangles[cursor[m_indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+			m_liveTriangles.resize(verticesCount);
+			for (size_t v = 0; v < verticesCount; v++) m_liveTriangles[v] = m_vertexTrianglesOffsets[v + 1] - m_vertexTrianglesOffsets[v];
+			m_vertexMeshlet.assign(verticesCount, UINT32_MAX);
+			m_isEmitted.assign(m_indices.size() / 3, false);
+		}
+
+		/** Return the reordered indices, meshlets receives the meshlets in the order of their triangles */
+		std::vector<uint32_t> Build(std::vector<Meshlet>& meshlets)
+		{
+			std::vector<uint32_t> indices;
+			indices.reserve(m_indices.size());
+			const size_t trianglesCount = m_indices.size() / 3;
+			size_t seed = 0;
+			while (true)
+			{
+				while (seed < trianglesCount && m_isEmitted[seed]) seed++;
+				if (seed == trianglesCount) break;
+
+				// Open a meshlet on the first triangle left, and grow it
+				const uint32_t meshletId = static_cast<uint32_t>(meshlets.size());
+				Meshlet meshlet;
+				meshlet.firstIndex = static_cast<uint32_t>(indices.size());
+				m_meshletVertices.clear();
+				m_centroid[0] = m_centroid[1] = m_centroid[2] = 0.0f;
+				uint32_t triangle = static_cast<uint32_t>(seed);
+				while (triangle != UINT32_MAX)
+				{
+					Emit(triangle, meshletId, indices);
+					if (indices.size() - meshlet.firstIndex == 3 * m_options.maxTriangles) break;
+					triangle = FindAdjacentTriangle(meshletId);
+
+					// A small meshlet out of neighbours takes the next triangle in order, as the pieces of a mesh are often drawn in sequence
+					if (triangle == UINT32_MAX && indices.size() - meshlet.firstIndex < 3 * m_options.maxTriangles / SMALL_MESHLET_DIVISOR)
+					{
+						while (seed < trianglesCount && m_isEmitted[seed]) seed++;
+						if (seed < trianglesCount && CountNewVertices(static_cast<uint32_t>(seed), meshletId) + m_meshletVertices.size() <= m_options.maxVertices)
+						{
+							triangle = static_cast<uint32_t>(seed);
+						}
+					}
+				}
+				meshlet.indicesCount = static_cast<uint32_t>(indices.size() - meshlet.firstIndex);
+				meshlet.verticesCount = static_cast<uint32_t>(m_meshletVertices.size());
+				SetBounds(meshlet, indices);
+				meshlets.push_back(meshlet);
+			}
+			return indices;
+		}
+
+	private:
+		const float* GetPosition(const uint32_t v) const { return m_positions + 3 * static_cast<size_t>(v); }
+
+		size_t CountNewVertices(const uint32_t triangle, const uint32_t meshletId) const
+		{
+			size_t count = 0;
+			for (size_t k = 0; k < 3; k++) count += (m_vertexMeshlet[m_indices[3 * triangle + k]] != meshletId);
+			return count;
+		}
+
+		void Emit(const uint32_t triangle, const uint32_t meshletId, std::vector<uint32_t>& indices)
+		{
+			m_isEmitted[triangle] = true;
+			for (size_t k = 0; k < 3; k++)
+			{
+				uint32_t v = m_indices[3 * triangle + k];
+				indices.push_back(v);
+				m_liveTriangles[v]--;
+				if (m_vertexMeshlet[v] == meshletId) continue;
+
+				// The centroid of the meshlet vertices steers the growth towards a round meshlet
+				m_vertexMeshlet[v] = meshletId;
+				m_meshletVertices.push_back(v);
+				float weight = 1.0f / static_cast<float>(m_meshletVertices.size());
+				for (size_t c = 0; c < 3; c++) m_centroid[c] += (GetPosition(v)[c] - m_centroid[c]) * weight;
+			}
+		}
+
+		/** Return the triangle left around the meshlet vertices with the fewest new vertices then the closest to the centroid, UINT32_MAX if none fits */
+		uint32_t FindAdjacentTriangle(const uint32_t meshletId) const
+		{
+			uint32_t best = UINT32_MAX;
+			size_t bestNewVertices = SIZE_MAX;
+			float bestDistance = 0.0f;
+			for (const uint32_t v : m_meshletVertices)
+			{
+				if (m_liveTriangles[v] == 0) continue;
+				for (uint32_t i = m_vertexTrianglesOffsets[v]; i < m_vertexTrianglesOffsets[v + 1]; i++)
+				{
+					uint32_t triangle = m_vertexTriangles[i];
+					if (m_isEmitted[triangle]) continue;
+					size_t newVertices = CountNewVertices(triangle, meshletId);
+					if (newVertices > bestNewVertices || m_meshletVertices.size() + newVertices > m_options.maxVertices) continue;
+
+					float distance = 0.0f;
+					for (size_t c = 0; c < 3; c++)
+					{
+						float d = (GetPosition(m_indices[3 * triangle])[c] + GetPosition(m_indices[3 * triangle + 1])[c] + GetPosition(m_indices[3 * triangle + 2])[c]) / 3.0f - m_centroid[c];
+						distance += d * d;
+					}
+					if (newVertices < bestNewVertices || distance < bestDistance)
+					{
+						best = triangle;
+						bestNewVertices = newVertices;
+						bestDistance = distance;
+					}
+				}
+			}
+			return best;
+		}
+
+		void SetBounds(Meshlet& meshlet, const std::vector<uint32_t>& indices) const
+		{
+			// The sphere is centered on the box, it contains every vertex
+			for (size_t c = 0; c < 3; c++)
+			{
+				meshlet.aabbMin[c] = meshlet.aabbMax[c] = GetPosition(m_meshletVertices[0])[c];
+			}
+			for (const uint32_t v : m_meshletVertices)
+			{
+				for (size_t c = 0; c < 3; c++)
+				{
+					meshlet.aabbMin[c] = (std::min)(meshlet.aabbMin[c], GetPosition(v)[c]);
+					meshlet.aabbMax[c] = (std::max)(meshlet.aabbMax[c], GetPosition(v)[c]);
+				}
+			}
+			for (size_t c = 0; c < 3; c++) meshlet.center[c] = 0.5f * (meshlet.aabbMin[c] + meshlet.aabbMax[c]);
+			float radius2 = 0.0f;
+			for (const uint32_t v : m_meshletVertices)
+			{
+				float d2 = 0.0f;
+				for (size_t c = 0; c < 3; c++) d2 += (GetPosition(v)[c] - meshlet.center[c]) * (GetPosition(v)[c] - meshlet.center[c]);
+				radius2 = (std::max)(radius2, d2);
+			}
+			meshlet.radius = std::sqrt(radius2);
+
+			// The cone axis is the mean of the unit normals, it culls if every normal is within acos(MIN_CONE_DOT) of it
+			struct TriangleNormal { float n[3]; uint32_t corner; };
+			std::vector<TriangleNormal> normals;
+			float axis[3] = {};
+			for (size_t i = meshlet.firstIndex; i < meshlet.firstIndex + static_cast<size_t>(meshlet.indicesCount); i += 3)
+			{
+				const float* a = GetPosition(indices[i]);
+				const float* b = GetPosition(indices[i + 1]);
+				const float* c = GetPosition(indices[i + 2]);
+				float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+				float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+				float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length == 0.0f) continue;	// Degenerate triangles face no direction
+				normals.push_back({ { n[0] / length, n[1] / length, n[2] / length }, indices[i] });
+				for (size_t k = 0; k < 3; k++) axis[k] += n[k] / length;
+			}
+			float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+			if (normals.empty() || axisLength == 0.0f) return;
+			for (size_t k = 0; k < 3; k++) axis[k] /= axisLength;
+
+			float minDot = 1.0f;
+			for (const TriangleNormal& normal : normals)
+			{
+				minDot = (std::min)(minDot, normal.n[0] * axis[0] + normal.n[1] * axis[1] + normal.n[2] * axis[2]);
+			}
+			if (minDot < MIN_CONE_DOT) return;
+
+			// The apex is the point of the axis through the center behind every triangle plane
+			float maxT = 0.0f;
+			for (const TriangleNormal& triangleNormal : normals)
+			{
+				const float* normal = triangleNormal.n;
+				const float* corner = GetPosition(triangleNormal.corner);
+				float dc = (meshlet.center[0] - corner[0]) * normal[0] + (meshlet.center[1] - corner[1]) * normal[1] + (meshlet.center[2] - corner[2]) * normal[2];
+				float dn = axis[0] * normal[0] + axis[1] * normal[1] + axis[2] * normal[2];
+				maxT = (std::max)(maxT, dc / dn);
+			}
+			for (size_t k = 0; k < 3; k++)
+			{
+				meshlet.coneApex[k] = meshlet.center[k] - axis[k] * maxT;
+				meshlet.coneAxis[k] = axis[k];
+			}
+			meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+
+		const std::vector<uint32_t>& m_indices;
+		const float* m_positions;
+		const MeshletOptions& m_options;
+		std::vector<uint32_t> m_vertexTrianglesOffsets;
+		std::vector<uint32_t> m_vertexTriangles;
+		std::vector<uint32_t> m_liveTriangles;	// Triangles of each vertex not in a meshlet yet
+		std::vector<uint32_t> m_vertexMeshlet;	// The last meshlet that uses each vertex
+		std::vector<bool> m_isEmitted;
+		std::vector<uint32_t> m_meshletVertices;
+		float m_centroid[3] = {};
+	};
+}
+
+void MeshletReport::Add(const MeshletReport& report)
+{
+	meshesCount += report.meshesCount;
+	trianglesCount += report.trianglesCount;
+	meshletsCount += report.meshletsCount;
+	verticesCount += report.verticesCount;
+	conesCount += report.conesCount;
+}
+
+MeshletReport BuildMeshlets(MeshStreams& mesh, const MeshletOptions& options, std::vector<Meshlet>& meshlets)
+{
+	meshlets.clear();
+	if (options.maxVertices < 3 || options.maxVertices > 256 || options.maxTriangles == 0) throw std::invalid_argument("Invalid meshlet limits");
+	if (mesh.indices.size() % 3 != 0) throw std::invalid_argument("The indices are not a triangle list");
+	if (!mesh.Find("POSITION")) throw std::invalid_argument("The mesh has no positions");
+	for (const uint32_t v : mesh.indices)
+	{
+		if (v >= mesh.verticesCount) throw std::invalid_argument("Index out of the vertices range");
+	}
+
+	MeshletReport report;
+	if (mesh.indices.empty()) return report;
+	mesh.indices = MeshletBuilder(mesh, options).Build(meshlets);
+
+	report.meshesCount = 1;
+	report.trianglesCount = mesh.indices.size() / 3;
+	report.meshletsCount = meshlets.size();
+	for (const Meshlet& meshlet : meshlets)
+	{
+		report.verticesCount += meshlet.verticesCount;
+		report.conesCount += (meshlet.coneCutoff <= 1.0f);
+	}
+	return report;
+}
+
+MeshletReport BuildMeshlets(std::vector<MeshStreams>& meshes, const MeshletOptions& options, ThreadPool& pool, std::vector<std::vector<Meshlet>>& meshlets)
+{
+	meshlets.assign(meshes.size(), {});
+	std::vector<MeshletReport> reports(meshes.size());
+	pool.ParallelFor(meshes.size(), [&](size_t m) { reports[m] = BuildMeshlets(meshes[m], options, meshlets[m]); });
+
+	MeshletReport report;
+	for (const MeshletReport& meshReport : reports) report.Add(meshReport);
+	return report;
+}
+
+MeshletCullingView GetMeshletCullingView(const float modelViewProjection[16], const float eyePosition[3], const bool cullBackfaces)
+{
+	// The frustum planes in the model space
+	Frustum frustum = GetFrustum(modelViewProjection);
+	MeshletCullingView view;
+	std::memcpy(view.planes, frustum.planes, sizeof(view.planes));
+	for (size_t k = 0; k < 3; k++) view.eyePosition[k] = eyePosition[k];
+	view.cullBackfaces = cullBackfaces;
+	return view;
+}
+
+size_t MarkVisibleMeshlets(const std::vector<Meshlet>& meshlets, const MeshletCullingView& view, std::vector<uint8_t>& visible)
+{
+	visible.resize(meshlets.size(), 0);
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < meshlets.size(); i++)
+	{
+		const Meshlet& meshlet = meshlets[i];
+		bool isVisible = true;
+		for (size_t p = 0; p < 6 && isVisible; p++)
+		{
+			const float* plane = view.planes[p];
+			isVisible = plane[0] * meshlet.center[0] + plane[1] * meshlet.center[1] + plane[2] * meshlet.center[2] + plane[3] >= -meshlet.radius;
+		}
+		if (isVisible && view.cullBackfaces && meshlet.coneCutoff <= 1.0f)
+		{
+			float d[3] = { meshlet.coneApex[0] - view.eyePosition[0], meshlet.coneApex[1] - view.eyePosition[1], meshlet.coneApex[2] - view.eyePosition[2] };
+			float dot = d[0] * meshlet.coneAxis[0] + d[1] * meshlet.coneAxis[1] + d[2] * meshlet.coneAxis[2];
+			isVisible = dot < meshlet.coneCutoff * std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+		}
+		if (isVisible)
+		{
+			visible[i] = 1;
+			visibleCount++;
+		}
+	}
+	return visibleCount;
+}
+
+std::vector<MeshletRange> GetMeshletRanges(const std::vector<Meshlet>& meshlets, const std::vector<uint8_t>& visible, const uint32_t maxGapIndices)
+{
+	std::vector<MeshletRange> ranges;
+	for (size_t i = 0; i < meshlets.size() && i < visible.size(); i++)
+	{
+		if (!visible[i]) continue;
+		if (!ranges.empty() && meshlets[i].firstIndex - (ranges.back().firstIndex + ranges.back().indicesCount) <= maxGapIndices)
+		{
+			ranges.back().indicesCount = meshlets[i].firstIndex + meshlets[i].indicesCount - ranges.back().firstIndex;
+		}
+		else ranges.push_back({ meshlets[i].firstIndex, meshlets[i].indicesCount });
+	}
+	return ranges;
+}
+
+std::vector<MeshletRange> CullMeshlets(const std::vector<Meshlet>& meshlets, const MeshletCullingView& view, const uint32_t maxGapIndices)
+{
+	std::vector<uint8_t> visible;
+	MarkVisibleMeshlets(meshlets, view, visible);
+	return GetMeshletRanges(meshlets, visible, maxGapIndices);
+}
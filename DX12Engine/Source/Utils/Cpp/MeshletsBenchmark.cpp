@@ -0,0 +1,357 @@
+#include "Benchmark.h"
+#include "Meshlets.h"
+#include "MeshStreams.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+	const std::vector<std::string> DEFAULT_MESHLETS_MODELS = { "models/2CylinderEngine.glb", "models/DamagedHelmet.glb", "models/NormalTangentTest.glb", "models/scene.gltf" };
+	constexpr size_t SPHERE_SEGMENTS = 512;		// About 500K triangles
+	constexpr size_t VIEWS_COUNT = 64;			// Random views the meshlets are culled against
+	constexpr int MESHLETS_REPETITIONS = 3;
+	constexpr float BOUNDS_EPSILON = 1e-4f;		// Relative to the mesh radius
+	constexpr uint32_t MERGE_GAP_INDICES = 384;	// The gap the viewer draws through to save a draw call
+
+	using Vector3 = std::array<float, 3>;
+
+	Vector3 Subtract(const Vector3& a, const Vector3& b) { return { a[0] - b[0], a[1] - b[1], a[2] - b[2] }; }
+	Vector3 Cross(const Vector3& a, const Vector3& b) { return { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] }; }
+	float Dot(const Vector3& a, const Vector3& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+	Vector3 Normalize(const Vector3& a) { float l = std::sqrt(Dot(a, a)); return { a[0] / l, a[1] / l, a[2] / l }; }
+
+	/** A camera looking at a mesh: the model view projection matrix, row major for row vectors, and the eye position */
+	struct View
+	{
+		float modelViewProjection[16];
+		Vector3 eye;
+	};
+
+	/** A left handed look at and perspective, as XMMatrixLookAtLH and XMMatrixPerspectiveFovLH multiplied */
+	View CreateView(const Vector3& eye, const Vector3& target, const float fovY, const float nearZ, const float farZ)
+	{
+		Vector3 z = Normalize(Subtract(target, eye));
+		Vector3 up = std::abs(z[1]) > 0.99f ? Vector3{ 1.0f, 0.0f, 0.0f } : Vector3{ 0.0f, 1.0f, 0.0f };
+		Vector3 x = Normalize(Cross(up, z));
+		Vector3 y = Cross(z, x);
+		float viewMtx[16] = { x[0], y[0], z[0], 0.0f, x[1], y[1], z[1], 0.0f, x[2], y[2], z[2], 0.0f, -Dot(x, eye), -Dot(y, eye), -Dot(z, eye), 1.0f };
+		float h = 1.0f / std::tan(0.5f * fovY), range = farZ / (farZ - nearZ);
+		float projMtx[16] = { h, 0.0f, 0.0f, 0.0f, 0.0f, h, 0.0f, 0.0f, 0.0f, 0.0f, range, 1.0f, 0.0f, 0.0f, -range * nearZ, 0.0f };
+
+		View view;
+		for (size_t r = 0; r < 4; r++)
+		{
+			for (size_t c = 0; c < 4; c++)
+			{
+				view.modelViewProjection[4 * r + c] = 0.0f;
+				for (size_t k = 0; k < 4; k++) view.modelViewProjection[4 * r + c] += viewMtx[4 * r + k] * projMtx[4 * k + c];
+			}
+		}
+		view.eye = eye;
+		return view;
+	}
+
+	/** Return the center of the mesh bounding box, and its half diagonal in radius */
+	Vector3 GetBounds(const MeshStreams& mesh, float& radius)
+	{
+		const std::vector<float>& positions = mesh.Find("POSITION")->values;
+		Vector3 low = { positions[0], positions[1], positions[2] }, high = low;
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			low[i % 3] = (std::min)(low[i % 3], positions[i]);
+			high[i % 3] = (std::max)(high[i % 3], positions[i]);
+		}
+		radius = (std::max)(0.5f * std::sqrt(Dot(Subtract(high, low), Subtract(high, low))), 1e-3f);
+		return { 0.5f * (low[0] + high[0]), 0.5f * (low[1] + high[1]), 0.5f * (low[2] + high[2]) };
+	}
+
+	/** Views from random points around the mesh bounds, looking at random points near its center: some see all of it, some a part */
+	std::vector<View> CreateViews(const MeshStreams& mesh, const size_t count)
+	{
+		float radius = 0.0f;
+		Vector3 center = GetBounds(mesh, radius);
+
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::vector<View> views;
+		while (views.size() < count)
+		{
+			Vector3 direction = { unit(random), unit(random), unit(random) };
+			if (Dot(direction, direction) < 1e-2f || Dot(direction, direction) > 1.0f) continue;
+			direction = Normalize(direction);
+			float distance = radius * (1.2f + 1.8f * (0.5f + 0.5f * unit(random)));
+			Vector3 eye = { center[0] + direction[0] * distance, center[1] + direction[1] * distance, center[2] + direction[2] * distance };
+			Vector3 target = { center[0] + 0.5f * radius * unit(random), center[1] + 0.5f * radius * unit(random), center[2] + 0.5f * radius * unit(random) };
+			views.push_back(CreateView(eye, target, 0.25f * 3.14159265f, 0.01f * radius, 10.0f * radius));
+		}
+		return views;
+	}
+
+	/** A UV sphere of segments x segments quads, counter clockwise seen from outside */
+	MeshStreams CreateSphere(const size_t segments)
+	{
+		const float pi = 3.14159265f;
+		MeshStreams mesh;
+		std::vector<float> positions;
+		for (size_t y = 0; y <= segments; y++)
+		{
+			float theta = pi * y / segments;
+			for (size_t x = 0; x <= segments; x++)
+			{
+				float phi = 2.0f * pi * x / segments;
+				positions.insert(positions.end(), { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) });
+			}
+		}
+		mesh.verticesCount = positions.size() / 3;
+		mesh.SetStream("POSITION", 3, std::move(positions));
+		const uint32_t w = static_cast<uint32_t>(segments + 1);
+		for (uint32_t y = 0; y < segments; y++)
+		{
+			for (uint32_t x = 0; x < segments; x++)
+			{
+				uint32_t p = y * w + x;
+				if (y > 0) mesh.indices.insert(mesh.indices.end(), { p, p + 1, p + w });
+				if (y + 1 < segments) mesh.indices.insert(mesh.indices.end(), { p + 1, p + w + 1, p + w });
+			}
+		}
+		return mesh;
+	}
+
+	/** Return the triangles of indices rotated to start on their smallest index, sorted: equal for two orders of the same triangles */
+	std::vector<std::array<uint32_t, 3>> GetSortedTriangles(const std::vector<uint32_t>& indices)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			std::array<uint32_t, 3> t = { indices[i], indices[i + 1], indices[i + 2] };
+			std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+			triangles.push_back(t);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	/** Return true if the meshlets tile the indices within the limits, and their bounds contain their triangles */
+	bool AreMeshletsValid(const MeshStreams& mesh, const std::vector<Meshlet>& meshlets, const MeshletOptions& options, const float epsilon)
+	{
+		const std::vector<float>& positions = mesh.Find("POSITION")->values;
+		size_t nextIndex = 0;
+		for (const Meshlet& meshlet : meshlets)
+		{
+			if (meshlet.firstIndex != nextIndex || meshlet.indicesCount == 0 || meshlet.indicesCount % 3 != 0 || meshlet.indicesCount / 3 > options.maxTriangles) return false;
+			nextIndex += meshlet.indicesCount;
+
+			std::vector<uint32_t> vertices(mesh.indices.begin() + meshlet.firstIndex, mesh.indices.begin() + meshlet.firstIndex + meshlet.indicesCount);
+			std::sort(vertices.begin(), vertices.end());
+			vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+			if (vertices.size() != meshlet.verticesCount || vertices.size() > options.maxVertices) return false;
+			for (const uint32_t v : vertices)
+			{
+				Vector3 p = { positions[3 * v], positions[3 * v + 1], positions[3 * v + 2] };
+				Vector3 d = Subtract(p, { meshlet.center[0], meshlet.center[1], meshlet.center[2] });
+				if (std::sqrt(Dot(d, d)) > meshlet.radius + epsilon) return false;
+				for (size_t c = 0; c < 3; c++) if (p[c] < meshlet.aabbMin[c] - epsilon || p[c] > meshlet.aabbMax[c] + epsilon) return false;
+			}
+		}
+		return nextIndex == mesh.indices.size();
+	}
+
+	/**
+	 * Return true if no meshlet culled by a view could be seen from it: the culled meshlets have no vertex inside the frustum, or every
+	 * triangle facing away from the eye. The culled and back facing meshlets are counted.
+	 */
+	bool IsCullingConservative(const MeshStreams& mesh, const std::vector<Meshlet>& meshlets, const std::vector<View>& views, const float epsilon,
+		size_t& culledCount, size_t& backfacingCount)
+	{
+		const std::vector<float>& positions = mesh.Find("POSITION")->values;
+		culledCount = backfacingCount = 0;
+		for (const View& view : views)
+		{
+			const float* m = view.modelViewProjection;
+			std::vector<uint8_t> visible, visibleInFrustum;
+			MarkVisibleMeshlets(meshlets, GetMeshletCullingView(m, view.eye.data(), true), visible);
+			MarkVisibleMeshlets(meshlets, GetMeshletCullingView(m, view.eye.data(), false), visibleInFrustum);
+			for (size_t i = 0; i < meshlets.size(); i++)
+			{
+				if (visible[i]) continue;
+				culledCount++;
+				const Meshlet& meshlet = meshlets[i];
+				if (visibleInFrustum[i])
+				{
+					// Back facing: the eye is behind every triangle plane
+					backfacingCount++;
+					for (size_t t = meshlet.firstIndex; t < meshlet.firstIndex + static_cast<size_t>(meshlet.indicesCount); t += 3)
+					{
+						Vector3 a = { positions[3 * mesh.indices[t]], positions[3 * mesh.indices[t] + 1], positions[3 * mesh.indices[t] + 2] };
+						Vector3 b = { positions[3 * mesh.indices[t + 1]], positions[3 * mesh.indices[t + 1] + 1], positions[3 * mesh.indices[t + 1] + 2] };
+						Vector3 c = { positions[3 * mesh.indices[t + 2]], positions[3 * mesh.indices[t + 2] + 1], positions[3 * mesh.indices[t + 2] + 2] };
+						Vector3 n = Cross(Subtract(b, a), Subtract(c, a));
+						float length = std::sqrt(Dot(n, n));
+						if (length > 0.0f && Dot(n, Subtract(view.eye, a)) / length > epsilon) return false;
+					}
+					continue;
+				}
+				for (size_t k = meshlet.firstIndex; k < meshlet.firstIndex + static_cast<size_t>(meshlet.indicesCount); k++)
+				{
+					const float* p = &positions[3 * mesh.indices[k]];
+					float clip[4];
+					for (size_t c = 0; c < 4; c++) clip[c] = p[0] * m[c] + p[1] * m[4 + c] + p[2] * m[8 + c] + m[12 + c];
+					float w = clip[3] * (1.0f - BOUNDS_EPSILON);	// Vertices on a plane may round either way
+					bool isInside = std::abs(clip[0]) < w && std::abs(clip[1]) < w && clip[2] > clip[3] * BOUNDS_EPSILON && clip[2] < w;
+					if (isInside) return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	/** Build and cull the meshlets of the meshes, check them and print the report as a JSON object */
+	bool CheckMeshlets(const std::string& name, const std::vector<MeshStreams>& meshes, const MeshletOptions& options, ThreadPool& pool, const bool isLast)
+	{
+		std::vector<double> serialMilliseconds, parallelMilliseconds;
+		std::vector<MeshStreams> serialMeshes, parallelMeshes;
+		std::vector<std::vector<Meshlet>> meshlets, serialMeshlets(meshes.size());
+		MeshletReport report;
+		for (int r = 0; r < MESHLETS_REPETITIONS; r++)
+		{
+			serialMeshes = meshes;
+			auto start = std::chrono::steady_clock::now();
+			for (size_t m = 0; m < meshes.size(); m++) BuildMeshlets(serialMeshes[m], options, serialMeshlets[m]);
+			serialMilliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+			parallelMeshes = meshes;
+			start = std::chrono::steady_clock::now();
+			report = BuildMeshlets(parallelMeshes, options, pool, meshlets);
+			parallelMilliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(serialMilliseconds.begin(), serialMilliseconds.end());
+		std::sort(parallelMilliseconds.begin(), parallelMilliseconds.end());
+		double serialMs = serialMilliseconds[serialMilliseconds.size() / 2], parallelMs = parallelMilliseconds[parallelMilliseconds.size() / 2];
+
+		// The meshlets cannot depend on the threads, must draw the same triangles, and must not cull what a view can see
+		bool isSame = true, isValid = true, isConservative = true;
+		size_t culledCount = 0, backfacingCount = 0, culledViews = 0;
+		std::vector<std::vector<View>> views(meshes.size());
+		for (size_t m = 0; m < meshes.size(); m++)
+		{
+			isSame &= parallelMeshes[m].indices == serialMeshes[m].indices && meshlets[m].size() == serialMeshlets[m].size();
+			isValid &= GetSortedTriangles(parallelMeshes[m].indices) == GetSortedTriangles(meshes[m].indices);
+
+			views[m] = CreateViews(meshes[m], VIEWS_COUNT);
+			float radius = 0.0f;
+			GetBounds(meshes[m], radius);
+			float epsilon = BOUNDS_EPSILON * radius;
+			isValid &= AreMeshletsValid(parallelMeshes[m], meshlets[m], options, epsilon);
+			size_t culled = 0, backfacing = 0;
+			isConservative &= IsCullingConservative(parallelMeshes[m], meshlets[m], views[m], epsilon, culled, backfacing);
+			culledCount += culled;
+			backfacingCount += backfacing;
+			culledViews += meshlets[m].size() * views[m].size();
+		}
+
+		// The cull throughput, in meshlets per millisecond: every view of every mesh, down to the ranges to draw
+		size_t rangesCount = 0, mergedRangesCount = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int r = 0; r < MESHLETS_REPETITIONS; r++)
+		{
+			for (size_t m = 0; m < meshes.size(); m++)
+			{
+				for (const View& view : views[m]) rangesCount += CullMeshlets(meshlets[m], GetMeshletCullingView(view.modelViewProjection, view.eye.data(), true)).size();
+			}
+		}
+		double cullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / MESHLETS_REPETITIONS;
+		for (size_t m = 0; m < meshes.size(); m++)
+		{
+			for (const View& view : views[m])
+			{
+				mergedRangesCount += CullMeshlets(meshlets[m], GetMeshletCullingView(view.modelViewProjection, view.eye.data(), true), MERGE_GAP_INDICES).size();
+			}
+		}
+		bool isMatch = isSame && isValid && isConservative;
+
+		std::cout << std::fixed << std::setprecision(3)
+			<< "    { \"mesh\": \"" << name << "\", \"primitives\": " << meshes.size() << ", \"triangles\": " << report.trianglesCount
+			<< ", \"meshlets\": " << report.meshletsCount << ", \"trianglesPerMeshlet\": " << (report.meshletsCount ? double(report.trianglesCount) / report.meshletsCount : 0.0)
+			<< ", \"verticesPerMeshlet\": " << (report.meshletsCount ? double(report.verticesCount) / report.meshletsCount : 0.0)
+			<< ", \"cones\": " << report.conesCount << ", \"threads\": " << pool.GetThreadsCount() << ", \"serialBuildMs\": " << serialMs << ", \"parallelBuildMs\": " << parallelMs
+			<< ", \"views\": " << VIEWS_COUNT << ", \"culledPercent\": " << (culledViews ? 100.0 * culledCount / culledViews : 0.0)
+			<< ", \"backfacingPercent\": " << (culledViews ? 100.0 * backfacingCount / culledViews : 0.0)
+			<< ", \"rangesPerView\": " << (meshes.empty() ? 0.0 : double(rangesCount) / (MESHLETS_REPETITIONS * VIEWS_COUNT * meshes.size()))
+			<< ", \"mergedRangesPerView\": " << (meshes.empty() ? 0.0 : double(mergedRangesCount) / (VIEWS_COUNT * meshes.size()))
+			<< ", \"meshletsPerMs\": " << (cullMs > 0.0 ? culledViews / cullMs : 0.0)
+			<< ", \"sameMeshlets\": " << (isSame ? "true" : "false") << ", \"valid\": " << (isValid ? "true" : "false")
+			<< ", \"conservative\": " << (isConservative ? "true" : "false") << ", \"match\": " << (isMatch ? "true" : "false") << " }" << (isLast ? "" : ",") << std::endl;
+		return isMatch;
+	}
+
+	/** A vertex out of range and limits that cannot hold a triangle must be rejected */
+	bool CheckInvalidMeshes()
+	{
+		MeshStreams mesh;
+		mesh.verticesCount = 3;
+		mesh.SetStream("POSITION", 3, { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f });
+		mesh.indices = { 0, 1, 3 };
+		std::vector<Meshlet> meshlets;
+		bool isOutOfRangeRejected = false, isLimitRejected = false;
+		try { BuildMeshlets(mesh, MeshletOptions(), meshlets); }
+		catch (const std::invalid_argument&) { isOutOfRangeRejected = true; }
+
+		mesh.indices = { 0, 1, 2 };
+		MeshletOptions options;
+		options.maxVertices = 2;
+		try { BuildMeshlets(mesh, options, meshlets); }
+		catch (const std::invalid_argument&) { isLimitRejected = true; }
+		bool isMatch = isOutOfRangeRejected && isLimitRejected;
+		std::cout << "  \"invalidMeshes\": { \"outOfRangeRejected\": " << (isOutOfRangeRejected ? "true" : "false") << ", \"limitsRejected\": "
+			<< (isLimitRejected ? "true" : "false") << ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunMeshlets(const std::vector<std::string>& args)
+	{
+		std::vector<std::string> fileNames = args.empty() ? DEFAULT_MESHLETS_MODELS : args;
+		ThreadPool& pool = ThreadPool::GetDefault();
+		MeshletOptions options;
+
+		std::cout << "{" << std::endl;
+		bool isMatch = CheckInvalidMeshes();
+		std::cout << "  \"meshes\": [" << std::endl;
+		isMatch &= CheckMeshlets("sphere", { CreateSphere(SPHERE_SEGMENTS) }, options, pool, fileNames.empty());
+		for (size_t f = 0; f < fileNames.size(); f++)
+		{
+			std::vector<MeshStreams> meshes = LoadMeshStreams(fileNames[f]);
+			meshes.erase(std::remove_if(meshes.begin(), meshes.end(), [](const MeshStreams& mesh) { return mesh.indices.empty(); }), meshes.end());
+			isMatch &= CheckMeshlets(std::filesystem::path(fileNames[f]).generic_string(), meshes, options, pool, f == fileNames.size() - 1);
+		}
+		std::cout << "  ]" << std::endl << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef MESHLETS_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunMeshlets({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
@@ -0,0 +1,372 @@
+#include "OcclusionCulling.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define OCCLUSION_CULLING_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	constexpr uint32_t MAX_BUFFER_SIZE = 4096;
+	constexpr size_t MAX_CLIPPED_VERTICES = 9;		// A triangle clipped by the five planes
+	constexpr size_t TEST_CHUNK_SIZE = 256;			// Boxes tested by a pool task
+	constexpr double DEPTH_EPSILON = 1e-6;			// Relative error of the depth plane, added to the depth of the occluders
+	constexpr float BOX_EPSILON = 1e-4f;			// Pixels and relative depth a box is grown by against its projection errors
+
+	/** Return the farthest of count depths, FLT_MAX if one of the pixels has no occluder */
+	float GetMaxDepth(const float* depths, const size_t count)
+	{
+		float maxDepth = -(std::numeric_limits<float>::max)();
+		for (size_t i = 0; i < count; i++) maxDepth = (std::max)(maxDepth, depths[i]);
+		return maxDepth;
+	}
+
+	void Transform(const float point[4], const float matrix[16], float result[4])
+	{
+		for (int j = 0; j < 4; j++) result[j] = point[0] * matrix[j] + point[1] * matrix[4 + j] + point[2] * matrix[8 + j] + point[3] * matrix[12 + j];
+	}
+
+	/** Clip a polygon of clip space vertices to -w <= x <= w, -w <= y <= w and 0 <= z (Sutherland-Hodgman), return its vertices count */
+	size_t ClipPolygon(float (&vertices)[MAX_CLIPPED_VERTICES][4], size_t count)
+	{
+		auto distance = [](const float* v, const int plane)
+		{
+			switch (plane)
+			{
+			case 0: return v[3] + v[0];
+			case 1: return v[3] - v[0];
+			case 2: return v[3] + v[1];
+			case 3: return v[3] - v[1];
+			default: return v[2];
+			}
+		};
+		float clipped[MAX_CLIPPED_VERTICES][4];
+		for (int plane = 0; plane < 5 && count >= 3; plane++)
+		{
+			// Most triangles are inside most planes: they are kept as they are
+			bool isInside = true;
+			for (size_t i = 0; i < count && isInside; i++) isInside = distance(vertices[i], plane) >= 0.0f;
+			if (isInside) continue;
+
+			size_t clippedCount = 0;
+			for (size_t i = 0; i < count; i++)
+			{
+				const float* a = vertices[i];
+				const float* b = vertices[(i + 1) % count];
+				float da = distance(a, plane), db = distance(b, plane);
+				if (da >= 0.0f) std::copy(a, a + 4, clipped[clippedCount++]);
+				if ((da >= 0.0f) != (db >= 0.0f))
+				{
+					// From the same end whichever way the edge is walked, the triangles sharing it get the same point
+					if (std::lexicographical_compare(b, b + 4, a, a + 4)) { std::swap(a, b); std::swap(da, db); }
+					float t = da / (da - db);
+					for (int k = 0; k < 4; k++) clipped[clippedCount][k] = a[k] + t * (b[k] - a[k]);
+					clippedCount++;
+				}
+			}
+			count = clippedCount;
+			std::copy(&clipped[0][0], &clipped[0][0] + 4 * count, &vertices[0][0]);
+		}
+		return count < 3 ? 0 : count;
+	}
+
+	BoundingBox GetBox(const CullingBounds& bounds, const uint32_t object)
+	{
+		BoundingBox box;
+		if (bounds.sphereRadii[object] == -std::numeric_limits<float>::infinity()) return box;
+		for (int k = 0; k < 3; k++)
+		{
+			box.min[k] = bounds.boxCenters[k][object] - bounds.boxExtents[k][object];
+			box.max[k] = bounds.boxCenters[k][object] + bounds.boxExtents[k][object];
+		}
+		return box;
+	}
+}
+
+OcclusionBuffer::OcclusionBuffer()
+{
+	OcclusionOptions options;
+	Resize(options.width, options.height);
+}
+
+void OcclusionBuffer::Resize(const uint32_t width, const uint32_t height)
+{
+	if (width == 0 || height == 0 || width > MAX_BUFFER_SIZE || height > MAX_BUFFER_SIZE)
+	{
+		throw std::invalid_argument("The occlusion buffer size must be from 1 to " + std::to_string(MAX_BUFFER_SIZE) + " pixels");
+	}
+	m_tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+	m_tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+	m_width = m_tilesX * TILE_WIDTH;
+	m_height = m_tilesY * TILE_HEIGHT;
+	m_depths.resize(static_cast<size_t>(m_width) * m_height);
+	m_tileMaxDepths.resize(static_cast<size_t>(m_tilesX) * m_tilesY);
+	m_tileTriangles.resize(m_tileMaxDepths.size());
+	Clear();
+}
+
+void OcclusionBuffer::SetViewProjection(const float viewProjection[16])
+{
+	std::copy(viewProjection, viewProjection + 16, m_viewProjection);
+	Clear();
+}
+
+void OcclusionBuffer::Clear()
+{
+	std::fill(m_depths.begin(), m_depths.end(), (std::numeric_limits<float>::max)());
+	std::fill(m_tileMaxDepths.begin(), m_tileMaxDepths.end(), (std::numeric_limits<float>::max)());
+	for (std::vector<uint32_t>& triangles : m_tileTriangles) triangles.clear();
+	m_triangles.clear();
+}
+
+void OcclusionBuffer::SetUpTriangles(const Occluder& occluder, std::vector<Triangle>& triangles) const
+{
+	// The model to clip transform of the occluder, then each triangle clipped to the view and split in a fan
+	float modelViewProjection[16];
+	for (int i = 0; i < 4; i++) Transform(&occluder.transform[4 * i], m_viewProjection, &modelViewProjection[4 * i]);
+	const double width = m_width, height = m_height;
+	for (size_t t = 0; t < occluder.trianglesCount; t++)
+	{
+		float vertices[MAX_CLIPPED_VERTICES][4];
+		for (size_t c = 0; c < 3; c++)
+		{
+			const float* p = &occluder.vertices[9 * t + 3 * c];
+			const float point[4] = { p[0], p[1], p[2], 1.0f };
+			Transform(point, modelViewProjection, vertices[c]);
+		}
+		size_t count = ClipPolygon(vertices, 3);
+		double screen[MAX_CLIPPED_VERTICES][3];
+		for (size_t i = 0; i < count; i++)
+		{
+			double w = vertices[i][3];
+			if (!(w > 0.0)) { count = 0; break; }
+			screen[i][0] = (0.5 * vertices[i][0] / w + 0.5) * width;
+			screen[i][1] = (0.5 - 0.5 * vertices[i][1] / w) * height;
+			screen[i][2] = vertices[i][2] / w;
+		}
+
+		for (size_t i = 1; i + 1 < count; i++)
+		{
+			const double* p[3] = { screen[0], screen[i], screen[i + 1] };
+			double area = (p[1][0] - p[0][0]) * (p[2][1] - p[0][1]) - (p[1][1] - p[0][1]) * (p[2][0] - p[0][0]);
+			if (!(std::fabs(area) > 1e-9)) continue;
+
+			// The pixels whose center is inside the triangle bounds, the only ones it may cover
+			double minX = (std::min)({ p[0][0], p[1][0], p[2][0] }), maxX = (std::max)({ p[0][0], p[1][0], p[2][0] });
+			double minY = (std::min)({ p[0][1], p[1][1], p[2][1] }), maxY = (std::max)({ p[0][1], p[1][1], p[2][1] });
+			double firstX = (std::max)(std::ceil(minX - 0.5), 0.0), lastX = (std::min)(std::floor(maxX - 0.5), width - 1.0);
+			double firstY = (std::max)(std::ceil(minY - 0.5), 0.0), lastY = (std::min)(std::floor(maxY - 0.5), height - 1.0);
+			if (firstX > lastX || firstY > lastY) continue;
+
+			// The edge functions and the depth plane at the pixel centers, x + 0.5 and y + 0.5 for the pixel x, y. The edge functions of
+			// two triangles sharing an edge are exact opposites: a center on the edge is covered by one of them at least, or both
+			Triangle triangle;
+			double sign = area > 0.0 ? 1.0 : -1.0;
+			for (int e = 0; e < 3; e++)
+			{
+				const double* a = p[e];
+				const double* b = p[(e + 1) % 3];
+				double ea = sign * (a[1] - b[1]), eb = sign * (b[0] - a[0]), ec = sign * (a[0] * b[1] - b[0] * a[1]);
+				triangle.edges[e][0] = static_cast<float>(ea);
+				triangle.edges[e][1] = static_cast<float>(eb);
+				triangle.edges[e][2] = static_cast<float>(ec + 0.5 * (ea + eb));
+			}
+			double dx = ((p[1][2] - p[0][2]) * (p[2][1] - p[0][1]) - (p[2][2] - p[0][2]) * (p[1][1] - p[0][1])) / area;
+			double dy = ((p[2][2] - p[0][2]) * (p[1][0] - p[0][0]) - (p[1][2] - p[0][2]) * (p[2][0] - p[0][0])) / area;
+			double d0 = p[0][2] - dx * p[0][0] - dy * p[0][1];
+			triangle.depth[0] = static_cast<float>(d0 + 0.5 * (dx + dy) + DEPTH_EPSILON * (std::fabs(d0) + std::fabs(dx) * width + std::fabs(dy) * height + 1.0));
+			triangle.depth[1] = static_cast<float>(dx);
+			triangle.depth[2] = static_cast<float>(dy);
+			triangle.maxDepth = static_cast<float>((std::max)({ p[0][2], p[1][2], p[2][2] }) * (1.0 + DEPTH_EPSILON) + DEPTH_EPSILON);
+			triangle.minX = static_cast<uint32_t>(firstX);
+			triangle.maxX = static_cast<uint32_t>(lastX);
+			triangle.minY = static_cast<uint32_t>(firstY);
+			triangle.maxY = static_cast<uint32_t>(lastY);
+			triangles.push_back(triangle);
+		}
+	}
+}
+
+void OcclusionBuffer::Rasterize(const std::vector<Occluder>& occluders, ThreadPool& pool)
+{
+	std::vector<std::vector<Triangle>> occluderTriangles(occluders.size());
+	pool.ParallelFor(occluders.size(), [&](size_t o) { SetUpTriangles(occluders[o], occluderTriangles[o]); });
+
+	// Bin the new triangles in occluder order, the tiles are then rasterized with the new triangles only
+	for (std::vector<uint32_t>& triangles : m_tileTriangles) triangles.clear();
+	for (const std::vector<Triangle>& triangles : occluderTriangles)
+	{
+		for (const Triangle& triangle : triangles)
+		{
+			uint32_t triangleId = static_cast<uint32_t>(m_triangles.size());
+			m_triangles.push_back(triangle);
+			for (uint32_t ty = triangle.minY / TILE_HEIGHT; ty <= triangle.maxY / TILE_HEIGHT; ty++)
+			{
+				for (uint32_t tx = triangle.minX / TILE_WIDTH; tx <= triangle.maxX / TILE_WIDTH; tx++) m_tileTriangles[ty * m_tilesX + tx].push_back(triangleId);
+			}
+		}
+	}
+	pool.ParallelFor(m_tileTriangles.size(), [&](size_t tileId) { RasterizeTile(tileId); });
+}
+
+void OcclusionBuffer::RasterizeTile(const size_t tileId)
+{
+	const std::vector<uint32_t>& tileTriangles = m_tileTriangles[tileId];
+	if (tileTriangles.empty()) return;
+	const uint32_t tileX = static_cast<uint32_t>(tileId % m_tilesX) * TILE_WIDTH, tileY = static_cast<uint32_t>(tileId / m_tilesX) * TILE_HEIGHT;
+	for (uint32_t triangleId : tileTriangles)
+	{
+		const Triangle& t = m_triangles[triangleId];
+		const uint32_t firstX = (std::max)(t.minX, tileX) & ~3u, lastX = (std::min)(t.maxX, tileX + TILE_WIDTH - 1);
+		const uint32_t firstY = (std::max)(t.minY, tileY), lastY = (std::min)(t.maxY, tileY + TILE_HEIGHT - 1);
+		for (uint32_t y = firstY; y <= lastY; y++)
+		{
+			float* row = &m_depths[static_cast<size_t>(y) * m_width];
+			const float fy = static_cast<float>(y);
+			float rowEdges[3], rowDepth = t.depth[0] + t.depth[2] * fy;
+			for (int e = 0; e < 3; e++) rowEdges[e] = t.edges[e][1] * fy + t.edges[e][2];
+#ifdef OCCLUSION_CULLING_SSE2
+			// Four pixels at a time: the ones inside the three edges take the nearer of their depth and the triangle depth
+			const __m128 offsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), maxDepth = _mm_set1_ps(t.maxDepth);
+			for (uint32_t x = firstX; x <= lastX; x += 4)
+			{
+				const __m128 xs = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+				__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.edges[0][0]), xs), _mm_set1_ps(rowEdges[0])), _mm_setzero_ps());
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.edges[1][0]), xs), _mm_set1_ps(rowEdges[1])), _mm_setzero_ps()));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.edges[2][0]), xs), _mm_set1_ps(rowEdges[2])), _mm_setzero_ps()));
+				if (_mm_movemask_ps(inside) == 0) continue;
+				__m128 depth = _mm_min_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.depth[1]), xs), _mm_set1_ps(rowDepth)), maxDepth);
+				__m128 stored = _mm_loadu_ps(row + x);
+				depth = _mm_min_ps(stored, depth);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, depth), _mm_andnot_ps(inside, stored)));
+			}
+#else
+			for (uint32_t x = firstX; x < ((lastX + 4) & ~3u); x++)
+			{
+				const float fx = static_cast<float>(x);
+				if (t.edges[0][0] * fx + rowEdges[0] >= 0.0f && t.edges[1][0] * fx + rowEdges[1] >= 0.0f && t.edges[2][0] * fx + rowEdges[2] >= 0.0f)
+				{
+					row[x] = (std::min)(row[x], (std::min)(t.depth[1] * fx + rowDepth, t.maxDepth));
+				}
+			}
+#endif
+		}
+	}
+
+	float tileMaxDepth = -(std::numeric_limits<float>::max)();
+	for (uint32_t y = tileY; y < tileY + TILE_HEIGHT; y++) tileMaxDepth = (std::max)(tileMaxDepth, GetMaxDepth(&m_depths[static_cast<size_t>(y) * m_width + tileX], TILE_WIDTH));
+	m_tileMaxDepths[tileId] = tileMaxDepth;
+}
+
+bool OcclusionBuffer::IsVisible(const BoundingBox& box) const
+{
+	if (box.IsEmpty()) return false;
+
+	// The screen rectangle and the nearest depth of the box corners, a box crossing the near plane is kept
+	float minX = (std::numeric_limits<float>::max)(), maxX = -minX, minY = minX, maxY = -minX, minDepth = minX;
+	for (int c = 0; c < 8; c++)
+	{
+		const float corner[4] = { (c & 1) ? box.max[0] : box.min[0], (c & 2) ? box.max[1] : box.min[1], (c & 4) ? box.max[2] : box.min[2], 1.0f };
+		float clip[4];
+		Transform(corner, m_viewProjection, clip);
+		if (!(clip[3] > 0.0f) || clip[2] < 0.0f) return true;
+		float x = (0.5f * clip[0] / clip[3] + 0.5f) * m_width, y = (0.5f - 0.5f * clip[1] / clip[3]) * m_height;
+		minX = (std::min)(minX, x);
+		maxX = (std::max)(maxX, x);
+		minY = (std::min)(minY, y);
+		maxY = (std::max)(maxY, y);
+		minDepth = (std::min)(minDepth, clip[2] / clip[3]);
+	}
+	minDepth -= BOX_EPSILON * std::fabs(minDepth);
+
+	// Every pixel the rectangle touches, clamped to the view
+	float firstX = (std::max)(std::floor(minX - BOX_EPSILON), 0.0f), lastX = (std::min)(std::floor(maxX + BOX_EPSILON), m_width - 1.0f);
+	float firstY = (std::max)(std::floor(minY - BOX_EPSILON), 0.0f), lastY = (std::min)(std::floor(maxY + BOX_EPSILON), m_height - 1.0f);
+	if (!(firstX <= lastX && firstY <= lastY)) return true;
+	const uint32_t x0 = static_cast<uint32_t>(firstX), x1 = static_cast<uint32_t>(lastX), y0 = static_cast<uint32_t>(firstY), y1 = static_cast<uint32_t>(lastY);
+
+	for (uint32_t ty = y0 / TILE_HEIGHT; ty <= y1 / TILE_HEIGHT; ty++)
+	{
+		for (uint32_t tx = x0 / TILE_WIDTH; tx <= x1 / TILE_WIDTH; tx++)
+		{
+			// A box behind the farthest pixel of a tile is hidden over all of it
+			if (m_tileMaxDepths[ty * m_tilesX + tx] < minDepth) continue;
+			const uint32_t firstTileX = (std::max)(x0, tx * TILE_WIDTH), lastTileX = (std::min)(x1, (tx + 1) * TILE_WIDTH - 1);
+			const uint32_t firstTileY = (std::max)(y0, ty * TILE_HEIGHT), lastTileY = (std::min)(y1, (ty + 1) * TILE_HEIGHT - 1);
+			for (uint32_t y = firstTileY; y <= lastTileY; y++)
+			{
+				const float* row = &m_depths[static_cast<size_t>(y) * m_width];
+				uint32_t x = firstTileX;
+#ifdef OCCLUSION_CULLING_SSE2
+				const __m128 depth = _mm_set1_ps(minDepth);
+				for (; x + 3 <= lastTileX; x += 4)
+				{
+					if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), depth)) != 0) return true;
+				}
+#endif
+				for (; x <= lastTileX; x++)
+				{
+					if (row[x] >= minDepth) return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+size_t OcclusionBuffer::TestBounds(const CullingBounds& bounds, const std::vector<uint32_t>& candidates, std::vector<uint32_t>& visible, ThreadPool& pool) const
+{
+	std::vector<uint8_t> isVisible(candidates.size(), 0);
+	const size_t chunksCount = (candidates.size() + TEST_CHUNK_SIZE - 1) / TEST_CHUNK_SIZE;
+	pool.ParallelFor(chunksCount, [&](size_t chunk)
+	{
+		const size_t end = (std::min)(candidates.size(), (chunk + 1) * TEST_CHUNK_SIZE);
+		for (size_t i = chunk * TEST_CHUNK_SIZE; i < end; i++) isVisible[i] = IsVisible(GetBox(bounds, candidates[i]));
+	});
+
+	visible.clear();
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		if (isVisible[i]) visible.push_back(candidates[i]);
+	}
+	return visible.size();
+}
+
+size_t SelectOccluders(const CullingBounds& bounds, const std::vector<uint32_t>& candidates, const std::vector<size_t>& trianglesCounts,
+	const float eye[3], const OcclusionOptions& options, std::vector<uint32_t>& occluders)
+{
+	// The sine of the half angle the sphere is seen under, the eye inside a sphere sees it largest
+	std::vector<std::pair<float, uint32_t>> sizes;
+	for (uint32_t object : candidates)
+	{
+		float radius = bounds.sphereRadii[object];
+		if (trianglesCounts[object] == 0 || radius == -std::numeric_limits<float>::infinity()) continue;
+		float distance = 0.0f;
+		for (int k = 0; k < 3; k++) distance += (bounds.sphereCenters[k][object] - eye[k]) * (bounds.sphereCenters[k][object] - eye[k]);
+		distance = std::sqrt(distance);
+		sizes.emplace_back(distance <= radius ? 1.0f : radius / distance, object);
+	}
+	std::sort(sizes.begin(), sizes.end(), [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b)
+	{
+		return a.first != b.first ? a.first > b.first : a.second < b.second;
+	});
+
+	occluders.clear();
+	size_t trianglesCount = 0;
+	for (const std::pair<float, uint32_t>& size : sizes)
+	{
+		if (occluders.size() == options.maxOccluders) break;
+		if (trianglesCount + trianglesCounts[size.second] > options.maxOccluderTriangles) continue;
+		trianglesCount += trianglesCounts[size.second];
+		occluders.push_back(size.second);
+	}
+	return occluders.size();
+}
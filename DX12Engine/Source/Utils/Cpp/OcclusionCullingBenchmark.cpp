@@ -0,0 +1,542 @@
+#include "Benchmark.h"
+#include "MeshStreams.h"
+#include "OcclusionCulling.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const std::vector<std::string> DEFAULT_OCCLUSION_MODELS = { "models/BoxTextured.glb", "models/2CylinderEngine.glb", "models/DamagedHelmet.glb", "models/scene.gltf" };
+	constexpr size_t OCCLUSION_GRID_SIZE = 12;			// Copies of a model per side of the benchmark grid
+	constexpr int OCCLUSION_FRAMES = 32;				// Frames of the camera path along the grid
+	constexpr size_t OCCLUSION_RANDOM_OCCLUDERS = 24;
+	constexpr size_t OCCLUSION_RANDOM_BOXES = 4000;
+	constexpr size_t OCCLUSION_CHECKED_BOXES = 64;		// Culled boxes of a model frame checked with rays
+	constexpr float PI = 3.14159265358979f;
+
+	using Matrix = std::array<float, 16>;
+
+	double GetMilliseconds(const std::chrono::steady_clock::time_point& start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double Median(std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+		return values.empty() ? 0.0 : values[values.size() / 2];
+	}
+
+	Matrix Multiply(const Matrix& a, const Matrix& b)
+	{
+		Matrix m = {};
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				for (int k = 0; k < 4; k++) m[4 * i + j] += a[4 * i + k] * b[4 * k + j];
+			}
+		}
+		return m;
+	}
+
+	/** A right handed look at and XMMatrixPerspectiveFovRH, row major, as Camera builds them */
+	Matrix CreateViewProjection(const float eye[3], const float target[3], const float fovY, const float aspect, const float nearZ, const float farZ)
+	{
+		auto normalize = [](float v[3]) { float l = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]); for (int k = 0; k < 3; k++) v[k] /= l; };
+		float forward[3] = { eye[0] - target[0], eye[1] - target[1], eye[2] - target[2] };
+		normalize(forward);
+		float worldUp[3] = { 0.0f, 1.0f, 0.0f };
+		if (std::fabs(forward[1]) > 0.99f) { worldUp[1] = 0.0f; worldUp[2] = 1.0f; }
+		float right[3] = { worldUp[1] * forward[2] - worldUp[2] * forward[1], worldUp[2] * forward[0] - worldUp[0] * forward[2], worldUp[0] * forward[1] - worldUp[1] * forward[0] };
+		normalize(right);
+		float up[3] = { forward[1] * right[2] - forward[2] * right[1], forward[2] * right[0] - forward[0] * right[2], forward[0] * right[1] - forward[1] * right[0] };
+
+		Matrix view = {};
+		const float* axes[3] = { right, up, forward };
+		for (int a = 0; a < 3; a++)
+		{
+			for (int k = 0; k < 3; k++) view[4 * k + a] = axes[a][k];
+			view[12 + a] = -(eye[0] * axes[a][0] + eye[1] * axes[a][1] + eye[2] * axes[a][2]);
+		}
+		view[15] = 1.0f;
+
+		float h = 1.0f / std::tan(0.5f * fovY), range = farZ / (nearZ - farZ);
+		Matrix projection = { h / aspect, 0, 0, 0, 0, h, 0, 0, 0, 0, range, -1, 0, 0, range * nearZ, 0 };
+		return Multiply(view, projection);
+	}
+
+	/** The inverse of a matrix by Gauss-Jordan elimination with partial pivoting, in double */
+	std::array<double, 16> Invert(const Matrix& m)
+	{
+		double a[4][8];
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++) { a[i][j] = m[4 * i + j]; a[i][4 + j] = (i == j) ? 1.0 : 0.0; }
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			int pivot = c;
+			for (int r = c + 1; r < 4; r++) if (std::fabs(a[r][c]) > std::fabs(a[pivot][c])) pivot = r;
+			std::swap(a[c], a[pivot]);
+			for (int r = 0; r < 4; r++)
+			{
+				if (r == c) continue;
+				double f = a[r][c] / a[c][c];
+				for (int j = 0; j < 8; j++) a[r][j] -= f * a[c][j];
+			}
+		}
+		std::array<double, 16> inverse;
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++) inverse[4 * i + j] = a[i][4 + j] / a[i][i];
+		}
+		return inverse;
+	}
+
+	/** Möller-Trumbore on both faces */
+	bool IntersectTriangle(const float* p0, const float* p1, const float* p2, const float origin[3], const float direction[3], float& t)
+	{
+		float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		const float* d = direction;
+		float q[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+		float det = e1[0] * q[0] + e1[1] * q[1] + e1[2] * q[2];
+		if (det == 0.0f) return false;
+		float inverseDet = 1.0f / det;
+		float s[3] = { origin[0] - p0[0], origin[1] - p0[1], origin[2] - p0[2] };
+		float u = (s[0] * q[0] + s[1] * q[1] + s[2] * q[2]) * inverseDet;
+		if (!(u >= 0.0f && u <= 1.0f)) return false;
+		float w[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+		float v = (d[0] * w[0] + d[1] * w[1] + d[2] * w[2]) * inverseDet;
+		if (!(v >= 0.0f && u + v <= 1.0f)) return false;
+		t = (e2[0] * w[0] + e2[1] * w[1] + e2[2] * w[2]) * inverseDet;
+		return true;
+	}
+
+	/** The triangles of the occluders in world space, nine floats each */
+	std::vector<float> GetWorldTriangles(const std::vector<Occluder>& occluders)
+	{
+		std::vector<float> triangles;
+		for (const Occluder& occluder : occluders)
+		{
+			const float* m = occluder.transform;
+			for (size_t i = 0; i < 9 * occluder.trianglesCount; i += 3)
+			{
+				const float* p = &occluder.vertices[i];
+				for (int j = 0; j < 3; j++) triangles.push_back(p[0] * m[j] + p[1] * m[4 + j] + p[2] * m[8 + j] + m[12 + j]);
+			}
+		}
+		return triangles;
+	}
+
+	/** The pixel rectangle of points in front of the eye, false if one of them is behind it */
+	bool GetScreenRectangle(const float* points, const size_t count, const Matrix& viewProjection, const OcclusionBuffer& buffer, float rectangle[4])
+	{
+		rectangle[0] = rectangle[1] = (std::numeric_limits<float>::max)();
+		rectangle[2] = rectangle[3] = -(std::numeric_limits<float>::max)();
+		for (size_t i = 0; i < count; i++)
+		{
+			const float* p = &points[3 * i];
+			float clip[4];
+			for (int j = 0; j < 4; j++) clip[j] = p[0] * viewProjection[j] + p[1] * viewProjection[4 + j] + p[2] * viewProjection[8 + j] + viewProjection[12 + j];
+			if (!(clip[3] > 0.0f)) return false;
+			float x = (0.5f * clip[0] / clip[3] + 0.5f) * buffer.GetWidth(), y = (0.5f - 0.5f * clip[1] / clip[3]) * buffer.GetHeight();
+			rectangle[0] = (std::min)(rectangle[0], x);
+			rectangle[1] = (std::min)(rectangle[1], y);
+			rectangle[2] = (std::max)(rectangle[2], x);
+			rectangle[3] = (std::max)(rectangle[3], y);
+		}
+		return true;
+	}
+
+	/**
+	 * Check that a culled box is hidden: every ray from the eye through the center of a pixel of the buffer that hits the box must hit
+	 * an occluder triangle first. A center on the silhouette of an occluder may be covered in the buffer and missed by a ray for the
+	 * float rounding: a ray a thousandth of a pixel away from the center that hits an occluder first also hides it.
+	 * Return false if a ray reaches the box
+	 */
+	bool IsBoxHidden(const BoundingBox& box, const float eye[3], const Matrix& viewProjection, const OcclusionBuffer& buffer, const std::vector<float>& triangles)
+	{
+		float corners[8][3], boxRectangle[4];
+		for (int c = 0; c < 8; c++)
+		{
+			for (int k = 0; k < 3; k++) corners[c][k] = (c & (1 << k)) ? box.max[k] : box.min[k];
+		}
+		if (!GetScreenRectangle(&corners[0][0], 8, viewProjection, buffer, boxRectangle)) return false;
+
+		// Only the triangles over the box rectangle, or crossing the eye plane, may hide it
+		std::vector<const float*> boxTriangles;
+		for (size_t t = 0; t < triangles.size(); t += 9)
+		{
+			float rectangle[4];
+			if (!GetScreenRectangle(&triangles[t], 3, viewProjection, buffer, rectangle) || (rectangle[0] <= boxRectangle[2] + 1.0f && boxRectangle[0] <= rectangle[2] + 1.0f
+				&& rectangle[1] <= boxRectangle[3] + 1.0f && boxRectangle[1] <= rectangle[3] + 1.0f)) boxTriangles.push_back(&triangles[t]);
+		}
+
+		const std::array<double, 16> inverse = Invert(viewProjection);
+		const int firstX = (std::max)(static_cast<int>(std::floor(boxRectangle[0])), 0), lastX = (std::min)(static_cast<int>(std::floor(boxRectangle[2])), static_cast<int>(buffer.GetWidth()) - 1);
+		const int firstY = (std::max)(static_cast<int>(std::floor(boxRectangle[1])), 0), lastY = (std::min)(static_cast<int>(std::floor(boxRectangle[3])), static_cast<int>(buffer.GetHeight()) - 1);
+		const double offsets[5][2] = { { 0.0, 0.0 }, { -1e-3, -1e-3 }, { 1e-3, -1e-3 }, { -1e-3, 1e-3 }, { 1e-3, 1e-3 } };
+		for (int y = firstY; y <= lastY; y++)
+		{
+			for (int x = firstX; x <= lastX; x++)
+			{
+				bool isHidden = false, isBoxHit = false;
+				for (int o = 0; o < 5 && !isHidden; o++)
+				{
+					// The pixel center on the near plane, unprojected
+					const double ndc[4] = { 2.0 * (x + 0.5 + offsets[o][0]) / buffer.GetWidth() - 1.0, 1.0 - 2.0 * (y + 0.5 + offsets[o][1]) / buffer.GetHeight(), 0.0, 1.0 };
+					double point[4];
+					for (int j = 0; j < 4; j++) point[j] = ndc[0] * inverse[j] + ndc[1] * inverse[4 + j] + ndc[2] * inverse[8 + j] + ndc[3] * inverse[12 + j];
+					float direction[3];
+					for (int k = 0; k < 3; k++) direction[k] = static_cast<float>(point[k] / point[3] - eye[k]);
+
+					float tBox = 0.0f, tExit = (std::numeric_limits<float>::max)();
+					for (int k = 0; k < 3; k++)
+					{
+						float a = (box.min[k] - eye[k]) / direction[k], b = (box.max[k] - eye[k]) / direction[k];
+						tBox = (std::max)(tBox, (std::min)(a, b));
+						tExit = (std::min)(tExit, (std::max)(a, b));
+					}
+					if (!(tBox <= tExit)) continue;
+					isBoxHit = true;
+					for (size_t t = 0; t < boxTriangles.size() && !isHidden; t++)
+					{
+						float distance;
+						isHidden = IntersectTriangle(boxTriangles[t], boxTriangles[t] + 3, boxTriangles[t] + 6, eye, direction, distance) && distance > 0.0f && distance < tBox;
+					}
+				}
+				if (isBoxHit && !isHidden) return false;
+			}
+		}
+		return true;
+	}
+
+	/** A wall facing the camera, and boxes behind it, around it, in front of it, through it and across the near plane */
+	bool CheckWall(ThreadPool& pool)
+	{
+		const float eye[3] = { 0.0f, 0.0f, 0.0f }, target[3] = { 0.0f, 0.0f, -1.0f };
+		Matrix viewProjection = CreateViewProjection(eye, target, 0.5f * PI, 16.0f / 9.0f, 0.1f, 100.0f);
+		const std::vector<float> wall = { -4, -4, -10, 4, -4, -10, 4, 4, -10, -4, -4, -10, 4, 4, -10, -4, 4, -10 };
+		Occluder occluder;
+		occluder.vertices = wall.data();
+		occluder.trianglesCount = 2;
+
+		struct Case
+		{
+			const char* name;
+			float center[3];
+			float halfSize;
+			bool isVisible;
+		};
+		const Case cases[] = {
+			{ "behindWall", { 0.0f, 0.0f, -20.0f }, 1.0f, false },
+			{ "farBehindWall", { 2.0f, -3.0f, -80.0f }, 0.5f, false },
+			{ "inFrontOfWall", { 0.0f, 0.0f, -5.0f }, 1.0f, true },
+			{ "throughWall", { 0.0f, 0.0f, -10.0f }, 1.0f, true },
+			{ "peekingOut", { 7.0f, 0.0f, -20.0f }, 1.0f, true },
+			{ "besideWall", { 12.0f, 0.0f, -20.0f }, 1.0f, true },
+			{ "acrossNearPlane", { 0.0f, 0.0f, 0.0f }, 1.0f, true },
+			{ "empty", { 0.0f, 0.0f, -20.0f }, -1.0f, false },
+		};
+
+		OcclusionBuffer buffer;
+		buffer.SetViewProjection(viewProjection.data());
+		buffer.Rasterize({ occluder }, pool);
+		bool isMatch = true;
+		std::cout << "  \"cases\": [" << std::endl;
+		const size_t casesCount = sizeof(cases) / sizeof(cases[0]);
+		for (size_t i = 0; i < casesCount; i++)
+		{
+			const Case& c = cases[i];
+			BoundingBox box;
+			if (c.halfSize > 0.0f)
+			{
+				for (int k = 0; k < 3; k++) { box.min[k] = c.center[k] - c.halfSize; box.max[k] = c.center[k] + c.halfSize; }
+			}
+			bool isVisible = buffer.IsVisible(box);
+			bool isCaseMatch = isVisible == c.isVisible;
+			isMatch &= isCaseMatch;
+			std::cout << "    { \"case\": \"" << c.name << "\", \"visible\": " << (isVisible ? "true" : "false") << ", \"match\": " << (isCaseMatch ? "true" : "false")
+				<< " }" << (i == casesCount - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]," << std::endl;
+		return isMatch;
+	}
+
+	/**
+	 * Random quads and a floor crossing the near plane hide random boxes. Every culled box must be hidden from the eye, and the buffer
+	 * and the culled boxes must be the same on one and on four threads
+	 */
+	bool CheckRandom(ThreadPool& pool)
+	{
+		std::mt19937 random(67);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		const float eye[3] = { 0.0f, 0.0f, 0.0f }, target[3] = { 0.0f, 0.0f, -1.0f };
+		Matrix viewProjection = CreateViewProjection(eye, target, PI / 3.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+
+		std::vector<float> quads = { -50, -1, 5, 50, -1, 5, 50, -1, -100, -50, -1, 5, 50, -1, -100, -50, -1, -100 };
+		for (size_t q = 0; q < OCCLUSION_RANDOM_OCCLUDERS; q++)
+		{
+			float center[3] = { 8.0f * unit(random), 4.0f * unit(random), -17.5f + 12.5f * unit(random) };
+			float a[3], b[3];
+			for (int k = 0; k < 3; k++) { a[k] = 3.0f * unit(random); b[k] = 3.0f * unit(random); }
+			const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+			for (int c : { 0, 1, 2, 0, 2, 3 })
+			{
+				for (int k = 0; k < 3; k++) quads.push_back(center[k] + corners[c][0] * a[k] + corners[c][1] * b[k]);
+			}
+		}
+		Occluder occluder;
+		occluder.vertices = quads.data();
+		occluder.trianglesCount = quads.size() / 9;
+		std::vector<Occluder> occluders(1, occluder);
+
+		CullingBounds bounds;
+		bounds.Resize(OCCLUSION_RANDOM_BOXES);
+		std::vector<uint32_t> candidates;
+		for (uint32_t i = 0; i < OCCLUSION_RANDOM_BOXES; i++)
+		{
+			BoundingBox box;
+			float center[3] = { 20.0f * unit(random), 8.0f * unit(random), -32.0f + 28.0f * unit(random) }, halfSize = 0.55f + 0.45f * unit(random);
+			for (int k = 0; k < 3; k++) { box.min[k] = center[k] - halfSize; box.max[k] = center[k] + halfSize; }
+			bounds.Set(i, box, GetBoundingSphere(box));
+			candidates.push_back(i);
+		}
+
+		ThreadPool serialPool(0), parallelPool(3);
+		OcclusionBuffer buffer, serialBuffer, parallelBuffer;
+		std::vector<uint32_t> visible, serialVisible, parallelVisible;
+		buffer.SetViewProjection(viewProjection.data());
+		auto start = std::chrono::steady_clock::now();
+		buffer.Rasterize(occluders, pool);
+		double rasterizeMs = GetMilliseconds(start);
+		start = std::chrono::steady_clock::now();
+		buffer.TestBounds(bounds, candidates, visible, pool);
+		double testMs = GetMilliseconds(start);
+		serialBuffer.SetViewProjection(viewProjection.data());
+		serialBuffer.Rasterize(occluders, serialPool);
+		serialBuffer.TestBounds(bounds, candidates, serialVisible, serialPool);
+		parallelBuffer.SetViewProjection(viewProjection.data());
+		parallelBuffer.Rasterize(occluders, parallelPool);
+		parallelBuffer.TestBounds(bounds, candidates, parallelVisible, parallelPool);
+
+		bool isThreadsMatch = visible == serialVisible && visible == parallelVisible;
+		for (uint32_t y = 0; y < buffer.GetHeight(); y++)
+		{
+			for (uint32_t x = 0; x < buffer.GetWidth(); x++)
+			{
+				isThreadsMatch &= buffer.GetDepth(x, y) == serialBuffer.GetDepth(x, y) && buffer.GetDepth(x, y) == parallelBuffer.GetDepth(x, y);
+			}
+		}
+
+		// Each culled box is checked against every occluder triangle with rays
+		std::vector<float> triangles = GetWorldTriangles(occluders);
+		size_t culledCount = 0, floorCulledCount = 0;
+		bool isHidden = true;
+		for (size_t i = 0, v = 0; i < candidates.size(); i++)
+		{
+			if (v < visible.size() && visible[v] == candidates[i]) { v++; continue; }
+			BoundingBox box;
+			for (int k = 0; k < 3; k++) { box.min[k] = bounds.boxCenters[k][i] - bounds.boxExtents[k][i]; box.max[k] = bounds.boxCenters[k][i] + bounds.boxExtents[k][i]; }
+			isHidden &= IsBoxHidden(box, eye, viewProjection, buffer, triangles);
+			culledCount++;
+			floorCulledCount += box.max[1] < -1.0f;
+		}
+
+		// Culling nothing would pass the checks: the quads and the floor must hide some of the boxes
+		bool isMatch = isThreadsMatch && isHidden && culledCount > 0 && floorCulledCount > 0;
+		std::cout << std::fixed << std::setprecision(3) << "  \"random\": { \"occluderTriangles\": " << occluder.trianglesCount << ", \"rasterizedTriangles\": "
+			<< buffer.GetRasterizedTrianglesCount() << ", \"boxes\": " << candidates.size() << ", \"culled\": " << culledCount << ", \"culledBelowFloor\": " << floorCulledCount
+			<< ", \"rasterizeMs\": " << rasterizeMs << ", \"testMs\": " << testMs << ", \"threadsMatch\": " << (isThreadsMatch ? "true" : "false")
+			<< ", \"hidden\": " << (isHidden ? "true" : "false") << ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+
+	/** A mesh of a model as an occluder and an object: its triangles unindexed, and its bounds */
+	struct ModelMesh
+	{
+		std::vector<float> vertices;
+		BoundingBox bounds;
+	};
+
+	std::vector<ModelMesh> LoadModelMeshes(const std::string& fileName, BoundingBox& modelBounds)
+	{
+		std::vector<ModelMesh> meshes;
+		for (const MeshStreams& streams : LoadMeshStreams(fileName))
+		{
+			const VertexStream* positions = streams.Find("POSITION");
+			if (positions == nullptr || streams.verticesCount == 0) continue;
+			ModelMesh mesh;
+			size_t indicesCount = streams.indices.empty() ? streams.verticesCount - streams.verticesCount % 3 : streams.indices.size();
+			for (size_t i = 0; i < indicesCount; i++)
+			{
+				size_t index = streams.indices.empty() ? i : streams.indices[i];
+				mesh.vertices.insert(mesh.vertices.end(), &positions->values[3 * index], &positions->values[3 * index] + 3);
+			}
+			mesh.bounds = ComputeBoundingBox(positions->values);
+			modelBounds.Add(mesh.bounds);
+			meshes.push_back(std::move(mesh));
+		}
+		return meshes;
+	}
+
+	/**
+	 * Copies of a model on a grid, each turned around the vertical axis, seen from a camera walking along the front row at the height of
+	 * the models. The meshes of the copies are the objects, culled against the frustum then against the largest of them as occluders.
+	 * Every frame reports the times of picking the occluders, of rasterizing them and of testing the objects left by the frustum
+	 */
+	bool CheckModel(const std::string& fileName, const bool isTemporal, ThreadPool& pool)
+	{
+		BoundingBox modelBounds;
+		std::vector<ModelMesh> meshes = LoadModelMeshes(fileName, modelBounds);
+		if (meshes.empty()) throw std::runtime_error("No triangles in " + fileName);
+		float modelCenter[3], modelSize = 0.0f;
+		for (int k = 0; k < 3; k++)
+		{
+			modelCenter[k] = 0.5f * (modelBounds.min[k] + modelBounds.max[k]);
+			modelSize = (std::max)(modelSize, modelBounds.max[k] - modelBounds.min[k]);
+		}
+		const float spacing = 1.25f * modelSize;
+
+		// The objects of each copy, the copies in row major order
+		std::vector<Matrix> copies;
+		for (size_t row = 0; row < OCCLUSION_GRID_SIZE; row++)
+		{
+			for (size_t column = 0; column < OCCLUSION_GRID_SIZE; column++)
+			{
+				float angle = 0.7f * (row * OCCLUSION_GRID_SIZE + column), c = std::cos(angle), s = std::sin(angle);
+				Matrix m = { c, 0, -s, 0, 0, 1, 0, 0, s, 0, c, 0, 0, 0, 0, 1 };
+				float center[3] = { modelCenter[0] * c + modelCenter[2] * s, modelCenter[1], -modelCenter[0] * s + modelCenter[2] * c };
+				m[12] = column * spacing - center[0];
+				m[13] = -center[1];
+				m[14] = -(row * spacing) - center[2];
+				copies.push_back(m);
+			}
+		}
+		CullingBounds bounds;
+		bounds.Resize(copies.size() * meshes.size());
+		std::vector<size_t> trianglesCounts(bounds.count);
+		for (size_t c = 0; c < copies.size(); c++)
+		{
+			for (size_t m = 0; m < meshes.size(); m++)
+			{
+				BoundingBox box = TransformBoundingBox(meshes[m].bounds, copies[c].data());
+				bounds.Set(c * meshes.size() + m, box, GetBoundingSphere(box));
+				trianglesCounts[c * meshes.size() + m] = meshes[m].vertices.size() / 9;
+			}
+		}
+
+		OcclusionOptions options;
+		OcclusionBuffer buffer;
+		buffer.Resize(options.width, options.height);
+		std::vector<double> selectMs, rasterizeMs, testMs;
+		std::vector<uint32_t> candidates, occluderObjects, visible, lastVisible;
+		size_t candidatesCount = 0, culledCount = 0, occludersCount = 0, checkedCount = 0;
+		bool isHidden = true;
+		for (int frame = 0; frame < OCCLUSION_FRAMES; frame++)
+		{
+			const float extent = (OCCLUSION_GRID_SIZE - 1) * spacing;
+			const float eye[3] = { extent * frame / (OCCLUSION_FRAMES - 1), 0.0f, spacing };
+			const float target[3] = { 0.5f * extent, 0.0f, -extent };
+			Matrix viewProjection = CreateViewProjection(eye, target, PI / 4.0f, 16.0f / 9.0f, 0.01f * modelSize, 4.0f * extent + modelSize);
+			CullBounds(GetFrustum(viewProjection.data()), bounds, candidates);
+
+			// The occluders come from the objects of the last frame that passed the test when the temporal reuse is on
+			auto start = std::chrono::steady_clock::now();
+			SelectOccluders(bounds, (isTemporal && frame > 0) ? lastVisible : candidates, trianglesCounts, eye, options, occluderObjects);
+			std::vector<Occluder> occluders(occluderObjects.size());
+			for (size_t o = 0; o < occluders.size(); o++)
+			{
+				const ModelMesh& mesh = meshes[occluderObjects[o] % meshes.size()];
+				occluders[o].vertices = mesh.vertices.data();
+				occluders[o].trianglesCount = mesh.vertices.size() / 9;
+				std::copy(copies[occluderObjects[o] / meshes.size()].begin(), copies[occluderObjects[o] / meshes.size()].end(), occluders[o].transform);
+			}
+			selectMs.push_back(GetMilliseconds(start));
+			start = std::chrono::steady_clock::now();
+			buffer.SetViewProjection(viewProjection.data());
+			buffer.Rasterize(occluders, pool);
+			rasterizeMs.push_back(GetMilliseconds(start));
+			start = std::chrono::steady_clock::now();
+			buffer.TestBounds(bounds, candidates, visible, pool);
+			testMs.push_back(GetMilliseconds(start));
+
+			candidatesCount += candidates.size();
+			culledCount += candidates.size() - visible.size();
+			occludersCount += occluders.size();
+			lastVisible = visible;
+
+			// The first culled objects of the first frames are checked with rays against the occluder triangles
+			if (frame % 8 != 0) continue;
+			std::vector<float> triangles = GetWorldTriangles(occluders);
+			for (size_t i = 0, v = 0; i < candidates.size() && checkedCount < OCCLUSION_CHECKED_BOXES * (frame / 8 + 1); i++)
+			{
+				if (v < visible.size() && visible[v] == candidates[i]) { v++; continue; }
+				const uint32_t object = candidates[i];
+				BoundingBox box;
+				for (int k = 0; k < 3; k++) { box.min[k] = bounds.boxCenters[k][object] - bounds.boxExtents[k][object]; box.max[k] = bounds.boxCenters[k][object] + bounds.boxExtents[k][object]; }
+				isHidden &= IsBoxHidden(box, eye, viewProjection, buffer, triangles);
+				checkedCount++;
+			}
+		}
+
+		std::cout << std::fixed << std::setprecision(3) << "    { \"file\": \"" << std::filesystem::path(fileName).generic_string() << "\", \"temporal\": "
+			<< (isTemporal ? "true" : "false") << ", \"objects\": " << bounds.count << ", \"occludersPerFrame\": " << static_cast<double>(occludersCount) / OCCLUSION_FRAMES
+			<< ", \"inFrustumPerFrame\": " << static_cast<double>(candidatesCount) / OCCLUSION_FRAMES
+			<< ", \"culledPercent\": " << 100.0 * culledCount / (std::max)(candidatesCount, size_t(1)) << ", \"selectMs\": " << Median(selectMs)
+			<< ", \"rasterizeMs\": " << Median(rasterizeMs) << ", \"testMs\": " << Median(testMs) << ", \"frameMs\": " << Median(selectMs) + Median(rasterizeMs) + Median(testMs)
+			<< ", \"checkedCulled\": " << checkedCount << ", \"match\": " << (isHidden ? "true" : "false") << " }";
+		return isHidden;
+	}
+}
+
+namespace Benchmark
+{
+	int RunOcclusionCulling(const std::vector<std::string>& args)
+	{
+		std::vector<std::string> fileNames = args.empty() ? DEFAULT_OCCLUSION_MODELS : args;
+		ThreadPool& pool = ThreadPool::GetDefault();
+		std::cout << "{" << std::endl << "  \"threads\": " << pool.GetThreadsCount() << "," << std::endl;
+		bool isMatch = CheckWall(pool);
+		isMatch &= CheckRandom(pool);
+		std::cout << "  \"models\": [" << std::endl;
+		for (size_t f = 0; f < fileNames.size(); f++)
+		{
+			isMatch &= CheckModel(fileNames[f], false, pool);
+			std::cout << "," << std::endl;
+			isMatch &= CheckModel(fileNames[f], true, pool);
+			std::cout << (f == fileNames.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]" << std::endl << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef OCCLUSION_CULLING_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunOcclusionCulling({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
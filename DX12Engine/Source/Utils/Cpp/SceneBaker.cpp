@@ -0,0 +1,346 @@
+#include "SceneBaker.h"
+#include "Scene.h"
+#include "Mesh.h"
+#include "UploadPlanner.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "using_directives.h"
+
+namespace
+{
+	static_assert(sizeof(RoughMetallicMaterial) <= sizeof(BakedMaterial::data), "RoughMetallicMaterial does not fit in a baked material");
+	static_assert(sizeof(Light) <= sizeof(BakedLight::data), "Light does not fit in a baked light");
+	static_assert(sizeof(D3D12_SAMPLER_DESC) <= sizeof(BakedSampler::data), "D3D12_SAMPLER_DESC does not fit in a baked sampler");
+
+	constexpr uint64_t BAKED_SECTION_ALIGNMENT = 16;
+
+	BakedBufferView BakeBufferView(const BufferView& view)
+	{
+		BakedBufferView bakedView;
+		bakedView.bufferId = view.bufferId;
+		bakedView.elemType = view.elemType;
+		bakedView.componentType = view.componentType;
+		bakedView.byteOffset = view.byteOffset;
+		bakedView.byteLength = view.byteLength;
+		bakedView.byteStride = view.byteStride;
+		bakedView.count = view.count;
+		return bakedView;
+	}
+
+	BakedMeshlet BakeMeshlet(const Meshlet& meshlet)
+	{
+		BakedMeshlet bakedMeshlet;
+		bakedMeshlet.firstIndex = meshlet.firstIndex;
+		bakedMeshlet.indicesCount = meshlet.indicesCount;
+		bakedMeshlet.verticesCount = meshlet.verticesCount;
+		std::copy(meshlet.center, meshlet.center + 3, bakedMeshlet.center);
+		bakedMeshlet.radius = meshlet.radius;
+		std::copy(meshlet.aabbMin, meshlet.aabbMin + 3, bakedMeshlet.aabbMin);
+		std::copy(meshlet.aabbMax, meshlet.aabbMax + 3, bakedMeshlet.aabbMax);
+		std::copy(meshlet.coneApex, meshlet.coneApex + 3, bakedMeshlet.coneApex);
+		std::copy(meshlet.coneAxis, meshlet.coneAxis + 3, bakedMeshlet.coneAxis);
+		bakedMeshlet.coneCutoff = meshlet.coneCutoff;
+		return bakedMeshlet;
+	}
+
+	template <class B, class T>
+	B BakeRecord(const uint32_t id, const T& value)
+	{
+		B record;
+		record.id = id;
+		record.byteSize = sizeof(T);
+		std::memcpy(record.data, &value, sizeof(T));
+		return record;
+	}
+}
+
+SceneBaker::SceneBaker(ComPtr<ID3D12Device> device, ComPtr<ID3D12CommandQueue> commandQueue)
+	: GLTFSceneLoader(device, commandQueue) {}
+
+void SceneBaker::Bake(const int sceneId, const std::string& fileName)
+{
+	m_file.open(fileName, std::ios::binary | std::ios::trunc);
+	if (!m_file) DXUtil::ThrowException("Cannot create " + fileName);
+	m_fileByteSize = 0;
+	m_bakedBuffers.clear();
+	m_bakedImages.clear();
+	m_bakedMipLevels.clear();
+
+	try
+	{
+		// The header is written last, when the sections are known
+		BakedSceneHeader header;
+		m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		m_fileByteSize = sizeof(header);
+
+		// Buffers and images are written by the AddScene* overrides while the scene is built
+		std::shared_ptr<Scene> scene;
+		GetScene(sceneId, scene);
+		if (m_bakedBuffers.size() != scene->m_buffersGPU.size()) DXUtil::ThrowException("Scene buffers were created outside of the baker");
+
+		std::vector<BakedNode> nodes;
+		uint32_t rootNodesCount = 0;
+		BakeNodes(scene.get(), nodes, rootNodesCount);
+
+		std::vector<BakedMesh> meshes;
+		std::vector<BakedSubMesh> subMeshes;
+		std::vector<BakedSubMeshLod> subMeshLods;
+		std::vector<BakedMeshlet> meshlets;
+		for (const auto& mesh : scene->m_meshes)
+		{
+			BakedMesh bakedMesh;
+			bakedMesh.meshId = mesh.first;
+			bakedMesh.firstSubMesh = static_cast<uint32_t>(subMeshes.size());
+			bakedMesh.subMeshesCount = static_cast<uint32_t>(mesh.second.GetSubMeshes().size());
+			meshes.push_back(bakedMesh);
+
+			for (const SubMesh& subMesh : mesh.second.GetSubMeshes())
+			{
+				BakedSubMesh bakedSubMesh;
+				bakedSubMesh.views[BAKED_VIEW_VERTICES] = BakeBufferView(subMesh.verticesBufferView);
+				bakedSubMesh.views[BAKED_VIEW_COLORS] = BakeBufferView(subMesh.colorsBufferView);
+				bakedSubMesh.views[BAKED_VIEW_NORMALS] = BakeBufferView(subMesh.normalsBufferView);
+				bakedSubMesh.views[BAKED_VIEW_TANGENTS] = BakeBufferView(subMesh.tangentsBufferView);
+				bakedSubMesh.views[BAKED_VIEW_TEXCOORD0] = BakeBufferView(subMesh.texCoord0BufferView);
+				bakedSubMesh.views[BAKED_VIEW_TEXCOORD1] = BakeBufferView(subMesh.texCoord1BufferView);
+				bakedSubMesh.views[BAKED_VIEW_INDICES] = BakeBufferView(subMesh.indicesBufferView);
+				bakedSubMesh.materialId = subMesh.materialId;
+				bakedSubMesh.topology = static_cast<uint32_t>(subMesh.topology);
+				bakedSubMesh.firstLod = static_cast<uint32_t>(subMeshLods.size());
+				bakedSubMesh.lodsCount = static_cast<uint32_t>(subMesh.lods.size());
+				bakedSubMesh.boundingSphere[0] = subMesh.boundingSphere.x;
+				bakedSubMesh.boundingSphere[1] = subMesh.boundingSphere.y;
+				bakedSubMesh.boundingSphere[2] = subMesh.boundingSphere.z;
+				bakedSubMesh.boundingSphere[3] = subMesh.boundingSphere.w;
+				std::memcpy(bakedSubMesh.boundsMin, subMesh.bounds.min, sizeof(subMesh.bounds.min));
+				std::memcpy(bakedSubMesh.boundsMax, subMesh.bounds.max, sizeof(subMesh.bounds.max));
+				bakedSubMesh.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+				bakedSubMesh.meshletsCount = static_cast<uint32_t>(subMesh.meshlets.size());
+				std::memcpy(bakedSubMesh.positionScale, subMesh.dequantization.positionScale, sizeof(bakedSubMesh.positionScale));
+				std::memcpy(bakedSubMesh.positionOffset, subMesh.dequantization.positionOffset, sizeof(bakedSubMesh.positionOffset));
+				std::memcpy(bakedSubMesh.texCoordTransforms, subMesh.dequantization.texCoordTransforms, sizeof(bakedSubMesh.texCoordTransforms));
+				bakedSubMesh.octahedralDirections = subMesh.dequantization.octahedralDirections;
+				subMeshes.push_back(bakedSubMesh);
+				for (const SubMeshLod& lod : subMesh.lods) subMeshLods.push_back({ BakeBufferView(lod.indicesBufferView), lod.error });
+				for (const Meshlet& meshlet : subMesh.meshlets) meshlets.push_back(BakeMeshlet(meshlet));
+			}
+		}
+
+		std::vector<BakedMaterial> materials;
+		for (const auto& material : scene->m_materials) materials.push_back(BakeRecord<BakedMaterial>(material.first, material.second));
+		std::vector<BakedLight> lights;
+		for (const auto& light : scene->m_lights) lights.push_back(BakeRecord<BakedLight>(light.first, light.second));
+		std::vector<BakedSampler> samplers;
+		for (const auto& sampler : scene->m_samplers) samplers.push_back(BakeRecord<BakedSampler>(sampler.first, sampler.second));
+
+		// Textures sharing an image share its GPU resource, as in GLTFSceneLoader::LoadTextures
+		std::vector<BakedTexture> textures;
+		for (size_t textureId = 0; textureId < m_model.textures.size(); textureId++)
+		{
+			textures.push_back({ static_cast<uint32_t>(textureId), static_cast<uint32_t>(m_model.textures[textureId].source) });
+		}
+
+		header.sections[BAKED_SECTION_NODES] = WriteSection(nodes);
+		header.sections[BAKED_SECTION_MESHES] = WriteSection(meshes);
+		header.sections[BAKED_SECTION_SUBMESHES] = WriteSection(subMeshes);
+		header.sections[BAKED_SECTION_SUBMESH_LODS] = WriteSection(subMeshLods);
+		header.sections[BAKED_SECTION_MESHLETS] = WriteSection(meshlets);
+		header.sections[BAKED_SECTION_MATERIALS] = WriteSection(materials);
+		header.sections[BAKED_SECTION_LIGHTS] = WriteSection(lights);
+		header.sections[BAKED_SECTION_SAMPLERS] = WriteSection(samplers);
+		header.sections[BAKED_SECTION_TEXTURES] = WriteSection(textures);
+		header.sections[BAKED_SECTION_IMAGES] = WriteSection(m_bakedImages);
+		header.sections[BAKED_SECTION_MIP_LEVELS] = WriteSection(m_bakedMipLevels);
+		header.sections[BAKED_SECTION_BUFFERS] = WriteSection(m_bakedBuffers);
+
+		std::memcpy(header.magic, BAKED_SCENE_MAGIC, sizeof(header.magic));
+		header.version = BAKED_SCENE_VERSION;
+		header.rootNodesCount = rootNodesCount;
+		header.fileByteSize = m_fileByteSize;
+		header.vertexSlotsMode = static_cast<uint32_t>(scene->m_vertexLayout.mode);
+		header.vertexFeatures = scene->m_vertexLayout.features;
+		header.quantizedPositions = scene->m_vertexLayout.quantization.positions ? 1 : 0;
+		header.quantizedDirections = scene->m_vertexLayout.quantization.directions ? 1 : 0;
+		header.texCoordsFormat = static_cast<uint32_t>(scene->m_vertexLayout.quantization.texCoords);
+		m_file.seekp(0);
+		m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		m_file.close();
+		if (m_file.fail()) DXUtil::ThrowException("Cannot write " + fileName);
+	}
+	catch (...)
+	{
+		// Never leave a partial file that could be loaded later
+		m_file.close();
+		std::error_code error;
+		std::filesystem::remove(fileName, error);
+		throw;
+	}
+}
+
+std::string SceneBaker::GetBakedFileName(const std::string& fileName)
+{
+	return std::filesystem::path(fileName).replace_extension(BAKED_SCENE_EXTENSION).string();
+}
+
+int SceneBaker::RunCommandLine(const std::vector<std::string>& args)
+{
+	DXUtil::AttachParentConsole();
+	std::vector<std::string> fileNames;
+	bool quantize = false;
+	for (size_t i = 1; i < args.size(); i++)
+	{
+		if (args[i] == "--quantize") quantize = true;
+		else fileNames.push_back(args[i]);
+	}
+	if (fileNames.empty() || fileNames.size() > 2)
+	{
+		std::cerr << "Usage: --bake input.gltf|input.glb [output" << BAKED_SCENE_EXTENSION << "] [--quantize]" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		std::string bakedFileName = (fileNames.size() > 1) ? fileNames[1] : GetBakedFileName(fileNames[0]);
+
+		ComPtr<ID3D12Device> device;
+		ComPtr<ID3D12CommandQueue> commandQueue;
+		DXUtil::CreateHeadlessDevice(device, commandQueue);
+
+		SceneBaker baker(device, commandQueue);
+		baker.SetMemoryMapping(true);
+		baker.SetTopologyNormalization(true);
+		baker.SetVertexWelding(true);
+		baker.SetMeshOptimization(true);
+		baker.SetLodGeneration(true);
+		baker.SetMeshletGeneration(true);
+		VertexQuantization quantization;
+		if (quantize) quantization = { true, true, VertexFormat::Half2 };
+		baker.SetVertexLayout(CreateVertexLayout(VERTEX_FEATURES_MESH, VertexSlotsMode::Interleaved, quantization));
+		baker.Load(fileNames[0]);
+		baker.Bake(0, bakedFileName);
+		std::cout << "Baked " << fileNames[0] << " to " << bakedFileName << " (" << baker.m_fileByteSize << " bytes)" << std::endl;
+
+		const TopologyReport& topologyReport = baker.GetTopologyReport();
+		if (topologyReport.primitivesCount > 0)
+		{
+			std::cout << topologyReport.primitivesCount << " primitives normalized, " << topologyReport.fansCount << " fans, " << topologyReport.loopsCount
+				<< " loops and " << topologyReport.stripsCount << " strips converted, " << topologyReport.degenerateTriangles << " degenerate and "
+				<< topologyReport.duplicateTriangles << " duplicate triangles removed, " << topologyReport.shortIndicesCount << " 16 bit indices" << std::endl;
+		}
+
+		const VertexWeldReport& weldReport = baker.GetVertexWeldReport();
+		if (weldReport.verticesCountBefore > 0)
+		{
+			std::cout << weldReport.verticesCountBefore << " vertices welded to " << weldReport.verticesCountAfter << std::endl;
+		}
+
+		const MeshOptimizationReport& report = baker.GetMeshOptimizationReport();
+		if (report.trianglesCount > 0)
+		{
+			std::cout << report.trianglesCount << " triangles optimized, ACMR " << report.before.acmr << " -> " << report.after.acmr
+				<< ", ATVR " << report.before.atvr << " -> " << report.after.atvr << std::endl;
+		}
+
+		const SimplificationReport& simplificationReport = baker.GetSimplificationReport();
+		if (simplificationReport.meshesCount > 0)
+		{
+			std::cout << simplificationReport.meshesCount << " submeshes simplified, " << simplificationReport.trianglesCount << " triangles ->";
+			for (size_t l = 0; l < simplificationReport.lodTrianglesCount.size(); l++)
+			{
+				std::cout << " " << simplificationReport.lodTrianglesCount[l] << " (error " << simplificationReport.lodRelativeError[l] << ")";
+			}
+			std::cout << std::endl;
+		}
+
+		const MeshletReport& meshletReport = baker.GetMeshletReport();
+		if (meshletReport.meshletsCount > 0)
+		{
+			std::cout << meshletReport.trianglesCount << " triangles split in " << meshletReport.meshletsCount << " meshlets, "
+				<< meshletReport.conesCount << " with a normal cone" << std::endl;
+		}
+
+		const VertexQuantizationReport& quantizationReport = baker.GetVertexQuantizationReport();
+		if (quantizationReport.verticesCount > 0)
+		{
+			std::cout << quantizationReport.verticesCount << " vertices quantized, " << quantizationReport.floatByteSize << " bytes -> "
+				<< quantizationReport.quantizedByteSize << " bytes" << std::endl;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int SceneBaker::AddSceneBuffer(Scene* scene, const uint8_t* data, const size_t byteSize)
+{
+	m_bakedBuffers.push_back({ WritePayload(data, byteSize) });
+	return GLTFSceneLoader::AddSceneBuffer(scene, data, byteSize);
+}
+
+int SceneBaker::AddSceneBuffer(Scene* scene, std::vector<uint8_t>&& data)
+{
+	m_bakedBuffers.push_back({ WritePayload(data.data(), data.size()) });
+	return GLTFSceneLoader::AddSceneBuffer(scene, std::move(data));
+}
+
+ComPtr<ID3D12Resource> SceneBaker::AddSceneImage(const DecodedTexture& decodedTexture)
+{
+	BakedImage image;
+	image.payload = WritePayload(decodedTexture.data.data(), decodedTexture.data.size());
+	image.width = decodedTexture.GetWidth();
+	image.height = decodedTexture.GetHeight();
+	image.firstMipLevel = static_cast<uint32_t>(m_bakedMipLevels.size());
+	image.mipLevelsCount = static_cast<uint32_t>(decodedTexture.mipLevels.size());
+	for (const MipLevel& mipLevel : decodedTexture.mipLevels) m_bakedMipLevels.push_back({ mipLevel.width, mipLevel.height, mipLevel.byteOffset });
+	m_bakedImages.push_back(image);
+
+	return GLTFSceneLoader::AddSceneImage(decodedTexture);
+}
+
+BakedPayload SceneBaker::WritePayload(const void* data, const size_t byteSize)
+{
+	WritePadding(BAKED_SCENE_PAYLOAD_ALIGNMENT);
+	BakedPayload payload = { m_fileByteSize, byteSize };
+	m_file.write(reinterpret_cast<const char*>(data), byteSize);
+	m_fileByteSize += byteSize;
+	return payload;
+}
+
+template <class T>
+BakedSectionDesc SceneBaker::WriteSection(const std::vector<T>& records)
+{
+	WritePadding(BAKED_SECTION_ALIGNMENT);
+	BakedSectionDesc section = { m_fileByteSize, records.size() };
+	m_file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T));
+	m_fileByteSize += records.size() * sizeof(T);
+	return section;
+}
+
+void SceneBaker::WritePadding(const uint64_t alignment)
+{
+	static const char zeros[BAKED_SCENE_PAYLOAD_ALIGNMENT] = {};
+	uint64_t paddedSize = UploadPlanner::AlignUp(m_fileByteSize, alignment);
+	m_file.write(zeros, paddedSize - m_fileByteSize);
+	m_fileByteSize = paddedSize;
+}
+
+void SceneBaker::BakeNodes(const Scene* scene, std::vector<BakedNode>& nodes, uint32_t& rootNodesCount) const
+{
+	// The scene nodes are already in the depth first order of the baked nodes, only the children are counted
+	rootNodesCount = 0;
+	nodes.resize(scene->m_nodes.size());
+	for (size_t nodeId = 0; nodeId < scene->m_nodes.size(); nodeId++)
+	{
+		const SceneNode& node = scene->m_nodes[nodeId];
+		nodes[nodeId].meshId = node.meshId;
+		std::memcpy(nodes[nodeId].transformMtx, scene->m_transforms.GetLocalMatrix(nodeId), sizeof(nodes[nodeId].transformMtx));
+		if (node.parentId == -1) rootNodesCount++;
+		else nodes[node.parentId].childrenCount++;
+	}
+}
\ No newline at end of file
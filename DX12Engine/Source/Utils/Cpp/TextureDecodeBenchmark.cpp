@@ -0,0 +1,109 @@
+#include "Benchmark.h"
+#include "TextureDecoder.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+	const std::vector<std::string> DEFAULT_IMAGE_PATHS = { "models/BoomBoxWithAxes", "models/textures" };
+	constexpr int TEXTURE_DECODE_REPETITIONS = 5;
+
+	/** Collect the .png and .jpg files in paths, directories are not recursed */
+	std::vector<std::string> FindImageFiles(const std::vector<std::string>& paths)
+	{
+		std::vector<std::string> fileNames;
+		for (const std::string& path : paths)
+		{
+			if (!std::filesystem::is_directory(path)) { fileNames.push_back(path); continue; }
+			for (const auto& entry : std::filesystem::directory_iterator(path))
+			{
+				std::string extension = entry.path().extension().string();
+				std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+				if (extension == ".png" || extension == ".jpg" || extension == ".jpeg") fileNames.push_back(entry.path().string());
+			}
+		}
+		std::sort(fileNames.begin(), fileNames.end());
+		return fileNames;
+	}
+}
+
+namespace Benchmark
+{
+	int RunTextureDecode(const std::vector<std::string>& args)
+	{
+		std::vector<std::string> fileNames = FindImageFiles(args.empty() ? DEFAULT_IMAGE_PATHS : args);
+		if (fileNames.empty()) { std::cerr << "No image found" << std::endl; return 1; }
+
+		// Read the files once, only decoding and mip generation are measured
+		std::vector<std::vector<uint8_t>> encodedData;
+		std::vector<EncodedImage> images;
+		for (const std::string& fileName : fileNames)
+		{
+			std::ifstream file(fileName, std::ios::binary);
+			encodedData.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		}
+		for (size_t i = 0; i < fileNames.size(); i++) images.push_back({ encodedData[i].data(), encodedData[i].size(), fileNames[i] });
+
+		std::vector<size_t> threadsCounts = { 1 };
+		size_t maxThreadsCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		for (size_t threads = 2; threads < maxThreadsCount; threads *= 2) threadsCounts.push_back(threads);
+		if (maxThreadsCount > 1) threadsCounts.push_back(maxThreadsCount);
+
+		std::cout << "[" << std::endl;
+		for (size_t t = 0; t < threadsCounts.size(); t++)
+		{
+			ThreadPool pool(threadsCounts[t] - 1);
+			std::vector<DecodedTexture> textures(images.size());
+			std::vector<double> seconds;
+			for (int r = 0; r < TEXTURE_DECODE_REPETITIONS; r++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				pool.ParallelFor(images.size(), [&](size_t i) { textures[i] = DecodeTexture(images[i]); });
+				seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			}
+			std::sort(seconds.begin(), seconds.end());
+			double medianSeconds = seconds[seconds.size() / 2];
+
+			// Throughput counts the pixels of the full resolution images, the mip chain is part of the work
+			double megaPixels = 0.0, mipMegaBytes = 0.0;
+			for (const DecodedTexture& texture : textures)
+			{
+				megaPixels += static_cast<double>(texture.GetWidth()) * texture.GetHeight() / 1e6;
+				mipMegaBytes += texture.data.size() / (1024.0 * 1024.0);
+			}
+
+			std::cout << std::fixed << std::setprecision(3)
+				<< "  { \"threads\": " << threadsCounts[t] << ", \"images\": " << images.size() << ", \"megaPixels\": " << megaPixels
+				<< ", \"decodedMB\": " << mipMegaBytes << ", \"medianMs\": " << medianSeconds * 1000.0
+				<< ", \"megaPixelsPerSecond\": " << megaPixels / medianSeconds << " }" << (t == threadsCounts.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "]" << std::endl;
+		return 0;
+	}
+}
+
+#ifdef TEXTURE_DECODE_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+#define STB_IMAGE_IMPLEMENTATION
+#include "glTF/stb_image.h"
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunTextureDecode({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
@@ -0,0 +1,89 @@
+#include "TextureDecoder.h"
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+#include "glTF/stb_image.h"
+
+uint32_t DecodedTexture::GetWidth() const
+{
+	return mipLevels.empty() ? 0 : mipLevels[0].width;
+}
+
+uint32_t DecodedTexture::GetHeight() const
+{
+	return mipLevels.empty() ? 0 : mipLevels[0].height;
+}
+
+size_t DecodedTexture::GetRowPitch(const size_t mipLevel) const
+{
+	return static_cast<size_t>(mipLevels[mipLevel].width) * BYTES_PER_PIXEL;
+}
+
+const uint8_t* DecodedTexture::GetMipData(const size_t mipLevel) const
+{
+	return data.data() + mipLevels[mipLevel].byteOffset;
+}
+
+DecodedTexture DecodeTexture(const EncodedImage& image)
+{
+	int width = 0, height = 0, components = 0;
+	stbi_uc* pixels = nullptr;
+	if (image.data != nullptr)
+	{
+		if (image.size > INT_MAX) throw std::runtime_error("Encoded image too large");
+		pixels = stbi_load_from_memory(image.data, static_cast<int>(image.size), &width, &height, &components, DecodedTexture::BYTES_PER_PIXEL);
+	}
+	else pixels = stbi_load(image.fileName.c_str(), &width, &height, &components, DecodedTexture::BYTES_PER_PIXEL);
+	if (pixels == nullptr) throw std::runtime_error(std::string("Cannot decode image ") + image.fileName + ": " + stbi_failure_reason());
+
+	// The whole mip chain lives in one allocation, the first level is the decoded image
+	DecodedTexture texture;
+	size_t byteSize = 0;
+	uint32_t mipWidth = static_cast<uint32_t>(width), mipHeight = static_cast<uint32_t>(height);
+	for (;;)
+	{
+		texture.mipLevels.push_back({ mipWidth, mipHeight, byteSize });
+		byteSize += static_cast<size_t>(mipWidth) * mipHeight * DecodedTexture::BYTES_PER_PIXEL;
+		if (mipWidth == 1 && mipHeight == 1) break;
+		mipWidth = std::max(1u, mipWidth / 2);
+		mipHeight = std::max(1u, mipHeight / 2);
+	}
+
+	texture.data.resize(byteSize);
+	std::copy(pixels, pixels + static_cast<size_t>(width) * height * DecodedTexture::BYTES_PER_PIXEL, texture.data.begin());
+	stbi_image_free(pixels);
+
+	GenerateMipChain(texture);
+	return texture;
+}
+
+void GenerateMipChain(DecodedTexture& texture)
+{
+	for (size_t level = 1; level < texture.mipLevels.size(); level++)
+	{
+		const MipLevel& srcLevel = texture.mipLevels[level - 1];
+		const MipLevel& dstLevel = texture.mipLevels[level];
+		const uint8_t* src = texture.data.data() + srcLevel.byteOffset;
+		uint8_t* dst = texture.data.data() + dstLevel.byteOffset;
+		size_t srcRowPitch = static_cast<size_t>(srcLevel.width) * DecodedTexture::BYTES_PER_PIXEL;
+
+		for (uint32_t y = 0; y < dstLevel.height; y++)
+		{
+			// On odd sizes the last row and column are reused
+			const uint8_t* srcRow0 = src + std::min(2 * y, srcLevel.height - 1) * srcRowPitch;
+			const uint8_t* srcRow1 = src + std::min(2 * y + 1, srcLevel.height - 1) * srcRowPitch;
+			for (uint32_t x = 0; x < dstLevel.width; x++)
+			{
+				size_t x0 = static_cast<size_t>(std::min(2 * x, srcLevel.width - 1)) * DecodedTexture::BYTES_PER_PIXEL;
+				size_t x1 = static_cast<size_t>(std::min(2 * x + 1, srcLevel.width - 1)) * DecodedTexture::BYTES_PER_PIXEL;
+				for (uint32_t c = 0; c < DecodedTexture::BYTES_PER_PIXEL; c++)
+				{
+					unsigned int sum = srcRow0[x0 + c] + srcRow0[x1 + c] + srcRow1[x0 + c] + srcRow1[x1 + c];
+					*dst++ = static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+	}
+}
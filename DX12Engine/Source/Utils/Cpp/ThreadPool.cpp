@@ -0,0 +1,107 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+ThreadPool::ThreadPool(const size_t workersCount)
+{
+	for (size_t i = 0; i < workersCount; i++) m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isStopping = true;
+	}
+	m_taskAvailable.notify_all();
+	for (std::thread& worker : m_workers) worker.join();
+}
+
+void ThreadPool::ParallelFor(const size_t count, const std::function<void(size_t)>& fn)
+{
+	if (count == 0) return;
+
+	// The loop state is shared with the helper tasks, which may start after the loop is over and must find it alive
+	struct LoopState
+	{
+		std::atomic<size_t> next{ 0 };
+		std::atomic<size_t> done{ 0 };
+		size_t count = 0;
+		std::function<void(size_t)> fn;
+		std::exception_ptr error;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+	auto state = std::make_shared<LoopState>();
+	state->count = count;
+	state->fn = fn;
+
+	auto work = [state]()
+	{
+		for (size_t i = state->next++; i < state->count; i = state->next++)
+		{
+			try { state->fn(i); }
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				if (!state->error) state->error = std::current_exception();
+			}
+
+			if (++state->done == state->count)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->finished.notify_all();
+			}
+		}
+	};
+
+	size_t helpersCount = std::min(m_workers.size(), count - 1);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < helpersCount; i++) m_tasks.push(work);
+	}
+	if (helpersCount == 1) m_taskAvailable.notify_one();
+	else if (helpersCount > 1) m_taskAvailable.notify_all();
+
+	work();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state]() { return state->done == state->count; });
+	if (state->error) std::rethrow_exception(state->error);
+}
+
+size_t ThreadPool::GetThreadsCount() const
+{
+	return m_workers.size() + 1;
+}
+
+ThreadPool& ThreadPool::GetDefault()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+size_t ThreadPool::GetDefaultWorkersCount()
+{
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taskAvailable.wait(lock, [this]() { return m_isStopping || !m_tasks.empty(); });
+			if (m_isStopping && m_tasks.empty()) return;
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+		}
+		task();
+	}
+}
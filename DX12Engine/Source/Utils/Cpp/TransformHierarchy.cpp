@@ -0,0 +1,231 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TRANSFORM_HIERARCHY_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const float IDENTITY[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+}
+
+void ComposeMatrix(const LocalTransform& transform, float matrix[16])
+{
+	// The rows of the rotation, as DirectXMath XMMatrixRotationQuaternion, each scaled by its axis scale
+	const float x = transform.rotation[0], y = transform.rotation[1], z = transform.rotation[2], w = transform.rotation[3];
+	const float rotation[3][3] = {
+		{ 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w) },
+		{ 2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w) },
+		{ 2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y) } };
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++) matrix[4 * i + j] = transform.scale[i] * rotation[i][j];
+		matrix[4 * i + 3] = 0.0f;
+	}
+	for (int j = 0; j < 3; j++) matrix[12 + j] = transform.translation[j];
+	matrix[15] = 1.0f;
+}
+
+void MultiplyMatrices(const float a[16], const float b[16], float result[16])
+{
+#ifdef TRANSFORM_HIERARCHY_SSE2
+	// Each row of the result is the rows of b weighted by the coefficients of the row of a
+	const __m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + 4), b2 = _mm_loadu_ps(b + 8), b3 = _mm_loadu_ps(b + 12);
+	for (int i = 0; i < 4; i++)
+	{
+		const float* row = a + 4 * i;
+		__m128 r = _mm_mul_ps(_mm_set1_ps(row[0]), b0);
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(row[1]), b1));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(row[2]), b2));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(row[3]), b3));
+		_mm_storeu_ps(result + 4 * i, r);
+	}
+#else
+	for (int i = 0; i < 4; i++)
+	{
+		const float* row = a + 4 * i;
+		for (int j = 0; j < 4; j++) result[4 * i + j] = row[0] * b[j] + row[1] * b[4 + j] + row[2] * b[8 + j] + row[3] * b[12 + j];
+	}
+#endif
+}
+
+bool DecomposeMatrix(const float matrix[16], LocalTransform& transform)
+{
+	transform = LocalTransform();
+	for (int j = 0; j < 3; j++) transform.translation[j] = matrix[12 + j];
+
+	// The scales are the lengths of the rows, a mirror flips the x row so that the rest is a rotation
+	float rows[3][3];
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++) rows[i][j] = matrix[4 * i + j];
+		transform.scale[i] = std::sqrt(rows[i][0] * rows[i][0] + rows[i][1] * rows[i][1] + rows[i][2] * rows[i][2]);
+	}
+	float determinant = rows[0][0] * (rows[1][1] * rows[2][2] - rows[1][2] * rows[2][1]) - rows[0][1] * (rows[1][0] * rows[2][2] - rows[1][2] * rows[2][0])
+		+ rows[0][2] * (rows[1][0] * rows[2][1] - rows[1][1] * rows[2][0]);
+	if (determinant < 0.0f) transform.scale[0] = -transform.scale[0];
+	if (transform.scale[0] == 0.0f || transform.scale[1] == 0.0f || transform.scale[2] == 0.0f) return false;
+	for (int i = 0; i < 3; i++) for (int j = 0; j < 3; j++) rows[i][j] /= transform.scale[i];
+
+	// The quaternion of the rotation rows, from the largest of w, x, y and z to stay accurate
+	float* q = transform.rotation;
+	float trace = rows[0][0] + rows[1][1] + rows[2][2];
+	if (trace > 0.0f)
+	{
+		float s = 2.0f * std::sqrt(1.0f + trace);
+		q[3] = 0.25f * s;
+		q[0] = (rows[1][2] - rows[2][1]) / s;
+		q[1] = (rows[2][0] - rows[0][2]) / s;
+		q[2] = (rows[0][1] - rows[1][0]) / s;
+	}
+	else if (rows[0][0] >= rows[1][1] && rows[0][0] >= rows[2][2])
+	{
+		float s = 2.0f * std::sqrt((std::max)(1.0f + rows[0][0] - rows[1][1] - rows[2][2], 0.0f));
+		q[0] = 0.25f * s;
+		q[3] = (rows[1][2] - rows[2][1]) / s;
+		q[1] = (rows[0][1] + rows[1][0]) / s;
+		q[2] = (rows[0][2] + rows[2][0]) / s;
+	}
+	else if (rows[1][1] >= rows[2][2])
+	{
+		float s = 2.0f * std::sqrt((std::max)(1.0f + rows[1][1] - rows[0][0] - rows[2][2], 0.0f));
+		q[1] = 0.25f * s;
+		q[3] = (rows[2][0] - rows[0][2]) / s;
+		q[0] = (rows[0][1] + rows[1][0]) / s;
+		q[2] = (rows[1][2] + rows[2][1]) / s;
+	}
+	else
+	{
+		float s = 2.0f * std::sqrt((std::max)(1.0f + rows[2][2] - rows[0][0] - rows[1][1], 0.0f));
+		q[2] = 0.25f * s;
+		q[3] = (rows[0][1] - rows[1][0]) / s;
+		q[0] = (rows[0][2] + rows[2][0]) / s;
+		q[1] = (rows[1][2] + rows[2][1]) / s;
+	}
+	float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	for (int k = 0; k < 4; k++) q[k] /= length;
+
+	// Exact if composing it back gives the matrix, up to the float rounding of the scales
+	float composed[16];
+	ComposeMatrix(transform, composed);
+	float largest = 0.0f;
+	for (int k = 0; k < 16; k++) largest = (std::max)(largest, std::fabs(matrix[k]));
+	for (int k = 0; k < 16; k++)
+	{
+		if (std::fabs(composed[k] - matrix[k]) > 1e-5f * largest) return false;
+	}
+	return true;
+}
+
+size_t TransformHierarchy::AddNode(const int parentId, const LocalTransform& transform)
+{
+	size_t nodeId = m_parents.size();
+	if (parentId < -1 || (parentId >= 0 && static_cast<size_t>(parentId) >= nodeId)) throw std::invalid_argument("Transform hierarchy parent is not an earlier node");
+	if (nodeId > UINT32_MAX) throw std::invalid_argument("Too many transform hierarchy nodes");
+
+	m_parents.push_back(parentId);
+	m_translations.emplace_back();
+	m_rotations.emplace_back();
+	m_scales.emplace_back();
+	m_localMatrices.emplace_back();
+	m_worldMatrices.emplace_back();
+	std::memcpy(m_worldMatrices.back().data(), IDENTITY, sizeof(IDENTITY));
+	m_dirtyFlags.push_back(0);
+	SetLocalTransform(nodeId, transform);
+	return nodeId;
+}
+
+void TransformHierarchy::Reserve(const size_t nodesCount)
+{
+	m_parents.reserve(nodesCount);
+	m_translations.reserve(nodesCount);
+	m_rotations.reserve(nodesCount);
+	m_scales.reserve(nodesCount);
+	m_localMatrices.reserve(nodesCount);
+	m_worldMatrices.reserve(nodesCount);
+	m_dirtyFlags.reserve(nodesCount);
+}
+
+void TransformHierarchy::Clear()
+{
+	m_parents.clear();
+	m_translations.clear();
+	m_rotations.clear();
+	m_scales.clear();
+	m_localMatrices.clear();
+	m_worldMatrices.clear();
+	m_dirtyFlags.clear();
+	m_updatedNodes.clear();
+	m_firstDirtyNode = SIZE_MAX;
+	m_isRootDirty = false;
+}
+
+void TransformHierarchy::SetLocalTransform(const size_t nodeId, const LocalTransform& transform)
+{
+	std::copy(transform.translation, transform.translation + 3, m_translations[nodeId].begin());
+	std::copy(transform.rotation, transform.rotation + 4, m_rotations[nodeId].begin());
+	std::copy(transform.scale, transform.scale + 3, m_scales[nodeId].begin());
+	ComposeMatrix(transform, m_localMatrices[nodeId].data());
+	MarkDirty(nodeId);
+}
+
+void TransformHierarchy::SetLocalMatrix(const size_t nodeId, const float matrix[16])
+{
+	LocalTransform transform;
+	DecomposeMatrix(matrix, transform);
+	std::copy(transform.translation, transform.translation + 3, m_translations[nodeId].begin());
+	std::copy(transform.rotation, transform.rotation + 4, m_rotations[nodeId].begin());
+	std::copy(transform.scale, transform.scale + 3, m_scales[nodeId].begin());
+	std::memcpy(m_localMatrices[nodeId].data(), matrix, sizeof(float) * 16);
+	MarkDirty(nodeId);
+}
+
+void TransformHierarchy::SetRootTransform(const float matrix[16])
+{
+	if (std::memcmp(m_rootTransform.data(), matrix, sizeof(float) * 16) == 0) return;
+	std::memcpy(m_rootTransform.data(), matrix, sizeof(float) * 16);
+	m_isRootDirty = true;
+}
+
+LocalTransform TransformHierarchy::GetLocalTransform(const size_t nodeId) const
+{
+	LocalTransform transform;
+	std::copy(m_translations[nodeId].begin(), m_translations[nodeId].end(), transform.translation);
+	std::copy(m_rotations[nodeId].begin(), m_rotations[nodeId].end(), transform.rotation);
+	std::copy(m_scales[nodeId].begin(), m_scales[nodeId].end(), transform.scale);
+	return transform;
+}
+
+void TransformHierarchy::MarkDirty(const size_t nodeId)
+{
+	m_dirtyFlags[nodeId] = 1;
+	m_firstDirtyNode = (std::min)(m_firstDirtyNode, nodeId);
+}
+
+size_t TransformHierarchy::Update()
+{
+	m_updatedNodes.clear();
+	if (!IsDirty()) return 0;
+
+	// A node is recomputed if it was edited or if its parent was recomputed earlier in the pass, its flag then passes it on to its children
+	const size_t nodesCount = m_parents.size();
+	for (size_t i = m_isRootDirty ? 0 : m_firstDirtyNode; i < nodesCount; i++)
+	{
+		const int parentId = m_parents[i];
+		if (!m_dirtyFlags[i] && !(parentId < 0 ? m_isRootDirty : m_dirtyFlags[parentId])) continue;
+		m_dirtyFlags[i] = 1;
+		MultiplyMatrices(m_localMatrices[i].data(), (parentId < 0) ? m_rootTransform.data() : m_worldMatrices[parentId].data(), m_worldMatrices[i].data());
+		m_updatedNodes.push_back(static_cast<uint32_t>(i));
+	}
+
+	for (uint32_t nodeId : m_updatedNodes) m_dirtyFlags[nodeId] = 0;
+	m_firstDirtyNode = SIZE_MAX;
+	m_isRootDirty = false;
+	return m_updatedNodes.size();
+}
@@ -0,0 +1,344 @@
+#include "Benchmark.h"
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const std::vector<size_t> DEFAULT_TRANSFORM_NODES = { 1000, 10000, 100000, 1000000 };
+	constexpr int TRANSFORM_CASES = 256;		// Random transformations composed and decomposed
+	constexpr int TRANSFORM_EDIT_ROUNDS = 64;	// Rounds of random edits checked against a full recomputation
+	constexpr int TRANSFORM_REPETITIONS = 5;
+	constexpr double TRANSFORM_EDITED_FRACTION = 0.01;	// Nodes edited before the timed partial updates
+
+	using Matrix = std::array<float, 16>;
+
+	/** Scalar reference product, row major and applied to row vectors as DirectXMath does: the result applies a then b */
+	Matrix Multiply(const Matrix& a, const Matrix& b)
+	{
+		Matrix m = {};
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				for (int k = 0; k < 4; k++) m[4 * i + j] += a[4 * i + k] * b[4 * k + j];
+			}
+		}
+		return m;
+	}
+
+	/** A random translation, unit rotation and scale of 0.1 to 10 on each axis, sometimes mirrored */
+	LocalTransform CreateRandomTransform(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> logScale(-1.0f, 1.0f);
+		LocalTransform transform;
+		float length = 0.0f;
+		for (float& c : transform.rotation) { c = unit(random); length += c * c; }
+		length = std::sqrt(length);
+		for (float& c : transform.rotation) c = (length > 0.0f) ? c / length : 0.5f;
+		for (int k = 0; k < 3; k++)
+		{
+			transform.translation[k] = 10.0f * unit(random);
+			transform.scale[k] = std::pow(10.0f, logScale(random)) * ((random() % 8 == 0) ? -1.0f : 1.0f);
+		}
+		return transform;
+	}
+
+	/** The reference composition: the scale, rotation and translation matrices multiplied */
+	Matrix ComposeReference(const LocalTransform& transform)
+	{
+		float x = transform.rotation[0], y = transform.rotation[1], z = transform.rotation[2], w = transform.rotation[3];
+		Matrix rotation = { 1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w), 0,
+			2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w), 0,
+			2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y), 0,
+			0, 0, 0, 1 };
+		Matrix scale = { transform.scale[0], 0, 0, 0, 0, transform.scale[1], 0, 0, 0, 0, transform.scale[2], 0, 0, 0, 0, 1 };
+		Matrix translation = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, transform.translation[0], transform.translation[1], transform.translation[2], 1 };
+		return Multiply(Multiply(scale, rotation), translation);
+	}
+
+	bool IsNearMatrix(const float* a, const float* b, const float tolerance)
+	{
+		float largest = 1.0f;
+		for (int k = 0; k < 16; k++) largest = (std::max)({ largest, std::fabs(a[k]), std::fabs(b[k]) });
+		for (int k = 0; k < 16; k++)
+		{
+			if (std::fabs(a[k] - b[k]) > tolerance * largest) return false;
+		}
+		return true;
+	}
+
+	/** A node of the pointer tree Scene used to walk: the local matrix and the children owned by their parent */
+	struct TreeNode
+	{
+		Matrix transformMtx;
+		size_t nodeId = 0;
+		std::vector<std::unique_ptr<TreeNode>> children;
+	};
+
+	/** The world matrices of a subtree, the parent matrix passed by value down the recursion as Scene::SetupNode did */
+	void WalkTree(const TreeNode* node, Matrix parentMtx, float* worldMatrices)
+	{
+		Matrix M;
+		MultiplyMatrices(node->transformMtx.data(), parentMtx.data(), M.data());
+		std::memcpy(worldMatrices + 16 * node->nodeId, M.data(), sizeof(M));
+		for (const std::unique_ptr<TreeNode>& child : node->children) WalkTree(child.get(), M, worldMatrices);
+	}
+
+	/** A random forest: each node hangs under a random earlier node, or is a root one time out of 64 */
+	std::vector<int> CreateRandomParents(const size_t nodesCount, std::mt19937& random)
+	{
+		std::vector<int> parents(nodesCount, -1);
+		for (size_t n = 1; n < nodesCount; n++) parents[n] = (random() % 64 == 0) ? -1 : static_cast<int>(random() % n);
+		return parents;
+	}
+
+	/** Compose random transformations with ComposeMatrix and the reference, then decompose them and sheared matrices back */
+	bool CheckCases()
+	{
+		bool isComposeMatch = true, isDecomposeMatch = true, isShearMatch = true;
+		std::mt19937 random(37);
+		for (int c = 0; c < TRANSFORM_CASES; c++)
+		{
+			LocalTransform transform = CreateRandomTransform(random);
+			Matrix m, reference = ComposeReference(transform);
+			ComposeMatrix(transform, m.data());
+			isComposeMatch &= IsNearMatrix(m.data(), reference.data(), 1e-6f);
+
+			// A decomposition may differ, a mirror on another axis or an opposite quaternion, but must compose back to the same matrix
+			LocalTransform decomposed;
+			Matrix recomposed;
+			isDecomposeMatch &= DecomposeMatrix(m.data(), decomposed);
+			ComposeMatrix(decomposed, recomposed.data());
+			isDecomposeMatch &= IsNearMatrix(m.data(), recomposed.data(), 1e-5f);
+
+			// A non uniform scale under a rotation shears
+			Matrix child;
+			LocalTransform stretch;
+			stretch.scale[0] = 4.0f;
+			ComposeMatrix(stretch, child.data());
+			Matrix sheared = Multiply(ComposeReference(transform), child);
+			isShearMatch &= !DecomposeMatrix(sheared.data(), decomposed) || IsNearMatrix(sheared.data(), ComposeReference(decomposed).data(), 1e-5f);
+		}
+		LocalTransform decomposed;
+		Matrix singular = {};
+		singular[15] = 1.0f;
+		isDecomposeMatch &= !DecomposeMatrix(singular.data(), decomposed);
+
+		std::cout << "  \"cases\": { \"transforms\": " << TRANSFORM_CASES << ", \"compose\": " << (isComposeMatch ? "true" : "false")
+			<< ", \"decompose\": " << (isDecomposeMatch ? "true" : "false") << ", \"shear\": " << (isShearMatch ? "true" : "false") << " }," << std::endl;
+		return isComposeMatch && isDecomposeMatch && isShearMatch;
+	}
+
+	/**
+	 * Edit random nodes, sometimes with sheared local matrices, and the root transform, then check that Update recomputes exactly the edited
+	 * nodes and their descendants, to the world matrices of a full recomputation from scratch
+	 */
+	bool CheckEdits()
+	{
+		bool isMatch = true;
+		std::mt19937 random(41);
+		const size_t nodesCount = 2000;
+		std::vector<int> parents = CreateRandomParents(nodesCount, random);
+		TransformHierarchy hierarchy;
+		std::vector<Matrix> locals(nodesCount);
+		for (size_t n = 0; n < nodesCount; n++)
+		{
+			LocalTransform transform = CreateRandomTransform(random);
+			hierarchy.AddNode(parents[n], transform);
+			ComposeMatrix(transform, locals[n].data());
+		}
+		Matrix root;
+		ComposeMatrix(LocalTransform(), root.data());
+		isMatch &= hierarchy.Update() == nodesCount && hierarchy.Update() == 0;
+		hierarchy.SetRootTransform(root.data());
+		isMatch &= !hierarchy.IsDirty();
+
+		size_t updatedCount = 0;
+		for (int r = 0; r < TRANSFORM_EDIT_ROUNDS; r++)
+		{
+			std::vector<uint8_t> isEdited(nodesCount, 0);
+			bool isRootEdited = (r % 8 == 7);
+			if (isRootEdited)
+			{
+				ComposeMatrix(CreateRandomTransform(random), root.data());
+				hierarchy.SetRootTransform(root.data());
+			}
+			for (size_t e = random() % 8; e > 0; e--)
+			{
+				size_t n = random() % nodesCount;
+				isEdited[n] = 1;
+				if (random() % 4 == 0)
+				{
+					Matrix child;
+					ComposeMatrix(CreateRandomTransform(random), child.data());
+					locals[n] = Multiply(ComposeReference(CreateRandomTransform(random)), child);
+					hierarchy.SetLocalMatrix(n, locals[n].data());
+					isMatch &= std::memcmp(hierarchy.GetLocalMatrix(n), locals[n].data(), sizeof(Matrix)) == 0;
+				}
+				else
+				{
+					LocalTransform transform = CreateRandomTransform(random);
+					hierarchy.SetLocalTransform(n, transform);
+					ComposeMatrix(transform, locals[n].data());
+				}
+			}
+
+			std::vector<uint32_t> expectedNodes;
+			std::vector<Matrix> worlds(nodesCount);
+			for (size_t n = 0; n < nodesCount; n++)
+			{
+				if (parents[n] < 0 ? isRootEdited : isEdited[parents[n]] != 0) isEdited[n] = 1;
+				if (isEdited[n] || isRootEdited) expectedNodes.push_back(static_cast<uint32_t>(n));
+				MultiplyMatrices(locals[n].data(), (parents[n] < 0) ? root.data() : worlds[parents[n]].data(), worlds[n].data());
+			}
+			updatedCount += hierarchy.Update();
+			isMatch &= hierarchy.GetUpdatedNodes() == expectedNodes;
+			for (size_t n = 0; n < nodesCount; n++) isMatch &= std::memcmp(hierarchy.GetWorldMatrix(n), worlds[n].data(), sizeof(Matrix)) == 0;
+		}
+
+		std::cout << "  \"edits\": { \"nodes\": " << nodesCount << ", \"rounds\": " << TRANSFORM_EDIT_ROUNDS << ", \"updatedNodes\": " << updatedCount
+			<< ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+
+	double Median(std::vector<double> ms)
+	{
+		std::sort(ms.begin(), ms.end());
+		return ms[ms.size() / 2];
+	}
+
+	/**
+	 * Place random forests of each size with the pointer tree recursion and with TransformHierarchy: a full update after a root change, an
+	 * update after editing a few nodes and an update with nothing edited. The world matrices of both must be identical
+	 */
+	bool CheckScaling(const std::vector<size_t>& nodesCounts)
+	{
+		bool isMatch = true;
+		std::mt19937 random(43);
+		std::cout << "  \"scaling\": [" << std::endl;
+		for (size_t c = 0; c < nodesCounts.size(); c++)
+		{
+			const size_t nodesCount = nodesCounts[c];
+			std::vector<int> parents = CreateRandomParents(nodesCount, random);
+			TransformHierarchy hierarchy;
+			hierarchy.Reserve(nodesCount);
+			std::vector<TreeNode*> treeNodes(nodesCount);
+			std::vector<std::shared_ptr<TreeNode>> tree;
+			for (size_t n = 0; n < nodesCount; n++)
+			{
+				LocalTransform transform = CreateRandomTransform(random);
+				hierarchy.AddNode(parents[n], transform);
+				std::unique_ptr<TreeNode> node = std::make_unique<TreeNode>();
+				ComposeMatrix(transform, node->transformMtx.data());
+				node->nodeId = n;
+				treeNodes[n] = node.get();
+				if (parents[n] >= 0) treeNodes[parents[n]]->children.push_back(std::move(node));
+				else tree.push_back(std::move(node));
+			}
+			hierarchy.Update();
+
+			std::vector<float> treeWorlds(16 * nodesCount);
+			std::vector<double> recursiveMs, fullMs, editMs, cleanMs;
+			size_t editedUpdatedCount = 0;
+			for (int r = 0; r < TRANSFORM_REPETITIONS; r++)
+			{
+				Matrix root;
+				ComposeMatrix(CreateRandomTransform(random), root.data());
+				auto start = std::chrono::steady_clock::now();
+				for (const std::shared_ptr<TreeNode>& node : tree) WalkTree(node.get(), root, treeWorlds.data());
+				recursiveMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+				start = std::chrono::steady_clock::now();
+				hierarchy.SetRootTransform(root.data());
+				hierarchy.Update();
+				fullMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+				for (size_t n = 0; n < nodesCount; n++) isMatch &= std::memcmp(hierarchy.GetWorldMatrix(n), treeWorlds.data() + 16 * n, sizeof(Matrix)) == 0;
+
+				// Edits are spread over the forest: most of them move small subtrees near the leaves
+				std::vector<size_t> edited((std::max)(size_t(1), static_cast<size_t>(nodesCount * TRANSFORM_EDITED_FRACTION)));
+				std::vector<LocalTransform> transforms(edited.size());
+				for (size_t e = 0; e < edited.size(); e++)
+				{
+					edited[e] = random() % nodesCount;
+					transforms[e] = CreateRandomTransform(random);
+				}
+				start = std::chrono::steady_clock::now();
+				for (size_t e = 0; e < edited.size(); e++) hierarchy.SetLocalTransform(edited[e], transforms[e]);
+				editedUpdatedCount = hierarchy.Update();
+				editMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+				start = std::chrono::steady_clock::now();
+				hierarchy.SetRootTransform(root.data());
+				isMatch &= hierarchy.Update() == 0;
+				cleanMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+				for (size_t e = 0; e < edited.size(); e++) ComposeMatrix(transforms[e], treeNodes[edited[e]]->transformMtx.data());
+			}
+
+			// The last edits, the earlier ones are checked by the next full update
+			Matrix root;
+			std::memcpy(root.data(), hierarchy.GetRootTransform(), sizeof(root));
+			for (const std::shared_ptr<TreeNode>& node : tree) WalkTree(node.get(), root, treeWorlds.data());
+			for (size_t n = 0; n < nodesCount; n++) isMatch &= std::memcmp(hierarchy.GetWorldMatrix(n), treeWorlds.data() + 16 * n, sizeof(Matrix)) == 0;
+
+			double recursive = Median(recursiveMs), full = Median(fullMs), edit = Median(editMs), clean = Median(cleanMs);
+			std::cout << std::fixed << std::setprecision(3)
+				<< "    { \"nodes\": " << nodesCount << ", \"roots\": " << tree.size() << ", \"recursiveMs\": " << recursive << ", \"fullUpdateMs\": " << full
+				<< ", \"fullSpeedup\": " << recursive / (std::max)(full, 1e-6) << ", \"editedNodes\": " << (std::max)(size_t(1), static_cast<size_t>(nodesCount * TRANSFORM_EDITED_FRACTION))
+				<< ", \"editUpdatedNodes\": " << editedUpdatedCount << ", \"editUpdateMs\": " << edit << ", \"editSpeedup\": " << recursive / (std::max)(edit, 1e-6)
+				<< ", \"cleanUpdateMs\": " << clean << ", \"match\": " << (isMatch ? "true" : "false") << " }" << (c == nodesCounts.size() - 1 ? "" : ",") << std::endl;
+		}
+		std::cout << "  ]" << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunTransformHierarchy(const std::vector<std::string>& args)
+	{
+		std::vector<size_t> nodesCounts;
+		for (const std::string& arg : args)
+		{
+			if (arg.empty() || !std::all_of(arg.begin(), arg.end(), ::isdigit)) throw std::invalid_argument("Expected a nodes count: " + arg);
+			nodesCounts.push_back(std::stoul(arg));
+		}
+		if (nodesCounts.empty()) nodesCounts = DEFAULT_TRANSFORM_NODES;
+
+		std::cout << "{" << std::endl;
+		bool isMatch = CheckCases();
+		isMatch &= CheckEdits();
+		isMatch &= CheckScaling(nodesCounts);
+		std::cout << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef TRANSFORM_HIERARCHY_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunTransformHierarchy({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
@@ -0,0 +1,154 @@
+#include "Benchmark.h"
+#include "UploadPlanner.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const std::vector<size_t> DEFAULT_UPLOAD_REQUESTS = { 10000 };
+	const std::vector<uint64_t> UPLOAD_STAGING_BUDGETS_MB = { 16, 64, 256 };
+	constexpr int UPLOAD_PLAN_REPETITIONS = 11;
+	constexpr uint64_t CASES_STAGING_BUDGET = 1024;
+	constexpr size_t CASES_ALIGNED_REQUESTS = 1000;
+
+	/** Return true if calling function throws std::invalid_argument */
+	template<typename Function>
+	bool IsRefused(Function function)
+	{
+		try
+		{
+			function();
+		}
+		catch (const std::invalid_argument&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	 * Hand built plans: a request larger than the budget between two small ones gets a batch of its own, random sizes with every
+	 * power of two alignment are placed at multiples of their alignment, and a zero budget or alignment not a power of two is refused
+	 */
+	bool CheckCases()
+	{
+		UploadPlanner planner(CASES_STAGING_BUDGET);
+		planner.Add(100, 16);
+		size_t oversizeId = planner.Add(4 * CASES_STAGING_BUDGET, 256);
+		planner.Add(100, 16);
+		planner.Plan();
+		const std::vector<UploadBatchPlan>& batches = planner.GetBatches();
+		bool isOversizeAlone = batches.size() == 3 && batches[1].requests == std::vector<size_t>{ oversizeId } &&
+			batches[1].byteSize == 4 * CASES_STAGING_BUDGET && planner.GetPlacement(oversizeId).byteOffset == 0 && planner.Validate();
+
+		std::mt19937 random(7);
+		std::vector<uint64_t> alignments(CASES_ALIGNED_REQUESTS);
+		planner.Clear();
+		for (uint64_t& alignment : alignments)
+		{
+			alignment = uint64_t(1) << (random() % 13);
+			planner.Add(1 + random() % 300, alignment);
+		}
+		planner.Plan();
+		bool isAligned = planner.Validate();
+		for (size_t i = 0; i < alignments.size(); i++) isAligned &= planner.GetPlacement(i).byteOffset % alignments[i] == 0;
+
+		bool isBadAlignmentRefused = IsRefused([&]() { planner.Add(64, 3); }) && IsRefused([&]() { planner.Add(64, 0); });
+		bool isZeroBudgetRefused = IsRefused([]() { UploadPlanner zeroBudget(0); });
+
+		bool isMatch = isOversizeAlone && isAligned && isBadAlignmentRefused && isZeroBudgetRefused;
+		std::cout << "  \"cases\": { \"oversizeAlone\": " << (isOversizeAlone ? "true" : "false") << ", \"aligned\": " << (isAligned ? "true" : "false")
+			<< ", \"badAlignmentRefused\": " << (isBadAlignmentRefused ? "true" : "false") << ", \"zeroBudgetRefused\": " << (isZeroBudgetRefused ? "true" : "false")
+			<< ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+
+	/** Plan a synthetic scene upload of each requests count, a mix of vertex buffers and texture mip chains, with several staging budgets */
+	bool CheckRandom(const std::vector<size_t>& requestsCounts)
+	{
+		bool isMatch = true;
+		std::cout << "  \"plans\": [" << std::endl;
+		for (size_t c = 0; c < requestsCounts.size(); c++)
+		{
+			std::mt19937 random(42);
+			std::vector<std::pair<uint64_t, uint64_t>> requests(requestsCounts[c]);
+			uint64_t requestedBytes = 0;
+			for (auto& request : requests)
+			{
+				bool isTexture = random() % 10 < 3;
+				request.first = isTexture ? 16 * 1024 + random() % (16 * 1024 * 1024) : 64 + random() % (1024 * 1024);
+				request.second = isTexture ? 512 : 16;
+				requestedBytes += request.first;
+			}
+
+			for (size_t i = 0; i < UPLOAD_STAGING_BUDGETS_MB.size(); i++)
+			{
+				UploadPlanner planner(UPLOAD_STAGING_BUDGETS_MB[i] * 1024 * 1024);
+				std::vector<double> milliseconds;
+				for (int r = 0; r < UPLOAD_PLAN_REPETITIONS; r++)
+				{
+					planner.Clear();
+					auto start = std::chrono::steady_clock::now();
+					for (const auto& request : requests) planner.Add(request.first, request.second);
+					planner.Plan();
+					milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+				}
+				std::sort(milliseconds.begin(), milliseconds.end());
+				bool isValid = planner.Validate();
+				isMatch &= isValid;
+
+				bool isLast = c == requestsCounts.size() - 1 && i == UPLOAD_STAGING_BUDGETS_MB.size() - 1;
+				std::cout << std::fixed << std::setprecision(3)
+					<< "    { \"requests\": " << requestsCounts[c] << ", \"stagingBudgetMB\": " << UPLOAD_STAGING_BUDGETS_MB[i]
+					<< ", \"requestedMB\": " << requestedBytes / (1024.0 * 1024.0) << ", \"batches\": " << planner.GetBatches().size()
+					<< ", \"paddingKB\": " << planner.GetPaddingBytes() / 1024.0 << ", \"medianMs\": " << milliseconds[milliseconds.size() / 2]
+					<< ", \"valid\": " << (isValid ? "true" : "false") << " }" << (isLast ? "" : ",") << std::endl;
+			}
+		}
+		std::cout << "  ]" << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunUploadPlan(const std::vector<std::string>& args)
+	{
+		std::vector<size_t> requestsCounts;
+		for (const std::string& arg : args)
+		{
+			if (arg.empty() || !std::all_of(arg.begin(), arg.end(), ::isdigit)) throw std::invalid_argument("Expected a requests count: " + arg);
+			requestsCounts.push_back(std::stoul(arg));
+		}
+		if (requestsCounts.empty()) requestsCounts = DEFAULT_UPLOAD_REQUESTS;
+
+		std::cout << "{" << std::endl;
+		bool isMatch = CheckCases();
+		isMatch &= CheckRandom(requestsCounts);
+		std::cout << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef UPLOAD_PLAN_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunUploadPlan({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
@@ -0,0 +1,213 @@
+#include "VertexLayout.h"
+#include "MeshStreams.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define VERTEX_LAYOUT_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	const VertexAttributeDesc VERTEX_ATTRIBUTES[VERTEX_ATTRIBUTES_COUNT] =
+	{
+		{ "POSITION", "POSITION", 0, 3, { 0.0f, 0.0f, 0.0f, 1.0f } },
+		{ "NORMAL", "NORMAL", 0, 3, { 0.0f, 0.0f, 1.0f, 0.0f } },
+		{ "TANGENT", "TANGENT", 0, 4, { 1.0f, 0.0f, 0.0f, 1.0f } },
+		{ "TEXCOORD_0", "TEXCOORD", 0, 2, { 0.0f, 0.0f, 0.0f, 0.0f } },
+		{ "TEXCOORD_1", "TEXCOORD", 1, 2, { 0.0f, 0.0f, 0.0f, 0.0f } },
+		{ "COLOR_0", "COLOR", 0, 4, { 1.0f, 1.0f, 1.0f, 1.0f } }
+	};
+
+	// The kernels only move bits: loads and stores of floats never convert nor quiet them
+	template <uint32_t Components>
+	void CopyElements(const float* src, const size_t count, uint8_t* dst, const size_t dstStride, const bool canOverwrite)
+	{
+		size_t i = 0;
+#ifdef VERTEX_LAYOUT_SSE2
+		if constexpr (Components == 4)
+		{
+			for (; i < count; i++) _mm_storeu_ps(reinterpret_cast<float*>(dst + i * dstStride), _mm_loadu_ps(src + 4 * i));
+		}
+		else if constexpr (Components == 3)
+		{
+			// A 16 byte load reads the first float of the next element, the last element is copied by the tail
+			if (canOverwrite)
+			{
+				for (; i + 1 < count; i++) _mm_storeu_ps(reinterpret_cast<float*>(dst + i * dstStride), _mm_loadu_ps(src + 3 * i));
+			}
+			else
+			{
+				for (; i + 1 < count; i++)
+				{
+					__m128 values = _mm_loadu_ps(src + 3 * i);
+					float* out = reinterpret_cast<float*>(dst + i * dstStride);
+					_mm_storel_pi(reinterpret_cast<__m64*>(out), values);
+					_mm_store_ss(out + 2, _mm_movehl_ps(values, values));
+				}
+			}
+		}
+		else if constexpr (Components == 2)
+		{
+			for (; i + 2 <= count; i += 2)
+			{
+				__m128 values = _mm_loadu_ps(src + 2 * i);
+				_mm_storel_pi(reinterpret_cast<__m64*>(dst + i * dstStride), values);
+				_mm_storeh_pi(reinterpret_cast<__m64*>(dst + (i + 1) * dstStride), values);
+			}
+		}
+#endif
+		for (; i < count; i++) std::memcpy(dst + i * dstStride, src + Components * i, Components * sizeof(float));
+	}
+
+	void FillElements(const float* value, const uint32_t componentsCount, const size_t count, uint8_t* dst, const size_t dstStride)
+	{
+		for (size_t i = 0; i < count; i++) std::memcpy(dst + i * dstStride, value, componentsCount * sizeof(float));
+	}
+
+	VertexFormat GetElementFormat(const VertexAttribute attribute, const VertexQuantization& quantization)
+	{
+		switch (attribute)
+		{
+		case VERTEX_ATTRIBUTE_POSITION: return quantization.positions ? VertexFormat::Unorm16x4 : VertexFormat::Float32;
+		case VERTEX_ATTRIBUTE_NORMAL: return quantization.directions ? VertexFormat::OctSnorm16x2 : VertexFormat::Float32;
+		case VERTEX_ATTRIBUTE_TANGENT: return quantization.directions ? VertexFormat::OctSignSnorm16x2 : VertexFormat::Float32;
+		case VERTEX_ATTRIBUTE_TEXCOORD0:
+		case VERTEX_ATTRIBUTE_TEXCOORD1: return quantization.texCoords;
+		default: return VertexFormat::Float32;
+		}
+	}
+
+	/** The bounds the unorm16 elements of attribute are relative to, nullptr for the other attributes */
+	void GetElementBounds(const VertexAttribute attribute, const VertexDequantization& dequantization, const float*& offset, const float*& scale)
+	{
+		offset = scale = nullptr;
+		if (attribute == VERTEX_ATTRIBUTE_POSITION) { offset = dequantization.positionOffset; scale = dequantization.positionScale; }
+		if (attribute == VERTEX_ATTRIBUTE_TEXCOORD0) { offset = dequantization.texCoordTransforms[0] + 2; scale = dequantization.texCoordTransforms[0]; }
+		if (attribute == VERTEX_ATTRIBUTE_TEXCOORD1) { offset = dequantization.texCoordTransforms[1] + 2; scale = dequantization.texCoordTransforms[1]; }
+	}
+}
+
+const VertexAttributeDesc& GetVertexAttributeDesc(const VertexAttribute attribute)
+{
+	if (attribute >= VERTEX_ATTRIBUTES_COUNT) throw std::invalid_argument("Unknown vertex attribute " + std::to_string(attribute));
+	return VERTEX_ATTRIBUTES[attribute];
+}
+
+const VertexElement* VertexLayout::Find(const VertexAttribute attribute) const
+{
+	for (const VertexElement& element : elements) if (element.attribute == attribute) return &element;
+	return nullptr;
+}
+
+size_t VertexLayout::GetVertexByteSize() const
+{
+	size_t byteSize = 0;
+	for (const uint32_t stride : slotStrides) byteSize += stride;
+	return byteSize;
+}
+
+VertexLayout CreateVertexLayout(const VertexFeatures features, const VertexSlotsMode mode, const VertexQuantization& quantization)
+{
+	if ((features & VERTEX_FEATURE_POSITION) == 0) throw std::invalid_argument("A vertex layout needs the positions");
+	if (features >> VERTEX_ATTRIBUTES_COUNT) throw std::invalid_argument("Unknown vertex features " + std::to_string(features));
+	if (quantization.texCoords != VertexFormat::Float32 && quantization.texCoords != VertexFormat::Half2 && quantization.texCoords != VertexFormat::Unorm16x2)
+	{
+		throw std::invalid_argument("Unsupported texture coordinates format " + std::to_string(static_cast<uint32_t>(quantization.texCoords)));
+	}
+
+	VertexLayout layout;
+	layout.mode = mode;
+	layout.features = features;
+	layout.quantization = quantization;
+	for (uint32_t a = 0; a < VERTEX_ATTRIBUTES_COUNT; a++)
+	{
+		if ((features & (1u << a)) == 0) continue;
+
+		VertexElement element;
+		element.attribute = static_cast<VertexAttribute>(a);
+		element.componentsCount = VERTEX_ATTRIBUTES[a].componentsCount;
+		element.format = GetElementFormat(element.attribute, quantization);
+		if (mode == VertexSlotsMode::Separate) element.slot = static_cast<uint32_t>(layout.elements.size());
+		else if (mode == VertexSlotsMode::PositionSplit) element.slot = (a == VERTEX_ATTRIBUTE_POSITION) ? 0 : 1;
+		else element.slot = 0;
+
+		if (element.slot == layout.slotStrides.size()) layout.slotStrides.push_back(0);
+		element.byteOffset = layout.slotStrides[element.slot];
+		layout.slotStrides[element.slot] += GetVertexFormatByteSize(element.format, element.componentsCount);
+		layout.elements.push_back(element);
+	}
+	return layout;
+}
+
+void CopyVertexElements(const float* src, const size_t count, const uint32_t componentsCount, uint8_t* dst, const size_t dstStride, const bool canOverwrite)
+{
+	switch (componentsCount)
+	{
+	case 1: CopyElements<1>(src, count, dst, dstStride, canOverwrite); break;
+	case 2: CopyElements<2>(src, count, dst, dstStride, canOverwrite); break;
+	case 3: CopyElements<3>(src, count, dst, dstStride, canOverwrite); break;
+	case 4: CopyElements<4>(src, count, dst, dstStride, canOverwrite); break;
+	default: throw std::invalid_argument("Vertex elements have 1 to 4 components, not " + std::to_string(componentsCount));
+	}
+}
+
+PackedVertices PackVertices(const MeshStreams& mesh, const VertexLayout& layout)
+{
+	PackedVertices packed;
+	packed.verticesCount = mesh.verticesCount;
+	packed.slots.resize(layout.slotStrides.size());
+	for (size_t s = 0; s < packed.slots.size(); s++) packed.slots[s].resize(mesh.verticesCount * layout.slotStrides[s]);
+	if (layout.quantization.IsEnabled()) packed.dequantization = ComputeVertexDequantization(mesh, layout.quantization);
+
+	// The elements of a slot are written in increasing offsets, an element can overwrite the bytes of the next ones before they are written
+	for (const VertexElement& element : layout.elements)
+	{
+		const VertexAttributeDesc& desc = VERTEX_ATTRIBUTES[element.attribute];
+		const size_t stride = layout.slotStrides[element.slot];
+		uint8_t* dst = packed.slots[element.slot].data() + element.byteOffset;
+		const bool canOverwrite = element.byteOffset + 4 * sizeof(float) <= stride;
+
+		const VertexStream* stream = mesh.Find(desc.gltfSemantic);
+		if (stream && stream->values.size() != mesh.verticesCount * stream->elementsCount)
+		{
+			throw std::invalid_argument(std::string("The ") + desc.gltfSemantic + " stream does not match the vertices count");
+		}
+
+		if (element.format != VertexFormat::Float32)
+		{
+			// The encoders read whole elements: the missing components are filled with their defaults first
+			const bool isWhole = stream && stream->elementsCount == element.componentsCount;
+			std::vector<float> values;
+			if (!isWhole)
+			{
+				const uint32_t elementByteSize = element.componentsCount * sizeof(float);
+				values.resize(mesh.verticesCount * element.componentsCount);
+				uint8_t* valuesData = reinterpret_cast<uint8_t*>(values.data());
+				FillElements(desc.defaultValue, element.componentsCount, mesh.verticesCount, valuesData, elementByteSize);
+				const size_t copiedBytes = stream ? (std::min)(stream->elementsCount, static_cast<size_t>(element.componentsCount)) * sizeof(float) : 0;
+				for (size_t v = 0; v < mesh.verticesCount && copiedBytes > 0; v++) std::memcpy(valuesData + v * elementByteSize, &stream->values[v * stream->elementsCount], copiedBytes);
+			}
+			const float *offset, *scale;
+			GetElementBounds(element.attribute, packed.dequantization, offset, scale);
+			EncodeVertexElements(element.format, isWhole ? stream->values.data() : values.data(), mesh.verticesCount, element.componentsCount, offset, scale, dst, stride);
+		}
+		else if (stream && stream->elementsCount == element.componentsCount)
+		{
+			CopyVertexElements(stream->values.data(), mesh.verticesCount, element.componentsCount, dst, stride, canOverwrite);
+		}
+		else if (stream)
+		{
+			// COLOR_0 can be a vec3: the components the stream lacks keep their default values
+			FillElements(desc.defaultValue, element.componentsCount, mesh.verticesCount, dst, stride);
+			const size_t copiedBytes = (std::min)(stream->elementsCount, static_cast<size_t>(element.componentsCount)) * sizeof(float);
+			for (size_t v = 0; v < mesh.verticesCount; v++) std::memcpy(dst + v * stride, &stream->values[v * stream->elementsCount], copiedBytes);
+		}
+		else FillElements(desc.defaultValue, element.componentsCount, mesh.verticesCount, dst, stride);
+	}
+	return packed;
+}
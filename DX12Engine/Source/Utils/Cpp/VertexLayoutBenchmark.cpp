@@ -0,0 +1,263 @@
+#include "Benchmark.h"
+#include "VertexLayout.h"
+#include "MeshStreams.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const std::vector<std::string> DEFAULT_LAYOUT_MODELS = { "models/BoxTextured.glb", "models/2CylinderEngine.glb", "models/DamagedHelmet.glb", "models/NormalTangentTest.glb", "models/scene.gltf" };
+	const std::vector<size_t> DEFAULT_LAYOUT_VERTICES = { 1 << 16, 1 << 20 };
+	constexpr size_t MAX_TAIL_VERTICES = 9;	// Meshes of 0 to 9 vertices exercise every tail of the kernels
+	constexpr int LAYOUT_REPETITIONS = 5;
+
+	/** The layouts checked: the viewer feature set and every attribute, in each slots mode */
+	struct LayoutCase
+	{
+		const char* name;
+		VertexFeatures features;
+		VertexSlotsMode mode;
+	};
+
+	const LayoutCase LAYOUT_CASES[] =
+	{
+		{ "mesh_separate", VERTEX_FEATURES_MESH, VertexSlotsMode::Separate },
+		{ "mesh_interleaved", VERTEX_FEATURES_MESH, VertexSlotsMode::Interleaved },
+		{ "mesh_position_split", VERTEX_FEATURES_MESH, VertexSlotsMode::PositionSplit },
+		{ "all_interleaved", (1u << VERTEX_ATTRIBUTES_COUNT) - 1, VertexSlotsMode::Interleaved },
+		{ "all_position_split", (1u << VERTEX_ATTRIBUTES_COUNT) - 1, VertexSlotsMode::PositionSplit },
+		{ "position_texcoord0", VERTEX_FEATURE_POSITION | VERTEX_FEATURE_TEXCOORD0, VertexSlotsMode::Interleaved },
+		{ "position", VERTEX_FEATURE_POSITION, VertexSlotsMode::Interleaved }
+	};
+
+	/**
+	 * A mesh whose streams hold random bit patterns, NaNs and denormals included, so that any conversion shows.
+	 * COLOR_0 is a vec3 and TEXCOORD_1 is missing, to check the default values.
+	 */
+	MeshStreams CreateRandomMesh(const size_t verticesCount, std::mt19937& random)
+	{
+		auto randomValues = [&](const size_t count)
+		{
+			std::vector<uint32_t> bits(count);
+			for (uint32_t& b : bits) b = static_cast<uint32_t>(random());
+			std::vector<float> values(count);
+			if (count > 0) std::memcpy(values.data(), bits.data(), count * sizeof(float));
+			return values;
+		};
+
+		MeshStreams mesh;
+		mesh.verticesCount = verticesCount;
+		mesh.SetStream("POSITION", 3, randomValues(3 * verticesCount));
+		mesh.SetStream("NORMAL", 3, randomValues(3 * verticesCount));
+		mesh.SetStream("TANGENT", 4, randomValues(4 * verticesCount));
+		mesh.SetStream("TEXCOORD_0", 2, randomValues(2 * verticesCount));
+		mesh.SetStream("COLOR_0", 3, randomValues(3 * verticesCount));
+		return mesh;
+	}
+
+	/** The reference packing: one vertex after the other, one component after the other */
+	std::vector<std::vector<uint8_t>> PackVerticesReference(const MeshStreams& mesh, const VertexLayout& layout)
+	{
+		std::vector<std::vector<uint8_t>> slots(layout.slotStrides.size());
+		for (size_t s = 0; s < slots.size(); s++) slots[s].resize(mesh.verticesCount * layout.slotStrides[s]);
+		for (size_t v = 0; v < mesh.verticesCount; v++)
+		{
+			for (const VertexElement& element : layout.elements)
+			{
+				const VertexAttributeDesc& desc = GetVertexAttributeDesc(element.attribute);
+				const VertexStream* stream = mesh.Find(desc.gltfSemantic);
+				uint8_t* dst = slots[element.slot].data() + v * layout.slotStrides[element.slot] + element.byteOffset;
+				for (size_t k = 0; k < element.componentsCount; k++)
+				{
+					const float* value = (stream && k < stream->elementsCount) ? &stream->values[v * stream->elementsCount + k] : &desc.defaultValue[k];
+					std::memcpy(dst + k * sizeof(float), value, sizeof(float));
+				}
+			}
+		}
+		return slots;
+	}
+
+	/** The elements must not overlap, must fit their slot stride and follow the slots of the mode */
+	bool IsLayoutValid(const VertexLayout& layout)
+	{
+		uint32_t previousSlot = 0, nextOffset = 0;
+		for (size_t e = 0; e < layout.elements.size(); e++)
+		{
+			const VertexElement& element = layout.elements[e];
+			if (element.slot >= layout.slotStrides.size()) return false;
+			if (element.slot != previousSlot) nextOffset = 0;
+			if (element.byteOffset != nextOffset || element.byteOffset % sizeof(float) != 0) return false;
+			nextOffset = element.byteOffset + element.componentsCount * sizeof(float);
+			if (nextOffset > layout.slotStrides[element.slot]) return false;
+			previousSlot = element.slot;
+
+			uint32_t expectedSlot = 0;
+			if (layout.mode == VertexSlotsMode::Separate) expectedSlot = static_cast<uint32_t>(e);
+			if (layout.mode == VertexSlotsMode::PositionSplit) expectedSlot = (element.attribute == VERTEX_ATTRIBUTE_POSITION) ? 0 : 1;
+			if (element.slot != expectedSlot) return false;
+		}
+		return !layout.elements.empty() && layout.elements[0].attribute == VERTEX_ATTRIBUTE_POSITION;
+	}
+
+	template <class Function>
+	double MedianMilliseconds(const Function& function)
+	{
+		std::vector<double> milliseconds;
+		for (int r = 0; r < LAYOUT_REPETITIONS; r++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			function();
+			milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(milliseconds.begin(), milliseconds.end());
+		return milliseconds[milliseconds.size() / 2];
+	}
+
+	/** Pack the meshes in every layout, check them bit for bit against the reference and compare their throughput */
+	bool CheckMeshes(const std::string& name, const std::vector<MeshStreams>& meshes, const bool isLast)
+	{
+		size_t verticesCount = 0;
+		for (const MeshStreams& mesh : meshes) verticesCount += mesh.verticesCount;
+
+		bool isMatch = true;
+		std::cout << "    { \"mesh\": \"" << name << "\", \"primitives\": " << meshes.size() << ", \"vertices\": " << verticesCount << ", \"layouts\": [" << std::endl;
+		for (size_t c = 0; c < std::size(LAYOUT_CASES); c++)
+		{
+			VertexLayout layout = CreateVertexLayout(LAYOUT_CASES[c].features, LAYOUT_CASES[c].mode);
+			bool isValid = IsLayoutValid(layout), isBitExact = true;
+			for (const MeshStreams& mesh : meshes)
+			{
+				PackedVertices packed = PackVertices(mesh, layout);
+				isBitExact &= packed.verticesCount == mesh.verticesCount && packed.slots == PackVerticesReference(mesh, layout);
+			}
+
+			double packMs = MedianMilliseconds([&]() { for (const MeshStreams& mesh : meshes) PackVertices(mesh, layout); });
+			double referenceMs = MedianMilliseconds([&]() { for (const MeshStreams& mesh : meshes) PackVerticesReference(mesh, layout); });
+			double packedBytes = double(verticesCount) * layout.GetVertexByteSize();
+			isMatch &= isValid && isBitExact;
+
+			std::cout << std::fixed << std::setprecision(3)
+				<< "      { \"layout\": \"" << LAYOUT_CASES[c].name << "\", \"slots\": " << layout.slotStrides.size() << ", \"vertexBytes\": " << layout.GetVertexByteSize()
+				<< ", \"packMs\": " << packMs << ", \"referenceMs\": " << referenceMs
+				<< ", \"packGBps\": " << (packMs > 0.0 ? packedBytes / (packMs * 1e6) : 0.0) << ", \"referenceGBps\": " << (referenceMs > 0.0 ? packedBytes / (referenceMs * 1e6) : 0.0)
+				<< ", \"valid\": " << (isValid ? "true" : "false") << ", \"bitExact\": " << (isBitExact ? "true" : "false")
+				<< " }" << (c + 1 == std::size(LAYOUT_CASES) ? "" : ",") << std::endl;
+		}
+		std::cout << "    ] }" << (isLast ? "" : ",") << std::endl;
+		return isMatch;
+	}
+
+	/** Every tail of the kernels, in every layout and for every copy width, must be exact and must not write past the slots */
+	bool CheckTails(std::mt19937& random)
+	{
+		bool isMatch = true;
+		for (size_t verticesCount = 0; verticesCount <= MAX_TAIL_VERTICES; verticesCount++)
+		{
+			MeshStreams mesh = CreateRandomMesh(verticesCount, random);
+			for (const LayoutCase& layoutCase : LAYOUT_CASES)
+			{
+				VertexLayout layout = CreateVertexLayout(layoutCase.features, layoutCase.mode);
+				isMatch &= PackVertices(mesh, layout).slots == PackVerticesReference(mesh, layout);
+			}
+
+			// The kernels alone, with guard bytes after the last element
+			for (uint32_t components = 1; components <= 4; components++)
+			{
+				std::vector<float> src(verticesCount * components);
+				for (float& value : src) value = static_cast<float>(random());
+				for (size_t stride : { components * sizeof(float), components * sizeof(float) + 4, size_t(32) })
+				{
+					const bool canOverwrite = stride >= 4 * sizeof(float);
+					std::vector<uint8_t> dst(verticesCount * stride + 16, 0xCD), expected = dst;
+					CopyVertexElements(src.data(), verticesCount, components, dst.data(), stride, canOverwrite);
+					for (size_t v = 0; v < verticesCount; v++) std::memcpy(&expected[v * stride], &src[v * components], components * sizeof(float));
+
+					// Only the elements are compared: the bytes an element may overwrite belong to the next elements
+					bool isSame = std::equal(dst.end() - 16, dst.end(), expected.end() - 16);
+					for (size_t v = 0; v < verticesCount; v++) isSame &= std::memcmp(&dst[v * stride], &expected[v * stride], components * sizeof(float)) == 0;
+					if (!canOverwrite) isSame &= dst == expected;
+					isMatch &= isSame;
+				}
+			}
+		}
+		std::cout << "  \"tails\": { \"maxVertices\": " << MAX_TAIL_VERTICES << ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+
+	/** A layout without positions and a stream shorter than the vertices must be rejected */
+	bool CheckInvalidInputs()
+	{
+		bool isLayoutRejected = false, isStreamRejected = false;
+		try { CreateVertexLayout(VERTEX_FEATURE_NORMAL, VertexSlotsMode::Interleaved); }
+		catch (const std::invalid_argument&) { isLayoutRejected = true; }
+
+		MeshStreams mesh;
+		mesh.verticesCount = 2;
+		mesh.SetStream("POSITION", 3, { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f });
+		mesh.streams.push_back({ "NORMAL", 3, { 0.0f, 0.0f, 1.0f } });
+		try { PackVertices(mesh, CreateVertexLayout(VERTEX_FEATURES_MESH, VertexSlotsMode::Interleaved)); }
+		catch (const std::invalid_argument&) { isStreamRejected = true; }
+
+		bool isMatch = isLayoutRejected && isStreamRejected;
+		std::cout << "  \"invalidInputs\": { \"layoutRejected\": " << (isLayoutRejected ? "true" : "false") << ", \"streamRejected\": "
+			<< (isStreamRejected ? "true" : "false") << ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunVertexLayout(const std::vector<std::string>& args)
+	{
+		std::vector<size_t> verticesCounts;
+		std::vector<std::string> fileNames;
+		for (const std::string& arg : args)
+		{
+			if (!arg.empty() && std::all_of(arg.begin(), arg.end(), ::isdigit)) verticesCounts.push_back(std::stoul(arg));
+			else fileNames.push_back(arg);
+		}
+		if (verticesCounts.empty()) verticesCounts = DEFAULT_LAYOUT_VERTICES;
+		if (fileNames.empty()) fileNames = DEFAULT_LAYOUT_MODELS;
+		std::mt19937 random(16);
+
+		std::cout << "{" << std::endl;
+		bool isMatch = CheckInvalidInputs();
+		isMatch &= CheckTails(random);
+		std::cout << "  \"meshes\": [" << std::endl;
+		for (size_t verticesCount : verticesCounts)
+		{
+			isMatch &= CheckMeshes("random_" + std::to_string(verticesCount), { CreateRandomMesh(verticesCount, random) }, false);
+		}
+		for (size_t f = 0; f < fileNames.size(); f++)
+		{
+			isMatch &= CheckMeshes(std::filesystem::path(fileNames[f]).generic_string(), LoadMeshStreams(fileNames[f]), f + 1 == fileNames.size());
+		}
+		std::cout << "  ]" << std::endl << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef VERTEX_LAYOUT_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunVertexLayout({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
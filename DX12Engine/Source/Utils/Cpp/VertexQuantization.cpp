@@ -0,0 +1,350 @@
+#include "VertexQuantization.h"
+#include "MeshStreams.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	// The steps per unit of the integer and normalized integer component types of KHR_mesh_quantization
+	const double INTEGER_GRIDS[] = { 1.0, 127.0, 255.0, 32767.0, 65535.0 };
+	constexpr double GRID_TOLERANCE = 1.0 / 64.0;	// In steps, above the float rounding of a normalized value
+
+	constexpr float SNORM16_STEPS = 32767.0f;
+	constexpr float TANGENT_Y_STEPS = 16383.0f;		// 15 bits, the sign of the stored value is the bitangent sign
+	constexpr int32_t TANGENT_Y_BIAS = 16384;		// Keeps the stored y away from zero, so that it always has a sign
+
+	/** The components stored by format, 0 for Float32 that stores 1 to 4 of them */
+	uint32_t GetFormatComponentsCount(const VertexFormat format)
+	{
+		switch (format)
+		{
+		case VertexFormat::Float32: return 0;
+		case VertexFormat::Unorm16x4: return 3;
+		case VertexFormat::OctSnorm16x2: return 3;
+		case VertexFormat::OctSignSnorm16x2: return 4;
+		case VertexFormat::Half2: return 2;
+		case VertexFormat::Unorm16x2: return 2;
+		}
+		throw std::invalid_argument("Unknown vertex format " + std::to_string(static_cast<uint32_t>(format)));
+	}
+
+	void CheckComponentsCount(const VertexFormat format, const uint32_t componentsCount)
+	{
+		uint32_t formatComponents = GetFormatComponentsCount(format);
+		if ((formatComponents == 0 && (componentsCount < 1 || componentsCount > 4)) || (formatComponents != 0 && componentsCount != formatComponents))
+		{
+			throw std::invalid_argument("Vertex format " + std::to_string(static_cast<uint32_t>(format)) + " does not store " + std::to_string(componentsCount) + " components");
+		}
+	}
+
+	/** Set the offset and the scale of a unorm16 component to the bounds of its finite values, or to the integer grid they lie on */
+	void SetUnormBounds(const VertexStream& stream, const size_t component, float& offset, float& scale)
+	{
+		float lower = 0.0f, upper = 0.0f;
+		bool isEmpty = true;
+		for (size_t i = component; i < stream.values.size(); i += stream.elementsCount)
+		{
+			const float value = stream.values[i];
+			if (!std::isfinite(value)) continue;
+			lower = isEmpty ? value : (std::min)(lower, value);
+			upper = isEmpty ? value : (std::max)(upper, value);
+			isEmpty = false;
+		}
+		offset = lower;
+		scale = upper - lower;
+
+		for (const double grid : INTEGER_GRIDS)
+		{
+			if ((static_cast<double>(upper) - lower) * grid > 65535.0) continue;
+			bool isOnGrid = true;
+			for (size_t i = component; i < stream.values.size() && isOnGrid; i += stream.elementsCount)
+			{
+				const double steps = static_cast<double>(stream.values[i]) * grid;
+				isOnGrid = std::isfinite(steps) && std::abs(steps - std::round(steps)) <= GRID_TOLERANCE;
+			}
+			if (!isOnGrid) continue;
+			scale = static_cast<float>(65535.0 / grid);
+			return;
+		}
+	}
+
+	uint16_t QuantizeUnorm16(const float value, const float offset, const float stepsPerUnit)
+	{
+		float steps = (value - offset) * stepsPerUnit;
+		steps = (steps >= 0.0f) ? (std::min)(steps, 65535.0f) : 0.0f;	// NaNs are stored as the offset
+		return static_cast<uint16_t>(steps + 0.5f);
+	}
+
+	/** std::floor without the library call, for the values of the octahedral grids */
+	float FloorSteps(const float value)
+	{
+		const float truncated = static_cast<float>(static_cast<int32_t>(value));
+		return (truncated > value) ? truncated - 1.0f : truncated;
+	}
+
+	/**
+	 * Quantize the octahedral coordinates of v on grids of xSteps and ySteps per unit. Of the four grid points around
+	 * the coordinates, keep the one whose direction is the closest to v: it is not always the rounded one.
+	 */
+	void QuantizeOctahedral(const float v[3], const float xSteps, const float ySteps, int32_t& qx, int32_t& qy)
+	{
+		float oct[2];
+		EncodeOctahedral(v, oct);
+		const float l1 = std::abs(v[0]) + std::abs(v[1]) + std::abs(v[2]);
+		const float unit[3] = { v[0], v[1], (l1 > 0.0f && std::isfinite(l1)) ? v[2] : 1.0f };	// A null vector is +z, as its encoding
+
+		// The candidates are compared by their squared cosine with v, none of them is more than 90 degrees away
+		const float x0 = FloorSteps(oct[0] * xSteps), y0 = FloorSteps(oct[1] * ySteps);
+		const float xUnit = 1.0f / xSteps, yUnit = 1.0f / ySteps;
+		float bestCos2 = -1.0f;
+		for (int corner = 0; corner < 4; corner++)
+		{
+			const float cx = (std::min)(x0 + (corner & 1), xSteps), cy = (std::min)(y0 + (corner >> 1), ySteps);
+			float x = cx * xUnit, y = cy * yUnit;
+			const float z = 1.0f - std::abs(x) - std::abs(y);
+			if (z < 0.0f)
+			{
+				const float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+				y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+				x = foldedX;
+			}
+			const float dot = unit[0] * x + unit[1] * y + unit[2] * z;
+			const float cos2 = dot * std::abs(dot) / (x * x + y * y + z * z);
+			if (cos2 <= bestCos2) continue;
+			bestCos2 = cos2;
+			qx = static_cast<int32_t>(cx);
+			qy = static_cast<int32_t>(cy);
+		}
+	}
+
+	float DecodeSnorm16(const int16_t value)
+	{
+		return (std::max)(value / SNORM16_STEPS, -1.0f);
+	}
+}
+
+uint32_t GetVertexFormatByteSize(const VertexFormat format, const uint32_t componentsCount)
+{
+	CheckComponentsCount(format, componentsCount);
+	switch (format)
+	{
+	case VertexFormat::Float32: return componentsCount * sizeof(float);
+	case VertexFormat::Unorm16x4: return 4 * sizeof(uint16_t);
+	default: return 2 * sizeof(uint16_t);
+	}
+}
+
+bool VertexQuantization::IsEnabled() const
+{
+	return positions || directions || texCoords != VertexFormat::Float32;
+}
+
+void VertexQuantizationReport::Add(const VertexQuantizationReport& report)
+{
+	verticesCount += report.verticesCount;
+	floatByteSize += report.floatByteSize;
+	quantizedByteSize += report.quantizedByteSize;
+}
+
+VertexDequantization ComputeVertexDequantization(const MeshStreams& mesh, const VertexQuantization& quantization)
+{
+	VertexDequantization dequantization;
+	dequantization.octahedralDirections = quantization.directions ? 1 : 0;
+
+	const VertexStream* positions = quantization.positions ? mesh.Find("POSITION") : nullptr;
+	for (size_t c = 0; positions && c < (std::min)(positions->elementsCount, size_t(3)); c++)
+	{
+		SetUnormBounds(*positions, c, dequantization.positionOffset[c], dequantization.positionScale[c]);
+	}
+
+	for (size_t t = 0; t < 2 && quantization.texCoords == VertexFormat::Unorm16x2; t++)
+	{
+		const VertexStream* texCoords = mesh.Find(t == 0 ? "TEXCOORD_0" : "TEXCOORD_1");
+		float* transform = dequantization.texCoordTransforms[t];
+		for (size_t c = 0; texCoords && c < (std::min)(texCoords->elementsCount, size_t(2)); c++) SetUnormBounds(*texCoords, c, transform[2 + c], transform[c]);
+	}
+	return dequantization;
+}
+
+void EncodeOctahedral(const float v[3], float oct[2])
+{
+	const float l1 = std::abs(v[0]) + std::abs(v[1]) + std::abs(v[2]);
+	if (!(l1 > 0.0f) || !std::isfinite(l1))
+	{
+		oct[0] = oct[1] = 0.0f;
+		return;
+	}
+
+	// Project on the octahedron, then fold its lower half over the upper one
+	const float x = v[0] / l1, y = v[1] / l1;
+	oct[0] = (v[2] >= 0.0f) ? x : (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+	oct[1] = (v[2] >= 0.0f) ? y : (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+}
+
+void DecodeOctahedral(const float oct[2], float v[3])
+{
+	float x = oct[0], y = oct[1];
+	const float z = 1.0f - std::abs(x) - std::abs(y);
+	if (z < 0.0f)
+	{
+		const float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+	}
+	const float length = std::sqrt(x * x + y * y + z * z);
+	v[0] = x / length;
+	v[1] = y / length;
+	v[2] = z / length;
+}
+
+uint16_t FloatToHalf(const float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+	const uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+	if (magnitude > 0x7F800000u) return sign | 0x7E00u | static_cast<uint16_t>((magnitude >> 13) & 0x3FFu);	// NaN, quiet
+	if (magnitude >= 0x477FF000u) return sign | 0x7C00u;	// 65520 and above round to infinity
+	if (magnitude >= 0x38800000u)
+	{
+		// Normal: rebias the exponent and round the mantissa to nearest even
+		const uint32_t rebiased = magnitude - 0x38000000u;
+		return sign | static_cast<uint16_t>((rebiased + 0xFFFu + ((rebiased >> 13) & 1u)) >> 13);
+	}
+
+	// Subnormal: the multiple of 2^-24, rounded to nearest even by the default rounding mode. 1024 is the smallest normal
+	float absValue;
+	std::memcpy(&absValue, &magnitude, sizeof(absValue));
+	return sign | static_cast<uint16_t>(std::nearbyint(absValue * 16777216.0f));
+}
+
+float HalfToFloat(const uint16_t half)
+{
+	const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+	const uint32_t exponent = (half >> 10) & 0x1Fu;
+	const uint32_t mantissa = half & 0x3FFu;
+	if (exponent == 0)
+	{
+		const float value = std::ldexp(static_cast<float>(mantissa), -24);
+		return sign ? -value : value;
+	}
+
+	const uint32_t bits = sign | ((exponent == 31) ? 0x7F800000u : ((exponent + 112) << 23)) | (mantissa << 13);
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+void EncodeVertexElements(const VertexFormat format, const float* src, const size_t count, const uint32_t componentsCount,
+	const float* offset, const float* scale, uint8_t* dst, const size_t dstStride)
+{
+	CheckComponentsCount(format, componentsCount);
+	switch (format)
+	{
+	case VertexFormat::Float32:
+		for (size_t i = 0; i < count; i++) std::memcpy(dst + i * dstStride, src + i * componentsCount, componentsCount * sizeof(float));
+		return;
+	case VertexFormat::Unorm16x4:
+	{
+		float stepsPerUnit[3];
+		for (int c = 0; c < 3; c++) stepsPerUnit[c] = (scale[c] > 0.0f) ? 65535.0f / scale[c] : 0.0f;
+		for (size_t i = 0; i < count; i++)
+		{
+			const float* p = src + 3 * i;
+			const uint16_t q[4] = { QuantizeUnorm16(p[0], offset[0], stepsPerUnit[0]), QuantizeUnorm16(p[1], offset[1], stepsPerUnit[1]),
+				QuantizeUnorm16(p[2], offset[2], stepsPerUnit[2]), 65535 };
+			std::memcpy(dst + i * dstStride, q, sizeof(q));
+		}
+		return;
+	}
+	case VertexFormat::OctSnorm16x2:
+		for (size_t i = 0; i < count; i++)
+		{
+			int32_t qx = 0, qy = 0;
+			QuantizeOctahedral(src + 3 * i, SNORM16_STEPS, SNORM16_STEPS, qx, qy);
+			const int16_t q[2] = { static_cast<int16_t>(qx), static_cast<int16_t>(qy) };
+			std::memcpy(dst + i * dstStride, q, sizeof(q));
+		}
+		return;
+	case VertexFormat::OctSignSnorm16x2:
+		for (size_t i = 0; i < count; i++)
+		{
+			int32_t qx = 0, qy = 0;
+			QuantizeOctahedral(src + 4 * i, SNORM16_STEPS, TANGENT_Y_STEPS, qx, qy);
+			const int32_t biasedY = qy + TANGENT_Y_BIAS;	// In [1, 32767]
+			const int16_t q[2] = { static_cast<int16_t>(qx), static_cast<int16_t>(src[4 * i + 3] < 0.0f ? -biasedY : biasedY) };
+			std::memcpy(dst + i * dstStride, q, sizeof(q));
+		}
+		return;
+	case VertexFormat::Half2:
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint16_t q[2] = { FloatToHalf(src[2 * i]), FloatToHalf(src[2 * i + 1]) };
+			std::memcpy(dst + i * dstStride, q, sizeof(q));
+		}
+		return;
+	case VertexFormat::Unorm16x2:
+	{
+		const float stepsPerUnit[2] = { (scale[0] > 0.0f) ? 65535.0f / scale[0] : 0.0f, (scale[1] > 0.0f) ? 65535.0f / scale[1] : 0.0f };
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint16_t q[2] = { QuantizeUnorm16(src[2 * i], offset[0], stepsPerUnit[0]), QuantizeUnorm16(src[2 * i + 1], offset[1], stepsPerUnit[1]) };
+			std::memcpy(dst + i * dstStride, q, sizeof(q));
+		}
+		return;
+	}
+	}
+}
+
+void DecodeVertexElements(const VertexFormat format, const uint8_t* src, const size_t count, const size_t srcStride, const uint32_t componentsCount,
+	const float* offset, const float* scale, float* dst)
+{
+	CheckComponentsCount(format, componentsCount);
+	for (size_t i = 0; i < count; i++)
+	{
+		const uint8_t* element = src + i * srcStride;
+		float* out = dst + i * componentsCount;
+		uint16_t u[4];
+		int16_t s[2];
+		switch (format)
+		{
+		case VertexFormat::Float32:
+			std::memcpy(out, element, componentsCount * sizeof(float));
+			break;
+		case VertexFormat::Unorm16x4:
+			std::memcpy(u, element, 4 * sizeof(uint16_t));
+			for (int c = 0; c < 3; c++) out[c] = u[c] / 65535.0f * scale[c] + offset[c];
+			break;
+		case VertexFormat::OctSnorm16x2:
+		{
+			std::memcpy(s, element, sizeof(s));
+			const float oct[2] = { DecodeSnorm16(s[0]), DecodeSnorm16(s[1]) };
+			DecodeOctahedral(oct, out);
+			break;
+		}
+		case VertexFormat::OctSignSnorm16x2:
+		{
+			std::memcpy(s, element, sizeof(s));
+			const float y = DecodeSnorm16(s[1]);
+			const float oct[2] = { DecodeSnorm16(s[0]), (std::round(std::abs(y) * SNORM16_STEPS) - TANGENT_Y_BIAS) / TANGENT_Y_STEPS };
+			DecodeOctahedral(oct, out);
+			out[3] = (y < 0.0f) ? -1.0f : 1.0f;
+			break;
+		}
+		case VertexFormat::Half2:
+			std::memcpy(u, element, 2 * sizeof(uint16_t));
+			out[0] = HalfToFloat(u[0]);
+			out[1] = HalfToFloat(u[1]);
+			break;
+		case VertexFormat::Unorm16x2:
+			std::memcpy(u, element, 2 * sizeof(uint16_t));
+			for (int c = 0; c < 2; c++) out[c] = u[c] / 65535.0f * scale[c] + offset[c];
+			break;
+		}
+	}
+}
@@ -0,0 +1,402 @@
+#include "Benchmark.h"
+#include "VertexLayout.h"
+#include "VertexQuantization.h"
+#include "MeshStreams.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const std::vector<std::string> DEFAULT_QUANTIZATION_MODELS = { "models/BoxTextured.glb", "models/2CylinderEngine.glb", "models/DamagedHelmet.glb", "models/NormalTangentTest.glb", "models/scene.gltf" };
+	const std::vector<size_t> DEFAULT_QUANTIZATION_VERTICES = { 1 << 16, 1 << 20 };
+	constexpr int QUANTIZATION_REPETITIONS = 5;
+
+	// The error bounds: half a step of the unorm16 and half float grids, and the largest angles of the octahedral grids
+	constexpr double UNORM16_MAX_ERROR = 0.5 / 65535.0;
+	constexpr double HALF_MAX_RELATIVE_ERROR = 1.0 / 2048.0;
+	constexpr double HALF_MAX_SUBNORMAL_ERROR = 1.0 / 33554432.0;	// Half of the 2^-24 subnormal step
+	constexpr double NORMAL_MAX_DEGREES = 0.008;
+	constexpr double TANGENT_MAX_DEGREES = 0.015;
+	constexpr double FLOAT_MAX_DEGREES = 0.0001;	// The acos of the dot product of a float direction with itself
+	constexpr double FLOAT_ROUNDING = 4.0 / 16777216.0;		// The float arithmetic of the decoding, relative to the values
+
+	struct QuantizationCase
+	{
+		const char* name;
+		VertexQuantization quantization;
+	};
+
+	const QuantizationCase QUANTIZATION_CASES[] =
+	{
+		{ "float", { false, false, VertexFormat::Float32 } },
+		{ "positions", { true, false, VertexFormat::Float32 } },
+		{ "directions", { false, true, VertexFormat::Float32 } },
+		{ "all_half_texcoords", { true, true, VertexFormat::Half2 } },
+		{ "all_unorm16_texcoords", { true, true, VertexFormat::Unorm16x2 } }
+	};
+
+	/** The largest errors of the decoded vertices, relative to their bounds */
+	struct QuantizationErrors
+	{
+		double positionHalfSteps = 0.0;	/*< In half unorm16 steps of the bounds, 1 is the bound */
+		double normalDegrees = 0.0;
+		double tangentDegrees = 0.0;
+		size_t tangentSignErrors = 0;
+		double texCoordError = 0.0;		/*< In half float rounding or half unorm16 steps, 1 is the bound */
+
+		bool IsWithinBounds(const VertexQuantization& quantization) const
+		{
+			const double positionBound = quantization.positions ? 1.0 : 0.0;
+			const double normalBound = quantization.directions ? NORMAL_MAX_DEGREES : FLOAT_MAX_DEGREES, tangentBound = quantization.directions ? TANGENT_MAX_DEGREES : FLOAT_MAX_DEGREES;
+			return positionHalfSteps <= positionBound && normalDegrees <= normalBound && tangentDegrees <= tangentBound
+				&& tangentSignErrors == 0 && texCoordError <= (quantization.texCoords == VertexFormat::Float32 ? 0.0 : 1.0);
+		}
+
+		void Add(const QuantizationErrors& errors)
+		{
+			positionHalfSteps = (std::max)(positionHalfSteps, errors.positionHalfSteps);
+			normalDegrees = (std::max)(normalDegrees, errors.normalDegrees);
+			tangentDegrees = (std::max)(tangentDegrees, errors.tangentDegrees);
+			tangentSignErrors += errors.tangentSignErrors;
+			texCoordError = (std::max)(texCoordError, errors.texCoordError);
+		}
+	};
+
+	double GetAngleDegrees(const float* a, const float* b)
+	{
+		const double la = std::sqrt(double(a[0]) * a[0] + double(a[1]) * a[1] + double(a[2]) * a[2]);
+		const double lb = std::sqrt(double(b[0]) * b[0] + double(b[1]) * b[1] + double(b[2]) * b[2]);
+		if (!(la > 1e-20) || !(lb > 1e-20) || !std::isfinite(la)) return 0.0;	// Null source vectors have no direction to keep
+		const double dot = (double(a[0]) * b[0] + double(a[1]) * b[1] + double(a[2]) * b[2]) / (la * lb);
+		return std::acos((std::min)(1.0, (std::max)(-1.0, dot))) * 180.0 / 3.14159265358979323846;
+	}
+
+	/** The unorm16 error of a component in half steps of its bounds, float rounding excluded: 1 is the rounding bound */
+	double GetUnormHalfSteps(const float value, const float decoded, const float offset, const float scale)
+	{
+		const double error = std::abs(double(decoded) - value) - FLOAT_ROUNDING * (std::abs(double(value)) + std::abs(double(offset)) + scale);
+		if (error <= 0.0) return 0.0;
+		return scale > 0.0f ? error / (scale * UNORM16_MAX_ERROR) : std::numeric_limits<double>::infinity();
+	}
+
+	/** Decode the packed vertices of mesh and measure their errors against its streams */
+	QuantizationErrors MeasureErrors(const MeshStreams& mesh, const VertexLayout& layout, const PackedVertices& packed)
+	{
+		QuantizationErrors errors;
+		const VertexDequantization& dq = packed.dequantization;
+		for (const VertexElement& element : layout.elements)
+		{
+			const VertexAttributeDesc& desc = GetVertexAttributeDesc(element.attribute);
+			const VertexStream* stream = mesh.Find(desc.gltfSemantic);
+			if (!stream || stream->elementsCount != element.componentsCount) continue;
+
+			const float* offset = nullptr;
+			const float* scale = nullptr;
+			if (element.attribute == VERTEX_ATTRIBUTE_POSITION) { offset = dq.positionOffset; scale = dq.positionScale; }
+			if (element.attribute == VERTEX_ATTRIBUTE_TEXCOORD0) { offset = dq.texCoordTransforms[0] + 2; scale = dq.texCoordTransforms[0]; }
+			std::vector<float> decoded(mesh.verticesCount * element.componentsCount);
+			DecodeVertexElements(element.format, packed.slots[element.slot].data() + element.byteOffset, mesh.verticesCount, layout.slotStrides[element.slot],
+				element.componentsCount, offset, scale, decoded.data());
+
+			for (size_t v = 0; v < mesh.verticesCount; v++)
+			{
+				const float* source = &stream->values[v * element.componentsCount];
+				const float* result = &decoded[v * element.componentsCount];
+				switch (element.attribute)
+				{
+				case VERTEX_ATTRIBUTE_POSITION:
+					for (int c = 0; c < 3; c++)
+					{
+						double halfSteps = (element.format == VertexFormat::Float32) ? (source[c] == result[c] ? 0.0 : 1.0) : GetUnormHalfSteps(source[c], result[c], offset[c], scale[c]);
+						errors.positionHalfSteps = (std::max)(errors.positionHalfSteps, halfSteps);
+					}
+					break;
+				case VERTEX_ATTRIBUTE_NORMAL:
+					errors.normalDegrees = (std::max)(errors.normalDegrees, GetAngleDegrees(source, result));
+					break;
+				case VERTEX_ATTRIBUTE_TANGENT:
+					errors.tangentDegrees = (std::max)(errors.tangentDegrees, GetAngleDegrees(source, result));
+					if (source[3] != 0.0f && (source[3] < 0.0f) != (result[3] < 0.0f)) errors.tangentSignErrors++;
+					break;
+				case VERTEX_ATTRIBUTE_TEXCOORD0:
+					for (int c = 0; c < 2; c++)
+					{
+						double error = 0.0;
+						if (element.format == VertexFormat::Float32) error = (source[c] == result[c]) ? 0.0 : 1.0;
+						else if (element.format == VertexFormat::Unorm16x2) error = GetUnormHalfSteps(source[c], result[c], offset[c], scale[c]);
+						else if (std::abs(source[c]) <= 65504.0f)
+						{
+							error = std::abs(double(result[c]) - source[c]) / (std::max)(std::abs(double(source[c])) * HALF_MAX_RELATIVE_ERROR, HALF_MAX_SUBNORMAL_ERROR);
+						}
+						errors.texCoordError = (std::max)(errors.texCoordError, error);
+					}
+					break;
+				default:
+					break;
+				}
+			}
+		}
+		return errors;
+	}
+
+	/** Random unit vector */
+	void RandomDirection(std::mt19937& random, float v[3])
+	{
+		std::normal_distribution<float> normal;
+		float length = 0.0f;
+		while (!(length > 1e-6f))
+		{
+			for (int c = 0; c < 3; c++) v[c] = normal(random);
+			length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		}
+		for (int c = 0; c < 3; c++) v[c] /= length;
+	}
+
+	/** A sphere away from the origin, with random frames and bitangent signs and texture coordinates spanning several repeats */
+	MeshStreams CreateSphere(const size_t verticesCount, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> uv(-2.0f, 3.0f);
+		std::vector<float> positions, normals, tangents, texCoords;
+		for (size_t v = 0; v < verticesCount; v++)
+		{
+			float n[3], t[3];
+			RandomDirection(random, n);
+			RandomDirection(random, t);
+			const float d = t[0] * n[0] + t[1] * n[1] + t[2] * n[2];
+			for (int c = 0; c < 3; c++) t[c] -= d * n[c];
+			positions.insert(positions.end(), { 100.0f + 12.5f * n[0], -40.0f + 12.5f * n[1], 3.0f + 12.5f * n[2] });
+			normals.insert(normals.end(), { n[0], n[1], n[2] });
+			tangents.insert(tangents.end(), { t[0], t[1], t[2], (random() & 1) ? 1.0f : -1.0f });
+			texCoords.insert(texCoords.end(), { uv(random), uv(random) });
+		}
+
+		MeshStreams mesh;
+		mesh.verticesCount = verticesCount;
+		mesh.SetStream("POSITION", 3, std::move(positions));
+		mesh.SetStream("NORMAL", 3, std::move(normals));
+		mesh.SetStream("TANGENT", 4, std::move(tangents));
+		mesh.SetStream("TEXCOORD_0", 2, std::move(texCoords));
+		return mesh;
+	}
+
+	/**
+	 * The attributes of a KHR_mesh_quantization file as the loader reads them: short positions, byte normalized normals
+	 * and tangents, and unsigned short normalized texture coordinates, converted to floats by the accessor views.
+	 */
+	MeshStreams CreateKhrQuantizedMesh(const size_t verticesCount, std::mt19937& random)
+	{
+		std::uniform_int_distribution<int> position(-30000, 30000), texCoord(0, 65535);
+		MeshStreams mesh = CreateSphere(verticesCount, random);
+		for (float& value : mesh.Find("POSITION")->values) value = static_cast<float>(position(random));
+		for (float& value : mesh.Find("NORMAL")->values) value = std::round(value * 127.0f) / 127.0f;
+		for (float& value : mesh.Find("TEXCOORD_0")->values) value = texCoord(random) / 65535.0f;
+		return mesh;
+	}
+
+	template <class Function>
+	double MedianMilliseconds(const Function& function)
+	{
+		std::vector<double> milliseconds;
+		for (int r = 0; r < QUANTIZATION_REPETITIONS; r++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			function();
+			milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(milliseconds.begin(), milliseconds.end());
+		return milliseconds[milliseconds.size() / 2];
+	}
+
+	/** Quantize the meshes in every case, check their errors and report the bytes saved */
+	bool CheckMeshes(const std::string& name, const std::vector<MeshStreams>& meshes, const bool isLast)
+	{
+		size_t verticesCount = 0;
+		for (const MeshStreams& mesh : meshes) verticesCount += mesh.verticesCount;
+		const size_t floatByteSize = verticesCount * CreateVertexLayout(VERTEX_FEATURES_MESH, VertexSlotsMode::Interleaved).GetVertexByteSize();
+
+		bool isMatch = true;
+		std::cout << "    { \"mesh\": \"" << name << "\", \"primitives\": " << meshes.size() << ", \"vertices\": " << verticesCount << ", \"quantizations\": [" << std::endl;
+		for (size_t c = 0; c < std::size(QUANTIZATION_CASES); c++)
+		{
+			const VertexQuantization& quantization = QUANTIZATION_CASES[c].quantization;
+			VertexLayout layout = CreateVertexLayout(VERTEX_FEATURES_MESH, VertexSlotsMode::Interleaved, quantization);
+			QuantizationErrors errors;
+			for (const MeshStreams& mesh : meshes) errors.Add(MeasureErrors(mesh, layout, PackVertices(mesh, layout)));
+			const bool isWithinBounds = errors.IsWithinBounds(quantization);
+			isMatch &= isWithinBounds;
+
+			double packMs = MedianMilliseconds([&]() { for (const MeshStreams& mesh : meshes) PackVertices(mesh, layout); });
+			const size_t quantizedByteSize = verticesCount * layout.GetVertexByteSize();
+			std::cout << std::fixed << std::setprecision(3)
+				<< "      { \"quantization\": \"" << QUANTIZATION_CASES[c].name << "\", \"vertexBytes\": " << layout.GetVertexByteSize()
+				<< ", \"floatBytes\": " << floatByteSize << ", \"quantizedBytes\": " << quantizedByteSize
+				<< ", \"savedPercent\": " << (floatByteSize > 0 ? 100.0 * (floatByteSize - quantizedByteSize) / floatByteSize : 0.0)
+				<< ", \"packMs\": " << packMs << ", \"packMVerticesps\": " << (packMs > 0.0 ? verticesCount / (packMs * 1e3) : 0.0)
+				<< std::setprecision(6) << ", \"positionHalfSteps\": " << errors.positionHalfSteps << ", \"normalDegrees\": " << errors.normalDegrees
+				<< ", \"tangentDegrees\": " << errors.tangentDegrees << ", \"tangentSignErrors\": " << errors.tangentSignErrors << ", \"texCoordError\": " << errors.texCoordError
+				<< ", \"withinBounds\": " << (isWithinBounds ? "true" : "false") << " }" << (c + 1 == std::size(QUANTIZATION_CASES) ? "" : ",") << std::endl;
+		}
+		std::cout << "    ] }" << (isLast ? "" : ",") << std::endl;
+		return isMatch;
+	}
+
+	/** Every half float must survive a round trip, and the float to half rounding must be to nearest even */
+	bool CheckHalfFloats()
+	{
+		size_t roundTripErrors = 0;
+		for (uint32_t h = 0; h <= 0xFFFF; h++)
+		{
+			const float value = HalfToFloat(static_cast<uint16_t>(h));
+			const uint16_t back = FloatToHalf(value);
+			if (std::isnan(value)) roundTripErrors += (std::isnan(HalfToFloat(back)) && (back & 0x8000u) == (h & 0x8000u)) ? 0 : 1;
+			else roundTripErrors += (back == h) ? 0 : 1;
+		}
+
+		struct Rounding { float value; uint16_t half; };
+		const Rounding ROUNDINGS[] =
+		{
+			{ 65504.0f, 0x7BFF }, { 65519.0f, 0x7BFF }, { 65520.0f, 0x7C00 }, { -1e10f, 0xFC00 },
+			{ 1.0f + 1.0f / 2048.0f, 0x3C00 }, { 1.0f + 3.0f / 2048.0f, 0x3C02 }, { 6.103515625e-05f, 0x0400 },
+			{ 2.98023223876953125e-08f, 0x0000 }, { 8.94069671630859375e-08f, 0x0002 }, { -0.0f, 0x8000 }, { 1e-10f, 0x0000 }
+		};
+		size_t roundingErrors = 0;
+		for (const Rounding& rounding : ROUNDINGS) roundingErrors += (FloatToHalf(rounding.value) == rounding.half) ? 0 : 1;
+
+		const bool isMatch = roundTripErrors == 0 && roundingErrors == 0;
+		std::cout << "  \"halfFloats\": { \"roundTripErrors\": " << roundTripErrors << ", \"roundingErrors\": " << roundingErrors
+			<< ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+
+	/** The axes and the null vector are encoded exactly, in both octahedral formats */
+	bool CheckOctahedralAxes()
+	{
+		const float AXES[][4] = { { 1, 0, 0, 1 }, { -1, 0, 0, -1 }, { 0, 1, 0, 1 }, { 0, -1, 0, -1 }, { 0, 0, 1, 1 }, { 0, 0, -1, -1 }, { 0, 0, 0, 1 } };
+		const float EXPECTED[][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, 0, 1 } };
+		bool isMatch = true;
+		for (size_t a = 0; a < std::size(AXES); a++)
+		{
+			uint8_t encoded[4];
+			float decoded[4];
+			EncodeVertexElements(VertexFormat::OctSnorm16x2, AXES[a], 1, 3, nullptr, nullptr, encoded, sizeof(encoded));
+			DecodeVertexElements(VertexFormat::OctSnorm16x2, encoded, 1, sizeof(encoded), 3, nullptr, nullptr, decoded);
+			isMatch &= std::equal(decoded, decoded + 3, EXPECTED[a]);
+			EncodeVertexElements(VertexFormat::OctSignSnorm16x2, AXES[a], 1, 4, nullptr, nullptr, encoded, sizeof(encoded));
+			DecodeVertexElements(VertexFormat::OctSignSnorm16x2, encoded, 1, sizeof(encoded), 4, nullptr, nullptr, decoded);
+			isMatch &= std::equal(decoded, decoded + 3, EXPECTED[a]) && decoded[3] == AXES[a][3];
+		}
+		std::cout << "  \"octahedralAxes\": { \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+
+	/** The KHR_mesh_quantization positions and texture coordinates lie on an integer grid: they must be stored without loss */
+	bool CheckKhrQuantizedInput(std::mt19937& random)
+	{
+		MeshStreams mesh = CreateKhrQuantizedMesh(1 << 16, random);
+		VertexLayout layout = CreateVertexLayout(VERTEX_FEATURES_MESH, VertexSlotsMode::Interleaved, { true, true, VertexFormat::Unorm16x2 });
+		PackedVertices packed = PackVertices(mesh, layout);
+
+		// Lossless: every decoded value is closer to its source than to the next value of the source grid
+		size_t lostValues = 0;
+		const struct { VertexAttribute attribute; const float* offset; const float* scale; double gridSteps; } CHECKS[] =
+		{
+			{ VERTEX_ATTRIBUTE_POSITION, packed.dequantization.positionOffset, packed.dequantization.positionScale, 1.0 },
+			{ VERTEX_ATTRIBUTE_TEXCOORD0, packed.dequantization.texCoordTransforms[0] + 2, packed.dequantization.texCoordTransforms[0], 65535.0 }
+		};
+		for (const auto& check : CHECKS)
+		{
+			const VertexElement& element = *layout.Find(check.attribute);
+			const VertexStream& stream = *mesh.Find(GetVertexAttributeDesc(check.attribute).gltfSemantic);
+			std::vector<float> decoded(mesh.verticesCount * element.componentsCount);
+			DecodeVertexElements(element.format, packed.slots[0].data() + element.byteOffset, mesh.verticesCount, layout.slotStrides[0], element.componentsCount,
+				check.offset, check.scale, decoded.data());
+			for (size_t i = 0; i < decoded.size(); i++) lostValues += (std::abs(double(decoded[i]) - stream.values[i]) * check.gridSteps < 1.0 / 64.0) ? 0 : 1;
+		}
+
+		const size_t floatByteSize = mesh.verticesCount * CreateVertexLayout(VERTEX_FEATURES_MESH, VertexSlotsMode::Interleaved).GetVertexByteSize();
+		const bool isMatch = lostValues == 0 && MeasureErrors(mesh, layout, packed).IsWithinBounds(layout.quantization);
+		std::cout << "  \"khrMeshQuantization\": { \"vertices\": " << mesh.verticesCount << ", \"floatBytes\": " << floatByteSize
+			<< ", \"quantizedBytes\": " << mesh.verticesCount * layout.GetVertexByteSize() << ", \"lostValues\": " << lostValues
+			<< ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+
+	/** A texture coordinates format that is not 2D and a format used with the wrong components must be rejected */
+	bool CheckInvalidInputs()
+	{
+		bool isLayoutRejected = false, isEncodingRejected = false;
+		try { CreateVertexLayout(VERTEX_FEATURES_MESH, VertexSlotsMode::Interleaved, { false, false, VertexFormat::OctSnorm16x2 }); }
+		catch (const std::invalid_argument&) { isLayoutRejected = true; }
+
+		const float values[3] = { 0.0f, 0.0f, 0.0f };
+		uint8_t encoded[8];
+		try { EncodeVertexElements(VertexFormat::Half2, values, 1, 3, nullptr, nullptr, encoded, sizeof(encoded)); }
+		catch (const std::invalid_argument&) { isEncodingRejected = true; }
+
+		bool isMatch = isLayoutRejected && isEncodingRejected;
+		std::cout << "  \"invalidInputs\": { \"layoutRejected\": " << (isLayoutRejected ? "true" : "false") << ", \"encodingRejected\": "
+			<< (isEncodingRejected ? "true" : "false") << ", \"match\": " << (isMatch ? "true" : "false") << " }," << std::endl;
+		return isMatch;
+	}
+}
+
+namespace Benchmark
+{
+	int RunVertexQuantization(const std::vector<std::string>& args)
+	{
+		std::vector<size_t> verticesCounts;
+		std::vector<std::string> fileNames;
+		for (const std::string& arg : args)
+		{
+			if (!arg.empty() && std::all_of(arg.begin(), arg.end(), ::isdigit)) verticesCounts.push_back(std::stoul(arg));
+			else fileNames.push_back(arg);
+		}
+		if (verticesCounts.empty()) verticesCounts = DEFAULT_QUANTIZATION_VERTICES;
+		if (fileNames.empty()) fileNames = DEFAULT_QUANTIZATION_MODELS;
+		std::mt19937 random(17);
+
+		std::cout << "{" << std::endl;
+		bool isMatch = CheckInvalidInputs();
+		isMatch &= CheckHalfFloats();
+		isMatch &= CheckOctahedralAxes();
+		isMatch &= CheckKhrQuantizedInput(random);
+		std::cout << "  \"meshes\": [" << std::endl;
+		for (size_t verticesCount : verticesCounts)
+		{
+			isMatch &= CheckMeshes("sphere_" + std::to_string(verticesCount), { CreateSphere(verticesCount, random) }, false);
+		}
+		for (size_t f = 0; f < fileNames.size(); f++)
+		{
+			isMatch &= CheckMeshes(std::filesystem::path(fileNames[f]).generic_string(), LoadMeshStreams(fileNames[f]), f + 1 == fileNames.size());
+		}
+		std::cout << "  ]" << std::endl << "}" << std::endl;
+		return isMatch ? 0 : 1;
+	}
+}
+
+#ifdef VERTEX_QUANTIZATION_BENCHMARK_MAIN
+// Standalone build, without the viewer: see the README for the command line
+int main(int argc, char** argv)
+{
+	try
+	{
+		return Benchmark::RunVertexQuantization({ argv + 1, argv + argc });
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
+#endif
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "glTF/tiny_gltf.h"
+
+/** The memory layout of a glTF accessor, as read by the loader */
+struct AccessorDesc
+{
+	const uint8_t* data = nullptr;	/*< The first element */
+	size_t count = 0;
+	size_t byteStride = 0;			/*< 0 when the elements are tightly packed */
+	int componentType = -1;			/*< A TINYGLTF_COMPONENT_TYPE_ value */
+	int elementsCount = 0;			/*< The components of each element, 1 for SCALAR up to 16 for MAT4 */
+	bool normalized = false;
+
+	size_t GetElementSize() const;
+
+	/** Return the bytes spanned by the elements, from the first byte of the first element to the last byte of the last one */
+	size_t GetByteLength() const;
+};
+
+/**
+ * Bulk conversion kernels, specialized for each component type and normalization.
+ * Normalized integers are mapped to [0, 1] or [-1, 1] with the glTF formulas, other integers are converted as they are.
+ * The source may be unaligned, the kernels use SSE2 where it is available.
+ */
+template <class Component, bool Normalized>
+void ConvertToFloat(const uint8_t* src, const size_t count, float* dst);
+
+template <> void ConvertToFloat<float, false>(const uint8_t* src, const size_t count, float* dst);
+template <> void ConvertToFloat<int8_t, false>(const uint8_t* src, const size_t count, float* dst);
+template <> void ConvertToFloat<int8_t, true>(const uint8_t* src, const size_t count, float* dst);
+template <> void ConvertToFloat<uint8_t, false>(const uint8_t* src, const size_t count, float* dst);
+template <> void ConvertToFloat<uint8_t, true>(const uint8_t* src, const size_t count, float* dst);
+template <> void ConvertToFloat<int16_t, false>(const uint8_t* src, const size_t count, float* dst);
+template <> void ConvertToFloat<int16_t, true>(const uint8_t* src, const size_t count, float* dst);
+template <> void ConvertToFloat<uint16_t, false>(const uint8_t* src, const size_t count, float* dst);
+template <> void ConvertToFloat<uint16_t, true>(const uint8_t* src, const size_t count, float* dst);
+template <> void ConvertToFloat<uint32_t, false>(const uint8_t* src, const size_t count, float* dst);
+
+template <class Component>
+void ConvertToUInt32(const uint8_t* src, const size_t count, uint32_t* dst);
+
+template <> void ConvertToUInt32<uint8_t>(const uint8_t* src, const size_t count, uint32_t* dst);
+template <> void ConvertToUInt32<uint16_t>(const uint8_t* src, const size_t count, uint32_t* dst);
+template <> void ConvertToUInt32<uint32_t>(const uint8_t* src, const size_t count, uint32_t* dst);
+
+/**
+ * A typed view over the elements of a glTF accessor, specialized at compile time on the component type,
+ * the number of components per element and the normalization.
+ * Elements can be strided and unaligned: packed views are converted in one pass by the bulk kernels, strided
+ * views are gathered in packed blocks that are converted in turn.
+ */
+template <class Component, size_t Elements, bool Normalized = false>
+class AccessorView
+{
+public:
+	static constexpr size_t ELEMENT_SIZE = sizeof(Component) * Elements;
+
+	AccessorView(const uint8_t* data, const size_t count, const size_t byteStride)
+		: m_data(data), m_count(count), m_byteStride(byteStride == 0 ? ELEMENT_SIZE : byteStride) {}
+
+	size_t GetCount() const { return m_count; }
+	bool IsPacked() const { return m_byteStride == ELEMENT_SIZE; }
+
+	/** Return a component of the element i, as it is stored */
+	Component Get(const size_t i, const size_t component = 0) const
+	{
+		Component value;
+		std::memcpy(&value, m_data + i * m_byteStride + component * sizeof(Component), sizeof(Component));
+		return value;
+	}
+
+	/** Convert every element to Elements floats, out must hold GetCount() * Elements floats */
+	void ReadFloats(float* out) const
+	{
+		ForEachPackedBlock([out](const uint8_t* block, const size_t first, const size_t count)
+			{
+				ConvertToFloat<Component, Normalized>(block, count * Elements, out + first * Elements);
+			});
+	}
+
+	/** Convert every element to an uint32_t, used for indices */
+	void ReadUInt32(uint32_t* out) const
+	{
+		static_assert(Elements == 1 && !Normalized && std::is_unsigned<Component>::value, "Only unsigned scalar accessors can be read as indices");
+		ForEachPackedBlock([out](const uint8_t* block, const size_t first, const size_t count)
+			{
+				ConvertToUInt32<Component>(block, count, out + first);
+			});
+	}
+
+private:
+	static constexpr size_t BLOCK_ELEMENTS = 256;
+
+	template <class F>
+	void ForEachPackedBlock(F&& convert) const
+	{
+		if (IsPacked()) { convert(m_data, 0, m_count); return; }
+
+		uint8_t block[BLOCK_ELEMENTS * ELEMENT_SIZE];
+		for (size_t first = 0; first < m_count; first += BLOCK_ELEMENTS)
+		{
+			size_t count = (std::min)(BLOCK_ELEMENTS, m_count - first);
+			for (size_t i = 0; i < count; i++) std::memcpy(block + i * ELEMENT_SIZE, m_data + (first + i) * m_byteStride, ELEMENT_SIZE);
+			convert(block, first, count);
+		}
+	}
+
+	const uint8_t* m_data = nullptr;
+	size_t m_count = 0;
+	size_t m_byteStride = 0;
+};
+
+/**
+ * Call f with the AccessorView that matches the component type and normalization of accessor.
+ * Throw std::invalid_argument if accessor does not have Elements components or its component type is not supported.
+ */
+template <size_t Elements, class F>
+void VisitAccessorView(const AccessorDesc& accessor, F&& f)
+{
+	if (accessor.elementsCount != static_cast<int>(Elements)) throw std::invalid_argument("Unexpected accessor elements count");
+	const bool n = accessor.normalized;
+	switch (accessor.componentType)
+	{
+	case TINYGLTF_COMPONENT_TYPE_FLOAT: f(AccessorView<float, Elements>(accessor.data, accessor.count, accessor.byteStride)); return;
+	case TINYGLTF_COMPONENT_TYPE_BYTE:
+		if (n) f(AccessorView<int8_t, Elements, true>(accessor.data, accessor.count, accessor.byteStride));
+		else f(AccessorView<int8_t, Elements>(accessor.data, accessor.count, accessor.byteStride));
+		return;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+		if (n) f(AccessorView<uint8_t, Elements, true>(accessor.data, accessor.count, accessor.byteStride));
+		else f(AccessorView<uint8_t, Elements>(accessor.data, accessor.count, accessor.byteStride));
+		return;
+	case TINYGLTF_COMPONENT_TYPE_SHORT:
+		if (n) f(AccessorView<int16_t, Elements, true>(accessor.data, accessor.count, accessor.byteStride));
+		else f(AccessorView<int16_t, Elements>(accessor.data, accessor.count, accessor.byteStride));
+		return;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+		if (n) f(AccessorView<uint16_t, Elements, true>(accessor.data, accessor.count, accessor.byteStride));
+		else f(AccessorView<uint16_t, Elements>(accessor.data, accessor.count, accessor.byteStride));
+		return;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: f(AccessorView<uint32_t, Elements>(accessor.data, accessor.count, accessor.byteStride)); return;
+	}
+	throw std::invalid_argument("Unsupported accessor component type");
+}
+
+/** Convert the elements of any SCALAR to VEC4 or MAT4 accessor to floats, out must hold count * elementsCount floats */
+void ReadAccessorFloats(const AccessorDesc& accessor, float* out);
+
+/** Convert the elements of an unsigned SCALAR accessor to uint32_t, out must hold count values */
+void ReadAccessorUInt32(const AccessorDesc& accessor, uint32_t* out);
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <mutex>
+#include <thread>
+
+#include "DXUtil.h"
+#include "GLTFSceneLoader.h"
+
+class Scene;
+
+/**
+ * Loads glTF scenes on background threads.
+ * Parsing, CPU preprocessing, texture decoding and GPU uploads run off the render loop, which keeps drawing its
+ * current scene and swaps in the new one, fully uploaded, when TakeScene returns it.
+ */
+class AsyncSceneLoader
+{
+public:
+	AsyncSceneLoader(Microsoft::WRL::ComPtr<ID3D12Device> device, Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue);
+	AsyncSceneLoader(const AsyncSceneLoader&) = delete;
+	AsyncSceneLoader& operator=(const AsyncSceneLoader&) = delete;
+	~AsyncSceneLoader();
+
+	/** Start loading the first scene of fileName, the loading in progress, if any, is cancelled */
+	void Start(const std::string& fileName);
+
+	/** Cancel the loading in progress, its scene is discarded */
+	void Cancel();
+
+	bool IsLoading() const;
+
+	/** Return the progress of the current loading, or of the last one when none is in progress */
+	const LoadingProgress& GetProgress() const;
+
+	/** Return the loaded scene once, nullptr if no new scene is ready */
+	std::shared_ptr<Scene> TakeScene();
+
+	/** Return the error of the last failed loading once, an empty string if there is none */
+	std::string TakeError();
+
+private:
+	struct Job
+	{
+		std::thread thread;
+		std::shared_ptr<LoadingProgress> progress;
+	};
+
+	void RunJob(const std::string fileName, std::shared_ptr<LoadingProgress> progress);
+	void JoinFinishedJobs(const bool waitAll);
+
+	Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_commandQueue;
+	std::vector<Job> m_jobs;	// The last job is the current one, the others have been cancelled and are terminating
+	std::shared_ptr<LoadingProgress> m_progress;
+
+	std::mutex m_mutex;		// Guards the results published by the jobs
+	std::shared_ptr<Scene> m_loadedScene;
+	std::string m_error;
+};
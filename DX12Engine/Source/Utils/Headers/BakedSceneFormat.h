@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Binary layout of a baked scene file (.gltfbake).
+ *
+ * A baked scene holds everything GLTFSceneLoader produces for a scene, ready to be copied to the GPU: the buffers
+ * as they are uploaded (geometry ranges, packed and quantized vertices, generated normals and tangents), the decoded images with their mip chains,
+ * and fixed size records for nodes, meshes, submeshes with their levels of detail and meshlets, materials, lights, samplers and textures.
+ *
+ *  [BakedSceneHeader][payloads, each aligned to BAKED_SCENE_PAYLOAD_ALIGNMENT][record tables]
+ *
+ * The file is memory mapped by BakedSceneLoader and the records are read in place, so every structure here has a
+ * fixed size and no implicit padding. Any change to the layout, or to how the payloads are encoded (such as the
+ * counter clockwise winding of the indices), must increase BAKED_SCENE_VERSION.
+ */
+
+constexpr char BAKED_SCENE_MAGIC[8] = { 'G', 'L', 'T', 'F', 'B', 'A', 'K', 'E' };
+constexpr uint32_t BAKED_SCENE_VERSION = 8;
+constexpr uint64_t BAKED_SCENE_PAYLOAD_ALIGNMENT = 64 * 1024;	// The placement alignment of D3D12 buffers and textures
+constexpr const char* BAKED_SCENE_EXTENSION = ".gltfbake";
+
+/** Sections of the record tables */
+enum BakedSceneSection : uint32_t
+{
+	BAKED_SECTION_NODES = 0,
+	BAKED_SECTION_MESHES,
+	BAKED_SECTION_SUBMESHES,
+	BAKED_SECTION_MATERIALS,
+	BAKED_SECTION_LIGHTS,
+	BAKED_SECTION_SAMPLERS,
+	BAKED_SECTION_TEXTURES,
+	BAKED_SECTION_IMAGES,
+	BAKED_SECTION_MIP_LEVELS,
+	BAKED_SECTION_BUFFERS,
+	BAKED_SECTION_SUBMESH_LODS,
+	BAKED_SECTION_MESHLETS,
+	BAKED_SECTIONS_COUNT
+};
+
+/** A table of records in the file */
+struct BakedSectionDesc
+{
+	uint64_t byteOffset = 0;
+	uint64_t count = 0;
+};
+
+struct BakedSceneHeader
+{
+	char magic[8] = {};
+	uint32_t version = 0;
+	uint32_t rootNodesCount = 0;
+	uint64_t fileByteSize = 0;
+	uint32_t vertexSlotsMode = 0;	// The VertexSlotsMode and the VertexFeatures of the layout the vertex buffers are packed in
+	uint32_t vertexFeatures = 0;
+	uint32_t quantizedPositions = 0;	// The VertexQuantization of the layout
+	uint32_t quantizedDirections = 0;
+	uint32_t texCoordsFormat = 0;		// A VertexFormat value
+	uint32_t _pad0 = 0;
+	BakedSectionDesc sections[BAKED_SECTIONS_COUNT];
+};
+
+/** A range of bytes in the file, aligned to BAKED_SCENE_PAYLOAD_ALIGNMENT */
+struct BakedPayload
+{
+	uint64_t byteOffset = 0;
+	uint64_t byteSize = 0;
+};
+
+/** A scene node, nodes are stored in depth first order and each node is followed by its children subtrees */
+struct BakedNode
+{
+	int32_t meshId = -1;
+	uint32_t childrenCount = 0;
+	float transformMtx[16] = {};
+};
+
+struct BakedMesh
+{
+	uint32_t meshId = 0;
+	uint32_t firstSubMesh = 0;
+	uint32_t subMeshesCount = 0;
+	uint32_t _pad0 = 0;
+};
+
+/** A BufferView, bufferId is an index in the buffers section */
+struct BakedBufferView
+{
+	int32_t bufferId = -1;
+	uint8_t elemType = 0;
+	uint8_t componentType = 0;
+	uint16_t _pad0 = 0;
+	uint64_t byteOffset = 0;
+	uint64_t byteLength = 0;
+	uint64_t byteStride = 0;
+	uint64_t count = 0;
+};
+
+/** The buffer views of a submesh, in the order of the SubMesh fields */
+enum BakedSubMeshView : uint32_t
+{
+	BAKED_VIEW_VERTICES = 0,
+	BAKED_VIEW_COLORS,
+	BAKED_VIEW_NORMALS,
+	BAKED_VIEW_TANGENTS,
+	BAKED_VIEW_TEXCOORD0,
+	BAKED_VIEW_TEXCOORD1,
+	BAKED_VIEW_INDICES,
+	BAKED_VIEWS_COUNT
+};
+
+struct BakedSubMesh
+{
+	BakedBufferView views[BAKED_VIEWS_COUNT];
+	uint32_t materialId = 0;
+	uint32_t topology = 0;			// A D3D_PRIMITIVE_TOPOLOGY value
+	uint32_t firstLod = 0;			// Index in the submesh lods section
+	uint32_t lodsCount = 0;
+	float boundingSphere[4] = {};	// Center and radius
+	float boundsMin[4] = {};		// The bounding box of the positions, the fourth components are not used
+	float boundsMax[4] = {};
+	uint32_t firstMeshlet = 0;		// Index in the meshlets section
+	uint32_t meshletsCount = 0;
+	float positionScale[4] = {};	// The VertexDequantization of the submesh
+	float positionOffset[4] = {};
+	float texCoordTransforms[2][4] = {};
+	uint32_t octahedralDirections = 0;
+	uint32_t _pad0 = 0;
+};
+
+/** A level of detail of a submesh, the indices address the submesh vertex buffers */
+struct BakedSubMeshLod
+{
+	BakedBufferView indices;
+	float error = 0.0f;
+	uint32_t _pad0 = 0;
+};
+
+/** A meshlet of a submesh, as the Meshlet built by the loader */
+struct BakedMeshlet
+{
+	uint32_t firstIndex = 0;
+	uint32_t indicesCount = 0;
+	uint32_t verticesCount = 0;
+	float center[3] = {};
+	float radius = 0.0f;
+	float aabbMin[3] = {};
+	float aabbMax[3] = {};
+	float coneApex[3] = {};
+	float coneAxis[3] = {};
+	float coneCutoff = 0.0f;
+};
+
+/** A material, the data is the RoughMetallicMaterial constant buffer data */
+struct BakedMaterial
+{
+	uint32_t id = 0;
+	uint32_t byteSize = 0;
+	uint8_t data[256] = {};
+};
+
+/** A light, the data is the Light constant buffer data */
+struct BakedLight
+{
+	uint32_t id = 0;
+	uint32_t byteSize = 0;
+	uint8_t data[64] = {};
+};
+
+/** A sampler, the data is a D3D12_SAMPLER_DESC */
+struct BakedSampler
+{
+	uint32_t id = 0;
+	uint32_t byteSize = 0;
+	uint8_t data[64] = {};
+};
+
+struct BakedTexture
+{
+	uint32_t textureId = 0;
+	uint32_t imageId = 0;
+};
+
+/** An RGBA8 image, its mip levels are tightly packed in the payload */
+struct BakedImage
+{
+	BakedPayload payload;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t firstMipLevel = 0;		// Index in the mip levels section
+	uint32_t mipLevelsCount = 0;
+};
+
+struct BakedMipLevel
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint64_t byteOffset = 0;	// Offset from the image payload
+};
+
+struct BakedBuffer
+{
+	BakedPayload payload;
+};
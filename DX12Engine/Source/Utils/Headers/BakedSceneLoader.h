@@ -0,0 +1,48 @@
+#pragma once
+
+#include "GLTFSceneLoader.h"
+#include "BakedSceneFormat.h"
+#include "Buffers.h"
+
+/**
+ * Load a Scene from a baked scene file written by SceneBaker.
+ * The file is memory mapped and its records are read in place, buffers and images are copied to the GPU
+ * straight from the mapping with one upload batch: nothing is parsed, decoded or computed.
+ */
+class BakedSceneLoader
+{
+public:
+	BakedSceneLoader(Microsoft::WRL::ComPtr<ID3D12Device> device, Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue);
+
+	/** Map a baked scene file and check its header, throw if it is not a baked scene of the supported version */
+	void Load(const std::string& fileName);
+
+	/** Report the loading progress to progress and stop when it is cancelled, progress must outlive the loading */
+	void SetProgress(LoadingProgress* progress);
+
+	/** Create the scene of the loaded file */
+	void GetScene(std::shared_ptr<Scene>& scene);
+
+	/** Return true if fileName has the baked scene extension */
+	static bool IsBakedSceneFile(const std::string& fileName);
+
+protected:
+	/** Return the records of a section, throw if the section is out of the file */
+	template <class T>
+	const T* GetSection(const BakedSceneSection section) const;
+
+	size_t GetSectionCount(const BakedSceneSection section) const;
+	ByteSpan GetPayload(const BakedPayload& payload) const;
+	BufferView GetBufferView(const BakedBufferView& bakedView) const;
+	void ParseSceneNode(size_t& nodeId, const int parentId, Scene* scene) const;
+
+	void CheckCancelled() const;
+	void ReportProgress(const size_t bytesDone, const size_t objectsDone);
+
+	std::unique_ptr<MappedFile> m_mappedFile;
+	BakedSceneHeader m_header;
+	LoadingProgress* m_progress = nullptr;
+
+	Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_commandQueue;
+};
\ No newline at end of file
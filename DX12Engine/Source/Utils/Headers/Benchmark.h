@@ -0,0 +1,110 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * Headless benchmarks, run from the command line instead of the viewer. Results are printed to the console as JSON.
+ *
+ *  --bench-glb [file.glb ...]	Compare wall time and peak memory of the tinygltf reference, the read and the memory mapped .glb loading,
+ *								each load runs in its own process so that peak memory is measured independently
+ *  --bench-residency [file ...]	Report the GPU geometry bytes saved by uploading each buffer view once
+ *  --bench-upload-plan [requests ...]	Pack synthetic scene uploads and edge cases into staging batches and validate the plans
+ *  --bench-baked [file ...]			Bake the glTF files, then compare the time to open the glTF and the baked scene
+ *  --bench-texture-decode [path ...]	Decode images and generate their mip chains with 1..N threads, report MPixel/s
+ *  --bench-gltf-parse [path ...]		Check that GLTFJsonReader and tinygltf read the same model, compare their parse MB/s
+ *  --bench-load [--runs n] [--baseline file.json] [--threshold percent] [path ...]
+ *										Open the glTF files n times, report median and p95 of each loading phase, flag the phases
+ *										slower than a saved output by more than threshold percent
+ *  --bench-accessors [count]			Check the accessor views against a scalar conversion, compare their M elements/s
+ *  --bench-normals [triangles ...]		Check the parallel vertex normals against a scalar reference, compare their time
+ *  --bench-tangents [file.glb ...]		Check the tangents against the golden TANGENT of the models, report the triangles/s
+ *  --bench-mesh-optimization [file ...]	Optimize the models triangle lists for the vertex cache, check them and report ACMR/ATVR
+ *  --bench-weld [vertices ...] [file ...]	Weld unindexed synthetic meshes and the models, check them against a single threaded map
+ *  --bench-simplify [file ...]			Generate the levels of detail of the models and of a seamed grid, check their triangles and seams
+ *  --bench-meshlets [file ...]			Split the models and a sphere in meshlets, check their bounds and culling, report clusters/ms
+ *  --bench-vertex-layout [vertices ...] [file ...]	Pack random meshes and the models in each vertex layout, check them bit for bit, report GB/s
+ *  --bench-vertex-quantization [vertices ...] [file ...]	Quantize spheres and the models, check the error bounds, report the bytes saved
+ *  --bench-topology [vertices ...] [file ...]	Normalize each primitive mode, random strips, fans and lists and the models, check them against a reference
+ *  --bench-bounds [points ...] [file ...]	Bound random clouds, hierarchies and the models, check them against the transformed points, report M points/s
+ *  --bench-bvh [triangles ...] [file ...]	Build the hierarchies of random soups and the models, check their rays against brute force, report M rays/s
+ *  --bench-transforms [nodes ...]		Place random node forests with TransformHierarchy and a pointer tree recursion, check their world matrices
+ *  --bench-frustum [objects ...]		Cull hand placed and random boxes against camera frustums, check them against a scalar reference, report M objects/s
+ *  --bench-scene-bvh [objects ...]	Cull, refit and query a hierarchy over the parts of transformed assemblies, check it against the flat culling, report the times
+ *  --bench-occlusion [file ...]		Rasterize occluders into a coarse depth buffer and test boxes behind them, check the culled ones with rays, report the frame times
+ *  --bench-instancing [instances ...]	Group the visible submeshes of scenes into instanced draws, check them against a stable sort by key, report the draws and times
+ */
+namespace Benchmark
+{
+	/** Return true if the command line arguments select a benchmark */
+	bool IsBenchmarkCommandLine(const std::vector<std::string>& args);
+
+	/** Run the benchmark selected by the command line arguments, return the process exit code */
+	int Run(const std::vector<std::string>& args);
+
+	/** Collect the .gltf and .glb files in paths, directories are recursed */
+	std::vector<std::string> FindGLTFFiles(const std::vector<std::string>& paths);
+
+	/** Escape the quotes, backslashes and new lines of text for a JSON string */
+	std::string EscapeJson(const std::string& text);
+
+	/** Decode and mip the images in args (files or directories) with an increasing number of threads, it has no Windows dependencies */
+	int RunTextureDecode(const std::vector<std::string>& args);
+
+	/** Check the parity of GLTFJsonReader with tinygltf on the glTF files in args (files or directories), then compare their parse throughput, it has no Windows dependencies */
+	int RunGLTFParse(const std::vector<std::string>& args);
+
+	/** Convert synthetic accessors of every component type, elements count and layout with AccessorView and a scalar reference, it has no Windows dependencies */
+	int RunAccessorViews(const std::vector<std::string>& args);
+
+	/** Generate the normals of synthetic meshes of args triangles with GenerateNormals and a scalar reference, it has no Windows dependencies */
+	int RunNormals(const std::vector<std::string>& args);
+
+	/** Generate the tangents of the .glb files in args and of synthetic meshes, checked against the files TANGENT, it has no Windows dependencies */
+	int RunTangents(const std::vector<std::string>& args);
+
+	/** Optimize the triangle lists of the glTF files in args and of a shuffled grid, checked to draw the same triangles, it has no Windows dependencies */
+	int RunMeshOptimization(const std::vector<std::string>& args);
+
+	/** Weld synthetic unindexed meshes of args vertices and the glTF files in args, checked against an unordered_map welding, it has no Windows dependencies */
+	int RunWelding(const std::vector<std::string>& args);
+
+	/** Generate the levels of detail of the glTF files in args and of a grid with a texture seam, checked to keep its borders and seam, it has no Windows dependencies */
+	int RunSimplification(const std::vector<std::string>& args);
+
+	/** Build the meshlets of the glTF files in args and of a sphere and cull them against random views, checked to be conservative, it has no Windows dependencies */
+	int RunMeshlets(const std::vector<std::string>& args);
+
+	/** Pack random meshes of args vertices and the glTF files in args in every vertex layout, checked bit for bit against a scalar packing, it has no Windows dependencies */
+	int RunVertexLayout(const std::vector<std::string>& args);
+
+	/** Quantize spheres of args vertices and the glTF files in args, checked against the error bounds of each format, it has no Windows dependencies */
+	int RunVertexQuantization(const std::vector<std::string>& args);
+
+	/** Normalize the topology of cases of every primitive mode, of random primitives of args vertices and of the glTF files in args, checked against a reference, it has no Windows dependencies */
+	int RunTopology(const std::vector<std::string>& args);
+
+	/** Bound random clouds of args points, random node hierarchies and the glTF files in args, checked against their brute force transformed points, it has no Windows dependencies */
+	int RunBounds(const std::vector<std::string>& args);
+
+	/** Build the hierarchies of random soups of args triangles and of the glTF files in args and trace rays through them, checked against a brute force loop, it has no Windows dependencies */
+	int RunMeshBVH(const std::vector<std::string>& args);
+
+	/** Place random node forests of args nodes with TransformHierarchy after full and partial edits and with a pointer tree recursion, checked to give the same world matrices, it has no Windows dependencies */
+	int RunTransformHierarchy(const std::vector<std::string>& args);
+
+	/** Cull edge cases and random objects of args counts against camera frustums with CullBounds and a scalar reference, checked to give the same lists and to keep every object with a point in the frustum, it has no Windows dependencies */
+	int RunFrustumCulling(const std::vector<std::string>& args);
+
+	/** Build, refit and cull a DynamicBVH over scenes of args counts of parts, checked to keep exact node boxes and to give the lists of a test of every part, it has no Windows dependencies */
+	int RunDynamicBVH(const std::vector<std::string>& args);
+
+	/** Cull hand placed and random boxes and grids of the args glTF files with an OcclusionBuffer, checked to hide only the boxes no pixel center ray reaches, it has no Windows dependencies */
+	int RunOcclusionCulling(const std::vector<std::string>& args);
+
+	/** Plan synthetic scene uploads of args requests with several staging budgets and hand built edge cases, checked to be valid, aligned and to refuse bad arguments, it has no Windows dependencies */
+	int RunUploadPlan(const std::vector<std::string>& args);
+
+	/** Batch the visible submeshes of a 100K bolts scene and of scenes of args counts of instances with an InstanceBatcher, checked against a stable sort of the instances by key, it has no Windows dependencies */
+	int RunInstanceBatching(const std::vector<std::string>& args);
+}
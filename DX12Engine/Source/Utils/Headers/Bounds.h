@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+/** An axis aligned bounding box, empty until a point is added: its min is then greater than its max */
+struct BoundingBox
+{
+	float min[3] = { (std::numeric_limits<float>::max)(), (std::numeric_limits<float>::max)(), (std::numeric_limits<float>::max)() };
+	float max[3] = { -(std::numeric_limits<float>::max)(), -(std::numeric_limits<float>::max)(), -(std::numeric_limits<float>::max)() };
+
+	bool IsEmpty() const;
+	void Add(const float point[3]);
+	void Add(const BoundingBox& box);
+};
+
+/** A bounding sphere, a radius of 0 with an empty box */
+struct BoundingSphere
+{
+	float center[3] = {};
+	float radius = 0.0f;
+};
+
+/**
+ * Return the bounding box of count points, x y z floats byteStride bytes apart (0 when they are tightly packed).
+ * The min/max reduction runs on SSE2 where it is available, four points per iteration for tightly packed points.
+ */
+BoundingBox ComputeBoundingBox(const float* points, const size_t count, const size_t byteStride = 0);
+
+/** Return the bounding box of x y z triples */
+BoundingBox ComputeBoundingBox(const std::vector<float>& points);
+
+/**
+ * Return the bounding box of box transformed by matrix, an affine row major matrix applied to row vectors as DirectXMath does.
+ * The center is transformed and the half extents are multiplied by the absolute values of the matrix (Arvo's method): the result
+ * is the bounding box of the eight transformed corners, without transforming them. An empty box stays empty.
+ */
+BoundingBox TransformBoundingBox(const BoundingBox& box, const float matrix[16]);
+
+/** Return the sphere around box: its center and half its diagonal */
+BoundingSphere GetBoundingSphere(const BoundingBox& box);
+
+/** Return sphere transformed by the affine matrix, its radius scaled by the largest stretch of the matrix, or a bound of it under a shear */
+BoundingSphere TransformBoundingSphere(const BoundingSphere& sphere, const float matrix[16]);
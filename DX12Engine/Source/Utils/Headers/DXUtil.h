@@ -115,4 +115,10 @@ namespace DXUtil
 
     /* Store an indentity matmrix in a XMFLOAT4X4 */
     DirectX::XMFLOAT4X4 RightToLeftHandedMtx();
+
+    /** Attach stdout and stderr to the console of the parent process, used by the command line tools */
+    void AttachParentConsole();
+
+    /** Create a device on the default adapter, or on WARP if it fails, and a direct command queue, for work without a window */
+    void CreateHeadlessDevice(Microsoft::WRL::ComPtr<ID3D12Device>& device, Microsoft::WRL::ComPtr<ID3D12CommandQueue>& commandQueue);
 }
\ No newline at end of file
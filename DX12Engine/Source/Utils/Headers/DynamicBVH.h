@@ -0,0 +1,97 @@
+#pragma once
+
+#include "FrustumCulling.h"
+#include "MeshBVH.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+/** The work done by the last DynamicBVH::Update */
+struct DynamicBVHUpdate
+{
+	size_t movedObjectsCount = 0;
+	size_t refittedNodesCount = 0;
+	bool isFullRefit = false;	/*< Every node was refitted, on the pool threads */
+	bool isRebuilt = false;		/*< The hierarchy was built again, its cost had grown too much or an object left out got bounds */
+	double cost = 0.0;			/*< The surface area cost of the hierarchy after the update, relative to its root */
+};
+
+/**
+ * A hierarchy over the boxes of a CullingBounds, kept in step with it as the objects move. Moving objects only marks them, Update then
+ * refits the leaves of the moved objects and their ancestors, or every node on the pool threads when many objects moved. The surface
+ * area cost of the hierarchy is kept up to date by the refits: it is built again when the cost grows past REBUILD_COST_RATIO times the
+ * cost of the last build, as objects drift apart from the objects they were grouped with.
+ * The objects that are never visible (an empty box) are left out of the hierarchy and out of every query result.
+ */
+class DynamicBVH
+{
+public:
+	static constexpr double REBUILD_COST_RATIO = 1.5;
+
+	/** Build the hierarchy over the objects of bounds, its objects count is then fixed until the next Build */
+	void Build(const CullingBounds& bounds, ThreadPool& pool, const BVHOptions& options = BVHOptions());
+
+	void Clear();
+
+	/** Mark an object whose bounds changed, it is refitted by the next Update */
+	void MarkMoved(const size_t object);
+
+	/** Mark every object, as after a change of the transformation above all of them */
+	void MarkAllMoved();
+
+	/** Refit the hierarchy to the moved objects bounds in bounds, the same objects it was built on, or build it again if its cost grew too much */
+	DynamicBVHUpdate Update(const CullingBounds& bounds, ThreadPool& pool);
+
+	/**
+	 * Write the objects that may be in the frustum to visible, in increasing order, and return their count: the same objects as CullBounds.
+	 * A subtree whose box is outside a plane is skipped, a subtree whose box is inside every plane is accepted without testing its
+	 * objects, and below a node only the planes its box straddles are tested again
+	 */
+	size_t Cull(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visible) const;
+
+	/** Write the objects whose box intersects region to objects, in increasing order, and return their count */
+	size_t Query(const BoundingBox& region, const CullingBounds& bounds, std::vector<uint32_t>& objects) const;
+
+	/** Write the objects whose box ray hits for tMin <= t <= tMax to objects, in increasing order, and return their count */
+	size_t Query(const Ray& ray, const CullingBounds& bounds, std::vector<uint32_t>& objects) const;
+
+	bool IsEmpty() const { return m_nodes.empty(); }
+	size_t GetObjectsCount() const { return m_objectLeaves.size(); }
+	const std::vector<BVHNode>& GetNodes() const { return m_nodes; }
+
+	/** Return the object of each slot of the hierarchy order, a node holds the slots [firstSlot, firstSlot + slotsCount) */
+	const std::vector<uint32_t>& GetOrder() const { return m_order; }
+	uint32_t GetFirstSlot(const size_t nodeId) const { return m_firstSlots[nodeId]; }
+	uint32_t GetSlotsCount(const size_t nodeId) const { return m_slotsCounts[nodeId]; }
+
+	/** Return the surface area cost of the hierarchy as of the last Build or Update, and as of the last Build */
+	double GetCost() const;
+	double GetBuildCost() const { return m_buildCost; }
+
+private:
+	void RefitNode(const uint32_t nodeId, const CullingBounds& bounds);
+	double GetNodeCost(const uint32_t nodeId) const;
+	void SetRefitTasks(const size_t threadsCount);
+
+	BVHOptions m_options;
+	std::vector<BVHNode> m_nodes;			/*< The root first, children after their parent */
+	std::vector<uint32_t> m_order;
+	std::vector<uint32_t> m_parents;		/*< UINT32_MAX for the root */
+	std::vector<uint32_t> m_firstSlots;		/*< The slots of the objects below each node */
+	std::vector<uint32_t> m_slotsCounts;
+	std::vector<uint32_t> m_objectLeaves;	/*< The leaf of each object, UINT32_MAX for an object left out of the hierarchy */
+
+	std::vector<uint32_t> m_movedObjects;
+	std::vector<uint8_t> m_isMoved;
+	bool m_areAllMoved = false;
+	std::vector<uint8_t> m_isNodeDirty;		/*< Scratch flags of the incremental refit */
+
+	std::vector<uint32_t> m_refitTasks;		/*< Roots of the subtrees refitted by a pool task each */
+	std::vector<uint32_t> m_upperNodes;		/*< The nodes above them, refitted after the tasks in decreasing order */
+
+	double m_costSum = 0.0;					/*< Sum of the area times the cost of each node, divided by the root area it gives the cost */
+	double m_buildCost = 0.0;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Bounds.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** A convex volume bounded by six planes a, b, c, d with a unit normal pointing inside: left, right, bottom, top, near, far */
+struct Frustum
+{
+	float planes[6][4] = {};
+};
+
+/**
+ * The world bounds of the objects to cull, a box and a sphere each, as a structure of arrays so that four objects are loaded at once.
+ * The arrays are padded to a multiple of four objects with objects that are never visible
+ */
+struct CullingBounds
+{
+	size_t count = 0;
+	std::vector<float> boxCenters[3];
+	std::vector<float> boxExtents[3];		/*< Half sizes of the boxes */
+	std::vector<float> sphereCenters[3];
+	std::vector<float> sphereRadii;			/*< Minus infinity for an object that is never visible */
+
+	/** Set the objects count, the added objects are never visible until they are set */
+	void Resize(const size_t objectsCount);
+
+	/** Set the bounds of an object, an empty box is never visible. The sphere need not be centered on the box */
+	void Set(const size_t object, const BoundingBox& box, const BoundingSphere& sphere);
+};
+
+/**
+ * Return the frustum of viewProjection, a row major matrix applied to row vectors as DirectXMath does, to a Direct3D clip space
+ * with 0 <= z <= w. The planes are in the space the matrix is applied to: world space for a view projection matrix
+ */
+Frustum GetFrustum(const float viewProjection[16]);
+
+/**
+ * Write the indices of the objects that may be in the frustum to visible, in increasing order, and return their count. An object is
+ * culled if its box or its sphere is entirely outside one of the planes, so objects straddling a plane are kept. Four objects are
+ * tested at once with SSE2 where it is available.
+ */
+size_t CullBounds(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visible);
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "glTF/tiny_gltf.h"
+
+/** The JSON and BIN chunks of a .glb file */
+struct GLBChunks
+{
+	const char* json = nullptr;
+	size_t jsonSize = 0;
+	const uint8_t* bin = nullptr;	/*< Null when the file has no BIN chunk */
+	size_t binSize = 0;
+};
+
+/**
+ * Streaming glTF JSON reader.
+ * The document is read token by token and the tinygltf::Model fields used by the viewer are filled straight from
+ * the tokens, without building a JSON DOM: keys are compared in place, strings are only allocated when they are
+ * stored and numbers are parsed with an exact fast path. Buffers and images are described but their data is not read.
+ * Animations, skins, cameras, extras and extensions other than KHR_lights_punctual are skipped.
+ * It has no Windows dependencies.
+ */
+class GLTFJsonReader
+{
+public:
+	/** Parse a glTF JSON document into model, throw std::runtime_error with the byte offset of the first error */
+	void Parse(const char* json, const size_t size, tinygltf::Model& model);
+
+	/** Return the byteLength of each buffer of the last parsed document */
+	const std::vector<size_t>& GetBuffersByteLength() const;
+
+	/** Split a .glb file into its chunks, throw std::runtime_error if the container is malformed */
+	static GLBChunks ReadGLBChunks(const uint8_t* data, const size_t size);
+
+	/** Return true if uri is a base64 data uri and decode it into data */
+	static bool DecodeDataURI(const std::string& uri, std::vector<unsigned char>& data);
+
+private:
+	template <class F> void ForEachMember(F&& onMember);
+	template <class F> void ForEachElement(F&& onElement);
+	template <class T> void ReadObjects(std::vector<T>& objects, void (GLTFJsonReader::*readObject)(T&));
+
+	void SkipWhitespace();
+	void Expect(const char c);
+	bool Consume(const char c);
+	[[noreturn]] void Fail(const char* message) const;
+
+	std::string_view ReadKey(std::string& escapedKey);
+	std::string ReadString();
+	double ReadNumber();
+	int ReadInt();
+	size_t ReadSize();
+	bool ReadBool();
+	void ReadNumbers(std::vector<double>& values);
+	void ReadInts(std::vector<int>& values);
+	void SkipString();
+	void SkipValue();
+
+	void ReadAsset(tinygltf::Asset& asset);
+	void ReadScene(tinygltf::Scene& scene);
+	void ReadNode(tinygltf::Node& node);
+	void ReadMesh(tinygltf::Mesh& mesh);
+	void ReadPrimitive(tinygltf::Primitive& primitive);
+	void ReadAccessor(tinygltf::Accessor& accessor);
+	void ReadBufferView(tinygltf::BufferView& bufferView);
+	void ReadBuffer(tinygltf::Buffer& buffer, size_t& byteLength);
+	void ReadImage(tinygltf::Image& image);
+	void ReadTexture(tinygltf::Texture& texture);
+	void ReadSampler(tinygltf::Sampler& sampler);
+	void ReadMaterial(tinygltf::Material& material);
+	void ReadTextureInfo(tinygltf::TextureInfo& textureInfo);
+	void ReadNormalTextureInfo(tinygltf::NormalTextureInfo& textureInfo);
+	void ReadOcclusionTextureInfo(tinygltf::OcclusionTextureInfo& textureInfo);
+	void ReadPbrMetallicRoughness(tinygltf::PbrMetallicRoughness& pbr);
+	void ReadRootExtensions(tinygltf::Model& model);
+	void ReadLight(tinygltf::Light& light);
+
+	const char* m_begin = nullptr;
+	const char* m_cursor = nullptr;
+	const char* m_end = nullptr;
+	int m_depth = 0;	// Nesting of the current value, bounded so that malformed documents cannot exhaust the stack
+	std::vector<size_t> m_buffersByteLength;
+};
\ No newline at end of file
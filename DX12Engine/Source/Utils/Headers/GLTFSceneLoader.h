@@ -1,23 +1,168 @@
 #pragma once
 
 #include <string>
+#include <atomic>
 
 #include "DXUtil.h"
+#include "MappedFile.h"
+#include "GeometryResidency.h"
+#include "UploadBatch.h"
+#include "TextureDecoder.h"
+#include "AccessorView.h"
+#include "LoadProfile.h"
+#include "MeshNormals.h"
+#include "MeshTangents.h"
+#include "MeshOptimization.h"
+#include "MeshWelding.h"
+#include "MeshSimplification.h"
+#include "Meshlets.h"
+#include "VertexLayout.h"
+#include "MeshTopology.h"
+#include "Bounds.h"
+#include "MeshBVH.h"
 
 class Scene;
-struct SceneNode;
+struct BufferView;
+struct SubMesh;
+struct MeshStreams;
+
+/** Progress of a scene loading, written by the loading thread and readable from any thread */
+struct LoadingProgress
+{
+	std::atomic<size_t> bytesDone{ 0 };		/*< Bytes of geometry and images processed */
+	std::atomic<size_t> bytesTotal{ 0 };
+	std::atomic<size_t> objectsDone{ 0 };	/*< Meshes and textures processed */
+	std::atomic<size_t> objectsTotal{ 0 };
+	std::atomic<bool> isCancelled{ false };	/*< Set to stop the loading as soon as possible */
+	std::atomic<bool> isFinished{ false };	/*< The loading completed, failed or has been cancelled */
+};
 
 /** Load a Scene from a glTF file */
 class GLTFSceneLoader
 {
 public:
 	GLTFSceneLoader(Microsoft::WRL::ComPtr<ID3D12Device> device, Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue);
+	virtual ~GLTFSceneLoader() = default;
 
 	/**
 	 * Loads the model information from the glTF file filename, to load a scene from the model call GetScene
 	 * @param fileName the .gltf or .glb file to load
 	 */
 	void Load(const std::string& fileName);
+
+	/**
+	 * Enable or disable memory mapped loading (disabled by default).
+	 * When enabled the glTF file and its external buffers are mapped in memory and never copied:
+	 * buffer data is read straight from the mappings.
+	 */
+	void SetMemoryMapping(const bool enabled);
+
+	/** 
+	 * Report the loading progress to progress, which must outlive the loading, and stop the loading when it is cancelled.
+	 * A cancelled Load or GetScene throws an exception.
+	 */
+	void SetProgress(LoadingProgress* progress);
+
+	/**
+	 * Record the time and bytes of each loading phase into profile, which must outlive the loading.
+	 * The profile is not cleared, loading again adds to its phases. With memory mapping, file_io only measures the mappings:
+	 * the pages are read by the phases that first touch them.
+	 */
+	void SetProfile(LoadProfile* profile);
+
+	/**
+	 * Enable or disable the normalization of the primitives topology (disabled by default). The triangle fans and the line loops,
+	 * that Direct3D cannot draw, are always converted to lists. Enabled, the options also convert the strips to lists, remove the
+	 * degenerate and the duplicate triangles before the welding, and upload 16 bit indices when the vertices allow it.
+	 * The primitives are normalized in parallel, before their normals and tangents are computed.
+	 */
+	void SetTopologyNormalization(const bool enabled, const TopologyOptions& options = TopologyOptions());
+
+	/** Return the primitives converted, the triangles removed and the 16 bit indices of the last GetScene */
+	const TopologyReport& GetTopologyReport() const;
+
+	/** Set how the triangle normals are weighted in the normals computed for primitives without NORMAL, uniform by default */
+	void SetNormalWeighting(const NormalWeighting weighting);
+
+	/**
+	 * Enable or disable the optimization of the indexed triangle lists (disabled by default): their triangles are reordered
+	 * for the post-transform vertex cache and to reduce overdraw, and their vertices renumbered in first use order.
+	 * The optimized primitives are uploaded in their own buffers instead of the resident geometry ranges.
+	 */
+	void SetMeshOptimization(const bool enabled, const MeshOptimizationOptions& options = MeshOptimizationOptions());
+
+	/** Return the vertex cache statistics of the primitives optimized by the last GetScene */
+	const MeshOptimizationReport& GetMeshOptimizationReport() const;
+
+	/**
+	 * Enable or disable the welding of the triangle lists vertices (disabled by default): the vertices with the same
+	 * attributes, or the same within the options epsilons, are stored once and the primitives without indices get some.
+	 * It runs before the mesh optimization, the welded primitives are uploaded in their own buffers.
+	 */
+	void SetVertexWelding(const bool enabled, const VertexWeldOptions& options = VertexWeldOptions());
+
+	/** Return the vertices count before and after the welding of the primitives loaded by the last GetScene */
+	const VertexWeldReport& GetVertexWeldReport() const;
+
+	/**
+	 * Enable or disable the generation of the levels of detail of the indexed triangle lists (disabled by default): each submesh
+	 * gets the simplified index buffers of options.lodRatios over its own vertex buffers, generated on the pool threads after
+	 * the welding and the optimization. The simplified primitives are uploaded in their own buffers.
+	 */
+	void SetLodGeneration(const bool enabled, const SimplificationOptions& options = SimplificationOptions());
+
+	/** Return the triangles and the errors of the levels generated by the last GetScene */
+	const SimplificationReport& GetSimplificationReport() const;
+
+	/**
+	 * Enable or disable the split of the indexed triangle lists in meshlets (disabled by default): the triangles of each submesh
+	 * are reordered in clusters of at most options.maxVertices and options.maxTriangles, built on the pool threads after the
+	 * welding and the optimization, that the scene culls on the CPU.
+	 */
+	void SetMeshletGeneration(const bool enabled, const MeshletOptions& options = MeshletOptions());
+
+	/** Return the meshlets built by the last GetScene */
+	const MeshletReport& GetMeshletReport() const;
+
+	/**
+	 * Enable or disable the hierarchies of the triangle lists (disabled by default): each submesh gets the bounding volume hierarchy
+	 * of its triangles, in the order of its uploaded indices, that the scene ray queries and the picking traverse. They are built
+	 * on the pool threads once the meshlets and the levels of detail are.
+	 */
+	void SetBVHGeneration(const bool enabled, const BVHOptions& options = BVHOptions());
+
+	/** Return the hierarchies built by the last GetScene */
+	const BVHReport& GetBVHReport() const;
+
+	/**
+	 * Set the layout of the scene vertex buffers, the VERTEX_FEATURES_MESH attributes in their own buffers by default. With
+	 * VertexSlotsMode::Separate the float attributes are read in place from the resident geometry ranges, with the other modes the
+	 * attributes of every primitive are packed in the layout slots and uploaded in their own buffers. layout must hold the attributes
+	 * of the mesh shaders. A layout with a quantization (none by default) packs the primitives in any mode: their positions,
+	 * directions and texture coordinates are stored in 16 bit formats, the KHR_mesh_quantization integer attributes included.
+	 */
+	void SetVertexLayout(const VertexLayout& layout);
+
+	/** Return the vertex bytes saved by the quantization of the last GetScene */
+	const VertexQuantizationReport& GetVertexQuantizationReport() const;
+
+	/** Return the number of glTF buffers in the loaded model */
+	size_t GetBuffersCount() const;
+
+	/** Return the bytes of the glTF buffer bufferId, valid until the next call to Load or the loader destruction */
+	ByteSpan GetBufferData(const int bufferId) const;
+
+	/** Return the bytes addressed by the glTF buffer view bufferViewId */
+	ByteSpan GetBufferViewData(const int bufferViewId) const;
+
+	/** Return the memory layout of the accessor accessorId, checked against its buffer view */
+	AccessorDesc GetAccessorDesc(const int accessorId) const;
+
+	/** Return the geometry ranges of the loaded model that are uploaded to the GPU */
+	const GeometryResidency& GetGeometryResidency() const;
+
+	/** Return the bytes that uploading every buffer once per primitive would cost, to compare with the resident bytes */
+	size_t GetPerPrimitiveUploadBytes() const;
 	
 	/** 
 	  * Load a scene from the glTF file into the Scene object 
@@ -30,22 +175,122 @@ protected:
 	
 	/** Check that the major minor version of the loaded mesh is superior to the supported one */ 
 	bool CheckMajorMinorVersion() const;
-	
-	std::unique_ptr<SceneNode> ParseSceneNode(const int nodeId);
+
+	/** Return the path of a resource referenced by the glTF file, relative uris are resolved against the glTF file directory */
+	std::string ResolvePath(const std::string& uri) const;
+
+	/** Return the encoded size of an image, used to report the loading progress */
+	size_t GetImageByteSize(const tinygltf::Image& image) const;
+
+	bool IsCancelled() const;
+	void CheckCancelled() const;
+	void ReportProgress(const size_t bytesDone, const size_t objectsDone);
+
+	void ParseSceneNode(const int nodeId, const int parentId, Scene* scene);
 	void ParseSceneGraph(const int sceneId, Scene* scene);
 	void LoadMeshes(Scene* scene);
+
+	/** Read the elements of a float, normalized or integer accessor as T, a struct of floats such as XMFLOAT3 */
+	template <class T>
+	std::vector<T> ReadAttribute(const int accessorId) const;
+
+	/** Return the bounding box of a POSITION accessor: its min and max for float positions that have them, the box of its elements otherwise */
+	BoundingBox ReadPositionBounds(const int accessorId) const;
+
+	/** Read the elements of an index accessor of any component type */
+	std::vector<uint32_t> ReadIndices(const int accessorId) const;
+
+	/** Read the topology of a primitive with POSITION, with its positions if withPositions */
+	PrimitiveTopology ReadPrimitiveTopology(tinygltf::Primitive primitive, const bool withPositions) const;
+
+	/** Address the data of the accessor accessorId in the geometry ranges resident on the GPU, uploading its range on the first use */
+	void SetResidentView(Scene* scene, const int accessorId, BufferView& view);
+
+	/** 
+	 * Set view to the vertex attribute of the accessor accessorId, which must have elemType components.
+	 * Float attributes are read from the resident geometry ranges, the others are converted to floats and uploaded in their own buffer.
+	 */
+	void SetAttributeView(Scene* scene, const int accessorId, const uint8_t elemType, BufferView& view);
 	void LoadLights(Scene* scene);
 	void LoadMaterials(Scene* scene);
 	void LoadTextures(Scene* scene);
 	void LoadSamplers(Scene* scene);
 	
-	virtual void ComputeTangents(tinygltf::Primitive primitive, Scene* scene);
-	virtual void ComputeNormals(tinygltf::Primitive primitive, Scene* scene);
+	/** Create a scene GPU buffer filled with data when the upload batch is submitted, return its buffer id. data must stay valid until then */
+	virtual int AddSceneBuffer(Scene* scene, const uint8_t* data, const size_t byteSize);
+
+	/** Create a scene GPU buffer filled with data when the upload batch is submitted, return its buffer id */
+	virtual int AddSceneBuffer(Scene* scene, std::vector<uint8_t>&& data);
+
+	/** Create the GPU texture of a scene image, filled when the upload batch is submitted */
+	virtual Microsoft::WRL::ComPtr<ID3D12Resource> AddSceneImage(const DecodedTexture& decodedTexture);
+
+	/**
+	 * Compute the MikkTSpace tangents of a triangle list primitive.
+	 * topology is the normalized topology of the primitive, or null to read its indices.
+	 * computedNormals are the normals computed for a primitive without NORMAL, otherwise empty.
+	 */
+	virtual VertexTangents ComputeTangents(tinygltf::Primitive primitive, const PrimitiveTopology* topology, const std::vector<DirectX::XMFLOAT3>& computedNormals);
+
+	/** Compute the normals of a primitive without NORMAL, topology is its normalized topology or null to read its indices */
+	virtual std::vector<DirectX::XMFLOAT3> ComputeNormals(tinygltf::Primitive primitive, const PrimitiveTopology* topology);
+
+	/** Upload values, count elements of elemType floats, in a new scene buffer and set view to it */
+	void SetFloatsView(Scene* scene, const float* values, const size_t count, const uint8_t elemType, BufferView& view);
+
+	/** Set view to the indices of the accessor accessorId, read from the resident geometry ranges or widened to 16 bit and uploaded in their own buffer */
+	void SetIndicesAccessorView(Scene* scene, const int accessorId, BufferView& view);
+
+	/**
+	 * Upload the vertex streams and the indices of mesh in new scene buffers and set the views of subMesh to them.
+	 * The streams are packed in the vertex layout slots, unless its attributes are in separate buffers.
+	 */
+	void SetMeshStreamsViews(Scene* scene, const MeshStreams& mesh, SubMesh& subMesh);
+
+	/**
+	 * Upload the indices of a primitive in a new scene buffer and set view to it, with their glTF counter clockwise winding.
+	 * The indices are 32 bit, or 16 bit when they fit and the topology normalization options allow it.
+	 */
+	void SetIndicesView(Scene* scene, const std::vector<uint32_t>& indices, BufferView& view);
+
+	/** Upload the indices of the levels in a new scene buffer, one after the other, and set the levels of subMesh to them */
+	void SetLodsViews(Scene* scene, const std::vector<MeshLod>& lods, SubMesh& subMesh);
 
-	static constexpr unsigned int MAX_PATH_SIZE = 200;
-	TCHAR m_gltfFilePath[MAX_PATH_SIZE];	// The path where gltf file and its resources are stored
-	tinygltf::Model m_model;
-	tinygltf::TinyGLTF m_glTFLoader;
+	std::string m_baseDir;	// The path where gltf file and its resources are stored
+	tinygltf::Model m_model;	// Filled by GLTFJsonReader, images are described but not decoded
+	bool m_useMemoryMapping = false;
+	std::unique_ptr<MappedFile> m_mappedFile;	// The mapped glTF file, when memory mapping is enabled
+	std::vector<std::unique_ptr<MappedFile>> m_mappedBuffers;	// The mapped external buffer files, when memory mapping is enabled
+	std::vector<ByteSpan> m_buffersData;		// The data of each glTF buffer, either in m_model.buffers or in a mapping
+	GeometryResidency m_geometryResidency;		// The buffer ranges read as vertex or index data
+	std::vector<int> m_rangesGPUBufferId;		// The scene buffer of each geometry range, -1 until a submesh reads it in place
+	size_t m_uploadedRangesCount = 0;			// The geometry ranges uploaded by the last LoadMeshes
+	size_t m_uploadedRangesBytes = 0;			// Their bytes
+	std::unique_ptr<UploadBatch> m_uploadBatch;	// Collects the scene buffers uploads while GetScene runs
+	std::vector<DecodedTexture> m_decodedTextures;	// The decoded images, kept until the upload batch is submitted
+	LoadingProgress* m_progress = nullptr;
+	LoadProfile* m_profile = nullptr;
+	NormalWeighting m_normalWeighting = NormalWeighting::Uniform;
+	bool m_normalizeTopology = false;
+	TopologyOptions m_topologyOptions;
+	TopologyReport m_topologyReport;
+	bool m_optimizeMeshes = false;
+	MeshOptimizationOptions m_meshOptimizationOptions;
+	MeshOptimizationReport m_meshOptimizationReport;
+	bool m_weldVertices = false;
+	VertexWeldOptions m_vertexWeldOptions;
+	VertexWeldReport m_vertexWeldReport;
+	bool m_generateLods = false;
+	SimplificationOptions m_simplificationOptions;
+	SimplificationReport m_simplificationReport;
+	bool m_buildMeshlets = false;
+	MeshletOptions m_meshletOptions;
+	MeshletReport m_meshletReport;
+	bool m_buildBVH = false;
+	BVHOptions m_bvhOptions;
+	BVHReport m_bvhReport;
+	VertexLayout m_vertexLayout = CreateVertexLayout(VERTEX_FEATURES_MESH, VertexSlotsMode::Separate);
+	VertexQuantizationReport m_vertexQuantizationReport;
 		
 	Microsoft::WRL::ComPtr<ID3D12Device> m_device; 
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_commandQueue;
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "DXUtil.h"
+
+/** A byte range of a glTF buffer that is read by the GPU as vertex or index data */
+struct GeometryRange
+{
+	int bufferId = -1;
+	size_t byteOffset = 0;
+	size_t byteLength = 0;
+};
+
+/**
+ * Plans which bytes of a glTF model must be resident on the GPU as geometry.
+ * Only the buffer views referenced by the mesh primitives attributes and indices are collected, images and
+ * other data stored in the same buffers are left out. Overlapping or contiguous views are merged so that each
+ * byte is uploaded once and shared by every submesh that reads it.
+ */
+class GeometryResidency
+{
+public:
+	/** Collect the geometry ranges of every mesh primitive in the model */
+	void Build(const tinygltf::Model& model);
+
+	/** Return the merged ranges, sorted by buffer and offset */
+	const std::vector<GeometryRange>& GetRanges() const;
+
+	/** Return the index of the range that contains the byte at byteOffset in the buffer bufferId, -1 if none */
+	int FindRange(const int bufferId, const size_t byteOffset) const;
+
+	/** Return the bytes uploaded to the GPU by the ranges */
+	size_t GetResidentBytes() const;
+
+	/** Return the number of mesh primitives in the model */
+	size_t GetPrimitivesCount() const;
+
+private:
+	std::vector<GeometryRange> m_ranges;
+	size_t m_primitivesCount = 0;
+};
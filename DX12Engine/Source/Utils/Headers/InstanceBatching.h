@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** What an instanced draw call draws: a submesh of a mesh, with its material */
+struct BatchKey
+{
+	uint32_t meshId = 0;
+	uint32_t subMeshId = 0;
+	uint32_t materialId = 0;
+};
+
+/** A run of instances of the same key, drawn by one instanced draw call */
+struct InstanceBatch
+{
+	uint32_t key = 0;				/*< The number of the key of its instances, as given by AssignBatchKeys */
+	uint32_t firstInstance = 0;		/*< Its instances are InstanceBatcher::GetInstances() [firstInstance, firstInstance + instancesCount) */
+	uint32_t instancesCount = 0;
+};
+
+/**
+ * Number the distinct keys in the order their batches are drawn: by material, then by mesh and submesh, so that the batches sharing a
+ * material follow each other. Write the number of each key to keyIds, equal keys get the same number, and return the distinct keys count
+ */
+uint32_t AssignBatchKeys(const std::vector<BatchKey>& keys, std::vector<uint32_t>& keyIds);
+
+/**
+ * Groups the instances drawn in a frame by the number of their key, one batch per key, so that each batch is one instanced draw call
+ * over contiguous instances. The grouping is a counting sort, linear in the instances and keys counts, and its buffers are kept from
+ * one Build to the next so that a frame allocates nothing once the counts stop growing.
+ */
+class InstanceBatcher
+{
+public:
+	/**
+	 * Group the instances by key, instanceKeys[i] being the key number of the instance i and keysCount the count of key numbers. The
+	 * batches are in increasing key order, the instances of a batch in their order in instances. Throw if a key is not below keysCount
+	 */
+	void Build(const std::vector<uint32_t>& instances, const std::vector<uint32_t>& instanceKeys, const uint32_t keysCount);
+
+	/** Return the batches of the last Build, none is empty */
+	const std::vector<InstanceBatch>& GetBatches() const { return m_batches; }
+
+	/** Return the instances of the last Build, grouped by batch */
+	const std::vector<uint32_t>& GetInstances() const { return m_instances; }
+
+private:
+	std::vector<InstanceBatch> m_batches;
+	std::vector<uint32_t> m_instances;
+	std::vector<uint32_t> m_keyOffsets;		/*< The instances count of each key, then the position of its next instance */
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/** Time and bytes spent in one phase of a scene loading */
+struct LoadPhase
+{
+	std::string name;
+	double milliseconds = 0.0;
+	size_t bytes = 0;		/*< Bytes processed by the phase: read, parsed, decoded or uploaded */
+	size_t calls = 0;
+};
+
+/** The phases of a scene loading, in the order they first ran */
+class LoadProfile
+{
+public:
+	void Clear();
+
+	/** Add time and bytes to the phase name, created if it does not exist */
+	void Add(const std::string& name, const double milliseconds, const size_t bytes);
+
+	const std::vector<LoadPhase>& GetPhases() const;
+
+	/** Return the phase name, nullptr if it never ran */
+	const LoadPhase* FindPhase(const std::string& name) const;
+
+	/** Return the sum of the phases time, the loading time spent outside any phase is not included */
+	double GetTotalMilliseconds() const;
+
+	/** Return the phases as a JSON object, { "phase": { "ms": ..., "bytes": ..., "calls": ... }, ... } */
+	std::string ToJson() const;
+
+private:
+	std::vector<LoadPhase> m_phases;
+};
+
+/**
+ * Time a scope into a LoadProfile, nothing is recorded when the profile is null.
+ * Phases are exclusive: the time of a ScopedPhase nested in another one on the same thread is only counted in the inner phase.
+ */
+class ScopedPhase
+{
+public:
+	ScopedPhase(LoadProfile* profile, const char* name, const size_t bytes = 0);
+	ScopedPhase(const ScopedPhase&) = delete;
+	ScopedPhase& operator=(const ScopedPhase&) = delete;
+	~ScopedPhase();
+
+	void AddBytes(const size_t bytes);
+
+private:
+	LoadProfile* m_profile = nullptr;
+	const char* m_name = nullptr;
+	size_t m_bytes = 0;
+	std::chrono::steady_clock::time_point m_start;
+	double m_nestedMilliseconds = 0.0;	// Time of the phases nested in this one
+	ScopedPhase* m_parent = nullptr;
+
+	static thread_local ScopedPhase* s_current;	// The innermost phase running on this thread
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "DXUtil.h"
+
+/** A read-only view over a contiguous range of bytes */
+struct ByteSpan
+{
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+};
+
+/**
+ * Maps a whole file read-only into the process address space.
+ * Pages are read straight from the page cache, writing to them faults. The mapping is released when the object is destroyed.
+ */
+class MappedFile
+{
+public:
+	MappedFile(const std::string& fileName);
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	/** Return the whole mapped file */
+	ByteSpan GetData() const;
+
+	/** Return the bytes in the range [byteOffset, byteOffset + byteLength), throw if the range is out of the file */
+	ByteSpan GetRange(const size_t byteOffset, const size_t byteLength) const;
+
+	size_t GetSize() const;
+
+private:
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = NULL;
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+};
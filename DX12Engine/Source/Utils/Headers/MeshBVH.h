@@ -0,0 +1,138 @@
+#pragma once
+
+#include "Bounds.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+struct MeshStreams;
+class ThreadPool;
+
+constexpr uint32_t RAY_NO_HIT = 0xFFFFFFFF;
+
+/** The binned surface area heuristic of the builds */
+struct BVHOptions
+{
+	size_t binsCount = 16;			/*< Candidate split planes per axis are the borders of the bins, from 2 to 64 */
+	size_t maxLeafPrimitives = 8;	/*< Larger nodes are always split, smaller ones only if the heuristic finds it cheaper */
+	float traversalCost = 1.0f;		/*< Cost of visiting a node, relative to intersecting one primitive */
+};
+
+/** The hierarchies built, summed over the meshes */
+struct BVHReport
+{
+	size_t meshesCount = 0;
+	size_t primitivesCount = 0;
+	size_t nodesCount = 0;
+	size_t leavesCount = 0;
+	size_t maxDepth = 0;
+	double sahCost = 0.0;	/*< Expected cost of a random ray hitting the root, summed over the meshes */
+
+	void Add(const BVHReport& report);
+};
+
+/**
+ * A node of a flattened hierarchy, 32 bytes. An inner node has primitivesCount 0 and its two children at firstChildOrPrimitive and
+ * firstChildOrPrimitive + 1, a leaf holds primitivesCount primitives from slot firstChildOrPrimitive of the hierarchy order
+ */
+struct BVHNode
+{
+	float boundsMin[3] = {};
+	uint32_t firstChildOrPrimitive = 0;
+	float boundsMax[3] = {};
+	uint32_t primitivesCount = 0;
+
+	bool IsLeaf() const { return primitivesCount != 0; }
+};
+
+/** The bottom level hierarchy of a triangle mesh, the triangle vertices are copied in the hierarchy order so that a leaf reads them at once */
+struct TriangleBVH
+{
+	std::vector<BVHNode> nodes;			/*< The root first, empty for a mesh without triangles */
+	std::vector<uint32_t> triangles;	/*< The triangle of the mesh indices of each slot of the hierarchy order */
+	std::vector<float> vertices;		/*< The three corners of each slot, nine floats */
+
+	bool IsEmpty() const { return nodes.empty(); }
+};
+
+/** A mesh hierarchy placed in the world, nodeId and subMeshId are returned with the hits of the instance */
+struct BVHInstance
+{
+	float transform[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };	/*< Model to world, row major, applied to row vectors as DirectXMath does */
+	uint32_t bvhId = 0;		/*< The TriangleBVH of the instance in the hierarchies the scene is queried with */
+	uint32_t nodeId = 0;
+	uint32_t subMeshId = 0;
+};
+
+/** The top level hierarchy over instances of the triangle hierarchies */
+struct InstanceBVH
+{
+	std::vector<BVHNode> nodes;
+	std::vector<uint32_t> order;				/*< The instance of each slot of the hierarchy order */
+	std::vector<BVHInstance> instances;			/*< In the order they were given */
+	std::vector<std::array<float, 16>> inverseTransforms;	/*< World to model, to query the instances hierarchies in their model space */
+
+	bool IsEmpty() const { return nodes.empty(); }
+};
+
+/** A ray origin + t * direction for tMin <= t < tMax. The direction need not be normalized, t is then in its units */
+struct Ray
+{
+	float origin[3] = {};
+	float direction[3] = { 0.0f, 0.0f, 1.0f };
+	float tMin = 0.0f;
+	float tMax = (std::numeric_limits<float>::max)();
+};
+
+/** The nearest hit of a ray, the hit point is (1 - u - v) * p0 + u * p1 + v * p2 with the triangle corners in the order of the mesh indices */
+struct RayHit
+{
+	float t = (std::numeric_limits<float>::max)();
+	float u = 0.0f;
+	float v = 0.0f;
+	uint32_t triangle = RAY_NO_HIT;		/*< The triangle in the mesh indices, indices[3 * triangle] is its first corner */
+	uint32_t instance = RAY_NO_HIT;		/*< The index of the instance hit by a scene query */
+
+	bool IsHit() const { return triangle != RAY_NO_HIT; }
+};
+
+/**
+ * Build the hierarchy of the triangles of mesh, an indexed or unindexed triangle list with POSITION. Nodes are split on the binned surface
+ * area heuristic; the upper nodes are binned on the pool threads, then the subtrees below them are built as independent pool tasks and
+ * appended to the node array, children next to each other. Triangles are intersected on both faces.
+ * Throw std::invalid_argument if the indices are not a triangle list in the vertices range, or if the options are invalid.
+ */
+BVHReport BuildTriangleBVH(const MeshStreams& mesh, const BVHOptions& options, ThreadPool& pool, TriangleBVH& bvh);
+
+/** Build the hierarchies of the meshes, one mesh per pool task: bvhs[i] receives the hierarchy of meshes[i] */
+BVHReport BuildTriangleBVHs(const std::vector<MeshStreams>& meshes, const BVHOptions& options, ThreadPool& pool, std::vector<TriangleBVH>& bvhs);
+
+/**
+ * Build the top level hierarchy over instances of bvhs, on the world bounds of their roots. Instances of an empty hierarchy or with a
+ * singular transform are never hit. Throw std::invalid_argument if an instance bvhId is out of bvhs.
+ */
+BVHReport BuildInstanceBVH(const std::vector<BVHInstance>& instances, const std::vector<const TriangleBVH*>& bvhs, const BVHOptions& options, ThreadPool& pool, InstanceBVH& bvh);
+
+/**
+ * Build a hierarchy over boxes, as the instances one is built over the instances bounds: order receives the box of each slot of the
+ * hierarchy order, the empty boxes are left out. Children always follow their parent in nodes
+ */
+BVHReport BuildBoundsBVH(const std::vector<BoundingBox>& boxes, const BVHOptions& options, ThreadPool& pool, std::vector<BVHNode>& nodes, std::vector<uint32_t>& order);
+
+/** Find the nearest hit of ray with the triangles of bvh closer than hit.t, update hit and return true if there is one */
+bool IntersectRay(const TriangleBVH& bvh, const Ray& ray, RayHit& hit);
+
+/**
+ * Find the nearest hits of count rays, hits[i] for rays[i] as IntersectRay does. The rays are traced four at a time down the hierarchy
+ * with SSE2 where it is available, a node is visited if any of the four rays hits it: rays of neighbouring pixels share most of their nodes
+ */
+void IntersectRays(const TriangleBVH& bvh, const Ray* rays, const size_t count, RayHit* hits);
+
+/** Find the nearest hit of a world ray with the instances of scene, hit.instance tells which one. bvhs are the hierarchies scene was built on */
+bool IntersectRay(const InstanceBVH& scene, const std::vector<const TriangleBVH*>& bvhs, const Ray& ray, RayHit& hit);
+
+/** Find the nearest hits of count world rays with the instances of scene, the rays are spread over the pool threads */
+void IntersectRays(const InstanceBVH& scene, const std::vector<const TriangleBVH*>& bvhs, const Ray* rays, const size_t count, RayHit* hits, ThreadPool& pool);
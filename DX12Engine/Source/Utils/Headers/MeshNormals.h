@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+/** How the normals of the triangles sharing a vertex are weighted in the vertex normal */
+enum class NormalWeighting
+{
+	Uniform,	/*< Every triangle counts the same */
+	Area,		/*< Larger triangles count more */
+	Angle		/*< Triangles count by their angle at the vertex, the result does not depend on the tessellation */
+};
+
+/** The vertices and triangles of a triangle list, positions are x, y, z triples */
+struct TriangleMesh
+{
+	const float* positions = nullptr;
+	size_t verticesCount = 0;
+	const uint32_t* indices = nullptr;	/*< Three per triangle, null for an unindexed list where triangle t is the vertices 3t, 3t + 1, 3t + 2 */
+	size_t indicesCount = 0;			/*< Three per triangle, for an unindexed list at most verticesCount */
+};
+
+/**
+ * Compute the vertex normals of mesh, the normalized weighted sum of the normals of the triangles that share each vertex.
+ * normals must hold verticesCount x, y, z triples. A vertex without any non degenerate triangle gets the normal (0, 1, 0).
+ * The work is spread over pool without locks or atomics: each thread owns a range of vertices and accumulates the
+ * triangle normals of their corners only. The corners are summed in order, the result does not depend on the number of threads.
+ * Throw std::invalid_argument if an index is out of the vertices range.
+ */
+void GenerateNormals(const TriangleMesh& mesh, const NormalWeighting weighting, float* normals, ThreadPool& pool);
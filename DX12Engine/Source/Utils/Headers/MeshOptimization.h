@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MeshStreams;
+
+/** The efficiency of a triangle order on a FIFO post-transform vertex cache */
+struct VertexCacheStatistics
+{
+	size_t transformedVertices = 0;	/*< The cache misses, each one is a vertex shader invocation */
+	double acmr = 0.0;				/*< Average cache miss ratio: transformed vertices per triangle, 0.5 to 3 */
+	double atvr = 0.0;				/*< Average transformed vertex ratio: transformed vertices per vertex, 1 is optimal */
+};
+
+/** The mesh optimization settings */
+struct MeshOptimizationOptions
+{
+	size_t cacheSize = 16;			/*< The FIFO cache size that triangles are ordered for, 16 to 32 fits current GPUs */
+	bool reduceOverdraw = true;		/*< Reorder the triangle clusters to draw the ones facing outwards first */
+	float overdrawThreshold = 1.05f;	/*< How much the ACMR can grow to split the clusters in smaller ones that sort better */
+};
+
+/** The cache statistics of a mesh before and after the optimization, summed over the meshes optimized */
+struct MeshOptimizationReport
+{
+	size_t trianglesCount = 0;
+	size_t verticesCountBefore = 0;
+	size_t verticesCountAfter = 0;	/*< Unreferenced vertices are removed */
+	VertexCacheStatistics before;
+	VertexCacheStatistics after;
+
+	void Add(const MeshOptimizationReport& report);
+};
+
+/**
+ * Simulate a FIFO vertex cache of cacheSize entries over the triangles of indices.
+ * Throw std::invalid_argument if an index is out of the vertices range.
+ */
+VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, const size_t verticesCount, const size_t cacheSize);
+
+/**
+ * Reorder the triangles of indices for a FIFO vertex cache of cacheSize entries with Tipsify (Sander, Nehab, Barczak 2007):
+ * it fans around a vertex, emitting all of its triangles, then moves to the vertex of the last triangles that will
+ * still be in the cache when its own remaining triangles are emitted. It runs in linear time.
+ * If clusters is not null, it receives the first triangle of each run that restarts from a cold cache, with a trailing
+ * triangles count: the units that OptimizeOverdraw can reorder.
+ * The triangles keep their winding. Throw std::invalid_argument if an index is out of the vertices range.
+ */
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, const size_t verticesCount, const size_t cacheSize, std::vector<uint32_t>* clusters = nullptr);
+
+/**
+ * Reorder the clusters of triangles of a cache optimized order to draw the ones that face away from the mesh center first,
+ * as they tend to occlude the others. Clusters are split further where it costs less than overdrawThreshold on the ACMR.
+ * positions are x, y, z triples and the triangles are counter clockwise.
+ */
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const float* positions, const size_t verticesCount,
+	const std::vector<uint32_t>& clusters, const size_t cacheSize, const float overdrawThreshold);
+
+/**
+ * Renumber the vertices in the order the triangles first use them, so that the vertex fetches walk the buffers forward.
+ * The indices are rewritten in place, the result is the source vertex of each new vertex. Unreferenced vertices are dropped.
+ */
+std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, const size_t verticesCount);
+
+/**
+ * Run the three passes on an indexed triangle list: cache, overdraw if enabled, and fetch order applied to every stream.
+ * Meshes without indices are left untouched. Throw std::invalid_argument if an index is out of the vertices range.
+ */
+MeshOptimizationReport OptimizeMesh(MeshStreams& mesh, const MeshOptimizationOptions& options);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MeshStreams;
+class ThreadPool;
+
+/** The levels of detail generated for a triangle list */
+struct SimplificationOptions
+{
+	std::vector<float> lodRatios = { 0.5f, 0.25f, 0.125f, 0.0625f };	/*< Target triangles of each level, a decreasing fraction of the mesh triangles */
+	float maxRelativeError = 0.1f;	/*< No collapse may cost more than this, relative to the mesh radius: the levels past it are not generated */
+	size_t minTrianglesCount = 256;	/*< Meshes with fewer triangles are not simplified */
+};
+
+/** A simplified triangle list, over the vertices of the mesh it was generated from */
+struct MeshLod
+{
+	std::vector<uint32_t> indices;	/*< Counter clockwise, as the mesh indices */
+	float error = 0.0f;				/*< Estimate of the largest distance between this level and the mesh surface, in mesh units */
+};
+
+/** The triangles and the errors of the levels generated, summed over the meshes simplified */
+struct SimplificationReport
+{
+	size_t meshesCount = 0;					/*< Meshes with at least one level */
+	size_t trianglesCount = 0;				/*< Triangles of those meshes */
+	std::vector<size_t> lodTrianglesCount;	/*< Triangles of each level, a mesh with fewer levels counts its coarsest one */
+	std::vector<float> lodRelativeError;	/*< The largest error of each level, relative to the radius of its mesh */
+
+	void Add(const SimplificationReport& report);
+};
+
+/**
+ * Generate the levels of detail of an indexed triangle list by quadric error edge collapses: each collapse moves a vertex onto a
+ * neighbour, so the levels only need new indices. Every level is simplified from the previous one, and a level is only kept if it has
+ * fewer triangles: lods may end up with fewer levels than options.lodRatios, or none.
+ *
+ * The vertices are joined by position, the ones at the same position with different attributes form the attribute seams. A vertex
+ * on an open border only collapses along the border, a vertex on a seam only along the seam, and the quadrics of the border and seam
+ * edges keep the shape of those lines. A vertex on a non manifold edge, or on more than one border, never moves.
+ * Throw std::invalid_argument if the indices are not a triangle list in the vertices range.
+ */
+SimplificationReport SimplifyMesh(const MeshStreams& mesh, const SimplificationOptions& options, std::vector<MeshLod>& lods);
+
+/** Simplify the meshes on the pool threads, one mesh per task: lods[i] receives the levels of meshes[i] */
+SimplificationReport SimplifyMeshes(const std::vector<MeshStreams>& meshes, const SimplificationOptions& options, ThreadPool& pool, std::vector<std::vector<MeshLod>>& lods);
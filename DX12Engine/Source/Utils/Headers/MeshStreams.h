@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "AccessorView.h"
+
+/** The vertex attributes read by the viewer, as glTF attribute names */
+extern const std::vector<std::string> MESH_STREAM_SEMANTICS;
+
+/** A vertex attribute of a primitive, converted to floats */
+struct VertexStream
+{
+	std::string semantic;		/*< The glTF attribute name, as POSITION or TEXCOORD_0 */
+	size_t elementsCount = 0;	/*< Floats per vertex */
+	std::vector<float> values;
+};
+
+/**
+ * The vertex attributes and the triangles of a primitive copied out of the glTF buffers, for the passes that rebuild
+ * the vertices: split, reorder or weld them. It has no Windows dependencies.
+ */
+struct MeshStreams
+{
+	std::vector<VertexStream> streams;
+	std::vector<uint32_t> indices;	/*< Counter clockwise triangles, empty for an unindexed primitive */
+	size_t verticesCount = 0;
+
+	VertexStream* Find(const std::string& semantic);
+	const VertexStream* Find(const std::string& semantic) const;
+
+	/** Add the stream semantic, or replace it if it exists. values must hold verticesCount elements */
+	void SetStream(const std::string& semantic, const size_t elementsCount, std::vector<float>&& values);
+
+	/** Replace the vertices of every stream with copies of sourceVertices, in order. The indices are left as they are */
+	void GatherVertices(const std::vector<uint32_t>& sourceVertices);
+};
+
+/**
+ * Read the MESH_STREAM_SEMANTICS attributes of primitive, getAccessor returns the memory layout of an accessor.
+ * The indices are not read, the callers read them with their own component type handling.
+ * Throw std::runtime_error if the attributes have different counts.
+ */
+MeshStreams ReadMeshStreams(const tinygltf::Primitive& primitive, const std::function<AccessorDesc(int)>& getAccessor);
+
+/**
+ * Read every triangle list primitive of a .gltf or .glb file, with its indices, for the tools that work without the viewer.
+ * Buffers can be in the .glb BIN chunk, in data uris or in files next to the glTF file.
+ */
+std::vector<MeshStreams> LoadMeshStreams(const std::string& fileName);
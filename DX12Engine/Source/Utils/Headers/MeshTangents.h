@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshNormals.h"
+
+class ThreadPool;
+
+/** The vertex tangents of a mesh, with the vertices that need more than one tangent frame split */
+struct VertexTangents
+{
+	std::vector<float> tangents;			/*< x, y, z, w per output vertex, w is the bitangent sign: bitangent = cross(normal, tangent) * w */
+	std::vector<uint32_t> sourceVertices;	/*< The input vertex copied by each output vertex after the input ones, empty when no vertex was split */
+	std::vector<uint32_t> indices;			/*< The triangles on the output vertices, empty when no vertex was split */
+
+	size_t GetVerticesCount() const { return tangents.size() / 4; }
+};
+
+/**
+ * Compute the tangents of the triangles of mesh the way MikkTSpace does, the reference of the glTF normal maps.
+ * normals and texCoords hold verticesCount x, y, z and u, v values, with the glTF texture coordinates origin at the top left
+ * and the glTF counter clockwise winding.
+ * Vertices with the same position, normal and texture coordinates are welded. The triangle tangents are projected on the
+ * tangent plane of each corner and summed weighted by the corner angle, separately for the triangles that preserve and
+ * that flip the texture orientation: a vertex shared by both, on a mirrored texture seam, is split in two.
+ * Triangles with degenerate texture coordinates take the tangent of the other triangles of their vertices.
+ * The triangles are processed in parallel on pool, the result does not depend on the number of threads.
+ * Throw std::invalid_argument if an index is out of the vertices range.
+ */
+VertexTangents GenerateTangents(const TriangleMesh& mesh, const float* normals, const float* texCoords, ThreadPool& pool);
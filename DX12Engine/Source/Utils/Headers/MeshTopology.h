@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+/** The glTF primitive modes, with the values of the glTF mode property */
+enum class PrimitiveMode : uint32_t
+{
+	Points = 0,
+	Lines = 1,
+	LineLoop = 2,
+	LineStrip = 3,
+	Triangles = 4,
+	TriangleStrip = 5,
+	TriangleFan = 6
+};
+
+/** What the topology normalization does besides converting the fans and the line loops, that Direct3D cannot draw, to lists */
+struct TopologyOptions
+{
+	bool stripsToLists = true;		/*< Convert the triangle and line strips to lists, so that the triangles can be welded, optimized and clustered */
+	bool removeDegenerates = true;	/*< Remove the triangles with two corners on the same vertex, or of zero area when the positions are known */
+	bool removeDuplicates = true;	/*< Remove the triangles with the same vertices in the same winding as an earlier triangle */
+	bool shortIndices = true;		/*< Store the indices in 16 bit when every index fits */
+};
+
+/** The primitives converted and the triangles removed by the topology normalization, summed over the primitives normalized */
+struct TopologyReport
+{
+	size_t primitivesCount = 0;
+	size_t fansCount = 0;			/*< Triangle fans converted to triangle lists */
+	size_t loopsCount = 0;			/*< Line loops converted to line lists */
+	size_t stripsCount = 0;			/*< Triangle and line strips converted to lists */
+	size_t degenerateTriangles = 0;
+	size_t duplicateTriangles = 0;
+	size_t shortIndicesCount = 0;	/*< Indices stored in 16 bit instead of 32 bit, counted when they are packed */
+
+	void Add(const TopologyReport& report);
+};
+
+/** The vertices a primitive draws, in the order of its mode */
+struct PrimitiveTopology
+{
+	PrimitiveMode mode = PrimitiveMode::Triangles;
+	std::vector<uint32_t> indices;	/*< With the glTF counter clockwise winding, empty for an unindexed primitive */
+	size_t verticesCount = 0;
+	std::vector<float> positions;	/*< x, y, z triples, only read to find the zero area triangles. Can be empty */
+};
+
+/** Return the mode a primitive of mode has after its normalization with options */
+PrimitiveMode GetNormalizedMode(const PrimitiveMode mode, const TopologyOptions& options);
+
+/**
+ * Convert topology to GetNormalizedMode: the fans to triangle lists, the line loops to line lists and, with options.stripsToLists,
+ * the strips to lists, in the triangle order and the winding of the glTF specification. Then remove the degenerate and the duplicate
+ * triangles of the triangle lists. The converted primitives and the strips are indexed; an unindexed triangle list gets indices only
+ * if some of its triangles are removed. The points and the line lists are left as they are.
+ * Throw std::invalid_argument if an index is out of the vertices range or if positions do not hold verticesCount vertices.
+ */
+TopologyReport NormalizeTopology(PrimitiveTopology& topology, const TopologyOptions& options);
+
+/** Normalize every topology, the primitives are spread over pool */
+TopologyReport NormalizeTopologies(std::vector<PrimitiveTopology>& topologies, const TopologyOptions& options, ThreadPool& pool);
+
+/**
+ * Return indices as bytes, in 16 bit when shortIndices and every index fits in 16 bit, in 32 bit otherwise.
+ * isShort tells which one is used. The 16 bit index 0xFFFF is kept: no pipeline of the viewer cuts the strips.
+ */
+std::vector<uint8_t> PackIndices(const std::vector<uint32_t>& indices, const bool shortIndices, bool& isShort);
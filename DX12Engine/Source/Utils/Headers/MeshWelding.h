@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MeshStreams;
+class ThreadPool;
+
+/** How vertices are compared by the welding */
+struct VertexWeldOptions
+{
+	/**
+	 * 0 welds the vertices whose every attribute is equal. Otherwise the attributes are snapped to a grid of this step
+	 * before they are compared: vertices closer than the step are welded unless a grid line falls between them.
+	 */
+	float positionEpsilon = 0.0f;
+	float attributeEpsilon = 0.0f;	/*< The same for the other attributes, normals, tangents, texture coordinates and colors */
+};
+
+/** The vertices before and after the welding, summed over the meshes welded */
+struct VertexWeldReport
+{
+	size_t verticesCountBefore = 0;
+	size_t verticesCountAfter = 0;
+	size_t degenerateTriangles = 0;	/*< Triangles with two corners on the same welded vertex, removed by a welding with epsilons */
+
+	void Add(const VertexWeldReport& report);
+};
+
+/**
+ * Return the welded vertex of each vertex of mesh, numbered in the order of their first vertex, and set uniqueCount to
+ * the number of welded vertices. The vertices are hashed on all their streams, then split by hash in shards that are
+ * welded in parallel on pool, each in its own open addressing table: there are no locks, and the first vertex of each
+ * distinct value represents it whatever the number of threads.
+ */
+std::vector<uint32_t> GenerateVertexRemap(const MeshStreams& mesh, const VertexWeldOptions& options, ThreadPool& pool, size_t& uniqueCount);
+
+/**
+ * Replace the vertices of a triangle list by its distinct vertices, each with the attributes of its first vertex, and
+ * rewrite or create the indices. A welding with epsilons removes the triangles that it leaves with two corners on the same vertex.
+ * Throw std::invalid_argument if an index is out of the vertices range.
+ */
+VertexWeldReport WeldVertices(MeshStreams& mesh, const VertexWeldOptions& options, ThreadPool& pool);
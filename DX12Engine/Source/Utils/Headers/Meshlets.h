@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MeshStreams;
+class ThreadPool;
+
+/** The size limits of the meshlets, the defaults fit a mesh shader thread group */
+struct MeshletOptions
+{
+	size_t maxVertices = 64;	/*< Distinct vertices of a meshlet, at most 256 so that a meshlet can address them with 8 bit indices */
+	size_t maxTriangles = 124;
+};
+
+/**
+ * A cluster of neighbouring triangles, stored consecutively in the indices of its mesh, with the bounds used to cull it.
+ * The cone holds the directions the triangles face: the meshlet is back facing from any eye position for which
+ * dot(normalize(coneApex - eye), coneAxis) >= coneCutoff. A cutoff greater than 1 never culls.
+ */
+struct Meshlet
+{
+	uint32_t firstIndex = 0;	/*< First index of the meshlet triangles */
+	uint32_t indicesCount = 0;
+	uint32_t verticesCount = 0;	/*< Distinct vertices used by the triangles */
+	float center[3] = {};		/*< Bounding sphere */
+	float radius = 0.0f;
+	float aabbMin[3] = {};
+	float aabbMax[3] = {};
+	float coneApex[3] = {};
+	float coneAxis[3] = {};
+	float coneCutoff = 2.0f;
+};
+
+/** The meshlets built, summed over the meshes */
+struct MeshletReport
+{
+	size_t meshesCount = 0;
+	size_t trianglesCount = 0;
+	size_t meshletsCount = 0;
+	size_t verticesCount = 0;	/*< Distinct vertices of each meshlet, summed: the vertices a mesh shader would transform */
+	size_t conesCount = 0;		/*< Meshlets whose normal cone can cull them */
+
+	void Add(const MeshletReport& report);
+};
+
+/** A view to cull meshlets against, in the model space of their mesh */
+struct MeshletCullingView
+{
+	float planes[6][4] = {};	/*< The frustum planes a, b, c, d with a unit normal pointing inside: left, right, bottom, top, near, far */
+	float eyePosition[3] = {};
+	bool cullBackfaces = true;	/*< The cone test is only exact for rigid transformations and uniform scales */
+};
+
+/** A range of consecutive indices to draw */
+struct MeshletRange
+{
+	uint32_t firstIndex = 0;
+	uint32_t indicesCount = 0;
+};
+
+/**
+ * Split an indexed triangle list in meshlets, reordering its triangles in place so that those of each meshlet are consecutive.
+ * A meshlet grows from a seed triangle, in the indices order, by adding the adjacent triangle that brings the fewest new vertices,
+ * the closest to the meshlet center among those. Small meshlets that run out of adjacent triangles take the next triangles in
+ * order, so that disconnected pieces are grouped. The triangles keep their winding and are counter clockwise.
+ * Throw std::invalid_argument if the indices are not a triangle list in the vertices range, or if the limits are invalid.
+ */
+MeshletReport BuildMeshlets(MeshStreams& mesh, const MeshletOptions& options, std::vector<Meshlet>& meshlets);
+
+/** Build the meshlets of the meshes on the pool threads, one mesh per task: meshlets[i] receives the meshlets of meshes[i] */
+MeshletReport BuildMeshlets(std::vector<MeshStreams>& meshes, const MeshletOptions& options, ThreadPool& pool, std::vector<std::vector<Meshlet>>& meshlets);
+
+/**
+ * Return the culling view of a mesh drawn with modelViewProjection, a row major matrix applied to row vectors as DirectXMath
+ * does, to a Direct3D clip space with 0 <= z <= w. eyePosition is the camera position in the model space.
+ */
+MeshletCullingView GetMeshletCullingView(const float modelViewProjection[16], const float eyePosition[3], const bool cullBackfaces);
+
+/**
+ * Set visible[i] to 1 for the meshlets inside the frustum and facing the eye, and leave the others as they are: views of
+ * several instances can mark the same flags. visible is resized to the meshlets count. Return the meshlets visible from view.
+ */
+size_t MarkVisibleMeshlets(const std::vector<Meshlet>& meshlets, const MeshletCullingView& view, std::vector<uint8_t>& visible);
+
+/**
+ * Return the index ranges of the visible meshlets, consecutive meshlets are merged in one range. The culled meshlets between two
+ * visible ones are drawn too if they hold at most maxGapIndices indices: a draw call costs more than a few hidden triangles.
+ */
+std::vector<MeshletRange> GetMeshletRanges(const std::vector<Meshlet>& meshlets, const std::vector<uint8_t>& visible, const uint32_t maxGapIndices = 0);
+
+/** Cull the meshlets against a single view and return the index ranges to draw */
+std::vector<MeshletRange> CullMeshlets(const std::vector<Meshlet>& meshlets, const MeshletCullingView& view, const uint32_t maxGapIndices = 0);
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Bounds.h"
+#include "FrustumCulling.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+/** A triangle soup drawn into an OcclusionBuffer, placed in the world by its transform */
+struct Occluder
+{
+	const float* vertices = nullptr;		/*< The three corners of each triangle, nine floats, as TriangleBVH::vertices */
+	size_t trianglesCount = 0;
+	float transform[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };	/*< Model to world, row major, applied to row vectors as DirectXMath does */
+};
+
+struct OcclusionOptions
+{
+	uint32_t width = 256;					/*< Pixels of the depth buffer, rounded up to whole tiles */
+	uint32_t height = 144;
+	size_t maxOccluders = 64;				/*< Occluders SelectOccluders picks at most, the largest on screen first */
+	size_t maxOccluderTriangles = 65536;	/*< Triangles of all the picked occluders together */
+};
+
+/**
+ * A coarse depth buffer the occluders are rasterized into on the CPU, to test the boxes of the objects behind them. A pixel takes the
+ * nearest depth of the triangles covering its center, and the triangles sharing an edge leave no gap between them. A box is hidden
+ * only if every pixel it touches holds a nearer depth than its nearest corner: no ray from the eye through a pixel center reaches a
+ * hidden box without crossing an occluder first. An object seen only through gaps between the occluders narrower than a pixel of the
+ * buffer may be hidden, the price of its coarse resolution.
+ * The buffer is split in tiles: the occluder triangles are set up in parallel, binned by the tiles they overlap, then each tile is
+ * rasterized on its own, four pixels at a time with SSE2 where it is available. The result does not depend on the threads count.
+ */
+class OcclusionBuffer
+{
+public:
+	static constexpr uint32_t TILE_WIDTH = 32;
+	static constexpr uint32_t TILE_HEIGHT = 8;
+
+	OcclusionBuffer();
+
+	/** Set the size of the buffer in pixels, rounded up to whole tiles, and clear it. Throw if a size is 0 or above 4096 */
+	void Resize(const uint32_t width, const uint32_t height);
+
+	/** Set the world to clip transform the occluders are rasterized and the boxes tested with, and clear the buffer */
+	void SetViewProjection(const float viewProjection[16]);
+
+	/** Remove the rasterized occluders, every box is visible again */
+	void Clear();
+
+	/** Rasterize the occluder triangles in front of the near plane, clipped to the view, into the buffer */
+	void Rasterize(const std::vector<Occluder>& occluders, ThreadPool& pool);
+
+	/** Return false if the rasterized occluders hide box entirely, true if it may be visible or crosses the near plane */
+	bool IsVisible(const BoundingBox& box) const;
+
+	/** Write the candidates whose box may be visible to visible, in their order, and return their count */
+	size_t TestBounds(const CullingBounds& bounds, const std::vector<uint32_t>& candidates, std::vector<uint32_t>& visible, ThreadPool& pool) const;
+
+	uint32_t GetWidth() const { return m_width; }
+	uint32_t GetHeight() const { return m_height; }
+
+	/** Return the depth of a pixel, the row 0 at the top of the view: z / w of the nearest occluder over it, or FLT_MAX */
+	float GetDepth(const uint32_t x, const uint32_t y) const { return m_depths[static_cast<size_t>(y) * m_width + x]; }
+
+	/** Return the triangles rasterized since the last Clear, after the clipping: a clipped triangle may give several */
+	size_t GetRasterizedTrianglesCount() const { return m_triangles.size(); }
+
+private:
+	/** A triangle in pixel units: its edge functions, positive inside, and the plane of its depth */
+	struct Triangle
+	{
+		float edges[3][3];					/*< a, b, c of a * x + b * y + c, for the pixel centers */
+		float depth[3];						/*< z / w = depth[0] + depth[1] * x + depth[2] * y */
+		float maxDepth;						/*< The farthest corner of the triangle, bounds the plane over the slivers */
+		uint32_t minX, minY, maxX, maxY;	/*< The pixels of its bounding rectangle, inclusive */
+	};
+
+	void SetUpTriangles(const Occluder& occluder, std::vector<Triangle>& triangles) const;
+	void RasterizeTile(const size_t tileId);
+
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	uint32_t m_tilesX = 0;
+	uint32_t m_tilesY = 0;
+	float m_viewProjection[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+	std::vector<float> m_depths;						/*< Row major, m_width per row */
+	std::vector<float> m_tileMaxDepths;					/*< The farthest pixel of each tile, a box behind it is hidden there */
+	std::vector<Triangle> m_triangles;
+	std::vector<std::vector<uint32_t>> m_tileTriangles;	/*< The triangles overlapping each tile, in occluder order */
+};
+
+/**
+ * Pick the occluders among the candidates, the objects with a trianglesCounts of 0 cannot be one: the largest bounding spheres seen
+ * from the eye first, up to the options occluders and triangles counts. Write them to occluders in decreasing size and return their count
+ */
+size_t SelectOccluders(const CullingBounds& bounds, const std::vector<uint32_t>& candidates, const std::vector<size_t>& trianglesCounts,
+	const float eye[3], const OcclusionOptions& options, std::vector<uint32_t>& occluders);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "GLTFSceneLoader.h"
+#include "BakedSceneFormat.h"
+#include <fstream>
+
+/**
+ * Convert a glTF scene to the baked scene format read by BakedSceneLoader.
+ * The scene is loaded with the regular GLTFSceneLoader pipeline, so the baked file contains exactly what the viewer
+ * would upload: the buffers and decoded images are written while they are enqueued, the records after the scene is built.
+ */
+class SceneBaker : public GLTFSceneLoader
+{
+public:
+	SceneBaker(Microsoft::WRL::ComPtr<ID3D12Device> device, Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue);
+
+	/** Build the scene sceneId of the glTF file loaded with Load and write it to fileName, throw on failure */
+	void Bake(const int sceneId, const std::string& fileName);
+
+	/** Return the glTF file name with the baked scene extension */
+	static std::string GetBakedFileName(const std::string& fileName);
+
+	/**
+	 * The converter command line: --bake input.gltf|input.glb [output.gltfbake] [--quantize], return the process exit code.
+	 * --quantize stores the positions as unorm16, the normals and tangents as octahedral snorm16 and the texture coordinates as half floats.
+	 */
+	static int RunCommandLine(const std::vector<std::string>& args);
+
+protected:
+	int AddSceneBuffer(Scene* scene, const uint8_t* data, const size_t byteSize) override;
+	int AddSceneBuffer(Scene* scene, std::vector<uint8_t>&& data) override;
+	Microsoft::WRL::ComPtr<ID3D12Resource> AddSceneImage(const DecodedTexture& decodedTexture) override;
+
+	/** Append data to the file at the next payload aligned offset */
+	BakedPayload WritePayload(const void* data, const size_t byteSize);
+
+	/** Append a record table to the file */
+	template <class T>
+	BakedSectionDesc WriteSection(const std::vector<T>& records);
+
+	void WritePadding(const uint64_t alignment);
+	void BakeNodes(const Scene* scene, std::vector<BakedNode>& nodes, uint32_t& rootNodesCount) const;
+
+	std::ofstream m_file;
+	uint64_t m_fileByteSize = 0;
+	std::vector<BakedBuffer> m_bakedBuffers;
+	std::vector<BakedImage> m_bakedImages;
+	std::vector<BakedMipLevel> m_bakedMipLevels;
+};
\ No newline at end of file
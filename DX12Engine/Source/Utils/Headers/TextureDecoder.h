@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** An encoded image (PNG, JPEG, ...) either in memory or in a file */
+struct EncodedImage
+{
+	const uint8_t* data = nullptr;	/*< Encoded bytes, used when not null */
+	size_t size = 0;
+	std::string fileName;			/*< The file to read otherwise */
+};
+
+/** A mip level of a decoded texture */
+struct MipLevel
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	size_t byteOffset = 0;	/*< Offset of the level in DecodedTexture::data, rows are tightly packed */
+};
+
+/** An RGBA8 image and its mip chain, ready to be copied to the GPU */
+struct DecodedTexture
+{
+	static constexpr uint32_t BYTES_PER_PIXEL = 4;
+
+	std::vector<uint8_t> data;		/*< All the mip levels, one after the other */
+	std::vector<MipLevel> mipLevels;	/*< From the full resolution image down to 1x1 */
+
+	uint32_t GetWidth() const;
+	uint32_t GetHeight() const;
+	size_t GetRowPitch(const size_t mipLevel) const;
+	const uint8_t* GetMipData(const size_t mipLevel) const;
+};
+
+/** Decode an image to RGBA8 with stb_image and generate its full mip chain, throw if the image can't be decoded */
+DecodedTexture DecodeTexture(const EncodedImage& image);
+
+/** Compute the mip levels below the first one with a 2x2 box filter, the first level must be in data already */
+void GenerateMipChain(DecodedTexture& texture);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of worker threads that run parallel loops.
+ * The thread calling ParallelFor takes part in the loop, so a pool with n workers runs a loop on n + 1 threads,
+ * and a loop started from a worker (or on a pool without workers) still completes.
+ */
+class ThreadPool
+{
+public:
+	/** Create a pool with workersCount threads, the default leaves one hardware thread to the caller */
+	explicit ThreadPool(const size_t workersCount = GetDefaultWorkersCount());
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	/**
+	 * Call fn(i) for every i in [0, count), distributing the calls over the workers and the calling thread.
+	 * Return when all the calls are done; if a call throws, the first exception is rethrown here.
+	 */
+	void ParallelFor(const size_t count, const std::function<void(size_t)>& fn);
+
+	/** Return the number of threads that run a parallel loop, workers plus the calling thread */
+	size_t GetThreadsCount() const;
+
+	/** Return the pool shared by the loaders */
+	static ThreadPool& GetDefault();
+
+	static size_t GetDefaultWorkersCount();
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> m_workers;
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_taskAvailable;
+	bool m_isStopping = false;
+};
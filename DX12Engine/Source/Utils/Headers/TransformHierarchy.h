@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** A transformation relative to the parent node: scale, then rotate, then translate, as glTF nodes are */
+struct LocalTransform
+{
+	float translation[3] = {};
+	float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };	/*< Unit quaternion x, y, z, w */
+	float scale[3] = { 1.0f, 1.0f, 1.0f };
+};
+
+/** Compose transform into a row major matrix applied to row vectors, as DirectXMath does: scaling * rotation * translation */
+void ComposeMatrix(const LocalTransform& transform, float matrix[16]);
+
+/**
+ * Decompose a row major affine matrix into scale, rotation and translation, a negative determinant gives a negative x scale.
+ * Return false if the matrix has no exact decomposition (shear, projection or a null scale), transform is then only an approximation
+ */
+bool DecomposeMatrix(const float matrix[16], LocalTransform& transform);
+
+/** result = a * b for row major matrices: the result applies a then b. result may not alias a or b */
+void MultiplyMatrices(const float a[16], const float b[16], float result[16]);
+
+/**
+ * The transformations of a forest of nodes, flattened in arrays indexed by node with every parent before its children.
+ * Each node keeps its local transformation, as translation, rotation and scale and as the matrix composed from them, its parent index
+ * and its world matrix. Editing a node or the root transform only sets a dirty flag, Update then recomputes the world matrices of the
+ * dirty nodes and of their descendants in one pass over the arrays: a parent world matrix is always recomputed before its children.
+ */
+class TransformHierarchy
+{
+public:
+	/** Append a node under parentId, -1 for a root, and return its index. Throw std::invalid_argument if the parent is not an earlier node */
+	size_t AddNode(const int parentId, const LocalTransform& transform = LocalTransform());
+
+	void Reserve(const size_t nodesCount);
+	void Clear();
+
+	/** Set the transformation of a node relative to its parent, the node and its descendants are placed again by the next Update */
+	void SetLocalTransform(const size_t nodeId, const LocalTransform& transform);
+
+	/** Set the local matrix of a node as is, a sheared matrix is kept exactly but GetLocalTransform only returns its nearest decomposition */
+	void SetLocalMatrix(const size_t nodeId, const float matrix[16]);
+
+	/** Set the matrix applied above the roots, every node is placed again by the next Update if it differs from the current one */
+	void SetRootTransform(const float matrix[16]);
+
+	/**
+	 * Recompute the world matrices of the nodes edited since the last Update and of their descendants, world = local * parent world,
+	 * in one pass from the first edited node. Return the number of nodes recomputed, GetUpdatedNodes lists them
+	 */
+	size_t Update();
+
+	size_t GetNodesCount() const { return m_parents.size(); }
+	int GetParent(const size_t nodeId) const { return m_parents[nodeId]; }
+	LocalTransform GetLocalTransform(const size_t nodeId) const;
+	const float* GetLocalMatrix(const size_t nodeId) const { return m_localMatrices[nodeId].data(); }
+	const float* GetRootTransform() const { return m_rootTransform.data(); }
+
+	/** Return the model to world matrix of a node, as of the last Update */
+	const float* GetWorldMatrix(const size_t nodeId) const { return m_worldMatrices[nodeId].data(); }
+
+	/** Return the nodes whose world matrix the last Update recomputed, in increasing order */
+	const std::vector<uint32_t>& GetUpdatedNodes() const { return m_updatedNodes; }
+
+	/** Return true if a node or the root transform was edited since the last Update */
+	bool IsDirty() const { return m_isRootDirty || m_firstDirtyNode < m_parents.size(); }
+
+private:
+	void MarkDirty(const size_t nodeId);
+
+	std::vector<int> m_parents;
+	std::vector<std::array<float, 3>> m_translations;
+	std::vector<std::array<float, 4>> m_rotations;
+	std::vector<std::array<float, 3>> m_scales;
+	std::vector<std::array<float, 16>> m_localMatrices;	/*< Composed from the translation, rotation and scale, or set by SetLocalMatrix */
+	std::vector<std::array<float, 16>> m_worldMatrices;
+	std::vector<uint8_t> m_dirtyFlags;					/*< Set for the edited nodes, and for their descendants while Update runs */
+	std::vector<uint32_t> m_updatedNodes;
+	std::array<float, 16> m_rootTransform = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	size_t m_firstDirtyNode = SIZE_MAX;	/*< Nodes before it are all clean, the pass starts there */
+	bool m_isRootDirty = false;
+};
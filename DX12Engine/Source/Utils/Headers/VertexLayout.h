@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "VertexQuantization.h"
+
+struct MeshStreams;
+
+/** The vertex attributes a layout can hold, a layout stores its elements in this order */
+enum VertexAttribute : uint32_t
+{
+	VERTEX_ATTRIBUTE_POSITION = 0,
+	VERTEX_ATTRIBUTE_NORMAL,
+	VERTEX_ATTRIBUTE_TANGENT,
+	VERTEX_ATTRIBUTE_TEXCOORD0,
+	VERTEX_ATTRIBUTE_TEXCOORD1,
+	VERTEX_ATTRIBUTE_COLOR0,
+	VERTEX_ATTRIBUTES_COUNT
+};
+
+/** A set of vertex attributes, one bit per VertexAttribute */
+using VertexFeatures = uint32_t;
+
+constexpr VertexFeatures VERTEX_FEATURE_POSITION = 1u << VERTEX_ATTRIBUTE_POSITION;
+constexpr VertexFeatures VERTEX_FEATURE_NORMAL = 1u << VERTEX_ATTRIBUTE_NORMAL;
+constexpr VertexFeatures VERTEX_FEATURE_TANGENT = 1u << VERTEX_ATTRIBUTE_TANGENT;
+constexpr VertexFeatures VERTEX_FEATURE_TEXCOORD0 = 1u << VERTEX_ATTRIBUTE_TEXCOORD0;
+constexpr VertexFeatures VERTEX_FEATURE_TEXCOORD1 = 1u << VERTEX_ATTRIBUTE_TEXCOORD1;
+constexpr VertexFeatures VERTEX_FEATURE_COLOR0 = 1u << VERTEX_ATTRIBUTE_COLOR0;
+
+/** The attributes read by the mesh vertex shader */
+constexpr VertexFeatures VERTEX_FEATURES_MESH = VERTEX_FEATURE_POSITION | VERTEX_FEATURE_NORMAL | VERTEX_FEATURE_TANGENT | VERTEX_FEATURE_TEXCOORD0;
+
+/** How the elements of a layout are split in vertex buffers */
+enum class VertexSlotsMode : uint32_t
+{
+	Separate = 0,	/*< One buffer per attribute, as glTF stores them: the buffers can be read in place */
+	Interleaved,	/*< A single buffer holding whole vertices */
+	PositionSplit	/*< The positions alone in a first buffer and the other attributes interleaved in a second one, for the passes that only read positions */
+};
+
+/** The description of a vertex attribute */
+struct VertexAttributeDesc
+{
+	const char* gltfSemantic;		/*< The glTF attribute name, as the MeshStreams semantic */
+	const char* semanticName;		/*< The vertex shader input semantic */
+	uint32_t semanticIndex;
+	uint32_t componentsCount;		/*< Floats per vertex */
+	float defaultValue[4];			/*< The components of a vertex whose stream is missing or shorter */
+};
+
+/** Return the description of attribute */
+const VertexAttributeDesc& GetVertexAttributeDesc(const VertexAttribute attribute);
+
+/** An attribute in a vertex buffer of a layout */
+struct VertexElement
+{
+	VertexAttribute attribute = VERTEX_ATTRIBUTE_POSITION;
+	uint32_t componentsCount = 0;	/*< The components of the attribute, as the vertex shader reads them */
+	VertexFormat format = VertexFormat::Float32;
+	uint32_t slot = 0;				/*< The vertex buffer, the input slot of the input layout */
+	uint32_t byteOffset = 0;		/*< From the start of the vertex in its slot */
+};
+
+/** The vertex buffers of a set of attributes, the input layout of the pipelines that read them */
+struct VertexLayout
+{
+	VertexSlotsMode mode = VertexSlotsMode::Separate;
+	VertexFeatures features = 0;
+	VertexQuantization quantization;
+	std::vector<VertexElement> elements;	/*< In the VertexAttribute order, so slots and offsets increase */
+	std::vector<uint32_t> slotStrides;		/*< Bytes per vertex of each slot */
+
+	/** Return the element of attribute, nullptr if the layout does not hold it */
+	const VertexElement* Find(const VertexAttribute attribute) const;
+
+	/** Return the bytes of a vertex, over all the slots */
+	size_t GetVertexByteSize() const;
+};
+
+/**
+ * Return the layout of the features attributes split in slots by mode, in the formats of quantization. Every element is 4 byte aligned.
+ * Throw std::invalid_argument if the features do not include the position or if the texture coordinates format is not a 2D one.
+ */
+VertexLayout CreateVertexLayout(const VertexFeatures features, const VertexSlotsMode mode, const VertexQuantization& quantization = VertexQuantization());
+
+/** The vertices of a mesh packed in a layout, one array of bytes per slot */
+struct PackedVertices
+{
+	std::vector<std::vector<uint8_t>> slots;
+	size_t verticesCount = 0;
+	VertexDequantization dequantization;	/*< The identity if the layout has no quantization */
+};
+
+/**
+ * Pack the streams of mesh in layout. The float elements are copied as they are, bit for bit, the quantized ones are
+ * encoded relative to the bounds of mesh. The layout attributes missing from mesh, and the components a stream lacks,
+ * take the default values of the attributes. The streams the layout does not hold are dropped. The copy kernels are
+ * specialized on the components count and use SSE2 where it is available.
+ */
+PackedVertices PackVertices(const MeshStreams& mesh, const VertexLayout& layout);
+
+/**
+ * Copy count elements of componentsCount floats from the packed src to dst, one element every dstStride bytes.
+ * canOverwrite allows the kernels to store up to 16 bytes per element, past the element but within dstStride:
+ * the bytes that follow are written by the next elements of the vertex.
+ */
+void CopyVertexElements(const float* src, const size_t count, const uint32_t componentsCount, uint8_t* dst, const size_t dstStride, const bool canOverwrite);
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct MeshStreams;
+
+/**
+ * The storage formats of the vertex elements. The 16 bit formats are expanded by the input assembler and decoded
+ * by the mesh vertex shader with the VertexDequantization of the submesh.
+ */
+enum class VertexFormat : uint32_t
+{
+	Float32 = 0,		/*< One 32 bit float per component */
+	Unorm16x4,			/*< Positions relative to the bounds of the submesh, xyz in [0, 1] and w = 1 */
+	OctSnorm16x2,		/*< Unit vectors in octahedral encoding */
+	OctSignSnorm16x2,	/*< Tangents: the octahedral direction with 15 bits for y, the sign of y is the bitangent sign w */
+	Half2,				/*< Texture coordinates as half floats */
+	Unorm16x2			/*< Texture coordinates relative to their bounds */
+};
+
+/** Return the bytes of an element of componentsCount components stored in format */
+uint32_t GetVertexFormatByteSize(const VertexFormat format, const uint32_t componentsCount);
+
+/** The attributes a vertex layout quantizes, everything is stored as floats by default. The colors are never quantized */
+struct VertexQuantization
+{
+	bool positions = false;		/*< Unorm16x4 positions, relative to the bounds of each submesh */
+	bool directions = false;	/*< Octahedral normals and tangents */
+	VertexFormat texCoords = VertexFormat::Float32;	/*< Float32, Half2 or Unorm16x2 */
+
+	bool IsEnabled() const;
+};
+
+/**
+ * The transforms that bring the quantized elements of a submesh back to model units, the identity for float elements.
+ * It is the VertexDequantization root constants buffer of mesh_common.hlsli, the layouts must match.
+ */
+struct VertexDequantization
+{
+	float positionScale[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	float positionOffset[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float texCoordTransforms[2][4] = { { 1.0f, 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f, 0.0f } };	/*< TEXCOORD_0 and TEXCOORD_1, scale in xy and offset in zw */
+	uint32_t octahedralDirections = 0;	/*< 1 if the normals and tangents are octahedral */
+	uint32_t _pad0[3] = {};
+};
+
+/** The vertex bytes saved by the quantization of a set of meshes */
+struct VertexQuantizationReport
+{
+	size_t verticesCount = 0;
+	size_t floatByteSize = 0;		/*< The vertices in the float layout of the same attributes */
+	size_t quantizedByteSize = 0;
+
+	void Add(const VertexQuantizationReport& report);
+};
+
+/**
+ * Return the bounds of the positions and of the texture coordinates of mesh that quantization stores as unorm16.
+ * Components that lie on the grid of an integer or normalized integer type, as the KHR_mesh_quantization attributes,
+ * and that span at most 65535 of its steps keep that exact step: they are stored without loss, up to the float rounding.
+ */
+VertexDequantization ComputeVertexDequantization(const MeshStreams& mesh, const VertexQuantization& quantization);
+
+/** Octahedral encoding of the direction v, that need not be normalized, to [-1, 1]^2. A null vector is encoded as +z */
+void EncodeOctahedral(const float v[3], float oct[2]);
+
+/** Return in v the unit vector of the octahedral coordinates oct */
+void DecodeOctahedral(const float oct[2], float v[3]);
+
+/** IEEE 754 half float conversions, rounding to nearest even. Overflows become infinities and NaNs stay NaNs */
+uint16_t FloatToHalf(const float value);
+float HalfToFloat(const uint16_t half);
+
+/**
+ * Encode count elements of componentsCount floats to format, one element every dstStride bytes. The unorm16 formats
+ * store (value - offset) / scale clamped to [0, 1], offset and scale hold one value per component and are only read by them.
+ * Throw std::invalid_argument if format does not store componentsCount components.
+ */
+void EncodeVertexElements(const VertexFormat format, const float* src, const size_t count, const uint32_t componentsCount,
+	const float* offset, const float* scale, uint8_t* dst, const size_t dstStride);
+
+/**
+ * Decode count elements of format back to componentsCount floats, as the input assembler and the mesh vertex shader do.
+ * The inverse of EncodeVertexElements, up to the quantization error.
+ */
+void DecodeVertexElements(const VertexFormat format, const uint8_t* src, const size_t count, const size_t srcStride, const uint32_t componentsCount,
+	const float* offset, const float* scale, float* dst);
@@ -9,7 +9,9 @@
 #include "SkyBox.h"
 #include "Grid.h"
 #include "GUI.h"
-#include "GLTFSceneLoader.h"
+#include "AsyncSceneLoader.h"
+
+#include <iomanip>
 
 #include "using_directives.h"
 
@@ -101,7 +103,7 @@ void ViewerApp::InitScene()
 {
     CreateTextureFromDDSFile(m_renderer->GetDevice().Get(), m_renderer->GetCommandQueue().Get(), "assets/wood-cubemap.dds", &m_cubeMapTexture);
 
-    m_gltfLoader = std::make_unique<GLTFSceneLoader>(m_renderer->GetDevice(), m_renderer->GetCommandQueue());
+    m_sceneLoader = std::make_unique<AsyncSceneLoader>(m_renderer->GetDevice(), m_renderer->GetCommandQueue());
     m_scene = std::make_shared<Scene>(m_renderer->GetDevice());
     m_scene->SetCubeMapTexture(m_cubeMapTexture);
 
@@ -295,7 +297,33 @@ void ViewerApp::OnMouseMove(const WPARAM btnState, const int x, const int y)
 }; 
 
 void ViewerApp::OnMouseDown(const WPARAM btnState, const int x, const int y)
-{};
+{
+    if (btnState != MK_LBUTTON || m_appState.isLoadingGLTF || m_clientWidth == 0 || m_clientHeight == 0) return;
+
+    // Pick the triangle under the cursor: the ray goes from the cursor on the near plane to the cursor on the far plane
+    XMFLOAT4X4 viewMtx = m_camera->getViewMtx();
+    XMFLOAT4X4 projMtx = m_camera->getProjMtx();
+    XMMATRIX inverseViewProj = XMMatrixInverse(nullptr, XMMatrixMultiply(XMLoadFloat4x4(&viewMtx), XMLoadFloat4x4(&projMtx)));
+    float ndcX = 2.0f * (static_cast<float>(x) + 0.5f) / static_cast<float>(m_clientWidth) - 1.0f;
+    float ndcY = 1.0f - 2.0f * (static_cast<float>(y) + 0.5f) / static_cast<float>(m_clientHeight);
+    XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0.0f, 1.0f), inverseViewProj);
+    XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), inverseViewProj);
+
+    Ray ray;
+    XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(ray.origin), nearPoint);
+    XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(ray.direction), XMVectorSubtract(farPoint, nearPoint));
+    ray.tMax = 1.0f;
+
+    SceneRayHit hit;
+    if (!m_scene->IntersectRay(ray, hit))
+    {
+        m_appState.pickStatus = "Nothing";
+        return;
+    }
+    float distance = hit.t * XMVectorGetX(XMVector3Length(XMVectorSubtract(farPoint, nearPoint)));
+    m_appState.pickStatus = "Mesh " + std::to_string(hit.meshId) + ", submesh " + std::to_string(hit.subMeshId) + ", triangle " + std::to_string(hit.triangle)
+        + " at " + std::to_string(distance);
+};
 
 void ViewerApp::OnMouseUp(const WPARAM btnState, const int x, const int y)
 {};
@@ -316,6 +344,20 @@ void ViewerApp::UpdateScene()
     // Update camera 
     m_camera->update();
     m_scene->SetCamera(*m_camera);
+    m_scene->SetViewportHeight(m_clientHeight);
+    m_scene->SetFrustumCulling(m_appState.cullNodes);
+    m_scene->SetOcclusionCulling(m_appState.cullOccluded);
+    m_scene->SetOccluderReuse(m_appState.reuseOccluders);
+
+    // Culling statistics of the last frame
+    const SceneCullingStats& cullingStats = m_scene->GetCullingStats();
+    m_appState.nodesCount = cullingStats.nodesCount;
+    m_appState.visibleNodesCount = cullingStats.visibleNodesCount;
+    m_appState.subMeshesCount = cullingStats.subMeshesCount;
+    m_appState.visibleSubMeshesCount = cullingStats.visibleSubMeshesCount;
+    m_appState.occludedSubMeshesCount = cullingStats.occludedSubMeshesCount;
+    m_appState.occludersCount = cullingStats.occludersCount;
+    m_appState.batchesCount = cullingStats.batchesCount;
 
     // Update lights
     for (auto light : m_appState.lights) { m_scene->SetLight(light.first, light.second); }
@@ -374,18 +416,56 @@ void ViewerApp::OnUpdate()
         //else OnResize(m_appState.currentScreenWidth, m_appState.currentScreenHeight);
     }
 
-    // Check if a new model loading has been triggered from the menu
-    if(m_appState.isOpenGLTFPressed) 
+    UpdateSceneLoading();
+    UpdateScene();
+}
+
+void ViewerApp::UpdateSceneLoading()
+{
+    // Check if a new model loading has been triggered from the menu, the current scene is drawn until the new one is ready
+    if (m_appState.isOpenGLTFPressed)
     {
-        m_gltfLoader = std::make_unique<GLTFSceneLoader>(m_renderer->GetDevice(), m_renderer->GetCommandQueue());
-        m_gltfLoader->Load(m_appState.gltfFileLoaded);
-        m_gltfLoader->GetScene(0, m_scene);
-        m_scene->SetCubeMapTexture(m_cubeMapTexture);
-        m_camera->lookAt(XMFLOAT3( m_scene->GetSceneRadius() * 1.5f , m_scene->GetSceneRadius() * 1.5f , m_scene->GetSceneRadius() * 1.5f ), { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f });
-        m_cameraStep = m_scene->GetSceneRadius() / 10.0f;
+        m_sceneLoader->Start(m_appState.gltfFileLoaded);
         m_appState.isOpenGLTFPressed = false;
     }
-    UpdateScene();
+
+    if (m_appState.isCancelLoadingPressed)
+    {
+        m_sceneLoader->Cancel();
+        m_appState.isCancelLoadingPressed = false;
+        m_appState.loadingStatus = "Loading cancelled";
+    }
+
+    const LoadingProgress& progress = m_sceneLoader->GetProgress();
+    m_appState.isLoadingGLTF = m_sceneLoader->IsLoading();
+    if (m_appState.isLoadingGLTF)
+    {
+        size_t objectsTotal = progress.objectsTotal;
+        m_appState.loadingProgress = objectsTotal > 0 ? static_cast<float>(progress.objectsDone) / static_cast<float>(objectsTotal) : 0.0f;
+        std::ostringstream status;
+        status << progress.objectsDone << "/" << objectsTotal << " objects, " << std::fixed << std::setprecision(1)
+            << progress.bytesDone / (1024.0 * 1024.0) << "/" << progress.bytesTotal / (1024.0 * 1024.0) << " MB";
+        m_appState.loadingStatus = status.str();
+    }
+
+    std::string error = m_sceneLoader->TakeError();
+    if (!error.empty()) m_appState.loadingStatus = error;
+
+    std::shared_ptr<Scene> loadedScene = m_sceneLoader->TakeScene();
+    if (loadedScene)
+    {
+        m_scene = loadedScene;
+        m_appState.loadingStatus.clear();
+        m_scene->SetCubeMapTexture(m_cubeMapTexture);
+
+        // Frame the bounding sphere of the scene: along the diagonal, the sphere fits in the default field of view
+        m_scene->UpdateBounds();
+        BoundingSphere sphere = m_scene->GetBoundingSphere();
+        float radius = (sphere.radius > 0.0f) ? sphere.radius : 1.0f;
+        XMFLOAT3 center = { sphere.center[0], sphere.center[1], sphere.center[2] };
+        m_camera->lookAt(XMFLOAT3(center.x + radius * 1.5f, center.y + radius * 1.5f, center.z + radius * 1.5f), center, { 0.0f, 1.0f, 0.0f });
+        m_cameraStep = radius / 10.0f;
+    }
 }
 
 void ViewerApp::OnDraw()
@@ -12,7 +12,7 @@ class Scene;
 class SkyBox;
 class Grid;
 class Renderer;
-class GLTFSceneLoader;
+class AsyncSceneLoader;
 struct Light;
 struct MeshConstants;
 
@@ -41,6 +41,7 @@ protected:
 	virtual void InitScene();
 	virtual void InitGui();
 	virtual void UpdateScene();
+	virtual void UpdateSceneLoading();
 	
 	// Event handlers
 	virtual void OnEnterSizeMove();
@@ -68,7 +69,7 @@ protected:
 	UINT m_clientWidth;
 	UINT m_clientHeight;
 	DXGI_MODE_DESC m_fullScreenMode;
-	std::unique_ptr<GLTFSceneLoader> m_gltfLoader;
+	std::unique_ptr<AsyncSceneLoader> m_sceneLoader;
 	AppState m_appState;
 	float m_mouseSensitivity = 0.25f;
 	float m_cameraStep = 0.05f;
@@ -1,7 +1,18 @@
 #include "ViewerApp.h"
+#include "Benchmark.h"
+#include "SceneBaker.h"
 
 int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ PWSTR lpCmdLine, _In_ int nCmdShow)
 {
+    // Command line arguments can select a headless benchmark or the scene converter instead of the viewer
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) args.push_back(DXUtil::transform_to<std::string>(std::wstring(argv[i])));
+    LocalFree(argv);
+    if (Benchmark::IsBenchmarkCommandLine(args)) return Benchmark::Run(args);
+    if (!args.empty() && args[0] == "--bake") return SceneBaker::RunCommandLine(args);
+
     ViewerApp viewer(hInstance);
     viewer.Run();
     DEBUG_LOG("Exiting application");